@@ -189,6 +189,11 @@ namespace cfg
 			return m_value;
 		}
 
+		void set(const T& value)
+		{
+			m_value = value;
+		}
+
 		void from_default() override
 		{
 			m_value = def;
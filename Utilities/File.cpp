@@ -1272,6 +1272,71 @@ fs::file::file(const void* ptr, std::size_t size)
 	m_file = std::make_unique<memory_stream>(ptr, size);
 }
 
+fs::file_view::~file_view()
+{
+	if (m_mapped)
+	{
+#ifdef _WIN32
+		verify("file_view::unmap" HERE), UnmapViewOfFile(m_data);
+#else
+		verify("file_view::unmap" HERE), ::munmap(const_cast<u8*>(m_data), m_size) == 0;
+#endif
+	}
+}
+
+fs::file_view fs::file::map() const
+{
+	if (!m_file) xnull();
+
+	file_view result;
+
+	const u64 size = m_file->size();
+	const native_handle handle = m_file->get_handle();
+
+	// Mapping an empty file is an error, it's also not worth a mapping
+	if (size && size <= SIZE_MAX)
+	{
+#ifdef _WIN32
+		if (handle != INVALID_HANDLE_VALUE)
+		{
+			if (const HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr))
+			{
+				result.m_data = static_cast<const u8*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(mapping);
+			}
+		}
+#else
+		if (handle != -1)
+		{
+			const auto ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, handle, 0);
+
+			if (ptr != MAP_FAILED)
+			{
+				result.m_data = static_cast<const u8*>(ptr);
+			}
+		}
+#endif
+	}
+
+	if (result.m_data)
+	{
+		result.m_size = size;
+		result.m_mapped = true;
+		return result;
+	}
+
+	// Not a native file or mapping failed: read the contents, keep current position
+	const u64 pos = m_file->seek(0, seek_cur);
+	result.m_copy.resize(size);
+	m_file->seek(0, seek_set);
+	result.m_copy.resize(m_file->read(result.m_copy.data(), size));
+	m_file->seek(pos, seek_set);
+
+	result.m_data = result.m_copy.data();
+	result.m_size = result.m_copy.size();
+	return result;
+}
+
 fs::native_handle fs::file::get_handle() const
 {
 	if (m_file)
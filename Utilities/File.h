@@ -178,6 +178,66 @@ namespace fs
 	// Set file access/modification time
 	bool utime(const std::string& path, s64 atime, s64 mtime);
 
+	// Read-only view of the whole file contents (memory-mapped if possible)
+	// The file must not be truncated while the view exists
+	class file_view final
+	{
+		const u8* m_data = nullptr;
+		u64 m_size = 0;
+
+		// Whether m_data is a mapping (otherwise it points to m_copy)
+		bool m_mapped = false;
+
+		std::vector<u8> m_copy;
+
+		friend class file;
+
+	public:
+		file_view() = default;
+
+		file_view(const file_view&) = delete;
+
+		file_view(file_view&& other) noexcept
+			: m_data(std::exchange(other.m_data, nullptr))
+			, m_size(std::exchange(other.m_size, 0))
+			, m_mapped(std::exchange(other.m_mapped, false))
+			, m_copy(std::move(other.m_copy))
+		{
+		}
+
+		file_view& operator=(file_view&& other) noexcept
+		{
+			file_view tmp(std::move(other));
+			std::swap(m_data, tmp.m_data);
+			std::swap(m_size, tmp.m_size);
+			std::swap(m_mapped, tmp.m_mapped);
+			std::swap(m_copy, tmp.m_copy);
+			return *this;
+		}
+
+		~file_view();
+
+		const u8* data() const
+		{
+			return m_data;
+		}
+
+		u64 size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		bool is_mapped() const
+		{
+			return m_mapped;
+		}
+	};
+
 	class file final
 	{
 		std::unique_ptr<file_base> m_file;
@@ -367,6 +427,9 @@ namespace fs
 			return result;
 		}
 
+		// Get read-only view of the full file, falls back to reading it into memory
+		file_view map() const;
+
 		// Get native handle if available
 		native_handle get_handle() const;
 
@@ -8,6 +8,10 @@
 #include "VirtualMemory.h"
 #include <immintrin.h>
 
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
 // Memory manager mutex
 shared_mutex s_mutex2;
 
@@ -165,8 +169,91 @@ void jit_runtime::initialize()
 	std::memcpy(s_data_init.data(), alloc(0, 0, false), s_data_pos);
 }
 
+// Huge pages requested for JIT memory
+static bool s_huge_pages = false;
+
+#ifdef LLVM_AVAILABLE
+static void jit_llvm_huge_pages();
+#endif
+
+void jit_runtime::set_huge_pages(bool enable)
+{
+	s_huge_pages = enable;
+
+	if (!enable)
+	{
+		return;
+	}
+
+	if (!utils::memory_advise_huge(get_jit_memory(), 0x40000000))
+	{
+		LOG_WARNING(GENERAL, "JIT: Huge pages are not supported");
+		return;
+	}
+
+#ifdef LLVM_AVAILABLE
+	jit_llvm_huge_pages();
+#endif
+}
+
+// Perf map file (enabled by set_symbol_export)
+static bool s_symbol_export = false;
+
+static shared_mutex s_symbol_mutex;
+
+static fs::file s_symbol_map;
+
+void jit_runtime::set_symbol_export(bool enable)
+{
+	std::lock_guard lock(s_symbol_mutex);
+
+	s_symbol_export = enable;
+
+	if (!enable)
+	{
+		s_symbol_map.close();
+		return;
+	}
+
+#ifdef __linux__
+	if (!s_symbol_map)
+	{
+		// Standard location expected by perf (previous file from the same pid is discarded)
+		const std::string path = fmt::format("/tmp/perf-%d.map", ::getpid());
+
+		if (!s_symbol_map.open(path, fs::rewrite))
+		{
+			LOG_ERROR(GENERAL, "JIT: Failed to create %s (%s)", path, fs::g_tls_error);
+			return;
+		}
+
+		LOG_NOTICE(GENERAL, "JIT: Writing symbols to %s", path);
+	}
+#endif
+}
+
+void jit_runtime::announce(const void* ptr, std::size_t size, const std::string& name)
+{
+	if (!s_symbol_export || !size)
+	{
+		return;
+	}
+
+	std::lock_guard lock(s_symbol_mutex);
+
+	if (s_symbol_map)
+	{
+		s_symbol_map.write(fmt::format("%x %x %s\n", reinterpret_cast<u64>(ptr), size, name));
+	}
+}
+
 void jit_runtime::finalize() noexcept
 {
+	if (s_huge_pages)
+	{
+		LOG_NOTICE(GENERAL, "JIT: Code memory backed by huge pages: %u KiB", utils::memory_huge_size(get_jit_memory(), 0x40000000) / 1024);
+	}
+
 	// Reset JIT memory
 #ifdef CAN_OVERCOMMIT
 	utils::memory_reset(get_jit_memory(), 0x80000000);
@@ -175,6 +262,12 @@ void jit_runtime::finalize() noexcept
 	utils::memory_decommit(get_jit_memory(), 0x80000000);
 #endif
 
+	if (s_huge_pages)
+	{
+		// Remapped memory loses the advice
+		utils::memory_advise_huge(get_jit_memory(), 0x40000000);
+	}
+
 	s_code_pos = 0;
 	s_data_pos = 0;
 
@@ -235,6 +328,8 @@ void asmjit::build_transaction_abort(asmjit::X86Assembler& c, unsigned char code
 #include <set>
 #include <array>
 #include <deque>
+#include <zlib.h>
+#include "zlib_util.h"
 
 #ifdef _MSC_VER
 #pragma warning(push, 0)
@@ -245,6 +340,7 @@ void asmjit::build_transaction_abort(asmjit::X86Assembler& c, unsigned char code
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Object/SymbolSize.h"
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -288,6 +384,11 @@ static void* const s_memory = []() -> void*
 
 static void* s_next = s_memory;
 
+static void jit_llvm_huge_pages()
+{
+	utils::memory_advise_huge(s_memory, s_memory_size);
+}
+
 #ifdef _WIN32
 static std::deque<std::vector<RUNTIME_FUNCTION>> s_unwater;
 static std::vector<std::vector<RUNTIME_FUNCTION>> s_unwind; // .pdata
@@ -317,8 +418,18 @@ extern void jit_finalize()
 	s_unfire.clear();
 #endif
 
+	if (s_huge_pages)
+	{
+		LOG_NOTICE(GENERAL, "LLVM: Memory backed by huge pages: %u KiB", utils::memory_huge_size(s_memory, s_memory_size) / 1024);
+	}
+
 	utils::memory_decommit(s_memory, s_memory_size);
 
+	if (s_huge_pages)
+	{
+		jit_llvm_huge_pages();
+	}
+
 	s_next = s_memory;
 }
 
@@ -593,6 +704,43 @@ struct EventListener : llvm::JITEventListener
 
 	void notifyObjectLoaded(ObjectKey K, const llvm::object::ObjectFile& obj, const llvm::RuntimeDyld::LoadedObjectInfo& inf) override
 	{
+		if (s_symbol_export)
+		{
+			// Debug object contains final load addresses
+			const auto dbg = inf.getObjectForDebug(obj);
+			const auto& src = dbg.getBinary() ? *dbg.getBinary() : obj;
+
+			for (const auto& [sym, size] : llvm::object::computeSymbolSizes(src))
+			{
+				auto type = sym.getType();
+				auto name = sym.getName();
+				auto addr = sym.getAddress();
+
+				if (!type || !name || !addr)
+				{
+					llvm::consumeError(type.takeError());
+					llvm::consumeError(name.takeError());
+					llvm::consumeError(addr.takeError());
+					continue;
+				}
+
+				if (*type != llvm::object::SymbolRef::ST_Function || !*addr)
+				{
+					continue;
+				}
+
+				std::string str = name->str();
+
+				if (str.compare(0, 4, "__0x") == 0)
+				{
+					// PPU function (guest address)
+					str = "ppu-" + str.substr(2);
+				}
+
+				jit_runtime::announce(reinterpret_cast<const void*>(*addr), size, str);
+			}
+		}
+
 #ifdef _WIN32
 		for (auto it = obj.section_begin(), end = obj.section_end(); it != end; ++it)
 		{
@@ -643,9 +791,22 @@ class ObjectCache final : public llvm::ObjectCache
 {
 	const std::string& m_path;
 
+	// Compress new objects
+	const bool m_compress;
+
+	// Header of compressed object file (followed by zlib stream)
+	struct zobj_header
+	{
+		char magic[8];
+		u64 size; // Uncompressed size
+	};
+
+	static constexpr char s_zobj_magic[8] = {'R', 'P', 'C', 'S', 'Z', 'O', 'B', 'J'};
+
 public:
-	ObjectCache(const std::string& path)
+	ObjectCache(const std::string& path, bool compress = false)
 		: m_path(path)
+		, m_compress(compress)
 	{
 	}
 
@@ -655,6 +816,25 @@ public:
 	{
 		std::string name = m_path;
 		name.append(module->getName());
+
+		if (m_compress)
+		{
+			uLongf zsize = compressBound(obj.getBufferSize());
+			std::vector<u8> zbuf(sizeof(zobj_header) + zsize);
+
+			if (compress2(zbuf.data() + sizeof(zobj_header), &zsize, reinterpret_cast<const Bytef*>(obj.getBufferStart()), obj.getBufferSize(), 6) == Z_OK)
+			{
+				zobj_header header;
+				std::memcpy(header.magic, s_zobj_magic, sizeof(header.magic));
+				header.size = obj.getBufferSize();
+				std::memcpy(zbuf.data(), &header, sizeof(header));
+
+				fs::file(name, fs::rewrite).write(zbuf.data(), sizeof(zobj_header) + zsize);
+				LOG_NOTICE(GENERAL, "LLVM: Created module: %s (compressed 0x%x -> 0x%x)", module->getName().data(), obj.getBufferSize(), zsize);
+				return;
+			}
+		}
+
 		fs::file(name, fs::rewrite).write(obj.getBufferStart(), obj.getBufferSize());
 		LOG_NOTICE(GENERAL, "LLVM: Created module: %s", module->getName().data());
 	}
@@ -663,8 +843,53 @@ public:
 	{
 		if (fs::file cached{path, fs::read})
 		{
+			zobj_header header{};
+
+			if (cached.size() > sizeof(header) && cached.read(header) && std::memcmp(header.magic, s_zobj_magic, sizeof(header.magic)) == 0)
+			{
+				// Deflate can't expand data more than 1032 times, a larger size means a damaged file (treated as a cache miss)
+				const u64 zsize = cached.size() - sizeof(header);
+
+				if (header.size == 0 || header.size > zsize * 1032 || header.size > UINT32_MAX)
+				{
+					LOG_ERROR(GENERAL, "LLVM: Invalid compressed object size 0x%llx (file size 0x%llx): %s", header.size, cached.size(), path);
+					return nullptr;
+				}
+
+				// Decompress object
+				std::vector<u8> zbuf;
+
+				if (!cached.read(zbuf, zsize))
+				{
+					LOG_ERROR(GENERAL, "LLVM: Failed to read object: %s", path);
+					return nullptr;
+				}
+
+				auto buf = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(header.size);
+
+				if (!utils::zlib_decompress(buf->getBufferStart(), buf->getBufferSize(), zbuf.data(), zbuf.size()))
+				{
+					LOG_ERROR(GENERAL, "LLVM: Failed to decompress object: %s", path);
+					return nullptr;
+				}
+
+				return buf;
+			}
+
+			// Raw object: map it read-only, so several instances using the same cache share the page cache instead of private copies
+			if (auto mapped = llvm::MemoryBuffer::getFileSlice(path, cached.size(), 0))
+			{
+				return std::move(mapped.get());
+			}
+
+			cached.seek(0);
 			auto buf = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(cached.size());
-			cached.read(buf->getBufferStart(), buf->getBufferSize());
+
+			if (cached.read(buf->getBufferStart(), buf->getBufferSize()) != buf->getBufferSize())
+			{
+				return nullptr;
+			}
+
 			return buf;
 		}
 
@@ -734,6 +959,7 @@ std::string jit_compiler::cpu(const std::string& _cpu)
 jit_compiler::jit_compiler(const std::unordered_map<std::string, u64>& _link, const std::string& _cpu, u32 flags)
 	: m_link(_link)
 	, m_cpu(cpu(_cpu))
+	, m_flags(flags)
 {
 	std::string result;
 
@@ -778,6 +1004,15 @@ jit_compiler::jit_compiler(const std::unordered_map<std::string, u64>& _link, co
 		if (m_engine)
 		{
 			m_engine->RegisterJITEventListener(m_jit_el.get());
+
+			if (s_symbol_export)
+			{
+				// Returns nullptr unless LLVM was built with LLVM_USE_INTEL_JITEVENTS
+				if (const auto vtune = llvm::JITEventListener::createIntelJITEventListener())
+				{
+					m_engine->RegisterJITEventListener(vtune);
+				}
+			}
 		}
 	}
 
@@ -793,7 +1028,7 @@ jit_compiler::~jit_compiler()
 
 void jit_compiler::add(std::unique_ptr<llvm::Module> module, const std::string& path)
 {
-	ObjectCache cache{path};
+	ObjectCache cache{path, (m_flags & 0x4) != 0};
 	m_engine->setObjectCache(&cache);
 
 	const auto ptr = module.get();
@@ -823,7 +1058,14 @@ void jit_compiler::add(std::unique_ptr<llvm::Module> module)
 
 void jit_compiler::add(const std::string& path)
 {
-	m_engine->addObjectFile(std::move(llvm::object::ObjectFile::createObjectFile(*ObjectCache::load(path)).get()));
+	auto buf = ObjectCache::load(path);
+
+	if (!buf)
+	{
+		fmt::throw_exception("LLVM: Failed to load object: %s" HERE, path);
+	}
+
+	m_engine->addObjectFile(std::move(llvm::object::ObjectFile::createObjectFile(*buf).get()));
 }
 
 void jit_compiler::fin()
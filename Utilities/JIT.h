@@ -6,6 +6,7 @@
 #include <asmjit/asmjit.h>
 #include <array>
 #include <functional>
+#include <string>
 
 enum class jit_class
 {
@@ -33,6 +34,15 @@ struct jit_runtime final : asmjit::HostRuntime
 	// Should be called at least once after global initialization
 	static void initialize();
 
+	// Request huge pages for JIT memory regions (ASMJIT and LLVM)
+	static void set_huge_pages(bool enable);
+
+	// Write symbols for recompiled code to /tmp/perf-<pid>.map (and notify VTune when LLVM supports it)
+	static void set_symbol_export(bool enable);
+
+	// Register executable code range with a readable name for external profilers
+	static void announce(const void* ptr, std::size_t size, const std::string& name);
+
 	// Deallocate all memory
 	static void finalize() noexcept;
 };
@@ -127,6 +137,9 @@ class jit_compiler final
 	// Arch
 	std::string m_cpu;
 
+	// Flags (0x1: auxiliary memory manager, 0x2: large code model, 0x4: compress cached objects)
+	u32 m_flags;
+
 public:
 	jit_compiler(const std::unordered_map<std::string, u64>& _link, const std::string& _cpu, u32 flags = 0);
 	~jit_compiler();
@@ -61,6 +61,116 @@ namespace logs
 	// Memory-mapped buffer size
 	constexpr u64 s_log_size = 32 * 1024 * 1024;
 
+	// Deferred message buffer size
+	constexpr u64 s_record_size = 8 * 1024 * 1024;
+
+	// Deferred message, followed by the arguments, the prefix, and the format string with copied string arguments (or the formatted text)
+	struct alignas(8) record_header
+	{
+		atomic_t<u32> size; // Total size, zero until the record is complete
+		u32 argc; // Argument count, -1 for padding at the end of the buffer
+		u32 prefix_size;
+		u32 text_size; // Formatted text size, if the message couldn't be deferred
+		u64 stamp;
+		channel* ch;
+		level sev;
+		const fmt_type_info* sup; // Null if the message couldn't be deferred
+	};
+
+	// Buffer of deferred messages, filled by logging threads and drained by the writer thread
+	class record_ring
+	{
+		std::unique_ptr<uchar[]> m_data = std::make_unique<uchar[]>(s_record_size);
+
+		alignas(128) atomic_t<u64> m_head{0}; // Bytes reserved
+		alignas(128) atomic_t<u64> m_tail{0}; // Bytes consumed
+
+	public:
+		// Reserve contiguous space for a record (size must be a multiple of 8), waits if the buffer is full
+		record_header* reserve(u32 size)
+		{
+			while (true)
+			{
+				u64 pad = 0;
+
+				const u64 pos = m_head.atomic_op([&](u64& head) -> u64
+				{
+					const u64 off = head % s_record_size;
+
+					pad = off + size > s_record_size ? s_record_size - off : 0;
+
+					if (head + pad + size - m_tail > s_record_size)
+					{
+						return -1;
+					}
+
+					head += pad + size;
+					return head - size;
+				});
+
+				if (UNLIKELY(pos == -1))
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if (pad)
+				{
+					// Skip the end of the buffer
+					const auto hdr = reinterpret_cast<record_header*>(m_data.get() + (pos - pad) % s_record_size);
+					hdr->argc = -1;
+					hdr->size.release(static_cast<u32>(pad));
+				}
+
+				return reinterpret_cast<record_header*>(m_data.get() + pos % s_record_size);
+			}
+		}
+
+		// Get the oldest complete record
+		record_header* front()
+		{
+			while (true)
+			{
+				const u64 tail = m_tail;
+
+				if (tail == m_head)
+				{
+					return nullptr;
+				}
+
+				const auto hdr = reinterpret_cast<record_header*>(m_data.get() + tail % s_record_size);
+
+				if (!hdr->size)
+				{
+					// Still being written
+					return nullptr;
+				}
+
+				if (hdr->argc != -1)
+				{
+					return hdr;
+				}
+
+				pop(hdr);
+			}
+		}
+
+		// Release the record returned by front()
+		void pop(record_header* hdr)
+		{
+			const u32 size = hdr->size;
+
+			// Zero the whole record, a header reserved here later must not see a stale size in old payload bytes
+			std::memset(hdr, 0, size);
+			m_tail += size;
+		}
+
+		bool empty() const
+		{
+			return m_tail == m_head;
+		}
+	};
+
 	class file_writer
 	{
 		fs::file m_file;
@@ -82,9 +192,14 @@ namespace logs
 
 		uchar m_zout[65536];
 
+		record_ring m_records;
+
 		// Write buffered logs immediately
 		bool flush(u64 bufv);
 
+		// Format deferred messages into the buffer (writer thread)
+		bool drain();
+
 	public:
 		file_writer(const std::string& name);
 
@@ -92,8 +207,56 @@ namespace logs
 
 		// Append raw data
 		void log(logs::level sev, const char* text, std::size_t size);
+
+		// Append message to be formatted by the writer thread
+		void log_deferred(u64 stamp, const message& msg, const std::string& prefix, const char* fmt, const fmt_type_info* sup, const u64* args);
 	};
 
+	// Make log file line: level, timestamp, prefix, channel name and text
+	static void append_line(std::string& out, u64 stamp, const message& msg, std::string_view prefix, std::string_view text)
+	{
+		// Used character: U+00B7 (Middle Dot)
+		switch (msg.sev)
+		{
+		case level::always:  out += u8"·A "; break;
+		case level::fatal:   out += u8"·F "; break;
+		case level::error:   out += u8"·E "; break;
+		case level::todo:    out += u8"·U "; break;
+		case level::success: out += u8"·S "; break;
+		case level::warning: out += u8"·W "; break;
+		case level::notice:  out += u8"·! "; break;
+		case level::trace:   out += u8"·T "; break;
+		case level::_uninit: out += u8"·  "; break;
+		}
+
+		// Print µs timestamp
+		const u64 hours = stamp / 3600'000'000;
+		const u64 mins = (stamp % 3600'000'000) / 60'000'000;
+		const u64 secs = (stamp % 60'000'000) / 1'000'000;
+		const u64 frac = (stamp % 1'000'000);
+		fmt::append(out, "%u:%02u:%02u.%06u ", hours, mins, secs, frac);
+
+		if (!prefix.empty())
+		{
+			out += "{";
+			out += prefix;
+			out += "} ";
+		}
+
+		if (msg.ch && '\0' != *msg.ch->name)
+		{
+			out += msg.ch->name;
+			out += msg.sev == level::todo ? " TODO: " : ": ";
+		}
+		else if (msg.sev == level::todo)
+		{
+			out += "TODO: ";
+		}
+
+		out += text;
+		out += '\n';
+	}
+
 	struct channel_info
 	{
 		channel* pointer = nullptr;
@@ -188,6 +351,9 @@ namespace logs
 	// Must be set to true in main()
 	atomic_t<bool> g_init{false};
 
+	// Format log file messages on the writer thread
+	atomic_t<bool> g_deferred{false};
+
 	void reset()
 	{
 		std::lock_guard lock(g_mutex);
@@ -205,6 +371,11 @@ namespace logs
 		get_logger()->channels[ch_name].set_level(value);
 	}
 
+	void set_deferred(bool value)
+	{
+		g_deferred = value;
+	}
+
 	// Must be called in main() to stop accumulating messages in g_messages
 	void set_init()
 	{
@@ -221,6 +392,11 @@ logs::listener::~listener()
 {
 }
 
+bool logs::listener::wants(level) const
+{
+	return true;
+}
+
 void logs::listener::add(logs::listener* _new)
 {
 	// Get first (main) listener
@@ -286,12 +462,34 @@ void logs::message::broadcast(const char* fmt, const fmt_type_info* sup, ...) co
 	for (u64& arg : args)
 		arg = va_arg(c_args, u64);
 	va_end(c_args);
-	fmt::raw_append(text, fmt, sup, args.data());
 	std::string prefix = g_tls_log_prefix();
 
 	// Get first (main) listener
 	listener* lis = get_logger();
 
+	if (g_deferred && g_init)
+	{
+		// The log file gets a binary record, other listeners only get the text if they need it
+		get_logger()->log_deferred(stamp, *this, prefix, fmt, sup, args.data());
+
+		for (lis = lis->m_next; lis; lis = lis->m_next)
+		{
+			if (lis->wants(sev))
+			{
+				if (text.empty())
+				{
+					fmt::raw_append(text, fmt, sup, args.data());
+				}
+
+				lis->log(stamp, *this, prefix, text);
+			}
+		}
+
+		return;
+	}
+
+	fmt::raw_append(text, fmt, sup, args.data());
+
 	if (!g_init)
 	{
 		std::lock_guard lock(g_mutex);
@@ -380,7 +578,8 @@ logs::file_writer::file_writer(const std::string& name)
 		m_fout.open(log_name, fs::rewrite);
 
 		// Compressed log, make it inaccessible (foolproof)
-		if (!m_fout2.open(log_name + ".gz", fs::rewrite + fs::unread) || deflateInit2(&m_zs, 9, Z_DEFLATED, 16 + 15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+		// Fastest level: the log is highly redundant text and compression runs on the logging path
+		if (!m_fout2.open(log_name + ".gz", fs::rewrite + fs::unread) || deflateInit2(&m_zs, Z_BEST_SPEED, Z_DEFLATED, 16 + 15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
 		{
 			m_fout2.close();
 		}
@@ -407,6 +606,9 @@ logs::file_writer::file_writer(const std::string& name)
 
 		while (true)
 		{
+			// Format deferred messages first, they are written out below
+			const bool drained = drain();
+
 			const u64 bufv = m_buf;
 
 			if (bufv & 0xffffff)
@@ -416,7 +618,7 @@ logs::file_writer::file_writer(const std::string& name)
 				continue;
 			}
 
-			if (!flush(bufv))
+			if (!flush(bufv) && !drained)
 			{
 				if (m_out == -1)
 				{
@@ -437,7 +639,7 @@ logs::file_writer::~file_writer()
 	}
 
 	// Stop writer thread
-	while (m_out << 24 < m_buf)
+	while (!m_records.empty() || m_out << 24 < m_buf)
 	{
 		std::this_thread::yield();
 	}
@@ -582,6 +784,198 @@ void logs::file_writer::log(logs::level sev, const char* text, std::size_t size)
 	}
 }
 
+void logs::file_writer::log_deferred(u64 stamp, const message& msg, const std::string& prefix, const char* fmt, const fmt_type_info* sup, const u64* args)
+{
+	if (!m_fptr)
+	{
+		return;
+	}
+
+	// Text of a message which has to be formatted here
+	thread_local std::string text;
+
+	bool deferrable = true;
+	u32 argc = 0;
+	u64 data_size = std::strlen(fmt) + 1;
+
+	for (auto v = sup; v->fmt_string; v++, argc++)
+	{
+		switch (v->kind)
+		{
+		case fmt_type_info::arg_kind::value:
+			break;
+		case fmt_type_info::arg_kind::c_string:
+			data_size += args[argc] ? std::strlen(reinterpret_cast<const char*>(args[argc])) + 1 : 0;
+			break;
+		case fmt_type_info::arg_kind::string:
+			data_size += reinterpret_cast<const std::string*>(args[argc])->size();
+			break;
+		case fmt_type_info::arg_kind::object:
+			deferrable = false;
+			break;
+		}
+	}
+
+	if (!deferrable)
+	{
+		// The argument may not outlive the call
+		text.clear();
+		fmt::raw_append(text, fmt, sup, args);
+		argc = 0;
+		data_size = text.size();
+	}
+
+	const u64 size = ::align(sizeof(record_header) + argc * sizeof(u64) + prefix.size() + data_size, 8);
+
+	if (UNLIKELY(size > s_record_size / 4))
+	{
+		// Huge message, write it directly once the preceding ones are done
+		while (!m_records.empty())
+		{
+			std::this_thread::yield();
+		}
+
+		if (deferrable)
+		{
+			text.clear();
+			fmt::raw_append(text, fmt, sup, args);
+		}
+
+		std::string line;
+		append_line(line, stamp, msg, prefix, text);
+		log(msg.sev, line.data(), line.size());
+		return;
+	}
+
+	const auto hdr = m_records.reserve(static_cast<u32>(size));
+	const auto base = reinterpret_cast<uchar*>(hdr);
+	const auto out = reinterpret_cast<u64*>(hdr + 1);
+
+	hdr->argc = argc;
+	hdr->prefix_size = static_cast<u32>(prefix.size());
+	hdr->text_size = static_cast<u32>(data_size);
+	hdr->stamp = stamp;
+	hdr->ch = msg.ch;
+	hdr->sev = msg.sev;
+	hdr->sup = deferrable ? sup : nullptr;
+
+	uchar* data = reinterpret_cast<uchar*>(out + argc);
+	std::memcpy(data, prefix.data(), prefix.size());
+	data += prefix.size();
+
+	if (!deferrable)
+	{
+		std::memcpy(data, text.data(), text.size());
+		hdr->size.release(static_cast<u32>(size));
+		return;
+	}
+
+	std::memcpy(data, fmt, std::strlen(fmt) + 1);
+	data += std::strlen(fmt) + 1;
+
+	// Strings are copied, their offset in the record replaces the pointer (with the size in the high bits for std::string)
+	for (u32 i = 0; i < argc; i++)
+	{
+		switch (sup[i].kind)
+		{
+		case fmt_type_info::arg_kind::c_string:
+		{
+			if (const auto str = reinterpret_cast<const char*>(args[i]))
+			{
+				const std::size_t len = std::strlen(str) + 1;
+				std::memcpy(data, str, len);
+				out[i] = data - base;
+				data += len;
+			}
+			else
+			{
+				out[i] = 0;
+			}
+
+			break;
+		}
+		case fmt_type_info::arg_kind::string:
+		{
+			const auto& str = *reinterpret_cast<const std::string*>(args[i]);
+			std::memcpy(data, str.data(), str.size());
+			out[i] = (data - base) | u64{str.size()} << 32;
+			data += str.size();
+			break;
+		}
+		default:
+		{
+			out[i] = args[i];
+			break;
+		}
+		}
+	}
+
+	hdr->size.release(static_cast<u32>(size));
+}
+
+bool logs::file_writer::drain()
+{
+	thread_local std::string text;
+	thread_local std::string line;
+	thread_local std::vector<u64> args;
+	thread_local std::vector<std::string> strings;
+
+	bool result = false;
+
+	while (const auto hdr = m_records.front())
+	{
+		const auto base = reinterpret_cast<const uchar*>(hdr);
+		const auto in = reinterpret_cast<const u64*>(hdr + 1);
+		const auto prefix = reinterpret_cast<const char*>(in + hdr->argc);
+		const auto data = prefix + hdr->prefix_size;
+
+		text.clear();
+
+		if (hdr->sup)
+		{
+			args.assign(in, in + hdr->argc);
+			strings.clear();
+			strings.reserve(hdr->argc);
+
+			for (u32 i = 0; i < hdr->argc; i++)
+			{
+				switch (hdr->sup[i].kind)
+				{
+				case fmt_type_info::arg_kind::c_string:
+				{
+					args[i] = args[i] ? reinterpret_cast<u64>(base + args[i]) : 0;
+					break;
+				}
+				case fmt_type_info::arg_kind::string:
+				{
+					strings.emplace_back(reinterpret_cast<const char*>(base + static_cast<u32>(args[i])), args[i] >> 32);
+					args[i] = reinterpret_cast<u64>(&strings.back());
+					break;
+				}
+				default: break;
+				}
+			}
+
+			fmt::raw_append(text, data, hdr->sup, args.data());
+		}
+		else
+		{
+			text.assign(data, hdr->text_size);
+		}
+
+		const level sev = hdr->sev;
+
+		line.clear();
+		append_line(line, hdr->stamp, message{hdr->ch, sev}, {prefix, hdr->prefix_size}, text);
+		m_records.pop(hdr);
+
+		log(sev, line.data(), line.size());
+		result = true;
+	}
+
+	return result;
+}
+
 logs::file_listener::file_listener(const std::string& name)
 	: file_writer(name)
 	, listener()
@@ -619,46 +1013,8 @@ void logs::file_listener::log(u64 stamp, const logs::message& msg, const std::st
 {
 	thread_local std::string text;
 
-	// Used character: U+00B7 (Middle Dot)
-	switch (msg.sev)
-	{
-	case level::always:  text = u8"·A "; break;
-	case level::fatal:   text = u8"·F "; break;
-	case level::error:   text = u8"·E "; break;
-	case level::todo:    text = u8"·U "; break;
-	case level::success: text = u8"·S "; break;
-	case level::warning: text = u8"·W "; break;
-	case level::notice:  text = u8"·! "; break;
-	case level::trace:   text = u8"·T "; break;
-	case level::_uninit: text = u8"·  "; break;
-	}
-
-	// Print µs timestamp
-	const u64 hours = stamp / 3600'000'000;
-	const u64 mins = (stamp % 3600'000'000) / 60'000'000;
-	const u64 secs = (stamp % 60'000'000) / 1'000'000;
-	const u64 frac = (stamp % 1'000'000);
-	fmt::append(text, "%u:%02u:%02u.%06u ", hours, mins, secs, frac);
-
-	if (!prefix.empty())
-	{
-		text += "{";
-		text += prefix;
-		text += "} ";
-	}
-
-	if (msg.ch && '\0' != *msg.ch->name)
-	{
-		text += msg.ch->name;
-		text += msg.sev == level::todo ? " TODO: " : ": ";
-	}
-	else if (msg.sev == level::todo)
-	{
-		text += "TODO: ";
-	}
-
-	text += _text;
-	text += '\n';
+	text.clear();
+	append_line(text, stamp, msg, prefix, _text);
 
 	file_writer::log(msg.sev, text.data(), text.size());
 }
@@ -51,6 +51,9 @@ namespace logs
 		// Process log message
 		virtual void log(u64 stamp, const message& msg, const std::string& prefix, const std::string& text) = 0;
 
+		// Check whether messages of given severity are processed at all (lets deferred logging skip formatting)
+		virtual bool wants(level sev) const;
+
 		// Add new listener
 		static void add(listener*);
 	};
@@ -108,6 +111,9 @@ namespace logs
 
 	// Log level control: register channel if necessary, set channel level
 	void set_level(const std::string&, level);
+
+	// Format log file messages on the writer thread instead of the logging thread
+	void set_deferred(bool);
 }
 
 #define LOG_CHANNEL(ch, ...) ::logs::channel ch(#ch, ##__VA_ARGS__)
@@ -230,16 +230,50 @@ struct fmt_class_string<char*, void> : fmt_class_string<const char*>
 	// Classify char* as const char*
 };
 
+// Detect fmt_unveil<> passing the argument by address (default implementation)
+template <typename T, typename = void>
+struct fmt_unveil_by_address : std::false_type
+{
+};
+
+template <typename T>
+struct fmt_unveil_by_address<T, std::void_t<typename fmt_unveil<T>::u64_wrapper>> : std::true_type
+{
+};
+
+// Detect fmt_class_string<> reading memory through the argument value (marked with is_indirect)
+template <typename T, typename = void>
+struct fmt_class_indirect : std::false_type
+{
+};
+
+template <typename T>
+struct fmt_class_indirect<T, std::void_t<decltype(fmt_class_string<T>::is_indirect)>> : std::true_type
+{
+};
+
 struct fmt_type_info
 {
 	decltype(&fmt_class_string<int>::format) fmt_string;
 
+	// How the u64 argument refers to the value, tells whether it stays valid after the call
+	enum class arg_kind : u8
+	{
+		value,    // Self-contained
+		c_string, // Pointer to a null-terminated string
+		string,   // Pointer to std::string
+		object,   // Pointer to another object, or a value the formatter dereferences
+	} kind;
+
 	template <typename T>
 	static constexpr fmt_type_info make()
 	{
 		return fmt_type_info
 		{
 			&fmt_class_string<T>::format,
+			std::is_same<T, const char*>::value ? arg_kind::c_string :
+			std::is_same<T, std::string>::value ? arg_kind::string :
+			fmt_unveil_by_address<T>::value || fmt_class_indirect<T>::value ? arg_kind::object : arg_kind::value,
 		};
 	}
 };
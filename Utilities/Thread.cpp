@@ -9,6 +9,8 @@
 #include "Emu/Cell/lv2/sys_event.h"
 #include "Thread.h"
 #include "sysinfo.h"
+#include "StrUtil.h"
+#include "asm.h"
 #include <typeinfo>
 #include <thread>
 
@@ -42,6 +44,10 @@
 #include "sync.h"
 #include "Log.h"
 
+#ifdef _WIN32
+DYNAMIC_IMPORT("avrt.dll", AvSetMmThreadCharacteristicsW, HANDLE(LPCWSTR TaskName, LPDWORD TaskIndex));
+#endif
+
 thread_local u64 g_tls_fault_all = 0;
 thread_local u64 g_tls_fault_rsx = 0;
 thread_local u64 g_tls_fault_spu = 0;
@@ -1178,7 +1184,7 @@ bool handle_access_violation(u32 addr, bool is_writing, x64_context* context)
 	}
 
 	// check if address is RawSPU MMIO register
-	if (addr - RAW_SPU_BASE_ADDR < (6 * RAW_SPU_OFFSET) && (addr % RAW_SPU_OFFSET) >= RAW_SPU_PROB_OFFSET)
+	if (spu_thread::is_raw_spu_reg(addr))
 	{
 		auto thread = idm::get<named_thread<spu_thread>>(spu_thread::find_raw_spu((addr - RAW_SPU_BASE_ADDR) / RAW_SPU_OFFSET));
 
@@ -1933,6 +1939,11 @@ void thread_ctrl::detect_cpu_layout()
 	if (!g_native_core_layout.compare_and_swap_test(native_core_arrangement::undefined, native_core_arrangement::generic))
 		return;
 
+	if (const auto& numa = get_numa_layout(); numa.size() > 1)
+	{
+		LOG_NOTICE(GENERAL, "Detected %u NUMA nodes", numa.size());
+	}
+
 	const auto system_id = utils::get_system_info();
 	if (system_id.find("Ryzen") != std::string::npos)
 	{
@@ -1987,15 +1998,348 @@ void thread_ctrl::detect_cpu_layout()
 	}
 }
 
-u16 thread_ctrl::get_affinity_mask(thread_class group)
+// Parse list of ranges (for example, "0-7,16-23")
+static u64 parse_cpu_list(const char* ptr)
 {
-	detect_cpu_layout();
+	u64 mask = 0;
+
+	while (*ptr)
+	{
+		u32 first, last;
+		int len = 0;
+
+		if (std::sscanf(ptr, "%u-%u%n", &first, &last, &len) != 2)
+		{
+			if (std::sscanf(ptr, "%u%n", &first, &len) != 1)
+			{
+				break;
+			}
+
+			last = first;
+		}
+
+		for (u32 cpu = first; cpu <= last && cpu < 64; cpu++)
+		{
+			mask |= 1ull << cpu;
+		}
+
+		ptr += len;
+		ptr += *ptr == ',';
+	}
+
+	return mask;
+}
+
+static u32 count_cpus(u64 mask)
+{
+	return utils::popcnt32(static_cast<u32>(mask)) + utils::popcnt32(static_cast<u32>(mask >> 32));
+}
+
+#ifdef __linux__
+static std::string read_sysfs(const std::string& path)
+{
+	std::string data;
+
+	if (const fs::file file{path})
+	{
+		// Size of sysfs files is unknown, read until the end
+		char buf[256];
+
+		while (const u64 count = file.read(buf, sizeof(buf)))
+		{
+			data.append(buf, count);
+		}
+	}
+
+	return data;
+}
+#endif
+
+const std::vector<u64>& thread_ctrl::get_numa_layout()
+{
+	static const std::vector<u64> s_layout = []
+	{
+		std::vector<u64> result;
+
+#ifdef _WIN32
+		ULONG highest = 0;
+
+		if (GetNumaHighestNodeNumber(&highest))
+		{
+			for (ULONG node = 0; node <= highest && node < 64; node++)
+			{
+				ULONGLONG mask = 0;
+				result.push_back(GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) ? mask : 0);
+			}
+		}
+#elif defined(__linux__)
+		for (u32 node = 0; node < 64; node++)
+		{
+			const std::string cpulist = read_sysfs(fmt::format("/sys/devices/system/node/node%u/cpulist", node));
+
+			if (cpulist.empty())
+			{
+				break;
+			}
+
+			result.push_back(parse_cpu_list(cpulist.c_str()));
+		}
+#endif
+
+		return result;
+	}();
+
+	return s_layout;
+}
+
+// Host CPU topology (first 64 logical CPUs)
+struct cpu_topology
+{
+	std::vector<u64> cores; // SMT siblings of each physical core
+	std::vector<u64> l3_domains; // Logical CPUs sharing an L3 cache
+	u64 performance = 0; // P cores of hybrid CPUs, otherwise all CPUs
+};
+
+static const cpu_topology& get_cpu_topology()
+{
+	static const cpu_topology s_topology = []
+	{
+		cpu_topology result;
+
+#ifdef _WIN32
+		DWORD buffer_size = 0;
+		GetLogicalProcessorInformationEx(RelationAll, nullptr, &buffer_size);
+
+		std::vector<u8> buffer(buffer_size);
+		std::vector<BYTE> classes;
+
+		if (buffer_size && GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &buffer_size))
+		{
+			for (std::size_t pos = 0; pos < buffer_size;)
+			{
+				const auto info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + pos);
+
+				if (info->Relationship == RelationProcessorCore && info->Processor.GroupMask[0].Group == 0)
+				{
+					result.cores.push_back(info->Processor.GroupMask[0].Mask);
+					classes.push_back(info->Processor.EfficiencyClass);
+				}
+				else if (info->Relationship == RelationCache && info->Cache.Level == 3 && info->Cache.GroupMask.Group == 0)
+				{
+					result.l3_domains.push_back(info->Cache.GroupMask.Mask);
+				}
+
+				pos += info->Size;
+			}
+		}
+
+		// Efficiency class is only non-zero on hybrid CPUs, higher is faster
+		BYTE max_class = 0;
+
+		for (BYTE _class : classes)
+		{
+			max_class = std::max(max_class, _class);
+		}
+
+		for (std::size_t i = 0; max_class && i < classes.size(); i++)
+		{
+			if (classes[i] == max_class)
+			{
+				result.performance |= result.cores[i];
+			}
+		}
+#elif defined(__linux__)
+		for (u32 cpu = 0; cpu < 64; cpu++)
+		{
+			const std::string path = fmt::format("/sys/devices/system/cpu/cpu%u/", cpu);
+
+			const u64 siblings = parse_cpu_list(read_sysfs(path + "topology/thread_siblings_list").c_str());
+
+			if (!siblings)
+			{
+				// Offline or missing
+				continue;
+			}
+
+			if (std::find(result.cores.begin(), result.cores.end(), siblings) == result.cores.end())
+			{
+				result.cores.push_back(siblings);
+			}
+
+			for (u32 index = 0; index < 8; index++)
+			{
+				const std::string level = read_sysfs(fmt::format("%scache/index%u/level", path, index));
+
+				if (level.empty())
+				{
+					break;
+				}
+
+				if (std::atoi(level.c_str()) == 3)
+				{
+					const u64 shared = parse_cpu_list(read_sysfs(fmt::format("%scache/index%u/shared_cpu_list", path, index)).c_str());
+
+					if (shared && std::find(result.l3_domains.begin(), result.l3_domains.end(), shared) == result.l3_domains.end())
+					{
+						result.l3_domains.push_back(shared);
+					}
+
+					break;
+				}
+			}
+		}
+
+		// Hybrid Intel CPUs register separate PMUs for P cores and E cores
+		result.performance = parse_cpu_list(read_sysfs("/sys/devices/cpu_core/cpus").c_str());
+#endif
+
+		u64 all = 0;
+
+		for (u64 core : result.cores)
+		{
+			all |= core;
+		}
+
+		if (!(result.performance &= all))
+		{
+			result.performance = all;
+		}
+
+		if (all)
+		{
+			LOG_NOTICE(GENERAL, "CPU topology: %u cores, %u threads, %u L3 domains, %u performance threads", result.cores.size(), count_cpus(all), result.l3_domains.size(), count_cpus(result.performance));
+		}
+
+		return result;
+	}();
+
+	return s_topology;
+}
+
+// Gives RSX and the main PPU thread a physical core each, keeps SPUs in one L3 domain.
+// Returns 0 when the topology is unknown or too small for this.
+static u64 get_topology_affinity_mask(thread_class group)
+{
+	const auto& topo = get_cpu_topology();
+
+	auto get_fast_cores = [&](u64 domain)
+	{
+		std::vector<u64> result;
+
+		for (u64 core : topo.cores)
+		{
+			if ((core & domain) == core && core & topo.performance)
+			{
+				result.push_back(core);
+			}
+		}
+
+		return result;
+	};
+
+	// Order L3 domains by the number of performance threads
+	std::vector<u64> domains = topo.l3_domains;
+
+	std::stable_sort(domains.begin(), domains.end(), [&](u64 a, u64 b)
+	{
+		return count_cpus(a & topo.performance) > count_cpus(b & topo.performance);
+	});
+
+	u64 rsx_mask, ppu_main_mask, ppu_mask, spu_mask = 0;
+
+	if (domains.size() > 1 && get_fast_cores(domains[1]).size() >= 2)
+	{
+		// SPUs get the largest domain, RSX and PPU threads the next one (e.g. multiple CCX or CCD)
+		const auto second = get_fast_cores(domains[1]);
 
+		for (u64 core : get_fast_cores(domains[0]))
+		{
+			spu_mask |= core;
+		}
+
+		rsx_mask = second.end()[-1];
+		ppu_main_mask = second.end()[-2];
+		ppu_mask = domains[1] & topo.performance & ~rsx_mask & ~ppu_main_mask;
+
+		if (!ppu_mask)
+		{
+			ppu_mask = spu_mask;
+		}
+	}
+	else
+	{
+		// Single domain, dedicate the last cores (some Windows code is bound to the first ones)
+		const auto fast = get_fast_cores(domains.empty() ? UINT64_MAX : domains[0]);
+
+		if (fast.size() < 4)
+		{
+			return 0;
+		}
+
+		rsx_mask = fast.end()[-1];
+		ppu_main_mask = fast.end()[-2];
+
+		for (std::size_t i = 0; i + 2 < fast.size(); i++)
+		{
+			spu_mask |= fast[i];
+		}
+
+		ppu_mask = spu_mask;
+	}
+
+	switch (group)
+	{
+	case thread_class::rsx: return rsx_mask;
+	case thread_class::ppu_main: return ppu_main_mask;
+	case thread_class::ppu: return ppu_mask;
+	case thread_class::spu: return spu_mask;
+	default: return 0;
+	}
+}
+
+// Placement from the config, for example "rsx=2-3;ppu_main=4-5;ppu=6-11;spu=6-11"
+static u64 get_override_affinity_mask(thread_class group)
+{
+	const std::string placement = g_cfg.core.thread_placement.get();
+
+	if (placement.empty())
+	{
+		return 0;
+	}
+
+	const char* name = "general";
+
+	switch (group)
+	{
+	case thread_class::general: break;
+	case thread_class::rsx: name = "rsx"; break;
+	case thread_class::spu: name = "spu"; break;
+	case thread_class::ppu: name = "ppu"; break;
+	case thread_class::ppu_main: name = "ppu_main"; break;
+	case thread_class::audio: name = "audio"; break;
+	case thread_class::vblank: name = "vblank"; break;
+	}
+
+	for (const std::string& entry : fmt::split(placement, {";"}))
+	{
+		const auto eq = entry.find('=');
+
+		if (eq != std::string::npos && entry.compare(0, eq, name) == 0)
+		{
+			return parse_cpu_list(entry.c_str() + eq + 1);
+		}
+	}
+
+	return 0;
+}
+
+static u64 get_layout_affinity_mask(native_core_arrangement layout, thread_class group)
+{
 	if (const auto thread_count = std::thread::hardware_concurrency())
 	{
-		const u16 all_cores_mask = thread_count < 16 ? (u16)(~(UINT16_MAX << thread_count)): UINT16_MAX;
+		const u64 all_cores_mask = thread_count < 64 ? ~(UINT64_MAX << thread_count) : UINT64_MAX;
 
-		switch (g_native_core_layout)
+		switch (layout)
 		{
 		default:
 		case native_core_arrangement::generic:
@@ -2004,7 +2348,7 @@ u16 thread_ctrl::get_affinity_mask(thread_class group)
 		}
 		case native_core_arrangement::amd_ccx:
 		{
-			u16 spu_mask, ppu_mask, rsx_mask;
+			u64 spu_mask, ppu_mask, rsx_mask;
 			if (thread_count >= 16)
 			{
 				// Threadripper, R7
@@ -2033,6 +2377,7 @@ u16 thread_ctrl::get_affinity_mask(thread_class group)
 			case thread_class::rsx:
 				return rsx_mask;
 			case thread_class::ppu:
+			case thread_class::ppu_main:
 				return ppu_mask;
 			case thread_class::spu:
 				return spu_mask;
@@ -2048,6 +2393,7 @@ u16 thread_ctrl::get_affinity_mask(thread_class group)
 				{
 				case thread_class::rsx:
 				case thread_class::ppu:
+				case thread_class::ppu_main:
 					return (0b0101 & all_cores_mask);
 				case thread_class::spu:
 					return (0b1010 & all_cores_mask);
@@ -2062,7 +2408,37 @@ u16 thread_ctrl::get_affinity_mask(thread_class group)
 		}
 	}
 
-	return UINT16_MAX;
+	return UINT64_MAX;
+}
+
+u64 thread_ctrl::get_affinity_mask(thread_class group)
+{
+	detect_cpu_layout();
+
+	if (const u64 mask = get_override_affinity_mask(group))
+	{
+		return mask;
+	}
+
+	u64 mask = g_cfg.core.thread_scheduler_enabled ? get_topology_affinity_mask(group) : 0;
+
+	if (!mask)
+	{
+		mask = get_layout_affinity_mask(g_native_core_layout, group);
+	}
+
+	// Restrict emulation threads to the preferred NUMA node
+	if (const s64 node = g_cfg.core.numa_node; node >= 0 && group != thread_class::general)
+	{
+		const auto& numa = get_numa_layout();
+
+		if (static_cast<u64>(node) < numa.size() && numa[node])
+		{
+			return mask & numa[node] ? mask & numa[node] : numa[node];
+		}
+	}
+
+	return mask;
 }
 
 void thread_ctrl::set_native_priority(int priority)
@@ -2098,7 +2474,76 @@ void thread_ctrl::set_native_priority(int priority)
 #endif
 }
 
-void thread_ctrl::set_thread_affinity_mask(u16 mask)
+void thread_ctrl::set_class_priority(thread_class group)
+{
+	const thread_priority_policy policy = g_cfg.core.thread_priority;
+
+	if (policy == thread_priority_policy::disabled)
+	{
+		return;
+	}
+
+	// Only the threads which directly pace frames and audio are raised
+	bool time_critical = false;
+
+	switch (group)
+	{
+	case thread_class::audio: time_critical = policy == thread_priority_policy::realtime; break;
+	case thread_class::rsx:
+	case thread_class::vblank: break;
+	default: return;
+	}
+
+	const bool highest = policy == thread_priority_policy::realtime;
+
+#ifdef _WIN32
+	if (time_critical)
+	{
+		// Multimedia Class Scheduler boosts the thread while the process is in the foreground
+		DWORD task_index = 0;
+
+		if (AvSetMmThreadCharacteristicsW && AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index))
+		{
+			return;
+		}
+
+		LOG_WARNING(GENERAL, "MMCSS registration failed: 0x%x", GetLastError());
+	}
+
+	if (!SetThreadPriority(GetCurrentThread(), highest ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL))
+	{
+		LOG_ERROR(GENERAL, "SetThreadPriority() failed: 0x%x", GetLastError());
+	}
+#else
+	if (time_critical)
+	{
+		struct sched_param param{};
+		param.sched_priority = std::min(sched_get_priority_min(SCHED_FIFO) + 9, sched_get_priority_max(SCHED_FIFO));
+
+		if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+		{
+			// Usually requires CAP_SYS_NICE or RLIMIT_RTPRIO (rtkit grants are not requested here)
+			LOG_WARNING(GENERAL, "SCHED_FIFO is not permitted (%d), using niceness instead", err);
+		}
+		else
+		{
+			return;
+		}
+	}
+
+#ifdef __linux__
+	// Niceness is per thread on Linux, negative values require CAP_SYS_NICE or RLIMIT_NICE
+	if (setpriority(PRIO_PROCESS, ::syscall(SYS_gettid), highest ? -10 : -5) != 0)
+	{
+		LOG_WARNING(GENERAL, "Failed to raise thread niceness (%d)", errno);
+	}
+#else
+	set_native_priority(1);
+#endif
+#endif
+}
+
+void thread_ctrl::set_thread_affinity_mask(u64 mask)
 {
 #ifdef _WIN32
 	HANDLE _this_thread = GetCurrentThread();
@@ -2111,9 +2556,9 @@ void thread_ctrl::set_thread_affinity_mask(u16 mask)
 	cpu_set_t cs;
 	CPU_ZERO(&cs);
 
-	for (u32 core = 0; core < 16u; ++core)
+	for (u32 core = 0; core < 64u; ++core)
 	{
-		if ((u32)mask & (1u << core))
+		if (mask & (1ull << core))
 		{
 			CPU_SET(core, &cs);
 		}
@@ -2122,3 +2567,248 @@ void thread_ctrl::set_thread_affinity_mask(u16 mask)
 	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cs);
 #endif
 }
+
+namespace
+{
+	// Index of the current pool thread (-1 on other threads)
+	thread_local u32 s_pool_worker = -1;
+
+	// Cancellation epoch of the job running on the current thread (-1 if none)
+	thread_local u64 s_job_epoch = -1;
+}
+
+worker_pool::worker_pool()
+	: m_cores(std::max<u32>(std::thread::hardware_concurrency(), 2))
+{
+	m_budget[static_cast<u32>(worker_priority::interactive)] = m_cores;
+	m_budget[static_cast<u32>(worker_priority::compile)] = m_cores;
+	m_budget[static_cast<u32>(worker_priority::background)] = std::max<u32>(m_cores / 4, 1);
+
+	for (u32 i = 0; i < m_cores; i++)
+	{
+		m_queues.emplace_back(std::make_unique<job_queue[]>(static_cast<u32>(worker_priority::count)));
+	}
+
+	for (u32 i = 0; i < m_cores; i++)
+	{
+		thread_ctrl::spawn(fmt::format("Worker Pool %u", i), [this, i]
+		{
+			worker(i);
+		});
+	}
+}
+
+worker_pool& worker_pool::get()
+{
+	// Leaked on purpose: the workers never exit, so the pool must outlive static destruction
+	static worker_pool& s_pool = *new worker_pool;
+	return s_pool;
+}
+
+void worker_pool::worker(u32 index)
+{
+	s_pool_worker = index;
+
+	int native_priority = 0;
+
+	while (true)
+	{
+		const u64 version = m_version;
+
+		if (job j; try_pop(j, index, nullptr))
+		{
+			// Only interactive jobs compete with emulator threads at normal priority
+			const int priority = j.prio == worker_priority::interactive ? 0 : -1;
+
+			if (priority != native_priority)
+			{
+				thread_ctrl::set_native_priority(priority);
+				native_priority = priority;
+			}
+
+			run(j);
+			continue;
+		}
+
+		std::lock_guard lock(m_mutex);
+
+		if (m_version == version)
+		{
+			m_cv.wait(m_mutex, 100000);
+		}
+	}
+}
+
+bool worker_pool::try_pop(job& out, u32 self, const group* filter, bool reserve)
+{
+	auto take = [&](job_queue& queue, bool lifo)
+	{
+		if (!queue.count)
+		{
+			return false;
+		}
+
+		std::lock_guard lock(queue.mutex);
+
+		auto found = queue.jobs.end();
+
+		if (filter)
+		{
+			found = std::find_if(queue.jobs.begin(), queue.jobs.end(), [&](const job& j) { return j.grp == filter; });
+		}
+		else if (!queue.jobs.empty())
+		{
+			found = lifo ? queue.jobs.end() - 1 : queue.jobs.begin();
+		}
+
+		if (found == queue.jobs.end())
+		{
+			return false;
+		}
+
+		out = std::move(*found);
+		queue.jobs.erase(found);
+		queue.count--;
+		return true;
+	};
+
+	for (u32 p = 0; p < static_cast<u32>(worker_priority::count); p++)
+	{
+		if (!reserve)
+		{
+			m_running[p]++;
+		}
+		else if (!m_running[p].try_inc(m_budget[p]))
+		{
+			continue;
+		}
+
+		// Own queue first (newest job, probably hot in cache), then injected jobs, then steal the oldest job of another worker
+		if ((self < m_cores && take(m_queues[self][p], true)) || take(m_inject[p], false))
+		{
+			return true;
+		}
+
+		for (u32 i = 1; i <= m_cores; i++)
+		{
+			const u32 victim = (self + i) % m_cores;
+
+			if (victim != self && take(m_queues[victim][p], false))
+			{
+				return true;
+			}
+		}
+
+		m_running[p]--;
+	}
+
+	return false;
+}
+
+void worker_pool::run(job& j)
+{
+	const u64 epoch = std::exchange(s_job_epoch, j.epoch);
+
+	try
+	{
+		j.func();
+	}
+	catch (...)
+	{
+		catch_all_exceptions();
+	}
+
+	s_job_epoch = epoch;
+	j.func = nullptr;
+
+	// Release the budget slot, the group may be destroyed as soon as it's completed
+	m_running[static_cast<u32>(j.prio)]--;
+
+	if (j.grp)
+	{
+		j.grp->m_pending--;
+	}
+
+	signal();
+}
+
+void worker_pool::signal()
+{
+	m_version++;
+
+	// Don't let the notification slip between the version check and the wait
+	{
+		std::lock_guard lock(m_mutex);
+	}
+
+	m_cv.notify_all();
+}
+
+void worker_pool::submit(worker_priority prio, std::function<void()> func, group* grp)
+{
+	const u32 p = static_cast<u32>(prio);
+
+	if (grp)
+	{
+		grp->m_pending++;
+	}
+
+	job_queue& queue = s_pool_worker < m_cores ? m_queues[s_pool_worker][p] : m_inject[p];
+
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.jobs.push_back(job{std::move(func), grp, m_epoch, prio});
+		queue.count++;
+	}
+
+	signal();
+}
+
+void worker_pool::submit_n(worker_priority prio, u32 count, const std::function<void()>& func, group* grp)
+{
+	for (u32 i = 0; i < count; i++)
+	{
+		submit(prio, func, grp);
+	}
+}
+
+void worker_pool::set_compile_budget(u32 threads)
+{
+	m_budget[static_cast<u32>(worker_priority::compile)] = threads ? std::min(threads, m_cores) : m_cores;
+	signal();
+}
+
+void worker_pool::cancel()
+{
+	m_epoch++;
+}
+
+bool worker_pool::is_cancelled()
+{
+	return s_job_epoch != u64(-1) && s_job_epoch < get().m_epoch;
+}
+
+void worker_pool::group::wait()
+{
+	while (m_pending)
+	{
+		worker_pool& pool = worker_pool::get();
+
+		const u64 version = pool.m_version;
+
+		// Help with the jobs of this group only, other jobs may depend on what the caller holds
+		// A job waiting here lends its own budget slot, so a budget of 1 doesn't deadlock
+		if (job j; pool.try_pop(j, s_pool_worker, this, s_job_epoch == u64(-1)))
+		{
+			pool.run(j);
+			continue;
+		}
+
+		std::lock_guard lock(pool.m_mutex);
+
+		if (m_pending && pool.m_version == version)
+		{
+			pool.m_cv.wait(pool.m_mutex, 10000);
+		}
+	}
+}
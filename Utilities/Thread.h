@@ -6,6 +6,9 @@
 #include <string>
 #include <memory>
 #include <string_view>
+#include <vector>
+#include <deque>
+#include <functional>
 
 #include "mutex.h"
 #include "cond.h"
@@ -31,7 +34,10 @@ enum class thread_class : u32
 	general,
 	rsx,
 	spu,
-	ppu
+	ppu,
+	ppu_main, // The first PPU thread of the process
+	audio,
+	vblank,
 };
 
 enum class thread_state
@@ -257,14 +263,20 @@ public:
 	// Detect layout
 	static void detect_cpu_layout();
 
+	// Returns core masks of NUMA nodes (empty if unavailable)
+	static const std::vector<u64>& get_numa_layout();
+
 	// Returns a core affinity mask. Set whether to generate the high priority set or not
-	static u16 get_affinity_mask(thread_class group);
+	static u64 get_affinity_mask(thread_class group);
 
 	// Sets the native thread priority
 	static void set_native_priority(int priority);
 
+	// Sets the native priority of the thread class according to the configured policy
+	static void set_class_priority(thread_class group);
+
 	// Sets the preferred affinity mask for this thread
-	static void set_thread_affinity_mask(u16 mask);
+	static void set_thread_affinity_mask(u64 mask);
 
 	// Spawn a detached named thread
 	template <typename F>
@@ -428,3 +440,123 @@ public:
 		}
 	}
 };
+
+// Priority classes of worker_pool jobs, in the order they are picked
+enum class worker_priority : u32
+{
+	interactive, // Work the running title waits for
+	compile, // Bulk recompilation and cache building, limited by the compile budget
+	background, // IO and other idle work, limited to a quarter of the cores
+
+	count
+};
+
+// Shared work-stealing pool for background jobs
+class worker_pool final
+{
+public:
+	// Completion counter for a set of jobs
+	class group
+	{
+		atomic_t<u32> m_pending{0};
+
+		friend class worker_pool;
+
+	public:
+		group() = default;
+
+		group(const group&) = delete;
+
+		group& operator=(const group&) = delete;
+
+		~group()
+		{
+			wait();
+		}
+
+		// Wait for all jobs of the group, running queued jobs on the current thread meanwhile
+		void wait();
+	};
+
+	struct job
+	{
+		std::function<void()> func;
+		group* grp;
+		u64 epoch;
+		worker_priority prio;
+	};
+
+private:
+	struct job_queue
+	{
+		shared_mutex mutex;
+		std::deque<job> jobs;
+
+		// Checked before locking
+		atomic_t<u32> count{0};
+	};
+
+	// Per-worker queues (owner pushes and pops at the back, thieves take from the front), then injection queues
+	std::vector<std::unique_ptr<job_queue[]>> m_queues;
+	job_queue m_inject[static_cast<u32>(worker_priority::count)];
+
+	// Running jobs and their limits per priority
+	atomic_t<u32> m_running[static_cast<u32>(worker_priority::count)]{};
+	atomic_t<u32> m_budget[static_cast<u32>(worker_priority::count)]{};
+
+	// Incremented whenever a job may have become runnable or a group has completed
+	atomic_t<u64> m_version{0};
+	shared_mutex m_mutex;
+	cond_variable m_cv;
+
+	// Cancellation epoch: jobs submitted before the last cancel() report is_cancelled()
+	atomic_t<u64> m_epoch{0};
+
+	u32 m_cores = 0;
+
+	worker_pool();
+
+	void worker(u32 index);
+
+	// Reserve a budget slot and take a job (only of the specified group if not null)
+	// Without reserve, the slot is taken regardless of the budget (the caller is a job blocked on the group)
+	bool try_pop(job& out, u32 self, const group* filter, bool reserve = true);
+
+	void run(job& j);
+
+	void signal();
+
+public:
+	worker_pool(const worker_pool&) = delete;
+
+	worker_pool& operator=(const worker_pool&) = delete;
+
+	static worker_pool& get();
+
+	// Queue a job (on the current worker's own queue when called from a pool thread)
+	void submit(worker_priority prio, std::function<void()> func, group* grp = nullptr);
+
+	// Queue count copies of a job, for workers consuming a shared work index
+	void submit_n(worker_priority prio, u32 count, const std::function<void()>& func, group* grp = nullptr);
+
+	// Number of pool threads
+	u32 size() const
+	{
+		return m_cores;
+	}
+
+	// Get the max number of simultaneous jobs of the class
+	u32 get_budget(worker_priority prio) const
+	{
+		return m_budget[static_cast<u32>(prio)];
+	}
+
+	// Set compile job limit (0 = all cores)
+	void set_compile_budget(u32 threads);
+
+	// Make jobs submitted until now see is_cancelled() (queued jobs still run, so counters stay balanced)
+	void cancel();
+
+	// True if the job running on the current thread was cancelled
+	static bool is_cancelled();
+};
@@ -134,6 +134,205 @@ namespace utils
 #endif
 	}
 
+	bool memory_advise_huge(void* pointer, std::size_t size)
+	{
+#ifdef MADV_HUGEPAGE
+		// Transparent huge pages (the flag survives mprotect, but not remapping)
+		return ::madvise(pointer, size, MADV_HUGEPAGE) != -1;
+#else
+		// Windows large pages can't be committed incrementally from reserved memory
+		return false;
+#endif
+	}
+
+	bool memory_huge_shm_enabled()
+	{
+#ifdef __linux__
+		// Shared memory has its own THP policy, the selected value is shown in brackets
+		const fs::file policy("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+
+		if (!policy)
+		{
+			return false;
+		}
+
+		// Size of sysfs files is unknown, read what is there
+		char buf[256];
+		const std::string_view value(buf, policy.read(buf, sizeof(buf)));
+
+		for (std::string_view mode : {"[always]", "[within_size]", "[advise]", "[force]"})
+		{
+			if (value.find(mode) != std::string_view::npos)
+			{
+				return true;
+			}
+		}
+
+		return false;
+#else
+		return false;
+#endif
+	}
+
+	bool memory_bind_node(void* pointer, std::size_t size, u32 node)
+	{
+#ifdef __NR_mbind
+		if (node >= 64)
+		{
+			return false;
+		}
+
+		// MPOL_PREFERRED: fall back to other nodes instead of failing when the node is full
+		const unsigned long mask = 1ul << node;
+		return ::syscall(__NR_mbind, pointer, size, 1, &mask, sizeof(mask) * 8 + 1, 0) == 0;
+#else
+		// Windows only supports node selection at commit time (VirtualAllocExNuma)
+		return false;
+#endif
+	}
+
+	std::size_t memory_huge_size(void* pointer, std::size_t size)
+	{
+#ifdef __linux__
+		const u64 start = reinterpret_cast<u64>(pointer), end = start + size;
+
+		std::size_t result = 0;
+		bool in_range = false;
+
+		const fs::file smaps("/proc/self/smaps");
+
+		if (!smaps)
+		{
+			return 0;
+		}
+
+		// Size of procfs files is unknown, read until the end
+		std::string data;
+		char buf[4096];
+
+		while (const u64 count = smaps.read(buf, sizeof(buf)))
+		{
+			data.append(buf, count);
+		}
+
+		for (std::string_view maps = data; !maps.empty();)
+		{
+			const auto line = maps.substr(0, maps.find_first_of('\n'));
+			maps.remove_prefix(std::min(line.size() + 1, maps.size()));
+
+			unsigned long long first, last;
+
+			if (std::sscanf(std::string(line).c_str(), "%llx-%llx ", &first, &last) == 2)
+			{
+				// Mapping header
+				in_range = first < end && last > start;
+			}
+			else if (in_range && line.compare(0, 14, "AnonHugePages:") == 0)
+			{
+				result += std::strtoull(std::string(line.substr(14)).c_str(), nullptr, 10) * 1024;
+			}
+			else if (in_range && line.compare(0, 15, "ShmemPmdMapped:") == 0)
+			{
+				// Guest memory allocations are utils::shm mappings
+				result += std::strtoull(std::string(line.substr(15)).c_str(), nullptr, 10) * 1024;
+			}
+		}
+
+		return result;
+#else
+		return 0;
+#endif
+	}
+
+#ifdef __linux__
+	static bool memory_watch_clear()
+	{
+		// Writing 4 clears soft-dirty bits of all pages
+		const int fd = ::open("/proc/self/clear_refs", O_WRONLY);
+
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		const bool result = ::write(fd, "4", 1) == 1;
+		::close(fd);
+		return result;
+	}
+
+	static bool memory_watch_read(void* pointer, std::size_t size, std::vector<u64>& entries)
+	{
+		const u64 first = reinterpret_cast<u64>(pointer) / 4096;
+		const u64 count = (reinterpret_cast<u64>(pointer) + size + 4095) / 4096 - first;
+
+		const int fd = ::open("/proc/self/pagemap", O_RDONLY);
+
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		entries.resize(count);
+		const bool result = ::pread(fd, entries.data(), count * 8, first * 8) == static_cast<ssize_t>(count * 8);
+		::close(fd);
+		return result;
+	}
+#endif
+
+	bool memory_watch_reset()
+	{
+#ifdef __linux__
+		// Check once that the kernel actually tracks writes (CONFIG_MEM_SOFT_DIRTY)
+		static const bool s_supported = []
+		{
+			const auto ptr = static_cast<volatile u8*>(::mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0));
+
+			if (ptr == MAP_FAILED)
+			{
+				return false;
+			}
+
+			std::vector<u64> entries;
+			ptr[0] = 1;
+			bool result = memory_watch_clear() && memory_watch_read((void*)ptr, 4096, entries) && !(entries[0] >> 55 & 1);
+			ptr[0] = 2;
+			result = result && memory_watch_read((void*)ptr, 4096, entries) && (entries[0] >> 55 & 1);
+
+			::munmap((void*)ptr, 4096);
+			return result;
+		}();
+
+		return s_supported && memory_watch_clear();
+#else
+		// Write watch on Windows requires MEM_WRITE_WATCH reservations, which can't be used with shared memory views
+		return false;
+#endif
+	}
+
+	bool memory_watch_get(void* pointer, std::size_t size, std::vector<u8>& written)
+	{
+#ifdef __linux__
+		std::vector<u64> entries;
+
+		if (!memory_watch_read(pointer, size, entries))
+		{
+			return false;
+		}
+
+		written.resize(entries.size());
+
+		for (std::size_t i = 0; i < entries.size(); i++)
+		{
+			// Bit 55: page was written since the last reset
+			written[i] = entries[i] >> 55 & 1;
+		}
+
+		return true;
+#else
+		return false;
+#endif
+	}
+
 	shm::shm(u32 size)
 		: m_size(::align(size, 0x10000))
 	{
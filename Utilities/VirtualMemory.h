@@ -37,6 +37,24 @@ namespace utils
 	// Set memory protection
 	void memory_protect(void* pointer, std::size_t size, protection prot);
 
+	// Advise the OS to back memory with huge pages where possible (returns false if unsupported)
+	bool memory_advise_huge(void* pointer, std::size_t size);
+
+	// Check if advised shared memory (utils::shm mappings) can be backed by huge pages
+	bool memory_huge_shm_enabled();
+
+	// Prefer allocating pages of the range on given NUMA node (applies to pages touched afterwards)
+	bool memory_bind_node(void* pointer, std::size_t size, u32 node);
+
+	// Get the amount of memory in the range backed by huge pages
+	std::size_t memory_huge_size(void* pointer, std::size_t size);
+
+	// Reset write tracking (soft-dirty bits) for all memory of the process, returns false if unsupported
+	bool memory_watch_reset();
+
+	// Get pages written since the last reset (one value per 4K page), returns false if unsupported
+	bool memory_watch_get(void* pointer, std::size_t size, std::vector<u8>& written);
+
 	// Shared memory handle
 	class shm
 	{
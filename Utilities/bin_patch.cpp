@@ -108,7 +108,7 @@ void patch_engine::append(const std::string& patch)
 	}
 }
 
-std::size_t patch_engine::apply(const std::string& name, u8* dst) const
+std::size_t patch_engine::apply(const std::string& name, u8* dst, std::vector<u32>* offsets) const
 {
 	const auto found = m_map.find(name);
 
@@ -122,6 +122,29 @@ std::size_t patch_engine::apply(const std::string& name, u8* dst) const
 	{
 		auto ptr = dst + p.offset;
 
+		if (offsets && p.type != patch_type::load)
+		{
+			u32 size = 1;
+
+			switch (p.type)
+			{
+			case patch_type::le16:
+			case patch_type::be16: size = 2; break;
+			case patch_type::le32:
+			case patch_type::lef32:
+			case patch_type::be32:
+			case patch_type::bef32: size = 4; break;
+			case patch_type::le64:
+			case patch_type::lef64:
+			case patch_type::be64:
+			case patch_type::bef64: size = 8; break;
+			default: break;
+			}
+
+			offsets->emplace_back(p.offset);
+			offsets->emplace_back(p.offset + size - 1);
+		}
+
 		switch (p.type)
 		{
 		case patch_type::load:
@@ -37,6 +37,6 @@ public:
 	// Load from file
 	void append(const std::string& path);
 
-	// Apply patch (returns the number of entries applied)
-	std::size_t apply(const std::string& name, u8* dst) const;
+	// Apply patch (returns the number of entries applied), optionally appends the offsets of modified bytes (first and last of each entry)
+	std::size_t apply(const std::string& name, u8* dst, std::vector<u32>* offsets = nullptr) const;
 };
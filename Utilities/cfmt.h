@@ -95,6 +95,20 @@ std::size_t cfmt_append(Dst& out, const Char* fmt, Src&& src)
 		}
 	};
 
+	// Append literal text up to the next format sequence at once
+	const auto write_literal = [&]
+	{
+		const Char* end = fmt;
+
+		while (*end && *end != '%')
+		{
+			end++;
+		}
+
+		out.insert(out.end(), fmt - 1, end);
+		fmt = end;
+	};
+
 	// Single pass over fmt string (null-terminated), TODO: check correct order
 	while (const Char ch = *fmt++) if (ctx.size == 0)
 	{
@@ -104,7 +118,7 @@ std::size_t cfmt_append(Dst& out, const Char* fmt, Src&& src)
 		}
 		else
 		{
-			out.push_back(ch);
+			write_literal();
 		}
 	}
 	else if (ctx.size == 1 && ch == '%')
@@ -114,7 +128,16 @@ std::size_t cfmt_append(Dst& out, const Char* fmt, Src&& src)
 	}
 	else if (ctx.size == -1)
 	{
-		out.push_back(ch);
+		// Formatting stopped, copy the rest
+		const Char* end = fmt;
+
+		while (*end)
+		{
+			end++;
+		}
+
+		out.insert(out.end(), fmt - 1, end);
+		fmt = end;
 	}
 	else switch (ctx.size++, ch)
 	{
@@ -1,6 +1,7 @@
 #include "cond.h"
 #include "sync.h"
 #include "lockless.h"
+#include "lock_profiler.h"
 
 #include <limits.h>
 
@@ -12,6 +13,33 @@ bool cond_variable::imp_wait(u32 _old, u64 _timeout) noexcept
 {
 	verify("cond_variable overflow" HERE), (_old & 0xffff) != 0xffff; // Very unlikely: it requires 65535 distinct threads to wait simultaneously
 
+	lock_profiler::wait_timer timer(this);
+
+#ifdef _WIN32
+	// Keyed events can't tolerate a signal consumed without waiting
+	const bool can_spin = _timeout && OptWaitOnAddress;
+#else
+	const bool can_spin = _timeout != 0;
+#endif
+
+	// Wait briefly for the signal before parking
+	if (can_spin && spin_budget::spin(this, [&]
+	{
+		return m_value >> 16 && m_value.atomic_op([](u32& value)
+		{
+			if (value >> 16)
+			{
+				value -= 0x10001;
+				return true;
+			}
+
+			return false;
+		});
+	}))
+	{
+		return true;
+	}
+
 	return balanced_wait_until(m_value, _timeout, [&](u32& value, auto... ret) -> int
 	{
 		if (value >> 16)
@@ -0,0 +1,215 @@
+﻿#include "lock_profiler.h"
+#include "StrFmt.h"
+#include "Thread.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace lock_profiler
+{
+	atomic_t<bool> g_enabled{false};
+
+	namespace
+	{
+		// Enough to tell which threads fight over a lock without growing per wait
+		constexpr size_t max_contenders = 8;
+
+		struct object_key
+		{
+			const char* type;
+			u32 id;
+
+			bool operator==(const object_key& rhs) const
+			{
+				return type == rhs.type && id == rhs.id;
+			}
+		};
+
+		struct object_key_hash
+		{
+			size_t operator()(const object_key& key) const
+			{
+				return std::hash<const void*>()(key.type) ^ key.id;
+			}
+		};
+
+		struct profiler_state
+		{
+			// Not a shared_mutex: they are instrumented themselves
+			std::mutex mutex;
+			std::unordered_map<const void*, std::string> names;
+			std::unordered_map<const void*, lock_stats> host;
+			std::unordered_map<object_key, lock_stats, object_key_hash> guest;
+			std::vector<lock_stats> retired;
+		};
+
+		profiler_state& get_state()
+		{
+			static profiler_state s_state;
+			return s_state;
+		}
+
+		std::string get_thread_name()
+		{
+			if (thread_ctrl::get_current())
+			{
+				return std::string(thread_ctrl::get_name());
+			}
+
+			return "main";
+		}
+
+		void add_wait(lock_stats& stats, u64 ns, std::string&& thread)
+		{
+			stats.count++;
+			stats.total_ns += ns;
+			stats.max_ns = std::max(stats.max_ns, ns);
+
+			if (stats.contenders.size() < max_contenders && std::find(stats.contenders.begin(), stats.contenders.end(), thread) == stats.contenders.end())
+			{
+				stats.contenders.emplace_back(std::move(thread));
+			}
+		}
+	}
+
+	u64 now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void set_name(const void* lock, const char* name)
+	{
+		auto& state = get_state();
+		std::lock_guard lock_state(state.mutex);
+		state.names[lock] = name;
+	}
+
+	void remove_name(const void* lock)
+	{
+		auto& state = get_state();
+		std::lock_guard lock_state(state.mutex);
+		state.names.erase(lock);
+
+		// The address may be reused by an unrelated lock, keep what was recorded aside
+		if (auto found = state.host.find(lock); found != state.host.end())
+		{
+			state.retired.emplace_back(std::move(found->second));
+			state.host.erase(found);
+		}
+	}
+
+	void record(const void* lock, u64 ns)
+	{
+		std::string thread = get_thread_name();
+
+		auto& state = get_state();
+		std::lock_guard lock_state(state.mutex);
+
+		auto& stats = state.host[lock];
+
+		if (stats.name.empty())
+		{
+			if (auto found = state.names.find(lock); found != state.names.end())
+			{
+				stats.name = found->second;
+			}
+			else
+			{
+				stats.name = fmt::format("%p", lock);
+			}
+		}
+
+		add_wait(stats, ns, std::move(thread));
+	}
+
+	void record_object(const char* type, u32 id, u64 name, u64 ns)
+	{
+		std::string thread = get_thread_name();
+
+		auto& state = get_state();
+		std::lock_guard lock_state(state.mutex);
+
+		auto& stats = state.guest[{type, id}];
+
+		if (stats.name.empty())
+		{
+			// lv2 names are 8 characters, not necessarily terminated
+			char str[9]{};
+			std::memcpy(str, &name, 8);
+			stats.name = fmt::format("%s 0x%x '%s'", type, id, str);
+		}
+
+		add_wait(stats, ns, std::move(thread));
+	}
+
+	std::vector<lock_stats> get_stats()
+	{
+		std::vector<lock_stats> result;
+
+		{
+			auto& state = get_state();
+			std::lock_guard lock_state(state.mutex);
+
+			result = state.retired;
+			result.reserve(result.size() + state.host.size() + state.guest.size());
+
+			for (auto& [key, stats] : state.host)
+			{
+				result.emplace_back(stats);
+			}
+
+			for (auto& [key, stats] : state.guest)
+			{
+				result.emplace_back(stats);
+			}
+		}
+
+		std::sort(result.begin(), result.end(), [](const lock_stats& a, const lock_stats& b)
+		{
+			return a.total_ns > b.total_ns;
+		});
+
+		return result;
+	}
+
+	void start()
+	{
+		{
+			auto& state = get_state();
+			std::lock_guard lock_state(state.mutex);
+			state.host.clear();
+			state.guest.clear();
+			state.retired.clear();
+		}
+
+		g_enabled = true;
+	}
+
+	void stop()
+	{
+		if (!g_enabled.exchange(false))
+		{
+			return;
+		}
+
+		const auto stats = get_stats();
+
+		std::string out;
+
+		for (const auto& entry : stats)
+		{
+			fmt::append(out, "\n%s: %u waits, total %.3f ms, max %.3f ms, avg %.3f us, threads:", entry.name, entry.count, entry.total_ns / 1000000., entry.max_ns / 1000000., entry.total_ns / 1000. / entry.count);
+
+			for (const auto& thread : entry.contenders)
+			{
+				fmt::append(out, " %s", thread);
+			}
+		}
+
+		LOG_NOTICE(GENERAL, "Lock contention (%u locks):%s", stats.size(), out);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.h"
+#include "Atomic.h"
+
+#include <string>
+#include <vector>
+
+// Opt-in wait time statistics for host locks and guest synchronization objects
+namespace lock_profiler
+{
+	// Tested before anything else, so disabled profiling costs a single load on the slow path of a lock
+	extern atomic_t<bool> g_enabled;
+
+	struct lock_stats
+	{
+		std::string name;
+		u64 count = 0;
+		u64 total_ns = 0;
+		u64 max_ns = 0;
+		std::vector<std::string> contenders; // Names of the threads which had to wait (limited)
+	};
+
+	// Nanoseconds on the profiler clock
+	u64 now();
+
+	// Give a readable name to a host lock, unnamed ones are reported by address
+	void set_name(const void* lock, const char* name);
+	void remove_name(const void* lock);
+
+	// Record a wait on a host lock
+	void record(const void* lock, u64 ns);
+
+	// Record a wait on a guest object (type is e.g. "sys_mutex", name is the 8-byte lv2 name)
+	void record_object(const char* type, u32 id, u64 name, u64 ns);
+
+	// Sorted by the total wait time, longest first
+	std::vector<lock_stats> get_stats();
+
+	void start();
+
+	// Stops recording and prints the statistics to the log
+	void stop();
+
+	class wait_timer
+	{
+		const void* m_lock;
+		u64 m_start = 0;
+
+	public:
+		wait_timer(const void* lock)
+			: m_lock(lock)
+		{
+			if (UNLIKELY(g_enabled))
+			{
+				m_start = now();
+			}
+		}
+
+		wait_timer(const wait_timer&) = delete;
+
+		~wait_timer()
+		{
+			if (UNLIKELY(m_start))
+			{
+				record(m_lock, now() - m_start);
+			}
+		}
+	};
+}
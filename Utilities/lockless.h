@@ -2,6 +2,8 @@
 
 #include "types.h"
 #include "Atomic.h"
+#include "mutex.h"
+#include <new>
 
 //! Simple sizeless array base for concurrent access. Cannot shrink, only growths automatically.
 //! There is no way to know the current size. The smaller index is, the faster it's accessed.
@@ -146,6 +148,268 @@ public:
 	}
 };
 
+//! Bounded multi-producer single-consumer ring. N must be a power of 2, the capacity can be limited further per push.
+//! Producers never block each other for long, the consumer shall be serialized externally.
+template <typename T, u32 N>
+class lf_mpsc_ring
+{
+	static_assert(N && (N & (N - 1)) == 0, "lf_mpsc_ring<> error: N must be a power of 2");
+
+	struct slot_t
+	{
+		atomic_t<u32> seq; // Position + 1 when the data is ready, position + N when it's free again
+		T data;
+	};
+
+	slot_t m_slots[N];
+
+	// Elements stored or being stored, checked against the limit
+	atomic_t<u32> m_count{0};
+
+	atomic_t<u32> m_push{0};
+	u32 m_pop = 0;
+
+public:
+	lf_mpsc_ring()
+	{
+		for (u32 i = 0; i < N; i++)
+		{
+			m_slots[i].seq.raw() = i;
+		}
+	}
+
+	lf_mpsc_ring(const lf_mpsc_ring&) = delete;
+
+	lf_mpsc_ring& operator=(const lf_mpsc_ring&) = delete;
+
+	// Number of elements, including the ones still being pushed
+	u32 size() const
+	{
+		return m_count;
+	}
+
+	bool empty() const
+	{
+		return !m_count;
+	}
+
+	// Fail if there are limit elements already
+	bool try_push(const T& value, u32 limit = N)
+	{
+		if (!m_count.try_inc(limit < N ? limit : N))
+		{
+			return false;
+		}
+
+		const u32 pos = m_push++;
+		auto& slot = m_slots[pos % N];
+
+		// The count guarantees the slot is free, the consumer may be releasing it yet
+		while (slot.seq != pos)
+		{
+			busy_wait(100);
+		}
+
+		slot.data = value;
+		slot.seq = pos + 1;
+		return true;
+	}
+
+	// Consumer only, fail if the next element is absent or not complete yet
+	bool try_pop(T& value)
+	{
+		auto& slot = m_slots[m_pop % N];
+
+		if (slot.seq != m_pop + 1)
+		{
+			return false;
+		}
+
+		value = slot.data;
+		slot.seq = m_pop + N;
+		m_pop++;
+		m_count--;
+		return true;
+	}
+};
+
+template <typename T>
+class lf_queue_item;
+
+// Node allocator for lf_queue_item<T>: freed nodes are cached per thread, surplus is handed to other threads in batches
+template <typename T>
+class lf_queue_pool
+{
+	// Overlay on the storage of a free node
+	struct free_node
+	{
+		free_node* next;
+
+		// Only valid in the first node of a batch in the shared list
+		free_node* next_batch;
+	};
+
+	// Nodes moved at once between a thread and the shared list
+	static constexpr u32 c_batch = 64;
+
+	// Batches retained in the shared list, while the rest is returned to the heap
+	static constexpr u32 c_max_batches = 64;
+
+	struct shared_list
+	{
+		shared_mutex mutex;
+
+		// Written under the mutex, may be peeked without it
+		atomic_t<free_node*> batches{nullptr};
+
+		u32 count = 0;
+	};
+
+	// Trivially destructible, so it stays usable after thread_local destructors ran
+	struct local_list
+	{
+		free_node* head;
+		u32 count;
+		bool dead;
+	};
+
+	// Returns the thread cache to the heap on thread exit
+	struct local_guard
+	{
+		~local_guard()
+		{
+			local_list& list = lf_queue_pool::local();
+
+			while (free_node* node = list.head)
+			{
+				list.head = node->next;
+				heap_free(node);
+			}
+
+			list.count = 0;
+			list.dead = true;
+		}
+	};
+
+	static shared_list& shared()
+	{
+		static shared_list s_list;
+		return s_list;
+	}
+
+	static local_list& local()
+	{
+		static thread_local local_list s_local{};
+		return s_local;
+	}
+
+	// Register thread exit cleanup before the thread keeps any node
+	static void attach()
+	{
+		static thread_local local_guard s_guard;
+	}
+
+	static void* heap_alloc()
+	{
+		return ::operator new(sizeof(lf_queue_item<T>), std::align_val_t{alignof(lf_queue_item<T>)});
+	}
+
+	static void heap_free(void* ptr)
+	{
+		::operator delete(ptr, std::align_val_t{alignof(lf_queue_item<T>)});
+	}
+
+public:
+	static void* allocate()
+	{
+		static_assert(sizeof(lf_queue_item<T>) >= sizeof(free_node));
+
+		local_list& list = local();
+
+		// Producer-only threads don't take the lock while no batch is available
+		if (shared_list& s = shared(); !list.head && !list.dead && s.batches.load())
+		{
+			// Take a batch freed by other threads (typically the consumer)
+			std::lock_guard lock(s.mutex);
+
+			if (free_node* batch = s.batches.load())
+			{
+				s.batches.store(batch->next_batch);
+				s.count--;
+				list.head = batch;
+				list.count = c_batch;
+				attach();
+			}
+		}
+
+		if (free_node* node = list.head)
+		{
+			list.head = node->next;
+			list.count--;
+			return node;
+		}
+
+		return heap_alloc();
+	}
+
+	static void deallocate(void* ptr)
+	{
+		local_list& list = local();
+
+		if (list.dead)
+		{
+			heap_free(ptr);
+			return;
+		}
+
+		if (!list.head)
+		{
+			attach();
+		}
+
+		const auto node = static_cast<free_node*>(ptr);
+		node->next = list.head;
+		list.head = node;
+
+		if (++list.count < c_batch * 2)
+		{
+			return;
+		}
+
+		// Detach the newest batch and give it away
+		free_node* first = list.head;
+		free_node* last = first;
+
+		for (u32 i = 1; i < c_batch; i++)
+		{
+			last = last->next;
+		}
+
+		list.head = last->next;
+		list.count -= c_batch;
+		last->next = nullptr;
+
+		shared_list& s = shared();
+
+		{
+			std::lock_guard lock(s.mutex);
+
+			if (s.count < c_max_batches)
+			{
+				first->next_batch = s.batches.load();
+				s.batches.store(first);
+				s.count++;
+				return;
+			}
+		}
+
+		while (first)
+		{
+			heap_free(std::exchange(first, first->next));
+		}
+	}
+};
+
 // Helper type, linked list element
 template <typename T>
 class lf_queue_item final
@@ -177,6 +441,16 @@ public:
 
 	lf_queue_item& operator=(const lf_queue_item&) = delete;
 
+	static void* operator new(std::size_t)
+	{
+		return lf_queue_pool<T>::allocate();
+	}
+
+	static void operator delete(void* ptr)
+	{
+		lf_queue_pool<T>::deallocate(ptr);
+	}
+
 	~lf_queue_item()
 	{
 		for (lf_queue_item* ptr = m_link; ptr;)
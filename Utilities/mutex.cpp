@@ -1,5 +1,6 @@
 #include "mutex.h"
 #include "sync.h"
+#include "lock_profiler.h"
 
 #include <climits>
 
@@ -7,14 +8,11 @@ void shared_mutex::imp_lock_shared(u32 val)
 {
 	verify("shared_mutex underflow" HERE), val < c_err;
 
-	for (int i = 0; i < 10; i++)
-	{
-		busy_wait();
+	lock_profiler::wait_timer timer(this);
 
-		if (try_lock_shared())
-		{
-			return;
-		}
+	if (spin_budget::spin(this, [&] { return try_lock_shared(); }))
+	{
+		return;
 	}
 
 	// Acquire writer lock and downgrade
@@ -68,14 +66,11 @@ void shared_mutex::imp_lock(u32 val)
 {
 	verify("shared_mutex underflow" HERE), val < c_err;
 
-	for (int i = 0; i < 10; i++)
-	{
-		busy_wait();
+	lock_profiler::wait_timer timer(this);
 
-		if (!m_value && try_lock())
-		{
-			return;
-		}
+	if (spin_budget::spin(this, [&] { return !m_value && try_lock(); }))
+	{
+		return;
 	}
 
 	const u32 old = m_value.fetch_add(c_one);
@@ -103,14 +98,11 @@ void shared_mutex::imp_unlock(u32 old)
 
 void shared_mutex::imp_lock_upgrade()
 {
-	for (int i = 0; i < 10; i++)
-	{
-		busy_wait();
+	lock_profiler::wait_timer timer(this);
 
-		if (try_lock_upgrade())
-		{
-			return;
-		}
+	if (spin_budget::spin(this, [&] { return try_lock_upgrade(); }))
+	{
+		return;
 	}
 
 	// Convert to writer lock
@@ -22,6 +22,7 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
 #include <unordered_map>
 
 #ifdef _WIN32
@@ -306,3 +307,57 @@ void balanced_awaken(atomic_t<T>& var, u32 weight)
 	return;
 #endif
 }
+
+// Adaptive spinning before parking, calibrated per lock address by recent outcomes
+namespace spin_budget
+{
+	// Length of one spin round in TSC cycles
+	constexpr u32 c_round = 500;
+
+	// Round limits: the budget starts at c_default, grows toward twice the rounds a successful spin needed and halves when spinning fails
+	constexpr u32 c_min = 1;
+	constexpr u32 c_default = 60;
+	constexpr u32 c_max = 240;
+
+	// Budget slots shared by addresses with the same hash (0 = not calibrated yet)
+	inline atomic_t<u8> g_slots[512]{};
+
+	inline atomic_t<u8>& slot(const void* addr)
+	{
+		const std::uintptr_t x = reinterpret_cast<std::uintptr_t>(addr);
+		return g_slots[((x >> 3) ^ (x >> 12)) % std::size(g_slots)];
+	}
+
+	// Spin until try_acquire() succeeds or the budget is exhausted, returns false if the caller should park
+	template <typename F>
+	bool spin(const void* addr, F&& try_acquire)
+	{
+		// Spinning can't help if only one hardware thread is available
+		static const bool s_single_core = std::thread::hardware_concurrency() <= 1;
+
+		if (s_single_core)
+		{
+			return try_acquire();
+		}
+
+		auto& budget = slot(addr);
+		const u32 _old = budget.load();
+		const u32 limit = _old ? _old : c_default;
+
+		for (u32 i = 0; i < limit; i++)
+		{
+			busy_wait(c_round);
+
+			if (try_acquire())
+			{
+				// Rounded up, so that a budget halved down to c_min can grow back
+				budget.store(static_cast<u8>(std::clamp<u32>((limit + (i + 1) * 2 + 1) / 2, c_min, c_max)));
+				return true;
+			}
+		}
+
+		// Probably a long hold time or an oversubscribed host
+		budget.store(static_cast<u8>(std::max<u32>(limit / 2, c_min)));
+		return false;
+	}
+}
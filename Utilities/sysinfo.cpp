@@ -38,6 +38,18 @@ bool utils::has_avx2()
 	return g_value;
 }
 
+bool utils::has_aesni()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x2000000;
+	return g_value;
+}
+
+bool utils::has_sha()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x7 && get_cpuid(7, 0)[1] & 0x20000000 && has_sse41();
+	return g_value;
+}
+
 bool utils::has_rtm()
 {
 	static const bool g_value = get_cpuid(0, 0)[0] >= 0x7 && (get_cpuid(7, 0)[1] & 0x800) == 0x800;
@@ -63,12 +75,25 @@ bool utils::has_512()
 	return g_value;
 }
 
+bool utils::has_avx512_vbmi()
+{
+	// Check AVX512_VBMI extension (Cannon Lake level support), implies VPERMI2B/VPERMB
+	static const bool g_value = has_512() && get_cpuid(7, 0)[2] & 0x2;
+	return g_value;
+}
+
 bool utils::has_xop()
 {
 	static const bool g_value = has_avx() && get_cpuid(0x80000001, 0)[2] & 0x800;
 	return g_value;
 }
 
+bool utils::has_invariant_tsc()
+{
+	static const bool g_value = get_cpuid(0x80000000, 0)[0] >= 0x80000007 && get_cpuid(0x80000007, 0)[3] & 0x100;
+	return g_value;
+}
+
 std::string utils::get_system_info()
 {
 	std::string result;
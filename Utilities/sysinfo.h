@@ -35,6 +35,10 @@ namespace utils
 
 	bool has_avx2();
 
+	bool has_aesni();
+
+	bool has_sha();
+
 	bool has_rtm();
 
 	bool has_tsx_force_abort();
@@ -43,8 +47,12 @@ namespace utils
 
 	bool has_512();
 
+	bool has_avx512_vbmi();
+
 	bool has_xop();
 
+	bool has_invariant_tsc();
+
 	std::string get_system_info();
 
 	std::string get_firmware_version();
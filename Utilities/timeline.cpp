@@ -0,0 +1,200 @@
+﻿#include "timeline.h"
+#include "File.h"
+#include "StrFmt.h"
+#include "Thread.h"
+#include "mutex.h"
+#include "Log.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace timeline
+{
+	atomic_t<bool> g_enabled{false};
+
+	namespace
+	{
+		struct event
+		{
+			const char* category;
+			const char* name;
+			u64 start;
+			u64 end; // Zero for counters
+			u64 value;
+		};
+
+		// Events past this are dropped, a runaway thread should not exhaust memory
+		constexpr size_t max_events_per_thread = 4 * 1024 * 1024;
+
+		struct thread_buffer
+		{
+			shared_mutex mutex;
+			u32 session;
+			u32 tid;
+			std::string name;
+			std::vector<event> events;
+			u64 dropped = 0;
+		};
+
+		struct trace_state
+		{
+			shared_mutex mutex;
+			std::vector<std::shared_ptr<thread_buffer>> buffers;
+			u32 session = 0;
+			u64 start_time = 0;
+		};
+
+		trace_state& get_state()
+		{
+			static trace_state s_state;
+			return s_state;
+		}
+
+		thread_local std::shared_ptr<thread_buffer> g_tls_buffer;
+
+		thread_buffer& get_thread_buffer()
+		{
+			auto& state = get_state();
+
+			if (!g_tls_buffer || g_tls_buffer->session != state.session)
+			{
+				auto buffer = std::make_shared<thread_buffer>();
+				buffer->name = thread_ctrl::get_current() ? std::string(thread_ctrl::get_name()) : "Main";
+
+				std::lock_guard lock(state.mutex);
+				buffer->session = state.session;
+				buffer->tid = ::size32(state.buffers) + 1;
+				state.buffers.push_back(buffer);
+				g_tls_buffer = std::move(buffer);
+			}
+
+			return *g_tls_buffer;
+		}
+
+		void push_event(const event& e)
+		{
+			auto& buffer = get_thread_buffer();
+			std::lock_guard lock(buffer.mutex);
+
+			if (buffer.events.size() < max_events_per_thread)
+			{
+				buffer.events.push_back(e);
+			}
+			else
+			{
+				buffer.dropped++;
+			}
+		}
+
+		std::string escape(const std::string& str)
+		{
+			std::string result;
+			result.reserve(str.size());
+
+			for (const char c : str)
+			{
+				if (c == '"' || c == '\\')
+					result += '\\';
+
+				result += c;
+			}
+
+			return result;
+		}
+	}
+
+	u64 now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void record_event(const char* category, const char* name, u64 start, u64 end, u64 arg)
+	{
+		push_event({ category, name, start, std::max(end, start + 1), arg });
+	}
+
+	void record_counter(const char* category, const char* name, s64 value)
+	{
+		push_event({ category, name, now(), 0, static_cast<u64>(value) });
+	}
+
+	void start()
+	{
+		auto& state = get_state();
+
+		{
+			std::lock_guard lock(state.mutex);
+			state.buffers.clear();
+			state.session++;
+			state.start_time = now();
+		}
+
+		g_enabled = true;
+		LOG_NOTICE(GENERAL, "Timeline trace started");
+	}
+
+	bool stop(const std::string& path)
+	{
+		if (!g_enabled.exchange(false))
+		{
+			return false;
+		}
+
+		auto& state = get_state();
+		std::lock_guard lock(state.mutex);
+
+		fs::file out(path, fs::rewrite);
+		if (!out)
+		{
+			LOG_ERROR(GENERAL, "Failed to create the timeline trace %s", path);
+			return false;
+		}
+
+		std::string text = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		u64 num_events = 0;
+		u64 num_dropped = 0;
+
+		for (const auto& buffer : state.buffers)
+		{
+			std::lock_guard buffer_lock(buffer->mutex);
+
+			text += fmt::format("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->tid, escape(buffer->name));
+			first = false;
+
+			for (const auto& e : buffer->events)
+			{
+				const u64 start = e.start - std::min(e.start, state.start_time);
+
+				if (e.end)
+				{
+					text += fmt::format(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":\"0x%llx\"}}",
+						e.name, e.category, buffer->tid, start / 1000., (e.end - e.start) / 1000., e.value);
+				}
+				else
+				{
+					text += fmt::format(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+						e.name, e.category, buffer->tid, start / 1000., static_cast<s64>(e.value));
+				}
+
+				// Flush in chunks, traces of long sessions get large
+				if (text.size() > 0x100000)
+				{
+					out.write(text);
+					text.clear();
+				}
+			}
+
+			num_events += buffer->events.size();
+			num_dropped += buffer->dropped;
+		}
+
+		text += "\n]}\n";
+		out.write(text);
+
+		LOG_SUCCESS(GENERAL, "Timeline trace written to %s: %llu events from %u threads (%llu dropped)", path, num_events, state.buffers.size(), num_dropped);
+		state.buffers.clear();
+		return true;
+	}
+}
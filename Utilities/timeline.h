@@ -0,0 +1,63 @@
+#pragma once
+
+#include "types.h"
+#include "Atomic.h"
+
+#include <string>
+
+// Timeline of scoped events and counters across emulator threads, written out in the Chrome trace event format
+namespace timeline
+{
+	// Set while a trace is recorded, every entry point tests it first so that disabled tracing costs a single load
+	extern atomic_t<bool> g_enabled;
+
+	// Nanoseconds on the trace clock
+	u64 now();
+
+	void record_event(const char* category, const char* name, u64 start, u64 end, u64 arg);
+	void record_counter(const char* category, const char* name, s64 value);
+
+	// Starts recording, events are buffered per thread until stop()
+	void start();
+
+	// Stops recording and writes the trace, it can be opened with chrome://tracing or the Perfetto UI
+	bool stop(const std::string& path);
+
+	class scoped_event
+	{
+		const char* m_category;
+		const char* m_name;
+		u64 m_arg;
+		u64 m_start = 0;
+
+	public:
+		scoped_event(const char* category, const char* name, u64 arg = 0)
+			: m_category(category)
+			, m_name(name)
+			, m_arg(arg)
+		{
+			if (UNLIKELY(g_enabled))
+			{
+				m_start = now();
+			}
+		}
+
+		scoped_event(const scoped_event&) = delete;
+
+		~scoped_event()
+		{
+			if (UNLIKELY(m_start))
+			{
+				record_event(m_category, m_name, m_start, now(), m_arg);
+			}
+		}
+	};
+
+	inline void counter(const char* category, const char* name, s64 value)
+	{
+		if (UNLIKELY(g_enabled))
+		{
+			record_counter(category, name, value);
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.h"
+
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#include <memory>
+#else
+#include <zlib.h>
+#endif
+
+namespace utils
+{
+	// Decompress zlib data of known decompressed size (trailing input is ignored), returns true if exactly dst_size bytes were produced
+	inline bool zlib_decompress(void* dst, u64 dst_size, const void* src, u64 src_size)
+	{
+#ifdef HAVE_LIBDEFLATE
+		struct deleter
+		{
+			void operator()(libdeflate_decompressor* ptr) const
+			{
+				libdeflate_free_decompressor(ptr);
+			}
+		};
+
+		// Decompressors aren't thread-safe, reuse one per thread
+		thread_local const std::unique_ptr<libdeflate_decompressor, deleter> s_decompressor{libdeflate_alloc_decompressor()};
+
+		std::size_t in_size = 0;
+		std::size_t out_size = 0;
+
+		if (!s_decompressor)
+		{
+			return false;
+		}
+
+		return libdeflate_zlib_decompress_ex(s_decompressor.get(), src, src_size, dst, dst_size, &in_size, &out_size) == LIBDEFLATE_SUCCESS && out_size == dst_size;
+#else
+		uLongf size = ::narrow<uLongf>(dst_size);
+		return uncompress(static_cast<Bytef*>(dst), &size, static_cast<const Bytef*>(src), ::narrow<uLong>(src_size)) == Z_OK && size == dst_size;
+#endif
+	}
+}
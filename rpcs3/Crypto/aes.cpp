@@ -31,6 +31,17 @@
 
 #include "aes.h"
 
+#include "Utilities/sysinfo.h"
+
+/*
+ * AES-NI kernels are selected at runtime
+ */
+#if defined(_MSC_VER) || defined(__AES__)
+#define AESNI_FUNC
+#else
+#define AESNI_FUNC __attribute__((__target__("aes")))
+#endif
+
 /*
  * 32-bit integer manipulation macros (little endian)
  */
@@ -633,9 +644,9 @@ int aes_setkey_dec( aes_context *ctx, const unsigned char *key, unsigned int key
 }
 
 /*
- * AES-ECB block encryption/decryption
+ * AES-ECB block encryption/decryption (portable)
  */
-int aes_crypt_ecb( aes_context *ctx,
+static int aes_crypt_ecb_soft( aes_context *ctx,
                     int mode,
                     const unsigned char input[16],
                     unsigned char output[16] )
@@ -727,6 +738,172 @@ int aes_crypt_ecb( aes_context *ctx,
     return( 0 );
 }
 
+/*
+ * AES-NI block encryption/decryption
+ *
+ * The round keys are used as they are: the encryption schedule has the FIPS-197
+ * byte order and the decryption schedule is the one of the equivalent inverse
+ * cipher, which is what AESDEC expects.
+ */
+AESNI_FUNC static __m128i aesni_encrypt( const aes_context *ctx, __m128i b )
+{
+    const __m128i *rk = (const __m128i *) ctx->rk;
+
+    b = _mm_xor_si128( b, _mm_loadu_si128( rk ) );
+
+    for( int i = 1; i < ctx->nr; i++ )
+        b = _mm_aesenc_si128( b, _mm_loadu_si128( rk + i ) );
+
+    return( _mm_aesenclast_si128( b, _mm_loadu_si128( rk + ctx->nr ) ) );
+}
+
+AESNI_FUNC static __m128i aesni_decrypt( const aes_context *ctx, __m128i b )
+{
+    const __m128i *rk = (const __m128i *) ctx->rk;
+
+    b = _mm_xor_si128( b, _mm_loadu_si128( rk ) );
+
+    for( int i = 1; i < ctx->nr; i++ )
+        b = _mm_aesdec_si128( b, _mm_loadu_si128( rk + i ) );
+
+    return( _mm_aesdeclast_si128( b, _mm_loadu_si128( rk + ctx->nr ) ) );
+}
+
+AESNI_FUNC static void aesni_crypt_ecb( const aes_context *ctx,
+                    int mode,
+                    const unsigned char input[16],
+                    unsigned char output[16] )
+{
+    const __m128i b = _mm_loadu_si128( (const __m128i *) input );
+
+    _mm_storeu_si128( (__m128i *) output, mode == AES_DECRYPT ? aesni_decrypt( ctx, b ) : aesni_encrypt( ctx, b ) );
+}
+
+/*
+ * AES-NI CBC decryption, four independent blocks are kept in flight
+ */
+AESNI_FUNC static void aesni_cbc_decrypt( const aes_context *ctx,
+                    size_t length,
+                    unsigned char iv[16],
+                    const unsigned char *input,
+                    unsigned char *output )
+{
+    const __m128i *rk = (const __m128i *) ctx->rk;
+    __m128i prev = _mm_loadu_si128( (const __m128i *) iv );
+
+    for( ; length >= 64; input += 64, output += 64, length -= 64 )
+    {
+        const __m128i c0 = _mm_loadu_si128( (const __m128i *) input + 0 );
+        const __m128i c1 = _mm_loadu_si128( (const __m128i *) input + 1 );
+        const __m128i c2 = _mm_loadu_si128( (const __m128i *) input + 2 );
+        const __m128i c3 = _mm_loadu_si128( (const __m128i *) input + 3 );
+
+        __m128i k = _mm_loadu_si128( rk );
+        __m128i b0 = _mm_xor_si128( c0, k );
+        __m128i b1 = _mm_xor_si128( c1, k );
+        __m128i b2 = _mm_xor_si128( c2, k );
+        __m128i b3 = _mm_xor_si128( c3, k );
+
+        for( int i = 1; i < ctx->nr; i++ )
+        {
+            k = _mm_loadu_si128( rk + i );
+            b0 = _mm_aesdec_si128( b0, k );
+            b1 = _mm_aesdec_si128( b1, k );
+            b2 = _mm_aesdec_si128( b2, k );
+            b3 = _mm_aesdec_si128( b3, k );
+        }
+
+        k = _mm_loadu_si128( rk + ctx->nr );
+        b0 = _mm_aesdeclast_si128( b0, k );
+        b1 = _mm_aesdeclast_si128( b1, k );
+        b2 = _mm_aesdeclast_si128( b2, k );
+        b3 = _mm_aesdeclast_si128( b3, k );
+
+        _mm_storeu_si128( (__m128i *) output + 0, _mm_xor_si128( b0, prev ) );
+        _mm_storeu_si128( (__m128i *) output + 1, _mm_xor_si128( b1, c0 ) );
+        _mm_storeu_si128( (__m128i *) output + 2, _mm_xor_si128( b2, c1 ) );
+        _mm_storeu_si128( (__m128i *) output + 3, _mm_xor_si128( b3, c2 ) );
+        prev = c3;
+    }
+
+    for( ; length >= 16; input += 16, output += 16, length -= 16 )
+    {
+        const __m128i c = _mm_loadu_si128( (const __m128i *) input );
+
+        _mm_storeu_si128( (__m128i *) output, _mm_xor_si128( aesni_decrypt( ctx, c ), prev ) );
+        prev = c;
+    }
+
+    _mm_storeu_si128( (__m128i *) iv, prev );
+}
+
+AESNI_FUNC static void aesni_cbc_encrypt( const aes_context *ctx,
+                    size_t length,
+                    unsigned char iv[16],
+                    const unsigned char *input,
+                    unsigned char *output )
+{
+    __m128i prev = _mm_loadu_si128( (const __m128i *) iv );
+
+    for( ; length >= 16; input += 16, output += 16, length -= 16 )
+    {
+        prev = aesni_encrypt( ctx, _mm_xor_si128( _mm_loadu_si128( (const __m128i *) input ), prev ) );
+        _mm_storeu_si128( (__m128i *) output, prev );
+    }
+
+    _mm_storeu_si128( (__m128i *) iv, prev );
+}
+
+/*
+ * Check the AES-NI path against the FIPS-197 example vector once before using it
+ */
+static bool aesni_self_test()
+{
+    static const unsigned char key[16] =
+        { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+    static const unsigned char plain[16] =
+        { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    static const unsigned char cipher[16] =
+        { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+
+    aes_context ctx;
+    unsigned char out[16];
+
+    aes_setkey_enc( &ctx, key, 128 );
+    aesni_crypt_ecb( &ctx, AES_ENCRYPT, plain, out );
+
+    if( memcmp( out, cipher, 16 ) != 0 )
+        return( false );
+
+    aes_setkey_dec( &ctx, key, 128 );
+    aesni_crypt_ecb( &ctx, AES_DECRYPT, cipher, out );
+
+    return( memcmp( out, plain, 16 ) == 0 );
+}
+
+static bool aes_use_aesni()
+{
+    static const bool s_value = utils::has_aesni() && aesni_self_test();
+    return( s_value );
+}
+
+/*
+ * AES-ECB block encryption/decryption
+ */
+int aes_crypt_ecb( aes_context *ctx,
+                    int mode,
+                    const unsigned char input[16],
+                    unsigned char output[16] )
+{
+    if( aes_use_aesni() )
+    {
+        aesni_crypt_ecb( ctx, mode, input, output );
+        return( 0 );
+    }
+
+    return( aes_crypt_ecb_soft( ctx, mode, input, output ) );
+}
+
 /*
  * AES-CBC buffer encryption/decryption
  */
@@ -743,6 +920,16 @@ int aes_crypt_cbc( aes_context *ctx,
     if( length % 16 )
         return( POLARSSL_ERR_AES_INVALID_INPUT_LENGTH );
 
+    if( aes_use_aesni() )
+    {
+        if( mode == AES_DECRYPT )
+            aesni_cbc_decrypt( ctx, length, iv, input, output );
+        else
+            aesni_cbc_encrypt( ctx, length, iv, input, output );
+
+        return( 0 );
+    }
+
     if( mode == AES_DECRYPT )
     {
         while( length > 0 )
@@ -839,6 +1026,19 @@ int aes_crypt_ctr( aes_context *ctx,
     int c, i;
     size_t n = *nc_off;
 
+    /* Whole blocks at a time while aligned to the key stream */
+    for( ; n == 0 && length >= 16; input += 16, output += 16, length -= 16 )
+    {
+        aes_crypt_ecb( ctx, AES_ENCRYPT, nonce_counter, stream_block );
+
+        for( i = 16; i > 0; i-- )
+            if( ++nonce_counter[i - 1] != 0 )
+                break;
+
+        for( i = 0; i < 16; i++ )
+            output[i] = (unsigned char)( input[i] ^ stream_block[i] );
+    }
+
     while( length-- )
     {
         if( n == 0 ) {
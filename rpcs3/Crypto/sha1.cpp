@@ -30,6 +30,19 @@
  
 #include "sha1.h"
 
+#include "Utilities/sysinfo.h"
+
+#include <utility>
+
+/*
+ * SHA-NI kernels are selected at runtime
+ */
+#if defined(_MSC_VER) || defined(__SHA__)
+#define SHANI_FUNC
+#else
+#define SHANI_FUNC __attribute__((__target__("sha,ssse3,sse4.1")))
+#endif
+
 /*
  * 32-bit integer manipulation macros (big endian)
  */
@@ -68,7 +81,100 @@ void sha1_starts( sha1_context *ctx )
     ctx->state[4] = 0xC3D2E1F0;
 }
 
+/*
+ * SHA-NI rounds 4 * G to 4 * G + 3, with the message schedule interleaved as in Intel's reference code
+ */
+template <int G>
+SHANI_FUNC static inline void sha1_shani_group( __m128i &abcd, __m128i (&e)[2], __m128i (&msg)[4], const unsigned char *data )
+{
+    __m128i &cur = msg[G % 4];
+
+    if constexpr( G < 4 )
+        cur = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( data + G * 16 ) ), _mm_set_epi64x( 0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL ) );
+
+    if constexpr( G == 0 )
+        e[0] = _mm_add_epi32( e[0], cur );
+    else
+        e[G % 2] = _mm_sha1nexte_epu32( e[G % 2], cur );
+
+    e[( G + 1 ) % 2] = abcd;
+
+    if constexpr( G >= 3 && G <= 18 )
+        msg[( G + 1 ) % 4] = _mm_sha1msg2_epu32( msg[( G + 1 ) % 4], cur );
+
+    abcd = _mm_sha1rnds4_epu32( abcd, e[G % 2], G / 5 );
+
+    if constexpr( G >= 1 && G <= 16 )
+        msg[( G + 3 ) % 4] = _mm_sha1msg1_epu32( msg[( G + 3 ) % 4], cur );
+
+    if constexpr( G >= 2 && G <= 17 )
+        msg[( G + 2 ) % 4] = _mm_xor_si128( msg[( G + 2 ) % 4], cur );
+}
+
+template <int... G>
+SHANI_FUNC static inline void sha1_shani_rounds( __m128i &abcd, __m128i (&e)[2], __m128i (&msg)[4], const unsigned char *data, std::integer_sequence<int, G...> )
+{
+    ( sha1_shani_group<G>( abcd, e, msg, data ), ... );
+}
+
+SHANI_FUNC static void sha1_process_shani( uint32_t state[5], const unsigned char data[64] )
+{
+    __m128i abcd = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i *) state ), 0x1B );
+    __m128i e[2] = { _mm_set_epi32( (int) state[4], 0, 0, 0 ), _mm_setzero_si128() };
+    __m128i msg[4];
+
+    const __m128i abcd_save = abcd;
+    const __m128i e_save = e[0];
+
+    sha1_shani_rounds( abcd, e, msg, data, std::make_integer_sequence<int, 20>{} );
+
+    e[0] = _mm_sha1nexte_epu32( e[0], e_save );
+    abcd = _mm_add_epi32( abcd, abcd_save );
+
+    _mm_storeu_si128( (__m128i *) state, _mm_shuffle_epi32( abcd, 0x1B ) );
+    state[4] = (uint32_t) _mm_extract_epi32( e[0], 3 );
+}
+
+static void sha1_process_soft( sha1_context *ctx, const unsigned char data[64] );
+
+/*
+ * Check the SHA-NI path against the portable one once before using it
+ */
+static bool sha1_shani_self_test()
+{
+    unsigned char data[64];
+    uint32_t soft[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint32_t fast[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    for( int i = 0; i < 64; i++ )
+        data[i] = (unsigned char)( i * 0x9D + 0x3B );
+
+    sha1_context ctx;
+    memcpy( ctx.state, soft, sizeof( soft ) );
+    sha1_process_soft( &ctx, data );
+    sha1_process_shani( fast, data );
+
+    return( memcmp( ctx.state, fast, sizeof( fast ) ) == 0 );
+}
+
+static bool sha1_use_shani()
+{
+    static const bool s_value = utils::has_sha() && sha1_shani_self_test();
+    return( s_value );
+}
+
 void sha1_process( sha1_context *ctx, const unsigned char data[64] )
+{
+    if( sha1_use_shani() )
+    {
+        sha1_process_shani( ctx->state, data );
+        return;
+    }
+
+    sha1_process_soft( ctx, data );
+}
+
+static void sha1_process_soft( sha1_context *ctx, const unsigned char data[64] )
 {
     uint32_t temp, W[16], A, B, C, D, E;
 
@@ -3,6 +3,10 @@
 #include "unedat.h"
 
 #include <cmath>
+#include <mutex>
+#include <thread>
+
+#include "Utilities/Thread.h"
 
 void generate_key(int crypto_mode, int version, unsigned char *key_final, unsigned char *iv_final, unsigned char *key, unsigned char *iv)
 {
@@ -940,6 +944,68 @@ bool EDATADecrypter::ReadHeader()
 	return true;
 }
 
+// Private position over the encrypted file, lets several threads decrypt blocks at once
+struct edat_locked_view final : fs::file_base
+{
+	const fs::file& m_file;
+	std::mutex& m_mutex;
+	u64 m_pos = 0;
+
+	edat_locked_view(const fs::file& file, std::mutex& mutex)
+		: m_file(file)
+		, m_mutex(mutex)
+	{
+	}
+
+	fs::stat_t stat() override
+	{
+		return m_file.stat();
+	}
+
+	bool trunc(u64 length) override
+	{
+		return false;
+	}
+
+	u64 read(void* buffer, u64 size) override
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_file.seek(m_pos);
+		const u64 result = m_file.read(buffer, size);
+		m_pos += result;
+		return result;
+	}
+
+	u64 write(const void* buffer, u64 size) override
+	{
+		return 0;
+	}
+
+	u64 seek(s64 offset, fs::seek_mode whence) override
+	{
+		const s64 new_pos =
+			whence == fs::seek_set ? offset :
+			whence == fs::seek_cur ? offset + m_pos :
+			whence == fs::seek_end ? offset + size() :
+			(fmt::raw_error("edat_locked_view::seek(): invalid whence"), 0);
+
+		if (new_pos < 0)
+		{
+			fs::g_tls_error = fs::error::inval;
+			return -1;
+		}
+
+		m_pos = new_pos;
+		return m_pos;
+	}
+
+	u64 size() override
+	{
+		return m_file.size();
+	}
+};
+
 u64 EDATADecrypter::ReadData(u64 pos, u8* data, u64 size)
 {
 	if (pos > edatHeader.file_size)
@@ -948,32 +1014,149 @@ u64 EDATADecrypter::ReadData(u64 pos, u8* data, u64 size)
 	// now we need to offset things to account for the actual 'range' requested
 	const u64 startOffset = pos % edatHeader.block_size;
 
-	const u32 num_blocks = static_cast<u32>(std::ceil((startOffset + size) / (double)edatHeader.block_size));
-	const u64 bufSize = num_blocks*edatHeader.block_size;
-	if (data_buf_size < (bufSize))
+	// find block range covering pos + size
+	const u32 starting_block = static_cast<u32>(pos / edatHeader.block_size);
+	const u32 ending_block = static_cast<u32>(std::min<u64>((pos + size + edatHeader.block_size - 1) / edatHeader.block_size, total_blocks));
+
+	if (starting_block >= ending_block)
+		return 0;
+
+	const u32 num_blocks = ending_block - starting_block;
+
+	// Blocks of the range, either owned by the cache or freshly decrypted
+	std::vector<cached_block*> blocks(num_blocks);
+	std::vector<cached_block> fresh;
+
+	for (u32 i = 0; i < num_blocks; i++)
 	{
-		data_buf.reset(new u8[bufSize]);
-		data_buf_size = bufSize;
+		for (auto& block : block_cache)
+		{
+			if (block.index == starting_block + i)
+			{
+				block.stamp = ++cache_stamp;
+				blocks[i] = &block;
+				break;
+			}
+		}
+
+		if (!blocks[i])
+		{
+			fresh.push_back({starting_block + i, 0, 0, std::make_unique<u8[]>(edatHeader.block_size)});
+		}
 	}
 
-	// find and decrypt block range covering pos + size
-	const u32 starting_block = static_cast<u32>(pos / edatHeader.block_size);
-	const u32 ending_block = std::min(starting_block + num_blocks, total_blocks);
-	u64 writeOffset = 0;
-	for (u32 i = starting_block; i < ending_block; ++i)
+	const u32 fresh_count = ::size32(fresh);
+	atomic_t<u32> failed = 0;
+
+	auto decrypt = [&](const fs::file& in, cached_block& block)
 	{
-		edata_file.seek(0);
-		u64 res = decrypt_block(&edata_file, &data_buf[writeOffset], &edatHeader, &npdHeader, dec_key.data(), i, total_blocks, edatHeader.file_size);
+		in.seek(0);
+		const s64 res = decrypt_block(&in, block.data.get(), &edatHeader, &npdHeader, dec_key.data(), block.index, total_blocks, edatHeader.file_size);
+
 		if (res == -1)
 		{
-			LOG_ERROR(LOADER, "Error Decrypting data");
-			return 0;
+			failed++;
 		}
-		writeOffset += res;
+
+		block.size = res;
+	};
+
+	if (fresh_count)
+	{
+		// The first block also initializes the AES tables before any helper thread may need them
+		decrypt(edata_file, fresh[0]);
+	}
+
+	if (fresh_count >= parallel_min)
+	{
+		std::mutex mutex;
+		atomic_t<u32> next = 1;
+
+		auto worker = [&]()
+		{
+			fs::file view;
+			view.reset(std::make_unique<edat_locked_view>(edata_file, mutex));
+
+			for (u32 j; (j = next++) < fresh_count;)
+			{
+				decrypt(view, fresh[j]);
+			}
+		};
+
+		const u32 helper_count = std::min(std::max(std::thread::hardware_concurrency(), 2u), 8u) - 1;
+
+		std::vector<std::unique_ptr<named_thread<decltype(worker)>>> helpers;
+
+		for (u32 i = 0; i < std::min(helper_count, fresh_count - 2); i++)
+		{
+			helpers.emplace_back(std::make_unique<named_thread<decltype(worker)>>("EDAT Decrypter", worker));
+		}
+
+		worker();
+		helpers.clear();
+	}
+	else
+	{
+		for (u32 j = 1; j < fresh_count; j++)
+		{
+			decrypt(edata_file, fresh[j]);
+		}
+	}
+
+	if (failed)
+	{
+		LOG_ERROR(LOADER, "Error Decrypting data");
+		return 0;
+	}
+
+	for (u32 i = 0, j = 0; i < num_blocks; i++)
+	{
+		if (!blocks[i])
+		{
+			blocks[i] = &fresh[j++];
+		}
+	}
+
+	// Copy the requested part
+	u64 bytesWrote = 0;
+	u64 skip = startOffset;
+
+	for (u32 i = 0; i < num_blocks && bytesWrote < size; i++)
+	{
+		const cached_block& block = *blocks[i];
+
+		if (skip >= block.size)
+		{
+			skip -= block.size;
+			continue;
+		}
+
+		const u64 count = std::min<u64>(block.size - skip, size - bytesWrote);
+		memcpy(data + bytesWrote, block.data.get() + skip, count);
+		bytesWrote += count;
+		skip = 0;
 	}
 
-	const u64 bytesWrote = std::min<u64>(writeOffset - startOffset, size);
+	// Keep the fresh blocks, evicting the least recently used ones
+	const u64 cache_count = std::max<u64>(cache_max / edatHeader.block_size, 1);
+
+	for (auto& block : fresh)
+	{
+		block.stamp = ++cache_stamp;
+
+		if (block_cache.size() < cache_count)
+		{
+			block_cache.emplace_back(std::move(block));
+			continue;
+		}
+
+		auto lru = std::min_element(block_cache.begin(), block_cache.end(), [](const cached_block& a, const cached_block& b)
+		{
+			return a.stamp < b.stamp;
+		});
+
+		*lru = std::move(block);
+	}
 
-	memcpy(data, &data_buf[startOffset], bytesWrote);
 	return bytesWrote;
 }
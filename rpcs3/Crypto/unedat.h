@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <array>
+#include <vector>
 
 #include "utils.h"
 
@@ -59,9 +60,21 @@ struct EDATADecrypter final : fs::file_base
 	NPD_HEADER npdHeader;
 	EDAT_HEADER edatHeader;
 
-	// Internal data buffers.
-	std::unique_ptr<u8[]> data_buf;
-	u64 data_buf_size{0};
+	// LRU cache of decrypted blocks
+	struct cached_block
+	{
+		u32 index;
+		u64 size;
+		u64 stamp;
+		std::unique_ptr<u8[]> data;
+	};
+
+	std::vector<cached_block> block_cache;
+	u64 cache_stamp{0};
+
+	// Cache size in bytes and the minimal amount of missing blocks decrypted on several threads
+	static constexpr u64 cache_max = 0x200000;
+	static constexpr u32 parallel_min = 4;
 
 	std::array<u8, 0x10> dec_key{};
 
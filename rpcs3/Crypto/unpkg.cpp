@@ -7,6 +7,261 @@
 #include "Emu/System.h"
 #include "Emu/VFS.h"
 #include "unpkg.h"
+#include "Utilities/Thread.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	// File being extracted, shared by its chunks in the pipeline
+	struct pkg_out_file
+	{
+		fs::file file;
+		std::string path;
+		bool failed = false; // Accessed by the writer only
+	};
+
+	// Chunks are read by the installer thread, decrypted by worker threads and written in order by the writer thread
+	class pkg_pipeline
+	{
+	public:
+		using decrypt_func = std::function<void(u128* data, u64 offset, u64 size, const uchar* key)>;
+
+		static constexpr u32 slot_count = 4;
+		static constexpr u64 part_size = 0x100000; // Decryption unit of a worker
+
+	private:
+		struct slot
+		{
+			std::unique_ptr<u128[]> data;
+			u64 size = 0;
+			u64 offset = 0;
+			const uchar* key = nullptr;
+			std::shared_ptr<pkg_out_file> out;
+			u32 parts = 0;
+			u32 claimed = 0;
+			u32 done = 0;
+		};
+
+		struct worker
+		{
+			pkg_pipeline* pipeline;
+
+			void operator()()
+			{
+				pipeline->decrypt_loop();
+			}
+		};
+
+		struct writer
+		{
+			pkg_pipeline* pipeline;
+
+			void operator()()
+			{
+				pipeline->write_loop();
+			}
+		};
+
+		const decrypt_func m_decrypt;
+		const u64 m_total;
+		atomic_t<double>& m_sync;
+		const bool m_can_cancel;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::array<slot, slot_count> m_slots;
+		u64 m_filled = 0;
+		u64 m_written = 0;
+		bool m_stop = false;
+		bool m_cancelled = false;
+
+		std::vector<std::unique_ptr<named_thread<worker>>> m_workers;
+		std::unique_ptr<named_thread<writer>> m_writer;
+
+		void decrypt_loop()
+		{
+			std::unique_lock lock(m_mutex);
+
+			while (true)
+			{
+				slot* job = nullptr;
+				u32 part = 0;
+
+				m_cv.wait(lock, [&]
+				{
+					if (m_stop || m_cancelled)
+					{
+						return true;
+					}
+
+					for (u64 i = m_written; i < m_filled; i++)
+					{
+						slot& s = m_slots[i % slot_count];
+
+						if (s.claimed < s.parts)
+						{
+							job = &s;
+							part = s.claimed++;
+							return true;
+						}
+					}
+
+					return false;
+				});
+
+				if (!job)
+				{
+					return;
+				}
+
+				lock.unlock();
+
+				const u64 begin = part * part_size;
+				m_decrypt(job->data.get() + begin / sizeof(u128), job->offset + begin, std::min(part_size, job->size - begin), job->key);
+
+				lock.lock();
+
+				if (++job->done == job->parts)
+				{
+					m_cv.notify_all();
+				}
+			}
+		}
+
+		void write_loop()
+		{
+			std::unique_lock lock(m_mutex);
+
+			while (true)
+			{
+				m_cv.wait(lock, [&]
+				{
+					return m_stop || m_cancelled || (m_written < m_filled && m_slots[m_written % slot_count].done == m_slots[m_written % slot_count].parts);
+				});
+
+				if (m_stop || m_cancelled)
+				{
+					return;
+				}
+
+				slot& s = m_slots[m_written % slot_count];
+
+				lock.unlock();
+
+				if (!s.out->failed && s.out->file.write(s.data.get(), s.size) != s.size)
+				{
+					LOG_ERROR(LOADER, "Failed to write file %s", s.out->path);
+					s.out->failed = true;
+				}
+
+				bool cancel = false;
+
+				if (m_sync.fetch_add((s.size + 0.0) / m_total) < 0.)
+				{
+					if (m_can_cancel)
+					{
+						cancel = true;
+					}
+					else
+					{
+						// Cannot cancel the installation
+						m_sync += 1.;
+					}
+				}
+
+				lock.lock();
+
+				// Closes the file after its last chunk
+				s.out.reset();
+				m_written++;
+				m_cancelled |= cancel;
+				m_cv.notify_all();
+			}
+		}
+
+	public:
+		pkg_pipeline(decrypt_func decrypt, u64 total, atomic_t<double>& sync, bool can_cancel, u64 buf_size)
+			: m_decrypt(std::move(decrypt))
+			, m_total(total)
+			, m_sync(sync)
+			, m_can_cancel(can_cancel)
+		{
+			for (slot& s : m_slots)
+			{
+				s.data.reset(new u128[buf_size / sizeof(u128)]);
+			}
+
+			const u32 count = std::clamp<u32>(std::thread::hardware_concurrency(), 2, 9) - 1;
+
+			for (u32 i = 0; i < count; i++)
+			{
+				m_workers.emplace_back(std::make_unique<named_thread<worker>>(fmt::format("PKG Decrypter %u", i), worker{this}));
+			}
+
+			m_writer = std::make_unique<named_thread<writer>>("PKG Writer", writer{this});
+		}
+
+		~pkg_pipeline()
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				m_stop = true;
+			}
+
+			m_cv.notify_all();
+			m_workers.clear();
+			m_writer.reset();
+		}
+
+		// Get the buffer for the next chunk, null if the installation has been cancelled
+		u128* acquire()
+		{
+			std::unique_lock lock(m_mutex);
+
+			m_cv.wait(lock, [&] { return m_cancelled || m_filled - m_written < slot_count; });
+
+			if (m_cancelled)
+			{
+				return nullptr;
+			}
+
+			return m_slots[m_filled % slot_count].data.get();
+		}
+
+		// Queue the chunk read into the acquired buffer
+		void submit(const std::shared_ptr<pkg_out_file>& out, u64 offset, u64 size, const uchar* key)
+		{
+			{
+				std::lock_guard lock(m_mutex);
+
+				slot& s = m_slots[m_filled++ % slot_count];
+				s.size = size;
+				s.offset = offset;
+				s.key = key;
+				s.out = out;
+				s.parts = static_cast<u32>((size + part_size - 1) / part_size);
+				s.claimed = 0;
+				s.done = 0;
+			}
+
+			m_cv.notify_all();
+		}
+
+		// Wait for all queued chunks to be written, false if the installation has been cancelled
+		bool finish()
+		{
+			std::unique_lock lock(m_mutex);
+
+			m_cv.wait(lock, [&] { return m_cancelled || m_written == m_filled; });
+
+			return !m_cancelled;
+		}
+	};
+}
 
 bool pkg_install(const std::string& path, atomic_t<double>& sync)
 {
@@ -219,16 +474,11 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 	// Allocate buffer with BUF_SIZE size or more if required
 	const std::unique_ptr<u128[]> buf(new u128[std::max<u64>(BUF_SIZE, sizeof(PKGEntry) * header.file_count) / sizeof(u128)]);
 
-	// Define decryption subfunction (`psp` arg selects the key for specific block)
-	auto decrypt = [&](u64 offset, u64 size, const uchar* key) -> u64
+	// Decrypt data in place, `offset` is the position of `data` in the package data (may run on several threads)
+	auto decrypt_data = [&header](u128* data, u64 offset, u64 size, const uchar* key)
 	{
-		archive_seek(header.data_offset + offset);
-
-		// Read the data and set available size
-		const u64 read = archive_read(buf.get(), size);
-
 		// Get block count
-		const u64 blocks = (read + 15) / 16;
+		const u64 blocks = (size + 15) / 16;
 
 		if (header.pkg_type == PKG_RELEASE_TYPE_DEBUG)
 		{
@@ -254,7 +504,7 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 				
 				sha1(reinterpret_cast<const u8*>(input), sizeof(input), hash.data);
 
-				buf[i] ^= hash._v128;
+				data[i] ^= hash._v128;
 			}
 		}
 
@@ -275,9 +525,20 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 
 				aes_crypt_ecb(&ctx, AES_ENCRYPT, reinterpret_cast<const u8*>(&input), reinterpret_cast<u8*>(&key));
 
-				buf[i] ^= key;
+				data[i] ^= key;
 			}
 		}
+	};
+
+	// Define decryption subfunction (`psp` arg selects the key for specific block)
+	auto decrypt = [&](u64 offset, u64 size, const uchar* key) -> u64
+	{
+		archive_seek(header.data_offset + offset);
+
+		// Read the data and set available size
+		const u64 read = archive_read(buf.get(), size);
+
+		decrypt_data(buf.get(), offset, read, key);
 
 		// Return the amount of data written in buf
 		return read;
@@ -306,6 +567,9 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 
 	std::memcpy(entries.data(), buf.get(), entries.size() * sizeof(PKGEntry));
 
+	// File contents go through the pipeline, names and folders are handled on this thread
+	auto pipeline = std::make_unique<pkg_pipeline>(decrypt_data, header.data_size, sync, was_null, BUF_SIZE);
+
 	for (const auto& entry : entries)
 	{
 		const bool is_psp = (entry.type & PKG_FILE_ENTRY_PSP) != 0;
@@ -348,35 +612,34 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 
 			if (fs::file out{path, fs::rewrite})
 			{
+				const auto file = std::make_shared<pkg_out_file>();
+				file->file = std::move(out);
+				file->path = path;
+
 				for (u64 pos = 0; pos < entry.file_size; pos += BUF_SIZE)
 				{
 					const u64 block_size = std::min<u64>(BUF_SIZE, entry.file_size - pos);
 
-					if (decrypt(entry.file_offset + pos, block_size, is_psp ? PKG_AES_KEY2 : dec_key.data()) != block_size)
+					u128* const data = pipeline->acquire();
+
+					if (!data)
 					{
-						LOG_ERROR(LOADER, "Failed to extract file %s", path);
-						break;
+						LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
+						pipeline.reset();
+						file->file.close();
+						fs::remove_all(dir, true);
+						return false;
 					}
 
-					if (out.write(buf.get(), block_size) != block_size)
+					archive_seek(header.data_offset + entry.file_offset + pos);
+
+					if (archive_read(data, block_size) != block_size)
 					{
-						LOG_ERROR(LOADER, "Failed to write file %s", path);
+						LOG_ERROR(LOADER, "Failed to extract file %s", path);
 						break;
 					}
 
-					if (sync.fetch_add((block_size + 0.0) / header.data_size) < 0.)
-					{
-						if (was_null)
-						{
-							LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
-							out.close();
-							fs::remove_all(dir, true);
-							return false;
-						}
-
-						// Cannot cancel the installation
-						sync += 1.;
-					}
+					pipeline->submit(file, entry.file_offset + pos, block_size, is_psp ? PKG_AES_KEY2 : dec_key.data());
 				}
 
 				if (did_overwrite)
@@ -424,6 +687,16 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 		}
 	}
 
+	if (!pipeline->finish())
+	{
+		LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
+		pipeline.reset();
+		fs::remove_all(dir, true);
+		return false;
+	}
+
+	pipeline.reset();
+
 	LOG_SUCCESS(LOADER, "Package successfully installed to %s", dir);
 	return true;
 }
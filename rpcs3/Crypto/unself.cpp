@@ -7,6 +7,7 @@
 #include "Emu/System.h"
 
 #include <algorithm>
+#include <thread>
 #include <zlib.h>
 
 inline u8 Read8(const fs::file& f)
@@ -1374,6 +1375,76 @@ static bool CheckDebugSelf(fs::file& s)
 	return false;
 }
 
+static std::string get_self_cache_path(const fs::file& self, const u8* klic_key)
+{
+	// Key the entry by the whole SELF image and the klicensee used to decrypt it
+	sha1_context ctx;
+	sha1_starts(&ctx);
+
+	std::vector<u8> buf(0x100000);
+	self.seek(0);
+
+	while (const u64 read = self.read(buf.data(), buf.size()))
+	{
+		sha1_update(&ctx, buf.data(), read);
+	}
+
+	if (klic_key)
+	{
+		sha1_update(&ctx, klic_key, 16);
+	}
+
+	u8 output[20];
+	sha1_finish(&ctx, output);
+
+	std::string name;
+
+	for (u32 i = 0; i < 16; i++)
+	{
+		fmt::append(name, "%02x", output[i]);
+	}
+
+	return fs::get_cache_dir() + "cache/self/" + fmt::format("%s-%x.elf", name, self.size());
+}
+
+static void save_self_cache(const std::string& path, const fs::file& elf)
+{
+	const std::string dir = path.substr(0, path.find_last_of('/'));
+
+	if (!fs::create_path(dir))
+	{
+		LOG_ERROR(LOADER, "SELF: Failed to create cache directory %s (%s)", dir, fs::g_tls_error);
+		return;
+	}
+
+	// Write to a temporary file first so that a partial entry is never picked up
+	const std::string temp = fmt::format("%s.%x.tmp", path, std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	fs::file out(temp, fs::rewrite);
+
+	if (!out)
+	{
+		LOG_ERROR(LOADER, "SELF: Failed to create cache file %s (%s)", temp, fs::g_tls_error);
+		return;
+	}
+
+	const auto data = elf.to_vector<u8>();
+
+	if (out.write(data.data(), data.size()) != data.size())
+	{
+		out.close();
+		fs::remove_file(temp);
+		return;
+	}
+
+	out.close();
+
+	if (!fs::rename(temp, path, true))
+	{
+		fs::remove_file(temp);
+	}
+}
+
 extern fs::file decrypt_self(fs::file elf_or_self, u8* klic_key)
 {
 	if (!elf_or_self)
@@ -1386,6 +1457,17 @@ extern fs::file decrypt_self(fs::file elf_or_self, u8* klic_key)
 	// Check SELF header first. Check for a debug SELF.
 	if (elf_or_self.size() >= 4 && elf_or_self.read<u32>() == "SCE\0"_u32 && !CheckDebugSelf(elf_or_self))
 	{
+		const std::string cache_path = g_cfg.core.self_cache ? get_self_cache_path(elf_or_self, klic_key) : std::string{};
+
+		if (!cache_path.empty())
+		{
+			if (fs::file cached{cache_path})
+			{
+				LOG_NOTICE(LOADER, "SELF: Loaded decrypted file from cache (%s)", cache_path);
+				return cached;
+			}
+		}
+
 		// Check the ELF file class (32 or 64 bit).
 		bool isElf32 = IsSelfElf32(elf_or_self);
 
@@ -1414,7 +1496,15 @@ extern fs::file decrypt_self(fs::file elf_or_self, u8* klic_key)
 		}
 
 		// Make a new ELF file from this SELF.
-		return self_dec.MakeElf(isElf32);
+		fs::file elf = self_dec.MakeElf(isElf32);
+
+		if (!cache_path.empty() && elf)
+		{
+			save_self_cache(cache_path, elf);
+			elf.seek(0);
+		}
+
+		return elf;
 	}
 
 	return elf_or_self;
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "key_vault.h"
-#include "zlib.h"
+#include "Utilities/zlib_util.h"
 
 struct AppInfo 
 {
@@ -445,23 +445,10 @@ private:
 					// Create a pointer to a buffer for decompression.
 					std::unique_ptr<u8[]> decomp_buf(new u8[filesz]);
 
-					// Create a buffer separate from data_buf to uncompress.
-					std::unique_ptr<u8[]> zlib_buf(new u8[data_buf_length]);
-					memcpy(zlib_buf.get(), data_buf.get(), data_buf_length);
-
-					uLongf decomp_buf_length = ::narrow<uLongf>(filesz);
-
-					// Use zlib uncompress on the new buffer.
-					// decomp_buf_length changes inside the call to uncompress
-					int rv = uncompress(decomp_buf.get(), &decomp_buf_length, zlib_buf.get() + data_buf_offset, data_buf_length);
-
-					// Check for errors (TODO: Probably safe to remove this once these changes have passed testing.)
-					switch (rv)
+					// Decompress straight from data_buf, the source is never modified
+					if (!utils::zlib_decompress(decomp_buf.get(), filesz, data_buf.get() + data_buf_offset, data_buf_length - data_buf_offset))
 					{
-					case Z_MEM_ERROR: LOG_ERROR(LOADER, "MakeELF encountered a Z_MEM_ERROR!"); break;
-					case Z_BUF_ERROR: LOG_ERROR(LOADER, "MakeELF encountered a Z_BUF_ERROR!"); break;
-					case Z_DATA_ERROR: LOG_ERROR(LOADER, "MakeELF encountered a Z_DATA_ERROR!"); break;
-					default: break;
+						LOG_ERROR(LOADER, "MakeELF failed to decompress section %u!", i);
 					}
 
 					// Seek to the program header data offset and write the data.
@@ -161,4 +161,16 @@ bool ALSABackend::AddData(const void* src, u32 num_samples)
 	return true;
 }
 
+u64 ALSABackend::GetLatency()
+{
+	snd_pcm_sframes_t frames = 0;
+
+	if (!tls_handle || snd_pcm_delay(tls_handle, &frames) < 0 || frames < 0)
+	{
+		return 0;
+	}
+
+	return static_cast<u64>(frames) * 1'000'000 / get_sampling_rate();
+}
+
 #endif
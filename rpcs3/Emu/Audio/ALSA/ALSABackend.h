@@ -18,13 +18,15 @@ public:
 
 	virtual const char* GetName() const override { return "ALSA"; }
 
-	static const u32 capabilities = 0;
+	static const u32 capabilities = GET_LATENCY;
 	virtual u32 GetCapabilities() const override { return capabilities; }
 
 	virtual void Open(u32) override;
 	virtual void Close() override;
 	
 	virtual bool AddData(const void* src, u32 num_samples) override;
+
+	virtual u64 GetLatency() override;
 };
 
 #endif
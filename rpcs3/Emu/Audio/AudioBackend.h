@@ -19,6 +19,7 @@ public:
 		IS_PLAYING = 0x2, // Implements IsPlaying
 		GET_NUM_ENQUEUED_SAMPLES = 0x4, // Implements GetNumEnqueuedSamples
 		SET_FREQUENCY_RATIO = 0x8, // Implements SetFrequencyRatio
+		GET_LATENCY = 0x10, // Implements GetLatency
 	};
 
 	virtual ~AudioBackend() = default;
@@ -85,6 +86,14 @@ public:
 		return 1.0f;
 	}
 
+	// Returns the time (usecs) until the last sample passed to AddData is heard, as reported by the device
+	// Should be implemented if capabilities & GET_LATENCY
+	virtual u64 GetLatency()
+	{
+		fmt::throw_exception("GetLatency() not implemented");
+		return 0;
+	}
+
 
 	/*
 	 * Helper methods
@@ -145,6 +154,12 @@ public:
 			count++;
 		}
 
+		if (capabilities & GET_LATENCY)
+		{
+			fmt::append(out, "%sGET_LATENCY", count > 0 ? " | " : "");
+			count++;
+		}
+
 		if (count == 0)
 		{
 			fmt::append(out, "NONE");
@@ -71,4 +71,22 @@ bool PulseBackend::AddData(const void* src, u32 num_samples)
 	return true;
 }
 
+u64 PulseBackend::GetLatency()
+{
+	if (!this->connection)
+	{
+		return 0;
+	}
+
+	int err;
+	const pa_usec_t latency = pa_simple_get_latency(this->connection, &err);
+
+	if (latency == static_cast<pa_usec_t>(-1))
+	{
+		return 0;
+	}
+
+	return latency;
+}
+
 #endif
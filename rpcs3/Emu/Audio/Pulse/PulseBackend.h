@@ -12,7 +12,7 @@ public:
 
 	virtual const char* GetName() const override { return "Pulse"; }
 
-	static const u32 capabilities = 0;
+	static const u32 capabilities = GET_LATENCY;
 	virtual u32 GetCapabilities() const override { return capabilities; }
 
 	virtual void Open(u32) override;
@@ -20,6 +20,8 @@ public:
 
 	virtual bool AddData(const void* src, u32 num_samples) override;
 
+	virtual u64 GetLatency() override;
+
 private:
 	pa_simple *connection = nullptr;
 };
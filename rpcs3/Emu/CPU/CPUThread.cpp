@@ -9,6 +9,8 @@
 
 DECLARE(cpu_thread::g_threads_created){0};
 DECLARE(cpu_thread::g_threads_deleted){0};
+DECLARE(cpu_thread::g_suspend_count){0};
+DECLARE(cpu_thread::g_suspend_time){0};
 
 template <>
 void fmt_class_string<cpu_flag>::format(std::string& out, u64 arg)
@@ -84,9 +86,12 @@ void cpu_thread::operator()()
 {
 	g_tls_current_cpu_thread = this;
 
-	if (g_cfg.core.thread_scheduler_enabled)
+	if (g_cfg.core.thread_scheduler_enabled || g_cfg.core.numa_node >= 0 || !g_cfg.core.thread_placement.get().empty())
 	{
-		thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(id_type() == 1 ? thread_class::ppu : thread_class::spu));
+		// The main PPU thread is created first
+		const thread_class group = id_type() != 1 ? thread_class::spu : id == ppu_thread::id_base ? thread_class::ppu_main : thread_class::ppu;
+
+		thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(group));
 	}
 
 	if (g_cfg.core.lower_spu_priority && id_type() == 2)
@@ -337,6 +342,7 @@ std::string cpu_thread::dump() const
 cpu_thread::suspend_all::suspend_all(cpu_thread* _this) noexcept
 	: m_lock(g_cpu_array_lock.try_shared_lock())
 	, m_this(_this)
+	, m_start(get_system_time())
 {
 	// TODO
 	if (!m_lock)
@@ -415,6 +421,9 @@ cpu_thread::suspend_all::~suspend_all()
 		}
 	}
 
+	g_suspend_count++;
+	g_suspend_time += get_system_time() - m_start;
+
 	if (m_this)
 	{
 		m_this->check_state();
@@ -85,6 +85,9 @@ public:
 	// Thread stats for external observation
 	static atomic_t<u64> g_threads_created, g_threads_deleted;
 
+	// suspend_all stats: number of calls and total time in microseconds
+	static atomic_t<u64> g_suspend_count, g_suspend_time;
+
 	// Get thread name
 	virtual std::string get_name() const = 0;
 
@@ -110,8 +113,12 @@ public:
 
 		cpu_thread* m_this;
 
+		u64 m_start;
+
 	public:
+		// Suspend all CPU threads
 		suspend_all(cpu_thread* _this) noexcept;
+
 		suspend_all(const suspend_all&) = delete;
 		suspend_all& operator=(const suspend_all&) = delete;
 		~suspend_all();
@@ -34,6 +34,13 @@ void cpu_translator::initialize(llvm::LLVMContext& context, llvm::ExecutionEngin
 	{
 		m_use_ssse3 = false;
 	}
+
+	// Test AVX-512 VBMI feature (TODO)
+	m_use_vbmi = cpu == "cannonlake" ||
+		cpu == "icelake" ||
+		cpu == "icelake-client" ||
+		cpu == "icelake-server" ||
+		cpu == "tigerlake";
 }
 
 llvm::Value* cpu_translator::bitcast(llvm::Value* val, llvm::Type* type)
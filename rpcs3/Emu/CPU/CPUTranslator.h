@@ -2399,6 +2399,9 @@ protected:
 	// Allow PSHUFB intrinsic
 	bool m_use_ssse3;
 
+	// Allow VPERMI2B intrinsic
+	bool m_use_vbmi;
+
 	// IR builder
 	llvm::IRBuilder<>* m_ir;
 
@@ -2774,6 +2777,15 @@ public:
 		return result;
 	}
 
+	// Select bytes from two tables: index bit 4 chooses b over a, upper bits are ignored (requires m_use_vbmi)
+	template <typename T1, typename T2, typename T3>
+	value_t<u8[16]> vpermi2b(T1 a, T2 index, T3 b)
+	{
+		value_t<u8[16]> result;
+		result.value = m_ir->CreateCall(get_intrinsic(llvm::Intrinsic::x86_avx512_vpermi2var_qi_128), {a.eval(m_ir), index.eval(m_ir), b.eval(m_ir)});
+		return result;
+	}
+
 	llvm::Value* load_const(llvm::GlobalVariable* g, llvm::Value* i)
 	{
 		return m_ir->CreateLoad(m_ir->CreateGEP(g, {m_ir->getInt64(0), m_ir->CreateZExtOrTrunc(i, get_type<u64>())}));
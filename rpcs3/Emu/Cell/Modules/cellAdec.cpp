@@ -291,7 +291,22 @@ public:
 					just_started = false;
 				}
 
-				bool last_frame = false;
+				struct AdecFrameHolder : AdecFrame
+				{
+					AdecFrameHolder()
+					{
+						data = av_frame_alloc();
+					}
+
+					~AdecFrameHolder()
+					{
+						if (data)
+						{
+							av_frame_unref(data);
+							av_frame_free(&data);
+						}
+					}
+				};
 
 				while (true)
 				{
@@ -301,53 +316,46 @@ public:
 						break;
 					}
 
-					last_frame = av_read_frame(fmt, &au) < 0;
-					if (last_frame)
+					if (av_read_frame(fmt, &au) < 0)
 					{
-						//break;
-						av_free(au.data);
-						au.data = NULL;
-						au.size = 0;
+						// AU fully consumed
+						break;
 					}
 
-					struct AdecFrameHolder : AdecFrame
+					// The decoder keeps its own reference to the packet data
+					const int sent = avcodec_send_packet(ctx, &au);
+					av_packet_unref(&au);
+
+					if (sent < 0)
 					{
-						AdecFrameHolder()
-						{
-							data = av_frame_alloc();
-						}
+						cellAdec.error("adecDecodeAu: AU decoding error(0x%x)", sent);
+						if (reader.size == 0) break;
+						continue;
+					}
+
+					// Receive every frame decoded from the packet
+					while (!is_closed)
+					{
+						AdecFrameHolder frame;
 
-						~AdecFrameHolder()
+						if (!frame.data)
 						{
-							if (data)
-							{
-								av_frame_unref(data);
-								av_frame_free(&data);
-							}
+							fmt::throw_exception("av_frame_alloc() failed" HERE);
 						}
 
-					} frame;
-
-					if (!frame.data)
-					{
-						fmt::throw_exception("av_frame_alloc() failed" HERE);
-					}
-
-					int got_frame = 0;
+						const int received = avcodec_receive_frame(ctx, frame.data);
 
-					int decode = avcodec_decode_audio4(ctx, frame.data, &got_frame, &au);
+						if (received == AVERROR(EAGAIN) || received == AVERROR_EOF)
+						{
+							break;
+						}
 
-					if (decode <= 0)
-					{
-						if (decode < 0)
+						if (received < 0)
 						{
-							cellAdec.error("adecDecodeAu: AU decoding error(0x%x)", decode);
+							cellAdec.error("adecDecodeAu: AU decoding error(0x%x)", received);
+							break;
 						}
-						if (!got_frame && reader.size == 0) break;
-					}
 
-					if (got_frame)
-					{
 						//u64 ts = av_frame_get_best_effort_timestamp(frame.data);
 						//if (ts != AV_NOPTS_VALUE)
 						//{
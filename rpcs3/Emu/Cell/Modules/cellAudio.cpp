@@ -2,6 +2,7 @@
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
 #include "Emu/Cell/PPUModule.h"
+#include "Utilities/timeline.h"
 
 #include "Emu/Cell/lv2/sys_event.h"
 #include "cellAudio.h"
@@ -276,6 +277,16 @@ u64 audio_ringbuffer::update()
 				}
 			}
 		}
+
+		// Count the times the buffer drops below a single block
+		const bool low = playing && enqueued_samples < AUDIO_BUFFER_SAMPLES;
+
+		if (low && !near_underrun)
+		{
+			near_underruns++;
+		}
+
+		near_underrun = low;
 	}
 
 	// Update playing state
@@ -285,6 +296,7 @@ u64 audio_ringbuffer::update()
 		{
 			cellAudio.warning("Audio backend stopped unexpectedly, likely due to a buffer underrun");
 
+			underruns++;
 			flush();
 			playing = false;
 		}
@@ -468,9 +480,44 @@ void cell_audio_thread::advance(u64 timestamp, bool reset)
 	}
 }
 
+void cell_audio_thread::update_buffer_duration(u64 timestamp)
+{
+	if (timestamp - m_buffer_duration_timestamp < cfg.adaptive_buffering_window)
+	{
+		return;
+	}
+
+	m_buffer_duration_timestamp = timestamp;
+
+	const auto [underruns, near_underruns] = ringbuffer->reset_underrun_counts();
+	const u64 old_duration = m_buffer_duration;
+
+	if (underruns)
+	{
+		// Grow quickly after an actual underrun
+		m_buffer_duration += m_buffer_duration / 2 + cfg.audio_block_period;
+	}
+	else if (near_underruns)
+	{
+		m_buffer_duration += cfg.audio_block_period * std::min<u32>(near_underruns, 4);
+	}
+	else
+	{
+		// Stable window, shrink slowly
+		m_buffer_duration -= std::min<u64>(m_buffer_duration, cfg.audio_block_period);
+	}
+
+	m_buffer_duration = std::clamp(m_buffer_duration, cfg.minimum_buffer_duration, cfg.maximum_buffer_duration);
+
+	if (m_buffer_duration != old_duration)
+	{
+		cellAudio.notice("Adaptive buffering: target duration %uus -> %uus (underruns=%u, near underruns=%u, device latency=%uus)", old_duration, m_buffer_duration, underruns, near_underruns, ringbuffer->get_backend_latency());
+	}
+}
+
 void cell_audio_thread::operator()()
 {
-	thread_ctrl::set_native_priority(1);
+	thread_ctrl::set_class_priority(thread_class::audio);
 
 	// Allocate ringbuffer
 	ringbuffer.reset(new audio_ringbuffer(cfg));
@@ -480,6 +527,8 @@ void cell_audio_thread::operator()()
 	m_start_time = ringbuffer->get_timestamp();
 	m_last_period_end = m_start_time;
 	m_dynamic_period = 0;
+	m_buffer_duration = cfg.adaptive_buffering ? std::clamp(cfg.desired_buffer_duration, cfg.minimum_buffer_duration, cfg.maximum_buffer_duration) : cfg.desired_buffer_duration;
+	m_buffer_duration_timestamp = m_start_time;
 
 	u32 untouched_expected = 0;
 	u32 in_progress_expected = 0;
@@ -519,6 +568,11 @@ void cell_audio_thread::operator()()
 
 			const bool playing = ringbuffer->is_playing();
 
+			if (cfg.adaptive_buffering)
+			{
+				update_buffer_duration(timestamp);
+			}
+
 			const auto tag_info = count_port_buffer_tags();
 			const u32 active_ports = std::get<0>(tag_info);
 			const u32 in_progress  = std::get<1>(tag_info);
@@ -537,7 +591,7 @@ void cell_audio_thread::operator()()
 				const f32 average_playtime_ratio = m_average_playtime / cfg.audio_buffer_length;
 
 				// Use the above average ratio to decide how much buffer we should be aiming for
-				f32 desired_duration_adjusted = cfg.desired_buffer_duration + (cfg.audio_block_period / 2.0f);
+				f32 desired_duration_adjusted = m_buffer_duration + (cfg.audio_block_period / 2.0f);
 				if (average_playtime_ratio < 1.0f)
 				{
 					desired_duration_adjusted /= std::max(average_playtime_ratio, 0.25f);
@@ -702,7 +756,7 @@ void cell_audio_thread::operator()()
 				// Flush, add silence, restart algorithm
 				cellAudio.trace("play/resume audio: received first audio buffer");
 				ringbuffer->flush();
-				ringbuffer->enqueue_silence(cfg.desired_full_buffers);
+				ringbuffer->enqueue_silence(static_cast<u32>(m_buffer_duration / cfg.audio_block_period) + 1);
 				finish_port_volume_stepping();
 				m_average_playtime = static_cast<f32>(ringbuffer->get_enqueued_playtime());
 			}
@@ -734,160 +788,371 @@ void cell_audio_thread::operator()()
 	ringbuffer.reset();
 }
 
-template <bool DownmixToStereo>
-void cell_audio_thread::mix(float *out_buffer, s32 offset)
+namespace audio_mix
 {
-	AUDIT(out_buffer != nullptr);
+	constexpr u32 samples = AUDIO_BUFFER_SAMPLES;
 
-	constexpr u32 channels = DownmixToStereo ? 2 : 8;
-	constexpr u32 out_buffer_sz = channels * AUDIO_BUFFER_SAMPLES;
+	// Port volume of sample i (vol is nullptr if the level is constant over the block)
+	inline __m128 volume_x4(const float* vol, float level, u32 i)
+	{
+		return vol ? _mm_loadu_ps(vol + i) : _mm_set1_ps(level);
+	}
 
-	bool first_mix = true;
+	// out = (First ? 0 : out) + in * volume, input and output have the same layout
+	template <u32 Channels, bool First>
+	void scale(float* out, const float* in, float level, const float* vol)
+	{
+		for (u32 i = 0; i < samples; i += 4)
+		{
+			const __m128 v = volume_x4(vol, level, i);
 
-	// mixing
-	for (auto& port : ports)
+			if constexpr (Channels == 2)
+			{
+				// 4 samples: L0 R0 L1 R1 | L2 R2 L3 R3
+				const __m128 v0 = _mm_unpacklo_ps(v, v);
+				const __m128 v1 = _mm_unpackhi_ps(v, v);
+				__m128 r0 = _mm_mul_ps(_mm_loadu_ps(in + i * 2), v0);
+				__m128 r1 = _mm_mul_ps(_mm_loadu_ps(in + i * 2 + 4), v1);
+
+				if constexpr (!First)
+				{
+					r0 = _mm_add_ps(r0, _mm_loadu_ps(out + i * 2));
+					r1 = _mm_add_ps(r1, _mm_loadu_ps(out + i * 2 + 4));
+				}
+
+				_mm_storeu_ps(out + i * 2, r0);
+				_mm_storeu_ps(out + i * 2 + 4, r1);
+			}
+			else
+			{
+				alignas(16) float lanes[4];
+				_mm_store_ps(lanes, v);
+
+				for (u32 j = 0; j < 4; j++)
+				{
+					const __m128 vj = _mm_set1_ps(lanes[j]);
+					const u32 pos = (i + j) * 8;
+					__m128 r0 = _mm_mul_ps(_mm_loadu_ps(in + pos), vj);
+					__m128 r1 = _mm_mul_ps(_mm_loadu_ps(in + pos + 4), vj);
+
+					if constexpr (!First)
+					{
+						r0 = _mm_add_ps(r0, _mm_loadu_ps(out + pos));
+						r1 = _mm_add_ps(r1, _mm_loadu_ps(out + pos + 4));
+					}
+
+					_mm_storeu_ps(out + pos, r0);
+					_mm_storeu_ps(out + pos + 4, r1);
+				}
+			}
+		}
+	}
+
+	// Stereo port to 8 channel output (other channels are cleared on first mix)
+	template <bool First>
+	void upmix(float* out, const float* in, float level, const float* vol)
 	{
-		if (port.state != audio_port_state::started) continue;
+		for (u32 i = 0; i < samples; i += 2)
+		{
+			// 2 samples: L0 R0 L1 R1
+			const __m128 v = vol ? _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(vol + i))) : _mm_set1_ps(level);
+			const __m128 r = _mm_mul_ps(_mm_loadu_ps(in + i * 2), _mm_unpacklo_ps(v, v));
+
+			float* const out0 = out + i * 8;
+			float* const out1 = out0 + 8;
+
+			if constexpr (First)
+			{
+				const __m128 zero = _mm_setzero_ps();
+				_mm_storeu_ps(out0, _mm_movelh_ps(r, zero));
+				_mm_storeu_ps(out0 + 4, zero);
+				_mm_storeu_ps(out1, _mm_movehl_ps(zero, r));
+				_mm_storeu_ps(out1 + 4, zero);
+			}
+			else
+			{
+				const __m128 prev = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(out0)), reinterpret_cast<const __m64*>(out1));
+				const __m128 sum = _mm_add_ps(prev, r);
+				_mm_storel_pi(reinterpret_cast<__m64*>(out0), sum);
+				_mm_storeh_pi(reinterpret_cast<__m64*>(out1), sum);
+			}
+		}
+	}
 
-		auto buf = port.get_vm_ptr(offset);
-		static const float k = 1.0f;
-		float& m = port.level;
+	// 8 channel port to stereo output: L + RL + SL + (C + LFE) * 0.708, same for R
+	template <bool First>
+	void downmix(float* out, const float* in, float level, const float* vol)
+	{
+		const __m128 mid_scale = _mm_set1_ps(0.708f);
 
-		// part of cellAudioSetPortLevel functionality
-		// spread port volume changes over 13ms
-		auto step_volume = [](audio_port& port)
+		for (u32 i = 0; i < samples; i += 2)
 		{
-			const auto param = port.level_set.load();
+			__m128 lr[2];
 
-			if (param.inc != 0.0f)
+			for (u32 j = 0; j < 2; j++)
+			{
+				// L R C LFE | RL RR SL SR
+				const __m128 a = _mm_loadu_ps(in + (i + j) * 8);
+				const __m128 b = _mm_loadu_ps(in + (i + j) * 8 + 4);
+				const __m128 rear_side = _mm_add_ps(b, _mm_movehl_ps(b, b));
+				const __m128 mid = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(a, a, 0xaa), _mm_shuffle_ps(a, a, 0xff)), mid_scale);
+				const __m128 v = _mm_set1_ps(vol ? vol[i + j] : level);
+				lr[j] = _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, rear_side), mid), v);
+			}
+
+			__m128 r = _mm_movelh_ps(lr[0], lr[1]);
+
+			if constexpr (!First)
+			{
+				r = _mm_add_ps(r, _mm_loadu_ps(out + i * 2));
+			}
+
+			_mm_storeu_ps(out + i * 2, r);
+		}
+	}
+
+	// Spread port volume changes over the block (part of cellAudioSetPortLevel functionality)
+	// Returns false if the level doesn't change, otherwise fills per-sample volume
+	bool step_volume(audio_port& port, float* vol)
+	{
+		const auto param = port.level_set.load();
+
+		if (param.inc == 0.0f)
+		{
+			return false;
+		}
+
+		const bool dec = param.inc < 0.0f;
+		bool reached = false;
+
+		for (u32 i = 0; i < samples; i++)
+		{
+			if (!reached)
 			{
 				port.level += param.inc;
-				const bool dec = param.inc < 0.0f;
 
 				if ((!dec && param.value - port.level <= 0.0f) || (dec && param.value - port.level >= 0.0f))
 				{
 					port.level = param.value;
-					port.level_set.compare_and_swap(param, { param.value, 0.0f });
+					reached = true;
 				}
 			}
-		};
 
-		if (port.num_channels == 2)
+			vol[i] = port.level;
+		}
+
+		if (reached)
+		{
+			port.level_set.compare_and_swap(param, { param.value, 0.0f });
+		}
+
+		return true;
+	}
+
+	// out[0..1] += pair (low half of v)
+	inline void add_pair(float* out, __m128 v)
+	{
+		_mm_storel_pi(reinterpret_cast<__m64*>(out), _mm_add_ps(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(out)), v));
+	}
+
+	// 4 s16 to float, scaled by k
+	inline __m128 s16_x4(__m128i v, __m128 k)
+	{
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), k);
+	}
+
+	void add_to_8ch(float* out, const float* in, u32 channels, u32 count)
+	{
+		u32 i = 0;
+
+		switch (channels)
+		{
+		case 1:
 		{
-			if (first_mix)
+			for (; i + 4 <= count; i += 4)
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 2)
-				{
-					step_volume(port);
+				const __m128 c = _mm_loadu_ps(in + i);
+				add_pair(out + i * 8 + 0, _mm_unpacklo_ps(c, c));
+				add_pair(out + i * 8 + 8, _mm_shuffle_ps(c, c, 0x55));
+				add_pair(out + i * 8 + 16, _mm_unpackhi_ps(c, c));
+				add_pair(out + i * 8 + 24, _mm_shuffle_ps(c, c, 0xff));
+			}
 
-					const float left  = buf[in + 0] * m;
-					const float right = buf[in + 1] * m;
+			for (; i < count; i++)
+			{
+				out[i * 8 + 0] += in[i];
+				out[i * 8 + 1] += in[i];
+			}
 
-					out_buffer[out + 0] = left;
-					out_buffer[out + 1] = right;
+			break;
+		}
+		case 2:
+		{
+			for (; i + 2 <= count; i += 2)
+			{
+				// 2 samples: L0 R0 L1 R1
+				const __m128 r = _mm_loadu_ps(in + i * 2);
+				add_pair(out + i * 8, r);
+				add_pair(out + i * 8 + 8, _mm_movehl_ps(r, r));
+			}
 
-					if constexpr (!DownmixToStereo)
-					{
-						out_buffer[out + 2] = 0.0f;
-						out_buffer[out + 3] = 0.0f;
-						out_buffer[out + 4] = 0.0f;
-						out_buffer[out + 5] = 0.0f;
-						out_buffer[out + 6] = 0.0f;
-						out_buffer[out + 7] = 0.0f;
-					}
-				}
-				first_mix = false;
+			for (; i < count; i++)
+			{
+				out[i * 8 + 0] += in[i * 2 + 0];
+				out[i * 8 + 1] += in[i * 2 + 1];
 			}
-			else
+
+			break;
+		}
+		case 6:
+		{
+			// L R C LFE | RL RR (the last sample can't load 4 floats for the rear pair)
+			for (; i < count; i++)
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 2)
-				{
-					step_volume(port);
+				_mm_storeu_ps(out + i * 8, _mm_add_ps(_mm_loadu_ps(out + i * 8), _mm_loadu_ps(in + i * 6)));
+				add_pair(out + i * 8 + 4, _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in + i * 6 + 4)));
+			}
+
+			break;
+		}
+		case 8:
+		{
+			for (; i < count * 8; i += 4)
+			{
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i)));
+			}
 
-					const float left  = buf[in + 0] * m;
-					const float right = buf[in + 1] * m;
+			break;
+		}
+		default: fmt::throw_exception("Invalid channel count (%u)" HERE, channels);
+		}
+	}
 
-					out_buffer[out + 0] += left;
-					out_buffer[out + 1] += right;
-				}
+	void add_to_channel(float* out, const float* in, u32 channel, u32 count)
+	{
+		// Strided output, nothing to gain from vectors here
+		for (u32 i = 0; i < count; i++)
+		{
+			out[i * 8 + channel] += in[i];
+		}
+	}
+
+	void add_s16(float* out, const s16* in, u32 channels, float level, u32 count)
+	{
+		// Same result as (float)v / 0x8000 * level, the division is exact
+		const __m128 norm = _mm_set1_ps(1.0f / 0x8000);
+		const __m128 k = _mm_set1_ps(level);
+
+		u32 i = 0;
+
+		if (channels == 1)
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 c = _mm_mul_ps(s16_x4(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)), norm), k);
+				add_pair(out + i * 8 + 0, _mm_unpacklo_ps(c, c));
+				add_pair(out + i * 8 + 8, _mm_shuffle_ps(c, c, 0x55));
+				add_pair(out + i * 8 + 16, _mm_unpackhi_ps(c, c));
+				add_pair(out + i * 8 + 24, _mm_shuffle_ps(c, c, 0xff));
+			}
+
+			for (; i < count; i++)
+			{
+				const float c = (float)in[i] / 0x8000 * level;
+				out[i * 8 + 0] += c;
+				out[i * 8 + 1] += c;
+			}
+		}
+		else
+		{
+			for (; i + 4 <= count; i += 4)
+			{
+				// 4 samples: L0 R0 L1 R1 | L2 R2 L3 R3
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+				const __m128 r0 = _mm_mul_ps(s16_x4(v, norm), k);
+				const __m128 r1 = _mm_mul_ps(s16_x4(_mm_unpackhi_epi64(v, v), norm), k);
+				add_pair(out + i * 8 + 0, r0);
+				add_pair(out + i * 8 + 8, _mm_movehl_ps(r0, r0));
+				add_pair(out + i * 8 + 16, r1);
+				add_pair(out + i * 8 + 24, _mm_movehl_ps(r1, r1));
+			}
+
+			for (; i < count; i++)
+			{
+				out[i * 8 + 0] += (float)in[i * 2 + 0] / 0x8000 * level;
+				out[i * 8 + 1] += (float)in[i * 2 + 1] / 0x8000 * level;
+			}
+		}
+	}
+}
+
+template <bool DownmixToStereo>
+void cell_audio_thread::mix(float *out_buffer, s32 offset)
+{
+	AUDIT(out_buffer != nullptr);
+
+	timeline::scoped_event event("Audio", "Mix");
+
+	constexpr u32 channels = DownmixToStereo ? 2 : 8;
+	constexpr u32 out_buffer_sz = channels * AUDIO_BUFFER_SAMPLES;
+
+	bool first_mix = true;
+
+	// Port block converted to native endianness
+	alignas(32) float buf[AUDIO_BLOCK_SIZE_8CH];
+
+	// mixing
+	for (auto& port : ports)
+	{
+		if (port.state != audio_port_state::started) continue;
+
+		vm::copy_from_be(buf, port.get_vm_ptr(offset), std::min<u32>(port.block_size(), AUDIO_BLOCK_SIZE_8CH));
+
+		// Per-sample volume while the port level is being changed
+		alignas(16) float vol_buf[AUDIO_BUFFER_SAMPLES];
+		const float* const vol = audio_mix::step_volume(port, vol_buf) ? vol_buf : nullptr;
+		const float level = port.level;
+
+		if (port.num_channels == 2)
+		{
+			if constexpr (DownmixToStereo)
+			{
+				if (first_mix)
+					audio_mix::scale<2, true>(out_buffer, buf, level, vol);
+				else
+					audio_mix::scale<2, false>(out_buffer, buf, level, vol);
+			}
+			else
+			{
+				if (first_mix)
+					audio_mix::upmix<true>(out_buffer, buf, level, vol);
+				else
+					audio_mix::upmix<false>(out_buffer, buf, level, vol);
 			}
 		}
 		else if (port.num_channels == 8)
 		{
-			if (first_mix)
+			if constexpr (DownmixToStereo)
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 8)
-				{
-					step_volume(port);
-
-					const float left       = buf[in + 0] * m;
-					const float right      = buf[in + 1] * m;
-					const float center     = buf[in + 2] * m;
-					const float low_freq   = buf[in + 3] * m;
-					const float rear_left  = buf[in + 4] * m;
-					const float rear_right = buf[in + 5] * m;
-					const float side_left  = buf[in + 6] * m;
-					const float side_right = buf[in + 7] * m;
-
-					if constexpr (DownmixToStereo)
-					{
-						const float mid = (center + low_freq) * 0.708f;
-						out_buffer[out + 0] = (left + rear_left + side_left + mid) * k;
-						out_buffer[out + 1] = (right + rear_right + side_right + mid) * k;
-					}
-					else
-					{
-						out_buffer[out + 0] = left;
-						out_buffer[out + 1] = right;
-						out_buffer[out + 2] = center;
-						out_buffer[out + 3] = low_freq;
-						out_buffer[out + 4] = rear_left;
-						out_buffer[out + 5] = rear_right;
-						out_buffer[out + 6] = side_left;
-						out_buffer[out + 7] = side_right;
-					}
-				}
-				first_mix = false;
+				if (first_mix)
+					audio_mix::downmix<true>(out_buffer, buf, level, vol);
+				else
+					audio_mix::downmix<false>(out_buffer, buf, level, vol);
 			}
 			else
 			{
-				for (u32 out = 0, in = 0; out < out_buffer_sz; out += channels, in += 8)
-				{
-					step_volume(port);
-
-					const float left       = buf[in + 0] * m;
-					const float right      = buf[in + 1] * m;
-					const float center     = buf[in + 2] * m;
-					const float low_freq   = buf[in + 3] * m;
-					const float rear_left  = buf[in + 4] * m;
-					const float rear_right = buf[in + 5] * m;
-					const float side_left  = buf[in + 6] * m;
-					const float side_right = buf[in + 7] * m;
-
-					if constexpr (DownmixToStereo)
-					{
-						const float mid = (center + low_freq) * 0.708f;
-						out_buffer[out + 0] += (left + rear_left + side_left + mid) * k;
-						out_buffer[out + 1] += (right + rear_right + side_right + mid) * k;
-					}
-					else
-					{
-						out_buffer[out + 0] += left;
-						out_buffer[out + 1] += right;
-						out_buffer[out + 2] += center;
-						out_buffer[out + 3] += low_freq;
-						out_buffer[out + 4] += rear_left;
-						out_buffer[out + 5] += rear_right;
-						out_buffer[out + 6] += side_left;
-						out_buffer[out + 7] += side_right;
-					}
-				}
+				if (first_mix)
+					audio_mix::scale<8, true>(out_buffer, buf, level, vol);
+				else
+					audio_mix::scale<8, false>(out_buffer, buf, level, vol);
 			}
 		}
 		else
 		{
 			fmt::throw_exception("Unknown channel count (port=%u, channel=%d)" HERE, port.number, port.num_channels);
 		}
+
+		first_mix = false;
 	}
 
 	// Nothing was mixed, memset out_buffer to 0
@@ -101,6 +101,19 @@ enum : u32
 	PORT_BUFFER_TAG_FIRST_8CH = PORT_BUFFER_TAG_LAST_8CH % (PORT_BUFFER_TAG_COUNT - 1),
 };
 
+// Mixing kernels shared with libmixer, inputs are native endian (see vm::copy_from_be)
+namespace audio_mix
+{
+	// Accumulate a block of 1 (to L and R), 2, 6 or 8 channel samples into 8 channel output
+	void add_to_8ch(float* out, const float* in, u32 channels, u32 count);
+
+	// Accumulate a block of mono samples into one channel of 8 channel output
+	void add_to_channel(float* out, const float* in, u32 channel, u32 count);
+
+	// Accumulate 1 (to L and R) or 2 channel s16 samples scaled by level into 8 channel output
+	void add_s16(float* out, const s16* in, u32 channels, float level, u32 count);
+}
+
 enum class audio_port_state : u32
 {
 	closed,
@@ -193,8 +206,17 @@ public:
 	const u64 minimum_block_period = audio_block_period / 2; // the block period will not be dynamically lowered below this value (usecs)
 	const u64 maximum_block_period = (6 * audio_block_period) / 5; // the block period will not be dynamically increased above this value (usecs)
 
+	/*
+	 * Adaptive Buffering
+	 */
+	const bool adaptive_buffering = buffering_enabled && g_cfg.audio.adaptive_buffering;
+
+	const u64 minimum_buffer_duration = 20'000; // the buffer duration will not be adaptively lowered below this value (usecs)
+	const u64 maximum_buffer_duration = std::min<u64>(250'000, (MAX_AUDIO_BUFFERS - EXTRA_AUDIO_BUFFERS - 1) * audio_block_period); // nor increased above this value (usecs)
+	const u64 adaptive_buffering_window = 1'000'000; // the buffer duration is reevaluated after this many usecs
+
 	const u32 desired_full_buffers = buffering_enabled ? static_cast<u32>(desired_buffer_duration / audio_block_period) + 1 : 2;
-	const u32 num_allocated_buffers = desired_full_buffers + EXTRA_AUDIO_BUFFERS; // number of ringbuffer buffers
+	const u32 num_allocated_buffers = (adaptive_buffering ? static_cast<u32>(maximum_buffer_duration / audio_block_period) + 1 : desired_full_buffers) + EXTRA_AUDIO_BUFFERS; // number of ringbuffer buffers
 
 	const f32 period_average_alpha = 0.02f; // alpha factor for the m_average_period rolling average
 
@@ -250,6 +272,11 @@ private:
 
 	u32 cur_pos = 0;
 
+	// Underrun statistics for adaptive buffering
+	u32 underruns = 0;
+	u32 near_underruns = 0;
+	bool near_underrun = false;
+
 	bool get_backend_playing() const
 	{
 		return has_capability(AudioBackend::PLAY_PAUSE_FLUSH | AudioBackend::IS_PLAYING) ? backend->IsPlaying() : playing;
@@ -315,6 +342,17 @@ public:
 	{
 		return backend->GetName();
 	}
+
+	u64 get_backend_latency() const
+	{
+		return has_capability(AudioBackend::GET_LATENCY) ? backend->GetLatency() : 0;
+	}
+
+	// Get the number of underruns and near-underruns since the last call
+	std::pair<u32, u32> reset_underrun_counts()
+	{
+		return { std::exchange(underruns, 0), std::exchange(near_underruns, 0) };
+	}
 };
 
 
@@ -331,6 +369,7 @@ class cell_audio_thread
 	template <bool DownmixToStereo>
 	void mix(float *out_buffer, s32 offset = 0);
 	void finish_port_volume_stepping();
+	void update_buffer_duration(u64 timestamp);
 
 	constexpr static u64 get_thread_wait_delay(u64 time_left)
 	{
@@ -349,6 +388,9 @@ public:
 	u64 m_dynamic_period = 0;
 	f32 m_average_playtime;
 
+	u64 m_buffer_duration = 0; // current target buffer duration (usecs)
+	u64 m_buffer_duration_timestamp = 0;
+
 	void operator()();
 
 	cell_audio_thread(vm::ptr<char> buf, vm::ptr<u64> ind)
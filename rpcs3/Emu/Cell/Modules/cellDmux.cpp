@@ -163,10 +163,16 @@ public:
 	const u32 spec; //addr
 
 	std::vector<u8> raw_data; // demultiplexed data stream (managed by demuxer thread)
-	size_t raw_pos; // should be <= raw_data.size()
+	size_t raw_pos; // should be <= raw_data.size(), data before it was already pushed as AU
 	u64 last_dts;
 	u64 last_pts;
 
+	// Size of demultiplexed data not yet pushed as AU
+	u32 raw_size() const
+	{
+		return static_cast<u32>(raw_data.size() - raw_pos);
+	}
+
 	void push(DemuxerStream& stream, u32 size); // called by demuxer thread (not multithread-safe)
 
 	bool isfull(u32 space);
@@ -349,7 +355,7 @@ public:
 					if ((fid_minor & -0x10) == 0 && esATX[ch])
 					{
 						ElementaryStream& es = *esATX[ch];
-						if (es.raw_data.size() > 1024 * 1024)
+						if (es.raw_size() > 1024 * 1024)
 						{
 							stream = backup;
 							std::this_thread::sleep_for(1ms); // hack
@@ -445,7 +451,7 @@ public:
 					{
 						ElementaryStream& es = *esAVC[ch];
 
-						const u32 old_size = (u32)es.raw_data.size();
+						const u32 old_size = es.raw_size();
 						if (es.isfull(old_size))
 						{
 							stream = backup;
@@ -611,7 +617,7 @@ public:
 			{
 				ElementaryStream& es = *task.es.es_ptr;
 
-				const u32 old_size = (u32)es.raw_data.size();
+				const u32 old_size = es.raw_size();
 				if (old_size && (es.fidMajor & -0x10) == 0xe0)
 				{
 					// TODO (it's only for AVC, some ATX data may be lost)
@@ -632,9 +638,9 @@ public:
 					lv2_obj::sleep(*this);
 				}
 
-				if (es.raw_data.size())
+				if (es.raw_size())
 				{
-					cellDmux.error("dmuxFlushEs: 0x%x bytes lost (es_id=%d)", (u32)es.raw_data.size(), es.id);
+					cellDmux.error("dmuxFlushEs: 0x%x bytes lost (es_id=%d)", es.raw_size(), es.id);
 				}
 
 				// callback
@@ -810,8 +816,9 @@ void ElementaryStream::push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool ra
 			put = memAddr;
 		}
 
-		std::memcpy(vm::base(put + 128), raw_data.data(), size);
-		raw_data.erase(raw_data.begin(), raw_data.begin() + size);
+		// Consume by advancing the read position, the buffer is compacted by push()
+		std::memcpy(vm::base(put + 128), raw_data.data() + raw_pos, size);
+		raw_pos += size;
 
 		auto info = vm::ptr<CellDmuxAuInfoEx>::make(put);
 		info->auAddr = put + 128;
@@ -849,6 +856,18 @@ void ElementaryStream::push_au(u32 size, u64 dts, u64 pts, u64 userdata, bool ra
 
 void ElementaryStream::push(DemuxerStream& stream, u32 size)
 {
+	if (raw_pos == raw_data.size())
+	{
+		raw_data.clear();
+		raw_pos = 0;
+	}
+	else if (raw_pos >= raw_data.size() / 2)
+	{
+		// Drop consumed data once it dominates the buffer (one move per many AUs)
+		raw_data.erase(raw_data.begin(), raw_data.begin() + raw_pos);
+		raw_pos = 0;
+	}
+
 	auto const old_size = raw_data.size();
 
 	raw_data.resize(old_size + size);
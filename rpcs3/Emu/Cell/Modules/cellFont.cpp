@@ -1,5 +1,6 @@
 ﻿#include "stdafx.h"
 #include "Emu/System.h"
+#include "Emu/IdManager.h"
 #include "Emu/Cell/PPUModule.h"
 
 // Defines STB_TRUETYPE_IMPLEMENTATION *once* before including stb_truetype.h (as noted in stb_truetype.h's comments)
@@ -8,8 +9,88 @@
 
 #include "cellFont.h"
 
+#include <list>
+#include <unordered_map>
+
 LOG_CHANNEL(cellFont);
 
+// Rendered glyph bitmaps, text is usually drawn with the same few glyphs every frame
+struct font_glyph_cache
+{
+	static constexpr std::size_t max_glyphs = 1024; // per font
+
+	struct glyph
+	{
+		std::vector<u8> bitmap;
+		s32 width;
+		s32 height;
+		s32 xoff;
+		s32 yoff;
+		s32 baseline;
+	};
+
+	struct font_cache
+	{
+		// Most recently used first
+		std::list<std::pair<u64, glyph>> lru;
+		std::unordered_map<u64, decltype(lru)::iterator> map;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<const stbtt_fontinfo*, font_cache> fonts;
+
+	// Get glyph bitmap and metrics, rasterise on miss (mutex must be locked)
+	const glyph* get(const stbtt_fontinfo* font, u32 code, float scale)
+	{
+		const u64 key = u64{code} << 32 | std::bit_cast<u32>(scale);
+
+		auto& cache = fonts[font];
+
+		if (auto found = cache.map.find(key); found != cache.map.end())
+		{
+			cache.lru.splice(cache.lru.begin(), cache.lru, found->second);
+			return &found->second->second;
+		}
+
+		glyph g;
+		u8* box = stbtt_GetCodepointBitmap(font, scale, scale, code, &g.width, &g.height, &g.xoff, &g.yoff);
+
+		if (box)
+		{
+			g.bitmap.assign(box, box + g.width * g.height);
+			stbtt_FreeBitmap(box, 0);
+		}
+		else
+		{
+			// Nothing to draw (spaces), remember it as well
+			g.width = 0;
+			g.height = 0;
+		}
+
+		// Get the baseLineY value
+		s32 ascent, descent, lineGap;
+		stbtt_GetFontVMetrics(font, &ascent, &descent, &lineGap);
+		g.baseline = (int)((float)ascent * scale); // ???
+
+		if (cache.lru.size() >= max_glyphs)
+		{
+			cache.map.erase(cache.lru.back().first);
+			cache.lru.pop_back();
+		}
+
+		cache.lru.emplace_front(key, std::move(g));
+		cache.map.emplace(key, cache.lru.begin());
+		return &cache.lru.front().second;
+	}
+
+	// Forget the glyphs of a closed or reopened font
+	void drop(const stbtt_fontinfo* font)
+	{
+		std::lock_guard lock(mutex);
+		fonts.erase(font);
+	}
+};
+
 // Functions
 s32 cellFontInitializeWithRevision(u64 revisionFlags, vm::ptr<CellFontConfig> config)
 {
@@ -52,6 +133,7 @@ s32 cellFontOpenFontMemory(vm::ptr<CellFontLibrary> library, u32 fontAddr, u32 f
 	cellFont.warning("cellFontOpenFontMemory(library=*0x%x, fontAddr=0x%x, fontSize=%d, subNum=%d, uniqueId=%d, font=*0x%x)", library, fontAddr, fontSize, subNum, uniqueId, font);
 
 	font->stbfont = (stbtt_fontinfo*)((u8*)&(font->stbfont) + sizeof(void*)); // hack: use next bytes of the struct
+	fxm::get_always<font_glyph_cache>()->drop(font->stbfont);
 
 	if (!stbtt_InitFont(font->stbfont, vm::_ptr<unsigned char>(fontAddr), 0))
 		return CELL_FONT_ERROR_FONT_OPEN_FAILED;
@@ -307,39 +389,34 @@ s32 cellFontRenderCharGlyphImage(vm::ptr<CellFont> font, u32 code, vm::ptr<CellF
 		return CELL_FONT_ERROR_RENDERER_UNBIND;
 	}
 
-	// Render the character
-	s32 width, height, xoff, yoff;
-	float scale = stbtt_ScaleForPixelHeight(font->stbfont, font->scale_y);
-	unsigned char* box = stbtt_GetCodepointBitmap(font->stbfont, scale, scale, code, &width, &height, &xoff, &yoff);
+	// Render the character (or get it from the cache)
+	const auto cache = fxm::get_always<font_glyph_cache>();
+	std::lock_guard lock(cache->mutex);
 
-	if (!box)
-	{
-		return CELL_OK;
-	}
+	const float scale = stbtt_ScaleForPixelHeight(font->stbfont, font->scale_y);
+	const auto glyph = cache->get(font->stbfont, code, scale);
 
-	// Get the baseLineY value
-	s32 baseLineY;
-	s32 ascent, descent, lineGap;
-	stbtt_GetFontVMetrics(font->stbfont, &ascent, &descent, &lineGap);
-	baseLineY = (int)((float)ascent * scale); // ???
+	const s32 width = glyph->width;
+	const s32 height = glyph->height;
+	const s32 yoff = glyph->yoff;
+	const s32 baseLineY = glyph->baseline;
+	const u32 surface_width = surface->width;
+	const u32 surface_height = surface->height;
 
-	// Move the rendered character to the surface
+	// Visible part of each row
+	const u32 row_size = (u32)x >= surface_width ? 0 : std::min<u32>(width, surface_width - (u32)x);
+
+	// Move the rendered character to the surface, row by row
 	unsigned char* buffer = vm::_ptr<unsigned char>(surface->buffer.addr());
-	for (u32 ypos = 0; ypos < (u32)height; ypos++)
+	for (u32 ypos = 0; row_size && ypos < (u32)height; ypos++)
 	{
-		if ((u32)y + ypos + yoff + baseLineY >= (u32)surface->height)
+		if ((u32)y + ypos + yoff + baseLineY >= surface_height)
 			break;
 
-		for (u32 xpos = 0; xpos < (u32)width; xpos++)
-		{
-			if ((u32)x + xpos >= (u32)surface->width)
-				break;
-
-			// TODO: There are some oddities in the position of the character in the final buffer
-			buffer[((s32)y + ypos + yoff + baseLineY)*surface->width + (s32)x + xpos] = box[ypos * width + xpos];
-		}
+		// TODO: There are some oddities in the position of the character in the final buffer
+		std::memcpy(buffer + ((s32)y + ypos + yoff + baseLineY) * surface_width + (s32)x, glyph->bitmap.data() + ypos * width, row_size);
 	}
-	stbtt_FreeBitmap(box, 0);
+
 	return CELL_OK;
 }
 
@@ -384,6 +461,8 @@ s32 cellFontCloseFont(vm::ptr<CellFont> font)
 {
 	cellFont.warning("cellFontCloseFont(font=*0x%x)", font);
 
+	fxm::get_always<font_glyph_cache>()->drop(font->stbfont);
+
 	if (font->origin == CELL_FONT_OPEN_FONTSET ||
 		font->origin == CELL_FONT_OPEN_FONT_FILE ||
 		font->origin == CELL_FONT_OPEN_MEMORY)
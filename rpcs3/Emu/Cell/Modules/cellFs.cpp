@@ -5,11 +5,16 @@
 
 #include "Emu/Cell/lv2/sys_fs.h"
 #include "Emu/Cell/lv2/sys_sync.h"
+#include "Emu/Cell/lv2/sys_ppu_thread.h"
 #include "cellFs.h"
+#include "sysPrxForUser.h"
 
 #include "Utilities/StrUtil.h"
 
 #include <mutex>
+#include <deque>
+#include <map>
+#include <unordered_map>
 
 LOG_CHANNEL(cellFs);
 
@@ -649,21 +654,186 @@ error_code cellFsSetDiscReadRetrySetting()
 	return CELL_OK;
 }
 
+// Creates an interrupt PPU thread running guest callbacks queued through its command list
+static std::shared_ptr<named_thread<ppu_thread>> fs_make_callback_thread(ppu_thread& ppu, const char* name)
+{
+	vm::var<u64> _tid;
+	vm::var<char[]> _name = vm::make_str(name);
+	ppu_execute<&sys_ppu_thread_create>(ppu, +_tid, 0x10000, 0, static_cast<s32>(ppu.prio.load()), 0x4000, SYS_PPU_THREAD_CREATE_INTERRUPT, +_name);
+
+	const auto thread = idm::get<named_thread<ppu_thread>>(static_cast<u32>(*_tid));
+	thread->state -= cpu_flag::stop;
+	return thread;
+}
+
+struct fs_st_stream
+{
+	// Fills the ring buffer block by block ahead of the guest
+	struct reader
+	{
+		fs_st_stream* st;
+
+		void operator()();
+	};
+
+	const u32 fd;
+	const std::shared_ptr<lv2_file> file;
+	const u64 ring_size;
+	const u64 block_size;
+	const u64 transfer_rate;
+	const s32 copy;
+	const u32 addr;
+
+	shared_mutex mutex;
+	u64 status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_STOP;
+
+	// Incremented by cellFsStReadStart/Stop to drop the block being read
+	u64 gen = 0;
+	u64 file_pos = 0;
+	u64 file_end = 0;
+
+	// Total amounts written and consumed since the start
+	u64 head = 0;
+	u64 tail = 0;
+
+	// cellFsStReadWait
+	ppu_thread* waiter = nullptr;
+	u64 wait_size = 0;
+
+	// cellFsStReadWaitCallback
+	std::shared_ptr<named_thread<ppu_thread>> cb_thread;
+	vm::ptr<void(s32 xfd, u64 xsize)> cb_func = vm::null;
+	u64 cb_size = 0;
+
+	std::unique_ptr<named_thread<reader>> thread;
+
+	fs_st_stream(u32 fd, std::shared_ptr<lv2_file> file, const CellFsRingBuffer& ringbuf, u32 addr)
+		: fd(fd)
+		, file(std::move(file))
+		, ring_size(ringbuf.ringbuf_size)
+		, block_size(ringbuf.block_size)
+		, transfer_rate(ringbuf.transfer_rate)
+		, copy(ringbuf.copy)
+		, addr(addr)
+	{
+		thread = std::make_unique<named_thread<reader>>(fmt::format("FS Stream Reader %u", fd), reader{this});
+	}
+
+	~fs_st_stream()
+	{
+		thread.reset();
+		vm::dealloc(addr);
+	}
+
+	u64 avail() const
+	{
+		return head - tail;
+	}
+
+	// No more data will arrive until the next cellFsStReadStart
+	bool finished() const
+	{
+		return !(status & CELL_FS_ST_PROGRESS) || file_pos >= file_end;
+	}
+
+	// Must be called with the mutex locked
+	void notify_waiters()
+	{
+		if (waiter && (avail() >= wait_size || finished()))
+		{
+			lv2_obj::awake(*waiter);
+			waiter = nullptr;
+		}
+
+		if (cb_func && (avail() >= cb_size || finished()))
+		{
+			cb_thread->cmd_list
+			({
+				{ ppu_cmd::set_args, 2 }, u64{fd}, u64{avail()},
+				{ ppu_cmd::lle_call, cb_func.addr() },
+				{ ppu_cmd::sleep, 0 }
+			});
+
+			thread_ctrl::notify(*cb_thread);
+			cb_func = vm::null;
+		}
+	}
+};
+
+void fs_st_stream::reader::operator()()
+{
+	while (thread_ctrl::state() != thread_state::aborting)
+	{
+		bool idle = true;
+		u64 gen = 0, pos = 0, size = 0, off = 0;
+
+		{
+			std::lock_guard lock(st->mutex);
+
+			if (!st->finished() && st->avail() + st->block_size <= st->ring_size)
+			{
+				idle = false;
+				gen = st->gen;
+				pos = st->file_pos;
+				size = std::min(st->block_size, st->file_end - st->file_pos);
+				off = st->head % st->ring_size;
+			}
+		}
+
+		if (idle)
+		{
+			thread_ctrl::wait();
+			continue;
+		}
+
+		// The block lies outside of the data available to the guest, no lock needed
+		const u64 result = st->file->op_read_at(pos, vm::ptr<void>::make(st->addr + static_cast<u32>(off)), size);
+
+		std::lock_guard lock(st->mutex);
+
+		if (gen != st->gen)
+		{
+			continue;
+		}
+
+		st->head += result;
+		st->file_pos = result < size ? st->file_end : st->file_pos + result;
+		st->notify_waiters();
+	}
+}
+
+struct fs_st_manager
+{
+	shared_mutex mutex;
+	std::unordered_map<u32, std::shared_ptr<fs_st_stream>> streams;
+
+	// Shared by the cellFsStReadWaitCallback callbacks of all streams
+	std::shared_ptr<named_thread<ppu_thread>> thread;
+
+	std::shared_ptr<fs_st_stream> get(u32 fd)
+	{
+		reader_lock lock(mutex);
+
+		const auto found = streams.find(fd);
+		return found == streams.end() ? nullptr : found->second;
+	}
+};
+
 s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.warning("cellFsStReadInit(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
 	if (ringbuf->copy & ~CELL_FS_ST_COPYLESS)
 	{
 		return CELL_EINVAL;
 	}
 
-	if (ringbuf->block_size & 0xfff) // check if a multiple of sector size
+	if (!ringbuf->block_size || ringbuf->block_size & 0xfff) // check if a multiple of sector size
 	{
 		return CELL_EINVAL;
 	}
 
-	if (ringbuf->ringbuf_size % ringbuf->block_size) // check if a multiple of block_size
+	if (!ringbuf->ringbuf_size || ringbuf->ringbuf_size % ringbuf->block_size) // check if a multiple of block_size
 	{
 		return CELL_EINVAL;
 	}
@@ -680,251 +850,528 @@ s32 cellFsStReadInit(u32 fd, vm::cptr<CellFsRingBuffer> ringbuf)
 		return CELL_EPERM;
 	}
 
-	// TODO
+	const auto m = fxm::get_always<fs_st_manager>();
+
+	std::lock_guard lock(m->mutex);
+
+	if (m->streams.count(fd))
+	{
+		return CELL_EBUSY;
+	}
+
+	const u32 addr = ringbuf->ringbuf_size > UINT32_MAX ? 0 : vm::alloc(static_cast<u32>(ringbuf->ringbuf_size), vm::main, 0x1000);
+
+	if (!addr)
+	{
+		return CELL_ENOMEM;
+	}
+
+	m->streams.emplace(fd, std::make_shared<fs_st_stream>(fd, file, *ringbuf, addr));
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadFinish(u32 fd)
 {
-	cellFs.todo("cellFsStReadFinish(fd=%d)", fd);
+	cellFs.warning("cellFsStReadFinish(fd=%d)", fd);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto m = fxm::get_always<fs_st_manager>();
 
-	if (!file)
+	std::shared_ptr<fs_st_stream> st;
 	{
-		return CELL_EBADF; // ???
+		std::lock_guard lock(m->mutex);
+
+		const auto found = m->streams.find(fd);
+
+		if (found == m->streams.end())
+		{
+			return CELL_EBADF; // ???
+		}
+
+		st = std::move(found->second);
+		m->streams.erase(found);
 	}
 
-	// TODO
+	// Release the waiters, the reader is joined and the ring buffer freed with the last reference
+	{
+		std::lock_guard lock(st->mutex);
+		st->gen++;
+		st->status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_STOP;
+		st->notify_waiters();
+	}
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRingBuf(u32 fd, vm::ptr<CellFsRingBuffer> ringbuf)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
+	cellFs.warning("cellFsStReadGetRingBuf(fd=%d, ringbuf=*0x%x)", fd, ringbuf);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	ringbuf->ringbuf_size = st->ring_size;
+	ringbuf->block_size = st->block_size;
+	ringbuf->transfer_rate = st->transfer_rate;
+	ringbuf->copy = st->copy;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetStatus(u32 fd, vm::ptr<u64> status)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, status=*0x%x)", fd, status);
+	cellFs.trace("cellFsStReadGetStatus(fd=%d, status=*0x%x)", fd, status);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
-		return CELL_EBADF;
+		if (!idm::check<lv2_fs_object, lv2_file>(fd))
+		{
+			return CELL_EBADF;
+		}
+
+		*status = CELL_FS_ST_NOT_INITIALIZED | CELL_FS_ST_STOP;
+		return CELL_OK;
 	}
 
-	// TODO
+	reader_lock lock(st->mutex);
+	*status = st->status;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetRegid(u32 fd, vm::ptr<u64> regid)
 {
-	cellFs.todo("cellFsStReadGetRingBuf(fd=%d, regid=*0x%x)", fd, regid);
+	cellFs.warning("cellFsStReadGetRegid(fd=%d, regid=*0x%x)", fd, regid);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	// TODO: the registration id of the streaming resource, the descriptor is unique enough here
+	*regid = fd;
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadStart(u32 fd, u64 offset, u64 size)
 {
-	cellFs.todo("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
+	cellFs.warning("cellFsStReadStart(fd=%d, offset=0x%llx, size=0x%llx)", fd, offset, size);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	const u64 file_size = st->file->file.size();
+
+	{
+		std::lock_guard lock(st->mutex);
+
+		if (st->status & CELL_FS_ST_PROGRESS)
+		{
+			return CELL_EBUSY;
+		}
+
+		st->gen++;
+		st->status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_PROGRESS;
+		st->file_pos = std::min(offset, file_size);
+		st->file_end = std::min(file_size - st->file_pos, size) + st->file_pos;
+		st->head = 0;
+		st->tail = 0;
+		st->notify_waiters();
+	}
+
+	thread_ctrl::notify(*st->thread);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadStop(u32 fd)
 {
-	cellFs.todo("cellFsStReadStop(fd=%d)", fd);
+	cellFs.warning("cellFsStReadStop(fd=%d)", fd);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	std::lock_guard lock(st->mutex);
+
+	st->gen++;
+	st->status = CELL_FS_ST_INITIALIZED | CELL_FS_ST_STOP;
+	st->notify_waiters();
 
 	return CELL_OK;
 }
 
 s32 cellFsStRead(u32 fd, vm::ptr<u8> buf, u64 size, vm::ptr<u64> rsize)
 {
-	cellFs.todo("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
+	cellFs.trace("cellFsStRead(fd=%d, buf=*0x%x, size=0x%llx, rsize=*0x%x)", fd, buf, size, rsize);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	{
+		std::lock_guard lock(st->mutex);
+
+		const u64 count = std::min(size, st->avail());
+		const u64 off = st->tail % st->ring_size;
+		const u64 first = std::min(count, st->ring_size - off);
+
+		std::memcpy(buf.get_ptr(), vm::base(st->addr + static_cast<u32>(off)), first);
+		std::memcpy(buf.get_ptr() + first, vm::base(st->addr), count - first);
+
+		st->tail += count;
+		*rsize = count;
+	}
+
+	thread_ctrl::notify(*st->thread);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadGetCurrentAddr(u32 fd, vm::ptr<u32> addr, vm::ptr<u64> size)
 {
-	cellFs.todo("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
+	cellFs.trace("cellFsStReadGetCurrentAddr(fd=%d, addr=*0x%x, size=*0x%x)", fd, addr, size);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	reader_lock lock(st->mutex);
+
+	// Only the contiguous part, the rest follows from the start of the ring buffer
+	const u64 off = st->tail % st->ring_size;
+	*addr = st->addr + static_cast<u32>(off);
+	*size = std::min(st->avail(), st->ring_size - off);
 
 	return CELL_OK;
 }
 
 s32 cellFsStReadPutCurrentAddr(u32 fd, vm::ptr<u8> addr, u64 size)
 {
-	cellFs.todo("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
+	cellFs.trace("cellFsStReadPutCurrentAddr(fd=%d, addr=*0x%x, size=0x%llx)", fd, addr, size);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	{
+		std::lock_guard lock(st->mutex);
+
+		if (addr.addr() != st->addr + st->tail % st->ring_size || size > st->avail())
+		{
+			return CELL_EINVAL;
+		}
+
+		st->tail += size;
+	}
+
+	thread_ctrl::notify(*st->thread);
 
 	return CELL_OK;
 }
 
-s32 cellFsStReadWait(u32 fd, u64 size)
+s32 cellFsStReadWait(ppu_thread& ppu, u32 fd, u64 size)
 {
-	cellFs.todo("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
+	cellFs.trace("cellFsStReadWait(fd=%d, size=0x%llx)", fd, size);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto st = fxm::get_always<fs_st_manager>()->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	{
+		std::lock_guard lock(st->mutex);
+
+		if (size > st->ring_size || st->waiter)
+		{
+			return CELL_EINVAL;
+		}
+
+		if (st->avail() >= size || st->finished())
+		{
+			return CELL_OK;
+		}
+
+		st->waiter = &ppu;
+		st->wait_size = size;
+		lv2_obj::sleep(ppu);
+	}
+
+	while (!ppu.state.test_and_reset(cpu_flag::signal))
+	{
+		if (ppu.is_stopped())
+		{
+			std::lock_guard lock(st->mutex);
+
+			if (st->waiter == &ppu)
+			{
+				st->waiter = nullptr;
+			}
+
+			return 0;
+		}
+
+		thread_ctrl::wait();
+	}
 
 	return CELL_OK;
 }
 
-s32 cellFsStReadWaitCallback(u32 fd, u64 size, vm::ptr<void(s32 xfd, u64 xsize)> func)
+s32 cellFsStReadWaitCallback(ppu_thread& ppu, u32 fd, u64 size, vm::ptr<void(s32 xfd, u64 xsize)> func)
 {
-	cellFs.todo("cellFsStReadWaitCallback(fd=%d, size=0x%llx, func=*0x%x)", fd, size, func);
+	cellFs.warning("cellFsStReadWaitCallback(fd=%d, size=0x%llx, func=*0x%x)", fd, size, func);
 
-	const auto file = idm::get<lv2_fs_object, lv2_file>(fd);
+	const auto m = fxm::get_always<fs_st_manager>();
+	const auto st = m->get(fd);
 
-	if (!file)
+	if (!st)
 	{
 		return CELL_EBADF;
 	}
 
-	// TODO
+	std::shared_ptr<named_thread<ppu_thread>> thread;
+	{
+		std::lock_guard lock(m->mutex);
+
+		if (!m->thread)
+		{
+			m->thread = fs_make_callback_thread(ppu, "_fs_st_cb_thread");
+		}
+
+		thread = m->thread;
+	}
+
+	std::lock_guard lock(st->mutex);
+
+	if (size > st->ring_size || st->cb_func)
+	{
+		return CELL_EINVAL;
+	}
+
+	st->cb_thread = std::move(thread);
+	st->cb_func = func;
+	st->cb_size = size;
+	st->notify_waiters();
 
 	return CELL_OK;
 }
 
 using fs_aio_cb_t = vm::ptr<void(vm::ptr<CellFsAio> xaio, s32 error, s32 xid, u64 size)>;
 
-// temporarily
-struct lv2_fs_mount_point
+atomic_t<s32> g_fs_aio_id;
+
+struct fs_aio_request
 {
-	std::mutex mutex;
+	u32 type; // 1 = read, 2 = write
+	s32 xid;
+	u32 fd;
+	vm::ptr<CellFsAio> aio;
+	fs_aio_cb_t func;
+	u64 seq;
 };
 
-struct fs_aio_thread : ppu_thread
+struct fs_aio_manager
 {
-	using ppu_thread::ppu_thread;
+	// Host workers, requests for different files are processed concurrently
+	static constexpr u32 worker_count = 4;
 
-	void non_task()
+	struct worker
 	{
-		while (cmd64 cmd = cmd_wait())
+		fs_aio_manager* manager;
+
+		void operator()();
+	};
+
+	// Guest thread running the callbacks, created with the priority of the cellFsAioInit caller
+	const std::shared_ptr<named_thread<ppu_thread>> thread;
+
+	shared_mutex mutex;
+	std::deque<fs_aio_request> queue;
+
+	// Files with a request in flight, requests for the same file keep their submission order
+	std::vector<u32> busy;
+
+	// Finished requests waiting for the earlier ones, callbacks are delivered in submission order
+	std::map<u64, std::tuple<vm::ptr<CellFsAio>, s32, s32, u64, fs_aio_cb_t>> done;
+	u64 next_seq = 0;
+	u64 next_done = 0;
+
+	std::vector<std::unique_ptr<named_thread<worker>>> workers;
+
+	fs_aio_manager(std::shared_ptr<named_thread<ppu_thread>> thread)
+		: thread(std::move(thread))
+	{
+		for (u32 i = 0; i < worker_count; i++)
 		{
-			const u32 type = cmd.arg1<u32>();
-			const s32 xid = cmd.arg2<s32>();
-			const cmd64 cmd2 = cmd_get(1);
-			const auto aio = cmd2.arg1<vm::ptr<CellFsAio>>();
-			const auto func = cmd2.arg2<fs_aio_cb_t>();
-			cmd_pop(1);
+			workers.emplace_back(std::make_unique<named_thread<worker>>(fmt::format("FS AIO Worker %u", i), worker{this}));
+		}
+	}
 
-			s32 error = CELL_OK;
-			u64 result = 0;
+	~fs_aio_manager()
+	{
+		workers.clear();
+	}
 
-			const auto file = idm::get<lv2_fs_object, lv2_file>(aio->fd);
+	bool claim(fs_aio_request& out)
+	{
+		std::lock_guard lock(mutex);
 
-			if (!file || (type == 1 && file->flags & CELL_FS_O_WRONLY) || (type == 2 && !(file->flags & CELL_FS_O_ACCMODE)))
+		for (auto it = queue.begin(); it != queue.end(); it++)
+		{
+			if (std::find(busy.begin(), busy.end(), it->fd) == busy.end())
 			{
-				error = CELL_EBADF;
+				out = *it;
+				busy.push_back(it->fd);
+				queue.erase(it);
+				return true;
 			}
-			else
-			{
-				std::lock_guard lock(file->mp->mutex);
+		}
 
-				const auto old_pos = file->file.pos(); file->file.seek(aio->offset);
+		return false;
+	}
 
-				result = type == 2
-					? file->op_write(aio->buf, aio->size)
-					: file->op_read(aio->buf, aio->size);
+	// Must be called with the mutex locked
+	void complete(const fs_aio_request& req, s32 error, u64 result)
+	{
+		done.emplace(req.seq, std::make_tuple(req.aio, error, req.xid, result, req.func));
 
-				file->file.seek(old_pos);
+		for (auto it = done.begin(); it != done.end() && it->first == next_done; it = done.erase(it), next_done++)
+		{
+			const auto& [aio, err, xid, size, func] = it->second;
+
+			thread->cmd_list
+			({
+				{ ppu_cmd::set_args, 4 }, u64{aio.addr()}, static_cast<u64>(s64{err}), static_cast<u64>(s64{xid}), u64{size},
+				{ ppu_cmd::lle_call, func.addr() },
+				{ ppu_cmd::sleep, 0 }
+			});
+
+			thread_ctrl::notify(*thread);
+		}
+	}
+
+	void execute(const fs_aio_request& req)
+	{
+		s32 error = CELL_OK;
+		u64 result = 0;
+
+		const auto file = idm::get<lv2_fs_object, lv2_file>(req.fd);
+
+		if (!file || (req.type == 1 && file->flags & CELL_FS_O_WRONLY) || (req.type == 2 && !(file->flags & CELL_FS_O_ACCMODE)))
+		{
+			error = CELL_EBADF;
+		}
+		else
+		{
+			result = req.type == 2
+				? file->op_write_at(req.aio->offset, req.aio->buf, req.aio->size)
+				: file->op_read_at(req.aio->offset, req.aio->buf, req.aio->size);
+		}
+
+		std::lock_guard lock(mutex);
+
+		busy.erase(std::find(busy.begin(), busy.end(), req.fd));
+		complete(req, error, result);
+
+		if (!queue.empty())
+		{
+			// The request may have been holding back another one for the same file
+			for (auto& w : workers)
+			{
+				thread_ctrl::notify(*w);
 			}
+		}
+	}
 
-			func(*this, aio, error, xid, result);
-			lv2_obj::sleep(*this);
+	s32 submit(u32 type, vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
+	{
+		const s32 xid = (*id = ++g_fs_aio_id);
+
+		{
+			std::lock_guard lock(mutex);
+			queue.push_back({type, xid, aio->fd, aio, func, next_seq++});
+		}
+
+		for (auto& w : workers)
+		{
+			thread_ctrl::notify(*w);
+		}
+
+		return CELL_OK;
+	}
+
+	bool cancel(s32 xid)
+	{
+		std::lock_guard lock(mutex);
+
+		for (auto it = queue.begin(); it != queue.end(); it++)
+		{
+			if (it->xid == xid)
+			{
+				const fs_aio_request req = *it;
+				queue.erase(it);
+				complete(req, CELL_ECANCELED, 0);
+				return true;
+			}
 		}
+
+		return false;
 	}
 };
 
-struct fs_aio_manager
+void fs_aio_manager::worker::operator()()
 {
-	std::shared_ptr<fs_aio_thread> thread;
-};
+	while (thread_ctrl::state() != thread_state::aborting)
+	{
+		fs_aio_request req;
+
+		while (manager->claim(req))
+		{
+			manager->execute(req);
+		}
+
+		thread_ctrl::wait();
+	}
+}
 
-s32 cellFsAioInit(vm::cptr<char> mount_point)
+error_code cellFsAioInit(ppu_thread& ppu, vm::cptr<char> mount_point)
 {
 	cellFs.warning("cellFsAioInit(mount_point=%s)", mount_point);
 
 	// TODO: create AIO thread (if not exists) for specified mount point
-	const auto m = fxm::make<fs_aio_manager>();
+	if (fxm::check<fs_aio_manager>())
+	{
+		return CELL_OK;
+	}
 
-	fmt::throw_exception("cellFsAio disabled, use LLE.");
+	fxm::make<fs_aio_manager>(fs_make_callback_thread(ppu, "_fs_aio_thread"));
 
 	return CELL_OK;
 }
@@ -938,8 +1385,6 @@ s32 cellFsAioFinish(vm::cptr<char> mount_point)
 	return CELL_OK;
 }
 
-atomic_t<s32> g_fs_aio_id;
-
 s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 {
 	cellFs.warning("cellFsAioRead(aio=*0x%x, id=*0x%x, func=*0x%x)", aio, id, func);
@@ -953,15 +1398,7 @@ s32 cellFsAioRead(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
-
-	m->thread->cmd_list
-	({
-		{ 1, xid },
-		{ aio, func },
-	});
-
-	return CELL_OK;
+	return m->submit(1, aio, id, func);
 }
 
 s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
@@ -977,24 +1414,27 @@ s32 cellFsAioWrite(vm::ptr<CellFsAio> aio, vm::ptr<s32> id, fs_aio_cb_t func)
 		return CELL_ENXIO;
 	}
 
-	const s32 xid = (*id = ++g_fs_aio_id);
-
-	m->thread->cmd_list
-	({
-		{ 2, xid },
-		{ aio, func },
-	});
-
-	return CELL_OK;
+	return m->submit(2, aio, id, func);
 }
 
 s32 cellFsAioCancel(s32 id)
 {
-	cellFs.todo("cellFsAioCancel(id=%d) -> CELL_EINVAL", id);
+	cellFs.warning("cellFsAioCancel(id=%d)", id);
 
-	// TODO: cancelled requests return CELL_ECANCELED through their own callbacks
+	const auto m = fxm::get<fs_aio_manager>();
 
-	return CELL_EINVAL;
+	if (!m)
+	{
+		return CELL_ENXIO;
+	}
+
+	// Cancelled requests return CELL_ECANCELED through their own callbacks, started ones can't be cancelled
+	if (!m->cancel(id))
+	{
+		return CELL_EINVAL;
+	}
+
+	return CELL_OK;
 }
 
 s32 cellFsArcadeHddSerialNumber()
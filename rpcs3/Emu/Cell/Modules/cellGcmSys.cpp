@@ -1132,10 +1132,12 @@ s32 cellGcmUnmapEaIoAddress(u32 ea)
 	{
 		const u32 io = offsetTable.ioAddress[ea];
 
+		RSXIOMem.unmap(io, size);
+
 		for (u32 i = 0; i < size; i++)
 		{
-			RSXIOMem.io[ea + i].release(offsetTable.ioAddress[ea + i] = 0xFFFF);
-			RSXIOMem.ea[io + i].release(offsetTable.eaAddress[io + i] = 0xFFFF);
+			offsetTable.ioAddress[ea + i] = 0xFFFF;
+			offsetTable.eaAddress[io + i] = 0xFFFF;
 		}
 	}
 	else
@@ -1155,10 +1157,12 @@ s32 cellGcmUnmapIoAddress(u32 io)
 	{
 		const u32 ea = offsetTable.eaAddress[io];
 
+		RSXIOMem.unmap(io, size);
+
 		for (u32 i = 0; i < size; i++)
 		{
-			RSXIOMem.io[ea + i].release(offsetTable.ioAddress[ea + i] = 0xFFFF);
-			RSXIOMem.ea[io + i].release(offsetTable.eaAddress[io + i] = 0xFFFF);
+			offsetTable.ioAddress[ea + i] = 0xFFFF;
+			offsetTable.eaAddress[io + i] = 0xFFFF;
 		}
 	}
 	else
@@ -7,10 +7,134 @@
 #include <stb_image.h>
 
 #include "Emu/Cell/lv2/sys_fs.h"
+#include "Crypto/sha1.h"
 #include "cellJpgDec.h"
 
+#include <list>
+#include <mutex>
+
 LOG_CHANNEL(cellJpgDec);
 
+// Decoded images keyed by the SHA-1 of the JPG data, for titles decoding the same files repeatedly
+struct jpg_decode_cache
+{
+	static constexpr u64 max_size = 64 * 1024 * 1024;
+
+	struct entry
+	{
+		std::array<u8, 20> hash;
+		s32 width;
+		s32 height;
+		std::shared_ptr<u8> image; // RGBA as returned by stb_image
+	};
+
+	std::mutex mutex;
+	std::list<entry> entries; // Most recently used first
+	u64 size = 0;
+
+	std::shared_ptr<u8> find(const std::array<u8, 20>& hash, s32& width, s32& height)
+	{
+		std::lock_guard lock(mutex);
+
+		for (auto it = entries.begin(); it != entries.end(); it++)
+		{
+			if (it->hash == hash)
+			{
+				entries.splice(entries.begin(), entries, it);
+				width = it->width;
+				height = it->height;
+				return it->image;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void add(const std::array<u8, 20>& hash, s32 width, s32 height, const std::shared_ptr<u8>& image)
+	{
+		const u64 image_size = u64{4} * width * height;
+
+		if (image_size > max_size)
+		{
+			return;
+		}
+
+		std::lock_guard lock(mutex);
+
+		entries.push_front({hash, width, height, image});
+		size += image_size;
+
+		while (size > max_size)
+		{
+			size -= u64{4} * entries.back().width * entries.back().height;
+			entries.pop_back();
+		}
+	}
+};
+
+// Convert one row of stb_image RGBA pixels to the output colour space, replacing the alpha channel
+static void jpg_convert_row(u8* dst, const u8* src, u32 width, u32 color_space, u8 alpha)
+{
+	u32 i = 0;
+
+	switch (color_space)
+	{
+	case CELL_JPG_RGBA:
+	{
+		const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+		const __m128i alpha_v = _mm_set1_epi32(alpha << 24);
+
+		for (; i + 4 <= width; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_and_si128(v, rgb_mask), alpha_v));
+		}
+
+		for (; i < width; i++)
+		{
+			dst[i * 4 + 0] = src[i * 4 + 0];
+			dst[i * 4 + 1] = src[i * 4 + 1];
+			dst[i * 4 + 2] = src[i * 4 + 2];
+			dst[i * 4 + 3] = alpha;
+		}
+
+		break;
+	}
+	case CELL_JPG_ARGB:
+	{
+		// Shifting each little-endian pixel left by one byte makes room for the alpha in front
+		const __m128i alpha_v = _mm_set1_epi32(alpha);
+
+		for (; i + 4 <= width; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_slli_epi32(v, 8), alpha_v));
+		}
+
+		for (; i < width; i++)
+		{
+			dst[i * 4 + 0] = alpha;
+			dst[i * 4 + 1] = src[i * 4 + 0];
+			dst[i * 4 + 2] = src[i * 4 + 1];
+			dst[i * 4 + 3] = src[i * 4 + 2];
+		}
+
+		break;
+	}
+	case CELL_JPG_RGB:
+	{
+		for (; i < width; i++)
+		{
+			dst[i * 3 + 0] = src[i * 4 + 0];
+			dst[i * 3 + 1] = src[i * 4 + 1];
+			dst[i * 3 + 2] = src[i * 4 + 2];
+		}
+
+		break;
+	}
+	}
+}
+
 s32 cellJpgDecCreate(u32 mainHandle, u32 threadInParam, u32 threadOutParam)
 {
 	UNIMPLEMENTED_FUNC(cellJpgDec);
@@ -196,16 +320,31 @@ s32 cellJpgDecDecodeData(u32 mainHandle, u32 subHandle, vm::ptr<u8> data, vm::cp
 	}
 	}
 
-	//Decode JPG file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
-	int width, height, actual_components;
-	auto image = std::unique_ptr<unsigned char,decltype(&::free)>
-		(
-			stbi_load_from_memory(jpg.get(), (s32)fileSize, &width, &height, &actual_components, 4),
-			&::free
-		);
+	const auto cache = g_cfg.core.image_decode_cache ? fxm::get_always<jpg_decode_cache>() : nullptr;
+
+	std::array<u8, 20> hash;
+	int width = 0, height = 0, actual_components;
+	std::shared_ptr<u8> image;
 
+	if (cache)
+	{
+		sha1(jpg.get(), fileSize, hash.data());
+		image = cache->find(hash, width, height);
+	}
+
+	//Decode JPG file. (TODO: Is there any faster alternative? Can we do it without external libraries?)
 	if (!image)
-		return CELL_JPGDEC_ERROR_STREAM_FORMAT;
+	{
+		image.reset(stbi_load_from_memory(jpg.get(), (s32)fileSize, &width, &height, &actual_components, 4), &::free);
+
+		if (!image)
+			return CELL_JPGDEC_ERROR_STREAM_FORMAT;
+
+		if (cache)
+		{
+			cache->add(hash, width, height, image);
+		}
+	}
 
 	const bool flip = current_outParam.outputMode == CELL_JPGDEC_BOTTOM_TO_TOP;
 	const int bytesPerLine = (u32)dataCtrlParam->outputBytesPerLine;
@@ -215,64 +354,24 @@ s32 cellJpgDecDecodeData(u32 mainHandle, u32 subHandle, vm::ptr<u8> data, vm::cp
 	{
 	case CELL_JPG_RGB:
 	case CELL_JPG_RGBA:
-	{
-		const char nComponents = current_outParam.outputColorSpace == CELL_JPG_RGBA ? 4 : 3;
-		image_size *= nComponents;
-		if (bytesPerLine > width * nComponents || flip) //check if we need padding
-		{
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * (flip ? height - i - 1 : i);
-				memcpy(&data[dstOffset], &image.get()[srcOffset], linesize);
-			}
-		}
-		else
-		{
-			memcpy(data.get_ptr(), image.get(), image_size);
-		}
-	}
-	break;
-
 	case CELL_JPG_ARGB:
 	{
-		const int nComponents = 4;
+		const int nComponents = current_outParam.outputColorSpace == CELL_JPG_RGB ? 3 : 4;
+		const int linesize = std::min(bytesPerLine, width * nComponents);
 		image_size *= nComponents;
-		if (bytesPerLine > width * nComponents || flip) //check if we need padding
+
+		if (!flip && current_outParam.outputColorSpace == CELL_JPG_RGBA && subHandle_data->outputColorAlpha == 0xff && bytesPerLine == width * 4)
 		{
-			//TODO: Find out if we can't do padding without an extra copy
-			const int linesize = std::min(bytesPerLine, width * nComponents);
-			char *output = (char *) malloc(linesize);
-			for (int i = 0; i < height; i++)
-			{
-				const int dstOffset = i * bytesPerLine;
-				const int srcOffset = width * nComponents * (flip ? height - i - 1 : i);
-				for (int j = 0; j < linesize; j += nComponents)
-				{
-					output[j + 0] = image.get()[srcOffset + j + 3];
-					output[j + 1] = image.get()[srcOffset + j + 0];
-					output[j + 2] = image.get()[srcOffset + j + 1];
-					output[j + 3] = image.get()[srcOffset + j + 2];
-				}
-				memcpy(&data[dstOffset], output, linesize);
-			}
-			free(output);
+			// stb_image already produced the exact output
+			std::memcpy(data.get_ptr(), image.get(), image_size);
+			break;
 		}
-		else
+
+		for (int i = 0; i < height; i++)
 		{
-			uint* img = (uint*)new char[image_size];
-			uint* source_current = (uint*)&(image.get()[0]);
-			uint* dest_current = img;
-			for (uint i = 0; i < image_size / nComponents; i++)
-			{
-				uint val = *source_current;
-				*dest_current = (val >> 24) | (val << 8); // set alpha (A8) as leftmost byte
-				source_current++;
-				dest_current++;
-			}
-			memcpy(data.get_ptr(), img, image_size);
-			delete[] img;
+			const int dstOffset = i * bytesPerLine;
+			const int srcOffset = width * 4 * (flip ? height - i - 1 : i);
+			jpg_convert_row(&data[dstOffset], image.get() + srcOffset, linesize / nComponents, current_outParam.outputColorSpace, subHandle_data->outputColorAlpha);
 		}
 	}
 	break;
@@ -340,6 +439,7 @@ s32 cellJpgDecSetParameter(u32 mainHandle, u32 subHandle, vm::cptr<CellJpgDecInP
 
 	current_outParam.outputMode     = inParam->outputMode;
 	current_outParam.downScale      = inParam->downScale;
+	subHandle_data->outputColorAlpha = inParam->outputColorAlpha;
 	current_outParam.useMemorySpace = 0; // Unimplemented
 
 	*outParam = current_outParam;
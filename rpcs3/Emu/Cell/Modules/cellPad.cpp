@@ -125,6 +125,11 @@ error_code cellPadGetData(u32 port_no, vm::ptr<CellPadData> data)
 	if (port_no >= config->max_connect)
 		return CELL_PAD_ERROR_NO_DEVICE;
 
+	if (port_no == 0)
+	{
+		handler->NotifySampled();
+	}
+
 	const auto pad = pads[port_no];
 	const auto setting = config->port_setting[port_no];
 
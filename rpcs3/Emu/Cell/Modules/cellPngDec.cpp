@@ -4,9 +4,13 @@
 #include "Emu/Cell/PPUModule.h"
 
 #include "Emu/Cell/lv2/sys_fs.h"
+#include "Crypto/sha1.h"
 #include "png.h"
 #include "cellPngDec.h"
 
+#include <list>
+#include <mutex>
+
 #if PNG_LIBPNG_VER_MAJOR >= 1 && (PNG_LIBPNG_VER_MINOR < 5 \
 || (PNG_LIBPNG_VER_MINOR == 5 && PNG_LIBPNG_VER_RELEASE < 7))
 #define PNG_ERROR_ACTION_NONE 1
@@ -45,6 +49,60 @@ using PCbControlDisp     = vm::cptr<CellPngDecCbCtrlDisp>;
 using PCbControlStream   = vm::cptr<CellPngDecCbCtrlStrm>;
 using PDispParam         = vm::ptr<CellPngDecDispParam>;
 
+// Decoded images keyed by the SHA-1 of the PNG data and the output parameters
+struct png_decode_cache
+{
+	static constexpr u64 max_size = 64 * 1024 * 1024;
+
+	struct entry
+	{
+		std::array<u8, 20> hash;
+		u32 num_text;
+		u32 chunk_information;
+		u32 num_unknown_chunks;
+		std::vector<u8> pixels; // Rows from top to bottom, outputWidthByte each
+	};
+
+	std::mutex mutex;
+	std::list<std::shared_ptr<const entry>> entries; // Most recently used first
+	u64 size = 0;
+
+	std::shared_ptr<const entry> find(const std::array<u8, 20>& hash)
+	{
+		std::lock_guard lock(mutex);
+
+		for (auto it = entries.begin(); it != entries.end(); it++)
+		{
+			if ((*it)->hash == hash)
+			{
+				entries.splice(entries.begin(), entries, it);
+				return *it;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void add(std::shared_ptr<const entry> image)
+	{
+		if (image->pixels.size() > max_size)
+		{
+			return;
+		}
+
+		std::lock_guard lock(mutex);
+
+		size += image->pixels.size();
+		entries.emplace_front(std::move(image));
+
+		while (size > max_size)
+		{
+			size -= entries.back()->pixels.size();
+			entries.pop_back();
+		}
+	}
+};
+
 // Custom read function for libpng, so we could decode images from a buffer
 void pngDecReadBuffer(png_structp png_ptr, png_bytep out, png_size_t length)
 {
@@ -537,6 +595,38 @@ s32 pngDecClose(ppu_thread& ppu, PHandle handle, PStream stream)
 	return CELL_OK;
 }
 
+// Hash the whole PNG data together with every parameter that selects a libpng transform
+std::array<u8, 20> pngDecHashImage(PngStream* stream)
+{
+	sha1_context ctx;
+	sha1_starts(&ctx);
+
+	if (stream->buffer->file)
+	{
+		const auto file = idm::get<lv2_fs_object, lv2_file>(stream->buffer->fd);
+		const auto view = file->file.map();
+		sha1_update(&ctx, view.data(), view.size());
+	}
+	else
+	{
+		sha1_update(&ctx, static_cast<const u8*>(stream->source.streamPtr.get_ptr()), stream->source.streamSize);
+	}
+
+	const u32 params[]
+	{
+		static_cast<u32>(stream->out_param.outputColorSpace),
+		stream->out_param.outputBitDepth,
+		static_cast<u32>(stream->alphaSelect),
+		stream->colorAlpha,
+	};
+
+	sha1_update(&ctx, reinterpret_cast<const u8*>(params), sizeof(params));
+
+	std::array<u8, 20> hash;
+	sha1_finish(&ctx, hash.data());
+	return hash;
+}
+
 void pngSetHeader(PngStream* stream)
 {
 	stream->info.imageWidth = png_get_image_width(stream->png_ptr, stream->info_ptr);
@@ -641,6 +731,8 @@ s32 pngDecSetParameter(PStream stream, PInParam in_param, POutParam out_param, P
 	stream->out_param.outputComponents = png_get_channels(stream->png_ptr, stream->info_ptr);
 
 	stream->packing = in_param->outputPackFlag;
+	stream->alphaSelect = in_param->outputAlphaSelect;
+	stream->colorAlpha = in_param->outputColorAlpha;
 
 	// Set the memory usage. We currently don't actually allocate memory for libpng through the callbacks, due to libpng needing a lot more memory compared to PS3 variant.
 	stream->out_param.useMemorySpace = 0;
@@ -688,8 +780,18 @@ s32 pngDecodeData(ppu_thread& ppu, PHandle handle, PStream stream, vm::ptr<u8> d
 		fmt::throw_exception("Bytes per line less than expected output! Got: %d, expected: %d" HERE, bytes_per_line, stream->out_param.outputWidthByte);
 	}
 
+	// Check if the image needs to be flipped
+	const bool flip = stream->out_param.outputMode == CELL_PNGDEC_BOTTOM_TO_TOP;
+	const u32 height = stream->out_param.outputHeight;
+	const u32 width_byte = static_cast<u32>(stream->out_param.outputWidthByte);
+
+	// Only whole image decodes go through the cache
+	const bool partial = cb_control_disp && stream->outputCounts > 0;
+	const auto cache = g_cfg.core.image_decode_cache && !partial ? fxm::get_always<png_decode_cache>() : nullptr;
+	std::array<u8, 20> hash;
+
 	// partial decoding
-	if (cb_control_disp && stream->outputCounts > 0)
+	if (partial)
 	{
 		// get data from cb
 		auto streamInfo = vm::ptr<CellPngDecStrmInfo>::make(handle->malloc_(ppu, sizeof(CellPngDecStrmInfo), handle->malloc_arg).addr());
@@ -762,21 +864,39 @@ s32 pngDecodeData(ppu_thread& ppu, PHandle handle, PStream stream, vm::ptr<u8> d
 	}
 	else
 	{
-		// Check if the image needs to be flipped
-		const bool flip = stream->out_param.outputMode == CELL_PNGDEC_BOTTOM_TO_TOP;
-
-		// Decode the image
-		// todo: commandptr
-		try
+		if (cache)
 		{
-			for (int j = 0; j < stream->passes; j++)
+			hash = pngDecHashImage(stream.get_ptr());
+
+			if (const auto image = cache->find(hash))
 			{
-				for (int i = 0; i < stream->out_param.outputHeight; ++i)
+				for (u32 i = 0; i < height; i++)
 				{
-					const u32 line = flip ? stream->out_param.outputHeight - i - 1 : i;
-					png_read_row(stream->png_ptr, &data[line*bytes_per_line], nullptr);
+					const u32 line = flip ? height - i - 1 : i;
+					std::memcpy(&data[line * bytes_per_line], image->pixels.data() + u64{i} * width_byte, width_byte);
 				}
+
+				data_out_info->numText = image->num_text;
+				data_out_info->chunkInformation = image->chunk_information;
+				data_out_info->numUnknownChunk = image->num_unknown_chunks;
+				data_out_info->status = CELL_PNGDEC_DEC_STATUS_FINISH;
+				return CELL_OK;
 			}
+		}
+
+		// Decode the whole image at once, libpng runs the interlace passes over the row table itself
+		// todo: commandptr
+		std::vector<png_bytep> rows(height);
+
+		for (u32 i = 0; i < height; i++)
+		{
+			const u32 line = flip ? height - i - 1 : i;
+			rows[i] = &data[line * bytes_per_line];
+		}
+
+		try
+		{
+			png_read_image(stream->png_ptr, rows.data());
 			png_read_end(stream->png_ptr, stream->info_ptr);
 		}
 		catch (LibPngCustomException&)
@@ -795,6 +915,24 @@ s32 pngDecodeData(ppu_thread& ppu, PHandle handle, PStream stream, vm::ptr<u8> d
 	const int num_unknowns = png_get_unknown_chunks(stream->png_ptr, stream->info_ptr, &unknowns);
 	data_out_info->numUnknownChunk = num_unknowns;
 
+	if (cache)
+	{
+		auto image = std::make_shared<png_decode_cache::entry>();
+		image->hash = hash;
+		image->num_text = text_chunks;
+		image->chunk_information = data_out_info->chunkInformation;
+		image->num_unknown_chunks = num_unknowns;
+		image->pixels.resize(u64{height} * width_byte);
+
+		for (u32 i = 0; i < height; i++)
+		{
+			const u32 line = flip ? height - i - 1 : i;
+			std::memcpy(image->pixels.data() + u64{i} * width_byte, &data[line * bytes_per_line], width_byte);
+		}
+
+		cache->add(std::move(image));
+	}
+
 	// Indicate that the decoding succeeded
 	data_out_info->status = CELL_PNGDEC_DEC_STATUS_FINISH;
 
@@ -304,6 +304,10 @@ struct PngStream
 	be_t<s32> packing;
 	u32 passes;
 
+	// Alpha parameters, only kept to identify the decoded image in the cache
+	be_t<s32> alphaSelect;
+	be_t<u32> colorAlpha;
+
 	// PNG custom read function structure, for decoding from a buffer
 	vm::ptr<PngBuffer> buffer;
 
@@ -91,6 +91,78 @@ vm::gvar<savedata_context> g_savedata_context;
 
 std::mutex g_savedata_mutex;
 
+// Save data commits running in background (waited for before save data is accessed again)
+static worker_pool::group& savedata_commits()
+{
+	// Construct the pool first so that it outlives the group
+	worker_pool::get();
+	static worker_pool::group s_group;
+	return s_group;
+}
+
+// Called by Emulator::Stop, the game was told these saves succeeded
+void savedata_wait_commits()
+{
+	savedata_commits().wait();
+}
+
+// Write staged files to the temporary directory, then swap it with the save directory
+static void savedata_commit(const std::map<std::string, std::vector<uchar>>& files, const std::map<std::string, std::pair<s64, s64>>& times,
+	const std::string& dir_path, const std::string& old_path, const std::string& new_path)
+{
+	// First, create temporary directory
+	if (fs::create_dir(new_path) || fs::g_tls_error == fs::error::exist)
+	{
+		fs::remove_all(new_path, false);
+	}
+	else
+	{
+		cellSaveData.fatal("Failed to create directory %s (%s)", new_path, fs::g_tls_error);
+		return;
+	}
+
+	// Write all files in temporary directory, make them durable before the old data is replaced
+	for (auto&& pair : files)
+	{
+		fs::file file(new_path + pair.first, fs::rewrite);
+
+		if (!file || file.write(pair.second.data(), pair.second.size()) != pair.second.size())
+		{
+			cellSaveData.fatal("Failed to write %s%s (%s)", new_path, pair.first, fs::g_tls_error);
+			return;
+		}
+
+		file.sync();
+	}
+
+	for (auto&& pair : times)
+	{
+		// Restore atime/mtime for files which have not been modified
+		fs::utime(new_path + pair.first, pair.second.first, pair.second.second);
+	}
+
+	// Remove old backup
+	fs::remove_all(old_path, false);
+
+	// Backup old savedata (the swap must complete even if the emulator is stopping)
+	if (!vfs::host::rename(dir_path, old_path, true, false))
+	{
+		cellSaveData.fatal("Failed to move directory %s (%s)", dir_path, fs::g_tls_error);
+		return;
+	}
+
+	// Commit new savedata
+	if (!vfs::host::rename(new_path, dir_path, false, false))
+	{
+		// TODO: handle the case when only commit failed at the next save load
+		cellSaveData.fatal("Failed to move directory %s (%s)", new_path, fs::g_tls_error);
+		return;
+	}
+
+	// Remove backup again (TODO: may be changed to persistent backup implementation)
+	fs::remove_all(old_path);
+}
+
 static bool savedata_check_args(u32 operation, u32 version, vm::cptr<char> dirName,
 	u32 errDialog, PSetList setList, PSetBuf setBuf, PFuncList funcList, PFuncFixed funcFixed, PFuncStat funcStat,
 	PFuncFile funcFile, u32 container, u32 unk_op_flags, vm::ptr<void> userdata, u32 userId, PFuncDone funcDone)
@@ -256,6 +328,9 @@ static NEVER_INLINE error_code savedata_op(ppu_thread& ppu, u32 operation, u32 v
 		return CELL_SAVEDATA_ERROR_BUSY;
 	}
 
+	// Previous save must be on disk before the directories are listed or read
+	savedata_commits().wait();
+
 	// Simulate idle time while data is being sent to VSH
 	const auto lv2_sleep = [](ppu_thread& ppu, size_t sleep_time)
 	{
@@ -1091,54 +1166,27 @@ static NEVER_INLINE error_code savedata_op(ppu_thread& ppu, u32 operation, u32 v
 	// Write PARAM.SFO and savedata
 	if (!psf.empty() && has_modified)
 	{
-		// First, create temporary directory
-		if (fs::create_dir(new_path) || fs::g_tls_error == fs::error::exist)
-		{
-			fs::remove_all(new_path, false);
-		}
-		else
-		{
-			fmt::throw_exception("Failed to create directory %s (%s)", new_path, fs::g_tls_error);
-		}
-
-		// Write all files in temporary directory
 		auto& fsfo = all_files["PARAM.SFO"];
 		fsfo = fs::make_stream<std::vector<uchar>>();
 		psf::save_object(fsfo, psf);
 
+		// Take the staged file contents
+		auto files = std::make_shared<std::map<std::string, std::vector<uchar>>>();
+
 		for (auto&& pair : all_files)
 		{
 			if (auto file = pair.second.release())
 			{
-				auto fvec = static_cast<fs::container_stream<std::vector<uchar>>&>(*file);
-				fs::file(new_path + pair.first, fs::rewrite).write(fvec.obj);
+				auto& fvec = static_cast<fs::container_stream<std::vector<uchar>>&>(*file);
+				files->emplace(pair.first, std::move(fvec.obj));
 			}
 		}
 
-		for (auto&& pair : all_times)
-		{
-			// Restore atime/mtime for files which have not been modified
-			fs::utime(new_path + pair.first, pair.second.first, pair.second.second);
-		}
-
-		// Remove old backup
-		fs::remove_all(old_path, false);
-
-		// Backup old savedata
-		if (!vfs::host::rename(dir_path, old_path, true))
-		{
-			fmt::throw_exception("Failed to move directory %s (%s)", dir_path, fs::g_tls_error);
-		}
-
-		// Commit new savedata
-		if (!vfs::host::rename(new_path, dir_path, false))
+		// Commit the whole directory in background, the game doesn't wait for host I/O
+		worker_pool::get().submit(worker_priority::background, [files, times = std::move(all_times), dir_path, old_path, new_path]
 		{
-			// TODO: handle the case when only commit failed at the next save load
-			fmt::throw_exception("Failed to move directory %s (%s)", new_path, fs::g_tls_error);
-		}
-
-		// Remove backup again (TODO: may be changed to persistent backup implementation)
-		fs::remove_all(old_path);
+			savedata_commit(*files, times, dir_path, old_path, new_path);
+		}, &savedata_commits());
 	}
 
 	return CELL_OK;
@@ -1153,6 +1201,8 @@ static NEVER_INLINE error_code savedata_get_list_item(vm::cptr<char> dirName, vm
 	std::string save_path = vfs::get(fmt::format("/dev_hdd0/home/%08u/savedata/%s/", userId, dirName.get_ptr()));
 	std::string sfo = save_path + "PARAM.SFO";
 
+	savedata_commits().wait();
+
 	if (!fs::is_dir(save_path) && !fs::is_file(sfo))
 	{
 		cellSaveData.error("cellSaveDataGetListItem(): Savedata at %s does not exist", dirName);
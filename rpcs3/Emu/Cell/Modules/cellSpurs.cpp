@@ -47,6 +47,9 @@ namespace _spurs
 	// Check whether libprof is loaded
 	bool is_libprof_loaded();
 
+	// Wake up SPURS kernels waiting for the lock line reservation lost event on the workload state
+	void notify_kernels(vm::ptr<CellSpurs> spurs);
+
 	// Create an LV2 event queue and attach it to the SPURS instance
 	s32 create_lv2_eq(ppu_thread& ppu, vm::ptr<CellSpurs> spurs, vm::ptr<u32> queueId, vm::ptr<u8> port, s32 size, const sys_event_queue_attribute_t& name);
 
@@ -367,6 +370,12 @@ bool _spurs::is_libprof_loaded()
 	return false;
 }
 
+void _spurs::notify_kernels(vm::ptr<CellSpurs> spurs)
+{
+	// Ready counts, signals, the workload flag and the system service message share the first line
+	vm::reservation_notifier(spurs.addr(), 128).notify_all();
+}
+
 //----------------------------------------------------------------------------
 // SPURS core functions
 //----------------------------------------------------------------------------
@@ -1682,6 +1691,7 @@ s32 cellSpursSetPriorities(vm::ptr<CellSpurs> spurs, u32 wid, vm::cptr<u8> prior
 
 	spurs->sysSrvMsgUpdateWorkload = 0xff;
 	spurs->sysSrvMessage = 0xff;
+	_spurs::notify_kernels(spurs);
 	return CELL_OK;
 }
 
@@ -1829,6 +1839,7 @@ void _spurs::trace_status_update(ppu_thread& ppu, vm::ptr<CellSpurs> spurs)
 	if (init)
 	{
 		spurs->sysSrvMessage = 0xff;
+		_spurs::notify_kernels(spurs);
 		CHECK_SUCCESS(sys_semaphore_wait(ppu, (u32)spurs->semPrv, 0));
 	}
 }
@@ -2262,6 +2273,7 @@ s32 _spurs::add_workload(vm::ptr<CellSpurs> spurs, vm::ptr<u32> wid, vm::cptr<vo
 	spurs->wklState(wnum).exchange(2);
 	spurs->sysSrvMsgUpdateWorkload.exchange(0xff);
 	spurs->sysSrvMessage.exchange(0xff);
+	_spurs::notify_kernels(spurs);
 	return CELL_OK;
 }
 
@@ -2397,6 +2409,7 @@ s32 cellSpursSendWorkloadSignal(vm::ptr<CellSpurs> spurs, u32 wid)
 		spurs->wklSignal1 |= 0x8000 >> wid;
 	}
 
+	_spurs::notify_kernels(spurs);
 	return CELL_OK;
 }
 
@@ -2458,6 +2471,7 @@ s32 cellSpursReadyCountStore(vm::ptr<CellSpurs> spurs, u32 wid, u32 value)
 		spurs->wklIdleSpuCountOrReadyCount2[wid].exchange((u8)value);
 	}
 
+	_spurs::notify_kernels(spurs);
 	return CELL_OK;
 }
 
@@ -2617,6 +2631,8 @@ s32 _cellSpursWorkloadFlagReceiver(vm::ptr<CellSpurs> spurs, u32 wid, u32 is_set
 			}
 		}
 	});
+
+	_spurs::notify_kernels(spurs);
 	return CELL_OK;
 }
 
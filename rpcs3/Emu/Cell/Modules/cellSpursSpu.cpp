@@ -764,6 +764,11 @@ void spursSysServiceIdleHandler(spu_thread& spu, SpursKernelContext* ctxt)
 		//vm::reservation_acquire(vm::base(spu.offset + 0x100), vm::cast(ctxt->spurs.addr(), HERE), 128);
 		auto spurs = vm::_ptr<CellSpurs>(spu.offset + 0x100);
 
+		// Snapshot of the lock line the idle wait below depends on
+		std::memcpy(vm::base(spu.offset + 0x100), vm::base(ctxt->spurs.addr()), 128);
+		decltype(spu_thread::rdata) line;
+		std::memcpy(&line, vm::base(ctxt->spurs.addr()), 128);
+
 		// Find the number of SPUs that are idling in this SPURS instance
 		u32 nIdlingSpus = 0;
 		for (u32 i = 0; i < 8; i++)
@@ -842,11 +847,39 @@ void spursSysServiceIdleHandler(spu_thread& spu, SpursKernelContext* ctxt)
 			spurs->spuIdling |= 1 << ctxt->spuNum;
 		}
 
+		// Also update the idle mask in main memory (the lock line is refreshed on every iteration)
+		// Store it under the reservation lock like an SPU DMA put, so it doesn't race with atomic updates of the line
+		if (const u8 bit = 1 << ctxt->spuNum; (ctxt->spurs->spuIdling ^ spurs->spuIdling) & bit)
+		{
+			auto& res = vm::reservation_lock(ctxt->spurs.ptr(&CellSpurs::spuIdling).addr(), 1);
+			ctxt->spurs->spuIdling ^= bit;
+			res.release(res.load() + 127);
+		}
+
 		// If all SPUs are idling and the exit_if_no_work flag is set then the SPU thread group must exit. Otherwise wait for external events.
 		if (spuIdling && shouldExit == false && foundReadyWorkload == false)
 		{
 			// The system service blocks by making a reservation and waiting on the lock line reservation lost event.
-			thread_ctrl::wait_for(1000);
+			// Park the thread until the PPU side notifies a change (cellSpursSendWorkloadSignal, ready counts, etc.), the timeout covers plain stores.
+			if (const auto lock = vm::reservation_notifier(ctxt->spurs.addr(), 128).try_shared_lock())
+			{
+				if (std::memcmp(&line, vm::base(ctxt->spurs.addr()), 128) == 0 && !spu.is_stopped())
+				{
+					spu.state += cpu_flag::wait;
+					lock.wait(10000);
+					spu.check_state();
+				}
+			}
+			else
+			{
+				thread_ctrl::wait_for(1000);
+			}
+
+			if (spu.is_stopped())
+			{
+				return;
+			}
+
 			continue;
 		}
 
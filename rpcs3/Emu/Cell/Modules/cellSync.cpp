@@ -6,6 +6,8 @@
 #include "Emu/Cell/lv2/sys_process.h"
 #include "cellSync.h"
 
+#include <thread>
+
 LOG_CHANNEL(cellSync);
 
 template<>
@@ -40,6 +42,110 @@ void fmt_class_string<CellSyncError>::format(std::string& out, u64 arg)
 	});
 }
 
+namespace
+{
+	// Blocking wait statistics shared by all primitives, reported when the emulation stops
+	struct sync_wait_stats
+	{
+		atomic_t<u64> spin_acquired{0};
+		atomic_t<u64> slept{0};
+		atomic_t<u64> sleep_us{0};
+
+		// Spin rounds before sleeping, grows when spinning succeeds and shrinks when it doesn't
+		atomic_t<u32> spin_limit{64};
+
+		~sync_wait_stats()
+		{
+			if (spin_acquired || slept)
+			{
+				cellSync.notice("Blocking waits: %u acquired while spinning, %u slept for %u us in total (spin limit %u)", spin_acquired.load(), slept.load(), sleep_us.load(), spin_limit.load());
+			}
+		}
+	};
+
+	// Backoff for the blocking functions, to be called after each failed attempt.
+	// Spins briefly, then sleeps on the reservation notifier of the primitive, which is signalled by SPU/PPU conditional stores
+	// and by the releasing functions below. The timeout covers plain stores, and other lines sharing the notifier.
+	class sync_waiter
+	{
+		ppu_thread& m_ppu;
+		const u32 m_addr;
+		u32 m_round = 0;
+		u32 m_spin = 0;
+		u64 m_sleep_start = 0;
+		std::shared_ptr<sync_wait_stats> m_stats;
+
+	public:
+		sync_waiter(ppu_thread& ppu, u32 addr)
+			: m_ppu(ppu)
+			, m_addr(addr)
+		{
+		}
+
+		sync_waiter(const sync_waiter&) = delete;
+
+		~sync_waiter()
+		{
+			if (!m_stats)
+			{
+				return;
+			}
+
+			if (!m_sleep_start)
+			{
+				m_stats->spin_acquired++;
+				m_stats->spin_limit.fetch_op([](u32& v) { v = std::min<u32>(v * 2, 1024); });
+			}
+			else
+			{
+				m_stats->slept++;
+				m_stats->sleep_us += get_system_time() - m_sleep_start;
+				m_stats->spin_limit.fetch_op([](u32& v) { v = std::max<u32>(v / 2, 8); });
+			}
+		}
+
+		// Returns false if the thread must stop
+		bool wait()
+		{
+			if (!m_stats)
+			{
+				m_stats = fxm::get_always<sync_wait_stats>();
+				m_spin = m_stats->spin_limit;
+			}
+
+			if (m_round++ < m_spin)
+			{
+				busy_wait(300);
+				return !m_ppu.test_stopped();
+			}
+
+			if (!m_sleep_start)
+			{
+				m_sleep_start = get_system_time();
+			}
+
+			// The slot is only held while sleeping, the notifier has 32 of them for all waiters sharing it
+			if (const auto lock = vm::reservation_notifier(m_addr, 128).try_shared_lock())
+			{
+				m_ppu.state += cpu_flag::wait;
+				lock.wait(100);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+
+			return !m_ppu.test_stopped();
+		}
+	};
+
+	// Wake up the threads waiting on a primitive after releasing it
+	void sync_notify(u32 addr)
+	{
+		vm::reservation_notifier(addr, 128).notify_all();
+	}
+}
+
 error_code cellSyncMutexInitialize(vm::ptr<CellSyncMutex> mutex)
 {
 	cellSync.trace("cellSyncMutexInitialize(mutex=*0x%x)", mutex);
@@ -76,10 +182,12 @@ error_code cellSyncMutexLock(ppu_thread& ppu, vm::ptr<CellSyncMutex> mutex)
 	// Increase acq value and remember its old value
 	const auto order = mutex->ctrl.atomic_op<&CellSyncMutex::Counter::lock_begin>();
 
+	sync_waiter waiter(ppu, mutex.addr());
+
 	// Wait until rel value is equal to old acq value
 	while (mutex->ctrl.load().rel != order)
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -127,6 +235,7 @@ error_code cellSyncMutexUnlock(vm::ptr<CellSyncMutex> mutex)
 	}
 
 	mutex->ctrl.atomic_op<&CellSyncMutex::Counter::unlock>();
+	sync_notify(mutex.addr());
 
 	return CELL_OK;
 }
@@ -170,14 +279,18 @@ error_code cellSyncBarrierNotify(ppu_thread& ppu, vm::ptr<CellSyncBarrier> barri
 		return CELL_SYNC_ERROR_ALIGN;
 	}
 
+	sync_waiter waiter(ppu, barrier.addr());
+
 	while (!barrier->ctrl.atomic_op<&CellSyncBarrier::try_notify>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
 	}
 
+	sync_notify(barrier.addr());
+
 	return CELL_OK;
 }
 
@@ -202,6 +315,8 @@ error_code cellSyncBarrierTryNotify(vm::ptr<CellSyncBarrier> barrier)
 		return not_an_error(CELL_SYNC_ERROR_BUSY);
 	}
 
+	sync_notify(barrier.addr());
+
 	return CELL_OK;
 }
 
@@ -221,14 +336,18 @@ error_code cellSyncBarrierWait(ppu_thread& ppu, vm::ptr<CellSyncBarrier> barrier
 
 	_mm_mfence();
 
+	sync_waiter waiter(ppu, barrier.addr());
+
 	while (!barrier->ctrl.atomic_op<&CellSyncBarrier::try_wait>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
 	}
 
+	sync_notify(barrier.addr());
+
 	return CELL_OK;
 }
 
@@ -253,6 +372,8 @@ error_code cellSyncBarrierTryWait(vm::ptr<CellSyncBarrier> barrier)
 		return not_an_error(CELL_SYNC_ERROR_BUSY);
 	}
 
+	sync_notify(barrier.addr());
+
 	return CELL_OK;
 }
 
@@ -299,10 +420,12 @@ error_code cellSyncRwmRead(ppu_thread& ppu, vm::ptr<CellSyncRwm> rwm, vm::ptr<vo
 		return CELL_SYNC_ERROR_ALIGN;
 	}
 
+	sync_waiter waiter(ppu, rwm.addr());
+
 	// wait until `writers` is zero, increase `readers`
 	while (!rwm->ctrl.atomic_op<&CellSyncRwm::try_read_begin>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -317,6 +440,8 @@ error_code cellSyncRwmRead(ppu_thread& ppu, vm::ptr<CellSyncRwm> rwm, vm::ptr<vo
 		return CELL_SYNC_ERROR_ABORT;
 	}
 
+	sync_notify(rwm.addr());
+
 	return CELL_OK;
 }
 
@@ -349,6 +474,8 @@ error_code cellSyncRwmTryRead(vm::ptr<CellSyncRwm> rwm, vm::ptr<void> buffer)
 		return CELL_SYNC_ERROR_ABORT;
 	}
 
+	sync_notify(rwm.addr());
+
 	return CELL_OK;
 }
 
@@ -366,10 +493,12 @@ error_code cellSyncRwmWrite(ppu_thread& ppu, vm::ptr<CellSyncRwm> rwm, vm::cptr<
 		return CELL_SYNC_ERROR_ALIGN;
 	}
 
+	sync_waiter waiter(ppu, rwm.addr());
+
 	// wait until `writers` is zero, set to 1
 	while (!rwm->ctrl.atomic_op<&CellSyncRwm::try_write_begin>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -378,7 +507,7 @@ error_code cellSyncRwmWrite(ppu_thread& ppu, vm::ptr<CellSyncRwm> rwm, vm::cptr<
 	// wait until `readers` is zero
 	while (rwm->ctrl.load().readers != 0)
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -389,6 +518,7 @@ error_code cellSyncRwmWrite(ppu_thread& ppu, vm::ptr<CellSyncRwm> rwm, vm::cptr<
 
 	// sync and clear `readers` and `writers`
 	rwm->ctrl.exchange({ 0, 0 });
+	sync_notify(rwm.addr());
 
 	return CELL_OK;
 }
@@ -418,6 +548,7 @@ error_code cellSyncRwmTryWrite(vm::ptr<CellSyncRwm> rwm, vm::cptr<void> buffer)
 
 	// sync and clear `readers` and `writers`
 	rwm->ctrl.exchange({ 0, 0 });
+	sync_notify(rwm.addr());
 
 	return CELL_OK;
 }
@@ -475,12 +606,14 @@ error_code cellSyncQueuePush(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::
 
 	u32 position;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (!queue->ctrl.atomic_op([&](auto& ctrl)
 	{
 		return CellSyncQueue::try_push_begin(ctrl, depth, &position);
 	}))
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -490,6 +623,7 @@ error_code cellSyncQueuePush(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::
 	std::memcpy(&queue->buffer[position * queue->size], buffer.get_ptr(), queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::push_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -524,6 +658,7 @@ error_code cellSyncQueueTryPush(vm::ptr<CellSyncQueue> queue, vm::cptr<void> buf
 	std::memcpy(&queue->buffer[position * queue->size], buffer.get_ptr(), queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::push_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -546,12 +681,14 @@ error_code cellSyncQueuePop(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::p
 
 	u32 position;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (!queue->ctrl.atomic_op([&](auto& ctrl)
 	{
 		return CellSyncQueue::try_pop_begin(ctrl, depth, &position);
 	}))
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -561,6 +698,7 @@ error_code cellSyncQueuePop(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::p
 	std::memcpy(buffer.get_ptr(), &queue->buffer[position % depth * queue->size], queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::pop_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -595,6 +733,7 @@ error_code cellSyncQueueTryPop(vm::ptr<CellSyncQueue> queue, vm::ptr<void> buffe
 	std::memcpy(buffer.get_ptr(), &queue->buffer[position % depth * queue->size], queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::pop_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -617,12 +756,14 @@ error_code cellSyncQueuePeek(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::
 
 	u32 position;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (!queue->ctrl.atomic_op([&](auto& ctrl)
 	{
 		return CellSyncQueue::try_peek_begin(ctrl, depth, &position);
 	}))
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -632,6 +773,7 @@ error_code cellSyncQueuePeek(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue, vm::
 	std::memcpy(buffer.get_ptr(), &queue->buffer[position % depth * queue->size], queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::pop_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -666,6 +808,7 @@ error_code cellSyncQueueTryPeek(vm::ptr<CellSyncQueue> queue, vm::ptr<void> buff
 	std::memcpy(buffer.get_ptr(), &queue->buffer[position % depth * queue->size], queue->size);
 
 	queue->ctrl.atomic_op<&CellSyncQueue::pop_end>();
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -705,9 +848,11 @@ error_code cellSyncQueueClear(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue)
 
 	const u32 depth = queue->check_depth();
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (!queue->ctrl.atomic_op<&CellSyncQueue::try_clear_begin_1>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -715,13 +860,14 @@ error_code cellSyncQueueClear(ppu_thread& ppu, vm::ptr<CellSyncQueue> queue)
 
 	while (!queue->ctrl.atomic_op<&CellSyncQueue::try_clear_begin_2>())
 	{
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
 	}
 
 	queue->ctrl.exchange({ 0, 0 });
+	sync_notify(queue.addr());
 
 	return CELL_OK;
 }
@@ -888,6 +1034,8 @@ error_code _cellSyncLFQueueGetPushPointer(ppu_thread& ppu, vm::ptr<CellSyncLFQue
 
 	const s32 depth = queue->m_depth;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	u32 var1 = 0;
 
 	while (true)
@@ -940,6 +1088,11 @@ error_code _cellSyncLFQueueGetPushPointer(ppu_thread& ppu, vm::ptr<CellSyncLFQue
 				}
 				else if (!useEventQueue)
 				{
+					if (!waiter.wait())
+					{
+						return CELL_SYNC_ERROR_AGAIN;
+					}
+
 					continue;
 				}
 				else
@@ -1133,6 +1286,8 @@ error_code _cellSyncLFQueuePushBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> qu
 
 	vm::var<s32> position;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (true)
 	{
 		s32 res;
@@ -1153,7 +1308,7 @@ error_code _cellSyncLFQueuePushBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> qu
 			break;
 		}
 
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -1165,14 +1320,13 @@ error_code _cellSyncLFQueuePushBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> qu
 	const u32 addr = vm::cast((u64)((queue->m_buffer.addr() & ~1ull) + size * (pos >= depth ? pos - depth : pos)), HERE);
 	std::memcpy(vm::base(addr), buffer.get_ptr(), size);
 
-	if (queue->m_direction != CELL_SYNC_QUEUE_ANY2ANY)
-	{
-		return _cellSyncLFQueueCompletePushPointer(ppu, queue, pos, vm::null);
-	}
-	else
-	{
-		return _cellSyncLFQueueCompletePushPointer2(ppu, queue, pos, vm::null);
-	}
+	const error_code res = queue->m_direction != CELL_SYNC_QUEUE_ANY2ANY
+		? _cellSyncLFQueueCompletePushPointer(ppu, queue, pos, vm::null)
+		: _cellSyncLFQueueCompletePushPointer2(ppu, queue, pos, vm::null);
+
+	sync_notify(queue.addr());
+
+	return res;
 }
 
 error_code _cellSyncLFQueueGetPopPointer(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> queue, vm::ptr<s32> pointer, u32 isBlocking, u32 arg4, u32 useEventQueue)
@@ -1186,6 +1340,8 @@ error_code _cellSyncLFQueueGetPopPointer(ppu_thread& ppu, vm::ptr<CellSyncLFQueu
 
 	const s32 depth = queue->m_depth;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	u32 var1 = 0;
 
 	while (true)
@@ -1238,6 +1394,11 @@ error_code _cellSyncLFQueueGetPopPointer(ppu_thread& ppu, vm::ptr<CellSyncLFQueu
 				}
 				else if (!useEventQueue)
 				{
+					if (!waiter.wait())
+					{
+						return CELL_SYNC_ERROR_AGAIN;
+					}
+
 					continue;
 				}
 				else
@@ -1431,6 +1592,8 @@ error_code _cellSyncLFQueuePopBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> que
 
 	vm::var<s32> position;
 
+	sync_waiter waiter(ppu, queue.addr());
+
 	while (true)
 	{
 		s32 res;
@@ -1451,7 +1614,7 @@ error_code _cellSyncLFQueuePopBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> que
 			break;
 		}
 
-		if (ppu.test_stopped())
+		if (!waiter.wait())
 		{
 			return 0;
 		}
@@ -1463,14 +1626,13 @@ error_code _cellSyncLFQueuePopBody(ppu_thread& ppu, vm::ptr<CellSyncLFQueue> que
 	const u32 addr = vm::cast((u64)((queue->m_buffer.addr() & ~1) + size * (pos >= depth ? pos - depth : pos)), HERE);
 	std::memcpy(buffer.get_ptr(), vm::base(addr), size);
 
-	if (queue->m_direction != CELL_SYNC_QUEUE_ANY2ANY)
-	{
-		return _cellSyncLFQueueCompletePopPointer(ppu, queue, pos, vm::null, 0);
-	}
-	else
-	{
-		return _cellSyncLFQueueCompletePopPointer2(ppu, queue, pos, vm::null, 0);
-	}
+	const error_code res = queue->m_direction != CELL_SYNC_QUEUE_ANY2ANY
+		? _cellSyncLFQueueCompletePopPointer(ppu, queue, pos, vm::null, 0)
+		: _cellSyncLFQueueCompletePopPointer2(ppu, queue, pos, vm::null, 0);
+
+	sync_notify(queue.addr());
+
+	return res;
 }
 
 error_code cellSyncLFQueueClear(vm::ptr<CellSyncLFQueue> queue)
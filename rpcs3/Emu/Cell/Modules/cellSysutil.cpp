@@ -41,6 +41,13 @@ struct sysutil_cb_manager
 	atomic_t<registered_cb> callbacks[4]{};
 
 	lf_queue<std::function<s32(ppu_thread&)>> registered;
+
+	// System event frames, 3 words each: {func, userdata} (written last, never zero), status, param
+	// Unlike registered, the storage is reused so sending an event doesn't allocate
+	lf_fifo<atomic_t<u64>, 127> frames;
+
+	// Protects popping frames
+	std::mutex frames_mutex;
 };
 
 extern void sysutil_register_cb(std::function<s32(ppu_thread&)>&& cb)
@@ -58,12 +65,13 @@ extern void sysutil_send_system_cmd(u64 status, u64 param)
 		{
 			if (cb.first)
 			{
-				cbm->registered.push([=](ppu_thread& ppu) -> s32
-				{
-					// TODO: check it and find the source of the return value (void isn't equal to CELL_OK)
-					cb.first(ppu, status, param, cb.second);
-					return CELL_OK;
-				});
+				// Reserve frame space
+				const u32 pos = cbm->frames.push_begin(3);
+
+				// Write the arguments in relaxed manner, then the head
+				cbm->frames[pos + 1].raw() = status;
+				cbm->frames[pos + 2].raw() = param;
+				cbm->frames[pos] = u64{cb.first.addr()} << 32 | cb.second.addr();
 			}
 		}
 	}
@@ -252,6 +260,45 @@ error_code cellSysutilCheckCallback(ppu_thread& ppu)
 
 	const auto cbm = fxm::get_always<sysutil_cb_manager>();
 
+	while (true)
+	{
+		u64 head, status, param;
+
+		{
+			std::lock_guard lock(cbm->frames_mutex);
+
+			const u32 pos = cbm->frames.peek();
+
+			// Stop if empty or if the next frame is still being written
+			if (pos == cbm->frames.size() || !(head = cbm->frames[pos].load()))
+			{
+				break;
+			}
+
+			status = cbm->frames[pos + 1].load();
+			param = cbm->frames[pos + 2].load();
+
+			// Clean the frame for reuse
+			for (u32 i = 0; i < 3; i++)
+			{
+				cbm->frames[pos + i].raw() = 0;
+			}
+
+			cbm->frames.pop_end(3);
+		}
+
+		const vm::ptr<CellSysutilCallback> func = vm::cast(head >> 32);
+		const vm::ptr<void> userdata = vm::cast(static_cast<u32>(head));
+
+		// TODO: check it and find the source of the return value (void isn't equal to CELL_OK)
+		func(ppu, status, param, userdata);
+
+		if (ppu.is_stopped())
+		{
+			return 0;
+		}
+	}
+
 	for (auto&& func : cbm->registered.pop_all())
 	{
 		if (s32 res = func(ppu))
@@ -136,6 +136,10 @@ struct vdec_context final
 			fmt::throw_exception("avcodec_alloc_context3() failed (type=0x%x)" HERE, type);
 		}
 
+		// Decode with frame and slice threads (0 = FFmpeg picks the thread count)
+		ctx->thread_count = g_cfg.video.vdec_threads;
+		ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 		AVDictionary* opts{};
 		av_dict_set(&opts, "refcounted_frames", "1", 0);
 
@@ -221,13 +225,9 @@ struct vdec_context final
 					cellVdec.trace("End sequence...");
 				}
 
+				// On end of sequence, an empty packet drains the pictures still delayed by reordering or frame threads
 				while (out_max)
 				{
-					if (cmd->mode == -1)
-					{
-						break;
-					}
-
 					vdec_frame frame;
 					frame.avf.reset(av_frame_alloc());
 
@@ -363,6 +363,12 @@ struct vdec_context final
 					}
 				}
 
+				if (cmd->mode == -1)
+				{
+					// Leave draining mode
+					avcodec_flush_buffers(ctx);
+				}
+
 				if (out_max)
 				{
 					cb_func(ppu, vid, cmd->mode != -1 ? CELL_VDEC_MSG_TYPE_AUDONE : CELL_VDEC_MSG_TYPE_SEQDONE, CELL_OK, cb_arg);
@@ -563,6 +569,113 @@ s32 cellVdecDecodeAuEx2()
 	return CELL_OK;
 }
 
+// Fixed-point (6 bit) YUV->RGB coefficients for limited range input: Y, V->R, U->G, V->G, U->B
+static constexpr s16 s_vdec_yuv_coefs[2][5] =
+{
+	{ 74, 102, -25, -52, 129 }, // BT.601
+	{ 74, 115, -14, -34, 135 }, // BT.709
+};
+
+// Convert a YUV420P frame to 32-bit RGBA or ARGB with constant alpha, written directly to the output buffer
+static void vdec_yuv420p_to_rgb32(const AVFrame* frame, u8* out, bool argb, u32 matrix, u8 alpha)
+{
+	const s16* c = s_vdec_yuv_coefs[matrix == CELL_VDEC_COLOR_MATRIX_TYPE_BT709 ? 1 : 0];
+	const int w = frame->width;
+	const int h = frame->height;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i y_ofs = _mm_set1_epi16(16);
+	const __m128i uv_ofs = _mm_set1_epi16(128);
+	const __m128i cy = _mm_set1_epi16(c[0]);
+	const __m128i cvr = _mm_set1_epi16(c[1]);
+	const __m128i cug = _mm_set1_epi16(c[2]);
+	const __m128i cvg = _mm_set1_epi16(c[3]);
+	const __m128i cub = _mm_set1_epi16(c[4]);
+	const __m128i a = _mm_set1_epi8(static_cast<s8>(alpha));
+	const __m128i rnd = _mm_set1_epi16(32);
+
+	for (int y = 0; y < h; y++)
+	{
+		const u8* py = frame->data[0] + y * frame->linesize[0];
+		const u8* pu = frame->data[1] + (y / 2) * frame->linesize[1];
+		const u8* pv = frame->data[2] + (y / 2) * frame->linesize[2];
+		u8* dst = out + y * w * 4;
+
+		int x = 0;
+
+		// 8 pixels per iteration
+		for (; x + 8 <= w; x += 8)
+		{
+			const __m128i yy = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(py + x)), zero), y_ofs), cy), rnd);
+
+			// Each chroma sample covers two pixels
+			s32 u4, v4;
+			std::memcpy(&u4, pu + x / 2, 4);
+			std::memcpy(&v4, pv + x / 2, 4);
+
+			__m128i u = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), zero);
+			__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), zero);
+			u = _mm_sub_epi16(_mm_unpacklo_epi16(u, u), uv_ofs);
+			v = _mm_sub_epi16(_mm_unpacklo_epi16(v, v), uv_ofs);
+
+			const __m128i r = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(v, cvr)), 6);
+			const __m128i g = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(u, cug)), _mm_mullo_epi16(v, cvg)), 6);
+			const __m128i b = _mm_srai_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(u, cub)), 6);
+
+			const __m128i r8 = _mm_packus_epi16(r, zero);
+			const __m128i g8 = _mm_packus_epi16(g, zero);
+			const __m128i b8 = _mm_packus_epi16(b, zero);
+
+			const __m128i lo = argb ? _mm_unpacklo_epi8(a, r8) : _mm_unpacklo_epi8(r8, g8);
+			const __m128i hi = argb ? _mm_unpacklo_epi8(g8, b8) : _mm_unpacklo_epi8(b8, a);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_unpacklo_epi16(lo, hi));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4 + 16), _mm_unpackhi_epi16(lo, hi));
+		}
+
+		for (; x < w; x++)
+		{
+			const int yy = (py[x] - 16) * c[0] + 32;
+			const int u = pu[x / 2] - 128;
+			const int v = pv[x / 2] - 128;
+
+			const u8 r = static_cast<u8>(std::clamp((yy + v * c[1]) >> 6, 0, 255));
+			const u8 g = static_cast<u8>(std::clamp((yy + u * c[2] + v * c[3]) >> 6, 0, 255));
+			const u8 b = static_cast<u8>(std::clamp((yy + u * c[4]) >> 6, 0, 255));
+
+			u8* p = dst + x * 4;
+
+			if (argb)
+			{
+				p[0] = alpha, p[1] = r, p[2] = g, p[3] = b;
+			}
+			else
+			{
+				p[0] = r, p[1] = g, p[2] = b, p[3] = alpha;
+			}
+		}
+	}
+}
+
+// Copy a YUV420P frame into a packed planar buffer
+static void vdec_copy_yuv420p(const AVFrame* frame, u8* out)
+{
+	const int w = frame->width;
+	const int h = frame->height;
+
+	u8* planes[3] = { out, out + w * h, out + w * h * 5 / 4 };
+	const int widths[3] = { w, w / 2, w / 2 };
+	const int heights[3] = { h, h / 2, h / 2 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		for (int y = 0; y < heights[i]; y++)
+		{
+			std::memcpy(planes[i] + y * widths[i], frame->data[i] + y * frame->linesize[i], widths[i]);
+		}
+	}
+}
+
 s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u8> outBuff)
 {
 	cellVdec.trace("cellVdecGetPicture(handle=0x%x, format=*0x%x, outBuff=*0x%x)", handle, format, outBuff);
@@ -602,60 +715,41 @@ s32 cellVdecGetPicture(u32 handle, vm::cptr<CellVdecPicFormat> format, vm::ptr<u
 		const int w = frame->width;
 		const int h = frame->height;
 
-		AVPixelFormat out_f = AV_PIX_FMT_YUV420P;
-
-		std::unique_ptr<u8[]> alpha_plane;
+		if (frame->format != AV_PIX_FMT_YUV420P)
+		{
+			fmt::throw_exception("Unknown format (%d)" HERE, frame->format);
+		}
 
+		// Convert straight into the guest buffer
 		switch (const u32 type = format->formatType)
 		{
-		case CELL_VDEC_PICFMT_ARGB32_ILV: out_f = AV_PIX_FMT_ARGB; alpha_plane.reset(new u8[w * h]); break;
-		case CELL_VDEC_PICFMT_RGBA32_ILV: out_f = AV_PIX_FMT_RGBA; alpha_plane.reset(new u8[w * h]); break;
-		case CELL_VDEC_PICFMT_UYVY422_ILV: out_f = AV_PIX_FMT_UYVY422; break;
-		case CELL_VDEC_PICFMT_YUV420_PLANAR: out_f = AV_PIX_FMT_YUV420P; break;
-
-		default:
+		case CELL_VDEC_PICFMT_ARGB32_ILV:
+		case CELL_VDEC_PICFMT_RGBA32_ILV:
 		{
-			fmt::throw_exception("Unknown formatType (%d)" HERE, type);
-		}
+			vdec_yuv420p_to_rgb32(frame.avf.get(), outBuff.get_ptr(), type == CELL_VDEC_PICFMT_ARGB32_ILV, format->colorMatrixType, format->alpha);
+			break;
 		}
-
-		// TODO: color matrix
-
-		if (alpha_plane)
+		case CELL_VDEC_PICFMT_YUV420_PLANAR:
 		{
-			std::memset(alpha_plane.get(), format->alpha, w * h);
+			vdec_copy_yuv420p(frame.avf.get(), outBuff.get_ptr());
+			break;
 		}
-
-		AVPixelFormat in_f = AV_PIX_FMT_YUV420P;
-
-		switch (frame->format)
+		case CELL_VDEC_PICFMT_UYVY422_ILV:
 		{
-		case AV_PIX_FMT_YUV420P: in_f = alpha_plane ? AV_PIX_FMT_YUVA420P : AV_PIX_FMT_YUV420P; break;
+			vdec->sws = sws_getCachedContext(vdec->sws, w, h, AV_PIX_FMT_YUV420P, w, h, AV_PIX_FMT_UYVY422, SWS_POINT, NULL, NULL, NULL);
+
+			u8* out_data[4] = { outBuff.get_ptr() };
+			int out_line[4] = { w * 2 };
 
+			sws_scale(vdec->sws, frame->data, frame->linesize, 0, h, out_data, out_line);
+			break;
+		}
 		default:
 		{
-			fmt::throw_exception("Unknown format (%d)" HERE, frame->format);
-		}
+			fmt::throw_exception("Unknown formatType (%d)" HERE, type);
 		}
-
-		vdec->sws = sws_getCachedContext(vdec->sws, w, h, in_f, w, h, out_f, SWS_POINT, NULL, NULL, NULL);
-
-		u8* in_data[4] = { frame->data[0], frame->data[1], frame->data[2], alpha_plane.get() };
-		int in_line[4] = { frame->linesize[0], frame->linesize[1], frame->linesize[2], w * 1 };
-		u8* out_data[4] = { outBuff.get_ptr() };
-		int out_line[4] = { w * 4 };
-
-		if (!alpha_plane)
-		{
-			out_data[1] = out_data[0] + w * h;
-			out_data[2] = out_data[0] + w * h * 5 / 4;
-			out_line[0] = w;
-			out_line[1] = w / 2;
-			out_line[2] = w / 2;
 		}
 
-		sws_scale(vdec->sws, in_data, in_line, 0, h, out_data, out_line);
-
 		//const u32 buf_size = align(av_image_get_buffer_size(vdec->ctx->pix_fmt, vdec->ctx->width, vdec->ctx->height, 1), 128);
 
 		//// TODO: zero padding bytes
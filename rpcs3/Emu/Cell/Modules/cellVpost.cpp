@@ -10,8 +10,132 @@ extern "C"
 
 #include "cellVpost.h"
 
+#include <cmath>
+
 LOG_CHANNEL(cellVpost);
 
+namespace
+{
+	// YUV to RGB coefficients (Q13 fixed point, applied to 16-bit inputs shifted left by 6)
+	struct vpost_yuv_coeffs
+	{
+		s16 y_offset;
+		s16 y, rv, gu, gv, bu;
+	};
+
+	vpost_yuv_coeffs vpost_get_coeffs(s32 matrix, s32 range)
+	{
+		const f64 kr = matrix == CELL_VPOST_COLOR_MATRIX_BT709 ? 0.2126 : 0.299;
+		const f64 kb = matrix == CELL_VPOST_COLOR_MATRIX_BT709 ? 0.0722 : 0.114;
+		const f64 kg = 1. - kr - kb;
+		const bool full = range == CELL_VPOST_QUANT_RANGE_FULL;
+		const f64 ys = full ? 1. : 255. / 219.;
+		const f64 cs = full ? 1. : 255. / 224.;
+
+		const auto q13 = [](f64 v) { return static_cast<s16>(std::lround(v * 8192.)); };
+
+		vpost_yuv_coeffs result;
+		result.y_offset = full ? 0 : 16;
+		result.y = q13(ys);
+		result.rv = q13(cs * 2. * (1. - kr));
+		result.gu = q13(cs * 2. * (1. - kb) * kb / kg);
+		result.gv = q13(cs * 2. * (1. - kr) * kr / kg);
+		result.bu = q13(cs * 2. * (1. - kb));
+		return result;
+	}
+
+	// Convert one row to RGBA; chroma is either subsampled (one sample per 2 pixels) or per pixel
+	void vpost_convert_row(const u8* y, const u8* u, const u8* v, u8* out, u32 width, bool subsampled, const vpost_yuv_coeffs& c, u8 alpha)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i y_off = _mm_set1_epi16(c.y_offset);
+		const __m128i c_off = _mm_set1_epi16(128);
+		const __m128i c_y = _mm_set1_epi16(c.y);
+		const __m128i c_rv = _mm_set1_epi16(c.rv);
+		const __m128i c_gu = _mm_set1_epi16(c.gu);
+		const __m128i c_gv = _mm_set1_epi16(c.gv);
+		const __m128i c_bu = _mm_set1_epi16(c.bu);
+		const __m128i round = _mm_set1_epi16(4);
+		const __m128i a8 = _mm_set1_epi8(alpha);
+
+		u32 x = 0;
+
+		for (; x + 8 <= width; x += 8)
+		{
+			__m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero);
+			__m128i u16, v16;
+
+			if (subsampled)
+			{
+				const __m128i u8 = _mm_cvtsi32_si128(*reinterpret_cast<const u32*>(u + x / 2));
+				const __m128i v8 = _mm_cvtsi32_si128(*reinterpret_cast<const u32*>(v + x / 2));
+				u16 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u8, u8), zero);
+				v16 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v8, v8), zero);
+			}
+			else
+			{
+				u16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x)), zero);
+				v16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x)), zero);
+			}
+
+			y16 = _mm_slli_epi16(_mm_sub_epi16(y16, y_off), 6);
+			u16 = _mm_slli_epi16(_mm_sub_epi16(u16, c_off), 6);
+			v16 = _mm_slli_epi16(_mm_sub_epi16(v16, c_off), 6);
+
+			// Values are scaled by 8 at this point
+			const __m128i ys = _mm_mulhi_epi16(y16, c_y);
+			const __m128i r = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(ys, _mm_mulhi_epi16(v16, c_rv)), round), 3);
+			const __m128i g = _mm_srai_epi16(_mm_add_epi16(_mm_sub_epi16(_mm_sub_epi16(ys, _mm_mulhi_epi16(u16, c_gu)), _mm_mulhi_epi16(v16, c_gv)), round), 3);
+			const __m128i b = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(ys, _mm_mulhi_epi16(u16, c_bu)), round), 3);
+
+			const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+			const __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), a8);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+
+		// Same arithmetic for the remaining pixels
+		const auto mulhi = [](s32 a, s32 b) { return (a * b) >> 16; };
+		const auto clamp = [](s32 v) { return static_cast<u8>(std::clamp((v + 4) >> 3, 0, 255)); };
+
+		for (; x < width; x++)
+		{
+			const s32 yv = (y[x] - c.y_offset) * 64;
+			const s32 uv = ((subsampled ? u[x / 2] : u[x]) - 128) * 64;
+			const s32 vv = ((subsampled ? v[x / 2] : v[x]) - 128) * 64;
+			const s32 ys = mulhi(yv, c.y);
+
+			out[x * 4 + 0] = clamp(ys + mulhi(vv, c.rv));
+			out[x * 4 + 1] = clamp(ys - mulhi(uv, c.gu) - mulhi(vv, c.gv));
+			out[x * 4 + 2] = clamp(ys + mulhi(uv, c.bu));
+			out[x * 4 + 3] = alpha;
+		}
+	}
+
+	// Average 2x2 luma blocks of two rows (2:1 downscale, width is the output width)
+	void vpost_downscale_row(const u8* row0, const u8* row1, u8* out, u32 width)
+	{
+		const __m128i mask = _mm_set1_epi16(0xff);
+		const __m128i one = _mm_set1_epi16(1);
+
+		u32 x = 0;
+
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m128i v = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2)));
+			const __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(v, mask), _mm_srli_epi16(v, 8)), one);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(_mm_srli_epi16(sum, 1), sum));
+		}
+
+		for (; x < width; x++)
+		{
+			const u32 a = (row0[x * 2] + row1[x * 2] + 1) / 2;
+			const u32 b = (row0[x * 2 + 1] + row1[x * 2 + 1] + 1) / 2;
+			out[x] = static_cast<u8>((a + b + 1) / 2);
+		}
+	}
+}
+
 s32 cellVpostQueryAttr(vm::cptr<CellVpostCfgParam> cfgParam, vm::ptr<CellVpostAttr> attr)
 {
 	cellVpost.warning("cellVpostQueryAttr(cfgParam=*0x%x, attr=*0x%x)", cfgParam, attr);
@@ -113,26 +237,55 @@ s32 cellVpostExec(u32 handle, vm::cptr<u8> inPicBuff, vm::cptr<CellVpostCtrlPara
 	picInfo->reserved1 = 0;
 	picInfo->reserved2 = 0;
 
-	//u64 stamp0 = get_system_time();
-	std::unique_ptr<u8[]> pA(new u8[w*h]);
+	const u8* in_y = &inPicBuff[0];
+	const u8* in_u = &inPicBuff[w * h];
+	const u8* in_v = &inPicBuff[w * h * 5 / 4];
+	u8* out = outPicBuff.get_ptr();
+	const u8 alpha = ctrlParam->outAlpha;
 
-	memset(pA.get(), ctrlParam->outAlpha, w*h);
+	// Convert directly into the output picture if the size is kept or exactly halved
+	if (w > 0 && w % 2 == 0 && h % 2 == 0 && ((ow == u32(w) && oh == h) || (ow * 2 == u32(w) && oh * 2 == h)))
+	{
+		const vpost_yuv_coeffs coeffs = vpost_get_coeffs(ctrlParam->inColorMatrix, ctrlParam->inQuantRange);
+
+		if (ow == u32(w))
+		{
+			for (u32 y = 0; y < h; y++)
+			{
+				vpost_convert_row(in_y + y * w, in_u + y / 2 * (w / 2), in_v + y / 2 * (w / 2), out + y * ow * 4, ow, true, coeffs, alpha);
+			}
+		}
+		else
+		{
+			// Chroma planes already have the output resolution
+			vpost->luma_row.resize(ow);
+
+			for (u32 y = 0; y < oh; y++)
+			{
+				vpost_downscale_row(in_y + y * 2 * w, in_y + (y * 2 + 1) * w, vpost->luma_row.data(), ow);
+				vpost_convert_row(vpost->luma_row.data(), in_u + y * ow, in_v + y * ow, out + y * ow * 4, ow, false, coeffs, alpha);
+			}
+		}
+
+		return CELL_OK;
+	}
 
-	//u64 stamp1 = get_system_time();
+	// Other scale ratios: swscale with a reused alpha plane
+	if (vpost->alpha_plane.size() != w * h || vpost->alpha_value != alpha)
+	{
+		vpost->alpha_plane.assign(w * h, alpha);
+		vpost->alpha_value = alpha;
+	}
 
 	vpost->sws = sws_getCachedContext(vpost->sws, w, h, AV_PIX_FMT_YUVA420P, ow, oh, AV_PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
 
-	//u64 stamp2 = get_system_time();
-
-	const u8* in_data[4] = { &inPicBuff[0], &inPicBuff[w * h], &inPicBuff[w * h * 5 / 4], pA.get() };
+	const u8* in_data[4] = { in_y, in_u, in_v, vpost->alpha_plane.data() };
 	int in_line[4] = { w, w/2, w/2, w };
-	u8* out_data[4] = { outPicBuff.get_ptr(), NULL, NULL, NULL };
+	u8* out_data[4] = { out, NULL, NULL, NULL };
 	int out_line[4] = { static_cast<int>(ow*4), 0, 0, 0 };
 
 	sws_scale(vpost->sws, in_data, in_line, 0, h, out_data, out_line);
 
-	//ConLog.Write("cellVpostExec() perf (access=%d, getContext=%d, scale=%d, finalize=%d)",
-		//stamp1 - stamp0, stamp2 - stamp1, stamp3 - stamp2, get_system_time() - stamp3);
 	return CELL_OK;
 }
 
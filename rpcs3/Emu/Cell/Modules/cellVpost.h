@@ -334,6 +334,11 @@ public:
 
 	SwsContext* sws{};
 
+	// Scratch buffers reused between frames
+	std::vector<u8> luma_row;
+	std::vector<u8> alpha_plane;
+	u8 alpha_value = 0;
+
 	VpostInstance(bool rgba)
 		: to_rgba(rgba)
 	{
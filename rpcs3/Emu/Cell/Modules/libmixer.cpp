@@ -81,56 +81,19 @@ s32 cellAANAddData(u32 aan_handle, u32 aan_port, u32 offset, vm::ptr<float> addr
 		return CELL_LIBMIXER_ERROR_INVALID_PARAMATER;
 	}
 
+	const u32 channels =
+		type == CELL_SURMIXER_CHSTRIP_TYPE1A ? 1 : // mono upmixing
+		type == CELL_SURMIXER_CHSTRIP_TYPE2A ? 2 : // stereo upmixing
+		type == CELL_SURMIXER_CHSTRIP_TYPE6A ? 6 : 8; // 5.1 upmixing or 7.1
+
+	// reverse byte order
+	alignas(16) f32 buf[8 * 256];
+	vm::copy_from_be(buf, addr.get_ptr(), samples * channels);
+
 	std::lock_guard lock(g_surmx.mutex);
 
-	if (type == CELL_SURMIXER_CHSTRIP_TYPE1A)
-	{
-		// mono upmixing
-		for (u32 i = 0; i < samples; i++)
-		{
-			const float center = addr[i];
-			g_surmx.mixdata[i * 8 + 0] += center;
-			g_surmx.mixdata[i * 8 + 1] += center;
-		}
-	}
-	else if (type == CELL_SURMIXER_CHSTRIP_TYPE2A)
-	{
-		// stereo upmixing
-		for (u32 i = 0; i < samples; i++)
-		{
-			const float left = addr[i * 2 + 0];
-			const float right = addr[i * 2 + 1];
-			g_surmx.mixdata[i * 8 + 0] += left;
-			g_surmx.mixdata[i * 8 + 1] += right;
-		}
-	}
-	else if (type == CELL_SURMIXER_CHSTRIP_TYPE6A)
-	{
-		// 5.1 upmixing
-		for (u32 i = 0; i < samples; i++)
-		{
-			const float left = addr[i * 6 + 0];
-			const float right = addr[i * 6 + 1];
-			const float center = addr[i * 6 + 2];
-			const float low_freq = addr[i * 6 + 3];
-			const float rear_left = addr[i * 6 + 4];
-			const float rear_right = addr[i * 6 + 5];
-			g_surmx.mixdata[i * 8 + 0] += left;
-			g_surmx.mixdata[i * 8 + 1] += right;
-			g_surmx.mixdata[i * 8 + 2] += center;
-			g_surmx.mixdata[i * 8 + 3] += low_freq;
-			g_surmx.mixdata[i * 8 + 4] += rear_left;
-			g_surmx.mixdata[i * 8 + 5] += rear_right;
-		}
-	}
-	else if (type == CELL_SURMIXER_CHSTRIP_TYPE8A)
-	{
-		// 7.1
-		for (u32 i = 0; i < samples * 8; i++)
-		{
-			g_surmx.mixdata[i] += addr[i];
-		}
-	}
+	// mix
+	audio_mix::add_to_8ch(g_surmx.mixdata, buf, channels, samples);
 
 	return CELL_OK;
 }
@@ -358,6 +321,18 @@ struct surmixer_thread : ppu_thread
 
 					for (auto& p : g_ssp) if (p.m_active && p.m_created)
 					{
+						if (p.m_speed == 1.0f && (p.m_channels == 1 || p.m_channels == 2) && p.m_position < p.m_samples && p.m_samples - p.m_position > 256)
+						{
+							// Normal speed without reaching the end, one sample per output sample
+							if (p.m_connected)
+							{
+								audio_mix::add_s16(g_surmx.mixdata, static_cast<const s16*>(vm::base(p.m_addr + p.m_position * p.m_channels * sizeof(s16))), p.m_channels, p.m_level, 256);
+							}
+
+							p.m_position += 256;
+							continue;
+						}
+
 						auto v = vm::ptrl<s16>::make(p.m_addr); // 16-bit LE audio data
 						float left = 0.0f;
 						float right = 0.0f;
@@ -434,11 +409,8 @@ struct surmixer_thread : ppu_thread
 
 				auto buf = vm::_ptr<f32>(port.addr.addr() + (g_surmx.mixcount % port.num_blocks) * port.num_channels * AUDIO_BUFFER_SAMPLES * sizeof(float));
 
-				for (auto& mixdata : g_surmx.mixdata)
-				{
-					// reverse byte order
-					*buf++ = mixdata;
-				}
+				// reverse byte order
+				vm::copy_to_be(buf, g_surmx.mixdata, ::size32(g_surmx.mixdata));
 
 				//u64 stamp3 = get_system_time();
 
@@ -586,13 +558,13 @@ s32 cellSurMixerSurBusAddData(u32 busNo, u32 offset, vm::ptr<float> addr, u32 sa
 		return CELL_OK;
 	}
 
+	alignas(16) f32 buf[256];
+	vm::copy_from_be(buf, addr.get_ptr(), samples);
+
 	std::lock_guard lock(g_surmx.mutex);
 
-	for (u32 i = 0; i < samples; i++)
-	{
-		// reverse byte order and mix
-		g_surmx.mixdata[i * 8 + busNo] += addr[i];
-	}
+	// mix
+	audio_mix::add_to_channel(g_surmx.mixdata, buf, busNo, samples);
 
 	return CELL_OK;
 }
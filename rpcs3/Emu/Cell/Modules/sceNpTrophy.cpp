@@ -21,6 +21,71 @@
 
 LOG_CHANNEL(sceNpTrophy);
 
+// Coalesces TROPUSR.DAT rewrites: bursts of unlocks produce a single delayed write per file
+class trophy_state_writer
+{
+	// Delay before pending state is written
+	static constexpr u64 c_debounce_us = 200'000;
+
+	std::mutex m_mutex;
+	std::map<std::string, std::vector<uchar>> m_pending; // Host path -> latest file contents
+	bool m_scheduled = false;
+
+	// Serializes writers, so older contents can't overwrite newer ones
+	std::mutex m_write_mutex;
+
+	worker_pool::group m_jobs;
+
+public:
+	static trophy_state_writer& get()
+	{
+		// Construct the pool first so that it outlives the pending jobs
+		worker_pool::get();
+		static trophy_state_writer s_writer;
+		return s_writer;
+	}
+
+	void queue(const std::string& path, std::vector<uchar> data)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pending[path] = std::move(data);
+
+		if (!std::exchange(m_scheduled, true))
+		{
+			worker_pool::get().submit(worker_priority::background, [this]
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(c_debounce_us));
+				flush();
+			}, &m_jobs);
+		}
+	}
+
+	// Write all pending state now
+	void flush()
+	{
+		std::lock_guard write_lock(m_write_mutex);
+
+		std::map<std::string, std::vector<uchar>> pending;
+		{
+			std::lock_guard lock(m_mutex);
+			pending.swap(m_pending);
+			m_scheduled = false;
+		}
+
+		for (const auto& [path, data] : pending)
+		{
+			// Write a temporary file and replace, an interrupted write leaves the previous state intact
+			const std::string tmp_path = path + ".tmp";
+
+			if (!fs::write_file(tmp_path, fs::rewrite, data) || !fs::rename(tmp_path, path, true))
+			{
+				sceNpTrophy.error("Failed to write %s (%s)", path, fs::g_tls_error);
+			}
+		}
+	}
+};
+
 TrophyNotificationBase::~TrophyNotificationBase()
 {
 }
@@ -34,6 +99,12 @@ struct trophy_context_t
 	std::string trp_name;
 	fs::file trp_stream;
 	std::unique_ptr<TROPUSRLoader> tropusr;
+
+	~trophy_context_t()
+	{
+		// Final write of coalesced trophy state (context destroyed or emulation stopped)
+		trophy_state_writer::get().flush();
+	}
 };
 
 struct trophy_handle_t
@@ -560,7 +631,7 @@ error_code sceNpTrophyUnlockTrophy(u32 context, u32 handle, s32 trophyId, vm::pt
 
 	ctxt->tropusr->UnlockTrophy(trophyId, 0, 0); // TODO
 	std::string trophyPath = "/dev_hdd0/home/" + Emu.GetUsr() + "/trophy/" + ctxt->trp_name + "/TROPUSR.DAT";
-	ctxt->tropusr->Save(trophyPath);
+	trophy_state_writer::get().queue(vfs::get(trophyPath), ctxt->tropusr->Serialize());
 
 	if (platinumId)
 	{
@@ -24,6 +24,21 @@ error_code sys_lwmutex_trylock(ppu_thread& CPU, vm::ptr<sys_lwmutex_t> lwmutex);
 error_code sys_lwmutex_unlock(ppu_thread& CPU, vm::ptr<sys_lwmutex_t> lwmutex);
 error_code sys_lwmutex_destroy(ppu_thread& CPU, vm::ptr<sys_lwmutex_t> lwmutex);
 
+// Adaptive spinning statistics, an lwmutex is tracked once it has been contended
+struct lwmutex_spin_info
+{
+	u32 hold_ns; // Moving average of the hold time
+	u64 spin_acquired; // Acquired while spinning
+	u64 spin_failed; // Spin budget ran out, blocked in the syscall
+	u64 spin_skipped; // Blocked without spinning (the owner wasn't running or holds it too long)
+};
+
+bool lwmutex_get_spin_info(u32 addr, lwmutex_spin_info& info);
+
+// Hold time tracking for the code which takes or releases the lwmutex by other means (lwcond)
+void lwmutex_hold_start(u32 addr);
+void lwmutex_hold_stop(u32 addr);
+
 struct sys_lwmutex_locker
 {
 	ppu_thread& ppu;
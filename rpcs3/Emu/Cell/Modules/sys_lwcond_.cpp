@@ -290,6 +290,8 @@ error_code sys_lwcond_wait(ppu_thread& ppu, vm::ptr<sys_lwcond_t> lwcond, u64 ti
 	// save old recursive value
 	const be_t<u32> recursive_value = lwmutex->recursive_count;
 
+	lwmutex_hold_stop(lwmutex.addr());
+
 	// set special value
 	lwmutex->vars.owner = lwmutex_reserved;
 	lwmutex->recursive_count = 0;
@@ -318,6 +320,7 @@ error_code sys_lwcond_wait(ppu_thread& ppu, vm::ptr<sys_lwcond_t> lwcond, u64 ti
 			fmt::throw_exception("Locking failed (lwmutex=*0x%x, owner=0x%x)" HERE, lwmutex, old);
 		}
 
+		lwmutex_hold_start(lwmutex.addr());
 		return res;
 	}
 
@@ -8,8 +8,201 @@
 #include "Emu/Cell/lv2/sys_mutex.h"
 #include "sysPrxForUser.h"
 
+#include <chrono>
+
 extern logs::channel sysPrxForUser;
 
+namespace
+{
+	// Adaptive spinning state of a contended lwmutex
+	struct lwmutex_spin_slot
+	{
+		atomic_t<u32> addr{0};
+		atomic_t<u32> hold_ns{0};
+		atomic_t<u64> locked_at{0}; // Written by the owner
+		atomic_t<u64> spin_acquired{0};
+		atomic_t<u64> spin_failed{0};
+		atomic_t<u64> spin_skipped{0};
+	};
+
+	// Lossy table indexed by the guest address, a colliding lwmutex falls back to the fixed spin
+	lwmutex_spin_slot s_spin_slots[4096];
+
+	// Budget before any hold time was observed
+	constexpr u64 s_spin_first_ns = 2000;
+
+	// Longer critical sections go straight to the syscall
+	constexpr u64 s_spin_max_ns = 20000;
+
+	u64 spin_clock()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	lwmutex_spin_slot* get_spin_slot(u32 addr, bool create)
+	{
+		auto& slot = s_spin_slots[((addr >> 3) * 0x9e3779b1) >> 20];
+
+		const u32 cur = slot.addr;
+
+		if (cur == addr)
+		{
+			return &slot;
+		}
+
+		if (create && cur == 0 && slot.addr.compare_and_swap_test(0, addr))
+		{
+			return &slot;
+		}
+
+		return nullptr;
+	}
+
+	void reset_spin_slot(u32 addr)
+	{
+		if (const auto slot = get_spin_slot(addr, false))
+		{
+			slot->hold_ns = 0;
+			slot->locked_at = 0;
+			slot->spin_acquired = 0;
+			slot->spin_failed = 0;
+			slot->spin_skipped = 0;
+			slot->addr.compare_and_swap_test(addr, 0);
+		}
+	}
+
+	bool is_owner_running(u32 owner)
+	{
+		const auto [ppu, running] = idm::check<named_thread<ppu_thread>>(owner, [](ppu_thread& thread)
+		{
+			return !thread.is_paused();
+		});
+
+		return ppu && running;
+	}
+
+	// Spin while the owner is running and is expected to release the lock within the budget
+	bool lwmutex_spin(vm::ptr<sys_lwmutex_t> lwmutex, const be_t<u32>& tid)
+	{
+		const auto slot = get_spin_slot(lwmutex.addr(), true);
+
+		if (!slot)
+		{
+			for (u32 i = 0; i < 10; i++)
+			{
+				busy_wait();
+
+				if (lwmutex->vars.owner.load() == lwmutex_free && lwmutex->vars.owner.compare_and_swap_test(lwmutex_free, tid))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		const u64 hold = slot->hold_ns;
+
+		if (hold > s_spin_max_ns)
+		{
+			slot->spin_skipped++;
+			return false;
+		}
+
+		const u64 budget = hold ? std::min<u64>(hold * 2, s_spin_max_ns) : s_spin_first_ns;
+		const u64 start = spin_clock();
+
+		u32 checked_owner = lwmutex_free;
+
+		for (u32 i = 0;; i++)
+		{
+			const u32 owner = lwmutex->vars.owner.load();
+
+			if (owner == lwmutex_free)
+			{
+				if (lwmutex->vars.owner.compare_and_swap_test(lwmutex_free, tid))
+				{
+					slot->locked_at = spin_clock();
+					slot->spin_acquired++;
+					return true;
+				}
+			}
+			else if (owner == lwmutex_dead || owner == lwmutex_reserved)
+			{
+				// Deleted, or handed over by the syscall
+				break;
+			}
+			else if (owner != checked_owner || i % 8 == 7)
+			{
+				// Look up the owner when it changes and then periodically, it can be descheduled while spinning
+				if (!is_owner_running(owner))
+				{
+					if (checked_owner == lwmutex_free)
+					{
+						slot->spin_skipped++;
+						return false;
+					}
+
+					break;
+				}
+
+				checked_owner = owner;
+			}
+
+			if (spin_clock() - start >= budget)
+			{
+				break;
+			}
+
+			busy_wait(300);
+		}
+
+		slot->spin_failed++;
+		return false;
+	}
+}
+
+bool lwmutex_get_spin_info(u32 addr, lwmutex_spin_info& info)
+{
+	const auto slot = get_spin_slot(addr, false);
+
+	if (!slot)
+	{
+		return false;
+	}
+
+	info.hold_ns = slot->hold_ns;
+	info.spin_acquired = slot->spin_acquired;
+	info.spin_failed = slot->spin_failed;
+	info.spin_skipped = slot->spin_skipped;
+	return true;
+}
+
+void lwmutex_hold_start(u32 addr)
+{
+	if (const auto slot = get_spin_slot(addr, false))
+	{
+		slot->locked_at = spin_clock();
+	}
+}
+
+void lwmutex_hold_stop(u32 addr)
+{
+	if (const auto slot = get_spin_slot(addr, false))
+	{
+		if (const u64 locked_at = slot->locked_at.exchange(0))
+		{
+			// Samples are clamped, anything above the spin limit means the same
+			const u32 sample = static_cast<u32>(std::min<u64>(spin_clock() - locked_at, s_spin_max_ns * 4));
+
+			slot->hold_ns.atomic_op([&](u32& avg)
+			{
+				avg = avg ? static_cast<u32>((u64{avg} * 7 + sample) / 8) : sample;
+			});
+		}
+	}
+}
+
 error_code sys_lwmutex_create(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, vm::ptr<sys_lwmutex_attribute_t> attr)
 {
 	sysPrxForUser.trace("sys_lwmutex_create(lwmutex=*0x%x, attr=*0x%x)", lwmutex, attr);
@@ -47,6 +240,8 @@ error_code sys_lwmutex_create(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, v
 		return res;
 	}
 
+	reset_spin_slot(lwmutex.addr());
+
 	lwmutex->lock_var.store({ lwmutex_free, 0 });
 	lwmutex->attribute = attr->recursive | attr->protocol;
 	lwmutex->recursive_count = 0;
@@ -87,6 +282,8 @@ error_code sys_lwmutex_destroy(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex)
 	// deleting succeeded
 	lwmutex->vars.owner.release(lwmutex_dead);
 
+	reset_spin_slot(lwmutex.addr());
+
 	return CELL_OK;
 }
 
@@ -107,6 +304,7 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 	if (old_owner == lwmutex_free)
 	{
 		// locking succeeded
+		lwmutex_hold_start(lwmutex.addr());
 		return CELL_OK;
 	}
 
@@ -139,18 +337,10 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 		return CELL_EINVAL;
 	}
 
-	for (u32 i = 0; i < 10; i++)
+	if (lwmutex_spin(lwmutex, tid))
 	{
-		busy_wait();
-
-		if (lwmutex->vars.owner.load() == lwmutex_free)
-		{
-			if (lwmutex->vars.owner.compare_and_swap_test(lwmutex_free, tid))
-			{
-				// locking succeeded
-				return CELL_OK;
-			}
-		}
+		// locking succeeded
+		return CELL_OK;
 	}
 
 	// atomically increment waiter value using 64 bit op
@@ -161,6 +351,7 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 		// locking succeeded
 		--lwmutex->all_info;
 
+		lwmutex_hold_start(lwmutex.addr());
 		return CELL_OK;
 	}
 
@@ -184,6 +375,7 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 			fmt::throw_exception("Locking failed (lwmutex=*0x%x, owner=0x%x)" HERE, lwmutex, old);
 		}
 
+		lwmutex_hold_start(lwmutex.addr());
 		return CELL_OK;
 	}
 
@@ -191,17 +383,9 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 	{
 		while (true)
 		{
-			for (u32 i = 0; i < 10; i++)
+			if (lwmutex_spin(lwmutex, tid))
 			{
-				busy_wait();
-
-				if (lwmutex->vars.owner.load() == lwmutex_free)
-				{
-					if (lwmutex->vars.owner.compare_and_swap_test(lwmutex_free, tid))
-					{
-						return CELL_OK;
-					}
-				}
+				return CELL_OK;
 			}
 
 			lwmutex->all_info++;
@@ -209,6 +393,7 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 			if (lwmutex->vars.owner.compare_and_swap_test(lwmutex_free, tid))
 			{
 				lwmutex->all_info--;
+				lwmutex_hold_start(lwmutex.addr());
 				return CELL_OK;
 			}
 
@@ -224,6 +409,7 @@ error_code sys_lwmutex_lock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex, u64
 			if (res_ == CELL_OK)
 			{
 				lwmutex->vars.owner.release(tid);
+				lwmutex_hold_start(lwmutex.addr());
 			}
 			else if (timeout && res_ != CELL_ETIMEDOUT)
 			{
@@ -267,6 +453,7 @@ error_code sys_lwmutex_trylock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex)
 	if (old_owner == lwmutex_free)
 	{
 		// locking succeeded
+		lwmutex_hold_start(lwmutex.addr());
 		return CELL_OK;
 	}
 
@@ -313,6 +500,8 @@ error_code sys_lwmutex_trylock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex)
 			{
 				fmt::throw_exception("Locking failed (lwmutex=*0x%x, owner=0x%x)" HERE, lwmutex, old);
 			}
+
+			lwmutex_hold_start(lwmutex.addr());
 		}
 
 		return res;
@@ -347,6 +536,8 @@ error_code sys_lwmutex_unlock(ppu_thread& ppu, vm::ptr<sys_lwmutex_t> lwmutex)
 		return CELL_OK;
 	}
 
+	lwmutex_hold_stop(lwmutex.addr());
+
 	// ensure that waiter is zero
 	if (lwmutex->lock_var.compare_and_swap_test({ tid, 0 }, { lwmutex_free, 0 }))
 	{
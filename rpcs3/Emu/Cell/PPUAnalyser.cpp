@@ -6,6 +6,7 @@
 #include <unordered_set>
 #include "yaml-cpp/yaml.h"
 #include "Utilities/asm.h"
+#include "Crypto/sha1.h"
 
 const ppu_decoder<ppu_itype> s_ppu_itype;
 
@@ -20,6 +21,7 @@ void fmt_class_string<ppu_attr>::format(std::string& out, u64 arg)
 		case ppu_attr::known_size: return "known_size";
 		case ppu_attr::no_return: return "no_return";
 		case ppu_attr::no_size: return "no_size";
+		case ppu_attr::hot: return "hot";
 		case ppu_attr::__bitset_enum_max: break;
 		}
 
@@ -532,8 +534,175 @@ namespace ppu_patterns
 	};
 }
 
+// Analyser cache format version (must be updated if the analyser produces different results)
+static constexpr u32 s_ppu_analyser_cache_version = 1;
+
+// Save analysis results (function list) as a flat array of u32
+static void ppu_save_analysis(const std::string& path, const std::vector<ppu_function>& funcs)
+{
+	std::vector<u32> data{s_ppu_analyser_cache_version, ::size32(funcs)};
+
+	for (const auto& func : funcs)
+	{
+		data.insert(data.end(), {func.addr, func.toc, func.size, static_cast<u32>(func.attr), func.stack_frame, func.trampoline});
+
+		data.push_back(::size32(func.blocks));
+
+		for (const auto& block : func.blocks)
+		{
+			data.insert(data.end(), {block.first, block.second});
+		}
+
+		data.push_back(::size32(func.calls));
+		data.insert(data.end(), func.calls.begin(), func.calls.end());
+		data.push_back(::size32(func.callers));
+		data.insert(data.end(), func.callers.begin(), func.callers.end());
+	}
+
+	// Write to temporary file first to avoid loading truncated results
+	if (!fs::create_path(path.substr(0, path.find_last_of('/'))) || !fs::write_file(path + ".tmp", fs::rewrite, data) || !fs::rename(path + ".tmp", path, true))
+	{
+		LOG_ERROR(PPU, "Failed to save analysis results: %s (%s)", path, fs::g_tls_error);
+	}
+}
+
+// Load analysis results, returns false on failure
+static bool ppu_load_analysis(const std::string& path, std::vector<ppu_function>& funcs)
+{
+	const fs::file file(path);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	const std::vector<u32> data = file.to_vector<u32>();
+
+	if (data.size() < 2 || data[0] != s_ppu_analyser_cache_version)
+	{
+		return false;
+	}
+
+	// Each function takes at least 9 values (6 fields and 3 empty lists), reject truncated or damaged files before allocating
+	if (data[1] > (data.size() - 2) / 9)
+	{
+		return false;
+	}
+
+	std::vector<ppu_function> result;
+	result.resize(data[1]);
+
+	std::size_t pos = 2;
+
+	// Read next value (returns false if out of data)
+	auto get = [&](u32& value) -> bool
+	{
+		if (pos >= data.size())
+		{
+			return false;
+		}
+
+		value = data[pos++];
+		return true;
+	};
+
+	for (auto& func : result)
+	{
+		u32 attr, count;
+
+		if (!get(func.addr) || !get(func.toc) || !get(func.size) || !get(attr) || !get(func.stack_frame) || !get(func.trampoline))
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < bs_t<ppu_attr>::bitsize; i++)
+		{
+			if (attr & (1u << i))
+			{
+				func.attr += static_cast<ppu_attr>(i);
+			}
+		}
+
+		if (!get(count))
+		{
+			return false;
+		}
+
+		for (u32 i = 0, addr, size; i < count; i++)
+		{
+			if (!get(addr) || !get(size))
+			{
+				return false;
+			}
+
+			func.blocks.emplace_hint(func.blocks.end(), addr, size);
+		}
+
+		for (auto* set : {&func.calls, &func.callers})
+		{
+			if (!get(count))
+			{
+				return false;
+			}
+
+			for (u32 i = 0, addr; i < count; i++)
+			{
+				if (!get(addr))
+				{
+					return false;
+				}
+
+				set->emplace_hint(set->end(), addr);
+			}
+		}
+
+		func.name = fmt::format("__0x%x", func.addr);
+	}
+
+	if (pos != data.size())
+	{
+		return false;
+	}
+
+	funcs.insert(funcs.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+	return true;
+}
+
 void ppu_module::analyse(u32 lib_toc, u32 entry)
 {
+	// Analysis results are cached, keyed on module memory contents and arguments
+	const std::string cache_path = [&]()
+	{
+		sha1_context ctx;
+		u8 output[20];
+		sha1_starts(&ctx);
+
+		const be_t<u32> args[]{s_ppu_analyser_cache_version, lib_toc, entry};
+		sha1_update(&ctx, reinterpret_cast<const u8*>(args), sizeof(args));
+
+		for (const auto& seg : segs)
+		{
+			const be_t<u32> info[]{seg.addr, seg.size};
+			sha1_update(&ctx, reinterpret_cast<const u8*>(info), sizeof(info));
+			sha1_update(&ctx, vm::_ptr<const u8>(seg.addr), seg.size);
+		}
+
+		for (const auto& sec : secs)
+		{
+			const be_t<u32> info[]{sec.addr, sec.size};
+			sha1_update(&ctx, reinterpret_cast<const u8*>(info), sizeof(info));
+		}
+
+		sha1_finish(&ctx, output);
+		return fmt::format("%scache/ppu-analysis/%s.dat", fs::get_cache_dir(), fmt::base57(output, 16));
+	}();
+
+	if (ppu_load_analysis(cache_path, funcs))
+	{
+		LOG_NOTICE(PPU, "Function analysis: %zu functions (cached)", funcs.size());
+		return;
+	}
+
 	// Assume first segment is executable
 	const u32 start = segs[0].addr;
 	const u32 end = segs[0].addr + segs[0].size;
@@ -1479,6 +1648,8 @@ void ppu_module::analyse(u32 lib_toc, u32 entry)
 	}
 
 	LOG_NOTICE(PPU, "Function analysis: %zu functions (%zu enqueued)", funcs.size(), func_queue.size());
+
+	ppu_save_analysis(cache_path, funcs);
 }
 
 void ppu_acontext::UNK(ppu_opcode_t op)
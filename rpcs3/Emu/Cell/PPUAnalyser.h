@@ -15,6 +15,7 @@ enum class ppu_attr : u32
 	known_size,
 	no_return,
 	no_size,
+	hot, // Frequently called (from profile)
 
 	__bitset_enum_max
 };
@@ -76,6 +77,7 @@ struct ppu_module
 	std::vector<ppu_segment> segs;
 	std::vector<ppu_segment> secs;
 	std::vector<ppu_function> funcs;
+	std::vector<u32> patches; // Sorted addresses modified by patch_engine
 
 	// Copy info without functions
 	void copy_part(const ppu_module& info)
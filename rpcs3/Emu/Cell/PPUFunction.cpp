@@ -1,5 +1,12 @@
 #include "stdafx.h"
 #include "PPUModule.h"
+#include "Utilities/mutex.h"
+#include "Utilities/asm.h"
+
+#include <chrono>
+#include <unordered_set>
+
+extern std::vector<std::string> g_ppu_function_names;
 
 extern std::string ppu_get_syscall_name(u64 code)
 {
@@ -2548,3 +2555,162 @@ u32 ppu_function_manager::add_function(ppu_function_t function)
 }
 
 DECLARE(ppu_function_manager::addr);
+
+DECLARE(ppu_call_stats::g_enabled){false};
+
+namespace
+{
+	// Every ppu_call_stats which recorded at least one call
+	struct ppu_call_stats_list
+	{
+		shared_mutex mutex;
+		ppu_call_stats* head = nullptr;
+	};
+
+	ppu_call_stats_list& get_call_stats_list()
+	{
+		static ppu_call_stats_list s_list;
+		return s_list;
+	}
+}
+
+u64 ppu_call_stats::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ppu_call_stats::record(u64 ns)
+{
+	if (UNLIKELY(!linked) && !linked.exchange(true))
+	{
+		auto& list = get_call_stats_list();
+		std::lock_guard lock(list.mutex);
+		next = list.head;
+		list.head = this;
+	}
+
+	count++;
+	total_ns += ns;
+	max_ns.atomic_op([&](u64& value) { value = std::max(value, ns); });
+	histogram[std::min<u64>(buckets - 1, 63 - utils::cntlz64(ns | 1, true))]++;
+}
+
+void ppu_call_stats::start()
+{
+	auto& list = get_call_stats_list();
+
+	{
+		std::lock_guard lock(list.mutex);
+
+		for (auto stats = list.head; stats; stats = stats->next)
+		{
+			stats->count = 0;
+			stats->total_ns = 0;
+			stats->max_ns = 0;
+
+			for (auto& bucket : stats->histogram)
+			{
+				bucket = 0;
+			}
+		}
+	}
+
+	g_enabled = true;
+}
+
+bool ppu_call_stats::stop(const std::string& path)
+{
+	if (!g_enabled.exchange(false))
+	{
+		return false;
+	}
+
+	std::vector<ppu_call_stats*> rows;
+
+	{
+		auto& list = get_call_stats_list();
+		reader_lock lock(list.mutex);
+
+		for (auto stats = list.head; stats; stats = stats->next)
+		{
+			if (stats->count)
+			{
+				rows.emplace_back(stats);
+			}
+		}
+	}
+
+	if (rows.empty())
+	{
+		return false;
+	}
+
+	std::sort(rows.begin(), rows.end(), [](ppu_call_stats* a, ppu_call_stats* b)
+	{
+		return a->total_ns > b->total_ns;
+	});
+
+	// Bound functions only know their C++ name, find the module from the registered names ("module.function")
+	std::unordered_map<std::string, std::string> modules;
+
+	for (const auto& name : g_ppu_function_names)
+	{
+		if (const auto pos = name.find_first_of('.'); pos != std::string::npos)
+		{
+			modules.emplace(name.substr(pos + 1), name.substr(0, pos));
+		}
+	}
+
+	std::unordered_set<std::string> syscalls;
+
+	for (u64 code = 0; code < 1024; code++)
+	{
+		syscalls.emplace(ppu_get_syscall_name(code));
+	}
+
+	std::string out = "module,function,calls,total_us,avg_ns,max_ns";
+
+	for (u32 i = 0; i < buckets - 1; i++)
+	{
+		fmt::append(out, ",<%uns", 2ull << i);
+	}
+
+	fmt::append(out, ",>=%uns\n", 1ull << (buckets - 1));
+
+	for (auto stats : rows)
+	{
+		std::string module = "?";
+
+		if (auto found = modules.find(stats->name); found != modules.end())
+		{
+			module = found->second;
+		}
+		else if (syscalls.count(stats->name))
+		{
+			module = "lv2";
+		}
+
+		fmt::append(out, "%s,%s,%u,%u,%u,%u", module, stats->name, stats->count, stats->total_ns / 1000, stats->total_ns / stats->count, stats->max_ns);
+
+		for (auto& bucket : stats->histogram)
+		{
+			fmt::append(out, ",%u", bucket.load());
+		}
+
+		out += '\n';
+	}
+
+	for (std::size_t i = 0; i < std::min<std::size_t>(rows.size(), 10); i++)
+	{
+		LOG_NOTICE(PPU, "HLE call stats: %s: %u calls, %.3f ms total", rows[i]->name, rows[i]->count, rows[i]->total_ns / 1000000.);
+	}
+
+	if (!fs::write_file(path, fs::rewrite, out))
+	{
+		LOG_ERROR(PPU, "Failed to write HLE call stats to %s (%s)", path, fs::g_tls_error);
+		return false;
+	}
+
+	LOG_SUCCESS(PPU, "HLE call stats for %zu functions saved to %s", rows.size(), path);
+	return true;
+}
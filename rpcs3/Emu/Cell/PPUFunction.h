@@ -4,11 +4,48 @@
 
 using ppu_function_t = bool(*)(ppu_thread&);
 
+// Call count and latency histogram of a bound HLE function or syscall (one per BIND_FUNC site)
+struct ppu_call_stats
+{
+	// Tested on every call, collecting is off by default and can be switched at any time
+	static atomic_t<bool> g_enabled;
+
+	// Latencies are counted in log2(ns) buckets, the last one takes everything above
+	static constexpr u32 buckets = 32;
+
+	const char* const name;
+	atomic_t<bool> linked{false};
+	ppu_call_stats* next = nullptr;
+	atomic_t<u64> count{0};
+	atomic_t<u64> total_ns{0};
+	atomic_t<u64> max_ns{0};
+	atomic_t<u64> histogram[buckets]{};
+
+	ppu_call_stats(const char* name)
+		: name(name)
+	{
+	}
+
+	// Nanoseconds on the profiling clock
+	static u64 now();
+
+	void record(u64 ns);
+
+	// Clear all counters and start collecting
+	static void start();
+
+	// Stop collecting and write the report as CSV, returns false if nothing was collected
+	static bool stop(const std::string& path);
+};
+
 // BIND_FUNC macro "converts" any appropriate HLE function to ppu_function_t, binding it to PPU thread context.
 #define BIND_FUNC(func, ...) (static_cast<ppu_function_t>([](ppu_thread& ppu) -> bool {\
+	static ppu_call_stats s_stats(#func);\
 	const auto old_f = ppu.last_function;\
 	ppu.last_function = #func;\
+	const u64 stats_start = UNLIKELY(ppu_call_stats::g_enabled) ? ppu_call_stats::now() : 0;\
 	ppu_func_detail::do_call(ppu, func);\
+	if (UNLIKELY(stats_start)) s_stats.record(ppu_call_stats::now() - stats_start);\
 	ppu.last_function = old_f;\
 	ppu.cia += 4;\
 	__VA_ARGS__;\
@@ -3,14 +3,26 @@
 #include "PPUThread.h"
 #include "PPUInterpreter.h"
 #include "Utilities/asm.h"
+#include "Utilities/sysinfo.h"
 #include "Emu/Cell/Common.h"
+#include "Emu/Cell/SPUThread.h"
 
 #include <cmath>
+#include <immintrin.h>
 
 #if !defined(_MSC_VER) && !defined(__SSSE3__)
 #define _mm_shuffle_epi8
 #endif
 
+const bool s_use_vbmi = utils::has_avx512_vbmi();
+
+// VBMI kernels are selected at runtime, enable the instruction set per function where the compiler needs it
+#if defined(_MSC_VER) || defined(__AVX512VBMI__)
+#define VBMI_FUNC
+#else
+#define VBMI_FUNC __attribute__((__target__("avx512f,avx512bw,avx512vl,avx512vbmi")))
+#endif
+
 inline u64 dup32(u32 x) { return x | static_cast<u64>(x) << 32; }
 
 // Write values to CR field
@@ -112,6 +124,12 @@ extern __m128i sse_altivec_vperm(__m128i A, __m128i B, __m128i C)
 	return _mm_or_si128(_mm_and_si128(mask, sa), _mm_andnot_si128(mask, sb));
 }
 
+// VPERMI2B selects from two tables with the low five index bits, which is exactly vperm with inverted indices
+extern VBMI_FUNC __m128i sse_altivec_vperm_vbmi(__m128i A, __m128i B, __m128i C)
+{
+	return _mm_permutex2var_epi8(B, _mm_xor_si128(C, _mm_set1_epi8(-1)), A);
+}
+
 extern __m128i sse_altivec_vperm_v0(__m128i A, __m128i B, __m128i C)
 {
 	__m128i ab[2]{B, A};
@@ -256,6 +274,30 @@ extern void sse_cellbe_stvrx_v0(u64 addr, __m128i a)
 	_mm_maskmoveu_si128(sse_pshufb(a, lvrx_masks[addr & 0xf]), lvlx_masks[addr & 0xf], (char*)vm::base(addr & ~0xf));
 }
 
+// Word access which handles Raw SPU registers directly instead of faulting into the access violation handler
+extern u32 ppu_mmio_read32(u64 addr)
+{
+	u32 value;
+
+	if (UNLIKELY(spu_thread::is_raw_spu_reg(static_cast<u32>(addr))) && spu_thread::read_raw_reg(static_cast<u32>(addr), value))
+	{
+		return value;
+	}
+
+	// Normal memory, or let the access violation handler report the invalid access
+	return vm::read32(vm::cast(addr, HERE));
+}
+
+extern void ppu_mmio_write32(u64 addr, u32 value)
+{
+	if (UNLIKELY(spu_thread::is_raw_spu_reg(static_cast<u32>(addr))) && spu_thread::write_raw_reg(static_cast<u32>(addr), value))
+	{
+		return;
+	}
+
+	vm::write32(vm::cast(addr, HERE), value);
+}
+
 template<typename T>
 struct add_flags_result_t
 {
@@ -1391,6 +1433,12 @@ bool ppu_interpreter_precise::VPERM(ppu_thread& ppu, ppu_opcode_t op)
 
 bool ppu_interpreter_fast::VPERM(ppu_thread& ppu, ppu_opcode_t op)
 {
+	if (s_use_vbmi)
+	{
+		ppu.vr[op.vd].vi = sse_altivec_vperm_vbmi(ppu.vr[op.va].vi, ppu.vr[op.vb].vi, ppu.vr[op.vc].vi);
+		return true;
+	}
+
 	ppu.vr[op.vd].vi = sse_altivec_vperm(ppu.vr[op.va].vi, ppu.vr[op.vb].vi, ppu.vr[op.vc].vi);
 	return true;
 }
@@ -3243,7 +3291,7 @@ bool ppu_interpreter::LDX(ppu_thread& ppu, ppu_opcode_t op)
 bool ppu_interpreter::LWZX(ppu_thread& ppu, ppu_opcode_t op)
 {
 	const u64 addr = op.ra ? ppu.gpr[op.ra] + ppu.gpr[op.rb] : ppu.gpr[op.rb];
-	ppu.gpr[op.rd] = vm::read32(vm::cast(addr, HERE));
+	ppu.gpr[op.rd] = ppu_mmio_read32(addr);
 	return true;
 }
 
@@ -3533,7 +3581,7 @@ bool ppu_interpreter::STWCX(ppu_thread& ppu, ppu_opcode_t op)
 bool ppu_interpreter::STWX(ppu_thread& ppu, ppu_opcode_t op)
 {
 	const u64 addr = op.ra ? ppu.gpr[op.ra] + ppu.gpr[op.rb] : ppu.gpr[op.rb];
-	vm::write32(vm::cast(addr, HERE), (u32)ppu.gpr[op.rs]);
+	ppu_mmio_write32(addr, (u32)ppu.gpr[op.rs]);
 	return true;
 }
 
@@ -4353,7 +4401,7 @@ bool ppu_interpreter::DCBZ(ppu_thread& ppu, ppu_opcode_t op)
 bool ppu_interpreter::LWZ(ppu_thread& ppu, ppu_opcode_t op)
 {
 	const u64 addr = op.ra ? ppu.gpr[op.ra] + op.simm16 : op.simm16;
-	ppu.gpr[op.rd] = vm::read32(vm::cast(addr, HERE));
+	ppu.gpr[op.rd] = ppu_mmio_read32(addr);
 	return true;
 }
 
@@ -4384,7 +4432,7 @@ bool ppu_interpreter::STW(ppu_thread& ppu, ppu_opcode_t op)
 {
 	const u64 addr = op.ra ? ppu.gpr[op.ra] + op.simm16 : op.simm16;
 	const u32 value = (u32)ppu.gpr[op.rs];
-	vm::write32(vm::cast(addr, HERE), value);
+	ppu_mmio_write32(addr, value);
 
 	//Insomniac engine v3 & v4 (newer R&C, Fuse, Resitance 3)
 	if (UNLIKELY(value == 0xAAAAAAAA))
@@ -980,15 +980,17 @@ std::shared_ptr<lv2_prx> ppu_load_prx(const ppu_prx_object& elf, const std::stri
 		hash[5 + i * 2] = pal[prx->sha1[i] & 15];
 	}
 
-	// Apply the patch
-	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr);
+	// Apply the patch (recording patched addresses for the recompiler)
+	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr, &prx->patches);
 
 	if (!Emu.GetTitleID().empty())
 	{
 		// Alternative patch
-		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr);
+		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr, &prx->patches);
 	}
 
+	std::sort(prx->patches.begin(), prx->patches.end());
+
 	LOG_NOTICE(LOADER, "PRX library hash: %s (<- %u)", hash, applied);
 
 	if (Emu.IsReady() && fxm::import<ppu_module>([&] { return prx; }))
@@ -1132,15 +1134,17 @@ void ppu_load_exec(const ppu_exec_object& elf)
 		hash[5 + i * 2] = pal[_main->sha1[i] & 15];
 	}
 
-	// Apply the patch
-	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr);
+	// Apply the patch (recording patched addresses for the recompiler)
+	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr, &_main->patches);
 
 	if (!Emu.GetTitleID().empty())
 	{
 		// Alternative patch
-		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr);
+		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr, &_main->patches);
 	}
 
+	std::sort(_main->patches.begin(), _main->patches.end());
+
 	LOG_NOTICE(LOADER, "PPU executable hash: %s (<- %u)", hash, applied);
 
 	// Initialize HLE modules
@@ -1425,9 +1429,30 @@ void ppu_load_exec(const ppu_exec_object& elf)
 				"\nVisit https://rpcs3.net/ for Quickstart Guide and more information.");
 		}
 
-		for (const auto& name : load_libs)
+		const std::vector<std::string> lib_names(load_libs.begin(), load_libs.end());
+
+		// Decrypt and parse all libraries concurrently
+		std::vector<ppu_prx_object> lib_objs(lib_names.size());
+
+		{
+			worker_pool::group jobs;
+
+			for (std::size_t i = 0; i < lib_names.size(); i++)
+			{
+				worker_pool::get().submit(worker_priority::interactive, [&, i]
+				{
+					lib_objs[i].open(decrypt_self(fs::file(lle_dir + lib_names[i])));
+				}, &jobs);
+			}
+
+			jobs.wait();
+		}
+
+		// Memory placement, linkage and patching stay in order (addresses must not depend on timing)
+		for (std::size_t i = 0; i < lib_names.size(); i++)
 		{
-			const ppu_prx_object obj = decrypt_self(fs::file(lle_dir + name));
+			const std::string& name = lib_names[i];
+			const ppu_prx_object& obj = lib_objs[i];
 
 			if (obj == elf_error::ok)
 			{
@@ -1446,6 +1471,9 @@ void ppu_load_exec(const ppu_exec_object& elf)
 				}
 
 				loaded_modules.emplace_back(std::move(prx));
+
+				// Free the decrypted image early
+				lib_objs[i] = {};
 			}
 			else
 			{
@@ -1703,15 +1731,17 @@ std::shared_ptr<lv2_overlay> ppu_load_overlay(const ppu_exec_object& elf, const
 		hash[5 + i * 2] = pal[ovlm->sha1[i] & 15];
 	}
 
-	// Apply the patch
-	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr);
+	// Apply the patch (recording patched addresses for the recompiler)
+	auto applied = fxm::check_unlocked<patch_engine>()->apply(hash, vm::g_base_addr, &ovlm->patches);
 
 	if (!Emu.GetTitleID().empty())
 	{
 		// Alternative patch
-		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr);
+		applied += fxm::check_unlocked<patch_engine>()->apply(Emu.GetTitleID() + '-' + hash, vm::g_base_addr, &ovlm->patches);
 	}
 
+	std::sort(ovlm->patches.begin(), ovlm->patches.end());
+
 	LOG_NOTICE(LOADER, "OVL executable hash: %s (<- %u)", hash, applied);
 
 	// Load other programs
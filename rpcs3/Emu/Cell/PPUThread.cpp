@@ -2,6 +2,7 @@
 #include "Utilities/VirtualMemory.h"
 #include "Utilities/sysinfo.h"
 #include "Utilities/JIT.h"
+#include "Utilities/timeline.h"
 #include "Crypto/sha1.h"
 #include "Emu/Memory/vm.h"
 #include "Emu/System.h"
@@ -13,6 +14,7 @@
 #include "SPURecompiler.h"
 #include "lv2/sys_sync.h"
 #include "lv2/sys_prx.h"
+#include "lv2/sys_time.h"
 #include "Utilities/GDBDebugServer.h"
 
 #ifdef LLVM_AVAILABLE
@@ -70,6 +72,10 @@ extern atomic_t<const char*> g_progr;
 extern atomic_t<u64> g_progr_ptotal;
 extern atomic_t<u64> g_progr_pdone;
 
+extern atomic_t<u64> g_ppu_modules_loaded;
+extern atomic_t<u64> g_ppu_modules_compiled;
+extern std::vector<std::string> g_ppu_function_names;
+
 enum class join_status : u32
 {
 	joinable = 0,
@@ -111,6 +117,22 @@ void fmt_class_string<ppu_decoder_type>::format(std::string& out, u64 arg)
 	});
 }
 
+template <>
+void fmt_class_string<ppu_llvm_pipeline>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](ppu_llvm_pipeline type)
+	{
+		switch (type)
+		{
+		case ppu_llvm_pipeline::minimal: return "Minimal";
+		case ppu_llvm_pipeline::standard: return "Standard";
+		case ppu_llvm_pipeline::extended: return "Extended";
+		}
+
+		return unknown;
+	});
+}
+
 // Table of identical interpreter functions when precise contains SSE2 version, and fast contains SSSE3 functions
 const std::pair<ppu_inter_func_t, ppu_inter_func_t> s_ppu_dispatch_table[]
 {
@@ -163,9 +185,39 @@ extern const ppu_decoder<ppu_interpreter_fast> g_ppu_interpreter_fast([](auto& t
 	}
 });
 
+// PPU compile benchmark (existing objects are ignored, every compiled part is timed)
+struct ppu_compile_benchmark
+{
+	struct part_stats
+	{
+		std::string module;
+		std::string obj_name;
+		u32 funcs = 0;
+		u64 code_size = 0; // Guest bytes
+		u64 translate_us = 0;
+		u64 optimize_us = 0;
+		u64 codegen_us = 0; // Including the object file write
+		u64 object_size = 0;
+	};
+
+	atomic_t<bool> enabled{false};
+	std::string output_path;
+	u64 start_time = 0;
+
+	shared_mutex mutex;
+	std::vector<part_stats> parts;
+
+	static ppu_compile_benchmark& get()
+	{
+		static ppu_compile_benchmark s_benchmark;
+		return s_benchmark;
+	}
+};
+
 extern void ppu_initialize();
 extern void ppu_initialize(const ppu_module& info);
-static void ppu_initialize2(class jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name);
+static void ppu_initialize2(class jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name, ppu_compile_benchmark::part_stats* stats = nullptr);
+static void ppu_llvm_request(u32 addr);
 extern void ppu_execute_syscall(ppu_thread& ppu, u64 code);
 
 // Get pointer to executable cache
@@ -208,6 +260,12 @@ void ppu_recompiler_fallback(ppu_thread& ppu)
 		LOG_ERROR(PPU, "Unregistered PPU Function (LR=0x%llx)", ppu.lr);
 	}
 
+	if (g_cfg.core.llvm_lazy)
+	{
+		// Prioritize compilation of the function
+		ppu_llvm_request(ppu.cia);
+	}
+
 	const auto& table = g_ppu_interpreter_fast.get_table();
 	const auto cache = vm::g_exec_addr;
 
@@ -284,6 +342,56 @@ extern void ppu_register_range(u32 addr, u32 size)
 	}
 }
 
+// Superinstruction: compare and the following conditional branch in a single dispatch
+template <bool(*Cmp)(ppu_thread&, ppu_opcode_t)>
+static bool ppu_fused_cmp_bc(ppu_thread& ppu, ppu_opcode_t op)
+{
+	Cmp(ppu, op);
+
+	// The branch may have been replaced (breakpoint) since fusion
+	const u64 next = ppu_ref(ppu.cia + 4);
+
+	if (UNLIKELY(static_cast<u32>(next) != ::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::BC))))
+	{
+		return true;
+	}
+
+	ppu.cia += 4;
+
+	if (ppu_interpreter_fast::BC(ppu, {static_cast<u32>(next >> 32)}))
+	{
+		ppu.cia += 4;
+	}
+
+	return false;
+}
+
+// Replace interpreter cache entries at addr with superinstructions where possible
+static void ppu_fuse_at(u32 addr)
+{
+	static const std::pair<u32, u32> s_fused[]
+	{
+		{::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::CMPI)), ::narrow<u32>(reinterpret_cast<uptr>(&ppu_fused_cmp_bc<&ppu_interpreter_fast::CMPI>))},
+		{::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::CMPLI)), ::narrow<u32>(reinterpret_cast<uptr>(&ppu_fused_cmp_bc<&ppu_interpreter_fast::CMPLI>))},
+		{::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::CMP)), ::narrow<u32>(reinterpret_cast<uptr>(&ppu_fused_cmp_bc<&ppu_interpreter_fast::CMP>))},
+		{::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::CMPL)), ::narrow<u32>(reinterpret_cast<uptr>(&ppu_fused_cmp_bc<&ppu_interpreter_fast::CMPL>))},
+	};
+
+	if (ppu_ref<u32>(addr + 4) != ::narrow<u32>(reinterpret_cast<uptr>(&ppu_interpreter_fast::BC)))
+	{
+		return;
+	}
+
+	for (const auto& [from, to] : s_fused)
+	{
+		if (ppu_ref<u32>(addr) == from)
+		{
+			ppu_ref<u32>(addr) = to;
+			return;
+		}
+	}
+}
+
 extern void ppu_register_function_at(u32 addr, u32 size, ppu_function_t ptr)
 {
 	// Initialize specific function
@@ -311,6 +419,8 @@ extern void ppu_register_function_at(u32 addr, u32 size, ppu_function_t ptr)
 	// Initialize interpreter cache
 	const u32 fallback = ::narrow<u32>(reinterpret_cast<std::uintptr_t>(ppu_fallback));
 
+	const u32 start = addr, end = addr + size;
+
 	while (size)
 	{
 		if (ppu_ref<u32>(addr) == fallback)
@@ -321,6 +431,15 @@ extern void ppu_register_function_at(u32 addr, u32 size, ppu_function_t ptr)
 		addr += 4;
 		size -= 4;
 	}
+
+	// Fuse common instruction pairs (not in debug mode, to keep single stepping exact)
+	if (g_cfg.core.ppu_decoder == ppu_decoder_type::fast && !g_cfg.core.ppu_debug)
+	{
+		for (u32 i = start; i + 4 < end; i += 4)
+		{
+			ppu_fuse_at(i);
+		}
+	}
 }
 
 // Breakpoint entry point
@@ -345,12 +464,88 @@ static bool ppu_break(ppu_thread& ppu, ppu_opcode_t op)
 	return false;
 }
 
+// Breakpoints in LLVM code: one counter per 256-byte line is checked by the compiled code, exact addresses only on a hit
+static u8 s_ppu_break_lines[0x1000000]{};
+static shared_mutex s_ppu_break_mutex;
+static std::unordered_set<u32> s_ppu_break_set;
+
+static bool ppu_llvm_is_breakpoint(u32 addr)
+{
+	if (!s_ppu_break_lines[addr / 256])
+	{
+		return false;
+	}
+
+	reader_lock lock(s_ppu_break_mutex);
+	return s_ppu_break_set.count(addr) != 0;
+}
+
+static void ppu_llvm_breakpoint(u32 addr, bool add)
+{
+	if (!g_cfg.core.ppu_llvm_breakpoints)
+	{
+		LOG_ERROR(PPU, "Breakpoint at 0x%x ignored: enable PPU LLVM Breakpoint Checks", addr);
+		return;
+	}
+
+	std::lock_guard lock(s_ppu_break_mutex);
+
+	if (add ? s_ppu_break_set.emplace(addr).second : s_ppu_break_set.erase(addr) != 0)
+	{
+		s_ppu_break_lines[addr / 256] += add ? 1 : -1;
+	}
+}
+
+// Check point hit in LLVM code: run the interpreter from addr, pausing at breakpoints, until compiled code is reached again
+static void ppu_llvm_break(ppu_thread& ppu, u64 addr)
+{
+	ppu.cia = ::narrow<u32>(addr);
+
+	const auto& table = g_ppu_interpreter_fast.get_table();
+	const auto cache = vm::g_exec_addr;
+
+	while (true)
+	{
+		if (ppu_llvm_is_breakpoint(ppu.cia))
+		{
+			// Pause and wait if necessary (same as ppu_break)
+			const bool status = ppu.state.test_and_set(cpu_flag::dbg_pause);
+#ifdef WITH_GDB_DEBUGGER
+			fxm::get<GDBDebugServer>()->pause_from(&ppu);
+#endif
+			if (!status && ppu.check_state())
+			{
+				return;
+			}
+		}
+
+		if (const u32 op = *reinterpret_cast<u32*>(cache + (u64)ppu.cia * 2 + 4);
+			LIKELY(table[ppu_decode(op)](ppu, {op})))
+		{
+			ppu.cia += 4;
+			continue;
+		}
+
+		if (uptr func = *reinterpret_cast<u32*>(cache + (u64)ppu.cia * 2);
+			func != reinterpret_cast<uptr>(ppu_recompiler_fallback))
+		{
+			// Back to compiled code
+			return;
+		}
+
+		if (ppu.test_stopped())
+		{
+			return;
+		}
+	}
+}
+
 // Set or remove breakpoint
 extern void ppu_breakpoint(u32 addr, bool isAdding)
 {
 	if (g_cfg.core.ppu_decoder == ppu_decoder_type::llvm)
 	{
-		return;
+		return ppu_llvm_breakpoint(addr, isAdding);
 	}
 
 	const auto _break = ::narrow<u32>(reinterpret_cast<std::uintptr_t>(&ppu_break));
@@ -372,7 +567,7 @@ extern void ppu_set_breakpoint(u32 addr)
 {
 	if (g_cfg.core.ppu_decoder == ppu_decoder_type::llvm)
 	{
-		return;
+		return ppu_llvm_breakpoint(addr, true);
 	}
 
 	const auto _break = ::narrow<u32>(reinterpret_cast<std::uintptr_t>(&ppu_break));
@@ -388,7 +583,7 @@ extern void ppu_remove_breakpoint(u32 addr)
 {
 	if (g_cfg.core.ppu_decoder == ppu_decoder_type::llvm)
 	{
-		return;
+		return ppu_llvm_breakpoint(addr, false);
 	}
 
 	const auto _break = ::narrow<u32>(reinterpret_cast<std::uintptr_t>(&ppu_break));
@@ -447,6 +642,7 @@ std::string ppu_thread::dump() const
 	fmt::append(ret, "Stack: 0x%x..0x%x\n", stack_addr, stack_addr + stack_size - 1);
 	fmt::append(ret, "Joiner: %s\n", join_status(joiner.load()));
 	fmt::append(ret, "Commands: %u\n", cmd_queue.size());
+	fmt::append(ret, "Reservations: TX: %u (Aborts: %u, Skipped: %u), Lock: %u (Waited: %u)\n", res_tx_count, res_tx_abort, res_tx_skip, res_lock_fast, res_lock_wait);
 
 	const auto _func = last_function;
 
@@ -564,22 +760,26 @@ void ppu_thread::cpu_task()
 		case ppu_cmd::lle_call:
 		{
 			const vm::ptr<u32> opd(arg < 32 ? vm::cast(gpr[arg]) : vm::cast(arg));
+			timeline::scoped_event event("PPU", "LLE call", opd[0]);
 			cmd_pop(), fast_call(opd[0], opd[1]);
 			break;
 		}
 		case ppu_cmd::hle_call:
 		{
+			timeline::scoped_event event("PPU", "HLE call", arg);
 			cmd_pop(), ppu_function_manager::get().at(arg)(*this);
 			break;
 		}
 		case ppu_cmd::ptr_call:
 		{
 			const ppu_function_t func = cmd_get(1).as<ppu_function_t>();
+			timeline::scoped_event event("PPU", "Host call");
 			cmd_pop(1), func(*this);
 			break;
 		}
 		case ppu_cmd::initialize:
 		{
+			timeline::scoped_event event("PPU", "Initialize");
 			cmd_pop(), ppu_initialize();
 			break;
 		}
@@ -702,6 +902,11 @@ void ppu_thread::exec_task()
 
 ppu_thread::~ppu_thread()
 {
+	if (res_tx_count || res_tx_abort || res_lock_fast || res_lock_wait)
+	{
+		LOG_NOTICE(PPU, "Stats for %s: Reservation TX: %u (Aborts: %u, Skipped: %u); Lock: %u (Waited: %u);", ppu_name.get(), res_tx_count, res_tx_abort, res_tx_skip, res_lock_fast, res_lock_wait);
+	}
+
 	// Deallocate Stack Area
 	vm::dealloc_verbose_nothrow(stack_addr, vm::stack);
 }
@@ -926,6 +1131,7 @@ extern __m128 sse_exp2_ps(__m128 A);
 extern __m128 sse_log2_ps(__m128 A);
 extern __m128i sse_altivec_vperm(__m128i A, __m128i B, __m128i C);
 extern __m128i sse_altivec_vperm_v0(__m128i A, __m128i B, __m128i C);
+extern __m128i sse_altivec_vperm_vbmi(__m128i A, __m128i B, __m128i C);
 extern __m128i sse_altivec_lvsl(u64 addr);
 extern __m128i sse_altivec_lvsr(u64 addr);
 extern __m128i sse_cellbe_lvlx(u64 addr);
@@ -936,6 +1142,8 @@ extern __m128i sse_cellbe_lvlx_v0(u64 addr);
 extern __m128i sse_cellbe_lvrx_v0(u64 addr);
 extern void sse_cellbe_stvlx_v0(u64 addr, __m128i a);
 extern void sse_cellbe_stvrx_v0(u64 addr, __m128i a);
+extern u32 ppu_mmio_read32(u64 addr);
+extern void ppu_mmio_write32(u64 addr, u32 value);
 
 [[noreturn]] static void ppu_trap(ppu_thread& ppu, u64 addr)
 {
@@ -974,6 +1182,8 @@ static T ppu_load_acquire_reservation(ppu_thread& ppu, u32 addr)
 
 	ppu.raddr = addr;
 
+	vm::heatmap_sample(addr, sizeof(T));
+
 	u64 count = 0;
 
 	while (LIKELY(g_use_rtm))
@@ -1049,6 +1259,55 @@ extern u64 ppu_ldarx(ppu_thread& ppu, u32 addr)
 	return ppu_load_acquire_reservation<u64>(ppu, addr);
 }
 
+// Per-line contention scores for reservation stores (hashed by 128-byte reservation line)
+static std::array<atomic_t<u8>, 4096> s_ppu_res_contention{};
+
+static atomic_t<u8>& ppu_res_contention(u32 addr)
+{
+	return s_ppu_res_contention[(addr >> 7) % s_ppu_res_contention.size()];
+}
+
+// Check whether the transaction is worth trying for the reservation line
+static bool ppu_res_use_tx(ppu_thread& ppu, u32 addr)
+{
+	auto& score = ppu_res_contention(addr);
+
+	if (LIKELY(score.load() < 64))
+	{
+		return true;
+	}
+
+	// Skip the transaction, decay the score to retry it later
+	score.try_dec();
+	ppu.res_tx_skip++;
+	return false;
+}
+
+// Update contention score after the transaction attempt (aborted or committed)
+static void ppu_res_update_tx(ppu_thread& ppu, u32 addr, bool aborted)
+{
+	auto& score = ppu_res_contention(addr);
+
+	if (aborted)
+	{
+		score.atomic_op([](u8& value)
+		{
+			value = value >= 255 - 16 ? 255 : value + 16;
+		});
+
+		ppu.res_tx_abort++;
+	}
+	else
+	{
+		if (UNLIKELY(score.load()))
+		{
+			score.try_dec();
+		}
+
+		ppu.res_tx_count++;
+	}
+}
+
 const auto ppu_stwcx_tx = build_function_asm<u32(*)(u32 raddr, u64 rtime, u64 rdata, u32 value)>([](asmjit::X86Assembler& c, auto& args)
 {
 	using namespace asmjit;
@@ -1108,20 +1367,25 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 
 	if (LIKELY(g_use_rtm))
 	{
-		switch (ppu_stwcx_tx(addr, ppu.rtime, old_data, reg_value))
-		{
-		case 0:
-		{
-			// Reservation lost
-			ppu.raddr = 0;
-			return false;
-		}
-		case 1:
+		if (LIKELY(ppu_res_use_tx(ppu, addr)))
 		{
-			vm::reservation_notifier(addr, sizeof(u32)).notify_all();
-			ppu.raddr = 0;
-			return true;
-		}
+			const u32 tx = ppu_stwcx_tx(addr, ppu.rtime, old_data, reg_value);
+
+			if (tx == 0)
+			{
+				// Reservation lost
+				ppu.raddr = 0;
+				return false;
+			}
+
+			ppu_res_update_tx(ppu, addr, tx != 1);
+
+			if (tx == 1)
+			{
+				vm::reservation_notifier(addr, sizeof(u32)).notify_all();
+				ppu.raddr = 0;
+				return true;
+			}
 		}
 
 		auto& res = vm::reservation_acquire(addr, sizeof(u32));
@@ -1148,6 +1412,28 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 		return false;
 	}
 
+	// Try to lock uncontended reservation line without releasing passive lock
+	if (auto& res = vm::reservation_acquire(addr, sizeof(u32)); LIKELY(res.compare_and_swap_test(ppu.rtime, ppu.rtime | 1)))
+	{
+		const bool result = data.compare_and_swap_test(old_data, reg_value);
+
+		if (result)
+		{
+			res.release(ppu.rtime + 128);
+			vm::reservation_notifier(addr, sizeof(u32)).notify_all();
+		}
+		else
+		{
+			res.release(ppu.rtime);
+		}
+
+		ppu.res_lock_fast++;
+		ppu.raddr = 0;
+		return result;
+	}
+
+	ppu.res_lock_wait++;
+
 	vm::passive_unlock(ppu);
 
 	auto& res = vm::reservation_lock(addr, sizeof(u32));
@@ -1229,20 +1515,25 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 
 	if (LIKELY(g_use_rtm))
 	{
-		switch (ppu_stdcx_tx(addr, ppu.rtime, old_data, reg_value))
+		if (LIKELY(ppu_res_use_tx(ppu, addr)))
 		{
-		case 0:
-		{
-			// Reservation lost
-			ppu.raddr = 0;
-			return false;
-		}
-		case 1:
-		{
-			vm::reservation_notifier(addr, sizeof(u64)).notify_all();
-			ppu.raddr = 0;
-			return true;
-		}
+			const u32 tx = ppu_stdcx_tx(addr, ppu.rtime, old_data, reg_value);
+
+			if (tx == 0)
+			{
+				// Reservation lost
+				ppu.raddr = 0;
+				return false;
+			}
+
+			ppu_res_update_tx(ppu, addr, tx != 1);
+
+			if (tx == 1)
+			{
+				vm::reservation_notifier(addr, sizeof(u64)).notify_all();
+				ppu.raddr = 0;
+				return true;
+			}
 		}
 
 		auto& res = vm::reservation_acquire(addr, sizeof(u64));
@@ -1269,6 +1560,28 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 		return false;
 	}
 
+	// Try to lock uncontended reservation line without releasing passive lock
+	if (auto& res = vm::reservation_acquire(addr, sizeof(u64)); LIKELY(res.compare_and_swap_test(ppu.rtime, ppu.rtime | 1)))
+	{
+		const bool result = data.compare_and_swap_test(old_data, reg_value);
+
+		if (result)
+		{
+			res.release(ppu.rtime + 128);
+			vm::reservation_notifier(addr, sizeof(u64)).notify_all();
+		}
+		else
+		{
+			res.release(ppu.rtime);
+		}
+
+		ppu.res_lock_fast++;
+		ppu.raddr = 0;
+		return result;
+	}
+
+	ppu.res_lock_wait++;
+
 	vm::passive_unlock(ppu);
 
 	auto& res = vm::reservation_lock(addr, sizeof(u64));
@@ -1291,40 +1604,520 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 	return result;
 }
 
-extern void ppu_initialize()
+// Periodically samples load/store targets of PPU threads for the memory heat map
+struct ppu_heatmap_sampler
 {
-	const auto _main = fxm::get<ppu_module>();
-
-	if (!_main)
+	static void sample(ppu_thread& ppu)
 	{
-		return;
+		// Racy snapshot (registers are only up to date in interpreters)
+		const u32 cia = ppu.cia;
+
+		if (cia % 4 || !vm::check_addr(cia, 4))
+		{
+			return;
+		}
+
+		const ppu_opcode_t op{vm::read32(cia)};
+		const u64 ra = op.ra ? ppu.gpr[op.ra] : 0;
+
+		switch (op.main)
+		{
+		case 31:
+		{
+			switch (s_ppu_itype.decode(op.opcode))
+			{
+			case ppu_itype::LBZX:
+			case ppu_itype::LHZX:
+			case ppu_itype::LWZX:
+			case ppu_itype::LDX:
+			case ppu_itype::LHAX:
+			case ppu_itype::LWAX:
+			case ppu_itype::LBZUX:
+			case ppu_itype::LHZUX:
+			case ppu_itype::LWZUX:
+			case ppu_itype::LDUX:
+			case ppu_itype::LHAUX:
+			case ppu_itype::LWAUX:
+			case ppu_itype::STBX:
+			case ppu_itype::STHX:
+			case ppu_itype::STWX:
+			case ppu_itype::STDX:
+			case ppu_itype::STBUX:
+			case ppu_itype::STHUX:
+			case ppu_itype::STWUX:
+			case ppu_itype::STDUX:
+			case ppu_itype::LFSX:
+			case ppu_itype::LFDX:
+			case ppu_itype::LFSUX:
+			case ppu_itype::LFDUX:
+			case ppu_itype::STFSX:
+			case ppu_itype::STFDX:
+			case ppu_itype::STFSUX:
+			case ppu_itype::STFDUX:
+			case ppu_itype::LVX:
+			case ppu_itype::LVXL:
+			case ppu_itype::STVX:
+			case ppu_itype::STVXL:
+			case ppu_itype::LWBRX:
+			case ppu_itype::STWBRX:
+			case ppu_itype::LHBRX:
+			case ppu_itype::STHBRX:
+			case ppu_itype::LDBRX:
+			case ppu_itype::STDBRX:
+			case ppu_itype::DCBZ:
+			{
+				return vm::heatmap_sample(static_cast<u32>(ra + ppu.gpr[op.rb]));
+			}
+			default: return;
+			}
+		}
+		case 58:
+		case 62:
+		{
+			// DS-form (LD, LDU, LWA, STD, STDU)
+			return vm::heatmap_sample(static_cast<u32>(ra + (op.simm16 & ~3)));
+		}
+		default:
+		{
+			// D-form loads and stores
+			if (op.main >= 32 && op.main <= 55)
+			{
+				vm::heatmap_sample(static_cast<u32>(ra + op.simm16));
+			}
+
+			return;
+		}
+		}
 	}
 
-	if (Emu.IsStopped())
+	void operator()()
 	{
-		return;
+		while (thread_ctrl::state() != thread_state::aborting)
+		{
+			idm::select<named_thread<ppu_thread>>([](u32, ppu_thread& ppu)
+			{
+				sample(ppu);
+			});
+
+			thread_ctrl::wait_for(1000);
+		}
 	}
+};
 
-	// Initialize main module
-	ppu_initialize(*_main);
+extern void ppu_start_compile_benchmark(const std::string& output_path)
+{
+	auto& bench = ppu_compile_benchmark::get();
 
-	std::vector<lv2_prx*> prx_list;
+	std::lock_guard lock(bench.mutex);
+	bench.output_path = output_path;
+	bench.start_time = get_system_time();
+	bench.parts.clear();
+	bench.enabled = true;
 
-	idm::select<lv2_obj, lv2_prx>([&](u32, lv2_prx& prx)
-	{
-		prx_list.emplace_back(&prx);
-	});
+#ifdef LLVM_AVAILABLE
+	// Per-pass timers of the legacy pass manager, printed by LLVM to stderr on exit
+	llvm::TimePassesIsEnabled = true;
+#endif
+}
 
-	// Initialize preloaded libraries
-	for (auto ptr : prx_list)
+extern bool ppu_finish_compile_benchmark()
+{
+	auto& bench = ppu_compile_benchmark::get();
+
+	if (!bench.enabled.exchange(false))
 	{
-		ppu_initialize(*ptr);
+		return false;
+	}
+
+	std::lock_guard lock(bench.mutex);
+
+	const u64 wall_time = get_system_time() - bench.start_time;
+
+	fs::file out(bench.output_path, fs::rewrite);
+
+	if (!out)
+	{
+		LOG_ERROR(PPU, "Compile benchmark: failed to create %s (%s)", bench.output_path, fs::g_tls_error);
+		return true;
+	}
+
+	out.write("module,object,functions,code_bytes,translate_us,optimize_us,codegen_us,total_us,object_bytes\n");
+
+	ppu_compile_benchmark::part_stats total;
+
+	for (const auto& part : bench.parts)
+	{
+		out.write(fmt::format("%s,%s,%u,%u,%u,%u,%u,%u,%u\n", part.module, part.obj_name, part.funcs, part.code_size, part.translate_us, part.optimize_us, part.codegen_us,
+			part.translate_us + part.optimize_us + part.codegen_us, part.object_size));
+
+		total.funcs += part.funcs;
+		total.code_size += part.code_size;
+		total.translate_us += part.translate_us;
+		total.optimize_us += part.optimize_us;
+		total.codegen_us += part.codegen_us;
+		total.object_size += part.object_size;
+	}
+
+	LOG_SUCCESS(PPU, "Compile benchmark: %u parts, %u functions, %u KiB of code in %.3f s using %u threads (pipeline: %s)",
+		bench.parts.size(), total.funcs, total.code_size / 1024, wall_time / 1000000., g_cfg.core.llvm_threads ? +g_cfg.core.llvm_threads : std::thread::hardware_concurrency(), g_cfg.core.llvm_pipeline.get());
+	LOG_SUCCESS(PPU, "Compile benchmark: translate %.3f s, optimize %.3f s, codegen %.3f s (summed over threads), %u KiB of objects, results written to %s",
+		total.translate_us / 1000000., total.optimize_us / 1000000., total.codegen_us / 1000000., total.object_size / 1024, bench.output_path);
+
+	return true;
+}
+
+extern void ppu_initialize()
+{
+	const auto _main = fxm::get<ppu_module>();
+
+	if (!_main)
+	{
+		return;
+	}
+
+	if (Emu.IsStopped())
+	{
+		return;
+	}
+
+	if (vm::g_heatmap)
+	{
+		fxm::get_always<named_thread<ppu_heatmap_sampler>>("PPU Heat Map Sampler");
+	}
+
+	// Initialize main module
+	ppu_initialize(*_main);
+
+	std::vector<lv2_prx*> prx_list;
+
+	idm::select<lv2_obj, lv2_prx>([&](u32, lv2_prx& prx)
+	{
+		prx_list.emplace_back(&prx);
+	});
+
+	// Initialize preloaded libraries
+	for (auto ptr : prx_list)
+	{
+		ppu_initialize(*ptr);
+	}
+
+	extern bool ppu_finish_compile_benchmark();
+
+	if (ppu_finish_compile_benchmark())
+	{
+		Emu.CallAfter([]()
+		{
+			// Benchmarks are started from the command line, leave once the results are out
+			Emu.Stop();
+
+			if (!g_cfg.misc.autoexit)
+			{
+				Emu.GetCallbacks().exit();
+			}
+		});
+
+		return;
 	}
 
 	// Initialize SPU cache
 	spu_cache::initialize();
 }
 
+#ifdef LLVM_AVAILABLE
+// Compiler mutex (global, protects primary JIT instances)
+static shared_mutex s_jit_mutex;
+
+// Copy an object compiled elsewhere from the remote cache directory (object names already contain the code hash, settings and CPU)
+// Get the "ppu/" subdirectory of the remote cache directory (empty if not configured)
+static std::string ppu_get_remote_dir()
+{
+	std::string remote = g_cfg.core.llvm_remote_cache.to_string();
+
+	if (remote.empty())
+	{
+		return remote;
+	}
+
+	if (remote.back() != '/' && remote.back() != '\\')
+	{
+		remote += '/';
+	}
+
+	return remote + "ppu/";
+}
+
+static bool ppu_fetch_remote_object(const std::string& cache_path, const std::string& obj_name)
+{
+	const std::string remote = ppu_get_remote_dir();
+
+	if (remote.empty() || !fs::is_file(remote + obj_name))
+	{
+		return false;
+	}
+
+	if (!fs::copy_file(remote + obj_name, cache_path + obj_name, false))
+	{
+		LOG_ERROR(PPU, "LLVM: Failed to fetch %s from the remote cache (%s)", obj_name, fs::g_tls_error);
+		return false;
+	}
+
+	LOG_NOTICE(PPU, "LLVM: Fetched module %s from the remote cache", obj_name);
+	return true;
+}
+
+// Publish a compiled object for the other instances using the same remote cache directory
+static void ppu_store_remote_object(const std::string& cache_path, const std::string& obj_name)
+{
+	const std::string remote = ppu_get_remote_dir();
+
+	if (remote.empty() || fs::is_file(remote + obj_name))
+	{
+		return;
+	}
+
+	// Copy under a unique name first, readers must never see a partial object
+	const std::string tmp = fmt::format("%s%s.%x.tmp", remote, obj_name, std::chrono::steady_clock::now().time_since_epoch().count());
+
+	if (!fs::create_path(remote) || !fs::copy_file(cache_path + obj_name, tmp, true) || !fs::rename(tmp, remote + obj_name, true))
+	{
+		LOG_ERROR(PPU, "LLVM: Failed to store %s in the remote cache (%s)", obj_name, fs::g_tls_error);
+		fs::remove_file(tmp);
+	}
+}
+
+// PPU module part scheduled for compilation
+struct ppu_llvm_job
+{
+	std::string jit_name; // Module key (JIT instance)
+	std::string cache_path;
+	std::string obj_name;
+	ppu_module part;
+	std::size_t size = 0; // Code size in bytes
+	std::vector<std::pair<std::string, u64>> globals; // Global variables of this part
+
+	bool hot = false; // Requested by running code
+	bool done = false;
+};
+
+// Background compiler for PPU LLVM lazy compilation mode
+struct ppu_llvm_worker
+{
+	const std::unordered_map<std::string, u64>& link_table;
+
+	// Deferred module parts
+	lf_queue<ppu_llvm_job> registered;
+
+	// Addresses of functions entered through the interpreter fallback
+	lf_queue<u32> requests;
+
+	// Recently requested addresses (filters repeated requests)
+	std::array<atomic_t<u32>, 4096> requested{};
+
+	ppu_llvm_worker(const std::unordered_map<std::string, u64>& link_table)
+		: link_table(link_table)
+	{
+	}
+
+	void operator()()
+	{
+		// Don't compete with PPU threads
+		thread_ctrl::set_native_priority(-1);
+
+		// JIT instances (one per module, symbol names are only unique within a module)
+		std::unordered_map<std::string, std::unique_ptr<jit_compiler>> jits;
+
+		// Pending parts (in order of submission) and requested parts
+		std::deque<std::shared_ptr<ppu_llvm_job>> pending, hot;
+
+		// Function address -> part containing it
+		std::unordered_map<u32, std::shared_ptr<ppu_llvm_job>> lookup;
+
+		while (thread_ctrl::state() != thread_state::aborting)
+		{
+			for (auto&& job : registered.pop_all())
+			{
+				const auto ptr = std::make_shared<ppu_llvm_job>(std::move(job));
+
+				for (const auto& func : ptr->part.funcs)
+				{
+					lookup.insert_or_assign(func.addr, ptr);
+				}
+
+				pending.emplace_back(ptr);
+			}
+
+			for (const u32 addr : requests.pop_all())
+			{
+				if (const auto found = lookup.find(addr); found != lookup.end() && !found->second->hot)
+				{
+					found->second->hot = true;
+					hot.emplace_back(found->second);
+				}
+			}
+
+			// Drop finished parts
+			while (!hot.empty() && hot.front()->done)
+			{
+				hot.pop_front();
+			}
+
+			while (!pending.empty() && pending.front()->done)
+			{
+				pending.pop_front();
+			}
+
+			if (pending.empty())
+			{
+				registered.wait(10000);
+				continue;
+			}
+
+			const auto job = hot.empty() ? pending.front() : hot.front();
+			job->done = true;
+
+			for (const auto& func : job->part.funcs)
+			{
+				lookup.erase(func.addr);
+			}
+
+			if (Emu.IsStopped())
+			{
+				continue;
+			}
+
+			auto& jit = jits[job->jit_name];
+
+			if (!jit)
+			{
+				jit = std::make_unique<jit_compiler>(link_table, g_cfg.core.llvm_cpu, g_cfg.core.llvm_compress_cache ? 0x4 : 0);
+			}
+
+			LOG_WARNING(PPU, "LLVM: Compiling module %s%s (lazy)", job->cache_path, job->obj_name);
+
+			std::lock_guard lock(s_jit_mutex);
+
+			ppu_initialize2(*jit, job->part, job->cache_path, job->obj_name);
+
+			if (Emu.IsStopped())
+			{
+				continue;
+			}
+
+			jit->fin();
+
+			ppu_store_remote_object(job->cache_path, job->obj_name);
+
+			// Initialize global variables before the code becomes reachable
+			for (const auto& var : job->globals)
+			{
+				if (const u64 addr = jit->get(var.first))
+				{
+					*reinterpret_cast<u64*>(addr) = var.second;
+				}
+			}
+
+			// Install functions, the interpreter fallback switches to them on the next call
+			for (const auto& func : job->part.funcs)
+			{
+				if (!func.size)
+				{
+					continue;
+				}
+
+				if (const u64 addr = jit->get(func.name))
+				{
+					ppu_ref<u32>(func.addr) = ::narrow<u32>(addr);
+				}
+			}
+
+			g_ppu_modules_compiled++;
+			LOG_SUCCESS(PPU, "LLVM: Compiled module %s (lazy)", job->obj_name);
+		}
+	}
+};
+#endif
+
+#ifdef LLVM_AVAILABLE
+// Function entry counters of compiled PPU modules (PPU Profile-Guided Optimization)
+struct ppu_llvm_profiler
+{
+	struct module_info
+	{
+		std::string path; // Profile file
+		std::vector<std::pair<u32, const u64*>> counters; // Relative function address -> entry counter
+	};
+
+	std::vector<module_info> modules;
+
+	ppu_llvm_profiler() = default;
+
+	ppu_llvm_profiler(const ppu_llvm_profiler&) = delete;
+
+	ppu_llvm_profiler& operator=(const ppu_llvm_profiler&) = delete;
+
+	// Save hot function lists (called on emulation stop)
+	~ppu_llvm_profiler()
+	{
+		for (const auto& info : modules)
+		{
+			std::vector<std::pair<u64, u32>> funcs;
+			u64 total = 0;
+
+			for (const auto& [addr, counter] : info.counters)
+			{
+				if (const u64 count = *counter)
+				{
+					funcs.emplace_back(count, addr);
+					total += count;
+				}
+			}
+
+			if (!total)
+			{
+				continue;
+			}
+
+			std::sort(funcs.begin(), funcs.end(), std::greater<>());
+
+			// Take the hottest functions which account for 90% of all calls
+			std::vector<u32> hot;
+			u64 sum = 0;
+
+			for (const auto& [count, addr] : funcs)
+			{
+				if (sum >= total / 10 * 9 || hot.size() >= 2000)
+				{
+					break;
+				}
+
+				hot.push_back(addr);
+				sum += count;
+			}
+
+			std::sort(hot.begin(), hot.end());
+
+			if (fs::write_file(info.path, fs::rewrite, hot))
+			{
+				LOG_NOTICE(PPU, "LLVM: Saved %zu hot functions (of %zu called) to %s", hot.size(), funcs.size(), info.path);
+			}
+		}
+	}
+};
+#endif
+
+static void ppu_llvm_request(u32 addr)
+{
+#ifdef LLVM_AVAILABLE
+	if (const auto worker = fxm::check_unlocked<named_thread<ppu_llvm_worker>>())
+	{
+		if (worker->requested[(addr >> 2) % 4096].exchange(addr) != addr)
+		{
+			worker->requests.push(addr);
+		}
+	}
+#endif
+}
+
 extern void ppu_initialize(const ppu_module& info)
 {
 	if (g_cfg.core.ppu_decoder != ppu_decoder_type::llvm)
@@ -1359,6 +2152,7 @@ extern void ppu_initialize(const ppu_module& info)
 			{ "__trap", (u64)&ppu_trap },
 			{ "__error", (u64)&ppu_error },
 			{ "__check", (u64)&ppu_check },
+			{ "__break", (u64)&ppu_llvm_break },
 			{ "__trace", (u64)&ppu_trace },
 			{ "__syscall", (u64)&ppu_execute_syscall },
 			{ "__get_tb", (u64)&get_timebased_time },
@@ -1368,7 +2162,7 @@ extern void ppu_initialize(const ppu_module& info)
 			{ "__stdcx", (u64)&ppu_stdcx },
 			{ "__vexptefp", (u64)&sse_exp2_ps },
 			{ "__vlogefp", (u64)&sse_log2_ps },
-			{ "__vperm", s_use_ssse3 ? (u64)&sse_altivec_vperm : (u64)&sse_altivec_vperm_v0 }, // Obsolete
+			{ "__vperm", utils::has_avx512_vbmi() ? (u64)&sse_altivec_vperm_vbmi : s_use_ssse3 ? (u64)&sse_altivec_vperm : (u64)&sse_altivec_vperm_v0 }, // Obsolete
 			{ "__lvsl", (u64)&sse_altivec_lvsl },
 			{ "__lvsr", (u64)&sse_altivec_lvsr },
 			{ "__lvlx", s_use_ssse3 ? (u64)&sse_cellbe_lvlx : (u64)&sse_cellbe_lvlx_v0 },
@@ -1376,6 +2170,8 @@ extern void ppu_initialize(const ppu_module& info)
 			{ "__stvlx", s_use_ssse3 ? (u64)&sse_cellbe_stvlx : (u64)&sse_cellbe_stvlx_v0 },
 			{ "__stvrx", s_use_ssse3 ? (u64)&sse_cellbe_stvrx : (u64)&sse_cellbe_stvrx_v0 },
 			{ "__resupdate", (u64)&vm::reservation_update },
+			{ "__mmio_read32", (u64)&ppu_mmio_read32 },
+			{ "__mmio_write32", (u64)&ppu_mmio_write32 },
 		};
 
 		for (u64 index = 0; index < 1024; index++)
@@ -1387,6 +2183,17 @@ extern void ppu_initialize(const ppu_module& info)
 			}
 		}
 
+		// HLE functions (for direct calls)
+		const auto& hle_funcs = ppu_function_manager::get();
+
+		for (std::size_t index = 2; index < std::min(hle_funcs.size(), g_ppu_function_names.size()); index++)
+		{
+			if (!g_ppu_function_names[index].empty())
+			{
+				link_table.emplace("__hle_" + g_ppu_function_names[index], (u64)hle_funcs[index]);
+			}
+		}
+
 		return link_table;
 	}();
 
@@ -1404,15 +2211,22 @@ extern void ppu_initialize(const ppu_module& info)
 
 		const std::string dev_flash = vfs::get("/dev_flash/");
 
+		// PPU hash and filename (directory name is content-addressed)
+		const std::string mod_dir = fmt::format("ppu-%s-%s/", fmt::base57(info.sha1), info.path.substr(info.path.find_last_of('/') + 1));
+
 		if (info.path.compare(0, dev_flash.size(), dev_flash) != 0 && !Emu.GetTitleID().empty() && Emu.GetCat() != "1P")
 		{
 			// Add prefix for anything except dev_flash files, standalone elfs or PS1 classics
-			cache_path += Emu.GetTitleID();
-			cache_path += '/';
+			const std::string title_path = cache_path + Emu.GetTitleID() + '/';
+
+			// Identical libraries shipped with many titles (libsre, etc.) can use the shared location, unless already compiled for this title
+			if (!g_cfg.core.llvm_shared_cache || fs::is_dir(title_path + mod_dir))
+			{
+				cache_path = title_path;
+			}
 		}
 
-		// Add PPU hash and filename
-		fmt::append(cache_path, "ppu-%s-%s/", fmt::base57(info.sha1), info.path.substr(info.path.find_last_of('/') + 1));
+		cache_path += mod_dir;
 
 		if (!fs::create_path(cache_path))
 		{
@@ -1447,57 +2261,105 @@ extern void ppu_initialize(const ppu_module& info)
 	// Compiler instance (deferred initialization)
 	std::shared_ptr<jit_compiler> jit;
 
-	// Compiler mutex (global)
-	static shared_mutex jmutex;
-
 	// Initialize global semaphore with the max number of threads
 	u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
 	s32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
 	const auto jcores = fxm::get_always<jit_core_allocator>(std::max<s32>(thread_count, 1));
 
-	// Worker threads
-	std::vector<std::thread> jthreads;
+	// Module parts to compile
+	std::vector<ppu_llvm_job> workload;
 
 	// Global variables to initialize
 	std::vector<std::pair<std::string, u64>> globals;
 
-	// Split module into fragments <= 1 MiB
-	std::size_t fpos = 0;
+	// Fragment size limit: a patched function only invalidates the fragment containing it
+	const std::size_t part_limit = g_cfg.core.llvm_part_size * 1024;
 
 	// Difference between function name and current location
 	const u32 reloc = info.name.empty() ? 0 : info.segs.at(0).addr;
 
-	while (jit_mod.vars.empty() && fpos < info.funcs.size())
+	// Hot functions (relative addresses) recorded by the profiler on previous runs
+	std::unordered_set<u32> hot_funcs;
+
+	if (g_cfg.core.ppu_profile_guided)
+	{
+		if (const fs::file profile{cache_path + "ppu-profile.dat"})
+		{
+			const auto list = profile.to_vector<u32>();
+			hot_funcs.insert(list.begin(), list.end());
+		}
+	}
+
+	// Functions containing patched code are compiled as separate parts, linked by name like any other part
+	const auto is_patched = [&](const ppu_function& func)
 	{
+		const auto found = std::lower_bound(info.patches.cbegin(), info.patches.cend(), func.addr);
+		return found != info.patches.cend() && *found < func.addr + func.size;
+	};
+
+	// Split module into small fragments, each cached as a separate object file
+	// Boundaries don't depend on patches, so editing a patch doesn't change the hash of the surrounding fragment
+	std::vector<std::vector<std::size_t>> part_list;
+	std::vector<std::vector<std::size_t>> patched_parts;
+
+	for (std::size_t i = 0, bsize = 0; i < info.funcs.size(); i++)
+	{
+		const auto& func = info.funcs[i];
+
+		if (part_list.empty() || (bsize + func.size > part_limit && bsize))
+		{
+			part_list.emplace_back();
+			bsize = 0;
+		}
+
+		for (auto&& block : func.blocks)
+		{
+			bsize += block.second;
+		}
+
+		if (is_patched(func))
+		{
+			patched_parts.emplace_back(1, i);
+		}
+		else
+		{
+			part_list.back().emplace_back(i);
+		}
+	}
+
+	part_list.insert(part_list.end(), patched_parts.begin(), patched_parts.end());
+
+	for (std::size_t ppos = 0; jit_mod.vars.empty() && ppos < part_list.size(); ppos++)
+	{
+		const auto& func_ids = part_list[ppos];
+
+		if (func_ids.empty())
+		{
+			// Every function of the fragment is patched
+			continue;
+		}
+
 		// Initialize compiler instance
 		if (!jit && get_current_cpu_thread())
 		{
 			jit = std::make_shared<jit_compiler>(s_link_table, g_cfg.core.llvm_cpu);
 		}
 
-		// First function in current module part
-		const auto fstart = fpos;
-
 		// Copy module information (TODO: optimize)
 		ppu_module part;
 		part.copy_part(info);
 		part.funcs.reserve(16000);
 
 		// Unique suffix for each module part
-		const u32 suffix = info.funcs.at(fstart).addr - reloc;
+		const u32 suffix = info.funcs.at(func_ids[0]).addr - reloc;
 
 		// Overall block size in bytes
 		std::size_t bsize = 0;
 
-		while (fpos < info.funcs.size())
+		for (const std::size_t fpos : func_ids)
 		{
 			auto& func = info.funcs[fpos];
 
-			if (bsize + func.size > 100 * 1024 && bsize)
-			{
-				break;
-			}
-
 			for (auto&& block : func.blocks)
 			{
 				bsize += block.second;
@@ -1508,10 +2370,14 @@ extern void ppu_initialize(const ppu_module& info)
 				entry.size = block.second;
 				entry.toc  = func.toc;
 				fmt::append(entry.name, "__0x%x", block.first - reloc);
+
+				if (hot_funcs.count(block.first - reloc))
+				{
+					entry.attr += ppu_attr::hot;
+				}
+
 				part.funcs.emplace_back(std::move(entry));
 			}
-
-			fpos++;
 		}
 
 		// Compute module hash to generate (hopefully) unique object name
@@ -1533,6 +2399,13 @@ extern void ppu_initialize(const ppu_module& info)
 				sha1_update(&ctx, reinterpret_cast<const u8*>(&addr), sizeof(addr));
 				sha1_update(&ctx, reinterpret_cast<const u8*>(&size), sizeof(size));
 
+				if (func.attr & ppu_attr::hot)
+				{
+					// Hot functions are optimized differently
+					const be_t<u32> hot = 1;
+					sha1_update(&ctx, reinterpret_cast<const u8*>(&hot), sizeof(hot));
+				}
+
 				for (const auto& block : func.blocks)
 				{
 					if (block.second == 0 || reloc)
@@ -1588,6 +2461,11 @@ extern void ppu_initialize(const ppu_module& info)
 			enum class ppu_settings : u32
 			{
 				non_win32,
+				entry_counters,
+				breakpoint_checks,
+				pipeline_minimal,
+				pipeline_extended,
+				table_calls,
 
 				__bitset_enum_max
 			};
@@ -1597,6 +2475,29 @@ extern void ppu_initialize(const ppu_module& info)
 #ifndef _WIN32
 			settings += ppu_settings::non_win32;
 #endif
+			if (g_cfg.core.ppu_profile_guided)
+			{
+				settings += ppu_settings::entry_counters;
+			}
+
+			if (g_cfg.core.ppu_llvm_breakpoints)
+			{
+				settings += ppu_settings::breakpoint_checks;
+			}
+
+			if (g_cfg.core.llvm_pipeline == ppu_llvm_pipeline::minimal)
+			{
+				settings += ppu_settings::pipeline_minimal;
+			}
+			else if (g_cfg.core.llvm_pipeline == ppu_llvm_pipeline::extended)
+			{
+				settings += ppu_settings::pipeline_extended;
+			}
+
+			if (g_cfg.core.llvm_lazy)
+			{
+				settings += ppu_settings::table_calls;
+			}
 
 			// Write version, hash, CPU, settings
 			fmt::append(obj_name, "v3-tane-%s-%s-%s.obj", fmt::base57(output, 16), fmt::base57(settings), jit_compiler::cpu(g_cfg.core.llvm_cpu));
@@ -1607,6 +2508,8 @@ extern void ppu_initialize(const ppu_module& info)
 			break;
 		}
 
+		const std::size_t gpos = globals.size();
+
 		globals.emplace_back(fmt::format("__mptr%x", suffix), (u64)vm::g_base_addr);
 		globals.emplace_back(fmt::format("__cptr%x", suffix), (u64)vm::g_exec_addr);
 
@@ -1616,8 +2519,14 @@ extern void ppu_initialize(const ppu_module& info)
 			globals.emplace_back(fmt::format("__seg%u_%x", i, suffix), info.segs[i].addr);
 		}
 
-		// Check object file
-		if (fs::is_file(cache_path + obj_name))
+		// Breakpoint line table (only defined if breakpoint checks are compiled)
+		globals.emplace_back(fmt::format("__bptr%x", suffix), (u64)+s_ppu_break_lines);
+
+		// TSC to timebase conversion parameters (inlined MFTB)
+		globals.emplace_back(fmt::format("__tbptr%x", suffix), (u64)&g_tsc_timebase);
+
+		// Check object file (always compiled again by the compile benchmark)
+		if ((fs::is_file(cache_path + obj_name) || ppu_fetch_remote_object(cache_path, obj_name)) && !ppu_compile_benchmark::get().enabled)
 		{
 			if (!jit)
 			{
@@ -1625,9 +2534,10 @@ extern void ppu_initialize(const ppu_module& info)
 				continue;
 			}
 
-			std::lock_guard lock(jmutex);
+			std::lock_guard lock(s_jit_mutex);
 			jit->add(cache_path + obj_name);
 
+			g_ppu_modules_loaded++;
 			LOG_SUCCESS(PPU, "LLVM: Loaded module %s", obj_name);
 			continue;
 		}
@@ -1635,46 +2545,120 @@ extern void ppu_initialize(const ppu_module& info)
 		// Update progress dialog
 		g_progr_ptotal++;
 
-		// Create worker thread for compilation
-		jthreads.emplace_back([&jit, obj_name = obj_name, part = std::move(part), &cache_path, jcores]()
+		auto& job = workload.emplace_back();
+		job.jit_name = cache_path + info.name;
+		job.cache_path = cache_path;
+		job.obj_name = std::move(obj_name);
+		job.part = std::move(part);
+		job.size = bsize;
+		job.globals.assign(globals.begin() + gpos, globals.end());
+	}
+
+	// Compile largest parts first to improve load balancing
+	std::stable_sort(workload.begin(), workload.end(), [](const ppu_llvm_job& a, const ppu_llvm_job& b)
+	{
+		return a.size > b.size;
+	});
+
+	// Parts deferred to the background compiler (submitted after installing compiled functions)
+	std::vector<ppu_llvm_job> deferred;
+
+	if (g_cfg.core.llvm_lazy && jit && !ppu_compile_benchmark::get().enabled)
+	{
+		// Uncompiled functions run in the interpreter meanwhile
+		g_progr_pdone += ::size32(workload);
+		deferred = std::move(workload);
+		workload.clear();
+	}
+
+	// Next part to compile
+	atomic_t<std::size_t> work_index{0};
+
+	// Compile jobs on the worker pool (no more than the allowed number of compile threads)
+	worker_pool::group jgroup;
+
+	for (std::size_t t = 0, max = std::min<std::size_t>(workload.size(), std::max<s32>(thread_count, 1)); t < max; t++)
+	{
+		worker_pool::get().submit(worker_priority::compile, [&]()
 		{
-			// Set low priority
-			thread_ctrl::set_native_priority(-1);
+			// Use another JIT instance (reused for parts compiled by this worker)
+			std::unique_ptr<jit_compiler> jit2;
+
+			// Code size compiled by jit2, its memory manager never frees the sections it loads
+			std::size_t jit2_size = 0;
 
-			// Allocate "core"
+			for (std::size_t i = work_index++; i < workload.size(); i = work_index++)
 			{
-				std::lock_guard jlock(jcores->sem);
+				const auto& obj_name = workload[i].obj_name;
+				const auto& part = workload[i].part;
 
-				if (!Emu.IsStopped())
+				// Allocate "core"
 				{
-					LOG_WARNING(PPU, "LLVM: Compiling module %s%s", cache_path, obj_name);
+					std::lock_guard jlock(jcores->sem);
+
+					if (!Emu.IsStopped() && !worker_pool::is_cancelled())
+					{
+						LOG_WARNING(PPU, "LLVM: Compiling module %s%s", cache_path, obj_name);
+
+						if (jit2 && jit2_size >= 0x400000)
+						{
+							// Objects are already written to the cache, release the memory
+							jit2.reset();
+						}
+
+						if (!jit2)
+						{
+							jit2 = std::make_unique<jit_compiler>(std::unordered_map<std::string, u64>{}, g_cfg.core.llvm_cpu, g_cfg.core.llvm_compress_cache ? 0x5 : 0x1);
+							jit2_size = 0;
+						}
+
+						jit2_size += workload[i].size;
 
-					// Use another JIT instance
-					jit_compiler jit2({}, g_cfg.core.llvm_cpu, 0x1);
-					ppu_initialize2(jit2, part, cache_path, obj_name);
+						if (auto& bench = ppu_compile_benchmark::get(); bench.enabled)
+						{
+							ppu_compile_benchmark::part_stats stats;
+							stats.module = info.name.empty() ? info.path.substr(info.path.find_last_of('/') + 1) : info.name;
+							stats.obj_name = obj_name;
+							stats.code_size = workload[i].size;
+
+							ppu_initialize2(*jit2, part, cache_path, obj_name, &stats);
+
+							if (fs::stat_t st; fs::stat(cache_path + obj_name, st))
+							{
+								stats.object_size = st.size;
+							}
+
+							std::lock_guard lock(bench.mutex);
+							bench.parts.emplace_back(std::move(stats));
+						}
+						else
+						{
+							ppu_initialize2(*jit2, part, cache_path, obj_name);
+						}
+					}
+
+					g_progr_pdone++;
 				}
 
-				g_progr_pdone++;
-			}
+				if (Emu.IsStopped() || !jit || !fs::is_file(cache_path + obj_name))
+				{
+					continue;
+				}
 
-			if (Emu.IsStopped() || !jit || !fs::is_file(cache_path + obj_name))
-			{
-				return;
-			}
+				ppu_store_remote_object(cache_path, obj_name);
 
-			// Proceed with original JIT instance
-			std::lock_guard lock(jmutex);
-			jit->add(cache_path + obj_name);
+				// Proceed with original JIT instance
+				std::lock_guard lock(s_jit_mutex);
+				jit->add(cache_path + obj_name);
 
-			LOG_SUCCESS(PPU, "LLVM: Compiled module %s", obj_name);
-		});
+				g_ppu_modules_compiled++;
+				LOG_SUCCESS(PPU, "LLVM: Compiled module %s", obj_name);
+			}
+		}, &jgroup);
 	}
 
-	// Join worker threads
-	for (auto& thread : jthreads)
-	{
-		thread.join();
-	}
+	// Wait for the compile jobs
+	jgroup.wait();
 
 	if (Emu.IsStopped() || !get_current_cpu_thread())
 	{
@@ -1684,7 +2668,7 @@ extern void ppu_initialize(const ppu_module& info)
 	// Jit can be null if the loop doesn't ever enter.
 	if (jit && jit_mod.vars.empty())
 	{
-		std::lock_guard lock(jmutex);
+		std::lock_guard lock(s_jit_mutex);
 		jit->fin();
 
 		// Get and install function addresses
@@ -1697,6 +2681,14 @@ extern void ppu_initialize(const ppu_module& info)
 				if (block.second)
 				{
 					const u64 addr = jit->get(fmt::format("__0x%x", block.first - reloc));
+
+					if (!addr)
+					{
+						// Not compiled yet (lazy compilation), keep the fallback
+						jit_mod.funcs.emplace_back(reinterpret_cast<ppu_function_t>(ppu_recompiler_fallback));
+						continue;
+					}
+
 					jit_mod.funcs.emplace_back(reinterpret_cast<ppu_function_t>(addr));
 					ppu_ref<u32>(block.first) = ::narrow<u32>(addr);
 				}
@@ -1715,6 +2707,35 @@ extern void ppu_initialize(const ppu_module& info)
 				*reinterpret_cast<u64*>(addr) = var.second;
 			}
 		}
+
+		if (g_cfg.core.ppu_profile_guided)
+		{
+			ppu_llvm_profiler::module_info prof;
+			prof.path = cache_path + "ppu-profile.dat";
+
+			for (const auto& func : info.funcs)
+			{
+				for (const auto& block : func.blocks)
+				{
+					if (const u64 addr = block.second ? jit->get(fmt::format("__cnt__0x%x", block.first - reloc)) : 0)
+					{
+						prof.counters.emplace_back(block.first - reloc, reinterpret_cast<const u64*>(addr));
+					}
+				}
+			}
+
+			fxm::get_always<ppu_llvm_profiler>()->modules.emplace_back(std::move(prof));
+		}
+
+		if (!deferred.empty())
+		{
+			const auto worker = fxm::get_always<named_thread<ppu_llvm_worker>>("PPU LLVM Worker", s_link_table);
+
+			for (auto& job : deferred)
+			{
+				worker->registered.push(std::move(job));
+			}
+		}
 	}
 	else
 	{
@@ -1736,16 +2757,26 @@ extern void ppu_initialize(const ppu_module& info)
 
 		index = 0;
 
-		// Rewrite global variables
+		// Rewrite global variables (null if the part wasn't compiled)
+		auto rewrite = [&](u64 value)
+		{
+			if (const auto ptr = jit_mod.vars[index++])
+			{
+				*ptr = value;
+			}
+		};
+
 		while (index < jit_mod.vars.size())
 		{
-			*jit_mod.vars[index++] = (u64)vm::g_base_addr;
-			*jit_mod.vars[index++] = (u64)vm::g_exec_addr;
+			rewrite((u64)vm::g_base_addr);
+			rewrite((u64)vm::g_exec_addr);
 
 			for (const auto& seg : info.segs)
 			{
-				*jit_mod.vars[index++] = seg.addr;
+				rewrite(seg.addr);
 			}
+
+			rewrite((u64)+s_ppu_break_lines);
 		}
 	}
 #else
@@ -1753,7 +2784,7 @@ extern void ppu_initialize(const ppu_module& info)
 #endif
 }
 
-static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name)
+static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name, ppu_compile_benchmark::part_stats* stats)
 {
 #ifdef LLVM_AVAILABLE
 	using namespace llvm;
@@ -1766,7 +2797,7 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 	module->setDataLayout(jit.get_engine().getTargetMachine()->createDataLayout());
 
 	// Initialize translator
-	PPUTranslator translator(jit.get_context(), module.get(), module_part, jit.get_engine());
+	PPUTranslator translator(jit.get_context(), module.get(), module_part, jit.get_engine(), g_cfg.core.ppu_llvm_breakpoints.get(), g_cfg.core.llvm_lazy.get());
 
 	// Define some types
 	const auto _void = Type::getVoidTy(jit.get_context());
@@ -1805,6 +2836,20 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 		//pm.add(createCFGSimplificationPass());
 		//pm.add(createLintPass()); // Check
 
+		// Additional optimizations for hot functions
+		legacy::FunctionPassManager hpm(module.get());
+		hpm.add(createCFGSimplificationPass());
+		hpm.add(createNewGVNPass());
+		hpm.add(createDeadStoreEliminationPass());
+		hpm.add(createLICMPass());
+		hpm.add(createAggressiveDCEPass());
+
+		const auto pipeline = g_cfg.core.llvm_pipeline.get();
+
+		// Benchmark timers
+		using clock = std::chrono::steady_clock;
+		clock::duration translate_time{}, optimize_time{};
+
 		// Translate functions
 		for (size_t fi = 0, fmax = module_part.funcs.size(); fi < fmax; fi++)
 		{
@@ -1817,10 +2862,38 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 			if (module_part.funcs[fi].size)
 			{
 				// Translate
+				const auto t0 = clock::now();
+
 				if (const auto func = translator.Translate(module_part.funcs[fi]))
 				{
+					if (g_cfg.core.ppu_profile_guided)
+					{
+						// Count function entries
+						const auto counter = new GlobalVariable(*module, Type::getInt64Ty(jit.get_context()), false, GlobalValue::ExternalLinkage, ConstantInt::get(Type::getInt64Ty(jit.get_context()), 0), "__cnt" + module_part.funcs[fi].name);
+						IRBuilder<> irb(&*func->getEntryBlock().getFirstInsertionPt());
+						irb.CreateAtomicRMW(AtomicRMWInst::Add, counter, irb.getInt64(1), AtomicOrdering::Monotonic);
+					}
+
+					const auto t1 = clock::now();
+
 					// Run optimization passes
-					pm.run(*func);
+					if (pipeline != ppu_llvm_pipeline::minimal)
+					{
+						pm.run(*func);
+					}
+
+					if (pipeline == ppu_llvm_pipeline::extended || (pipeline == ppu_llvm_pipeline::standard && module_part.funcs[fi].attr & ppu_attr::hot))
+					{
+						hpm.run(*func);
+					}
+
+					translate_time += t1 - t0;
+					optimize_time += clock::now() - t1;
+
+					if (stats)
+					{
+						stats->funcs++;
+					}
 				}
 				else
 				{
@@ -1857,9 +2930,22 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 		}
 
 		LOG_NOTICE(PPU, "LLVM: %zu functions generated", module->getFunctionList().size());
+
+		if (stats)
+		{
+			stats->translate_us = std::chrono::duration_cast<std::chrono::microseconds>(translate_time).count();
+			stats->optimize_us = std::chrono::duration_cast<std::chrono::microseconds>(optimize_time).count();
+		}
 	}
 
+	const auto codegen_start = std::chrono::steady_clock::now();
+
 	// Load or compile module
 	jit.add(std::move(module), cache_path);
+
+	if (stats)
+	{
+		stats->codegen_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - codegen_start).count();
+	}
 #endif // LLVM_AVAILABLE
 }
@@ -164,6 +164,12 @@ public:
 	u64 rtime{0};
 	u64 rdata{0}; // Reservation data
 
+	u64 res_tx_count = 0; // Reservation stores committed in transaction
+	u64 res_tx_abort = 0; // Aborted transactions (completed in fallback path)
+	u64 res_tx_skip = 0; // Transactions skipped due to reservation line contention
+	u64 res_lock_fast = 0; // Reservation stores completed without lock waiting
+	u64 res_lock_wait = 0; // Reservation stores which had to wait for the lock
+
 	atomic_t<u32> prio{0}; // Thread priority (0..3071)
 	const u32 stack_size; // Stack size
 	const u32 stack_addr; // Stack address
@@ -3,6 +3,8 @@
 #include "PPUTranslator.h"
 #include "PPUThread.h"
 #include "PPUInterpreter.h"
+#include "PPUFunction.h"
+#include "SPUThread.h"
 
 #include "../Utilities/Log.h"
 #include <algorithm>
@@ -11,9 +13,10 @@ using namespace llvm;
 
 const ppu_decoder<PPUTranslator> s_ppu_decoder;
 
-PPUTranslator::PPUTranslator(LLVMContext& context, Module* module, const ppu_module& info, ExecutionEngine& engine)
+PPUTranslator::PPUTranslator(LLVMContext& context, Module* module, const ppu_module& info, ExecutionEngine& engine, bool break_checks, bool table_calls)
 	: cpu_translator(module, false)
 	, m_info(info)
+	, m_table_calls(table_calls)
 	, m_pure_attr(AttributeList::get(m_context, AttributeList::FunctionIndex, {Attribute::NoUnwind, Attribute::ReadNone}))
 {
 	// Bind context
@@ -52,6 +55,19 @@ PPUTranslator::PPUTranslator(LLVMContext& context, Module* module, const ppu_mod
 	m_call->setInitializer(ConstantPointerNull::get(cast<PointerType>(m_call->getType()->getPointerElementType())));
 	m_call->setExternallyInitialized(true);
 
+	// TSC to timebase conversion parameters (tsc_timebase_info)
+	m_tb_info = new GlobalVariable(*module, GetType<u64[3]>()->getPointerTo(), true, GlobalValue::ExternalLinkage, 0, fmt::format("__tbptr%x", gsuffix));
+	m_tb_info->setInitializer(ConstantPointerNull::get(cast<PointerType>(m_tb_info->getType()->getPointerElementType())));
+	m_tb_info->setExternallyInitialized(true);
+
+	if (break_checks)
+	{
+		// One byte per 256 bytes of code
+		m_break_lines = new GlobalVariable(*module, ArrayType::get(GetType<u8>(), 0x1000000)->getPointerTo(), true, GlobalValue::ExternalLinkage, 0, fmt::format("__bptr%x", gsuffix));
+		m_break_lines->setInitializer(ConstantPointerNull::get(cast<PointerType>(m_break_lines->getType()->getPointerElementType())));
+		m_break_lines->setExternallyInitialized(true);
+	}
+
 	const auto md_name = MDString::get(m_context, "branch_weights");
 	const auto md_low = ValueAsMetadata::get(ConstantInt::get(GetType<u32>(), 1));
 	const auto md_high = ValueAsMetadata::get(ConstantInt::get(GetType<u32>(), 666));
@@ -194,6 +210,11 @@ Function* PPUTranslator::Translate(const ppu_function& info)
 				m_rel = nullptr;
 			}
 
+			if (m_break_lines)
+			{
+				BreakpointCheck();
+			}
+
 			const u32 op = vm::read32(vm::cast(m_addr + base));
 			(this->*(s_ppu_decoder.decode(op)))({op});
 
@@ -253,11 +274,101 @@ Value* PPUTranslator::RotateLeft(Value* arg, Value* n)
 	return m_ir->CreateOr(m_ir->CreateShl(arg, m_ir->CreateAnd(n, mask)), m_ir->CreateLShr(arg, m_ir->CreateAnd(m_ir->CreateNeg(n), mask)));
 }
 
+extern std::vector<std::string> g_ppu_function_names;
+
+void PPUTranslator::BreakpointCheck()
+{
+	// Registers must be in memory for the debugger and the interpreter
+	FlushRegisters();
+
+	const auto line = m_ir->CreateLShr(GetAddr(), 8);
+	const auto count = m_ir->CreateLoad(m_ir->CreateGEP(m_ir->CreateLoad(m_break_lines), {m_ir->getInt64(0), line}));
+
+	const auto hit = BasicBlock::Create(m_context, "__break", m_function);
+	const auto next = BasicBlock::Create(m_context, "__next", m_function);
+	m_ir->CreateCondBr(m_ir->CreateIsNotNull(count), hit, next, m_md_unlikely);
+	m_ir->SetInsertPoint(hit);
+	Call(GetType<void>(), "__break", m_thread, GetAddr())->setTailCallKind(llvm::CallInst::TCK_Tail);
+	m_ir->CreateRetVoid();
+	m_ir->SetInsertPoint(next);
+}
+
+Value* PPUTranslator::GetTimebase()
+{
+	const auto info = m_ir->CreateLoad(m_tb_info);
+	const auto mul = m_ir->CreateLoad(m_ir->CreateGEP(info, {m_ir->getInt64(0), m_ir->getInt64(2)}));
+
+	const auto fast = BasicBlock::Create(m_context, "__tsc", m_function);
+	const auto slow = BasicBlock::Create(m_context, "__get_tb", m_function);
+	const auto next = BasicBlock::Create(m_context, "__next", m_function);
+	m_ir->CreateCondBr(m_ir->CreateIsNotNull(mul), fast, slow, m_md_likely);
+
+	// Inlined get_timebased_time(): tb_start + ((tsc - tsc_start) * mul >> 64)
+	m_ir->SetInsertPoint(fast);
+	const auto tsc_start = m_ir->CreateLoad(m_ir->CreateGEP(info, {m_ir->getInt64(0), m_ir->getInt64(0)}));
+	const auto tb_start = m_ir->CreateLoad(m_ir->CreateGEP(info, {m_ir->getInt64(0), m_ir->getInt64(1)}));
+	const auto delta = m_ir->CreateZExt(m_ir->CreateSub(m_ir->CreateCall(get_intrinsic(Intrinsic::readcyclecounter)), tsc_start), m_ir->getIntNTy(128));
+	const auto scaled = m_ir->CreateTrunc(m_ir->CreateLShr(m_ir->CreateMul(delta, m_ir->CreateZExt(mul, m_ir->getIntNTy(128))), 64), GetType<u64>());
+	const auto fast_value = m_ir->CreateAdd(tb_start, scaled);
+	m_ir->CreateBr(next);
+
+	m_ir->SetInsertPoint(slow);
+	const auto slow_value = Call(GetType<u64>(), m_pure_attr, "__get_tb");
+	m_ir->CreateBr(next);
+
+	m_ir->SetInsertPoint(next);
+	const auto result = m_ir->CreatePHI(GetType<u64>(), 2);
+	result->addIncoming(fast_value, fast);
+	result->addIncoming(slow_value, slow);
+	return result;
+}
+
+bool PPUTranslator::CallHLE(u64 addr)
+{
+	const u64 index = (addr - ppu_function_manager::addr) / 8;
+
+	// Skip INVALID and HLE RETURN entries
+	if (!ppu_function_manager::addr || addr < ppu_function_manager::addr || addr % 8 || index < 2 || index >= g_ppu_function_names.size() || g_ppu_function_names[index].empty())
+	{
+		return false;
+	}
+
+	// Call HLE function directly (resolved by name at link time), it expects CIA to point to its table entry
+	m_ir->CreateStore(m_ir->getInt32(::narrow<u32>(addr)), m_ir->CreateStructGEP(nullptr, m_thread, &m_cia - m_locals), true);
+	Call(GetType<void>(), "__hle_" + g_ppu_function_names[index], m_thread);
+
+	// Normal return sets CIA to the BLR after the table entry: execute it here instead of returning to the dispatcher
+	const auto ret = BasicBlock::Create(m_context, "__hle_ret", m_function);
+	const auto exit = BasicBlock::Create(m_context, "__hle_exit", m_function);
+	const auto cia = m_ir->CreateLoad(m_ir->CreateStructGEP(nullptr, m_thread, &m_cia - m_locals), true);
+	m_ir->CreateCondBr(m_ir->CreateICmpEQ(cia, m_ir->getInt32(::narrow<u32>(addr + 4))), ret, exit);
+	m_ir->SetInsertPoint(exit);
+	m_ir->CreateRetVoid();
+	m_ir->SetInsertPoint(ret);
+	CallFunction(0, m_ir->CreateLoad(m_ir->CreateStructGEP(nullptr, m_thread, &m_lr - m_locals)));
+	return true;
+}
+
 void PPUTranslator::CallFunction(u64 target, Value* indirect)
 {
 	const auto type = FunctionType::get(GetType<void>(), {m_thread_type->getPointerTo()}, false);
 	const auto block = m_ir->GetInsertBlock();
 
+	// Constant calls to HLE functions (static HLE stubs, forced HLE branches)
+	if (const auto _const = dyn_cast_or_null<ConstantInt>(indirect))
+	{
+		if (CallHLE(_const->getZExtValue()))
+		{
+			return;
+		}
+	}
+	else if (!indirect && !m_reloc && CallHLE(target))
+	{
+		return;
+	}
+
+	bool direct = false;
+
 	if (!indirect)
 	{
 		if ((!m_reloc && target < 0x10000) || target >= -0x10000)
@@ -266,9 +377,25 @@ void PPUTranslator::CallFunction(u64 target, Value* indirect)
 			return;
 		}
 
-		indirect = m_module->getOrInsertFunction(fmt::format("__0x%llx", target), type).getCallee();
+		const std::string name = fmt::format("__0x%llx", target);
+
+		if (!m_table_calls || m_module->getFunction(name))
+		{
+			indirect = m_module->getOrInsertFunction(name, type).getCallee();
+			direct = true;
+		}
+		else if (m_reloc)
+		{
+			// Not in this module part: the exec table holds the fallback until the target is compiled
+			indirect = m_ir->CreateAdd(m_ir->getInt64(target), m_ir->CreateLoad(m_segs[m_reloc - m_info.segs.data()]));
+		}
+		else
+		{
+			indirect = m_ir->getInt64(target);
+		}
 	}
-	else
+
+	if (!direct)
 	{
 		m_ir->CreateStore(Trunc(indirect, GetType<u32>()), m_ir->CreateStructGEP(nullptr, m_thread, &m_cia - m_locals), true);
 
@@ -529,10 +656,27 @@ llvm::Value* PPUTranslator::GetMemory(llvm::Value* addr, llvm::Type* type)
 	return m_ir->CreateBitCast(m_ir->CreateGEP(m_base_loaded, {m_ir->getInt64(0), addr}), type->getPointerTo());
 }
 
+bool PPUTranslator::IsRawSpuReg(Value* addr, Type* type)
+{
+	if (const auto c = dyn_cast<ConstantInt>(addr); c && type->isIntegerTy(32))
+	{
+		return c->getZExtValue() <= UINT32_MAX && spu_thread::is_raw_spu_reg(static_cast<u32>(c->getZExtValue()));
+	}
+
+	return false;
+}
+
 Value* PPUTranslator::ReadMemory(Value* addr, Type* type, bool is_be, u32 align)
 {
 	const auto size = type->getPrimitiveSizeInBits();
 
+	if (IsRawSpuReg(addr, type))
+	{
+		// Known Raw SPU register: call the handler instead of faulting (it returns the register value)
+		const auto value = Call(type, "__mmio_read32", addr);
+		return is_be ^ m_is_be ? value : Call(type, "llvm.bswap.i32", value);
+	}
+
 	if (is_be ^ m_is_be && size > 8)
 	{
 		// Read, byteswap, bitcast
@@ -550,6 +694,12 @@ void PPUTranslator::WriteMemory(Value* addr, Value* value, bool is_be, u32 align
 	const auto type = value->getType();
 	const auto size = type->getPrimitiveSizeInBits();
 
+	if (IsRawSpuReg(addr, type))
+	{
+		Call(GetType<void>(), "__mmio_write32", addr, is_be ^ m_is_be ? value : Call(type, "llvm.bswap.i32", value));
+		return;
+	}
+
 	if (is_be ^ m_is_be && size > 8)
 	{
 		// Bitcast, byteswap
@@ -1190,6 +1340,14 @@ void PPUTranslator::VPERM(ppu_opcode_t op)
 	const auto a = get_vr<u8[16]>(op.va);
 	const auto b = get_vr<u8[16]>(op.vb);
 	const auto c = get_vr<u8[16]>(op.vc);
+
+	if (m_use_vbmi && !llvm::isa<llvm::Constant>(c.value))
+	{
+		// Single instruction (constant indices are better left to shufflevector folding)
+		set_vr(op.vd, vpermi2b(b, eval(~c), a));
+		return;
+	}
+
 	const auto i = eval(~c & 0x1f);
 	set_vr(op.vd, select(noncast<s8[16]>(c << 3) >= 0, pshufb(a, i), pshufb(b, i)));
 }
@@ -2820,10 +2978,10 @@ void PPUTranslator::MFSPR(ppu_opcode_t op)
 		result = ZExt(RegLoad(m_vrsave));
 		break;
 	case 0x10C: // MFTB
-		result = Call(GetType<u64>(), m_pure_attr, "__get_tb");
+		result = GetTimebase();
 		break;
 	case 0x10D: // MFTBU
-		result = m_ir->CreateLShr(Call(GetType<u64>(), m_pure_attr, "__get_tb"), 32);
+		result = m_ir->CreateLShr(GetTimebase(), 32);
 		break;
 	default:
 		result = Call(GetType<u64>(), fmt::format("__mfspr_%u", n));
@@ -2858,10 +3016,10 @@ void PPUTranslator::MFTB(ppu_opcode_t op)
 	switch (const u32 n = (op.spr >> 5) | ((op.spr & 0x1f) << 5))
 	{
 	case 0x10C: // MFTB
-		result = Call(GetType<u64>(), m_pure_attr, "__get_tb");
+		result = GetTimebase();
 		break;
 	case 0x10D: // MFTBU
-		result = m_ir->CreateLShr(Call(GetType<u64>(), m_pure_attr, "__get_tb"), 32);
+		result = m_ir->CreateLShr(GetTimebase(), 32);
 		break;
 	default:
 		result = Call(GetType<u64>(), fmt::format("__mftb_%u", n));
@@ -32,6 +32,9 @@ class PPUTranslator final : public cpu_translator
 	// Set by instruction code after processing the relocation
 	const ppu_reloc* m_rel = nullptr;
 
+	// Call functions of other module parts through the executable table (they may be compiled later)
+	bool m_table_calls = false;
+
 	/* Variables */
 
 	// Segments
@@ -47,6 +50,12 @@ class PPUTranslator final : public cpu_translator
 	// Callable functions
 	llvm::GlobalVariable* m_call;
 
+	// Breakpoint line table (null if breakpoint checks are disabled)
+	llvm::GlobalVariable* m_break_lines = nullptr;
+
+	// TSC to timebase conversion parameters
+	llvm::GlobalVariable* m_tb_info;
+
 	// Thread context struct
 	llvm::StructType* m_thread_type;
 
@@ -117,6 +126,15 @@ public:
 	// Emit function call
 	void CallFunction(u64 target, llvm::Value* indirect = nullptr);
 
+	// Emit breakpoint check point for the current instruction
+	void BreakpointCheck();
+
+	// Read the timebase (inlined TSC conversion if available)
+	llvm::Value* GetTimebase();
+
+	// Emit direct call to HLE function if the address belongs to the HLE function table
+	bool CallHLE(u64 addr);
+
 	// Initialize global for writing
 	llvm::Value* RegInit(llvm::Value*& local);
 
@@ -284,6 +302,9 @@ public:
 	// Get memory pointer
 	llvm::Value* GetMemory(llvm::Value* addr, llvm::Type* type);
 
+	// Check whether the constant address is a Raw SPU register (word access only)
+	bool IsRawSpuReg(llvm::Value* addr, llvm::Type* type);
+
 	// Read from memory
 	llvm::Value* ReadMemory(llvm::Value* addr, llvm::Type* type, bool is_be = true, u32 align = 1);
 
@@ -315,7 +336,7 @@ public:
 	// Handle compilation errors
 	void CompilationError(const std::string& error);
 
-	PPUTranslator(llvm::LLVMContext& context, llvm::Module* module, const ppu_module& info, llvm::ExecutionEngine& engine);
+	PPUTranslator(llvm::LLVMContext& context, llvm::Module* module, const ppu_module& info, llvm::ExecutionEngine& engine, bool break_checks = false, bool table_calls = false);
 	~PPUTranslator();
 
 	// Get thread context struct type
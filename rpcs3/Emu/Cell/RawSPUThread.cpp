@@ -69,6 +69,26 @@ bool spu_thread::read_reg(const u32 addr, u32& value)
 	return false;
 }
 
+bool spu_thread::read_raw_reg(u32 addr, u32& value)
+{
+	if (const auto thread = idm::get<named_thread<spu_thread>>(find_raw_spu((addr - RAW_SPU_BASE_ADDR) / RAW_SPU_OFFSET)))
+	{
+		return thread->read_reg(addr, value);
+	}
+
+	return false;
+}
+
+bool spu_thread::write_raw_reg(u32 addr, u32 value)
+{
+	if (const auto thread = idm::get<named_thread<spu_thread>>(find_raw_spu((addr - RAW_SPU_BASE_ADDR) / RAW_SPU_OFFSET)))
+	{
+		return thread->write_reg(addr, value);
+	}
+
+	return false;
+}
+
 bool spu_thread::write_reg(const u32 addr, const u32 value)
 {
 	auto try_start = [this]()
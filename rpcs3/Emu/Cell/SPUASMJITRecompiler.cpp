@@ -724,6 +724,13 @@ spu_function_t spu_recompiler::compile(u64 last_reset_count, const std::vector<u
 	// Acknowledge success and add statistics
 	c->add(SPU_OFF_64(block_counter), ::size32(words) / (words_align / 4));
 
+	if (const auto prof = fxm::get<named_thread<spu_profiler>>())
+	{
+		// Increase function entry counter (profiler)
+		c->mov(*qw0, imm_ptr(prof->add(func)));
+		c->lock().inc(x86::qword_ptr(*qw0));
+	}
+
 	if (m_pos != start)
 	{
 		// Jump to the entry point if necessary
@@ -869,6 +876,9 @@ spu_function_t spu_recompiler::compile(u64 last_reset_count, const std::vector<u
 		return nullptr;
 	}
 
+	// Name the function for external profilers (same scheme as SPU LLVM)
+	jit_runtime::announce(reinterpret_cast<const void*>(fn), code.getCodeSize(), fmt::format("spu-0x%05x-asmjit", func[0]));
+
 	if (g_cfg.core.spu_debug)
 	{
 		// Add ASMJIT logs
@@ -1078,15 +1088,25 @@ void spu_recompiler::branch_indirect(spu_opcode_t op, bool jt, bool ret)
 
 	if (g_cfg.core.spu_block_size != spu_block_size_type::safe && ret)
 	{
-		// Get stack pointer, try to use native return address (check SPU return address)
+		// Try to use native return address from the shadow link stack (check SPU return address)
+		// The second entry is checked too in case a call returned without popping its entry
+		Label found = c->newLabel();
 		Label fail = c->newLabel();
-		c->mov(qw1->r32(), SPU_OFF_32(gpr, 1, &v128::_u32, 3));
-		c->and_(qw1->r32(), 0x3fff0);
-		c->lea(*qw1, x86::qword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::stack_mirror)));
-		c->cmp(x86::dword_ptr(*qw1, 8), *addr);
+		c->mov(qw1->r32(), SPU_OFF_32(ret_stack_pos));
+		c->lea(x86::r10, x86::qword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::ret_stack)));
+		c->cmp(x86::dword_ptr(x86::r10, 8), *addr);
+		c->je(found);
+		c->sub(qw1->r32(), 16);
+		c->and_(qw1->r32(), 0x1f0);
+		c->lea(x86::r10, x86::qword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::ret_stack)));
+		c->cmp(x86::dword_ptr(x86::r10, 8), *addr);
 		c->jne(fail);
-		c->mov(pc0->r32(), x86::dword_ptr(*qw1, 12));
-		c->jmp(x86::qword_ptr(*qw1));
+		c->bind(found);
+		c->sub(qw1->r32(), 16);
+		c->and_(qw1->r32(), 0x1f0);
+		c->mov(SPU_OFF_32(ret_stack_pos), qw1->r32());
+		c->mov(pc0->r32(), x86::dword_ptr(x86::r10, 12));
+		c->jmp(x86::qword_ptr(x86::r10));
 		c->bind(fail);
 	}
 
@@ -1139,30 +1159,18 @@ void spu_recompiler::branch_set_link(u32 target)
 
 		if (local != instr_labels.end() && local->second.isValid())
 		{
-			Label ret = c->newLabel();
-
-			// Get stack pointer, write native and SPU return addresses into the stack mirror
-			c->mov(qw1->r32(), SPU_OFF_32(gpr, 1, &v128::_u32, 3));
-			c->and_(qw1->r32(), 0x3fff0);
-			c->lea(*qw1, x86::qword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::stack_mirror)));
-			c->lea(x86::r10, x86::qword_ptr(ret));
+			// Push native and SPU return addresses to the shadow link stack (the return pops the entry)
+			c->mov(qw1->r32(), SPU_OFF_32(ret_stack_pos));
+			c->add(qw1->r32(), 16);
+			c->and_(qw1->r32(), 0x1f0);
+			c->mov(SPU_OFF_32(ret_stack_pos), qw1->r32());
+			c->lea(*qw1, x86::qword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::ret_stack)));
+			c->lea(x86::r10, x86::qword_ptr(local->second));
 			c->mov(x86::qword_ptr(*qw1, 0), x86::r10);
 			c->lea(x86::r10, get_pc(target));
 			c->and_(x86::r10d, 0x3fffc);
 			c->mov(x86::dword_ptr(*qw1, 8), x86::r10d);
 			c->mov(x86::dword_ptr(*qw1, 12), pc0->r32());
-
-			after.emplace_back([=, target = local->second]
-			{
-				// Clear return info after use
-				c->align(kAlignCode, 16);
-				c->bind(ret);
-				c->mov(qw1->r32(), SPU_OFF_32(gpr, 1, &v128::_u32, 3));
-				c->and_(qw1->r32(), 0x3fff0);
-				c->pcmpeqd(x86::xmm0, x86::xmm0);
-				c->movdqa(x86::dqword_ptr(*cpu, *qw1, 0, ::offset32(&spu_thread::stack_mirror)), x86::xmm0);
-				c->jmp(target);
-			});
 		}
 	}
 }
@@ -2,16 +2,19 @@
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
 #include "Emu/Memory/vm.h"
+#include "Utilities/timeline.h"
 #include "Crypto/sha1.h"
 #include "Utilities/StrUtil.h"
 #include "Utilities/JIT.h"
 #include "Utilities/sysinfo.h"
+#include "Utilities/lockless.h"
 
 #include "SPUThread.h"
 #include "SPUAnalyser.h"
 #include "SPUInterpreter.h"
 #include "SPUDisAsm.h"
 #include "SPURecompiler.h"
+#include "rpcs3_version.h"
 #include <algorithm>
 #include <mutex>
 #include <thread>
@@ -20,6 +23,9 @@ extern atomic_t<const char*> g_progr;
 extern atomic_t<u64> g_progr_ptotal;
 extern atomic_t<u64> g_progr_pdone;
 
+extern atomic_t<u64> g_spu_functions_precompiled;
+extern atomic_t<u64> g_spu_functions_compiled;
+
 const spu_decoder<spu_itype> s_spu_itype;
 const spu_decoder<spu_iname> s_spu_iname;
 const spu_decoder<spu_iflag> s_spu_iflag;
@@ -206,9 +212,14 @@ DECLARE(spu_runtime::g_tail_escape) = build_function_asm<void(*)(spu_thread*, sp
 
 DECLARE(spu_runtime::g_interpreter) = nullptr;
 
-spu_cache::spu_cache(const std::string& loc)
+spu_cache::spu_cache(const std::string& loc, const std::string& info_loc)
 	: m_file(loc, fs::read + fs::write + fs::create + fs::append)
 {
+	if (!info_loc.empty())
+	{
+		m_info_file.open(info_loc, fs::read + fs::write + fs::create + fs::append);
+		read_info();
+	}
 }
 
 spu_cache::~spu_cache()
@@ -224,35 +235,72 @@ std::deque<std::vector<u32>> spu_cache::get()
 		return result;
 	}
 
-	m_file.seek(0);
+	std::lock_guard lock(m_mutex);
+
+	m_hashes.clear();
+
+	// Number of duplicate entries skipped
+	std::size_t dups = 0;
 
-	// TODO: signal truncated or otherwise broken file
-	while (true)
 	{
-		be_t<u32> size;
-		be_t<u32> addr;
-		std::vector<u32> func;
+		// Parse the whole file from a view instead of issuing several reads per entry
+		// The view must be released before the file is rewritten
+		const fs::file_view view = m_file.map();
 
-		if (!m_file.read(size) || !m_file.read(addr))
+		// TODO: signal truncated or otherwise broken file
+		for (u64 pos = 0;;)
 		{
-			break;
-		}
+			be_t<u32> size;
+			be_t<u32> addr;
+			std::vector<u32> func;
 
-		func.resize(size + 1);
-		func[0] = addr;
+			if (view.size() - pos < sizeof(size) + sizeof(addr))
+			{
+				break;
+			}
 
-		if (m_file.read(func.data() + 1, func.size() * 4 - 4) != func.size() * 4 - 4)
-		{
-			break;
+			std::memcpy(&size, view.data() + pos, sizeof(size));
+			std::memcpy(&addr, view.data() + pos + sizeof(size), sizeof(addr));
+			pos += sizeof(size) + sizeof(addr);
+
+			if ((view.size() - pos) / 4 < size)
+			{
+				break;
+			}
+
+			func.resize(size + 1);
+			func[0] = addr;
+
+			std::memcpy(func.data() + 1, view.data() + pos, u64{size} * 4);
+			pos += u64{size} * 4;
+
+			if (!size || !func[1])
+			{
+				// Skip old format Giga entries
+				continue;
+			}
+
+			if (!insert(func))
+			{
+				dups++;
+				continue;
+			}
+
+			result.emplace_front(std::move(func));
 		}
+	}
+
+	if (dups)
+	{
+		// Rewrite the file without duplicates (preserving original order)
+		LOG_NOTICE(SPU, "SPU Cache: removing %u duplicate entries", dups);
+
+		m_file.trunc(0);
 
-		if (!size || !func[1])
+		for (auto it = result.rbegin(); it != result.rend(); it++)
 		{
-			// Skip old format Giga entries
-			continue;
+			write(*it);
 		}
-
-		result.emplace_front(std::move(func));
 	}
 
 	return result;
@@ -265,6 +313,38 @@ void spu_cache::add(const std::vector<u32>& func)
 		return;
 	}
 
+	std::lock_guard lock(m_mutex);
+
+	if (!insert(func))
+	{
+		return;
+	}
+
+	write(func);
+}
+
+bool spu_cache::insert(const std::vector<u32>& func)
+{
+	const auto sha1 = digest(func);
+
+	u64 key;
+	std::memcpy(&key, sha1.data(), sizeof(key));
+
+	// Functions sharing the 64-bit prefix are only duplicates if the whole hash matches
+	for (auto [found, end] = m_hashes.equal_range(key); found != end; found++)
+	{
+		if (found->second == sha1)
+		{
+			return false;
+		}
+	}
+
+	m_hashes.emplace(key, sha1);
+	return true;
+}
+
+void spu_cache::write(const std::vector<u32>& func)
+{
 	be_t<u32> size = ::size32(func) - 1;
 	be_t<u32> addr = func[0];
 
@@ -279,10 +359,152 @@ void spu_cache::add(const std::vector<u32>& func)
 	m_file.write_gather(gather, 3);
 }
 
+void spu_cache::read_info()
+{
+	if (!m_info_file)
+	{
+		return;
+	}
+
+	bool stale = false;
+
+	{
+		const fs::file_view view = m_info_file.map();
+
+		for (u64 pos = 0;;)
+		{
+			be_t<u64> hash;
+			be_t<u32> version;
+			be_t<u32> size;
+
+			if (view.size() - pos < sizeof(hash) + sizeof(version) + sizeof(size))
+			{
+				break;
+			}
+
+			std::memcpy(&hash, view.data() + pos, sizeof(hash));
+			std::memcpy(&version, view.data() + pos + sizeof(hash), sizeof(version));
+			std::memcpy(&size, view.data() + pos + sizeof(hash) + sizeof(version), sizeof(size));
+			pos += sizeof(hash) + sizeof(version) + sizeof(size);
+
+			if (view.size() - pos < size)
+			{
+				break;
+			}
+
+			if (version != spu_recompiler_base::analysis_key())
+			{
+				stale = true;
+				break;
+			}
+
+			m_info.emplace(hash, std::make_pair(pos, u32{size}));
+			pos += size;
+		}
+	}
+
+	if (stale)
+	{
+		// Produced by a different analyser, throw everything away
+		LOG_NOTICE(SPU, "SPU Cache: discarding outdated analyser data");
+		m_info.clear();
+		m_info_file.trunc(0);
+	}
+}
+
+bool spu_cache::need_info(u64 hash)
+{
+	if (!m_info_file)
+	{
+		return false;
+	}
+
+	std::lock_guard lock(m_mutex);
+
+	return m_info.count(hash) == 0;
+}
+
+void spu_cache::add_info(u64 hash, const std::vector<u8>& data)
+{
+	if (!m_info_file)
+	{
+		return;
+	}
+
+	std::lock_guard lock(m_mutex);
+
+	const be_t<u64> _hash = hash;
+	const be_t<u32> version = spu_recompiler_base::analysis_key();
+	const be_t<u32> size = ::size32(data);
+
+	const u64 pos = m_info_file.size() + sizeof(_hash) + sizeof(version) + sizeof(size);
+
+	if (!m_info.try_emplace(hash, pos, ::size32(data)).second)
+	{
+		return;
+	}
+
+	const fs::iovec_clone gather[4]
+	{
+		{&_hash, sizeof(_hash)},
+		{&version, sizeof(version)},
+		{&size, sizeof(size)},
+		{data.data(), data.size()}
+	};
+
+	m_info_file.write_gather(gather, 4);
+}
+
+bool spu_cache::get_info(u64 hash, std::vector<u8>& data)
+{
+	if (!m_info_file)
+	{
+		return false;
+	}
+
+	std::lock_guard lock(m_mutex);
+
+	const auto found = m_info.find(hash);
+
+	if (found == m_info.end())
+	{
+		return false;
+	}
+
+	data.resize(found->second.second);
+	m_info_file.seek(found->second.first);
+	return m_info_file.read(data.data(), data.size()) == data.size();
+}
+
+std::array<u8, 20> spu_cache::digest(const std::vector<u32>& func)
+{
+	sha1_context ctx;
+	std::array<u8, 20> output;
+
+	sha1_starts(&ctx);
+	sha1_update(&ctx, reinterpret_cast<const u8*>(func.data()), func.size() * 4);
+	sha1_finish(&ctx, output.data());
+	return output;
+}
+
+u64 spu_cache::hash(const std::vector<u32>& func)
+{
+	const auto output = digest(func);
+
+	u64 result;
+	std::memcpy(&result, output.data(), sizeof(result));
+	return result;
+}
+
 void spu_cache::initialize()
 {
 	spu_runtime::g_interpreter = nullptr;
 
+	if (g_cfg.core.spu_profiler && g_cfg.core.spu_decoder != spu_decoder_type::precise && g_cfg.core.spu_decoder != spu_decoder_type::fast)
+	{
+		fxm::get_always<named_thread<spu_profiler>>("SPU Profiler");
+	}
+
 	const std::string ppu_cache = Emu.PPUCache();
 
 	if (ppu_cache.empty())
@@ -290,10 +512,11 @@ void spu_cache::initialize()
 		return;
 	}
 
-	// SPU cache file (version + block size type)
+	// SPU cache file (version + block size type) and analyser state file
 	const std::string loc = ppu_cache + "spu-" + fmt::to_lower(g_cfg.core.spu_block_size.to_string()) + "-v1-tane.dat";
+	const std::string info_loc = ppu_cache + "spu-" + fmt::to_lower(g_cfg.core.spu_block_size.to_string()) + "-v1-tane-info.dat";
 
-	auto cache = std::make_shared<spu_cache>(loc);
+	auto cache = std::make_shared<spu_cache>(loc, info_loc);
 
 	if (!*cache)
 	{
@@ -309,6 +532,9 @@ void spu_cache::initialize()
 	// Initialize compiler instances for parallel compilation
 	u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
 	u32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
+
+	// Don't create more workers than there are functions to build (but at least one)
+	thread_count = std::max<u32>(1, std::min<u32>(thread_count, ::size32(func_list)));
 	std::vector<std::unique_ptr<spu_recompiler_base>> compilers{thread_count};
 
 	if (g_cfg.core.spu_decoder == spu_decoder_type::fast)
@@ -346,6 +572,12 @@ void spu_cache::initialize()
 
 	if (compilers.size() && !func_list.empty())
 	{
+		// Build largest functions first, so that no worker is left compiling a huge function alone at the end
+		std::stable_sort(func_list.begin(), func_list.end(), [](const std::vector<u32>& a, const std::vector<u32>& b)
+		{
+			return a.size() > b.size();
+		});
+
 		// Initialize progress dialog (wait for previous progress done)
 		while (g_progr_ptotal)
 		{
@@ -356,9 +588,10 @@ void spu_cache::initialize()
 		g_progr_ptotal += func_list.size();
 	}
 
-	std::deque<named_thread<std::function<void()>>> thread_queue;
+	// One compile job per compiler instance on the worker pool
+	worker_pool::group jobs;
 
-	for (std::size_t i = 0; i < compilers.size(); i++) thread_queue.emplace_back("Worker " + std::to_string(i), [&, compiler = compilers[i].get()]()
+	for (std::size_t i = 0; i < compilers.size(); i++) worker_pool::get().submit(worker_priority::compile, [&, compiler = compilers[i].get()]()
 	{
 		// Register SPU runtime user
 		spu_runtime::passive_lock _passive_lock(compiler->get_runtime());
@@ -371,61 +604,31 @@ void spu_cache::initialize()
 		{
 			std::vector<u32>& func = func_list[func_i];
 
-			if (Emu.IsStopped() || fail_flag)
+			if (Emu.IsStopped() || worker_pool::is_cancelled() || fail_flag)
 			{
 				g_progr_pdone++;
 				continue;
 			}
 
-			// Get data start
-			const u32 start = func[0];
-			const u32 size0 = ::size32(func);
-
-			// Initialize LS with function data only
-			for (u32 i = 1, pos = start; i < size0; i++, pos += 4)
-			{
-				ls[pos / 4] = se_storage<u32>::swap(func[i]);
-			}
-
-			// Call analyser
-			const std::vector<u32>& func2 = compiler->analyse(ls.data(), func[0]);
-
-			if (func2.size() != size0)
-			{
-				LOG_ERROR(SPU, "[0x%05x] SPU Analyser failed, %u vs %u", func2[0], func2.size() - 1, size0 - 1);
-			}
+			// Restore or rebuild analyser state
+			compiler->analyse_cached(cache.get(), ls, func);
 
 			if (!compiler->compile(0, func))
 			{
 				// Likely, out of JIT memory. Signal to prevent further building.
 				fail_flag |= 1;
 			}
-
-			// Clear fake LS
-			for (u32 i = 1, pos = start; i < func2.size(); i++, pos += 4)
-			{
-				if (se_storage<u32>::swap(func2[i]) != ls[pos / 4])
-				{
-					LOG_ERROR(SPU, "[0x%05x] SPU Analyser failed at 0x%x", func2[0], pos);
-				}
-
-				ls[pos / 4] = 0;
-			}
-
-			if (func2.size() != size0)
+			else if (g_cfg.core.spu_tiered && g_cfg.core.spu_decoder == spu_decoder_type::asmjit)
 			{
-				std::memset(ls.data(), 0, 0x40000);
+				spu_recompiler_base::enqueue_upgrade(0, func);
 			}
 
 			g_progr_pdone++;
 		}
-	});
+	}, &jobs);
 
-	// Join all threads
-	while (!thread_queue.empty())
-	{
-		thread_queue.pop_front();
-	}
+	// Wait for all jobs
+	jobs.wait();
 
 	if (Emu.IsStopped())
 	{
@@ -443,6 +646,7 @@ void spu_cache::initialize()
 
 	if (compilers.size() && !func_list.empty())
 	{
+		g_spu_functions_precompiled += func_list.size();
 		LOG_SUCCESS(SPU, "SPU Runtime: Built %u functions.", func_list.size());
 	}
 
@@ -453,6 +657,148 @@ void spu_cache::initialize()
 	});
 }
 
+bool spu_cache::benchmark(const std::string& path, const std::string& output_path)
+{
+	// Work on a copy, reading the cache can compact the file
+	const std::string copy = Emu.PPUCache() + "spu-benchmark.dat";
+
+	if (!fs::copy_file(path, copy, true))
+	{
+		LOG_ERROR(SPU, "SPU Benchmark: failed to read %s (%s)", path, fs::g_tls_error);
+		return false;
+	}
+
+	const auto func_list = spu_cache(copy).get();
+	fs::remove_file(copy);
+
+	if (func_list.empty())
+	{
+		LOG_ERROR(SPU, "SPU Benchmark: no functions in %s", path);
+		return false;
+	}
+
+	fs::file out(output_path, fs::rewrite);
+
+	if (!out)
+	{
+		LOG_ERROR(SPU, "SPU Benchmark: failed to create %s (%s)", output_path, fs::g_tls_error);
+		return false;
+	}
+
+	out.write("decoder,block_size,address,cached_size,size,analyse_us,compile_us\n");
+
+	const auto decoder_type = g_cfg.core.spu_decoder.get();
+	const auto block_size = g_cfg.core.spu_block_size.get();
+
+	// Fake LS
+	std::vector<be_t<u32>> ls(0x10000);
+
+	for (const auto decoder : {spu_decoder_type::asmjit, spu_decoder_type::llvm})
+	{
+		for (const auto size_type : {spu_block_size_type::safe, spu_block_size_type::mega, spu_block_size_type::giga})
+		{
+			if (Emu.IsStopped())
+			{
+				break;
+			}
+
+			g_cfg.core.spu_decoder.set(decoder);
+			g_cfg.core.spu_block_size.set(size_type);
+
+			std::unique_ptr<spu_recompiler_base> compiler;
+
+			try
+			{
+				compiler = decoder == spu_decoder_type::asmjit ? spu_recompiler_base::make_asmjit_recompiler() : spu_recompiler_base::make_llvm_recompiler();
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(SPU, "SPU Benchmark: %s", e.what());
+				break;
+			}
+
+			compiler->init();
+
+			const std::string decoder_name = fmt::format("%s", decoder);
+			const std::string size_name = fmt::format("%s", size_type);
+
+			u64 total_insts = 0;
+			u64 total_analyse = 0;
+			u64 total_compile = 0;
+			u32 built = 0;
+
+			{
+				spu_runtime::passive_lock _passive_lock(compiler->get_runtime());
+
+				for (const std::vector<u32>& func : func_list)
+				{
+					if (Emu.IsStopped())
+					{
+						break;
+					}
+
+					// Initialize LS with function data only
+					const u32 start = func[0];
+					const u32 size0 = ::size32(func);
+
+					for (u32 i = 1, pos = start; i < size0; i++, pos += 4)
+					{
+						ls[pos / 4] = se_storage<u32>::swap(func[i]);
+					}
+
+					// Analyse with the tested block size, compile the result
+					const auto t0 = std::chrono::steady_clock::now();
+					const std::vector<u32> func2 = compiler->analyse(ls.data(), start);
+					const auto t1 = std::chrono::steady_clock::now();
+					const bool ok = func2.size() < 2 || compiler->compile(0, func2) != nullptr;
+					const auto t2 = std::chrono::steady_clock::now();
+
+					std::memset(ls.data(), 0, 0x40000);
+
+					if (func2.size() < 2)
+					{
+						continue;
+					}
+
+					if (!ok)
+					{
+						// Out of JIT memory, results of the remaining functions would be meaningless
+						LOG_ERROR(SPU, "SPU Benchmark: [%s/%s] failed to compile 0x%05x", decoder_name, size_name, start);
+						break;
+					}
+
+					const u64 analyse_us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+					const u64 compile_us = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+					out.write(fmt::format("%s,%s,0x%05x,%u,%u,%u,%u\n", decoder_name, size_name, start, size0 - 1, func2.size() - 1, analyse_us, compile_us));
+
+					total_insts += func2.size() - 1;
+					total_analyse += analyse_us;
+					total_compile += compile_us;
+					built++;
+				}
+			}
+
+			LOG_SUCCESS(SPU, "SPU Benchmark: [%s/%s] %u functions, %u instructions, analyse %u ms, compile %u ms (%.3f us per instruction)",
+				decoder_name, size_name, built, total_insts, total_analyse / 1000, total_compile / 1000, total_insts ? static_cast<f64>(total_compile) / total_insts : 0.);
+
+			// Release all code before the next configuration
+			compiler.reset();
+			fxm::remove<spu_runtime>();
+
+#ifdef LLVM_AVAILABLE
+			extern void jit_finalize();
+			jit_finalize();
+#endif
+			jit_runtime::finalize();
+		}
+	}
+
+	g_cfg.core.spu_decoder.set(decoder_type);
+	g_cfg.core.spu_block_size.set(block_size);
+	return true;
+}
+
 bool spu_runtime::func_compare::operator()(const std::vector<u32>& lhs, const std::vector<u32>& rhs) const
 {
 	if (lhs.empty())
@@ -538,11 +884,26 @@ bool spu_runtime::add(u64 last_reset_count, void* _where, spu_function_t compile
 	//
 	const u32 _off = 1 + (func[0] / 4) * (false);
 
+	// Tier upgrades replace an existing function and are not counted
+	if (!where.second)
+	{
+		g_spu_functions_compiled++;
+	}
+
 	// Set pointer to the compiled function
 	where.second = compiled;
 
 	// Register function in PIC map
-	m_pic_map[{func.data() + _off, func.size() - _off}] = compiled;
+	const auto pic = m_pic_map.try_emplace({func.data() + _off, func.size() - _off}, compiled);
+
+	if (pic.second)
+	{
+		index_pic(*pic.first);
+	}
+	else
+	{
+		pic.first->second = compiled;
+	}
 
 	// Prepare sorted list
 	m_flat_list.clear();
@@ -896,7 +1257,12 @@ void* spu_runtime::find(u64 last_reset_count, const std::vector<u32>& func)
 	const auto result = m_map.try_emplace(func, nullptr);
 
 	// Add PIC entry as well
-	m_pic_map.try_emplace({result.first->first.data() + _off, result.first->first.size() - _off}, nullptr);
+	const auto pic = m_pic_map.try_emplace({result.first->first.data() + _off, result.first->first.size() - _off}, nullptr);
+
+	if (pic.second)
+	{
+		index_pic(*pic.first);
+	}
 
 	// Pointer to the value in the map (pair)
 	const auto fn_location = &*result.first;
@@ -927,35 +1293,94 @@ void* spu_runtime::find(u64 last_reset_count, const std::vector<u32>& func)
 	return fn_location;
 }
 
-spu_function_t spu_runtime::find(const u32* ls, u32 addr) const
+void* spu_runtime::find_compiled(u64 last_reset_count, const std::vector<u32>& func)
 {
-	const u64 reset_count = m_reset_count;
-
-	reader_lock lock(*this);
+	writer_lock lock(*this);
 
-	if (reset_count != m_reset_count)
+	// Check reset count
+	if (last_reset_count != m_reset_count)
 	{
 		return nullptr;
 	}
 
-	const auto upper = m_pic_map.upper_bound({ls + addr / 4, (0x40000 - addr) / 4});
+	const auto found = m_map.find(func);
 
-	if (upper != m_pic_map.begin())
+	if (found == m_map.end() || !found->second)
 	{
-		const auto found = std::prev(upper);
-
-		if (found->first.compare(0, found->first.size(), ls + addr / 4, found->first.size()) == 0)
-		{
-			return found->second;
-		}
+		// Not compiled yet (or compilation in progress)
+		return nullptr;
 	}
 
-	return nullptr;
+	return &*found;
 }
 
-spu_function_t spu_runtime::make_branch_patchpoint() const
+spu_function_t spu_runtime::find(const u32* ls, u32 addr) const
 {
-	u8* const raw = jit_runtime::alloc(16, 16);
+	const u64 reset_count = m_reset_count;
+
+	reader_lock lock(*this);
+
+	if (reset_count != m_reset_count)
+	{
+		return nullptr;
+	}
+
+	const std::basic_string_view<u32> data(ls + addr / 4, (0x40000 - addr) / 4);
+
+	// Find the longest registered function which is a prefix of LS data
+	const decltype(m_pic_map)::value_type* found = nullptr;
+
+	const auto test = [&](const decltype(m_pic_map)::value_type* entry)
+	{
+		const auto& key = entry->first;
+
+		if (key.size() <= data.size() && (!found || key.size() > found->first.size()) && data.compare(0, key.size(), key) == 0)
+		{
+			found = entry;
+		}
+	};
+
+	if (data.size() >= 2)
+	{
+		const auto bucket = m_pic_index.find(data[0] | u64{data[1]} << 32);
+
+		if (bucket != m_pic_index.end())
+		{
+			for (auto entry : bucket->second)
+			{
+				test(entry);
+			}
+		}
+	}
+
+	if (!found)
+	{
+		for (auto entry : m_pic_short)
+		{
+			test(entry);
+		}
+	}
+
+	return found ? found->second : nullptr;
+}
+
+void spu_runtime::index_pic(decltype(m_pic_map)::value_type& entry)
+{
+	const auto& key = entry.first;
+
+	if (key.size() >= 2)
+	{
+		m_pic_index[key[0] | u64{key[1]} << 32].emplace_back(&entry);
+	}
+	else if (key.size() == 1)
+	{
+		m_pic_short.emplace_back(&entry);
+	}
+}
+
+spu_function_t spu_runtime::make_branch_patchpoint() const
+{
+	u8* const raw = jit_runtime::alloc(16, 16);
 
 	if (!raw)
 	{
@@ -1007,6 +1432,8 @@ u64 spu_runtime::reset(std::size_t last_reset_count)
 	// Reset function map (may take some time)
 	m_map.clear();
 	m_pic_map.clear();
+	m_pic_index.clear();
+	m_pic_short.clear();
 
 	// Wait for threads to catch on jit_return flag
 	while (m_passive_locks)
@@ -1025,13 +1452,140 @@ void spu_runtime::handle_return(spu_thread* _spu)
 	// Wait until the runtime becomes available
 	writer_lock lock(*this);
 
-	// Reset stack mirror
-	std::memset(_spu->stack_mirror.data(), 0xff, sizeof(spu_thread::stack_mirror));
+	// Reset shadow link stack
+	std::memset(_spu->ret_stack.data(), 0xff, sizeof(spu_thread::ret_stack));
 
 	// Reset the flag
 	_spu->state -= cpu_flag::jit_return;
 }
 
+spu_profiler::spu_profiler()
+	: m_path(Emu.PPUCache())
+{
+}
+
+u64* spu_profiler::add(const std::vector<u32>& func)
+{
+	const u64 hash = spu_cache::hash(func);
+
+	std::lock_guard lock(m_mutex);
+
+	const auto found = m_map.find(hash);
+
+	if (found != m_map.end())
+	{
+		return &m_funcs[found->second].entries.raw();
+	}
+
+	m_map.emplace(hash, m_funcs.size());
+
+	auto& stat = m_funcs.emplace_back();
+	stat.data = func;
+	stat.hash = hash;
+	return &stat.entries.raw();
+}
+
+void spu_profiler::operator()()
+{
+	// Last matched function for each SPU thread (ID -> m_funcs index)
+	std::unordered_map<u32, std::size_t> last;
+
+	while (thread_ctrl::state() != thread_state::aborting)
+	{
+		thread_ctrl::wait_for(1000);
+
+		reader_lock lock(m_mutex);
+
+		// Check whether the function is currently loaded in LS and contains the PC
+		const auto test = [&](const func_stat& stat, const u32* ls, u32 pc)
+		{
+			const u32 start = stat.data[0];
+			const u32 size = ::size32(stat.data) - 1;
+
+			if (pc < start || pc >= start + size * 4)
+			{
+				return false;
+			}
+
+			return std::memcmp(ls + start / 4, stat.data.data() + 1, size * 4) == 0;
+		};
+
+		idm::select<named_thread<spu_thread>>([&](u32 id, spu_thread& spu)
+		{
+			if (spu.state & (cpu_flag::stop + cpu_flag::dbg_global_stop) || !spu.jit)
+			{
+				return;
+			}
+
+			const u32 pc = spu.pc;
+			const auto ls = static_cast<const u32*>(vm::base(spu.offset));
+
+			const auto it = last.find(id);
+
+			if (it != last.end() && it->second < m_funcs.size() && test(m_funcs[it->second], ls, pc))
+			{
+				m_funcs[it->second].samples++;
+				return;
+			}
+
+			for (std::size_t i = 0; i < m_funcs.size(); i++)
+			{
+				if (test(m_funcs[i], ls, pc))
+				{
+					m_funcs[i].samples++;
+					last[id] = i;
+					return;
+				}
+			}
+
+			m_unknown++;
+		});
+	}
+
+	dump();
+}
+
+void spu_profiler::dump()
+{
+	reader_lock lock(m_mutex);
+
+	std::vector<const func_stat*> sorted;
+	sorted.reserve(m_funcs.size());
+
+	u64 total = m_unknown;
+
+	for (const auto& stat : m_funcs)
+	{
+		sorted.emplace_back(&stat);
+		total += stat.samples;
+	}
+
+	std::stable_sort(sorted.begin(), sorted.end(), [](const func_stat* a, const func_stat* b)
+	{
+		return a->samples > b->samples || (a->samples == b->samples && a->entries > b->entries);
+	});
+
+	std::string out;
+	fmt::append(out, "SPU Profiler: %u functions, %u samples (%u unknown)\n", sorted.size(), total, m_unknown);
+
+	for (const auto stat : sorted)
+	{
+		fmt::append(out, "[0x%05x] size=%u hash=%016x entries=%u samples=%u (%.2f%%)\n", stat->data[0], stat->data.size() - 1, stat->hash,
+			stat->entries.load(), stat->samples.load(), total ? stat->samples * 100. / total : 0.);
+	}
+
+	for (std::size_t i = 0; i < sorted.size() && i < 10; i++)
+	{
+		LOG_NOTICE(SPU, "Profiler: [0x%05x] hash=%016x entries=%u samples=%u", sorted[i]->data[0], sorted[i]->hash, sorted[i]->entries.load(), sorted[i]->samples.load());
+	}
+
+	if (!m_path.empty())
+	{
+		fs::file(m_path + "spu-profile.log", fs::rewrite).write(out);
+		LOG_SUCCESS(SPU, "SPU Profiler: report written to %sspu-profile.log", m_path);
+	}
+}
+
 spu_recompiler_base::spu_recompiler_base()
 {
 	result.reserve(8192);
@@ -1047,6 +1601,11 @@ void spu_recompiler_base::make_function(const std::vector<u32>& data)
 	{
 		if (LIKELY(compile(reset_count, data)))
 		{
+			if (g_cfg.core.spu_tiered && g_cfg.core.spu_decoder == spu_decoder_type::asmjit)
+			{
+				enqueue_upgrade(reset_count, data);
+			}
+
 			break;
 		}
 
@@ -1054,6 +1613,14 @@ void spu_recompiler_base::make_function(const std::vector<u32>& data)
 	}
 }
 
+spu_function_t spu_recompiler_base::upgrade(u64 last_reset_count, const std::vector<u32>& data)
+{
+	m_upgrade = true;
+	const auto result = compile(last_reset_count, data);
+	m_upgrade = false;
+	return result;
+}
+
 void spu_recompiler_base::dispatch(spu_thread& spu, void*, u8* rip)
 {
 	// If code verification failed from a patched patchpoint, clear it with a dispatcher jump
@@ -1084,12 +1651,13 @@ void spu_recompiler_base::dispatch(spu_thread& spu, void*, u8* rip)
 	}
 
 	// Compile
+	timeline::scoped_event event("SPU", "Dispatch (compile)", spu.pc);
 	spu.jit->make_function(spu.jit->analyse(spu._ptr<u32>(0), spu.pc));
 
 	// Diagnostic
 	if (g_cfg.core.spu_block_size == spu_block_size_type::giga)
 	{
-		const v128 _info = spu.stack_mirror[(spu.gpr[1]._u32[3] & 0x3fff0) >> 4];
+		const v128 _info = spu.ret_stack[spu.ret_stack_pos / sizeof(v128)];
 
 		if (_info._u64[0] + 1)
 		{
@@ -2893,187 +3461,586 @@ const std::vector<u32>& spu_recompiler_base::analyse(const be_t<u32>* ls, u32 en
 		}
 	}
 
-	// Check function blocks, verify and print some reasons
-	for (auto& f : m_funcs)
+	// Check function blocks, verify and print some reasons
+	for (auto& f : m_funcs)
+	{
+		if (g_cfg.core.spu_block_size != spu_block_size_type::giga)
+		{
+			break;
+		}
+
+		bool is_ok = true;
+
+		u32 used_stack = 0;
+
+		for (auto it = m_bbs.lower_bound(f.first); it != m_bbs.end() && it->second.func == f.first; ++it)
+		{
+			auto& bb       = it->second;
+			auto& func     = m_funcs.at(bb.func);
+			const u32 addr = it->first;
+			const u32 flim = bb.func + func.size * 4;
+
+			used_stack |= bb.stack_sub;
+
+			if (is_ok && bb.terminator >= term_type::indirect_call)
+			{
+				is_ok = false;
+			}
+
+			if (is_ok && bb.terminator == term_type::ret)
+			{
+				// Check $LR (alternative return registers are currently not supported)
+				if (u32 lr_orig = bb.reg_mod[s_reg_lr] ? addr : bb.reg_origin_abs[s_reg_lr]; lr_orig < 0x40000)
+				{
+					auto& src = m_bbs.at(lr_orig);
+
+					if (src.reg_load_mod[s_reg_lr] != func.reg_save_off[s_reg_lr])
+					{
+						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $LR mismatch (src=0x%x; 0x%x vs 0x%x)", f.first, addr, lr_orig, src.reg_load_mod[0], func.reg_save_off[0]);
+						is_ok = false;
+					}
+					else if (src.reg_load_mod[s_reg_lr] == 0)
+					{
+						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $LR modified (src=0x%x)", f.first, addr, lr_orig);
+						is_ok = false;
+					}
+				}
+				else if (lr_orig > 0x40000)
+				{
+					LOG_TODO(SPU, "Function 0x%05x: [0x%05x] $LR unpredictable (src=0x%x)", f.first, addr, lr_orig);
+					is_ok = false;
+				}
+
+				// Check $80..$127 (should be restored or unmodified)
+				for (u32 i = s_reg_80; is_ok && i <= s_reg_127; i++)
+				{
+					if (u32 orig = bb.reg_mod[i] ? addr : bb.reg_origin_abs[i]; orig < 0x40000)
+					{
+						auto& src = m_bbs.at(orig);
+
+						if (src.reg_load_mod[i] != func.reg_save_off[i])
+						{
+							LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $%u mismatch (src=0x%x; 0x%x vs 0x%x)", f.first, addr, i, orig, src.reg_load_mod[i], func.reg_save_off[i]);
+							is_ok = false;
+						}
+					}
+					else if (orig > 0x40000)
+					{
+						LOG_TODO(SPU, "Function 0x%05x: [0x%05x] $%u unpredictable (src=0x%x)", f.first, addr, i, orig);
+						is_ok = false;
+					}
+
+					if (func.reg_save_off[i] + 1 == 0)
+					{
+						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $%u used incorrectly", f.first, addr, i);
+						is_ok = false;
+					}
+				}
+
+				// Check $SP (should be restored or unmodified)
+				if (bb.stack_sub != 0 && bb.stack_sub != 0x80000000)
+				{
+					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] return with stack frame 0x%x", f.first, addr, bb.stack_sub);
+					is_ok = false;
+				}
+			}
+
+			if (is_ok && bb.terminator == term_type::call)
+			{
+				// Check call instruction (TODO)
+				if (bb.stack_sub == 0)
+				{
+					// Call without a stack frame
+					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] frameless call", f.first, addr);
+					is_ok = false;
+				}
+			}
+
+			if (is_ok && bb.terminator == term_type::fallthrough)
+			{
+				// Can't just fall out of the function
+				if (bb.targets.size() != 1 || bb.targets[0] >= flim)
+				{
+					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] bad fallthrough to 0x%x", f.first, addr, bb.targets[0]);
+					is_ok = false;
+				}
+			}
+
+			if (is_ok && bb.stack_sub == 0x80000000)
+			{
+				LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] bad stack frame", f.first, addr);
+				is_ok = false;
+			}
+
+			// Fill external function targets (calls, possibly tail calls)
+			for (u32 target : bb.targets)
+			{
+				if (target < bb.func || target >= flim || (bb.terminator == term_type::call && target == bb.func))
+				{
+					if (func.calls.find_first_of(target) + 1 == 0)
+					{
+						func.calls.push_back(target);
+					}
+				}
+			}
+		}
+
+		if (is_ok && used_stack && f.first == entry_point)
+		{
+			LOG_ERROR(SPU, "Function 0x%05x: considered possible chunk", f.first);
+			is_ok = false;
+		}
+
+		// if (is_ok && f.first > 0x1d240 && f.first < 0x1e000)
+		// {
+		// 	LOG_ERROR(SPU, "Function 0x%05x: manually disabled", f.first);
+		// 	is_ok = false;
+		// }
+
+		f.second.good = is_ok;
+	}
+
+	// Check function call graph
+	while (g_cfg.core.spu_block_size == spu_block_size_type::giga)
+	{
+		bool need_repeat = false;
+
+		for (auto& f : m_funcs)
+		{
+			if (!f.second.good)
+			{
+				continue;
+			}
+
+			for (u32 call : f.second.calls)
+			{
+				const auto ffound = std::as_const(m_funcs).find(call);
+
+				if (ffound == m_funcs.cend() || ffound->second.good == false)
+				{
+					need_repeat = true;
+
+					if (f.second.good)
+					{
+						LOG_ERROR(SPU, "Function 0x%05x: calls bad function (0x%05x)", f.first, call);
+						f.second.good = false;
+					}
+				}
+			}
+		}
+
+		if (!need_repeat)
+		{
+			break;
+		}
+	}
+
+	if (result.size() == 1)
+	{
+		// Blocks starting from 0x0 or invalid instruction won't be compiled, may need special interpreter fallback
+		result.clear();
+	}
+
+	if (!result.empty() && m_cache && g_cfg.core.spu_cache)
+	{
+		if (const u64 hash = spu_cache::hash(result); m_cache->need_info(hash))
+		{
+			std::vector<u8> info;
+			save_analysis(info);
+			m_cache->add_info(hash, info);
+		}
+	}
+
+	return result;
+}
+
+namespace
+{
+	// Analyser state serialization helpers (native layout, the data is only valid for the same build)
+	struct spu_info_writer
+	{
+		std::vector<u8>& out;
+
+		template <typename T>
+		void put(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const auto ptr = reinterpret_cast<const u8*>(&value);
+			out.insert(out.end(), ptr, ptr + sizeof(T));
+		}
+
+		void put(const std::basic_string<u32>& str)
+		{
+			put(::size32(str));
+			const auto ptr = reinterpret_cast<const u8*>(str.data());
+			out.insert(out.end(), ptr, ptr + str.size() * 4);
+		}
+	};
+
+	struct spu_info_reader
+	{
+		const u8* ptr;
+		const u8* end;
+
+		template <typename T>
+		bool get(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			if (static_cast<std::size_t>(end - ptr) < sizeof(T))
+			{
+				return false;
+			}
+
+			std::memcpy(&value, ptr, sizeof(T));
+			ptr += sizeof(T);
+			return true;
+		}
+
+		bool get(std::basic_string<u32>& str)
+		{
+			u32 size;
+
+			if (!get(size) || static_cast<std::size_t>(end - ptr) / 4 < size)
+			{
+				return false;
+			}
+
+			str.resize(size);
+			std::memcpy(str.data(), ptr, size * 4);
+			ptr += size * 4;
+			return true;
+		}
+	};
+}
+
+bool spu_recompiler_base::analyse_cached(spu_cache* cache, std::vector<be_t<u32>>& ls, const std::vector<u32>& func)
+{
+	if (cache)
+	{
+		std::vector<u8> info;
+
+		if (cache->get_info(spu_cache::hash(func), info) && load_analysis(func, info))
+		{
+			return true;
+		}
+	}
+
+	// Get data start
+	const u32 start = func[0];
+	const u32 size0 = ::size32(func);
+
+	// Initialize LS with function data only
+	for (u32 i = 1, pos = start; i < size0; i++, pos += 4)
+	{
+		ls[pos / 4] = se_storage<u32>::swap(func[i]);
+	}
+
+	// Call analyser
+	const std::vector<u32>& func2 = analyse(ls.data(), func[0]);
+
+	bool ok = func2.size() == size0;
+
+	if (!ok)
+	{
+		LOG_ERROR(SPU, "[0x%05x] SPU Analyser failed, %u vs %u", func[0], func2.size() - 1, size0 - 1);
+	}
+
+	// Clear fake LS
+	for (u32 i = 1, pos = start; i < func2.size(); i++, pos += 4)
+	{
+		if (se_storage<u32>::swap(func2[i]) != ls[pos / 4])
+		{
+			LOG_ERROR(SPU, "[0x%05x] SPU Analyser failed at 0x%x", func2[0], pos);
+			ok = false;
+		}
+
+		ls[pos / 4] = 0;
+	}
+
+	if (func2.size() != size0)
+	{
+		std::memset(ls.data(), 0, 0x40000);
+	}
+	else if (ok && cache && !m_cache)
+	{
+		// Not registered yet (precompilation)
+		if (const u64 hash = spu_cache::hash(func2); cache->need_info(hash))
+		{
+			std::vector<u8> info;
+			save_analysis(info);
+			cache->add_info(hash, info);
+		}
+	}
+
+	return ok;
+}
+
+void spu_recompiler_base::save_analysis(std::vector<u8>& out) const
+{
+	out.clear();
+
+	spu_info_writer w{out};
+
+	const u32 start = result[0] / 4;
+	const u32 count = ::size32(result) - 1;
+
+	w.put(u32{s_reg_max});
+	w.put(result[0]);
+	w.put(count);
+
+	const auto put_bits = [&](const std::bitset<0x10000>& bits)
+	{
+		std::basic_string<u32> set;
+
+		for (u32 i = 0; i < 0x10000; i++)
+		{
+			if (bits[i])
+			{
+				set += i;
+			}
+		}
+
+		w.put(set);
+	};
+
+	put_bits(m_block_info);
+	put_bits(m_entry_info);
+	put_bits(m_ret_info);
+
+	for (u32 i = start; i < start + count; i++)
+	{
+		w.put(m_regmod[i]);
+		w.put(m_use_ra[i]);
+		w.put(m_use_rb[i]);
+		w.put(m_use_rc[i]);
+	}
+
+	const auto put_map = [&](const auto& map)
+	{
+		w.put(::size32(map));
+
+		for (const auto& [addr, list] : map)
+		{
+			w.put(addr);
+			w.put(list);
+		}
+	};
+
+	put_map(m_targets);
+	put_map(m_preds);
+
+	w.put(::size32(m_bbs));
+
+	for (const auto& [addr, bb] : m_bbs)
+	{
+		w.put(addr);
+		w.put(bb.chunk);
+		w.put(bb.size);
+		w.put(bb.analysed);
+		w.put(bb.terminator);
+		w.put(bb.reg_mod);
+		w.put(bb.reg_mod_xf);
+		w.put(bb.reg_maybe_xf);
+		w.put(bb.reg_use);
+		w.put(bb.reg_const);
+		w.put(bb.reg_save_dom);
+		w.put(bb.func);
+		w.put(bb.stack_sub);
+		w.put(bb.reg_val32);
+		w.put(bb.reg_load_mod);
+		w.put(bb.reg_origin);
+		w.put(bb.reg_origin_abs);
+		w.put(bb.targets);
+		w.put(bb.preds);
+	}
+
+	w.put(m_chunks);
+
+	w.put(::size32(m_funcs));
+
+	for (const auto& [addr, f] : m_funcs)
+	{
+		w.put(addr);
+		w.put(f.size);
+		w.put(f.good);
+		w.put(f.calls);
+		w.put(f.reg_save_off);
+	}
+}
+
+u32 spu_recompiler_base::analysis_key()
+{
+	static const u32 s_key = []
+	{
+		// Any mismatch discards the whole analyser state file, a stale layout must never be loaded
+		const std::string id = fmt::format("%u:%s:%u:%u:%u", spu_cache::info_version, rpcs3::version.to_string(), u32{s_reg_max}, sizeof(block_info), sizeof(func_info));
+
+		sha1_context ctx;
+		u8 output[20];
+
+		sha1_starts(&ctx);
+		sha1_update(&ctx, reinterpret_cast<const u8*>(id.data()), id.size());
+		sha1_finish(&ctx, output);
+
+		u32 result;
+		std::memcpy(&result, output, sizeof(result));
+		return result;
+	}();
+
+	return s_key;
+}
+
+bool spu_recompiler_base::load_analysis(const std::vector<u32>& func, const std::vector<u8>& data)
+{
+	spu_info_reader r{data.data(), data.data() + data.size()};
+
+	u32 reg_max, entry, count;
+
+	if (!r.get(reg_max) || !r.get(entry) || !r.get(count))
+	{
+		return false;
+	}
+
+	if (reg_max != s_reg_max || func.empty() || entry != func[0] || count != func.size() - 1 || entry / 4 + count > 0x10000)
+	{
+		return false;
+	}
+
+	const auto get_bits = [&](std::bitset<0x10000>& bits)
+	{
+		std::basic_string<u32> set;
+
+		if (!r.get(set))
+		{
+			return false;
+		}
+
+		bits.reset();
+
+		for (u32 i : set)
+		{
+			bits.set(i & 0xffff);
+		}
+
+		return true;
+	};
+
+	if (!get_bits(m_block_info) || !get_bits(m_entry_info) || !get_bits(m_ret_info))
+	{
+		return false;
+	}
+
+	std::memset(m_regmod.data(), 0xff, sizeof(m_regmod));
+	std::memset(m_use_ra.data(), 0xff, sizeof(m_use_ra));
+	std::memset(m_use_rb.data(), 0xff, sizeof(m_use_rb));
+	std::memset(m_use_rc.data(), 0xff, sizeof(m_use_rc));
+
+	for (u32 i = entry / 4; i < entry / 4 + count; i++)
+	{
+		if (!r.get(m_regmod[i]) || !r.get(m_use_ra[i]) || !r.get(m_use_rb[i]) || !r.get(m_use_rc[i]))
+		{
+			return false;
+		}
+	}
+
+	const auto get_map = [&](auto& map)
 	{
-		if (g_cfg.core.spu_block_size != spu_block_size_type::giga)
+		u32 size;
+
+		if (!r.get(size))
 		{
-			break;
+			return false;
 		}
 
-		bool is_ok = true;
-
-		u32 used_stack = 0;
+		map.clear();
 
-		for (auto it = m_bbs.lower_bound(f.first); it != m_bbs.end() && it->second.func == f.first; ++it)
+		for (u32 i = 0; i < size; i++)
 		{
-			auto& bb       = it->second;
-			auto& func     = m_funcs.at(bb.func);
-			const u32 addr = it->first;
-			const u32 flim = bb.func + func.size * 4;
-
-			used_stack |= bb.stack_sub;
+			u32 addr;
 
-			if (is_ok && bb.terminator >= term_type::indirect_call)
+			if (!r.get(addr) || !r.get(map[addr]))
 			{
-				is_ok = false;
+				return false;
 			}
+		}
 
-			if (is_ok && bb.terminator == term_type::ret)
-			{
-				// Check $LR (alternative return registers are currently not supported)
-				if (u32 lr_orig = bb.reg_mod[s_reg_lr] ? addr : bb.reg_origin_abs[s_reg_lr]; lr_orig < 0x40000)
-				{
-					auto& src = m_bbs.at(lr_orig);
-
-					if (src.reg_load_mod[s_reg_lr] != func.reg_save_off[s_reg_lr])
-					{
-						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $LR mismatch (src=0x%x; 0x%x vs 0x%x)", f.first, addr, lr_orig, src.reg_load_mod[0], func.reg_save_off[0]);
-						is_ok = false;
-					}
-					else if (src.reg_load_mod[s_reg_lr] == 0)
-					{
-						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $LR modified (src=0x%x)", f.first, addr, lr_orig);
-						is_ok = false;
-					}
-				}
-				else if (lr_orig > 0x40000)
-				{
-					LOG_TODO(SPU, "Function 0x%05x: [0x%05x] $LR unpredictable (src=0x%x)", f.first, addr, lr_orig);
-					is_ok = false;
-				}
-
-				// Check $80..$127 (should be restored or unmodified)
-				for (u32 i = s_reg_80; is_ok && i <= s_reg_127; i++)
-				{
-					if (u32 orig = bb.reg_mod[i] ? addr : bb.reg_origin_abs[i]; orig < 0x40000)
-					{
-						auto& src = m_bbs.at(orig);
-
-						if (src.reg_load_mod[i] != func.reg_save_off[i])
-						{
-							LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $%u mismatch (src=0x%x; 0x%x vs 0x%x)", f.first, addr, i, orig, src.reg_load_mod[i], func.reg_save_off[i]);
-							is_ok = false;
-						}
-					}
-					else if (orig > 0x40000)
-					{
-						LOG_TODO(SPU, "Function 0x%05x: [0x%05x] $%u unpredictable (src=0x%x)", f.first, addr, i, orig);
-						is_ok = false;
-					}
-
-					if (func.reg_save_off[i] + 1 == 0)
-					{
-						LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] $%u used incorrectly", f.first, addr, i);
-						is_ok = false;
-					}
-				}
+		return true;
+	};
 
-				// Check $SP (should be restored or unmodified)
-				if (bb.stack_sub != 0 && bb.stack_sub != 0x80000000)
-				{
-					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] return with stack frame 0x%x", f.first, addr, bb.stack_sub);
-					is_ok = false;
-				}
-			}
+	if (!get_map(m_targets) || !get_map(m_preds))
+	{
+		return false;
+	}
 
-			if (is_ok && bb.terminator == term_type::call)
-			{
-				// Check call instruction (TODO)
-				if (bb.stack_sub == 0)
-				{
-					// Call without a stack frame
-					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] frameless call", f.first, addr);
-					is_ok = false;
-				}
-			}
+	u32 nbbs;
 
-			if (is_ok && bb.terminator == term_type::fallthrough)
-			{
-				// Can't just fall out of the function
-				if (bb.targets.size() != 1 || bb.targets[0] >= flim)
-				{
-					LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] bad fallthrough to 0x%x", f.first, addr, bb.targets[0]);
-					is_ok = false;
-				}
-			}
+	if (!r.get(nbbs))
+	{
+		return false;
+	}
 
-			if (is_ok && bb.stack_sub == 0x80000000)
-			{
-				LOG_ERROR(SPU, "Function 0x%05x: [0x%05x] bad stack frame", f.first, addr);
-				is_ok = false;
-			}
+	m_bbs.clear();
 
-			// Fill external function targets (calls, possibly tail calls)
-			for (u32 target : bb.targets)
-			{
-				if (target < bb.func || target >= flim || (bb.terminator == term_type::call && target == bb.func))
-				{
-					if (func.calls.find_first_of(target) + 1 == 0)
-					{
-						func.calls.push_back(target);
-					}
-				}
-			}
-		}
+	for (u32 i = 0; i < nbbs; i++)
+	{
+		u32 addr;
 
-		if (is_ok && used_stack && f.first == entry_point)
+		if (!r.get(addr))
 		{
-			LOG_ERROR(SPU, "Function 0x%05x: considered possible chunk", f.first);
-			is_ok = false;
+			return false;
 		}
 
-		// if (is_ok && f.first > 0x1d240 && f.first < 0x1e000)
-		// {
-		// 	LOG_ERROR(SPU, "Function 0x%05x: manually disabled", f.first);
-		// 	is_ok = false;
-		// }
+		auto& bb = m_bbs[addr];
 
-		f.second.good = is_ok;
+		if (!r.get(bb.chunk) || !r.get(bb.size) || !r.get(bb.analysed) || !r.get(bb.terminator) ||
+			!r.get(bb.reg_mod) || !r.get(bb.reg_mod_xf) || !r.get(bb.reg_maybe_xf) || !r.get(bb.reg_use) ||
+			!r.get(bb.reg_const) || !r.get(bb.reg_save_dom) || !r.get(bb.func) || !r.get(bb.stack_sub) ||
+			!r.get(bb.reg_val32) || !r.get(bb.reg_load_mod) || !r.get(bb.reg_origin) || !r.get(bb.reg_origin_abs) ||
+			!r.get(bb.targets) || !r.get(bb.preds))
+		{
+			return false;
+		}
 	}
 
-	// Check function call graph
-	while (g_cfg.core.spu_block_size == spu_block_size_type::giga)
+	if (!r.get(m_chunks))
 	{
-		bool need_repeat = false;
+		return false;
+	}
 
-		for (auto& f : m_funcs)
-		{
-			if (!f.second.good)
-			{
-				continue;
-			}
+	u32 nfuncs;
 
-			for (u32 call : f.second.calls)
-			{
-				const auto ffound = std::as_const(m_funcs).find(call);
+	if (!r.get(nfuncs))
+	{
+		return false;
+	}
 
-				if (ffound == m_funcs.cend() || ffound->second.good == false)
-				{
-					need_repeat = true;
+	m_funcs.clear();
 
-					if (f.second.good)
-					{
-						LOG_ERROR(SPU, "Function 0x%05x: calls bad function (0x%05x)", f.first, call);
-						f.second.good = false;
-					}
-				}
-			}
+	for (u32 i = 0; i < nfuncs; i++)
+	{
+		u32 addr;
+
+		if (!r.get(addr))
+		{
+			return false;
 		}
 
-		if (!need_repeat)
+		auto& f = m_funcs[addr];
+
+		if (!r.get(f.size) || !r.get(f.good) || !r.get(f.calls) || !r.get(f.reg_save_off))
 		{
-			break;
+			return false;
 		}
 	}
 
-	if (result.size() == 1)
+	if (r.ptr != r.end)
 	{
-		// Blocks starting from 0x0 or invalid instruction won't be compiled, may need special interpreter fallback
-		result.clear();
+		return false;
 	}
 
-	return result;
+	result = func;
+	return true;
 }
 
 void spu_recompiler_base::dump(std::string& out)
@@ -3179,6 +4146,10 @@ class spu_llvm_recompiler : public spu_recompiler_base, public cpu_translator
 	// Module name
 	std::string m_hash;
 
+	// Xfloat emulation mode for the current function
+	bool m_accurate_xfloat = false;
+	bool m_approx_xfloat = false;
+
 	// Current function (chunk)
 	llvm::Function* m_function;
 
@@ -4116,7 +5087,7 @@ public:
 			return compile_interpreter();
 		}
 
-		const auto fn_location = m_spurt->find(last_reset_count, func);
+		const auto fn_location = m_upgrade ? m_spurt->find_compiled(last_reset_count, func) : m_spurt->find(last_reset_count, func);
 
 		if (fn_location == spu_runtime::g_dispatcher)
 		{
@@ -4147,6 +5118,8 @@ public:
 			fmt::append(m_hash, "spu-0x%05x-%s", func[0], fmt::base57(output));
 		}
 
+		set_xfloat_mode(func);
+
 		if (m_cache)
 		{
 			LOG_SUCCESS(SPU, "LLVM: Building %s (size %u)...", m_hash, func.size() - 1);
@@ -4314,6 +5287,13 @@ public:
 		const auto pbcount = spu_ptr<u64>(&spu_thread::block_counter);
 		m_ir->CreateStore(m_ir->CreateAdd(m_ir->CreateLoad(pbcount), m_ir->getInt64(check_iterations)), pbcount);
 
+		if (const auto prof = fxm::get<named_thread<spu_profiler>>())
+		{
+			// Increase function entry counter (profiler)
+			const auto pentries = m_ir->CreateIntToPtr(m_ir->getInt64(reinterpret_cast<u64>(prof->add(func))), get_type<u64*>());
+			m_ir->CreateAtomicRMW(llvm::AtomicRMWInst::Add, pentries, m_ir->getInt64(1), llvm::AtomicOrdering::Monotonic);
+		}
+
 		// Call the entry function chunk
 		const auto entry_chunk = add_function(m_pos);
 		const auto entry_call = m_ir->CreateCall(entry_chunk->chunk, {m_thread, m_lsptr, m_base_pc});
@@ -4425,7 +5405,7 @@ public:
 						if (src > 0x40000)
 						{
 							// Use the xfloat hint to create 256-bit (4x double) PHI
-							llvm::Type* type = g_cfg.core.spu_accurate_xfloat && bb.reg_maybe_xf[i] ? get_type<f64[4]>() : get_reg_type(i);
+							llvm::Type* type = m_accurate_xfloat && bb.reg_maybe_xf[i] ? get_type<f64[4]>() : get_reg_type(i);
 
 							const auto _phi = m_ir->CreatePHI(type, ::size32(bb.preds), fmt::format("phi0x%05x_r%u", baddr, i));
 							m_block->phi[i] = _phi;
@@ -4745,10 +5725,41 @@ public:
 		}
 	}
 
+	// Choose xfloat emulation for the function: accurate xfloat only pays off when enough instructions work on xfloat values
+	void set_xfloat_mode(const std::vector<u32>& func)
+	{
+		m_accurate_xfloat = g_cfg.core.spu_accurate_xfloat.get();
+		m_approx_xfloat = g_cfg.core.spu_approx_xfloat.get();
+
+		if (!m_accurate_xfloat || g_cfg.core.spu_accurate_xfloat_threshold == 0 || func.empty())
+		{
+			return;
+		}
+
+		u32 count = 0;
+
+		for (u32 i = 1; i < func.size(); i++)
+		{
+			if (func[i] && s_spu_itype.decode(func[i]) & spu_itype::xfloat)
+			{
+				count++;
+			}
+		}
+
+		if (count < g_cfg.core.spu_accurate_xfloat_threshold)
+		{
+			// Sparse float code: avoid double conversions on every register load and store
+			m_accurate_xfloat = false;
+			m_approx_xfloat = true;
+		}
+	}
+
 	spu_function_t compile_interpreter()
 	{
 		using namespace llvm;
 
+		set_xfloat_mode({});
+
 		// Create LLVM module
 		std::unique_ptr<Module> module = std::make_unique<Module>("spu_interpreter.obj", m_context);
 		module->setTargetTriple(Triple::normalize(sys::getProcessTriple()));
@@ -6996,7 +8007,7 @@ public:
 	void FREST(spu_opcode_t op)
 	{
 		// TODO
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, fsplat<f64[4]>(1.0) / get_vr<f64[4]>(op.ra));
 		else
 			set_vr(op.rt, fsplat<f32[4]>(1.0) / get_vr<f32[4]>(op.ra));
@@ -7005,7 +8016,7 @@ public:
 	void FRSQEST(spu_opcode_t op)
 	{
 		// TODO
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, fsplat<f64[4]>(1.0) / sqrt(fabs(get_vr<f64[4]>(op.ra))));
 		else
 			set_vr(op.rt, fsplat<f32[4]>(1.0) / sqrt(fabs(get_vr<f32[4]>(op.ra))));
@@ -7013,7 +8024,7 @@ public:
 
 	void FCGT(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(get_vr<f64[4]>(op.ra) > get_vr<f64[4]>(op.rb))));
 			return;
@@ -7023,7 +8034,7 @@ public:
 		const auto b = get_vr<f32[4]>(op.rb);
 
 		// See FCMGT.
-		if (g_cfg.core.spu_approx_xfloat)
+		if (m_approx_xfloat)
 		{
 			const auto ia = bitcast<s32[4]>(fabs(a));
 			const auto ib = bitcast<s32[4]>(fabs(b));
@@ -7042,7 +8053,7 @@ public:
 
 	void FCMGT(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(fabs(get_vr<f64[4]>(op.ra)) > fabs(get_vr<f64[4]>(op.rb)))));
 			return;
@@ -7054,7 +8065,7 @@ public:
 		const auto abs_b = fabs(b);
 
 		// Actually, it's accurate and can be used as an alternative path for accurate xfloat.
-		if (g_cfg.core.spu_approx_xfloat)
+		if (m_approx_xfloat)
 		{
 			// Compare abs values as integers, but return false if both are denormals or zeros.
 			const auto ia = bitcast<s32[4]>(abs_a);
@@ -7070,7 +8081,7 @@ public:
 
 	void FA(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, get_vr<f64[4]>(op.ra) + get_vr<f64[4]>(op.rb));
 		else
 			set_vr(op.rt, get_vr<f32[4]>(op.ra) + get_vr<f32[4]>(op.rb));
@@ -7078,7 +8089,7 @@ public:
 
 	void FS(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, get_vr<f64[4]>(op.ra) - get_vr<f64[4]>(op.rb));
 		else
 			set_vr(op.rt, get_vr<f32[4]>(op.ra) - get_vr<f32[4]>(op.rb));
@@ -7086,9 +8097,9 @@ public:
 
 	void FM(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, get_vr<f64[4]>(op.ra) * get_vr<f64[4]>(op.rb));
-		else if (g_cfg.core.spu_approx_xfloat)
+		else if (m_approx_xfloat)
 		{
 			const auto a = get_vr<f32[4]>(op.ra);
 			const auto b = get_vr<f32[4]>(op.rb);
@@ -7114,7 +8125,7 @@ public:
 
 	void FESD(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			const auto r = shuffle2(get_vr<f64[4]>(op.ra), fsplat<f64[4]>(0.), 1, 3);
 			const auto d = bitcast<s64[2]>(r);
@@ -7134,7 +8145,7 @@ public:
 
 	void FRDS(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			const auto r = get_vr<f64[2]>(op.ra);
 			const auto d = bitcast<s64[2]>(r);
@@ -7155,7 +8166,7 @@ public:
 
 	void FCEQ(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(get_vr<f64[4]>(op.ra) == get_vr<f64[4]>(op.rb))));
 		else
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(get_vr<f32[4]>(op.ra) == get_vr<f32[4]>(op.rb))));
@@ -7163,7 +8174,7 @@ public:
 
 	void FCMEQ(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(fabs(get_vr<f64[4]>(op.ra)) == fabs(get_vr<f64[4]>(op.rb)))));
 		else
 			set_vr(op.rt, sext<s32[4]>(fcmp_ord(fabs(get_vr<f32[4]>(op.ra)) == fabs(get_vr<f32[4]>(op.rb)))));
@@ -7181,9 +8192,9 @@ public:
 	void FNMS(spu_opcode_t op)
 	{
 		// See FMA.
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt4, -fmuladd(get_vr<f64[4]>(op.ra), get_vr<f64[4]>(op.rb), eval(-get_vr<f64[4]>(op.rc))));
-		else if (g_cfg.core.spu_approx_xfloat)
+		else if (m_approx_xfloat)
 			set_vr(op.rt4, get_vr<f32[4]>(op.rc) - mzero_if_xtended(get_vr<f32[4]>(op.ra), get_vr<f32[4]>(op.rb)));
 		else
 			set_vr(op.rt4, get_vr<f32[4]>(op.rc) - get_vr<f32[4]>(op.ra) * get_vr<f32[4]>(op.rb));
@@ -7192,9 +8203,9 @@ public:
 	void FMA(spu_opcode_t op)
 	{
 		// Hardware FMA produces the same result as multiple + add on the limited double range (xfloat).
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt4, fmuladd(get_vr<f64[4]>(op.ra), get_vr<f64[4]>(op.rb), get_vr<f64[4]>(op.rc)));
-		else if (g_cfg.core.spu_approx_xfloat)
+		else if (m_approx_xfloat)
 			set_vr(op.rt4, mzero_if_xtended(get_vr<f32[4]>(op.ra), get_vr<f32[4]>(op.rb)) + get_vr<f32[4]>(op.rc));
 		else
 			set_vr(op.rt4, get_vr<f32[4]>(op.ra) * get_vr<f32[4]>(op.rb) + get_vr<f32[4]>(op.rc));
@@ -7203,9 +8214,9 @@ public:
 	void FMS(spu_opcode_t op)
 	{
 		// See FMA.
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt4, fmuladd(get_vr<f64[4]>(op.ra), get_vr<f64[4]>(op.rb), eval(-get_vr<f64[4]>(op.rc))));
-		else if (g_cfg.core.spu_approx_xfloat)
+		else if (m_approx_xfloat)
 			set_vr(op.rt4, mzero_if_xtended(get_vr<f32[4]>(op.ra), get_vr<f32[4]>(op.rb)) - get_vr<f32[4]>(op.rc));
 		else
 			set_vr(op.rt4, get_vr<f32[4]>(op.ra) * get_vr<f32[4]>(op.rb) - get_vr<f32[4]>(op.rc));
@@ -7214,7 +8225,7 @@ public:
 	void FI(spu_opcode_t op)
 	{
 		// TODO
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 			set_vr(op.rt, get_vr<f64[4]>(op.rb));
 		else
 			set_vr(op.rt, get_vr<f32[4]>(op.rb));
@@ -7222,7 +8233,7 @@ public:
 
 	void CFLTS(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			value_t<f64[4]> a = get_vr<f64[4]>(op.ra);
 			value_t<f64[4]> s;
@@ -7296,7 +8307,7 @@ public:
 
 	void CFLTU(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			value_t<f64[4]> a = get_vr<f64[4]>(op.ra);
 			value_t<f64[4]> s;
@@ -7370,7 +8381,7 @@ public:
 
 	void CSFLT(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			value_t<s32[4]> a = get_vr<s32[4]>(op.ra);
 			value_t<f64[4]> r;
@@ -7411,7 +8422,7 @@ public:
 
 	void CUFLT(spu_opcode_t op)
 	{
-		if (g_cfg.core.spu_accurate_xfloat)
+		if (m_accurate_xfloat)
 		{
 			value_t<s32[4]> a = get_vr<s32[4]>(op.ra);
 			value_t<f64[4]> r;
@@ -7668,21 +8679,6 @@ public:
 			return result;
 		}
 
-		// Load stack addr if necessary
-		value_t<u32> sp;
-
-		if (ret && g_cfg.core.spu_block_size != spu_block_size_type::safe)
-		{
-			if (op.opcode)
-			{
-				sp = eval(extract(get_reg_fixed(1), 3) & 0x3fff0);
-			}
-			else
-			{
-				sp.value = m_ir->CreateLoad(spu_ptr<u32>(&spu_thread::gpr, 1, &v128::_u32, 3));
-			}
-		}
-
 		const auto cblock = m_ir->GetInsertBlock();
 		const auto result = llvm::BasicBlock::Create(m_context, "", m_function);
 		m_ir->SetInsertPoint(result);
@@ -7702,18 +8698,24 @@ public:
 
 		if (ret && g_cfg.core.spu_block_size >= spu_block_size_type::mega)
 		{
-			// Compare address stored in stack mirror with addr
-			const auto stack0 = eval(zext<u64>(sp) + ::offset32(&spu_thread::stack_mirror));
-			const auto stack1 = eval(stack0 + 8);
-			const auto _ret = m_ir->CreateLoad(m_ir->CreateBitCast(m_ir->CreateGEP(m_thread, stack0.value), type));
-			const auto link = m_ir->CreateLoad(m_ir->CreateBitCast(m_ir->CreateGEP(m_thread, stack1.value), get_type<u64*>()));
+			// Compare return addresses of the top two shadow link stack entries with addr
+			// The second one is taken if a call returned without popping its entry
+			const auto pos0 = m_ir->CreateLoad(spu_ptr<u32>(&spu_thread::ret_stack_pos));
+			const auto pos1 = m_ir->CreateAnd(m_ir->CreateSub(pos0, m_ir->getInt32(16)), 0x1f0);
+			const auto link0 = m_ir->CreateLoad(m_ir->CreateBitCast(ret_stack_entry(pos0, 8), get_type<u64*>()));
+			const auto link1 = m_ir->CreateLoad(m_ir->CreateBitCast(ret_stack_entry(pos1, 8), get_type<u64*>()));
+			const auto hit0 = m_ir->CreateICmpEQ(addr.value, m_ir->CreateTrunc(link0, get_type<u32>()));
+			const auto hit1 = m_ir->CreateICmpEQ(addr.value, m_ir->CreateTrunc(link1, get_type<u32>()));
 			const auto fail = llvm::BasicBlock::Create(m_context, "", m_function);
 			const auto done = llvm::BasicBlock::Create(m_context, "", m_function);
-			m_ir->CreateCondBr(m_ir->CreateICmpEQ(addr.value, m_ir->CreateTrunc(link, get_type<u32>())), done, fail, m_md_likely);
+			m_ir->CreateCondBr(m_ir->CreateOr(hit0, hit1), done, fail, m_md_likely);
 			m_ir->SetInsertPoint(done);
 
-			// Clear stack mirror and return by tail call to the provided return address
-			m_ir->CreateStore(splat<u64[2]>(-1).eval(m_ir), m_ir->CreateBitCast(m_ir->CreateGEP(m_thread, stack0.value), get_type<u64(*)[2]>()));
+			// Pop the entry and return by tail call to the provided return address
+			const auto pos = m_ir->CreateSelect(hit0, pos0, pos1);
+			const auto link = m_ir->CreateSelect(hit0, link0, link1);
+			const auto _ret = m_ir->CreateLoad(m_ir->CreateBitCast(ret_stack_entry(pos), type));
+			m_ir->CreateStore(m_ir->CreateAnd(m_ir->CreateSub(pos, m_ir->getInt32(16)), 0x1f0), spu_ptr<u32>(&spu_thread::ret_stack_pos));
 			tail_chunk(_ret, m_ir->CreateTrunc(m_ir->CreateLShr(link, 32), get_type<u32>()));
 			m_ir->SetInsertPoint(fail);
 		}
@@ -8074,16 +9076,23 @@ public:
 
 		if (g_cfg.core.spu_block_size >= spu_block_size_type::mega && m_block_info[m_pos / 4 + 1] && m_entry_info[m_pos / 4 + 1])
 		{
-			// Store the return function chunk address at the stack mirror
+			// Push the return function chunk address to the shadow link stack
 			const auto pfunc = add_function(m_pos + 4);
-			const auto stack0 = eval(zext<u64>(extract(get_reg_fixed(1), 3) & 0x3fff0) + ::offset32(&spu_thread::stack_mirror));
-			const auto stack1 = eval(stack0 + 8);
+			const auto pos = m_ir->CreateAnd(m_ir->CreateAdd(m_ir->CreateLoad(spu_ptr<u32>(&spu_thread::ret_stack_pos)), m_ir->getInt32(16)), 0x1f0);
 			const auto base_plus_pc = m_ir->CreateOr(m_ir->CreateShl(m_ir->CreateZExt(m_base_pc, get_type<u64>()), 32), m_ir->getInt64(m_pos + 4));
-			m_ir->CreateStore(pfunc->chunk, m_ir->CreateBitCast(m_ir->CreateGEP(m_thread, stack0.value), pfunc->chunk->getType()->getPointerTo()));
-			m_ir->CreateStore(base_plus_pc, m_ir->CreateBitCast(m_ir->CreateGEP(m_thread, stack1.value), get_type<u64*>()));
+			m_ir->CreateStore(pos, spu_ptr<u32>(&spu_thread::ret_stack_pos));
+			m_ir->CreateStore(pfunc->chunk, m_ir->CreateBitCast(ret_stack_entry(pos), pfunc->chunk->getType()->getPointerTo()));
+			m_ir->CreateStore(base_plus_pc, m_ir->CreateBitCast(ret_stack_entry(pos, 8), get_type<u64*>()));
 		}
 	}
 
+	// Get the address of a shadow link stack entry (pos is its byte offset)
+	llvm::Value* ret_stack_entry(llvm::Value* pos, u32 offset = 0)
+	{
+		const auto off = m_ir->CreateAdd(m_ir->CreateZExt(pos, get_type<u64>()), m_ir->getInt64(::offset32(&spu_thread::ret_stack) + offset));
+		return m_ir->CreateGEP(m_thread, off);
+	}
+
 	static const spu_decoder<spu_llvm_recompiler> g_decoder;
 };
 
@@ -8094,6 +9103,68 @@ std::unique_ptr<spu_recompiler_base> spu_recompiler_base::make_llvm_recompiler(u
 
 DECLARE(spu_llvm_recompiler::g_decoder);
 
+// Background LLVM recompiler for functions built by ASMJIT (tiered compilation)
+struct spu_llvm_worker
+{
+	lf_queue<std::pair<u64, std::vector<u32>>> registered;
+
+	void operator()()
+	{
+		// Don't compete with SPU threads
+		thread_ctrl::set_native_priority(-1);
+
+		const auto compiler = spu_recompiler_base::make_llvm_recompiler();
+		compiler->init();
+
+		// Fake LS
+		std::vector<be_t<u32>> ls(0x10000);
+
+		for (auto slice = registered.pop_all(); thread_ctrl::state() != thread_state::aborting; slice ? slice.pop_front() : slice = registered.pop_all())
+		{
+			if (!slice)
+			{
+				registered.wait(10000);
+				continue;
+			}
+
+			if (Emu.IsStopped())
+			{
+				continue;
+			}
+
+			const auto& [reset_count, func] = *slice;
+
+			// Register SPU runtime user only for the duration of a single compilation
+			spu_runtime::passive_lock _passive_lock(compiler->get_runtime());
+
+			if (reset_count != compiler->get_runtime().get_reset_count())
+			{
+				// Runtime was reset, the function is gone
+				continue;
+			}
+
+			// The compiler works on the analyser state of the function
+			compiler->analyse_cached(fxm::get<spu_cache>().get(), ls, func);
+
+			if (!compiler->upgrade(reset_count, func))
+			{
+				LOG_TRACE(SPU, "[0x%05x] LLVM upgrade skipped", func[0]);
+			}
+		}
+	}
+};
+
+void spu_recompiler_base::enqueue_upgrade(u64 last_reset_count, const std::vector<u32>& func)
+{
+	if (func.empty())
+	{
+		return;
+	}
+
+	const auto worker = fxm::get_always<named_thread<spu_llvm_worker>>("SPU LLVM Worker");
+	worker->registered.push(last_reset_count, func);
+}
+
 #else
 
 std::unique_ptr<spu_recompiler_base> spu_recompiler_base::make_llvm_recompiler(u8 magn)
@@ -8106,4 +9177,8 @@ std::unique_ptr<spu_recompiler_base> spu_recompiler_base::make_llvm_recompiler(u
 	fmt::throw_exception("LLVM is not available in this build.");
 }
 
+void spu_recompiler_base::enqueue_upgrade(u64, const std::vector<u32>&)
+{
+}
+
 #endif
@@ -10,14 +10,44 @@
 #include <memory>
 #include <string>
 #include <deque>
+#include <unordered_map>
+#include <array>
 
 // Helper class
 class spu_cache
 {
 	fs::file m_file;
 
+	// Protects m_file appends and m_hashes
+	shared_mutex m_mutex;
+
+	// Full SHA-1 of all functions stored in the file, keyed on hash() (for deduplication)
+	std::unordered_multimap<u64, std::array<u8, 20>, value_hash<u64>> m_hashes;
+
+	// Analyser state file (optional)
+	fs::file m_info_file;
+
+	// Analyser state records stored in m_info_file (hash -> data offset and size)
+	std::unordered_map<u64, std::pair<u64, u32>, value_hash<u64>> m_info;
+
+	// Append function record (unlocked)
+	void write(const std::vector<u32>& func);
+
+	// Remember the function, returns false if an identical one is already stored (unlocked)
+	bool insert(const std::vector<u32>& func);
+
+	// Get SHA-1 of the function (including its address)
+	static std::array<u8, 20> digest(const std::vector<u32>& func);
+
+	// Load analyser state record locations
+	void read_info();
+
 public:
-	spu_cache(const std::string& loc);
+	// Analyser state format version (bump on any change of the analyser or of its state layout)
+	// Records are tagged with spu_recompiler_base::analysis_key(), which also changes with the build and the state structures
+	static constexpr u32 info_version = 1;
+
+	spu_cache(const std::string& loc, const std::string& info_loc = {});
 
 	~spu_cache();
 
@@ -26,11 +56,28 @@ public:
 		return m_file.operator bool();
 	}
 
+	// Read all unique functions, compacting the file if duplicates were found
 	std::deque<std::vector<u32>> get();
 
+	// Append function unless it's already stored
 	void add(const std::vector<u32>& func);
 
+	// Check whether the analyser state for the function hash should be stored
+	bool need_info(u64 hash);
+
+	// Append analyser state unless it's already stored
+	void add_info(u64 hash, const std::vector<u8>& data);
+
+	// Read stored analyser state
+	bool get_info(u64 hash, std::vector<u8>& data);
+
+	// Get 64-bit hash of the function (including its address)
+	static u64 hash(const std::vector<u32>& func);
+
 	static void initialize();
+
+	// Compile all functions of a cache file with each recompiler and block size, write the timings as CSV
+	static bool benchmark(const std::string& path, const std::string& output_path);
 };
 
 // Helper class
@@ -56,6 +103,15 @@ class spu_runtime
 	// All functions as PIC
 	std::map<std::basic_string_view<u32>, spu_function_t> m_pic_map;
 
+	// PIC map index keyed by the first two instructions (pointers to m_pic_map elements)
+	std::unordered_map<u64, std::vector<decltype(m_pic_map)::value_type*>, value_hash<u64>> m_pic_index;
+
+	// PIC map elements containing a single instruction
+	std::vector<decltype(m_pic_map)::value_type*> m_pic_short;
+
+	// Register new m_pic_map element in the index
+	void index_pic(decltype(m_pic_map)::value_type& entry);
+
 	// Debug module output location
 	std::string m_cache_path;
 
@@ -84,6 +140,9 @@ public:
 	// Return opaque pointer for add()
 	void* find(u64 last_reset_count, const std::vector<u32>&);
 
+	// Return opaque pointer for add() to replace already compiled function (tiered compilation)
+	void* find_compiled(u64 last_reset_count, const std::vector<u32>&);
+
 	// Find existing function
 	spu_function_t find(const u32* ls, u32 addr) const;
 
@@ -185,6 +244,51 @@ public:
 	};
 };
 
+// Opt-in SPU execution profiler (counts function entries and samples running SPU threads)
+class spu_profiler
+{
+	struct func_stat
+	{
+		// Function data (same format as spu_cache entry)
+		std::vector<u32> data;
+
+		// spu_cache::hash() value
+		u64 hash;
+
+		// Incremented by compiled code on every entry
+		atomic_t<u64> entries{0};
+
+		// Number of samples taken while executing this function
+		atomic_t<u64> samples{0};
+	};
+
+	shared_mutex m_mutex;
+
+	// All registered functions (element addresses are stable)
+	std::deque<func_stat> m_funcs;
+
+	// Hash to m_funcs index
+	std::unordered_map<u64, std::size_t, value_hash<u64>> m_map;
+
+	// Samples which couldn't be attributed to any compiled function
+	atomic_t<u64> m_unknown{0};
+
+	// Report location
+	std::string m_path;
+
+public:
+	spu_profiler();
+
+	// Register compiled function, return pointer to its entry counter
+	u64* add(const std::vector<u32>& func);
+
+	// Sampling thread entry point (the report is written on exit)
+	void operator()();
+
+	// Write report sorted by samples
+	void dump();
+};
+
 // SPU Recompiler instance base class
 class spu_recompiler_base
 {
@@ -326,6 +430,9 @@ protected:
 
 	std::shared_ptr<spu_cache> m_cache;
 
+	// Set when compiling a replacement for already compiled function (tiered compilation)
+	bool m_upgrade = false;
+
 private:
 	// For private use
 	std::bitset<0x10000> m_bits;
@@ -350,6 +457,12 @@ public:
 	// Compile function, handle failure
 	void make_function(const std::vector<u32>&);
 
+	// Compile replacement for already compiled function (may fail)
+	spu_function_t upgrade(u64 last_reset_count, const std::vector<u32>&);
+
+	// Queue function for background recompilation with LLVM (tiered compilation)
+	static void enqueue_upgrade(u64 last_reset_count, const std::vector<u32>&);
+
 	// Default dispatch function fallback (second arg is unused)
 	static void dispatch(spu_thread&, void*, u8* rip);
 
@@ -359,6 +472,18 @@ public:
 	// Get the function data at specified address
 	const std::vector<u32>& analyse(const be_t<u32>* ls, u32 lsa);
 
+	// Get analyser state for the function from the cache or by analysing it in the fake LS (returns false on mismatch)
+	bool analyse_cached(spu_cache* cache, std::vector<be_t<u32>>& ls, const std::vector<u32>& func);
+
+	// Serialize analyser state of the last analysed function
+	void save_analysis(std::vector<u8>& out) const;
+
+	// Restore analyser state, return false if the data doesn't match the function
+	bool load_analysis(const std::vector<u32>& func, const std::vector<u8>& data);
+
+	// Get the tag of compatible analyser state records (hash of the format version, the build and the state structure sizes)
+	static u32 analysis_key();
+
 	// Print analyser internal state
 	void dump(std::string& out);
 
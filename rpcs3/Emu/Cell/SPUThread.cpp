@@ -11,6 +11,7 @@
 #include "Emu/Cell/lv2/sys_event_flag.h"
 #include "Emu/Cell/lv2/sys_event.h"
 #include "Emu/Cell/lv2/sys_interrupt.h"
+#include "Emu/Cell/lv2/sys_time.h"
 
 #include "Emu/Cell/SPUDisAsm.h"
 #include "Emu/Cell/SPUThread.h"
@@ -23,14 +24,50 @@
 #include <atomic>
 #include <thread>
 
-// Verify AVX availability for TSX transactions
+// Verify AVX availability for TSX transactions and reservation line compare/copy
 static const bool s_tsx_avx = utils::has_avx();
 
 // For special case
 static const bool s_tsx_haswell = utils::has_rtm() && !utils::has_mpx();
 
+// AVX kernels are selected at runtime, enable the instruction set per function where the compiler needs it
+#if defined(_MSC_VER) || defined(__AVX__)
+#define AVX_FUNC
+#else
+#define AVX_FUNC __attribute__((__target__("avx")))
+#endif
+
+// Compare two 128-byte reservation lines using 256-bit registers
+static AVX_FUNC bool cmp_rdata_avx(const __m256i* lhs, const __m256i* rhs)
+{
+	const __m256 x0 = _mm256_xor_ps(_mm256_castsi256_ps(_mm256_loadu_si256(lhs + 0)), _mm256_castsi256_ps(_mm256_loadu_si256(rhs + 0)));
+	const __m256 x1 = _mm256_xor_ps(_mm256_castsi256_ps(_mm256_loadu_si256(lhs + 1)), _mm256_castsi256_ps(_mm256_loadu_si256(rhs + 1)));
+	const __m256 x2 = _mm256_xor_ps(_mm256_castsi256_ps(_mm256_loadu_si256(lhs + 2)), _mm256_castsi256_ps(_mm256_loadu_si256(rhs + 2)));
+	const __m256 x3 = _mm256_xor_ps(_mm256_castsi256_ps(_mm256_loadu_si256(lhs + 3)), _mm256_castsi256_ps(_mm256_loadu_si256(rhs + 3)));
+	const __m256i r = _mm256_castps_si256(_mm256_or_ps(_mm256_or_ps(x0, x1), _mm256_or_ps(x2, x3)));
+	return _mm256_testz_si256(r, r) != 0;
+}
+
+// Copy 128-byte reservation line using 256-bit registers
+static AVX_FUNC void mov_rdata_avx(__m256i* dst, const __m256i* src)
+{
+	const __m256i data0 = _mm256_loadu_si256(src + 0);
+	const __m256i data1 = _mm256_loadu_si256(src + 1);
+	const __m256i data2 = _mm256_loadu_si256(src + 2);
+	const __m256i data3 = _mm256_loadu_si256(src + 3);
+	_mm256_storeu_si256(dst + 0, data0);
+	_mm256_storeu_si256(dst + 1, data1);
+	_mm256_storeu_si256(dst + 2, data2);
+	_mm256_storeu_si256(dst + 3, data3);
+}
+
 static FORCE_INLINE bool cmp_rdata(const decltype(spu_thread::rdata)& lhs, const decltype(spu_thread::rdata)& rhs)
 {
+	if (s_tsx_avx)
+	{
+		return cmp_rdata_avx(reinterpret_cast<const __m256i*>(&lhs), reinterpret_cast<const __m256i*>(&rhs));
+	}
+
 	const v128 a = (lhs[0] ^ rhs[0]) | (lhs[1] ^ rhs[1]);
 	const v128 b = (lhs[2] ^ rhs[2]) | (lhs[3] ^ rhs[3]);
 	const v128 c = (lhs[4] ^ rhs[4]) | (lhs[5] ^ rhs[5]);
@@ -41,6 +78,11 @@ static FORCE_INLINE bool cmp_rdata(const decltype(spu_thread::rdata)& lhs, const
 
 static FORCE_INLINE void mov_rdata(decltype(spu_thread::rdata)& dst, const decltype(spu_thread::rdata)& src)
 {
+	if (s_tsx_avx)
+	{
+		return mov_rdata_avx(reinterpret_cast<__m256i*>(&dst), reinterpret_cast<const __m256i*>(&src));
+	}
+
 	{
 		const v128 data0 = src[0];
 		const v128 data1 = src[1];
@@ -113,52 +155,67 @@ namespace spu
 {
 	namespace scheduler
 	{
-		std::array<std::atomic<u8>, 65536> atomic_instruction_table = {};
+		std::array<atomic_t<u8>, 65536> atomic_instruction_table = {};
 		constexpr u32 native_jiffy_duration_us = 1500; //About 1ms resolution with a half offset
 
-		void acquire_pc_address(u32 pc, u32 timeout_ms = 3)
+		// Threads waiting for a free slot in atomic_instruction_table
+		shared_mutex g_slot_mutex;
+		cond_variable g_slot_cond;
+		atomic_t<u32> g_slot_waiters{0};
+
+		// Returns the time spent waiting (in microseconds)
+		u64 acquire_pc_address(u32 pc, u32 timeout_ms = 3)
 		{
 			const u8 max_concurrent_instructions = (u8)g_cfg.core.preferred_spu_threads;
-			const u32 pc_offset = pc >> 2;
+			auto& slot = atomic_instruction_table[pc >> 2];
 
-			if (atomic_instruction_table[pc_offset].load(std::memory_order_consume) >= max_concurrent_instructions)
+			if (LIKELY(slot.try_inc(max_concurrent_instructions)))
 			{
-				if (timeout_ms > 0)
-				{
-					const u64 timeout = timeout_ms * 1000u; //convert to microseconds
-					const u64 start = get_system_time();
-					auto remaining = timeout;
+				return 0;
+			}
 
-					while (atomic_instruction_table[pc_offset].load(std::memory_order_consume) >= max_concurrent_instructions)
-					{
-						if (remaining >= native_jiffy_duration_us)
-							std::this_thread::sleep_for(1ms);
-						else
-							std::this_thread::yield();
+			if (timeout_ms == 0)
+			{
+				// Slight pause if function is overburdened
+				busy_wait(slot.load() * 100ull);
+				slot++;
+				return 0;
+			}
 
-						const auto now = get_system_time();
-						const auto elapsed = now - start;
+			// Sleep until another thread releases the slot (or the penalty timeout expires)
+			const u64 timeout = timeout_ms * 1000u;
+			const u64 start = get_system_time();
 
-						if (elapsed > timeout) break;
-						remaining = timeout - elapsed;
-					}
-				}
-				else
+			std::lock_guard lock(g_slot_mutex);
+			g_slot_waiters++;
+
+			while (!slot.try_inc(max_concurrent_instructions))
+			{
+				const u64 elapsed = get_system_time() - start;
+
+				if (elapsed >= timeout)
 				{
-					//Slight pause if function is overburdened
-					const auto count = atomic_instruction_table[pc_offset].load(std::memory_order_consume) * 100ull;
-					busy_wait(count);
+					slot++;
+					break;
 				}
+
+				g_slot_cond.wait(g_slot_mutex, timeout - elapsed);
 			}
 
-			atomic_instruction_table[pc_offset]++;
+			g_slot_waiters--;
+			return get_system_time() - start;
 		}
 
 		void release_pc_address(u32 pc)
 		{
-			const u32 pc_offset = pc >> 2;
+			atomic_instruction_table[pc >> 2]--;
 
-			atomic_instruction_table[pc_offset]--;
+			if (g_slot_waiters)
+			{
+				// Wake waiters immediately instead of letting them poll
+				std::lock_guard lock(g_slot_mutex);
+				g_slot_cond.notify_all();
+			}
 		}
 
 		struct concurrent_execution_watchdog
@@ -171,7 +228,12 @@ namespace spu
 			{
 				if (g_cfg.core.preferred_spu_threads > 0)
 				{
-					acquire_pc_address(pc, (u32)g_cfg.core.spu_delay_penalty);
+					if (const u64 waited = acquire_pc_address(pc, (u32)g_cfg.core.spu_delay_penalty))
+					{
+						spu.sched_wait_count++;
+						spu.sched_wait_time += waited;
+					}
+
 					active = true;
 				}
 			}
@@ -985,6 +1047,7 @@ std::string spu_thread::dump() const
 	}
 
 	fmt::append(ret, "\nBlock Weight: %u (Retreats: %u)", block_counter, block_failure);
+	fmt::append(ret, "\nScheduler Waits: %u (%u us)", sched_wait_count, sched_wait_time);
 	fmt::append(ret, "\n[%s]", ch_mfc_cmd);
 	fmt::append(ret, "\nTag Mask: 0x%08x", ch_tag_mask);
 	fmt::append(ret, "\nMFC Stall: 0x%08x", ch_stall_mask);
@@ -1147,7 +1210,7 @@ void spu_thread::cpu_task()
 		}
 
 		// Print some stats
-		LOG_NOTICE(SPU, "Stats: Block Weight: %u (Retreats: %u);", block_counter, block_failure);
+		LOG_NOTICE(SPU, "Stats: Block Weight: %u (Retreats: %u); Scheduler Waits: %u (%u us);", block_counter, block_failure, sched_wait_count, sched_wait_time);
 		cpu_stop();
 		return;
 	}
@@ -1238,8 +1301,8 @@ spu_thread::spu_thread(vm::addr_t ls, lv2_spu_group* group, u32 index, std::stri
 	{
 		if (g_cfg.core.spu_block_size != spu_block_size_type::safe)
 		{
-			// Initialize stack mirror
-			std::memset(stack_mirror.data(), 0xff, sizeof(stack_mirror));
+			// Initialize shadow link stack
+			std::memset(ret_stack.data(), 0xff, sizeof(ret_stack));
 		}
 	}
 
@@ -1265,6 +1328,15 @@ void spu_thread::push_snr(u32 number, u32 value)
 	}
 }
 
+// Wake up SPUs waiting for a reservation lost event on the written lines
+static void spu_notify_put(u32 eal, u32 size)
+{
+	for (u64 addr = eal & -128; addr < u64{eal} + size; addr += 128)
+	{
+		vm::reservation_notifier(static_cast<u32>(addr), 128).notify_all();
+	}
+}
+
 void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 {
 	const bool is_get = (args.cmd & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK | MFC_START_MASK)) == MFC_GET_CMD;
@@ -1272,6 +1344,9 @@ void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 	u32 eal = args.eal;
 	u32 lsa = args.lsa & 0x3ffff;
 
+	// Set if the target is LS of another SPU thread in the same group (no reservation handling required)
+	bool ls_to_ls = false;
+
 	// SPU Thread Group MMIO (LS and SNR) and RawSPU MMIO
 	if (eal >= RAW_SPU_BASE_ADDR)
 	{
@@ -1317,6 +1392,7 @@ void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 			if (offset + args.size - 1 < 0x40000) // LS access
 			{
 				eal = spu.offset + offset; // redirect access
+				ls_to_ls = true;
 			}
 			else if (!is_get && args.size == 4 && (offset == SYS_SPU_THREAD_SNR1 || offset == SYS_SPU_THREAD_SNR2))
 			{
@@ -1334,10 +1410,12 @@ void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 		}
 	}
 
+	vm::heatmap_sample(eal, args.size);
+
 	u8* dst = (u8*)vm::base(eal);
 	u8* src = (u8*)vm::base(offset + lsa);
 
-	if (UNLIKELY(!is_get && !g_use_rtm))
+	if (UNLIKELY(!is_get && !g_use_rtm && !ls_to_ls))
 	{
 		switch (u32 size = args.size)
 		{
@@ -1414,6 +1492,7 @@ void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 		}
 		}
 
+		spu_notify_put(eal, args.size);
 		return;
 	}
 
@@ -1467,6 +1546,16 @@ void spu_thread::do_dma_transfer(const spu_mfc_cmd& args)
 		break;
 	}
 	}
+
+	if (ls_to_ls)
+	{
+		// Make LS-to-LS data visible to the target SPU before the command completes
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+	else if (!is_get)
+	{
+		spu_notify_put(eal, args.size);
+	}
 }
 
 bool spu_thread::do_dma_check(const spu_mfc_cmd& args)
@@ -1563,8 +1652,37 @@ bool spu_thread::do_list_transfer(spu_mfc_cmd& args)
 			transfer.cmd  = MFC(args.cmd & ~MFC_LIST_MASK);
 			transfer.size = size;
 
+			// Coalesce following elements which are contiguous both in LS and in main memory
+			if (!(item.sb & 0x8000) && (size & 0xf) == 0 && (addr & 0xf) == 0 && addr < RAW_SPU_BASE_ADDR)
+			{
+				while (args.size > 8)
+				{
+					const list_element next = _ref<list_element>((args.eal + 8) & 0x3fff8);
+					const u32 next_size = next.ts & 0x7fff;
+
+					if (!next_size || next_size & 0xf || next.ea != addr + transfer.size ||
+						u64{addr} + transfer.size + next_size > RAW_SPU_BASE_ADDR || args.lsa + transfer.size + next_size > 0x40000)
+					{
+						break;
+					}
+
+					LOG_TRACE(SPU, "LIST: addr=0x%x, size=0x%x, sb=0x%x (merged)", next.ea, next_size, next.sb);
+
+					item = next;
+					transfer.size += next_size;
+					args.eal += 8;
+					args.size -= 8;
+
+					if (item.sb & 0x8000)
+					{
+						// Stall after this element
+						break;
+					}
+				}
+			}
+
 			do_dma_transfer(transfer);
-			const u32 add_size = std::max<u32>(size, 16);
+			const u32 add_size = std::max<u32>(transfer.size, 16);
 			args.lsa += add_size;
 		}
 
@@ -1781,6 +1899,8 @@ bool spu_thread::process_mfc_cmd()
 		auto& dst = _ref<decltype(rdata)>(ch_mfc_cmd.lsa & 0x3ff80);
 		u64 ntime;
 
+		vm::heatmap_sample(addr, 128);
+
 		const bool is_polling = false; // TODO
 
 		if (is_polling)
@@ -1890,6 +2010,8 @@ bool spu_thread::process_mfc_cmd()
 		const u32 addr = ch_mfc_cmd.eal & -128u;
 		u32 result = 0;
 
+		vm::heatmap_sample(addr, 128);
+
 		if (raddr == addr)
 		{
 			const auto& to_write = _ref<decltype(rdata)>(ch_mfc_cmd.lsa & 0x3ff80);
@@ -2359,6 +2481,18 @@ s64 spu_thread::get_ch_value(u32 ch)
 
 		const u32 mask1 = ch_event_mask;
 
+		// Time until the decrementer event in microseconds (the only event nothing notifies)
+		const auto dec_timeout = [&]() -> u64
+		{
+			if (!(mask1 & SPU_EVENT_TM))
+			{
+				return -1;
+			}
+
+			const u32 left = ch_dec_value - static_cast<u32>(get_timebased_time() - ch_dec_start_timestamp);
+			return left >> 31 ? 0 : u64{left} * 1000000 / sys_time_get_timebase_frequency() + 1;
+		};
+
 		if (mask1 & SPU_EVENT_LR && raddr)
 		{
 			if (mask1 != SPU_EVENT_LR && mask1 != SPU_EVENT_LR + SPU_EVENT_TM)
@@ -2374,6 +2508,9 @@ s64 spu_thread::get_ch_value(u32 ch)
 				fmt::throw_exception("Unexpected: reservation notifier lock failed");
 			}
 
+			// Reservation writes by SPU DMA and atomic stores notify, but plain PPU stores don't, so keep polling with backoff
+			u64 poll = 100;
+
 			while (res = get_events(), !res)
 			{
 				state += cpu_flag::wait;
@@ -2383,7 +2520,8 @@ s64 spu_thread::get_ch_value(u32 ch)
 					return -1;
 				}
 
-				pseudo_lock.wait(100);
+				pseudo_lock.wait(std::min(poll, dec_timeout()));
+				poll = std::min<u64>(poll * 2, 1000);
 			}
 
 			check_state();
@@ -2399,7 +2537,15 @@ s64 spu_thread::get_ch_value(u32 ch)
 				return -1;
 			}
 
-			thread_ctrl::wait_for(100);
+			// Other events are raised by this thread or notified by set_events()
+			if (const u64 timeout = dec_timeout(); timeout != u64(-1))
+			{
+				thread_ctrl::wait_for(timeout);
+			}
+			else
+			{
+				thread_ctrl::wait();
+			}
 		}
 
 		check_state();
@@ -2892,9 +3038,10 @@ bool spu_thread::stop_and_signal(u32 code)
 
 			std::lock_guard qlock(queue->mutex);
 
-			if (queue->events.empty())
+			lv2_event event;
+
+			if (queue->add_waiter(this, event))
 			{
-				queue->sq.emplace_back(this);
 				group->run_state = SPU_THREAD_GROUP_STATUS_WAITING;
 
 				for (auto& thread : group->threads)
@@ -2911,12 +3058,10 @@ bool spu_thread::stop_and_signal(u32 code)
 			else
 			{
 				// Return the event immediately
-				const auto event = queue->events.front();
 				const auto data1 = static_cast<u32>(std::get<1>(event));
 				const auto data2 = static_cast<u32>(std::get<2>(event));
 				const auto data3 = static_cast<u32>(std::get<3>(event));
 				ch_in_mbox.set_values(4, CELL_OK, data1, data2, data3);
-				queue->events.pop_front();
 				check_state();
 				return true;
 			}
@@ -3008,17 +3153,17 @@ bool spu_thread::stop_and_signal(u32 code)
 
 		std::lock_guard qlock(queue->mutex);
 
-		if (queue->events.empty())
+		lv2_event event;
+
+		if (!queue->events.try_pop(event))
 		{
 			return ch_in_mbox.set_values(1, CELL_EBUSY), true;
 		}
 
-		const auto event = queue->events.front();
 		const auto data1 = static_cast<u32>(std::get<1>(event));
 		const auto data2 = static_cast<u32>(std::get<2>(event));
 		const auto data3 = static_cast<u32>(std::get<3>(event));
 		ch_in_mbox.set_values(4, CELL_OK, data1, data2, data3);
-		queue->events.pop_front();
 		return true;
 	}
 
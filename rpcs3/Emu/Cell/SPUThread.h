@@ -578,11 +578,16 @@ public:
 	u64 block_recover = 0;
 	u64 block_failure = 0;
 
+	u64 sched_wait_count = 0; // Number of times the thread was delayed by the atomic instruction scheduler
+	u64 sched_wait_time = 0; // Total delay in microseconds
+
 	u64 saved_native_sp = 0; // Host thread's stack pointer for emulated longjmp
 
 	u8* memory_base_addr = vm::g_base_addr;
 
-	std::array<v128, 0x4000> stack_mirror; // Return address information
+	// Shadow link stack of recompiled calls: native continuation (u64), SPU return address (u32), its function base (u32)
+	std::array<v128, 32> ret_stack;
+	u32 ret_stack_pos = 0; // Byte offset of the top entry
 
 	void push_snr(u32 number, u32 value);
 	void do_dma_transfer(const spu_mfc_cmd& args);
@@ -621,6 +626,16 @@ public:
 	bool read_reg(const u32 addr, u32& value);
 	bool write_reg(const u32 addr, const u32 value);
 
+	// Check whether the address belongs to a Raw SPU problem state area
+	static constexpr bool is_raw_spu_reg(u32 addr)
+	{
+		return addr - RAW_SPU_BASE_ADDR < (6 * RAW_SPU_OFFSET) && (addr % RAW_SPU_OFFSET) >= RAW_SPU_PROB_OFFSET;
+	}
+
+	// Access a Raw SPU register without the access violation handler (returns false if the Raw SPU or the register doesn't exist)
+	static bool read_raw_reg(u32 addr, u32& value);
+	static bool write_raw_reg(u32 addr, u32 value);
+
 	static atomic_t<u32> g_raw_spu_ctr;
 	static atomic_t<u32> g_raw_spu_id[5];
 
@@ -1,5 +1,7 @@
 ﻿#include "stdafx.h"
 #include "Emu/System.h"
+#include "Utilities/timeline.h"
+#include "Utilities/asm.h"
 
 #include "Emu/Cell/PPUFunction.h"
 #include "Emu/Cell/ErrorCodes.h"
@@ -971,13 +973,32 @@ extern void ppu_initialize_syscalls()
 	g_ppu_syscall_table = s_ppu_syscall_table;
 }
 
+// Number of times the thread was put to sleep, tells blocking syscalls apart on the timeline
+thread_local u64 g_tls_sleep_count = 0;
+
 extern void ppu_execute_syscall(ppu_thread& ppu, u64 code)
 {
 	if (code < g_ppu_syscall_table.size())
 	{
 		if (auto func = g_ppu_syscall_table[code])
 		{
-			func(ppu);
+			if (UNLIKELY(timeline::g_enabled))
+			{
+				const u64 sleep_count = g_tls_sleep_count;
+				const u64 start = timeline::now();
+
+				func(ppu);
+
+				if (g_tls_sleep_count != sleep_count)
+				{
+					timeline::record_event("lv2", "Blocking syscall", start, timeline::now(), code);
+				}
+			}
+			else
+			{
+				func(ppu);
+			}
+
 			LOG_TRACE(PPU, "Syscall '%s' (%llu) finished, r3=0x%llx", ppu_syscall_code(code), code, ppu.gpr[3]);
 			return;
 		}
@@ -1001,7 +1022,115 @@ extern u64 get_system_time();
 DECLARE(lv2_obj::g_mutex);
 DECLARE(lv2_obj::g_ppu);
 DECLARE(lv2_obj::g_pending);
-DECLARE(lv2_obj::g_waiting);
+
+u32 lv2_obj::ppu_run_queue::next_level(u32 from) const
+{
+	if (from >= levels)
+	{
+		return levels;
+	}
+
+	u32 word = from / 64;
+
+	if (const u64 bits = bitmap[word] & (~0ull << (from % 64)))
+	{
+		return word * 64 + static_cast<u32>(utils::cnttz64(bits, true));
+	}
+
+	// Find the next non-empty bitmap word
+	const u64 words = word + 1 < 64 ? summary & (~0ull << (word + 1)) : 0;
+
+	if (!words)
+	{
+		return levels;
+	}
+
+	word = static_cast<u32>(utils::cnttz64(words, true));
+	return word * 64 + static_cast<u32>(utils::cnttz64(bitmap[word], true));
+}
+
+std::size_t lv2_obj::ppu_run_queue::push(ppu_thread* thread, u32 prio)
+{
+	const u32 lv = level(prio);
+
+	queues[lv].emplace_back(thread);
+	bitmap[lv / 64] |= 1ull << (lv % 64);
+	summary |= 1ull << (lv / 64);
+	count++;
+
+	return index_of(thread, prio);
+}
+
+bool lv2_obj::ppu_run_queue::remove(ppu_thread* thread, u32 prio)
+{
+	const u32 lv = level(prio);
+	auto& queue = queues[lv];
+
+	const auto found = std::find(queue.begin(), queue.end(), thread);
+
+	if (found == queue.end())
+	{
+		return false;
+	}
+
+	queue.erase(found);
+	count--;
+
+	if (queue.empty() && !(bitmap[lv / 64] &= ~(1ull << (lv % 64))))
+	{
+		summary &= ~(1ull << (lv / 64));
+	}
+
+	return true;
+}
+
+bool lv2_obj::ppu_run_queue::contains(ppu_thread* thread, u32 prio) const
+{
+	const auto& queue = queues[level(prio)];
+	return std::find(queue.begin(), queue.end(), thread) != queue.end();
+}
+
+std::size_t lv2_obj::ppu_run_queue::index_of(ppu_thread* thread, u32 prio) const
+{
+	const u32 lv = level(prio);
+
+	std::size_t index = 0;
+
+	for (u32 i = next_level(0); i < lv; i = next_level(i + 1))
+	{
+		index += queues[i].size();
+	}
+
+	const auto& queue = queues[lv];
+	return index + (std::find(queue.begin(), queue.end(), thread) - queue.begin());
+}
+
+ppu_thread* lv2_obj::ppu_run_queue::at(std::size_t index) const
+{
+	for (u32 lv = next_level(0);; lv = next_level(lv + 1))
+	{
+		verify(HERE), lv < levels;
+
+		if (index < queues[lv].size())
+		{
+			return queues[lv][index];
+		}
+
+		index -= queues[lv].size();
+	}
+}
+
+void lv2_obj::ppu_run_queue::clear()
+{
+	for (u32 lv = next_level(0); lv < levels; lv = next_level(lv + 1))
+	{
+		queues[lv].clear();
+	}
+
+	bitmap.fill(0);
+	summary = 0;
+	count = 0;
+}
 
 void lv2_obj::sleep_timeout(cpu_thread& thread, u64 timeout)
 {
@@ -1030,8 +1159,10 @@ void lv2_obj::sleep_timeout(cpu_thread& thread, u64 timeout)
 			return;
 		}
 
+		g_tls_sleep_count++;
+
 		// Find and remove the thread
-		unqueue(g_ppu, ppu);
+		g_ppu.remove(ppu, ppu->prio);
 		unqueue(g_pending, ppu);
 
 		ppu->start_time = start_time;
@@ -1039,19 +1170,13 @@ void lv2_obj::sleep_timeout(cpu_thread& thread, u64 timeout)
 
 	if (timeout)
 	{
-		const u64 wait_until = start_time + timeout;
-
-		// Register timeout if necessary
-		for (auto it = g_waiting.begin(), end = g_waiting.end(); it != end; it++)
-		{
-			if (it->first > wait_until)
-			{
-				g_waiting.emplace(it, wait_until, &thread);
-				return;
-			}
-		}
-
-		g_waiting.emplace_back(wait_until, &thread);
+		// Register timeout
+		lv2_timer_wheel::add_timeout(thread, start_time + timeout);
+	}
+	else
+	{
+		// Drop a stale one (an exiting thread sleeps without timeout for the last time)
+		lv2_timer_wheel::remove(&thread);
 	}
 
 	schedule_all();
@@ -1062,67 +1187,57 @@ void lv2_obj::awake(cpu_thread& cpu, u32 prio)
 	// Check thread type
 	if (cpu.id_type() != 1) return;
 
+	auto& ppu = static_cast<ppu_thread&>(cpu);
+
 	std::lock_guard lock(g_mutex);
 
 	if (prio < INT32_MAX)
 	{
-        // Priority set
-        if (static_cast<ppu_thread&>(cpu).prio.exchange(prio) == prio || !unqueue(g_ppu, &cpu))
-        {
-            return;
-        }
+		// Priority set
+		const u32 old_prio = ppu.prio.exchange(prio);
+
+		if (old_prio == prio || !g_ppu.remove(&ppu, old_prio))
+		{
+			return;
+		}
 	}
 	else if (prio == -4)
 	{
 		// Yield command
 		const u64 start_time = get_system_time();
 
-		for (std::size_t i = 0, pos = -1; i < g_ppu.size(); i++)
+		const u32 lv = g_ppu.level(ppu.prio);
+		const auto& queue = g_ppu.queues[lv];
+
+		if (!queue.empty() && queue.back() == &ppu && g_ppu.next_level(lv + 1) < g_ppu.levels)
 		{
-			if (g_ppu[i] == &cpu)
-			{
-				pos = i;
-				prio = g_ppu[i]->prio;
-			}
-			else if (i == pos + 1 && prio != -4 && g_ppu[i]->prio != prio)
-			{
-				return;
-			}
+			// Nothing to yield to: the next thread has a lower priority
+			return;
 		}
 
-		unqueue(g_ppu, &cpu);
+		g_ppu.remove(&ppu, ppu.prio);
 		unqueue(g_pending, &cpu);
 
-		static_cast<ppu_thread&>(cpu).start_time = start_time;
+		ppu.start_time = start_time;
 	}
 
 	// Emplace current thread
-	for (std::size_t i = 0; i <= g_ppu.size(); i++)
-	{
-		if (i < g_ppu.size() && g_ppu[i] == &cpu)
-		{
-			LOG_TRACE(PPU, "sleep() - suspended (p=%zu)", g_pending.size());
-			break;
-		}
+	bool pushed = false;
+	std::size_t pos = 0;
 
+	if (g_ppu.contains(&ppu, ppu.prio))
+	{
+		LOG_TRACE(PPU, "sleep() - suspended (p=%zu)", g_pending.size());
+	}
+	else
+	{
 		// Use priority, also preserve FIFO order
-		if (i == g_ppu.size() || g_ppu[i]->prio > static_cast<ppu_thread&>(cpu).prio)
-		{
-			LOG_TRACE(PPU, "awake(): %s", cpu.id);
-			g_ppu.insert(g_ppu.cbegin() + i, &static_cast<ppu_thread&>(cpu));
-
-			// Unregister timeout if necessary
-			for (auto it = g_waiting.cbegin(), end = g_waiting.cend(); it != end; it++)
-			{
-				if (it->second == &cpu)
-				{
-					g_waiting.erase(it);
-					break;
-				}
-			}
+		LOG_TRACE(PPU, "awake(): %s", cpu.id);
+		pos = g_ppu.push(&ppu, ppu.prio);
+		pushed = true;
 
-			break;
-		}
+		// Unregister timeout if necessary
+		lv2_timer_wheel::remove(&cpu);
 	}
 
 	// Remove pending if necessary
@@ -1131,10 +1246,12 @@ void lv2_obj::awake(cpu_thread& cpu, u32 prio)
 		unqueue(g_pending, &cpu);
 	}
 
-	// Suspend threads if necessary
-	for (std::size_t i = g_cfg.core.ppu_threads; i < g_ppu.size(); i++)
+	// Suspend the thread pushed out of the first ppu_threads positions, threads past it are suspended already
+	const std::size_t max_running = g_cfg.core.ppu_threads;
+
+	if (pushed && g_ppu.count > max_running)
 	{
-		const auto target = g_ppu[i];
+		const auto target = pos >= max_running ? &ppu : g_ppu.at(max_running);
 
 		if (!target->state.test_and_set(cpu_flag::suspend))
 		{
@@ -1150,7 +1267,8 @@ void lv2_obj::cleanup()
 {
 	g_ppu.clear();
 	g_pending.clear();
-	g_waiting.clear();
+	lv2_timer_wheel::clear();
+	lv2_memory_owners::clear();
 }
 
 void lv2_obj::schedule_all()
@@ -1158,9 +1276,14 @@ void lv2_obj::schedule_all()
 	if (g_pending.empty())
 	{
 		// Wake up threads
-		for (std::size_t i = 0, x = std::min<std::size_t>(g_cfg.core.ppu_threads, g_ppu.size()); i < x; i++)
+		std::size_t left = g_cfg.core.ppu_threads;
+
+		g_ppu.for_each([&](ppu_thread* target)
 		{
-			const auto target = g_ppu[i];
+			if (!left--)
+			{
+				return false;
+			}
 
 			if (target->state & cpu_flag::suspend)
 			{
@@ -1173,23 +1296,8 @@ void lv2_obj::schedule_all()
 					target->notify();
 				}
 			}
-		}
-	}
 
-	// Check registered timeouts
-	while (!g_waiting.empty())
-	{
-		auto& pair = g_waiting.front();
-
-		if (pair.first <= get_system_time())
-		{
-			pair.second->notify();
-			g_waiting.pop_front();
-		}
-		else
-		{
-			// The list is sorted so assume no more timeouts
-			break;
-		}
+			return true;
+		});
 	}
 }
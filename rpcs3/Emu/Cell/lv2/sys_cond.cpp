@@ -3,6 +3,7 @@
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
 #include "Emu/IPC.h"
+#include "Utilities/lock_profiler.h"
 
 #include "Emu/Cell/ErrorCodes.h"
 #include "Emu/Cell/PPUThread.h"
@@ -295,6 +296,11 @@ error_code sys_cond_wait(ppu_thread& ppu, u32 cond_id, u64 timeout)
 		}
 	}
 
+	if (UNLIKELY(lock_profiler::g_enabled))
+	{
+		lock_profiler::record_object("sys_cond", cond_id, cond->name, (get_system_time() - ppu.start_time) * 1000);
+	}
+
 	// Verify ownership
 	verify(HERE), cond->mutex->owner >> 1 == ppu.id;
 
@@ -31,20 +31,88 @@ std::shared_ptr<lv2_event_queue> lv2_event_queue::find(u64 ipc_key)
 
 bool lv2_event_queue::send(lv2_event event)
 {
+	if (!waiters)
+	{
+		// Fast path: nobody waits, store the event without locking
+		if (events.try_push(event, this->size))
+		{
+			if (LIKELY(!waiters))
+			{
+				return true;
+			}
+
+			// A receiver registered meanwhile and may have missed the event
+			std::lock_guard lock(mutex);
+
+			while (!sq.empty() && events.try_pop(event))
+			{
+				deliver(event);
+			}
+
+			return true;
+		}
+
+		if (!waiters)
+		{
+			return false;
+		}
+	}
+
 	std::lock_guard lock(mutex);
 
 	if (sq.empty())
 	{
-		if (events.size() < this->size)
+		// Save event
+		return events.try_push(event, this->size);
+	}
+
+	// Keep the order with the events stored by the fast path
+	lv2_event old;
+
+	while (events.try_pop(old))
+	{
+		deliver(old);
+
+		if (sq.empty())
 		{
-			// Save event
-			events.emplace_back(event);
-			return true;
+			return events.try_push(event, this->size);
 		}
+	}
 
+	deliver(event);
+	return true;
+}
+
+bool lv2_event_queue::add_waiter(cpu_thread* cpu, lv2_event& event)
+{
+	if (events.try_pop(event))
+	{
+		return false;
+	}
+
+	sq.emplace_back(cpu);
+	waiters = ::size32(sq);
+
+	// Check again, senders which didn't see the waiter have finished pushing or will deliver it themselves
+	if (events.try_pop(event))
+	{
+		sq.pop_back();
+		waiters = ::size32(sq);
 		return false;
 	}
 
+	return true;
+}
+
+bool lv2_event_queue::remove_waiter(cpu_thread* cpu)
+{
+	const bool result = unqueue(sq, cpu);
+	waiters = ::size32(sq);
+	return result;
+}
+
+void lv2_event_queue::deliver(const lv2_event& event)
+{
 	if (type == SYS_PPU_QUEUE)
 	{
 		// Store event in registers
@@ -71,7 +139,7 @@ bool lv2_event_queue::send(lv2_event event)
 		spu.notify();
 	}
 
-	return true;
+	waiters = ::size32(sq);
 }
 
 error_code sys_event_queue_create(vm::ptr<u32> equeue_id, vm::ptr<sys_event_queue_attribute_t> attr, u64 event_queue_key, s32 size)
@@ -209,12 +277,11 @@ error_code sys_event_queue_tryreceive(u32 equeue_id, vm::ptr<sys_event_t> event_
 	std::lock_guard lock(queue->mutex);
 
 	s32 count = 0;
+	lv2_event event;
 
-	while (queue->sq.empty() && count < size && !queue->events.empty())
+	while (queue->sq.empty() && count < size && queue->events.try_pop(event))
 	{
 		auto& dest = event_array[count++];
-		auto event = queue->events.front();
-		queue->events.pop_front();
 
 		std::tie(dest.source, dest.data1, dest.data2, dest.data3) = event;
 	}
@@ -239,15 +306,15 @@ error_code sys_event_queue_receive(ppu_thread& ppu, u32 equeue_id, vm::ptr<sys_e
 
 		std::lock_guard lock(queue.mutex);
 
-		if (queue.events.empty())
+		lv2_event event;
+
+		if (queue.add_waiter(&ppu, event))
 		{
-			queue.sq.emplace_back(&ppu);
 			queue.sleep(ppu, timeout);
 			return CELL_EBUSY;
 		}
 
-		std::tie(ppu.gpr[4], ppu.gpr[5], ppu.gpr[6], ppu.gpr[7]) = queue.events.front();
-		queue.events.pop_front();
+		std::tie(ppu.gpr[4], ppu.gpr[5], ppu.gpr[6], ppu.gpr[7]) = event;
 		return {};
 	});
 
@@ -284,7 +351,7 @@ error_code sys_event_queue_receive(ppu_thread& ppu, u32 equeue_id, vm::ptr<sys_e
 			{
 				std::lock_guard lock(queue->mutex);
 
-				if (!queue->unqueue(queue->sq, &ppu))
+				if (!queue->remove_waiter(&ppu))
 				{
 					timeout = 0;
 					continue;
@@ -313,7 +380,11 @@ error_code sys_event_queue_drain(u32 equeue_id)
 	{
 		std::lock_guard lock(queue.mutex);
 
-		queue.events.clear();
+		lv2_event event;
+
+		while (queue.events.try_pop(event))
+		{
+		}
 	});
 
 	if (!queue)
@@ -2,6 +2,8 @@
 
 #include "sys_sync.h"
 
+#include "Utilities/lockless.h"
+
 class cpu_thread;
 
 // Event Queue Type
@@ -84,8 +86,9 @@ struct lv2_event_queue final : public lv2_obj
 	const s32 size;
 
 	shared_mutex mutex;
-	std::deque<lv2_event> events;
+	lf_mpsc_ring<lv2_event, 128> events; // Pushed without the mutex, popped only with it
 	std::deque<cpu_thread*> sq;
+	atomic_t<u32> waiters{0}; // Mirror of sq.size() for senders which don't take the mutex
 
 	lv2_event_queue(u32 protocol, s32 type, u64 name, u64 ipc_key, s32 size)
 		: protocol(protocol)
@@ -98,6 +101,14 @@ struct lv2_event_queue final : public lv2_obj
 
 	bool send(lv2_event);
 
+	// Register the receiver (mutex must be locked), returns false and the event if one arrived meanwhile
+	bool add_waiter(cpu_thread* cpu, lv2_event& event);
+
+	bool remove_waiter(cpu_thread* cpu);
+
+	// Give the event to the receiver to pick (mutex must be locked, sq must not be empty)
+	void deliver(const lv2_event& event);
+
 	bool send(u64 source, u64 d1, u64 d2, u64 d3)
 	{
 		return send(std::make_tuple(source, d1, d2, d3));
@@ -10,6 +10,10 @@
 #include "Emu/IdManager.h"
 #include "Utilities/StrUtil.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 LOG_CHANNEL(sys_fs);
 
 struct lv2_fs_mount_point
@@ -57,6 +61,8 @@ bool verify_mself(u32 fd, fs::file const& mself_file)
 	return true;
 }
 
+atomic_t<u64> lv2_file::g_modified{0};
+
 lv2_fs_mount_point* lv2_fs_object::get_mp(const char* filename)
 {
 	// TODO
@@ -65,19 +71,159 @@ lv2_fs_mount_point* lv2_fs_object::get_mp(const char* filename)
 
 u64 lv2_file::op_read(vm::ptr<void> buf, u64 size)
 {
+	if (flags & CELL_FS_O_ACCMODE)
+	{
+		// The file may change under the cache
+		return op_read_uncached(buf, size);
+	}
+
+	const u64 pos = file.pos();
+	const u64 stamp = g_modified.load();
+
+	if (ra_stamp != stamp)
+	{
+		// The file may have been written through another descriptor or truncated
+		ra_size = 0;
+	}
+
+	// Grow the read-ahead window while the access stays sequential
+	ra_window = pos != ra_next ? 0 : ra_window ? std::min(ra_window * 2, ra_max) : ra_min;
+
+	u64 result = 0;
+
+	if (pos >= ra_pos && pos < ra_pos + ra_size)
+	{
+		result = std::min(size, ra_pos + ra_size - pos);
+		std::memcpy(buf.get_ptr(), ra_buf.get() + (pos - ra_pos), result);
+	}
+
+	if (const u64 rest = size - result)
+	{
+		const auto dst = vm::ptr<void>::make(buf.addr() + static_cast<u32>(result));
+
+		if (result)
+		{
+			file.seek(pos + result);
+		}
+
+		if (ra_window && rest < ra_window)
+		{
+			if (!ra_buf)
+			{
+				ra_buf.reset(new u8[ra_max]);
+			}
+
+			ra_pos = pos + result;
+			ra_stamp = stamp;
+			ra_size = file.read(ra_buf.get(), std::min(rest + ra_window, ra_max));
+
+			const u64 count = std::min(rest, ra_size);
+			std::memcpy(dst.get_ptr(), ra_buf.get(), count);
+			result += count;
+		}
+		else
+		{
+			result += op_read_uncached(dst, rest);
+		}
+	}
+
+	file.seek(pos + result);
+	ra_next = pos + result;
+	return result;
+}
+
+u64 lv2_file::op_read_uncached(vm::ptr<void> buf, u64 size)
+{
+	u64 result = 0;
+
+#ifndef _WIN32
+	if (const int fd = file.get_handle(); fd != -1 && size >= direct_min && !(buf.addr() & 0xfff) && vm::check_addr(buf.addr(), static_cast<u32>(size), vm::page_writable))
+	{
+		// Large aligned read straight into guest memory, EFAULT on pages protected by the host falls back to the copy
+		const auto r = ::read(fd, buf.get_ptr(), size);
+
+		if (r == 0)
+		{
+			return 0;
+		}
+
+		verify("lv2_file::op_read_uncached" HERE), r > 0 || errno == EFAULT;
+
+		if (r > 0 && (result = r) == size)
+		{
+			return result;
+		}
+	}
+#endif
+
 	// Copy data from intermediate buffer (avoid passing vm pointer to a native API)
+	std::unique_ptr<u8[]> local_buf(new u8[size - result]);
+	const u64 count = file.read(local_buf.get(), size - result);
+	std::memcpy(static_cast<u8*>(buf.get_ptr()) + result, local_buf.get(), count);
+	return result + count;
+}
+
+u64 lv2_file::op_write(vm::cptr<void> buf, u64 size)
+{
+	// Copy data to intermediate buffer (avoid passing vm pointer to a native API)
 	std::unique_ptr<u8[]> local_buf(new u8[size]);
-	const u64 result = file.read(local_buf.get(), size);
+	std::memcpy(local_buf.get(), buf.get_ptr(), size);
+	const u64 result = file.write(local_buf.get(), size);
+	g_modified++;
+	return result;
+}
+
+u64 lv2_file::op_read_at(u64 pos, vm::ptr<void> buf, u64 size)
+{
+	std::unique_ptr<u8[]> local_buf(new u8[size]);
+	u64 result = 0;
+
+#ifndef _WIN32
+	if (const int fd = file.get_handle(); fd != -1)
+	{
+		// Concurrent reads of the same file don't need the mount point lock
+		const auto r = ::pread(fd, local_buf.get(), size, pos);
+		verify("lv2_file::op_read_at" HERE), r != -1;
+		result = r;
+	}
+	else
+#endif
+	{
+		std::lock_guard lock(mp->mutex);
+
+		const u64 old_pos = file.pos();
+		file.seek(pos);
+		result = file.read(local_buf.get(), size);
+		file.seek(old_pos);
+	}
+
 	std::memcpy(buf.get_ptr(), local_buf.get(), result);
 	return result;
 }
 
-u64 lv2_file::op_write(vm::cptr<void> buf, u64 size)
+u64 lv2_file::op_write_at(u64 pos, vm::cptr<void> buf, u64 size)
 {
-	// Copy data to intermediate buffer (avoid passing vm pointer to a native API)
 	std::unique_ptr<u8[]> local_buf(new u8[size]);
 	std::memcpy(local_buf.get(), buf.get_ptr(), size);
-	return file.write(local_buf.get(), size);
+
+#ifndef _WIN32
+	if (const int fd = file.get_handle(); fd != -1)
+	{
+		const auto r = ::pwrite(fd, local_buf.get(), size, pos);
+		verify("lv2_file::op_write_at" HERE), r != -1;
+		g_modified++;
+		return r;
+	}
+#endif
+
+	std::lock_guard lock(mp->mutex);
+
+	const u64 old_pos = file.pos();
+	file.seek(pos);
+	const u64 result = file.write(local_buf.get(), size);
+	file.seek(old_pos);
+	g_modified++;
+	return result;
 }
 
 struct lv2_file::file_view : fs::file_base
@@ -321,6 +467,11 @@ error_code sys_fs_open(ppu_thread& ppu, vm::cptr<char> path, s32 flags, vm::ptr<
 		return {CELL_EIO, path};
 	}
 
+	if (open_mode & fs::trunc)
+	{
+		lv2_file::g_modified++;
+	}
+
 	if ((flags & CELL_FS_O_MSELF) && (!verify_mself(*fd, file)))
 	{
 		return {CELL_ENOTMSELF, path};
@@ -1429,6 +1580,7 @@ error_code sys_fs_truncate(ppu_thread& ppu, vm::cptr<char> path, u64 size)
 		return {CELL_EIO, path}; // ???
 	}
 
+	lv2_file::g_modified++;
 	return CELL_OK;
 }
 
@@ -1472,6 +1624,7 @@ error_code sys_fs_ftruncate(ppu_thread& ppu, u32 fd, u64 size)
 		return CELL_EIO; // ???
 	}
 
+	lv2_file::g_modified++;
 	return CELL_OK;
 }
 
@@ -170,6 +170,23 @@ struct lv2_file final : lv2_fs_object
 	// Stream lock
 	atomic_t<u32> lock{0};
 
+	// Read-ahead cache of read-only files, protected by the mount point mutex like the file position
+	static constexpr u64 ra_min = 0x10000;
+	static constexpr u64 ra_max = 0x100000;
+
+	// Reads of at least this size go straight into guest memory when possible
+	static constexpr u64 direct_min = 0x40000;
+
+	std::unique_ptr<u8[]> ra_buf;
+	u64 ra_pos = 0; // File offset of ra_buf
+	u64 ra_size = 0; // Amount of valid data in ra_buf
+	u64 ra_window = 0; // Current read-ahead size, grows with sequential reads
+	u64 ra_next = -1; // Where the next read starts if the access is sequential
+	u64 ra_stamp = 0; // Value of g_modified when ra_buf was filled
+
+	// Incremented after every write or truncation of any file, discards all read-ahead caches
+	static atomic_t<u64> g_modified;
+
 	lv2_file(const char* filename, fs::file&& file, s32 mode, s32 flags)
 		: lv2_fs_object(lv2_fs_object::get_mp(filename), filename)
 		, file(std::move(file))
@@ -186,12 +203,21 @@ struct lv2_file final : lv2_fs_object
 	{
 	}
 
-	// File reading with intermediate buffer
+	// File reading with intermediate buffer, sequential reads of read-only files are served from the read-ahead cache
 	u64 op_read(vm::ptr<void> buf, u64 size);
 
+	// Read from the current position without caching
+	u64 op_read_uncached(vm::ptr<void> buf, u64 size);
+
 	// File writing with intermediate buffer
 	u64 op_write(vm::cptr<void> buf, u64 size);
 
+	// Positional reading, doesn't touch the file position (pread for native files, locked seek otherwise)
+	u64 op_read_at(u64 pos, vm::ptr<void> buf, u64 size);
+
+	// Positional writing, doesn't touch the file position
+	u64 op_write_at(u64 pos, vm::cptr<void> buf, u64 size);
+
 	// For MSELF support
 	struct file_view;
 
@@ -2,6 +2,7 @@
 #include "Emu/Memory/vm.h"
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
+#include "Utilities/lock_profiler.h"
 
 #include "Emu/Cell/ErrorCodes.h"
 #include "Emu/Cell/PPUThread.h"
@@ -154,6 +155,11 @@ error_code _sys_lwmutex_lock(ppu_thread& ppu, u32 lwmutex_id, u64 timeout)
 		}
 	}
 
+	if (UNLIKELY(lock_profiler::g_enabled))
+	{
+		lock_profiler::record_object("sys_lwmutex", lwmutex_id, mutex->name, (get_system_time() - ppu.start_time) * 1000);
+	}
+
 	return not_an_error(ppu.gpr[3]);
 }
 
@@ -5,13 +5,31 @@
 
 LOG_CHANNEL(sys_memory);
 
-lv2_memory_alloca::lv2_memory_alloca(u32 size, u32 align, u64 flags, const std::shared_ptr<lv2_memory_container>& ct)
-	: size(size)
-	, align(align)
-	, flags(flags)
-	, ct(ct)
-	, shm(std::make_shared<utils::shm>(size))
+namespace
 {
+	// Containers can't be destroyed while used, so the pointers stay valid while their allocation lives
+	std::array<atomic_t<lv2_memory_container*>, 0x10000> g_mem_owners{};
+
+	// Makes an allocation and its owner record change together, so frees racing on one address see a consistent state
+	shared_mutex g_mem_owners_mutex;
+}
+
+void lv2_memory_owners::set(u32 addr, lv2_memory_container* ct)
+{
+	g_mem_owners[addr >> 16] = ct;
+}
+
+lv2_memory_container* lv2_memory_owners::claim(u32 addr)
+{
+	return g_mem_owners[addr >> 16].exchange(nullptr);
+}
+
+void lv2_memory_owners::clear()
+{
+	for (auto& owner : g_mem_owners)
+	{
+		owner.release(nullptr);
+	}
 }
 
 // Todo: fix order of error checks
@@ -49,8 +67,14 @@ error_code sys_memory_allocate(u32 size, u64 flags, vm::ptr<u32> alloc_addr)
 
 	if (const auto area = vm::get(align == 0x10000 ? vm::user64k : vm::user1m, 0, ::align(size, 0x10000000)))
 	{
+		std::unique_lock lock(g_mem_owners_mutex);
+
 		if (u32 addr = area->alloc(size, align))
 		{
+			lv2_memory_owners::set(addr, dct.get());
+
+			lock.unlock();
+
 			if (alloc_addr)
 			{
 				*alloc_addr = addr;
@@ -110,13 +134,16 @@ error_code sys_memory_allocate_from_container(u32 size, u32 cid, u64 flags, vm::
 		return ct.ret;
 	}
 
-	// Create phantom memory object
-	const auto mem = idm::make_ptr<lv2_memory_alloca>(size, align, flags, ct.ptr);
-
 	if (const auto area = vm::get(align == 0x10000 ? vm::user64k : vm::user1m, 0, ::align(size, 0x10000000)))
 	{
-		if (u32 addr = area->alloc(size, mem->align, &mem->shm))
+		std::unique_lock lock(g_mem_owners_mutex);
+
+		if (u32 addr = area->alloc(size, align))
 		{
+			lv2_memory_owners::set(addr, ct.ptr.get());
+
+			lock.unlock();
+
 			if (alloc_addr)
 			{
 				*alloc_addr = addr;
@@ -129,7 +156,6 @@ error_code sys_memory_allocate_from_container(u32 size, u32 cid, u64 flags, vm::
 		}
 	}
 
-	idm::remove<lv2_memory_alloca>(idm::last_id());
 	ct->used -= size;
 	return CELL_ENOMEM;
 }
@@ -147,6 +173,8 @@ error_code sys_memory_free(u32 addr)
 		return {CELL_EINVAL, addr};
 	}
 
+	std::lock_guard lock(g_mem_owners_mutex);
+
 	const auto shm = area->get(addr);
 
 	if (!shm.second)
@@ -154,18 +182,9 @@ error_code sys_memory_free(u32 addr)
 		return {CELL_EINVAL, addr};
 	}
 
-	// Retrieve phantom memory object
-	const auto mem = idm::select<lv2_memory_alloca>([&](u32 id, lv2_memory_alloca& mem) -> u32
-	{
-		if (mem.shm.get() == shm.second.get())
-		{
-			return id;
-		}
+	const auto ct = lv2_memory_owners::claim(addr);
 
-		return 0;
-	});
-
-	if (!mem)
+	if (!ct)
 	{
 		// Deallocate memory (simple)
 		if (!area->dealloc(addr))
@@ -182,14 +201,12 @@ error_code sys_memory_free(u32 addr)
 	// Deallocate memory
 	if (!area->dealloc(addr, &shm.second))
 	{
+		lv2_memory_owners::set(addr, ct);
 		return {CELL_EINVAL, addr};
 	}
 
 	// Return "physical memory"
-	mem->ct->used -= mem->size;
-
-	// Remove phantom memory object
-	verify(HERE), idm::remove<lv2_memory_alloca>(mem.ret);
+	ct->used -= shm.second->size();
 
 	return CELL_OK;
 }
@@ -76,19 +76,16 @@ struct lv2_memory_container
 	}
 };
 
-struct lv2_memory_alloca
+// Container charged for each sys_memory allocation, indexed by address / 64K (the minimal page size)
+// Cleared with the rest of the lv2 state on stop, so no pointer outlives its emulation session
+struct lv2_memory_owners
 {
-	static const u32 id_base = 0x1;
-	static const u32 id_step = 0x1;
-	static const u32 id_count = 0x1000;
+	static void set(u32 addr, lv2_memory_container* ct);
 
-	const u32 size; // Memory size
-	const u32 align; // Alignment required
-	const u64 flags;
-	const std::shared_ptr<lv2_memory_container> ct;
-	const std::shared_ptr<utils::shm> shm;
+	// Take the owner (only one of concurrent callers can get it), nullptr if not recorded
+	static lv2_memory_container* claim(u32 addr);
 
-	lv2_memory_alloca(u32 size, u32 align, u64 flags, const std::shared_ptr<lv2_memory_container>& ct);
+	static void clear();
 };
 
 // SysCalls
@@ -3,6 +3,7 @@
 #include "Emu/System.h"
 #include "Emu/IdManager.h"
 #include "Emu/IPC.h"
+#include "Utilities/lock_profiler.h"
 
 #include "Emu/Cell/ErrorCodes.h"
 #include "Emu/Cell/PPUThread.h"
@@ -189,6 +190,11 @@ error_code sys_mutex_lock(ppu_thread& ppu, u32 mutex_id, u64 timeout)
 		}
 	}
 
+	if (UNLIKELY(lock_profiler::g_enabled))
+	{
+		lock_profiler::record_object("sys_mutex", mutex_id, mutex->name, (get_system_time() - ppu.start_time) * 1000);
+	}
+
 	return not_an_error(ppu.gpr[3]);
 }
 
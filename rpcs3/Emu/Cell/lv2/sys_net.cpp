@@ -22,6 +22,12 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <sys/event.h>
+#endif
 #endif
 
 
@@ -110,31 +116,358 @@ static void network_clear_queue(ppu_thread& ppu)
 	});
 }
 
+// Backend of the network thread: sockets with selected events are armed once and report readiness by their ID
+#ifdef _WIN32
+static atomic_t<HANDLE> s_nw_event{};
+#elif defined(__linux__)
+static atomic_t<int> s_nw_wake{-1}; // eventfd
+#else
+static atomic_t<int> s_nw_kqueue{-1}; // Wakes up with EVFILT_USER
+#endif
+
+// Notify the network thread about newly selected events
+static void network_wake()
+{
+#ifdef _WIN32
+	if (const HANDLE ev = s_nw_event)
+	{
+		SetEvent(ev);
+	}
+#elif defined(__linux__)
+	if (const int fd = s_nw_wake; fd >= 0)
+	{
+		const u64 value = 1;
+		verify(HERE), ::write(fd, &value, sizeof(value)) == sizeof(value);
+	}
+#else
+	if (const int kq = s_nw_kqueue; kq >= 0)
+	{
+		struct kevent ev;
+		EV_SET(&ev, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+		::kevent(kq, &ev, 1, nullptr, 0, nullptr);
+	}
+#endif
+}
+
+#ifdef __linux__
+struct lv2_socket::dgram_batch
+{
+	static constexpr u32 max_count = 8;
+	static constexpr u32 max_size = 65536;
+
+	// Datagrams received ahead, returned by the following recvfrom calls
+	std::unique_ptr<u8[]> rx_data{new u8[max_count * max_size]};
+	::sockaddr_in rx_addr[max_count];
+	u32 rx_size[max_count];
+	u32 rx_pos = 0;
+	atomic_t<u32> rx_left{0}; // Read by poll and select without the socket mutex
+
+	// Datagrams accepted by sendto, sent by the network thread
+	std::vector<u8> tx_data[max_count];
+	::sockaddr_in tx_addr[max_count];
+	bool tx_named[max_count];
+	u32 tx_count = 0;
+};
+
+// Take the next datagram, the first one of a new batch is received directly into the guest buffer (socket mutex required)
+static int dgram_recv(lv2_socket& sock, void* buf, u32 len, int native_flags, ::sockaddr_storage& addr, ::socklen_t& addrlen)
+{
+	auto& b = *sock.batch;
+
+	if (b.rx_left)
+	{
+		const u32 i = b.rx_pos;
+		const u32 size = std::min(b.rx_size[i], len);
+
+		std::memcpy(buf, b.rx_data.get() + i * b.max_size, size);
+		std::memcpy(&addr, &b.rx_addr[i], sizeof(::sockaddr_in));
+		addrlen = sizeof(::sockaddr_in);
+
+		if (!(native_flags & MSG_PEEK))
+		{
+			b.rx_pos++;
+			b.rx_left--;
+		}
+
+		return size;
+	}
+
+	if (native_flags & MSG_PEEK)
+	{
+		return ::recvfrom(sock.socket, buf, len, native_flags, reinterpret_cast<::sockaddr*>(&addr), &addrlen);
+	}
+
+	::mmsghdr msgs[lv2_socket::dgram_batch::max_count + 1]{};
+	::iovec iov[lv2_socket::dgram_batch::max_count + 1];
+
+	iov[0] = {buf, len};
+	msgs[0].msg_hdr.msg_name = &addr;
+	msgs[0].msg_hdr.msg_namelen = addrlen;
+	msgs[0].msg_hdr.msg_iov = &iov[0];
+	msgs[0].msg_hdr.msg_iovlen = 1;
+
+	for (u32 i = 0; i < b.max_count; i++)
+	{
+		iov[i + 1] = {b.rx_data.get() + i * b.max_size, b.max_size};
+		msgs[i + 1].msg_hdr.msg_name = &b.rx_addr[i];
+		msgs[i + 1].msg_hdr.msg_namelen = sizeof(::sockaddr_in);
+		msgs[i + 1].msg_hdr.msg_iov = &iov[i + 1];
+		msgs[i + 1].msg_hdr.msg_iovlen = 1;
+	}
+
+	const int count = ::recvmmsg(sock.socket, msgs, b.max_count + 1, MSG_DONTWAIT, nullptr);
+
+	if (count <= 0)
+	{
+		return -1;
+	}
+
+	for (int i = 1; i < count; i++)
+	{
+		b.rx_size[i - 1] = msgs[i].msg_len;
+	}
+
+	b.rx_pos = 0;
+	b.rx_left = count - 1;
+
+	addrlen = msgs[0].msg_hdr.msg_namelen;
+	return msgs[0].msg_len;
+}
+
+// Send the queued datagrams and the optional extra one with a single syscall (socket mutex required)
+static int dgram_flush(lv2_socket& sock, const void* buf = nullptr, u32 len = 0, const ::sockaddr_in* name = nullptr)
+{
+	auto& b = *sock.batch;
+
+	::mmsghdr msgs[lv2_socket::dgram_batch::max_count + 1]{};
+	::iovec iov[lv2_socket::dgram_batch::max_count + 1];
+
+	u32 count = 0;
+
+	for (; count < b.tx_count; count++)
+	{
+		iov[count] = {b.tx_data[count].data(), b.tx_data[count].size()};
+		msgs[count].msg_hdr.msg_name = b.tx_named[count] ? &b.tx_addr[count] : nullptr;
+		msgs[count].msg_hdr.msg_namelen = b.tx_named[count] ? sizeof(::sockaddr_in) : 0;
+		msgs[count].msg_hdr.msg_iov = &iov[count];
+		msgs[count].msg_hdr.msg_iovlen = 1;
+	}
+
+	if (buf)
+	{
+		iov[count] = {const_cast<void*>(buf), len};
+		msgs[count].msg_hdr.msg_name = const_cast<::sockaddr_in*>(name);
+		msgs[count].msg_hdr.msg_namelen = name ? sizeof(::sockaddr_in) : 0;
+		msgs[count].msg_hdr.msg_iov = &iov[count];
+		msgs[count].msg_hdr.msg_iovlen = 1;
+		count++;
+	}
+
+	if (!count)
+	{
+		return 0;
+	}
+
+	const int sent = ::sendmmsg(sock.socket, msgs, count, MSG_DONTWAIT);
+
+	if (sent < 0)
+	{
+		if (errno == EWOULDBLOCK)
+		{
+			// Retried on the next pass of the network thread
+			return -1;
+		}
+
+		// Errors of accepted datagrams can't be reported anymore, like with asynchronous ICMP errors
+		sys_net.error("sendmmsg() failed: %d (%u datagrams dropped)", errno, b.tx_count);
+		b.tx_count = 0;
+		return -1;
+	}
+
+	const u32 done = std::min<u32>(sent, b.tx_count);
+
+	for (u32 i = done; i < b.tx_count; i++)
+	{
+		b.tx_data[i - done].swap(b.tx_data[i]);
+		b.tx_addr[i - done] = b.tx_addr[i];
+		b.tx_named[i - done] = b.tx_named[i];
+	}
+
+	b.tx_count -= done;
+
+	// Whether the extra datagram was sent
+	return buf && static_cast<u32>(sent) == count ? len : -1;
+}
+
+// Queue the datagram for the network thread, or send it with the full batch (socket mutex required)
+static int dgram_send(lv2_socket& sock, const void* buf, u32 len, const ::sockaddr_in* name)
+{
+	auto& b = *sock.batch;
+
+	if (b.tx_count == b.max_count)
+	{
+		const int result = dgram_flush(sock, buf, len, name);
+
+		if (result < 0)
+		{
+			errno = EWOULDBLOCK;
+		}
+
+		return result;
+	}
+
+	b.tx_data[b.tx_count].assign(static_cast<const u8*>(buf), static_cast<const u8*>(buf) + len);
+	b.tx_named[b.tx_count] = name != nullptr;
+
+	if (name)
+	{
+		b.tx_addr[b.tx_count] = *name;
+	}
+
+	if (b.tx_count++ == 0)
+	{
+		network_wake();
+	}
+
+	return len;
+}
+
+static bool dgram_pending(lv2_socket& sock)
+{
+	return sock.batch && sock.batch->rx_left;
+}
+#endif
+
+static int native_recvfrom(lv2_socket& sock, void* buf, u32 len, int flags, ::sockaddr_storage& addr, ::socklen_t& addrlen)
+{
+#ifdef __linux__
+	if (sock.batch)
+	{
+		return dgram_recv(sock, buf, len, flags, addr, addrlen);
+	}
+#endif
+
+	return ::recvfrom(sock.socket, static_cast<char*>(buf), len, flags, reinterpret_cast<::sockaddr*>(&addr), &addrlen);
+}
+
+static int native_sendto(lv2_socket& sock, const void* buf, u32 len, int flags, const ::sockaddr_in* name)
+{
+#ifdef __linux__
+	if (sock.batch)
+	{
+		return dgram_send(sock, buf, len, name);
+	}
+#endif
+
+	return ::sendto(sock.socket, static_cast<const char*>(buf), len, flags, reinterpret_cast<const ::sockaddr*>(name), static_cast<::socklen_t>(name ? sizeof(*name) : 0));
+}
+
 extern void network_thread_init()
 {
 	thread_ctrl::spawn("Network Thread", []()
 	{
 		std::vector<std::shared_ptr<lv2_socket>> socklist;
+		std::vector<u32> sockids;
 		socklist.reserve(lv2_socket::id_count);
+		sockids.reserve(lv2_socket::id_count);
 
 		s_to_awake.clear();
 
+		// Only wakes up for the stop check when nothing happens
+		constexpr int timeout_ms = 100;
+
 #ifdef _WIN32
 		HANDLE _eventh = CreateEventW(nullptr, false, false, nullptr);
+		s_nw_event = _eventh;
 
 		WSADATA wsa_data;
 		WSAStartup(MAKEWORD(2, 2), &wsa_data);
 #else
-		::pollfd fds[lv2_socket::id_count]{};
+		// Events reported by the backend, indexed by socket ID
+		std::vector<bs_t<lv2_socket::poll>> ready(lv2_socket::id_count);
+
+		auto set_ready = [&](u64 id, lv2_socket::poll event)
+		{
+			if (id - lv2_socket::id_base < lv2_socket::id_count)
+			{
+				ready[id - lv2_socket::id_base] += event;
+			}
+		};
+#endif
+
+#ifdef __linux__
+		const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+		const int wakefd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+		::epoll_event wake_ev{};
+		wake_ev.events = EPOLLIN;
+		wake_ev.data.u64 = UINT64_MAX;
+		verify(HERE), ::epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &wake_ev) == 0;
+
+		s_nw_wake = wakefd;
+
+		::epoll_event evs[64];
+#elif !defined(_WIN32)
+		const int kq = ::kqueue();
+
+		struct kevent wake_ev;
+		EV_SET(&wake_ev, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+		verify(HERE), ::kevent(kq, &wake_ev, 1, nullptr, 0, nullptr) == 0;
+
+		s_nw_kqueue = kq;
+
+		std::vector<struct kevent> changes;
+		struct kevent evs[64];
 #endif
 
 		do
 		{
-			// Wait with 1ms timeout
+			// Wait for the armed sockets or for new events to select
 #ifdef _WIN32
-			WaitForSingleObjectEx(_eventh, 1, false);
+			WaitForSingleObjectEx(_eventh, timeout_ms, false);
+#elif defined(__linux__)
+			const int count = ::epoll_wait(epfd, evs, 64, timeout_ms);
+
+			for (int i = 0; i < count; i++)
+			{
+				const u64 id = evs[i].data.u64;
+
+				if (id == UINT64_MAX)
+				{
+					u64 value;
+					::read(wakefd, &value, sizeof(value));
+					continue;
+				}
+
+				if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP))
+					set_ready(id, lv2_socket::poll::read);
+				if (evs[i].events & EPOLLOUT)
+					set_ready(id, lv2_socket::poll::write);
+				if (evs[i].events & EPOLLERR)
+					set_ready(id, lv2_socket::poll::error);
+			}
 #else
-			::poll(fds, socklist.size(), 1);
+			const ::timespec timeout{0, timeout_ms * 1000000};
+			const int count = ::kevent(kq, changes.data(), static_cast<int>(changes.size()), evs, 64, &timeout);
+
+			changes.clear();
+
+			for (int i = 0; i < count; i++)
+			{
+				const u64 id = reinterpret_cast<std::uintptr_t>(evs[i].udata);
+
+				if (evs[i].filter == EVFILT_USER)
+				{
+					continue;
+				}
+
+				if (evs[i].flags & EV_ERROR)
+					set_ready(id, lv2_socket::poll::error);
+				else if (evs[i].filter == EVFILT_READ)
+					set_ready(id, lv2_socket::poll::read);
+				else if (evs[i].filter == EVFILT_WRITE)
+					set_ready(id, lv2_socket::poll::write);
+			}
 #endif
 
 			std::lock_guard lock(s_nw_mutex);
@@ -172,11 +505,13 @@ extern void network_thread_init()
 					sys_net.error("WSAEnumNetworkEvents() failed (s=%d)", i);
 				}
 #else
-				if (fds[i].revents & (POLLIN | POLLHUP) && socklist[i]->events.test_and_reset(lv2_socket::poll::read))
+				const auto revents = std::exchange(ready[sockids[i] - lv2_socket::id_base], {});
+
+				if (revents & lv2_socket::poll::read && sock.events.test_and_reset(lv2_socket::poll::read))
 					events += lv2_socket::poll::read;
-				if (fds[i].revents & POLLOUT && socklist[i]->events.test_and_reset(lv2_socket::poll::write))
+				if (revents & lv2_socket::poll::write && sock.events.test_and_reset(lv2_socket::poll::write))
 					events += lv2_socket::poll::write;
-				if (fds[i].revents & POLLERR && socklist[i]->events.test_and_reset(lv2_socket::poll::error))
+				if (revents & lv2_socket::poll::error && sock.events.test_and_reset(lv2_socket::poll::error))
 					events += lv2_socket::poll::error;
 #endif
 
@@ -212,34 +547,78 @@ extern void network_thread_init()
 
 			s_to_awake.clear();
 			socklist.clear();
+			sockids.clear();
 
 			// Obtain all active sockets
 			idm::select<lv2_socket>([&](u32 id, lv2_socket&)
 			{
 				socklist.emplace_back(idm::get_unlocked<lv2_socket>(id));
+				sockids.emplace_back(id);
 			});
 
+			// Arm the sockets which have events selected, others report nothing until selected again
 			for (std::size_t i = 0; i < socklist.size(); i++)
 			{
-				auto events = socklist[i]->events.load();
+				lv2_socket& sock = *socklist[i];
+
+#ifdef __linux__
+				if (sock.batch)
+				{
+					// Send the datagrams queued since the last pass
+					std::lock_guard lock(sock.mutex);
+					dgram_flush(sock);
+				}
+#endif
+
+				auto events = sock.events.load();
 
 #ifdef _WIN32
-				verify(HERE), 0 == WSAEventSelect(socklist[i]->socket, _eventh, FD_READ | FD_ACCEPT | FD_CLOSE | FD_WRITE | FD_CONNECT);
+				verify(HERE), 0 == WSAEventSelect(sock.socket, _eventh, FD_READ | FD_ACCEPT | FD_CLOSE | FD_WRITE | FD_CONNECT);
+#elif defined(__linux__)
+				if (!events)
+				{
+					continue;
+				}
+
+				::epoll_event ev{};
+				ev.events = EPOLLONESHOT |
+					(events & lv2_socket::poll::read ? EPOLLIN | EPOLLRDHUP : 0) |
+					(events & lv2_socket::poll::write ? EPOLLOUT : 0);
+				ev.data.u64 = sockids[i];
+
+				// Closed descriptors leave the set by themselves
+				if (::epoll_ctl(epfd, EPOLL_CTL_MOD, sock.socket, &ev) != 0 && errno == ENOENT)
+				{
+					::epoll_ctl(epfd, EPOLL_CTL_ADD, sock.socket, &ev);
+				}
 #else
-				fds[i].fd = events ? socklist[i]->socket : -1;
-				fds[i].events =
-					(events & lv2_socket::poll::read ? POLLIN : 0) |
-					(events & lv2_socket::poll::write ? POLLOUT : 0) |
-					0;
-				fds[i].revents = 0;
+				if (events & lv2_socket::poll::read)
+				{
+					changes.emplace_back();
+					EV_SET(&changes.back(), sock.socket, EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, reinterpret_cast<void*>(std::uintptr_t{sockids[i]}));
+				}
+
+				if (events & lv2_socket::poll::write)
+				{
+					changes.emplace_back();
+					EV_SET(&changes.back(), sock.socket, EVFILT_WRITE, EV_ADD | EV_ONESHOT, 0, 0, reinterpret_cast<void*>(std::uintptr_t{sockids[i]}));
+				}
 #endif
 			}
 		}
 		while (!Emu.IsStopped());
 
 #ifdef _WIN32
+		s_nw_event = nullptr;
 		CloseHandle(_eventh);
 		WSACleanup();
+#elif defined(__linux__)
+		s_nw_wake = -1;
+		::close(wakefd);
+		::close(epfd);
+#else
+		s_nw_kqueue = -1;
+		::close(kq);
 #endif
 	});
 }
@@ -261,6 +640,13 @@ lv2_socket::~lv2_socket()
 #ifdef _WIN32
 	::closesocket(socket);
 #else
+#ifdef __linux__
+	if (batch)
+	{
+		dgram_flush(*this);
+	}
+#endif
+
 	::close(socket);
 #endif
 }
@@ -300,6 +686,7 @@ s32 sys_net_bnet_accept(ppu_thread& ppu, s32 s, vm::ptr<sys_net_sockaddr> addr,
 
 		// Enable read event
 		sock.events += lv2_socket::poll::read;
+		network_wake();
 		sock.queue.emplace_back(ppu.id, [&](bs_t<lv2_socket::poll> events) -> bool
 		{
 			if (events & lv2_socket::poll::read)
@@ -480,6 +867,7 @@ s32 sys_net_bnet_connect(ppu_thread& ppu, s32 s, vm::ptr<sys_net_sockaddr> addr,
 			if (result == SYS_NET_EINPROGRESS)
 			{
 				sock.events += lv2_socket::poll::write;
+				network_wake();
 				sock.queue.emplace_back(u32{0}, [&sock](bs_t<lv2_socket::poll> events) -> bool
 				{
 					if (events & lv2_socket::poll::write)
@@ -511,6 +899,7 @@ s32 sys_net_bnet_connect(ppu_thread& ppu, s32 s, vm::ptr<sys_net_sockaddr> addr,
 		}
 
 		sock.events += lv2_socket::poll::write;
+		network_wake();
 		sock.queue.emplace_back(ppu.id, [&](bs_t<lv2_socket::poll> events) -> bool
 		{
 			if (events & lv2_socket::poll::write)
@@ -906,7 +1295,7 @@ s32 sys_net_bnet_recvfrom(ppu_thread& ppu, s32 s, vm::ptr<void> buf, u32 len, s3
 #ifdef _WIN32
 			if (!(native_flags & MSG_PEEK)) sock.ev_set &= ~FD_READ;
 #endif
-			native_result = ::recvfrom(sock.socket, (char*)buf.get_ptr(), len, native_flags, (::sockaddr*)&native_addr, &native_addrlen);
+			native_result = native_recvfrom(sock, buf.get_ptr(), len, native_flags, native_addr, native_addrlen);
 
 			if (native_result >= 0)
 			{
@@ -923,6 +1312,7 @@ s32 sys_net_bnet_recvfrom(ppu_thread& ppu, s32 s, vm::ptr<void> buf, u32 len, s3
 
 		// Enable read event
 		sock.events += lv2_socket::poll::read;
+		network_wake();
 		sock.queue.emplace_back(ppu.id, [&](bs_t<lv2_socket::poll> events) -> bool
 		{
 			if (events & lv2_socket::poll::read)
@@ -930,7 +1320,7 @@ s32 sys_net_bnet_recvfrom(ppu_thread& ppu, s32 s, vm::ptr<void> buf, u32 len, s3
 #ifdef _WIN32
 				if (!(native_flags & MSG_PEEK)) sock.ev_set &= ~FD_READ;
 #endif
-				native_result = ::recvfrom(sock.socket, (char*)buf.get_ptr(), len, native_flags, (::sockaddr*)&native_addr, &native_addrlen);
+				native_result = native_recvfrom(sock, buf.get_ptr(), len, native_flags, native_addr, native_addrlen);
 
 				if (native_result >= 0 || (result = get_last_error(!sock.so_nbio && (flags & SYS_NET_MSG_DONTWAIT) == 0)))
 				{
@@ -1052,7 +1442,6 @@ s32 sys_net_bnet_sendto(ppu_thread& ppu, s32 s, vm::cptr<void> buf, u32 len, s32
 		name.sin_addr.s_addr = htonl(((sys_net_sockaddr_in*)addr.get_ptr())->sin_addr);
 	}
 
-	::socklen_t namelen = sizeof(name);
 	s32 result = 0;
 
 	if (flags & SYS_NET_MSG_WAITALL)
@@ -1069,7 +1458,7 @@ s32 sys_net_bnet_sendto(ppu_thread& ppu, s32 s, vm::cptr<void> buf, u32 len, s32
 #ifdef _WIN32
 			sock.ev_set &= ~FD_WRITE;
 #endif
-			native_result = ::sendto(sock.socket, (const char*)buf.get_ptr(), len, native_flags, addr ? (::sockaddr*)&name : nullptr, addr ? namelen : 0);
+			native_result = native_sendto(sock, buf.get_ptr(), len, native_flags, addr ? &name : nullptr);
 
 			if (native_result >= 0)
 			{
@@ -1086,6 +1475,7 @@ s32 sys_net_bnet_sendto(ppu_thread& ppu, s32 s, vm::cptr<void> buf, u32 len, s32
 
 		// Enable write event
 		sock.events += lv2_socket::poll::write;
+		network_wake();
 		sock.queue.emplace_back(ppu.id, [&](bs_t<lv2_socket::poll> events) -> bool
 		{
 			if (events & lv2_socket::poll::write)
@@ -1093,7 +1483,7 @@ s32 sys_net_bnet_sendto(ppu_thread& ppu, s32 s, vm::cptr<void> buf, u32 len, s32
 #ifdef _WIN32
 				sock.ev_set &= ~FD_WRITE;
 #endif
-				native_result = ::sendto(sock.socket, (const char*)buf.get_ptr(), len, native_flags, addr ? (::sockaddr*)&name : nullptr, addr ? namelen : 0);
+				native_result = native_sendto(sock, buf.get_ptr(), len, native_flags, addr ? &name : nullptr);
 
 				if (native_result >= 0 || (result = get_last_error(!sock.so_nbio && (flags & SYS_NET_MSG_DONTWAIT) == 0)))
 				{
@@ -1414,7 +1804,16 @@ s32 sys_net_bnet_socket(ppu_thread& ppu, s32 family, s32 type, s32 protocol)
 		return -get_last_error(false);
 	}
 
-	const s32 s = idm::import_existing<lv2_socket>(std::make_shared<lv2_socket>(native_socket));
+	const auto sock = std::make_shared<lv2_socket>(native_socket);
+
+#ifdef __linux__
+	if (native_type == SOCK_DGRAM && g_cfg.net.batch_udp)
+	{
+		sock->batch = std::make_unique<lv2_socket::dgram_batch>();
+	}
+#endif
+
+	const s32 s = idm::import_existing<lv2_socket>(sock);
 
 	if (s == id_manager::id_traits<lv2_socket>::invalid)
 	{
@@ -1491,6 +1890,10 @@ s32 sys_net_bnet_poll(ppu_thread& ppu, vm::ptr<sys_net_pollfd> fds, s32 nfds, s3
 					_fds[i].events |= POLLIN;
 				if (fds[i].events & SYS_NET_POLLOUT)
 					_fds[i].events |= POLLOUT;
+#ifdef __linux__
+				if (fds[i].events & SYS_NET_POLLIN && dgram_pending(*sock))
+					fds[i].revents |= SYS_NET_POLLIN;
+#endif
 #endif
 			}
 			else
@@ -1545,6 +1948,7 @@ s32 sys_net_bnet_poll(ppu_thread& ppu, vm::ptr<sys_net_pollfd> fds, s32 nfds, s3
 				//	selected += lv2_socket::poll::error;
 
 				sock->events += selected;
+				network_wake();
 				sock->queue.emplace_back(ppu.id, [sock, selected, fds, i, &signaled, &ppu](bs_t<lv2_socket::poll> events)
 				{
 					if (events & selected)
@@ -1678,6 +2082,10 @@ s32 sys_net_bnet_select(ppu_thread& ppu, s32 nfds, vm::ptr<sys_net_fd_set> readf
 					_fds[i].events |= POLLIN;
 				if (selected & lv2_socket::poll::write)
 					_fds[i].events |= POLLOUT;
+#ifdef __linux__
+				if (selected & lv2_socket::poll::read && dgram_pending(*sock))
+					rread.set(i);
+#endif
 #endif
 			}
 			else
@@ -1691,7 +2099,7 @@ s32 sys_net_bnet_select(ppu_thread& ppu, s32 nfds, vm::ptr<sys_net_fd_set> readf
 
 		for (s32 i = 0; i < nfds; i++)
 		{
-			bool sig = false;
+			bool sig = rread.bit(i);
 			if (_fds[i].revents & (POLLIN | POLLHUP | POLLERR))
 				sig = true, rread.set(i);
 			if (_fds[i].revents & (POLLOUT | POLLERR))
@@ -1740,6 +2148,7 @@ s32 sys_net_bnet_select(ppu_thread& ppu, s32 nfds, vm::ptr<sys_net_fd_set> readf
 				std::lock_guard lock(sock->mutex);
 
 				sock->events += selected;
+				network_wake();
 				sock->queue.emplace_back(ppu.id, [sock, selected, i, &rread, &rwrite, &rexcept, &signaled, &ppu](bs_t<lv2_socket::poll> events)
 				{
 					if (events & selected)
@@ -3,6 +3,7 @@
 #include "Utilities/bit_set.h"
 #include "Utilities/mutex.h"
 
+#include <memory>
 #include <vector>
 #include <utility>
 #include <functional>
@@ -354,6 +355,12 @@ struct lv2_socket final
 
 	// Event processing workload (pair of thread id and the processing function)
 	std::vector<std::pair<u32, std::function<bool(bs_t<lv2_socket::poll>)>>> queue;
+
+#ifdef __linux__
+	// Batched datagram I/O (UDP sockets with "Batch UDP Datagrams" only)
+	struct dgram_batch;
+	std::unique_ptr<dgram_batch> batch;
+#endif
 };
 
 class ppu_thread;
@@ -192,13 +192,7 @@ error_code sys_rsx_context_iomap(u32 context_id, u32 io, u32 ea, u32 size, u64 f
 		}
 	}
 
-	io >>= 20, ea >>= 20, size >>= 20;
-
-	for (u32 i = 0; i < size; i++)
-	{
-		RSXIOMem.io[ea + i].release(io + i);
-		RSXIOMem.ea[io + i].release(ea + i);
-	}
+	RSXIOMem.map(ea >> 20, io >> 20, size >> 20);
 
 	return CELL_OK;
 }
@@ -218,12 +212,7 @@ error_code sys_rsx_context_iounmap(u32 context_id, u32 io, u32 size)
 		return CELL_EINVAL;
 	}
 
-	const u32 end = (io >>= 20) + (size >>= 20);
-	for (u32 ea = RSXIOMem.ea[io]; io < end;)
-	{
-		RSXIOMem.io[ea++].release(0xFFFF);
-		RSXIOMem.ea[io++].release(0xFFFF);
-	}
+	RSXIOMem.unmap(io >> 20, size >> 20);
 
 	return CELL_OK;
 }
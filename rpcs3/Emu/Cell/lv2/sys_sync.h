@@ -217,14 +217,62 @@ private:
 	// Scheduler mutex
 	static shared_mutex g_mutex;
 
+	// Active PPU threads in scheduling order: a FIFO per priority and a bitmap of the non-empty ones
+	struct ppu_run_queue
+	{
+		static constexpr u32 levels = 3072;
+
+		std::array<std::vector<class ppu_thread*>, levels> queues;
+		std::array<u64, levels / 64> bitmap{};
+		u64 summary = 0; // Bit per non-zero bitmap word
+		std::size_t count = 0;
+
+		// Priorities out of the lv2 range share the lowest level
+		static u32 level(u32 prio)
+		{
+			return std::min(prio, levels - 1);
+		}
+
+		// First non-empty level starting from the given one, or levels if none
+		u32 next_level(u32 from) const;
+
+		// Insert at the back of the level, returns the position in scheduling order
+		std::size_t push(class ppu_thread* thread, u32 prio);
+
+		bool remove(class ppu_thread* thread, u32 prio);
+
+		bool contains(class ppu_thread* thread, u32 prio) const;
+
+		// Position in scheduling order (the thread must be queued)
+		std::size_t index_of(class ppu_thread* thread, u32 prio) const;
+
+		// Thread at the position in scheduling order (must be lower than count)
+		class ppu_thread* at(std::size_t index) const;
+
+		void clear();
+
+		// Visit threads in scheduling order until the function returns false
+		template <typename F>
+		void for_each(F&& func) const
+		{
+			for (u32 lv = next_level(0); lv < levels; lv = next_level(lv + 1))
+			{
+				for (auto thread : queues[lv])
+				{
+					if (!func(thread))
+					{
+						return;
+					}
+				}
+			}
+		}
+	};
+
 	// Scheduler queue for active PPU threads
-	static std::deque<class ppu_thread*> g_ppu;
+	static ppu_run_queue g_ppu;
 
 	// Waiting for the response from
 	static std::deque<class cpu_thread*> g_pending;
 
-	// Scheduler queue for timeouts (wait until -> thread)
-	static std::deque<std::pair<u64, class cpu_thread*>> g_waiting;
-
 	static void schedule_all();
 };
@@ -3,8 +3,13 @@
 #include "Emu/System.h"
 
 #include "Emu/Cell/ErrorCodes.h"
+#include "Utilities/sysinfo.h"
+#include "Utilities/asm.h"
 #include "sys_time.h"
 
+#include <cmath>
+#include <thread>
+
 #ifdef _WIN32
 
 #include <Windows.h>
@@ -109,8 +114,8 @@ LOG_CHANNEL(sys_time);
 
 static const u64 g_timebase_freq = /*79800000*/ 80000000; // 80 Mhz
 
-// Auxiliary functions
-u64 get_timebased_time()
+// Timebase from the OS clock, rescaled on every call
+static u64 get_clock_timebased_time()
 {
 #ifdef _WIN32
 	LARGE_INTEGER count;
@@ -128,6 +133,68 @@ u64 get_timebased_time()
 #endif
 }
 
+// Calibrate the TSC against the OS clock (only if the TSC is invariant, so it's synchronized across cores and frequency changes)
+const tsc_timebase_info g_tsc_timebase = []() -> tsc_timebase_info
+{
+	if (!utils::has_invariant_tsc())
+	{
+		return {};
+	}
+
+	// Sample both clocks, the TSC reads around the clock read give its error bound
+	const auto sample = [](u64& tsc, u64& tb) -> u64
+	{
+		const u64 before = __rdtsc();
+		tb = get_clock_timebased_time();
+		const u64 after = __rdtsc();
+		tsc = before + (after - before) / 2;
+		return after - before;
+	};
+
+	u64 tsc0, tb0, tsc1, tb1;
+
+	// Retry if interrupted between the reads
+	for (u32 i = 0; i < 10 && sample(tsc0, tb0) > 10000; i++)
+	{
+	}
+
+	// Measure over 20ms
+	do
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		sample(tsc1, tb1);
+	}
+	while (tb1 - tb0 < g_timebase_freq / 50);
+
+	for (u32 i = 0; i < 10 && sample(tsc1, tb1) > 10000; i++)
+	{
+	}
+
+	// The TSC must be much faster than the timebase for the conversion to be exact enough
+	if (tsc1 <= tsc0 || (tsc1 - tsc0) / (tb1 - tb0) < 4)
+	{
+		LOG_ERROR(GENERAL, "TSC calibration failed, using the OS clock for the timebase");
+		return {};
+	}
+
+	tsc_timebase_info result;
+	result.tsc_start = tsc0;
+	result.tb_start = tb0;
+	result.mul = static_cast<u64>(std::ldexp(static_cast<f64>(tb1 - tb0) / static_cast<f64>(tsc1 - tsc0), 64));
+	return result;
+}();
+
+// Auxiliary functions
+u64 get_timebased_time()
+{
+	if (const u64 mul = g_tsc_timebase.mul)
+	{
+		return g_tsc_timebase.tb_start + utils::umulh64(__rdtsc() - g_tsc_timebase.tsc_start, mul);
+	}
+
+	return get_clock_timebased_time();
+}
+
 // Returns some relative time in microseconds, don't change this fact
 u64 get_system_time()
 {
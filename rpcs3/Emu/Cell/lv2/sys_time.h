@@ -1,5 +1,16 @@
 #pragma once
 
+// TSC to timebase conversion, mul is 0 if the TSC can't be used
+struct tsc_timebase_info
+{
+	u64 tsc_start; // TSC at calibration
+	u64 tb_start; // Timebase at calibration
+	u64 mul; // Timebase ticks per TSC tick (0.64 fixed point)
+};
+
+// Read by get_timebased_time() and by the PPU LLVM recompiler (inlined MFTB)
+extern const tsc_timebase_info g_tsc_timebase;
+
 // SysCalls
 s32 sys_time_get_timezone(vm::ptr<s32> timezone, vm::ptr<s32> summertime);
 s32 sys_time_get_current_time(vm::ptr<s64> sec, vm::ptr<s64> nsec);
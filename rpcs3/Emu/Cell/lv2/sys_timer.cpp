@@ -9,69 +9,380 @@
 #include "sys_process.h"
 #include "sys_timer.h"
 
+#include "Utilities/asm.h"
+
+#include <map>
 #include <thread>
 
 LOG_CHANNEL(sys_timer);
 
 extern u64 get_system_time();
 
-void lv2_timer_context::operator()()
+namespace
 {
-	while (!Emu.IsStopped())
+	constexpr u32 wheel_levels = 6;
+	constexpr u32 wheel_bits = 6;
+
+	// Host scheduler quantum, the servicing thread spins (yields) for the rest to be accurate
+#ifdef __linux__
+	constexpr u64 wheel_quantum = 100;
+#else
+	constexpr u64 wheel_quantum = 500;
+#endif
+
+	struct wheel_entry
+	{
+		u64 time;
+		const void* owner;
+		cpu_thread* cpu; // Thread to notify, or nullptr for a timer
+		u32 timer_id;
+	};
+
+	struct wheel_state
 	{
-		const u32 _state = state;
+		shared_mutex mutex;
+
+		// Wheel time, entries are placed relative to it (zero until first used)
+		u64 now = 0;
+
+		std::array<std::array<std::vector<wheel_entry>, 64>, wheel_levels> slots;
+		std::array<u64, wheel_levels> bitmap{};
+		std::multimap<u64, wheel_entry> overflow;
 
-		if (_state == SYS_TIMER_STATE_RUN)
+		struct location
 		{
-			const u64 _now = get_system_time();
-			const u64 next = expire;
+			u32 level; // wheel_levels for the overflow map
+			u32 slot;
+			std::size_t index;
+			std::multimap<u64, wheel_entry>::iterator it;
+		};
+
+		std::unordered_map<const void*, location> locations;
+
+		// Servicing thread and the time it is going to wake up at
+		thread_base* thread = nullptr;
+		u64 wake_time = -1;
 
-			if (_now >= next)
+		void insert(const wheel_entry& entry)
+		{
+			if (!now)
 			{
-				std::lock_guard lock(mutex);
+				now = get_system_time();
+			}
 
-				if (const auto queue = port.lock())
+			const u64 time = std::max(entry.time, now);
+
+			// Lowest level which has the deadline in the same window as the wheel time
+			const u64 diff = time ^ now;
+			const u32 level = diff ? static_cast<u32>(63 - utils::cntlz64(diff, true)) / wheel_bits : 0;
+
+			if (level >= wheel_levels)
+			{
+				locations[entry.owner] = {wheel_levels, 0, 0, overflow.emplace(time, entry)};
+			}
+			else
+			{
+				const u32 slot = (time >> (level * wheel_bits)) % 64;
+				auto& list = slots[level][slot];
+				locations[entry.owner] = {level, slot, list.size(), {}};
+				list.emplace_back(entry);
+				bitmap[level] |= 1ull << slot;
+			}
+
+			// Wake the servicing thread up earlier if necessary
+			if (thread && entry.time < wake_time)
+			{
+				wake_time = entry.time;
+				thread->notify();
+			}
+		}
+
+		void erase(const void* owner)
+		{
+			const auto found = locations.find(owner);
+
+			if (found == locations.end())
+			{
+				return;
+			}
+
+			const auto loc = found->second;
+			locations.erase(found);
+
+			if (loc.level == wheel_levels)
+			{
+				overflow.erase(loc.it);
+				return;
+			}
+
+			auto& list = slots[loc.level][loc.slot];
+
+			if (loc.index + 1 != list.size())
+			{
+				list[loc.index] = list.back();
+				locations[list[loc.index].owner].index = loc.index;
+			}
+
+			list.pop_back();
+
+			if (list.empty())
+			{
+				bitmap[loc.level] &= ~(1ull << loc.slot);
+			}
+		}
+
+		// Time of the next slot to process (exact deadline for the first level, cascade time otherwise)
+		u64 next_event(u32& level, u32& slot) const
+		{
+			u64 result = -1;
+			level = wheel_levels;
+
+			for (u32 lv = 0; lv < wheel_levels; lv++)
+			{
+				const u32 shift = lv * wheel_bits;
+
+				if (const u64 bits = bitmap[lv] & (~0ull << ((now >> shift) % 64)))
 				{
-					queue->send(source, data1, data2, next);
+					const u32 s = static_cast<u32>(utils::cnttz64(bits, true));
+					const u64 start = (now >> (shift + wheel_bits) << (shift + wheel_bits)) | (u64{s} << shift);
+
+					if (start < result)
+					{
+						result = start;
+						level = lv;
+						slot = s;
+					}
 				}
+			}
+
+			if (!overflow.empty())
+			{
+				const u32 shift = wheel_levels * wheel_bits;
+				const u64 start = overflow.begin()->first >> shift << shift;
+
+				if (start < result)
+				{
+					result = start;
+					level = wheel_levels;
+				}
+			}
+
+			return result;
+		}
 
-				if (period)
+		// Advance the wheel time, notify threads and collect the timers which are due
+		void advance(u64 time, std::vector<u32>& timers)
+		{
+			if (!now)
+			{
+				now = time;
+			}
+
+			u32 level, slot;
+
+			for (u64 event = next_event(level, slot); event <= time; event = next_event(level, slot))
+			{
+				std::vector<wheel_entry> list;
+
+				if (level == wheel_levels)
+				{
+					const u32 shift = wheel_levels * wheel_bits;
+
+					for (auto it = overflow.begin(); it != overflow.end() && it->first >> shift == event >> shift;)
+					{
+						list.emplace_back(it->second);
+						it = overflow.erase(it);
+					}
+				}
+				else
 				{
-					// Set next expiration time and check again (HACK)
-					expire += period;
-					continue;
+					list = std::move(slots[level][slot]);
+					slots[level][slot].clear();
+					bitmap[level] &= ~(1ull << slot);
 				}
 
-				// Stop after oneshot
-				state.compare_and_swap_test(SYS_TIMER_STATE_RUN, SYS_TIMER_STATE_STOP);
-				continue;
+				now = std::max(now, event);
+
+				for (auto& entry : list)
+				{
+					locations.erase(entry.owner);
+
+					if (entry.time > time)
+					{
+						// Cascade to a lower level
+						insert(entry);
+					}
+					else if (entry.cpu)
+					{
+						entry.cpu->notify();
+					}
+					else
+					{
+						timers.emplace_back(entry.timer_id);
+					}
+				}
 			}
 
-			// TODO: use single global dedicated thread for busy waiting, no timer threads
+			now = std::max(now, time);
+		}
+	};
+
+	wheel_state& get_wheel()
+	{
+		static wheel_state s_wheel;
+		return s_wheel;
+	}
+
+	void fire_timer(u32 timer_id)
+	{
+		idm::check<lv2_obj, lv2_timer>(timer_id, [&](lv2_timer& timer)
+		{
+			std::lock_guard lock(timer.mutex);
+
+			if (timer.state != SYS_TIMER_STATE_RUN)
+			{
+				return;
+			}
+
+			const u64 _now = get_system_time();
+
+			// Send an event for every period passed
+			while (timer.expire <= _now)
+			{
+				if (const auto queue = timer.port.lock())
+				{
+					queue->send(timer.source, timer.data1, timer.data2, timer.expire);
+				}
+
+				if (!timer.period)
+				{
+					// Stop after oneshot
+					timer.state = SYS_TIMER_STATE_STOP;
+					return;
+				}
+
+				timer.expire += timer.period;
+			}
+
+			lv2_timer_wheel::add_timer(timer, timer_id, timer.expire);
+		});
+	}
+}
+
+void lv2_timer_wheel::add_timeout(cpu_thread& cpu, u64 time)
+{
+	auto& wheel = get_wheel();
+	std::lock_guard lock(wheel.mutex);
+	wheel.erase(&cpu);
+	wheel.insert({time, &cpu, &cpu, 0});
+}
+
+void lv2_timer_wheel::add_timer(lv2_timer& timer, u32 timer_id, u64 time)
+{
+	auto& wheel = get_wheel();
+	std::lock_guard lock(wheel.mutex);
+	wheel.erase(&timer);
+	wheel.insert({time, &timer, nullptr, timer_id});
+}
+
+void lv2_timer_wheel::remove(const void* owner)
+{
+	auto& wheel = get_wheel();
+	std::lock_guard lock(wheel.mutex);
+	wheel.erase(owner);
+}
+
+void lv2_timer_wheel::clear()
+{
+	auto& wheel = get_wheel();
+	std::lock_guard lock(wheel.mutex);
+
+	for (auto& level : wheel.slots)
+	{
+		for (auto& list : level)
+		{
+			list.clear();
+		}
+	}
+
+	wheel.bitmap.fill(0);
+	wheel.overflow.clear();
+	wheel.locations.clear();
+	wheel.now = 0;
+}
+
+void lv2_timer_wheel::operator()()
+{
+	auto& wheel = get_wheel();
+
+	{
+		std::lock_guard lock(wheel.mutex);
+		wheel.thread = thread_ctrl::get_current();
+	}
+
+	std::vector<u32> timers;
+
+	while (thread_ctrl::state() != thread_state::aborting && !Emu.IsStopped())
+	{
+		u64 next;
+		bool exact;
+
+		{
+			std::lock_guard lock(wheel.mutex);
+
+			wheel.advance(get_system_time(), timers);
+
+			u32 level, slot;
+			next = wheel.next_event(level, slot);
+			exact = level == 0;
+			wheel.wake_time = next;
+		}
+
+		// Outside of the wheel lock, timers add themselves back
+		for (u32 id : timers)
+		{
+			fire_timer(id);
+		}
+
+		timers.clear();
+
+		if (next == UINT64_MAX)
+		{
+			thread_ctrl::wait();
+			continue;
+		}
+
+		const u64 _now = get_system_time();
+
+		if (next <= _now)
+		{
+			continue;
+		}
+
+		if (!exact)
+		{
+			// Cascading doesn't need to be accurate
 			thread_ctrl::wait_for(next - _now);
 		}
-		else if (_state == SYS_TIMER_STATE_STOP)
+		else if (next - _now > wheel_quantum)
 		{
-			thread_ctrl::wait_for(10000);
+			thread_ctrl::wait_for(next - _now - wheel_quantum);
 		}
 		else
 		{
-			break;
+			std::this_thread::yield();
 		}
 	}
-}
 
-void lv2_timer_context::on_abort()
-{
-	// Signal thread using invalid state
-	state = -1;
+	std::lock_guard lock(wheel.mutex);
+	wheel.thread = nullptr;
 }
 
 error_code sys_timer_create(vm::ptr<u32> timer_id)
 {
 	sys_timer.warning("sys_timer_create(timer_id=*0x%x)", timer_id);
 
-	if (const u32 id = idm::make<lv2_obj, lv2_timer>("Timer Thread"))
+	if (const u32 id = idm::make<lv2_obj, lv2_timer>())
 	{
 		*timer_id = id;
 		return CELL_OK;
@@ -93,6 +404,7 @@ error_code sys_timer_destroy(u32 timer_id)
 			return CELL_EISCONN;
 		}
 
+		lv2_timer_wheel::remove(&timer);
 		return {};
 	});
 
@@ -167,8 +479,7 @@ error_code _sys_timer_start(u32 timer_id, u64 base_time, u64 period)
 		timer.period = period;
 		timer.state  = SYS_TIMER_STATE_RUN;
 
-		lock.unlock();
-		thread_ctrl::notify(timer);
+		lv2_timer_wheel::add_timer(timer, timer_id, timer.expire);
 		return {};
 	});
 
@@ -194,6 +505,7 @@ error_code sys_timer_stop(u32 timer_id)
 		std::lock_guard lock(timer.mutex);
 
 		timer.state = SYS_TIMER_STATE_STOP;
+		lv2_timer_wheel::remove(&timer);
 	});
 
 	if (!timer)
@@ -260,6 +572,7 @@ error_code sys_timer_disconnect_event_queue(u32 timer_id)
 
 		timer.state = SYS_TIMER_STATE_STOP;
 		timer.port.reset();
+		lv2_timer_wheel::remove(&timer);
 		return {};
 	});
 
@@ -293,38 +606,20 @@ error_code sys_timer_usleep(ppu_thread& ppu, u64 sleep_time)
 
 	if (sleep_time)
 	{
-#ifdef __linux__
-		constexpr u32 host_min_quantum = 100;
-#else
-		// Host scheduler quantum for windows (worst case)
-		// NOTE: On ps3 this function has very high accuracy
-		constexpr u32 host_min_quantum = 500;
-#endif
-
 		u64 passed = 0;
-		u64 remaining;
 
+		// The timer wheel notifies the thread on time
+		// NOTE: On ps3 this function has very high accuracy
 		lv2_obj::sleep(ppu, sleep_time);
 
-		while (sleep_time >= passed)
+		while (passed < sleep_time)
 		{
 			if (ppu.is_stopped())
 			{
 				return 0;
 			}
 
-			remaining = sleep_time - passed;
-
-			if (remaining > host_min_quantum)
-			{
-				// Wait on multiple of min quantum for large durations
-				thread_ctrl::wait_for(remaining - (remaining % host_min_quantum));
-			}
-			else
-			{
-				// Try yielding. May cause long wake latency but helps weaker CPUs a lot by alleviating resource pressure
-				std::this_thread::yield();
-			}
+			thread_ctrl::wait_for(sleep_time - passed);
 
 			passed = (get_system_time() - ppu.start_time);
 		}
@@ -17,13 +17,10 @@ struct sys_timer_information_t
 	be_t<u32> pad;
 };
 
-struct lv2_timer_context : lv2_obj
+struct lv2_timer : lv2_obj
 {
 	static const u32 id_base = 0x11000000;
 
-	void operator()();
-	void on_abort();
-
 	shared_mutex mutex;
 	atomic_t<u32> state{SYS_TIMER_STATE_STOP};
 
@@ -36,7 +33,25 @@ struct lv2_timer_context : lv2_obj
 	atomic_t<u64> period{0}; // Period (oneshot if 0)
 };
 
-using lv2_timer = named_thread<lv2_timer_context>;
+// Hierarchical timer wheel for lv2 timeouts and timer events, serviced by a single thread
+// The wheel has 6 levels of 64 slots, level N slots are 64^N microseconds wide; farther deadlines wait in an overflow map
+// Its mutex is always acquired last, so it can be used under any other lock
+struct lv2_timer_wheel
+{
+	// Notify the thread at the given system time, replaces its previous timeout
+	static void add_timeout(cpu_thread& cpu, u64 time);
+
+	// Send the events of the timer which are due at the given system time
+	static void add_timer(lv2_timer& timer, u32 timer_id, u64 time);
+
+	// Cancel the timeout of a thread or a timer (no-op if not registered)
+	static void remove(const void* owner);
+
+	static void clear();
+
+	// Servicing thread, started with the emulation
+	void operator()();
+};
 
 class ppu_thread;
 
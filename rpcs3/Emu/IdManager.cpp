@@ -6,6 +6,7 @@ shared_mutex id_manager::g_mutex;
 
 thread_local DECLARE(idm::g_id);
 DECLARE(idm::g_map);
+DECLARE(idm::g_tables);
 DECLARE(fxm::g_vec);
 
 id_manager::id_map::pointer idm::allocate_id(const id_manager::id_key& info, u32 base, u32 step, u32 count)
@@ -47,15 +48,74 @@ id_manager::id_map::pointer idm::allocate_id(const id_manager::id_key& info, u32
 	return nullptr;
 }
 
+void idm::publish_id(u32 type, id_manager::id_map::pointer place)
+{
+	const u32 index = static_cast<u32>(place - g_map[type].data());
+
+	auto& chunk = g_tables[type].chunks[index / id_manager::id_table::chunk_size];
+
+	if (!chunk)
+	{
+		chunk = new id_manager::id_slot[id_manager::id_table::chunk_size];
+	}
+
+	auto& slot = chunk.load()[index % id_manager::id_table::chunk_size];
+
+	slot.key = place->first;
+	slot.ptr = place->second;
+	slot.ctrl |= id_manager::id_slot::published;
+}
+
+std::shared_ptr<void> idm::retire_id(u32 type, id_manager::id_map::pointer place)
+{
+	const u32 index = static_cast<u32>(place - g_map[type].data());
+
+	const auto chunk = g_tables[type].chunks[index / id_manager::id_table::chunk_size].load();
+
+	if (!chunk)
+	{
+		return nullptr;
+	}
+
+	auto& slot = chunk[index % id_manager::id_table::chunk_size];
+
+	slot.ctrl &= ~id_manager::id_slot::published;
+
+	// Readers only copy the pointer, this is short
+	while (slot.ctrl & id_manager::id_slot::readers)
+	{
+		busy_wait(100);
+	}
+
+	return std::move(slot.ptr);
+}
+
 void idm::init()
 {
 	// Allocate
 	g_map.resize(id_manager::typeinfo::get_count());
+	g_tables = std::make_unique<id_manager::id_table[]>(g_map.size());
 	idm::clear();
 }
 
 void idm::clear()
 {
+	// Drop the lookup copies first, threads using them are stopped already
+	for (u32 type = 0; type < g_map.size(); type++)
+	{
+		for (auto& chunk : g_tables[type].chunks)
+		{
+			if (const auto slots = chunk.load())
+			{
+				for (u32 i = 0; i < id_manager::id_table::chunk_size; i++)
+				{
+					slots[i].ctrl = 0;
+					slots[i].ptr.reset();
+				}
+			}
+		}
+	}
+
 	// Call recorded finalization functions for all IDs
 	for (auto& map : g_map)
 	{
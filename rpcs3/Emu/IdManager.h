@@ -115,6 +115,40 @@ namespace id_manager
 	};
 
 	using id_map = std::vector<std::pair<id_key, std::shared_ptr<void>>>;
+
+	// Copy of an ID map entry for lookups without the global mutex
+	struct id_slot
+	{
+		static constexpr u32 published = 0x80000000;
+		static constexpr u32 readers = 0x7fffffff;
+
+		// Published flag and the number of readers holding the slot
+		atomic_t<u32> ctrl{0};
+
+		id_key key{};
+		std::shared_ptr<void> ptr;
+	};
+
+	// Slots of a type indexed like its ID map, chunks are allocated on demand and never move
+	struct id_table
+	{
+		static constexpr u32 chunk_size = 256;
+		static constexpr u32 chunk_count = 256;
+
+		atomic_t<id_slot*> chunks[chunk_count]{};
+
+		id_table() = default;
+
+		id_table(const id_table&) = delete;
+
+		~id_table()
+		{
+			for (auto& chunk : chunks)
+			{
+				delete[] chunk.load();
+			}
+		}
+	};
 }
 
 // Object manager for emulated process. Multiple objects of specified arbitrary type are given unique IDs.
@@ -126,6 +160,9 @@ class idm
 	// Type Index -> ID -> Object. Use global since only one process is supported atm.
 	static std::vector<id_manager::id_map> g_map;
 
+	// Type Index -> ID -> Slot, mirrors g_map for get() and check() which don't take the mutex
+	static std::unique_ptr<id_manager::id_table[]> g_tables;
+
 	template <typename T>
 	static inline u32 get_type()
 	{
@@ -237,6 +274,50 @@ class idm
 		return nullptr;
 	}
 
+	// Make the entry visible to lookups which don't take the mutex (writer lock required)
+	static void publish_id(u32 type, id_manager::id_map::pointer place);
+
+	// Hide the entry from such lookups, wait for their readers and return the slot's reference (writer lock required)
+	static std::shared_ptr<void> retire_id(u32 type, id_manager::id_map::pointer place);
+
+	// Find the published slot and keep it from being retired until ctrl is decremented
+	template <typename T, typename Type>
+	static id_manager::id_slot* acquire_slot(u32 id)
+	{
+		static_assert(id_manager::id_verify<T, Type>::value, "Invalid ID type combination");
+
+		const u32 index = get_index<Type>(id);
+
+		if (index >= id_manager::id_traits<Type>::count)
+		{
+			return nullptr;
+		}
+
+		const auto chunk = g_tables[get_type<T>()].chunks[index / id_manager::id_table::chunk_size].load();
+
+		if (UNLIKELY(!chunk))
+		{
+			return nullptr;
+		}
+
+		auto& slot = chunk[index % id_manager::id_table::chunk_size];
+
+		// Counted blindly, a retiring writer only waits for the readers which saw the flag
+		if (!(slot.ctrl.fetch_add(1) & id_manager::id_slot::published))
+		{
+			slot.ctrl--;
+			return nullptr;
+		}
+
+		if (!std::is_same<T, Type>::value && slot.key.type() != get_type<Type>())
+		{
+			slot.ctrl--;
+			return nullptr;
+		}
+
+		return &slot;
+	}
+
 	// Allocate new ID and assign the object from the provider()
 	template <typename T, typename Type, typename F>
 	static id_manager::id_map::pointer create_id(F&& provider)
@@ -249,6 +330,8 @@ class idm
 		// ID traits
 		using traits = id_manager::id_traits<Type>;
 
+		static_assert(traits::count <= id_manager::id_table::chunk_size * id_manager::id_table::chunk_count, "ID traits: too many IDs");
+
 		// Allocate new id
 		std::lock_guard lock(id_manager::g_mutex);
 
@@ -259,6 +342,7 @@ class idm
 
 			if (place->second)
 			{
+				publish_id(get_type<T>(), place);
 				return place;
 			}
 		}
@@ -346,13 +430,18 @@ public:
 		return nullptr;
 	}
 
-	// Check the ID
+	// Check the ID (doesn't lock)
 	template <typename T, typename Get = T>
 	static inline Get* check(u32 id)
 	{
-		reader_lock lock(id_manager::g_mutex);
+		if (const auto slot = acquire_slot<T, Get>(id))
+		{
+			const auto ptr = static_cast<Get*>(slot->ptr.get());
+			slot->ctrl--;
+			return ptr;
+		}
 
-		return check_unlocked<T, Get>(id);
+		return nullptr;
 	}
 
 	// Check the ID, access object under shared lock
@@ -398,20 +487,20 @@ public:
 		return {found->second, static_cast<Get*>(found->second.get())};
 	}
 
-	// Get the object
+	// Get the object (doesn't lock)
 	template <typename T, typename Get = T>
 	static inline std::shared_ptr<Get> get(u32 id)
 	{
-		reader_lock lock(id_manager::g_mutex);
+		const auto slot = acquire_slot<T, Get>(id);
 
-		const auto found = find_id<T, Get>(id);
-
-		if (UNLIKELY(found == nullptr))
+		if (UNLIKELY(slot == nullptr))
 		{
 			return nullptr;
 		}
 
-		return {found->second, static_cast<Get*>(found->second.get())};
+		std::shared_ptr<Get> result{slot->ptr, static_cast<Get*>(slot->ptr.get())};
+		slot->ctrl--;
+		return result;
 	}
 
 	// Get the object, access object under reader lock
@@ -497,12 +586,13 @@ public:
 	template <typename T, typename Get = T>
 	static inline bool remove(u32 id)
 	{
-		std::shared_ptr<void> ptr;
+		std::shared_ptr<void> ptr, copy;
 		{
 			std::lock_guard lock(id_manager::g_mutex);
 
 			if (const auto found = find_id<T, Get>(id))
 			{
+				copy = retire_id(get_type<T>(), found);
 				ptr = std::move(found->second);
 			}
 			else
@@ -518,12 +608,13 @@ public:
 	template <typename T, typename Get = T>
 	static inline std::shared_ptr<Get> withdraw(u32 id)
 	{
-		std::shared_ptr<void> ptr;
+		std::shared_ptr<void> ptr, copy;
 		{
 			std::lock_guard lock(id_manager::g_mutex);
 
 			if (const auto found = find_id<T, Get>(id))
 			{
+				copy = retire_id(get_type<T>(), found);
 				ptr = std::move(found->second);
 			}
 			else
@@ -548,6 +639,7 @@ public:
 			if constexpr (std::is_void_v<FRT>)
 			{
 				func(*_ptr);
+				retire_id(get_type<T>(), found);
 				std::shared_ptr<void> ptr = std::move(found->second);
 				return {ptr, static_cast<Get*>(ptr.get())};
 			}
@@ -561,6 +653,7 @@ public:
 					return {{found->second, _ptr}, std::move(ret)};
 				}
 
+				retire_id(get_type<T>(), found);
 				std::shared_ptr<void> ptr = std::move(found->second);
 				return {{ptr, static_cast<Get*>(ptr.get())}, std::move(ret)};
 			}
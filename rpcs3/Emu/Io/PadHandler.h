@@ -493,6 +493,8 @@ public:
 	virtual std::vector<std::string> ListDevices() = 0;
 	//Callback called during pad_thread::ThreadFunc
 	virtual void ThreadProc() = 0;
+	//Adds file descriptors which become readable on new input (wakes pad_thread::ThreadFunc early)
+	virtual void GetEventDescriptors(std::vector<int>& /*fds*/) {}
 	//Binds a Pad to a device
 	virtual bool bindPadToDevice(std::shared_ptr<Pad> /*pad*/, const std::string& /*device*/) = 0;
 	virtual void init_config(pad_config* /*cfg*/, const std::string& /*name*/) = 0;
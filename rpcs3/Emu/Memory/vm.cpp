@@ -5,6 +5,7 @@
 #include "Utilities/Thread.h"
 #include "Utilities/VirtualMemory.h"
 #include "Utilities/asm.h"
+#include "Utilities/sysinfo.h"
 #include "Emu/CPU/CPUThread.h"
 #include "Emu/Cell/lv2/sys_memory.h"
 #include "Emu/RSX/GSRender.h"
@@ -45,12 +46,70 @@ namespace vm
 	// Reservation stats (compressed x16)
 	u8* const g_reservations = memory_reserve_4GiB((std::uintptr_t)g_stat_addr);
 
-	// Reservation sync variables
-	u8* const g_reservations2 = g_reservations + 0x10000000;
+	// Reservation sync variables (one per cache line to avoid false sharing)
+	alignas(64) static u8 s_reservation_waiters[reservation_waiter_count * 64]{};
+
+	u8* const g_reservations2 = s_reservation_waiters;
+
+	// Heat map counters (allocated on init if enabled)
+	static std::unique_ptr<atomic_t<u32>[]> s_heatmap;
+
+	atomic_t<u32>* g_heatmap = nullptr;
 
 	// Memory locations
 	std::vector<std::shared_ptr<block_t>> g_locations;
 
+	static const bool s_use_ssse3 =
+#ifdef _MSC_VER
+		utils::has_ssse3();
+#elif __SSSE3__
+		true;
+#else
+		false;
+#define _mm_shuffle_epi8
+#endif
+
+	void copy_swap(void* dst, const void* src, u32 size, u32 count)
+	{
+		auto d = static_cast<u8*>(dst);
+		auto s = static_cast<const u8*>(src);
+		u64 bytes = u64{size} * count;
+
+		const __m128i mask =
+			size == 2 ? _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1) :
+			size == 4 ? _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3) :
+			_mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+
+#ifdef __AVX2__
+		const __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+
+		for (; bytes >= 32; bytes -= 32, d += 32, s += 32)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)), mask256));
+		}
+#endif
+
+		if (LIKELY(s_use_ssse3))
+		{
+			for (; bytes >= 16; bytes -= 16, d += 16, s += 16)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), mask));
+			}
+		}
+
+		// Remaining elements (or everything without SSSE3)
+		for (; bytes >= size; bytes -= size, d += size, s += size)
+		{
+			switch (size)
+			{
+			case 2: *reinterpret_cast<u16*>(d) = se_storage<u16>::swap(*reinterpret_cast<const u16*>(s)); break;
+			case 4: *reinterpret_cast<u32*>(d) = se_storage<u32>::swap(*reinterpret_cast<const u32*>(s)); break;
+			case 8: *reinterpret_cast<u64*>(d) = se_storage<u64>::swap(*reinterpret_cast<const u64*>(s)); break;
+			default: fmt::throw_exception("Invalid element size (%u)" HERE, size);
+			}
+		}
+	}
+
 	// Memory mutex core
 	shared_mutex g_mutex;
 
@@ -60,33 +119,127 @@ namespace vm
 	// Currently locked address
 	atomic_t<u32> g_addr_lock = 0;
 
-	// Memory mutex: passive locks
-	std::array<atomic_t<cpu_thread*>, 4> g_locks{};
-	std::array<atomic_t<u64>, 6> g_range_locks{};
+	// Memory mutex: passive locks (one slot per thread)
+	std::array<atomic_t<cpu_thread*>, 384> g_locks{};
+	std::array<atomic_t<u64>, 384> g_range_locks{};
 
-	static void _register_lock(cpu_thread* _cpu)
+	// Allocation bits for passive lock slots (64 x N in total)
+	std::array<atomic_t<u64>, g_locks.size() / 64> g_lock_bits{};
+
+	// Passive lock slot owned by the current thread
+	static thread_local struct lock_slot
 	{
-		for (u32 i = 0;; i = (i + 1) % g_locks.size())
+		u32 index = -1;
+
+		~lock_slot()
 		{
-			if (!g_locks[i] && g_locks[i].compare_and_swap_test(nullptr, _cpu))
+			if (index < g_locks.size())
 			{
-				g_tls_locked = g_locks.data() + i;
-				return;
+				g_locks[index].release(nullptr);
+				g_range_locks[index].release(0);
+				g_lock_bits[index / 64] &= ~(1ull << (index % 64));
+			}
+		}
+	} g_tls_slot;
+
+	template <typename F>
+	static void _for_all_lock_slots(F&& func)
+	{
+		for (u32 i = 0; i < g_lock_bits.size(); i++)
+		{
+			for (u64 bits = g_lock_bits[i]; bits; bits &= bits - 1)
+			{
+				func(i * 64 + utils::cnttz64(bits, true));
+			}
+		}
+	}
+
+	static u32 _get_lock_slot()
+	{
+		if (LIKELY(g_tls_slot.index < g_locks.size()))
+		{
+			return g_tls_slot.index;
+		}
+
+		u64 wait_start = 0;
+
+		for (u32 i = 0;; i = (i + 1) % ::size32(g_lock_bits))
+		{
+			if (LIKELY(~g_lock_bits[i]))
+			{
+				const u64 found = g_lock_bits[i].atomic_op([](u64& bits) -> u64
+				{
+					// Find empty slot and set its bit
+					if (LIKELY(~bits))
+					{
+						const u64 bit = utils::cnttz64(~bits, true);
+						bits |= 1ull << bit;
+						return bit;
+					}
+
+					return 64;
+				});
+
+				if (LIKELY(found < 64))
+				{
+					return g_tls_slot.index = ::narrow<u32>(i * 64 + found);
+				}
+			}
+
+			if (i == g_lock_bits.size() - 1)
+			{
+				// All slots are owned by other threads, wait a bit for one of them to exit
+				if (!wait_start)
+				{
+					wait_start = get_system_time();
+					LOG_ERROR(MEMORY, "All %u passive lock slots are in use, waiting for a thread to exit", ::size32(g_locks));
+				}
+				else if (get_system_time() - wait_start > 1000000)
+				{
+					fmt::throw_exception("Passive lock slots exhausted (%u threads)" HERE, ::size32(g_locks));
+				}
+
+				std::this_thread::yield();
 			}
 		}
 	}
 
+	static void _register_lock(cpu_thread* _cpu)
+	{
+		const u32 slot = _get_lock_slot();
+
+		g_locks[slot] = _cpu;
+		g_tls_locked = g_locks.data() + slot;
+	}
+
 	static atomic_t<u64>* _register_range_lock(const u64 lock_info)
 	{
+		auto& lock = g_range_locks[_get_lock_slot()];
+
+		if (LIKELY(lock.compare_and_swap_test(0, lock_info)))
+		{
+			return &lock;
+		}
+
+		// Nested range lock: borrow a free slot (only owned slots are checked by writers)
 		while (true)
 		{
-			for (auto& lock : g_range_locks)
+			atomic_t<u64>* _ret = nullptr;
+
+			_for_all_lock_slots([&](u32 index)
 			{
-				if (!lock && lock.compare_and_swap_test(0, lock_info))
+				if (!_ret && !g_range_locks[index] && g_range_locks[index].compare_and_swap_test(0, lock_info))
 				{
-					return &lock;
+					_ret = &g_range_locks[index];
 				}
+			});
+
+			if (_ret)
+			{
+				return _ret;
 			}
+
+			std::this_thread::yield();
 		}
 	}
 
@@ -160,11 +313,11 @@ namespace vm
 
 	void cleanup_unlock(cpu_thread& cpu) noexcept
 	{
-		for (u32 i = 0; i < g_locks.size(); i++)
+		for (auto& lock : g_locks)
 		{
-			if (g_locks[i] == &cpu)
+			if (lock == &cpu)
 			{
-				g_locks[i].compare_and_swap_test(&cpu, nullptr);
+				lock.compare_and_swap_test(&cpu, nullptr);
 				return;
 			}
 		}
@@ -242,21 +395,21 @@ namespace vm
 
 		if (addr)
 		{
-			for (auto& lock : g_locks)
+			_for_all_lock_slots([](u32 index)
 			{
-				if (cpu_thread* ptr = lock)
+				if (cpu_thread* ptr = g_locks[index])
 				{
 					ptr->state.test_and_set(cpu_flag::memory);
 				}
-			}
+			});
 
 			g_addr_lock = addr;
 
-			for (auto& lock : g_range_locks)
+			_for_all_lock_slots([addr](u32 index)
 			{
 				while (true)
 				{
-					const u64 value = lock;
+					const u64 value = g_range_locks[index];
 
 					// Test beginning address
 					if (static_cast<u32>(value) > addr)
@@ -272,11 +425,11 @@ namespace vm
 
 					_mm_pause();
 				}
-			}
+			});
 
-			for (auto& lock : g_locks)
+			_for_all_lock_slots([](u32 index)
 			{
-				while (cpu_thread* ptr = lock)
+				while (cpu_thread* ptr = g_locks[index])
 				{
 					if (ptr->is_stopped())
 					{
@@ -285,7 +438,7 @@ namespace vm
 
 					_mm_pause();
 				}
-			}
+			});
 		}
 
 		if (cpu)
@@ -331,6 +484,20 @@ namespace vm
 	// Memory pages
 	std::array<memory_page, 0x100000000 / 4096> g_pages{};
 
+	// Apply the preferred NUMA node to host memory of the range (must precede first access)
+	static bool _numa_bind(u32 addr, u32 size)
+	{
+		const s64 node = g_cfg.core.numa_node;
+
+		if (node < 0)
+		{
+			return true;
+		}
+
+		return utils::memory_bind_node(g_base_addr + addr, size, static_cast<u32>(node)) &&
+			utils::memory_bind_node(g_sudo_addr + addr, size, static_cast<u32>(node));
+	}
+
 	static void _page_map(u32 addr, u8 flags, u32 size, utils::shm* shm)
 	{
 		if (!size || (size | addr) % 4096 || flags & page_allocated)
@@ -363,6 +530,11 @@ namespace vm
 		{
 			fmt::throw_exception("Memory mapping failed - blame Windows (addr=0x%x, size=0x%x, flags=0x%x)", addr, size, flags);
 		}
+		else
+		{
+			// New mapping replaced the policy set for the block
+			_numa_bind(addr, size);
+		}
 
 		if (flags & page_executable)
 		{
@@ -573,6 +745,12 @@ namespace vm
 		}
 	}
 
+	// Check if the block should be backed by huge pages (excluding stack and SPU areas)
+	static bool _use_huge_pages(u32 addr, u32 size, u64 flags)
+	{
+		return g_cfg.core.vm_huge_pages && !(flags & 0x10) && addr < 0xe0000000 && size >= 0x200000;
+	}
+
 	bool block_t::try_alloc(u32 addr, u8 flags, u32 size, std::shared_ptr<utils::shm>&& shm)
 	{
 		// Check if memory area is already mapped
@@ -597,17 +775,83 @@ namespace vm
 		// Map "real" memory pages
 		_page_map(page_addr, flags, page_size, shm.get());
 
+		if (shm && _use_huge_pages(this->addr, this->size, this->flags))
+		{
+			// New mapping replaced the advice set for the block
+			utils::memory_advise_huge(g_base_addr + page_addr, page_size);
+			utils::memory_advise_huge(g_sudo_addr + page_addr, page_size);
+		}
+
 		// Add entry
 		m_map[addr] = std::make_pair(size, std::move(shm));
+		free_remove(addr, size);
 
 		return true;
 	}
 
+	void block_t::free_insert(u32 addr, u32 size)
+	{
+		u64 end = u64{addr} + size;
+
+		const auto next = m_free.lower_bound(addr);
+
+		// Merge with the following range
+		if (next != m_free.end() && next->first == end)
+		{
+			end += next->second;
+			m_free.erase(next);
+		}
+
+		const auto upper = m_free.lower_bound(addr);
+
+		// Merge with the preceding range
+		if (upper != m_free.begin())
+		{
+			const auto prev = std::prev(upper);
+
+			if (u64{prev->first} + prev->second == addr)
+			{
+				addr = prev->first;
+				m_free.erase(prev);
+			}
+		}
+
+		size = ::narrow<u32>(end - addr);
+		m_free.emplace(addr, size);
+	}
+
+	void block_t::free_remove(u32 addr, u32 size)
+	{
+		const auto upper = m_free.upper_bound(addr);
+
+		verify("block_t::free_remove" HERE), upper != m_free.begin();
+
+		const auto found = std::prev(upper);
+		const u32 range_addr = found->first;
+		const u32 range_size = found->second;
+
+		verify("block_t::free_remove" HERE), u64{addr} + size <= u64{range_addr} + range_size;
+
+		m_free.erase(found);
+
+		if (const u32 before = addr - range_addr)
+		{
+			m_free.emplace(range_addr, before);
+		}
+
+		if (const u32 after = ::narrow<u32>(u64{range_addr} + range_size - addr - size))
+		{
+			m_free.emplace(addr + size, after);
+		}
+	}
+
 	block_t::block_t(u32 addr, u32 size, u64 flags)
 		: addr(addr)
 		, size(size)
 		, flags(flags)
 	{
+		free_insert(addr, size);
+
 		// Allocate compressed reservation info area (avoid SPU MMIO area)
 		if (addr != 0xe0000000)
 		{
@@ -615,11 +859,9 @@ namespace vm
 			if (addr == 0x10000)
 			{
 				utils::memory_commit(g_reservations, 0x1000);
-				utils::memory_commit(g_reservations2, 0x1000);
 			}
 
 			utils::memory_commit(g_reservations + addr / 16, size / 16);
-			utils::memory_commit(g_reservations2 + addr / 16, size / 16);
 		}
 		else
 		{
@@ -627,12 +869,10 @@ namespace vm
 			for (u32 i = 0; i < 6; i++)
 			{
 				utils::memory_commit(g_reservations + addr / 16 + i * 0x10000, 0x4000);
-				utils::memory_commit(g_reservations2 + addr / 16 + i * 0x10000, 0x4000);
 			}
 
 			// End of the address space
 			utils::memory_commit(g_reservations + 0xfff0000, 0x10000);
-			utils::memory_commit(g_reservations2 + 0xfff0000, 0x10000);
 		}
 
 		if (flags & 0x100)
@@ -642,10 +882,35 @@ namespace vm
 			verify(HERE), m_common->map_critical(vm::base(addr), utils::protection::no) == vm::base(addr);
 			verify(HERE), m_common->map_critical(vm::get_super_ptr(addr), utils::protection::rw) == vm::get_super_ptr(addr);
 		}
+		else if (_use_huge_pages(addr, size, flags))
+		{
+			// Back main, user and video memory with transparent huge pages (split back to 4k pages by mprotect if necessary)
+			// Allocations are shared memory mappings, advised again by try_alloc
+			if (!utils::memory_advise_huge(vm::base(addr), size) || !utils::memory_huge_shm_enabled())
+			{
+				LOG_WARNING(MEMORY, "Huge pages are not available for block 0x%x (size=0x%x), check transparent_hugepage/shmem_enabled", addr, size);
+			}
+		}
+
+		if (g_cfg.core.numa_node >= 0)
+		{
+			if (!_numa_bind(addr, size) || !utils::memory_bind_node(g_reservations + addr / 16, size / 16, static_cast<u32>(g_cfg.core.numa_node)))
+			{
+				LOG_WARNING(MEMORY, "Failed to set NUMA policy for block 0x%x (size=0x%x)", addr, size);
+			}
+		}
 	}
 
 	block_t::~block_t()
 	{
+		if (!m_common && _use_huge_pages(addr, size, flags))
+		{
+			if (const std::size_t huge = utils::memory_huge_size(vm::base(addr), size))
+			{
+				LOG_NOTICE(MEMORY, "Block 0x%x: %u MiB was backed by huge pages", addr, huge >> 20);
+			}
+		}
+
 		{
 			vm::writer_lock lock(0);
 
@@ -716,12 +981,17 @@ namespace vm
 		else
 			shm = std::make_shared<utils::shm>(size);
 
-		// Search for an appropriate place (unoptimized)
-		for (u32 addr = ::align(this->addr, align); u64{addr} + size <= u64{this->addr} + this->size; addr += align)
+		// Search for the lowest appropriate place, only looking at free ranges (same order as scanning the whole block)
+		for (const auto& [range_addr, range_size] : m_free)
 		{
-			if (try_alloc(addr, pflags, size, std::move(shm)))
+			const u64 range_end = u64{range_addr} + range_size;
+
+			for (u64 addr = ::align<u64>(range_addr, align); addr + size <= range_end; addr += align)
 			{
-				return addr + (flags & 0x10 ? 0x1000 : 0);
+				if (try_alloc(static_cast<u32>(addr), pflags, size, std::move(shm)))
+				{
+					return static_cast<u32>(addr) + (flags & 0x10 ? 0x1000 : 0);
+				}
 			}
 		}
 
@@ -810,6 +1080,7 @@ namespace vm
 			verify(HERE), size == _page_unmap(addr, size, found->second.second.get());
 
 			// Remove entry
+			free_insert(found->first, found->second.first);
 			m_map.erase(found);
 
 			return size;
@@ -1059,11 +1330,76 @@ namespace vm
 				std::make_shared<block_t>(0xD0000000, 0x10000000, 0x111), // stack
 				std::make_shared<block_t>(0xE0000000, 0x20000000), // SPU reserved
 			};
+
+			if (g_cfg.core.memory_heatmap)
+			{
+				s_heatmap = std::make_unique<atomic_t<u32>[]>(0x10000);
+				g_heatmap = s_heatmap.get();
+			}
+		}
+	}
+
+	static void heatmap_save()
+	{
+		std::string out = "Memory access heat map (samples per 64K page)\n\n";
+
+		for (auto& block : g_locations)
+		{
+			if (!block)
+			{
+				continue;
+			}
+
+			u64 total = 0;
+
+			for (u32 i = block->addr >> 16; i < (u64{block->addr} + block->size) >> 16; i++)
+			{
+				total += g_heatmap[i];
+			}
+
+			fmt::append(out, "Block 0x%08x..0x%08x: %llu\n", block->addr, block->addr + block->size - 1, total);
+		}
+
+		std::vector<std::pair<u32, u32>> pages;
+
+		for (u32 i = 0; i < 0x10000; i++)
+		{
+			if (const u32 count = g_heatmap[i])
+			{
+				pages.emplace_back(count, i);
+			}
+		}
+
+		std::sort(pages.begin(), pages.end(), std::greater<>());
+
+		out += "\n";
+
+		for (auto& page : pages)
+		{
+			fmt::append(out, "0x%08x: %u\n", page.second << 16, page.first);
 		}
+
+		const std::string path = fs::get_cache_dir() + "heatmap/";
+		const std::string name = Emu.GetTitleID().empty() ? "unknown" : Emu.GetTitleID();
+
+		if (!fs::create_path(path) || !fs::write_file(path + name + ".txt", fs::rewrite, out))
+		{
+			LOG_ERROR(MEMORY, "Failed to save memory heat map (%s)", fs::g_tls_error);
+			return;
+		}
+
+		LOG_NOTICE(MEMORY, "Memory heat map saved: %u pages accessed", pages.size());
 	}
 
 	void close()
 	{
+		if (g_heatmap)
+		{
+			heatmap_save();
+			g_heatmap = nullptr;
+			s_heatmap.reset();
+		}
+
 		g_locations.clear();
 
 		utils::memory_decommit(g_base_addr, 0x100000000);
@@ -18,6 +18,12 @@ namespace vm
 	extern u8* const g_reservations;
 	extern u8* const g_reservations2;
 
+	// Size of reservation sync variable table (hashed by reservation line)
+	constexpr u32 reservation_waiter_count = 4096;
+
+	// Guest memory access counters per 64K page (null if the heat map is disabled)
+	extern atomic_t<u32>* g_heatmap;
+
 	enum memory_location_t : uint
 	{
 		main,
@@ -101,10 +107,24 @@ namespace vm
 		reservation_acquire(addr, size) += 128;
 	}
 
-	// Get reservation sync variable
+	// Get reservation sync variable (shared by lines with the same hash, waiters must recheck their condition)
 	inline shared_cond& reservation_notifier(u32 addr, u32 size)
 	{
-		return *reinterpret_cast<shared_cond*>(g_reservations2 + addr / 128 * 8);
+		return *reinterpret_cast<shared_cond*>(g_reservations2 + (addr / 128 % reservation_waiter_count) * 64);
+	}
+
+	// Count guest memory access for the heat map
+	inline void heatmap_sample(u32 addr, u32 size = 1)
+	{
+		if (UNLIKELY(g_heatmap))
+		{
+			const u32 last = static_cast<u32>((u64{addr} + (size ? size - 1 : 0)) >> 16);
+
+			for (u32 i = addr >> 16; i <= last && i < 0x10000; i++)
+			{
+				g_heatmap[i]++;
+			}
+		}
 	}
 
 	void reservation_lock_internal(atomic_t<u64>&);
@@ -148,6 +168,15 @@ namespace vm
 		// Common mapped region for special cases
 		std::shared_ptr<utils::shm> m_common;
 
+		// Free ranges: addr -> size
+		std::map<u32, u32> m_free;
+
+		// Return range to the free ranges (merging it with adjacent ones)
+		void free_insert(u32 addr, u32 size);
+
+		// Remove range from the free range containing it
+		void free_remove(u32 addr, u32 size);
+
 		bool try_alloc(u32 addr, u8 flags, u32 size, std::shared_ptr<utils::shm>&&);
 
 	public:
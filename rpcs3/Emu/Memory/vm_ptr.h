@@ -308,6 +308,25 @@ namespace vm
 		}
 	}
 
+	// Copy count elements of given size (2, 4 or 8) reversing byte order of each (vectorized, buffers must not overlap)
+	void copy_swap(void* dst, const void* src, u32 size, u32 count);
+
+	// Copy array of BE elements (usually from guest memory) to native array
+	template<typename T>
+	inline void copy_from_be(T* dst, const be_t<T>* src, u32 count)
+	{
+		static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "vm::copy_from_be<> error: invalid type size");
+		copy_swap(dst, src, sizeof(T), count);
+	}
+
+	// Copy native array to array of BE elements (usually in guest memory)
+	template<typename T>
+	inline void copy_to_be(be_t<T>* dst, const T* src, u32 count)
+	{
+		static_assert(sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "vm::copy_to_be<> error: invalid type size");
+		copy_swap(dst, src, sizeof(T), count);
+	}
+
 	struct null_t
 	{
 		template<typename T, typename AT>
@@ -464,6 +483,9 @@ template<>
 struct fmt_class_string<vm::_ptr_base<const char>, void>
 {
 	static void format(std::string& out, u64 arg);
+
+	// The string is read from guest memory while formatting
+	static constexpr bool is_indirect = true;
 };
 
 template<>
@@ -8,32 +8,244 @@
 #include "Emu/Memory/vm.h"
 
 #include "xxhash.h"
+#include <zlib.h>
+#include <cereal/archives/binary.hpp>
+#include <sstream>
 
 namespace rsx
 {
 	namespace capture
 	{
+		namespace
+		{
+			// Granularity of the memory diff between snapshots
+			constexpr u32 page_size = 4096;
+
+			// Replay commands are small, batch them so that every record is worth compressing
+			constexpr size_t replay_command_batch_size = 4096;
+
+			struct capture_stream
+			{
+				fs::file file;
+				// data hash -> hash of the same data with another seed, this catches collisions without keeping the data around
+				std::unordered_map<u64, u64> data_index;
+				// page address -> hash of its contents in the last snapshot that covered the whole page
+				std::unordered_map<u32, u64> page_state;
+				std::vector<u8> compressed;
+				u64 raw_bytes = 0;
+				u64 stored_bytes = 0;
+			};
+
+			capture_stream& get_capture_stream()
+			{
+				static capture_stream s_stream;
+				return s_stream;
+			}
+
+			void write_record(capture_record_type type, u64 key, const void* data, size_t size)
+			{
+				auto& stream = get_capture_stream();
+				if (!stream.file)
+					fmt::throw_exception("Capture stream is not open" HERE);
+
+				capture_record_header header = {};
+				header.type = type;
+				header.raw_size = ::narrow<u32>(size, "capture record size" HERE);
+				header.key = key;
+
+				uLongf stored_size = compressBound(static_cast<uLong>(size));
+				stream.compressed.resize(stored_size);
+
+				// Fastest level, this runs on the rsx thread while the frame is being captured
+				const void* payload = data;
+				if (compress2(stream.compressed.data(), &stored_size, static_cast<const Bytef*>(data), static_cast<uLong>(size), Z_BEST_SPEED) == Z_OK && stored_size < size)
+				{
+					header.stored_size = static_cast<u32>(stored_size);
+					payload = stream.compressed.data();
+				}
+				else
+				{
+					header.stored_size = header.raw_size;
+				}
+
+				stream.file.write(header);
+				stream.file.write(payload, header.stored_size);
+
+				stream.raw_bytes += header.raw_size;
+				stream.stored_bytes += header.stored_size;
+			}
+
+			template <typename... Args>
+			void write_archive_record(capture_record_type type, Args&... args)
+			{
+				std::stringstream os;
+				cereal::BinaryOutputArchive archive(os);
+				archive(args...);
+
+				const std::string data = os.str();
+				write_record(type, 0, data.data(), data.size());
+			}
+		}
+
+		bool begin_capture_stream(const std::string& path)
+		{
+			auto& stream = get_capture_stream();
+			stream.data_index.clear();
+			stream.page_state.clear();
+			stream.raw_bytes = 0;
+			stream.stored_bytes = 0;
+
+			if (!stream.file.open(path, fs::rewrite))
+			{
+				LOG_ERROR(RSX, "Failed to create capture file %s", path);
+				return false;
+			}
+
+			capture_file_header header;
+			header.magic = FRAME_CAPTURE_MAGIC;
+			header.version = FRAME_CAPTURE_VERSION;
+			stream.file.write(header);
+
+			write_archive_record(capture_record_type::initial_state, frame_capture.reg_state);
+			return true;
+		}
+
+		void flush_replay_commands(bool force)
+		{
+			auto& commands = frame_capture.replay_commands;
+			if (commands.empty() || (!force && commands.size() < replay_command_batch_size))
+			{
+				return;
+			}
+
+			if (force)
+			{
+				write_archive_record(capture_record_type::replay_commands, commands);
+				commands.clear();
+				return;
+			}
+
+			// Memory state is attached to the last issued command, keep it around until the next one arrives
+			std::vector<frame_capture_data::replay_command> batch(std::make_move_iterator(commands.begin()), std::make_move_iterator(commands.end() - 1));
+			commands.erase(commands.begin(), commands.end() - 1);
+
+			write_archive_record(capture_record_type::replay_commands, batch);
+		}
+
+		bool end_capture_stream()
+		{
+			auto& stream = get_capture_stream();
+			if (!stream.file)
+			{
+				return false;
+			}
+
+			flush_replay_commands(true);
+			write_archive_record(capture_record_type::state_tables, frame_capture.tile_map, frame_capture.memory_map, frame_capture.display_buffers_map);
+
+			LOG_NOTICE(RSX, "Capture stream closed: %llu unique memory blocks, %llu bytes stored as %llu bytes", stream.data_index.size(), stream.raw_bytes, stream.stored_bytes);
+
+			stream.file.close();
+			stream.data_index.clear();
+			stream.page_state.clear();
+			return true;
+		}
+
+		void insert_data_block(std::unordered_set<u64>& mem_changes, frame_capture_data::memory_block block, const u8* data, u32 size)
+		{
+			u64 data_hash = XXH64(data, size, 0);
+			block.data_state = data_hash;
+
+			auto& stream = get_capture_stream();
+			const u64 check_hash = XXH64(data, size, 1);
+
+			auto it = stream.data_index.find(data_hash);
+			if (it != stream.data_index.end())
+			{
+				if (it->second != check_hash)
+					// screw this
+					fmt::throw_exception("Memory map hash collision detected...cant capture");
+			}
+			else
+			{
+				// Only the hash stays in memory, the data goes straight to disk
+				stream.data_index.emplace(data_hash, check_hash);
+				write_record(capture_record_type::memory_data, data_hash, data, size);
+			}
+
+			u64 block_hash = XXH64(&block, sizeof(frame_capture_data::memory_block), 0);
+			mem_changes.insert(block_hash);
+			if (frame_capture.memory_map.find(block_hash) == frame_capture.memory_map.end())
+				frame_capture.memory_map.insert(std::make_pair(block_hash, block));
+		}
+
 		void insert_mem_block_in_map(std::unordered_set<u64>& mem_changes, frame_capture_data::memory_block&& block, frame_capture_data::memory_block_data&& data)
 		{
-			if (!data.data.empty())
+			if (data.data.empty())
+				return;
+
+			// Only pages that differ from their last snapshot are stored, the replay applies snapshots in
+			// capture order so memory still holds the last snapshot of every page that was skipped
+			auto& page_state = get_capture_stream().page_state;
+			const u32 base_address = get_address(block.offset, block.location);
+			const u32 size = ::size32(data.data);
+			const u8* src = data.data.data();
+
+			u32 run_start = 0;
+			u32 run_end = 0;
+
+			for (u32 pos = 0; pos < size;)
 			{
-				u64 data_hash = XXH64(data.data.data(), data.data.size(), 0);
-				block.data_state = data_hash;
+				const u32 page = (base_address + pos) & ~(page_size - 1);
+				const u32 chunk_end = std::min(page + page_size - base_address, size);
 
-				auto it = frame_capture.memory_data_map.find(data_hash);
-				if (it != frame_capture.memory_data_map.end())
+				bool changed = true;
+				if (chunk_end - pos == page_size)
 				{
-					if (it->second.data != data.data)
-						// screw this
-						fmt::throw_exception("Memory map hash collision detected...cant capture");
+					const u64 page_hash = XXH64(src + pos, page_size, 0);
+					auto found = page_state.find(page);
+
+					if (found == page_state.end())
+					{
+						page_state.emplace(page, page_hash);
+					}
+					else if (found->second == page_hash)
+					{
+						changed = false;
+					}
+					else
+					{
+						found->second = page_hash;
+					}
 				}
 				else
-					frame_capture.memory_data_map.insert(std::make_pair(data_hash, std::move(data)));
+				{
+					// Partially covered pages are always stored, the rest of the page is no longer known
+					page_state.erase(page);
+				}
+
+				if (changed)
+				{
+					if (run_end != pos)
+						run_start = pos;
+
+					run_end = chunk_end;
+				}
+				else if (run_end > run_start)
+				{
+					frame_capture_data::memory_block run = block;
+					run.offset += run_start;
+					insert_data_block(mem_changes, run, src + run_start, run_end - run_start);
+					run_start = run_end;
+				}
 
-				u64 block_hash = XXH64(&block, sizeof(frame_capture_data::memory_block), 0);
-				mem_changes.insert(block_hash);
-				if (frame_capture.memory_map.find(block_hash) == frame_capture.memory_map.end())
-					frame_capture.memory_map.insert(std::make_pair(block_hash, std::move(block)));
+				pos = chunk_end;
+			}
+
+			if (run_end > run_start)
+			{
+				block.offset += run_start;
+				insert_data_block(mem_changes, block, src + run_start, run_end - run_start);
 			}
 		}
 
@@ -6,6 +6,13 @@ namespace rsx
 	class thread;
 	namespace capture
 	{
+		// Opens the capture file, memory data and replay commands are streamed into it while the frame is captured
+		bool begin_capture_stream(const std::string& path);
+		// Writes out finished replay commands once enough have been queued, the last command can still receive state
+		void flush_replay_commands(bool force = false);
+		// Writes the remaining commands and the state tables and closes the file
+		bool end_capture_stream();
+
 		void capture_draw_memory(thread* rsx);
 		void capture_image_in(thread* rsx, frame_capture_data::replay_command& replay_command);
 		void capture_buffer_notify(thread* rsx, frame_capture_data::replay_command& replay_command);
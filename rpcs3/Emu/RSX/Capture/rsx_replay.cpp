@@ -6,12 +6,122 @@
 #include "Emu/Cell/lv2/sys_memory.h"
 #include "Emu/Memory/vm.h"
 #include "Emu/RSX/GSRender.h"
+#include "Utilities/zlib_util.h"
 
 #include <map>
 #include <exception>
+#include <sstream>
+#include <cereal/archives/binary.hpp>
 
 namespace rsx
 {
+	bool frame_capture_reader::read_payload(const capture_record_header& header, std::vector<u8>& data)
+	{
+		data.resize(header.raw_size);
+
+		if (header.stored_size == header.raw_size)
+		{
+			return m_file.read(data.data(), header.raw_size) == header.raw_size;
+		}
+
+		m_stored.resize(header.stored_size);
+		if (m_file.read(m_stored.data(), header.stored_size) != header.stored_size)
+		{
+			return false;
+		}
+
+		return utils::zlib_decompress(data.data(), header.raw_size, m_stored.data(), header.stored_size);
+	}
+
+	bool frame_capture_reader::open(const std::string& path, frame_capture_data& frame)
+	{
+		m_data_index.clear();
+
+		if (!m_file.open(path))
+		{
+			return false;
+		}
+
+		capture_file_header file_header;
+		if (!m_file.read(file_header) || file_header.magic != FRAME_CAPTURE_MAGIC || file_header.version != FRAME_CAPTURE_VERSION)
+		{
+			return false;
+		}
+
+		frame.magic = file_header.magic;
+		frame.version = file_header.version;
+
+		std::vector<u8> payload;
+		capture_record_header header;
+
+		while (m_file.read(header))
+		{
+			if (header.type == capture_record_type::memory_data)
+			{
+				// Only index the data here, it is read back when a command needs it
+				m_data_index[header.key] = { m_file.pos(), header.raw_size, header.stored_size };
+				m_file.seek(header.stored_size, fs::seek_cur);
+				continue;
+			}
+
+			if (!read_payload(header, payload))
+			{
+				LOG_ERROR(LOADER, "Rsx capture record could not be read (type=%u)", static_cast<u32>(header.type));
+				return false;
+			}
+
+			std::istringstream is(std::string(reinterpret_cast<const char*>(payload.data()), payload.size()));
+			cereal::BinaryInputArchive archive(is);
+
+			switch (header.type)
+			{
+			case capture_record_type::initial_state:
+			{
+				archive(frame.reg_state);
+				break;
+			}
+			case capture_record_type::replay_commands:
+			{
+				std::vector<frame_capture_data::replay_command> batch;
+				archive(batch);
+				frame.replay_commands.insert(frame.replay_commands.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+				break;
+			}
+			case capture_record_type::state_tables:
+			{
+				archive(frame.tile_map, frame.memory_map, frame.display_buffers_map);
+				LOG_NOTICE(LOADER, "Rsx capture loaded: %u commands, %u memory blocks", frame.replay_commands.size(), m_data_index.size());
+				return true;
+			}
+			default:
+				LOG_ERROR(LOADER, "Unknown rsx capture record type %u", static_cast<u32>(header.type));
+				return false;
+			}
+		}
+
+		// The state tables are written when the capture ends, without them the file was cut short
+		LOG_ERROR(LOADER, "Rsx capture file is truncated");
+		return false;
+	}
+
+	bool frame_capture_reader::read_memory_data(u64 data_hash, std::vector<u8>& data)
+	{
+		const auto found = m_data_index.find(data_hash);
+		if (found == m_data_index.end())
+		{
+			return false;
+		}
+
+		capture_record_header header = {};
+		header.type = capture_record_type::memory_data;
+		header.raw_size = found->second.raw_size;
+		header.stored_size = found->second.stored_size;
+		header.key = data_hash;
+
+		m_file.seek(found->second.offset);
+		return read_payload(header, data);
+	}
+
 	be_t<u32> rsx_replay_thread::allocate_context()
 	{
 		u32 buffer_size = 4;
@@ -110,12 +220,16 @@ namespace rsx
 				fmt::throw_exception("requested memory state for command not found in memory_map");
 
 			const auto& memblock = it->second;
+			const std::vector<u8>* data_block = &memory_data;
+
+			// Legacy captures keep all memory data in memory, streamed captures read it from the file
 			auto it_data = frame->memory_data_map.find(it->second.data_state);
-			if (it_data == frame->memory_data_map.end())
+			if (it_data != frame->memory_data_map.end())
+				data_block = &it_data->second.data;
+			else if (!reader || !reader->read_memory_data(it->second.data_state, memory_data))
 				fmt::throw_exception("requested memory data state for command not found in memory_data_map");
 
-			const auto& data_block = it_data->second;
-			std::memcpy(vm::base(get_address(memblock.offset, memblock.location)), data_block.data.data(), data_block.data.size());
+			std::memcpy(vm::base(get_address(memblock.offset, memblock.location)), data_block->data(), data_block->size());
 		}
 
 		if (replay_cmd.display_buffer_state != 0 && replay_cmd.display_buffer_state != cs.display_buffer_hash)
@@ -175,18 +289,28 @@ namespace rsx
 
 		auto fifo_stops = alloc_write_fifo(context_id);
 
+		u32 iteration = 0;
+		u64 last_frame_timestamp = get_system_time();
+		u64 last_frame_idle_time = get_current_renderer()->performance_counters.idle_time;
+		std::vector<frame_benchmark_stats> frame_stats;
+
+		if (benchmark.iterations)
+		{
+			LOG_NOTICE(RSX, "Capture Replay: benchmarking %u iterations", benchmark.iterations);
+		}
+
 		while (!Emu.IsStopped())
 		{
 			// Load registers while the RSX is still idle
 			method_registers = frame->reg_state;
 			_mm_mfence();
 
-			// start up fifo buffer by dumping the put ptr to first stop
-			sys_rsx_context_attribute(context_id, 0x001, 0x10000000, fifo_stops[0], 0, 0);
-
 			auto render = get_current_renderer();
 			auto last_flip = render->int_flip_index;
 
+			// start up fifo buffer by dumping the put ptr to first stop
+			sys_rsx_context_attribute(context_id, 0x001, 0x10000000, fifo_stops[0], 0, 0);
+
 			size_t stopIdx = 0;
 			for (const auto& replay_cmd : frame->replay_commands)
 			{
@@ -236,11 +360,106 @@ namespace rsx
 				render->request_emu_flip(1u);
 			}
 
+			if (benchmark.iterations)
+			{
+				// Requested flips are handled asynchronously, wait until the counters of the last frame are published
+				const u64 last_frame_index = std::max<u64>(render->int_flip_index, last_flip + 1);
+				while (!Emu.IsStopped())
+				{
+					render->take_frame_benchmark_stats(frame_stats);
+
+					if (!frame_stats.empty() && frame_stats.back().frame_index >= last_frame_index)
+						break;
+
+					std::this_thread::yield();
+				}
+
+				if (Emu.IsStopped())
+					break;
+
+				// Captures of several frames contain several flips, every one of them gets its own row
+				for (const auto& stats : frame_stats)
+				{
+					const u64 frame_time = stats.timestamp - last_frame_timestamp;
+					const u64 idle_time = stats.idle_time - last_frame_idle_time;
+					benchmark_frames.push_back({ iteration, frame_time, frame_time - std::min(idle_time, frame_time), stats });
+
+					last_frame_timestamp = stats.timestamp;
+					last_frame_idle_time = stats.idle_time;
+				}
+
+				frame_stats.clear();
+
+				if (++iteration == benchmark.iterations)
+				{
+					write_benchmark_results();
+
+					Emu.CallAfter([]()
+					{
+						// Benchmarks are started from the command line, leave once the results are out
+						Emu.Stop();
+
+						if (!g_cfg.misc.autoexit)
+						{
+							Emu.GetCallbacks().exit();
+						}
+					});
+					break;
+				}
+
+				// No pause between frames, the results would include it
+				continue;
+			}
+
 			// random pause to not destroy gpu
 			std::this_thread::sleep_for(10ms);
 		}
 	}
 
+	void rsx_replay_thread::write_benchmark_results()
+	{
+		const std::string path = benchmark.output_path.empty() ? fs::get_cache_dir() + "rsx_benchmark.csv" : benchmark.output_path;
+
+		fs::file out(path, fs::rewrite);
+		if (!out)
+		{
+			LOG_ERROR(RSX, "Capture Replay: failed to create the benchmark results file %s", path);
+		}
+		else
+		{
+			out.write("iteration,frame,frame_time_us,rsx_busy_us,gpu_time_ms,draw_calls,pipelines_compiled,"
+				"texture_uploads,texture_upload_bytes,texture_hits,texture_misses,texture_flushes,texture_memory_bytes\n");
+		}
+
+		u64 total_time = 0;
+		u64 total_busy_time = 0;
+		u64 min_time = UINT64_MAX;
+		u64 max_time = 0;
+		u64 total_pipelines = 0;
+
+		for (u32 i = 0; i < benchmark_frames.size(); ++i)
+		{
+			const auto& result = benchmark_frames[i];
+			const auto& stats = result.stats;
+
+			total_time += result.frame_time;
+			total_busy_time += result.rsx_busy_time;
+			min_time = std::min(min_time, result.frame_time);
+			max_time = std::max(max_time, result.frame_time);
+			total_pipelines += stats.pipelines_compiled;
+
+			if (out)
+			{
+				out.write(fmt::format("%u,%u,%llu,%llu,%.3f,%u,%u,%u,%llu,%u,%u,%u,%llu\n", result.iteration, i, result.frame_time, result.rsx_busy_time, stats.gpu_time_ms, stats.draw_calls, stats.pipelines_compiled,
+					stats.texture_uploads, stats.texture_upload_bytes, stats.texture_hits, stats.texture_misses, stats.texture_flushes, stats.texture_memory));
+			}
+		}
+
+		const size_t count = std::max<size_t>(benchmark_frames.size(), 1);
+		LOG_SUCCESS(RSX, "Capture Replay: %u frames in %u iterations, average %lluus (min %lluus, max %lluus), rsx busy %lluus, %llu pipeline(s) compiled, results written to %s",
+			benchmark_frames.size(), benchmark.iterations, total_time / count, min_time, max_time, total_busy_time / count, total_pipelines, path);
+	}
+
 	void rsx_replay_thread::operator()()
 	{
 		try
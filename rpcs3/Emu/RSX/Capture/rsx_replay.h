@@ -15,7 +15,10 @@
 namespace rsx
 {
 	constexpr u32 FRAME_CAPTURE_MAGIC = 0x52524300; // ascii 'RRC/0'
-	constexpr u32 FRAME_CAPTURE_VERSION = 0x4;
+	constexpr u32 FRAME_CAPTURE_VERSION = 0x5;
+	// Version 4 captures are a single cereal archive, they are still accepted for replay
+	constexpr u32 FRAME_CAPTURE_LEGACY_VERSION = 0x4;
+
 	struct frame_capture_data
 	{
 		struct memory_block_data
@@ -177,12 +180,84 @@ namespace rsx
 			version = FRAME_CAPTURE_VERSION;
 			tile_map.clear();
 			memory_map.clear();
+			memory_data_map.clear();
+			display_buffers_map.clear();
 			replay_commands.clear();
 			reg_state = method_registers;
 		}
 	};
 
 
+	// Streamed captures start with this header and are followed by records, every record is
+	// deflated on its own so memory blocks can be written as they are seen and read back individually
+	struct capture_file_header
+	{
+		u32 magic;
+		u32 version;
+	};
+
+	enum class capture_record_type : u32
+	{
+		initial_state = 1,   // reg_state
+		memory_data = 2,     // raw memory block data, key is the data hash
+		replay_commands = 3, // a batch of replay commands
+		state_tables = 4,    // tile_map, memory_map and display_buffers_map, always the last record
+	};
+
+	struct capture_record_header
+	{
+		capture_record_type type;
+		u32 raw_size;
+		u32 stored_size; // equal to raw_size when the payload is stored uncompressed
+		u32 reserved;
+		u64 key;
+	};
+
+	// Loads everything but the memory data of a streamed capture, memory data is only indexed and read on demand
+	class frame_capture_reader
+	{
+		struct data_record
+		{
+			u64 offset;
+			u32 raw_size;
+			u32 stored_size;
+		};
+
+		fs::file m_file;
+		std::unordered_map<u64, data_record> m_data_index;
+		std::vector<u8> m_stored;
+
+		bool read_payload(const capture_record_header& header, std::vector<u8>& data);
+
+	public:
+		bool open(const std::string& path, frame_capture_data& frame);
+		bool read_memory_data(u64 data_hash, std::vector<u8>& data);
+	};
+
+	// Counters of one emulated frame, published at the end of every emulated flip for the capture replay benchmark
+	struct frame_benchmark_stats
+	{
+		u64 frame_index = 0; // int_flip_index of the flip
+		u64 timestamp = 0;   // us, taken at the end of the flip
+		u64 idle_time = 0;   // Total rsx idle time at the end of the flip
+		u32 draw_calls = 0;
+		u32 pipelines_compiled = 0;
+		f32 gpu_time_ms = 0.f; // Zero when the GPU profiler is not running
+		u32 texture_uploads = 0;
+		u64 texture_upload_bytes = 0;
+		u32 texture_hits = 0;
+		u32 texture_misses = 0;
+		u32 texture_flushes = 0;
+		u64 texture_memory = 0;
+	};
+
+	struct replay_benchmark_settings
+	{
+		u32 iterations = 0;      // Zero replays the capture interactively until the emulator is stopped
+		bool null_present = false;
+		std::string output_path; // Defaults to rsx_benchmark.csv in the cache directory
+	};
+
 	class rsx_replay_thread
 	{
 		struct rsx_context
@@ -205,13 +280,27 @@ namespace rsx
 			frame_capture_data::tile_state tile_state;
 		};
 
+		struct benchmark_frame
+		{
+			u32 iteration;
+			u64 frame_time;     // us since the previous flip
+			u64 rsx_busy_time;  // us of the above the rsx thread did not spend idling
+			frame_benchmark_stats stats;
+		};
+
 		u32 user_mem_addr;
 		current_state cs;
 		std::unique_ptr<frame_capture_data> frame;
+		std::unique_ptr<frame_capture_reader> reader;
+		std::vector<u8> memory_data;
+		replay_benchmark_settings benchmark;
+		std::vector<benchmark_frame> benchmark_frames;
 
 	public:
-		rsx_replay_thread(std::unique_ptr<frame_capture_data>&& frame_data)
+		rsx_replay_thread(std::unique_ptr<frame_capture_data>&& frame_data, std::unique_ptr<frame_capture_reader>&& frame_reader = nullptr, const replay_benchmark_settings& benchmark_settings = {})
 			:frame(std::move(frame_data))
+			,reader(std::move(frame_reader))
+			,benchmark(benchmark_settings)
 		{
 		}
 
@@ -221,5 +310,6 @@ namespace rsx
 		be_t<u32> allocate_context();
 		std::vector<u32> alloc_write_fifo(be_t<u32> context_id);
 		void apply_frame_state(be_t<u32> context_id, const frame_capture_data::replay_command& replay_cmd);
+		void write_benchmark_results();
 	};
 }
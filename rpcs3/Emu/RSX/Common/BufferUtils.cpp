@@ -2,8 +2,12 @@
 #include "BufferUtils.h"
 #include "../rsx_methods.h"
 #include "Utilities/sysinfo.h"
+#include "Utilities/Thread.h"
+#include "Emu/IdManager.h"
+#include "Emu/System.h"
 
 #include <limits>
+#include <functional>
 
 #define DEBUG_VERTEX_STREAMING 0
 
@@ -17,6 +21,15 @@ const bool s_use_ssse3 =
 #define _mm_shuffle_epi8
 #endif
 
+const bool s_use_avx2 = utils::has_avx2();
+
+// AVX2 kernels are selected at runtime, enable the instruction set per function where the compiler needs it
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((__target__("avx2")))
+#endif
+
 namespace
 {
 	// FIXME: GSL as_span break build if template parameter is non const with current revision.
@@ -34,6 +47,150 @@ namespace
 	}
 }
 
+namespace
+{
+	// Minimum element count before a conversion is split across the helper threads
+	constexpr u32 parallel_conversion_threshold = 0x10000;
+
+	// Range of elements shared between the RSX thread and the helper threads
+	struct conversion_job
+	{
+		const std::function<void(u32, u32)>& func;
+		const u32 total;
+		const u32 chunk;
+		atomic_t<u32> next{0};
+
+		bool run_one()
+		{
+			const u32 first = next.fetch_add(chunk);
+
+			if (first >= total)
+			{
+				return false;
+			}
+
+			func(first, std::min(chunk, total - first));
+			return true;
+		}
+	};
+
+	class buffer_conversion_pool
+	{
+		struct worker
+		{
+			buffer_conversion_pool* pool;
+
+			void operator()()
+			{
+				while (thread_ctrl::state() != thread_state::aborting)
+				{
+					{
+						reader_lock lock(pool->m_mutex);
+
+						if (const auto job = pool->m_job)
+						{
+							while (job->run_one());
+						}
+					}
+
+					thread_ctrl::wait();
+				}
+			}
+		};
+
+		// Readers are workers busy with the current job
+		shared_mutex m_mutex;
+		conversion_job* m_job = nullptr;
+
+		std::vector<std::unique_ptr<named_thread<worker>>> m_workers;
+
+	public:
+		buffer_conversion_pool()
+		{
+			for (u32 i = 0; i < g_cfg.video.buffer_conversion_threads; i++)
+			{
+				m_workers.emplace_back(std::make_unique<named_thread<worker>>(fmt::format("RSX Buffer Conversion %u", i), worker{this}));
+			}
+		}
+
+		u32 size() const
+		{
+			return ::size32(m_workers);
+		}
+
+		// Process [0, total) in chunks, the calling thread takes part and returns once every chunk is written
+		void run(u32 total, u32 chunk, const std::function<void(u32, u32)>& func)
+		{
+			conversion_job job{func, total, chunk};
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_job = &job;
+			}
+
+			for (auto& thread : m_workers)
+			{
+				thread_ctrl::notify(*thread);
+			}
+
+			while (job.run_one());
+
+			// Wait for the workers still writing their last chunk
+			std::lock_guard lock(m_mutex);
+			m_job = nullptr;
+		}
+	};
+
+	/**
+	 * Split func(first, count) over [0, total) between the RSX thread and the helper threads.
+	 * Chunk boundaries are multiples of granularity. Returns false if nothing was done.
+	 */
+	bool parallel_conversion(u32 total, u32 granularity, const std::function<void(u32, u32)>& func)
+	{
+		if (total < parallel_conversion_threshold || !g_cfg.video.buffer_conversion_threads)
+		{
+			return false;
+		}
+
+		const auto pool = fxm::get_always<buffer_conversion_pool>();
+
+		if (!pool->size())
+		{
+			return false;
+		}
+
+		// A few chunks per thread keep the load balanced when a worker starts late
+		const u32 chunk = ::align(total / ((pool->size() + 1) * 4), granularity);
+		pool->run(total, chunk, func);
+		return true;
+	}
+}
+
+bool run_conversion_tasks(u32 count, const std::function<void(u32)>& func)
+{
+	if (count < 2 || !g_cfg.video.buffer_conversion_threads)
+	{
+		return false;
+	}
+
+	const auto pool = fxm::get_always<buffer_conversion_pool>();
+
+	if (!pool->size())
+	{
+		return false;
+	}
+
+	pool->run(count, 1, [&](u32 first, u32 range)
+	{
+		for (u32 i = first; i < first + range; ++i)
+		{
+			func(i);
+		}
+	});
+
+	return true;
+}
+
 namespace
 {
 	/**
@@ -53,6 +210,42 @@ namespace
 		return{ X, Y, Z, 1 };
 	}
 
+	AVX2_FUNC inline __m256i broadcast_mask_avx2(__m128i mask)
+	{
+		return _mm256_inserti128_si256(_mm256_castsi128_si256(mask), mask, 1);
+	}
+
+	/**
+	 * Byteswap pairs of 128-bit vectors with the given pshufb mask.
+	 * Returns the number of 128-bit vectors processed, an odd one is left to the caller.
+	 */
+	AVX2_FUNC u32 stream_data_to_memory_swapped_avx2(void *dst, const void *src, u32 iterations, __m128i mask128)
+	{
+		const __m256i mask = broadcast_mask_avx2(mask128);
+
+		__m256i* dst_ptr = (__m256i*)dst;
+		const __m256i* src_ptr = (const __m256i*)src;
+
+		const u32 blocks = iterations / 2;
+
+		if (((u64)dst & 31) == 0)
+		{
+			for (u32 i = 0; i < blocks; ++i)
+			{
+				_mm256_stream_si256(dst_ptr + i, _mm256_shuffle_epi8(_mm256_loadu_si256(src_ptr + i), mask));
+			}
+		}
+		else
+		{
+			for (u32 i = 0; i < blocks; ++i)
+			{
+				_mm256_storeu_si256(dst_ptr + i, _mm256_shuffle_epi8(_mm256_loadu_si256(src_ptr + i), mask));
+			}
+		}
+
+		return blocks * 2;
+	}
+
 	inline void stream_data_to_memory_swapped_u32(void *dst, const void *src, u32 vertex_count, u8 stride)
 	{
 		const __m128i mask = _mm_set_epi8(
@@ -70,7 +263,16 @@ namespace
 
 		if (LIKELY(s_use_ssse3))
 		{
-			for (u32 i = 0; i < iterations; ++i)
+			u32 i = 0;
+
+			if (s_use_avx2)
+			{
+				i = stream_data_to_memory_swapped_avx2(dst_ptr, src_ptr, iterations, mask);
+				src_ptr += i;
+				dst_ptr += i;
+			}
+
+			for (; i < iterations; ++i)
 			{
 				const __m128i vector = _mm_loadu_si128(src_ptr);
 				const __m128i shuffled_vector = _mm_shuffle_epi8(vector, mask);
@@ -121,7 +323,16 @@ namespace
 
 		if (LIKELY(s_use_ssse3))
 		{
-			for (u32 i = 0; i < iterations; ++i)
+			u32 i = 0;
+
+			if (s_use_avx2)
+			{
+				i = stream_data_to_memory_swapped_avx2(dst_ptr, src_ptr, iterations, mask);
+				src_ptr += i;
+				dst_ptr += i;
+			}
+
+			for (; i < iterations; ++i)
 			{
 				const __m128i vector = _mm_loadu_si128(src_ptr);
 				const __m128i shuffled_vector = _mm_shuffle_epi8(vector, mask);
@@ -437,9 +648,8 @@ namespace
 	}
 }
 
-void write_vertex_array_data_to_buffer(gsl::span<gsl::byte> raw_dst_span, gsl::span<const gsl::byte> src_ptr, u32 count, rsx::vertex_base_type type, u32 vector_element_count, u32 attribute_src_stride, u8 dst_stride, bool swap_endianness)
+static void write_vertex_array_data_to_buffer_impl(gsl::span<gsl::byte> raw_dst_span, gsl::span<const gsl::byte> src_ptr, u32 count, rsx::vertex_base_type type, u32 vector_element_count, u32 attribute_src_stride, u8 dst_stride, bool swap_endianness)
 {
-	verify(HERE), (vector_element_count > 0);
 	const u32 src_read_stride = rsx::get_vertex_type_size_on_host(type, vector_element_count);
 
 	bool use_stream_no_stride = false;
@@ -538,6 +748,29 @@ void write_vertex_array_data_to_buffer(gsl::span<gsl::byte> raw_dst_span, gsl::s
 	}
 }
 
+void write_vertex_array_data_to_buffer(gsl::span<gsl::byte> raw_dst_span, gsl::span<const gsl::byte> src_ptr, u32 count, rsx::vertex_base_type type, u32 vector_element_count, u32 attribute_src_stride, u8 dst_stride, bool swap_endianness)
+{
+	verify(HERE), (vector_element_count > 0);
+
+	const u32 src_stride = attribute_src_stride ? attribute_src_stride : rsx::get_vertex_type_size_on_host(type, vector_element_count);
+
+	// Repeating arrays wrap around the source, only split arrays with one source element per vertex
+	if ((u32)src_ptr.size_bytes() / src_stride >= count)
+	{
+		// 16 vertices per granule keep the chunk addresses as aligned as the base addresses for the SSE paths
+		if (parallel_conversion(count, 16, [&](u32 first, u32 range)
+		{
+			write_vertex_array_data_to_buffer_impl(raw_dst_span.subspan(first * dst_stride, range * dst_stride), src_ptr.subspan(first * src_stride),
+				range, type, vector_element_count, src_stride, dst_stride, swap_endianness);
+		}))
+		{
+			return;
+		}
+	}
+
+	write_vertex_array_data_to_buffer_impl(raw_dst_span, src_ptr, count, type, vector_element_count, attribute_src_stride, dst_stride, swap_endianness);
+}
+
 namespace
 {
 	template <typename T>
@@ -558,6 +791,81 @@ namespace
 		return value;
 	}
 
+	/**
+	 * Swap, restart-filter and min/max scan of an index array, 256 bits at a time.
+	 * Restart indices are replaced with the type limit and ignored by the scan.
+	 * Returns the number of indices processed, the remainder is left to the scalar loop.
+	 */
+	template<typename T>
+	AVX2_FUNC u32 upload_untouched_avx2(const void* src, void* dst, u32 count, bool restart, T restart_index, T& min_index, T& max_index)
+	{
+		constexpr u32 width = 32 / sizeof(T);
+		const u32 iterations = count / width;
+
+		if (!iterations)
+		{
+			return 0;
+		}
+
+		const __m256i* src_ptr = (const __m256i*)src;
+		__m256i* dst_ptr = (__m256i*)dst;
+
+		__m256i mask, restart_vec;
+
+		if constexpr (sizeof(T) == 4)
+		{
+			mask = broadcast_mask_avx2(_mm_set_epi8(0xC, 0xD, 0xE, 0xF, 0x8, 0x9, 0xA, 0xB, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3));
+			restart_vec = _mm256_set1_epi32(restart_index);
+		}
+		else
+		{
+			mask = broadcast_mask_avx2(_mm_set_epi8(0xE, 0xF, 0xC, 0xD, 0xA, 0xB, 0x8, 0x9, 0x6, 0x7, 0x4, 0x5, 0x2, 0x3, 0x0, 0x1));
+			restart_vec = _mm256_set1_epi16(restart_index);
+		}
+
+		__m256i vmin = _mm256_set1_epi32(-1);
+		__m256i vmax = _mm256_setzero_si256();
+
+		for (u32 i = 0; i < iterations; ++i)
+		{
+			__m256i for_min = _mm256_shuffle_epi8(_mm256_loadu_si256(src_ptr + i), mask);
+			__m256i for_max = for_min;
+
+			if (restart)
+			{
+				const __m256i is_restart = sizeof(T) == 4 ? _mm256_cmpeq_epi32(for_min, restart_vec) : _mm256_cmpeq_epi16(for_min, restart_vec);
+				for_min = _mm256_or_si256(for_min, is_restart);
+				for_max = _mm256_andnot_si256(is_restart, for_max);
+			}
+
+			_mm256_storeu_si256(dst_ptr + i, for_min);
+
+			if constexpr (sizeof(T) == 4)
+			{
+				vmin = _mm256_min_epu32(vmin, for_min);
+				vmax = _mm256_max_epu32(vmax, for_max);
+			}
+			else
+			{
+				vmin = _mm256_min_epu16(vmin, for_min);
+				vmax = _mm256_max_epu16(vmax, for_max);
+			}
+		}
+
+		alignas(32) T mins[width];
+		alignas(32) T maxs[width];
+		_mm256_store_si256((__m256i*)mins, vmin);
+		_mm256_store_si256((__m256i*)maxs, vmax);
+
+		for (u32 i = 0; i < width; ++i)
+		{
+			min_index = std::min(min_index, mins[i]);
+			max_index = std::max(max_index, maxs[i]);
+		}
+
+		return iterations * width;
+	}
+
 	struct untouched_impl
 	{
 		template<typename T>
@@ -567,7 +875,12 @@ namespace
 			T min_index = index_limit<T>(), max_index = 0;
 			u32 dst_index = 0;
 
-			for (const T index : src)
+			if (s_use_avx2)
+			{
+				dst_index = upload_untouched_avx2<T>(src.data(), dst.data(), ::size32(src), false, 0, min_index, max_index);
+			}
+
+			for (const T index : src.subspan(dst_index))
 			{
 				dst[dst_index++] = min_max(min_index, max_index, index);
 			}
@@ -585,7 +898,13 @@ namespace
 			T min_index = index_limit<T>(), max_index = 0;
 			u32 dst_index = 0;
 
-			for (const T index : src)
+			// Only forwarded restart indices keep the output position equal to the input position
+			if (s_use_avx2 && !skip_restart)
+			{
+				dst_index = upload_untouched_avx2<T>(src.data(), dst.data(), ::size32(src), restart_index <= index_limit<T>(), (T)restart_index, min_index, max_index);
+			}
+
+			for (const T index : src.subspan(dst_index))
 			{
 				if (index == restart_index)
 				{
@@ -841,14 +1160,58 @@ namespace
 		return std::make_tuple(first, count);
 	}
 
+	/**
+	 * Split an index conversion whose output position only depends on the input position.
+	 * dst_per_src output indices are written for every src_per_dst input indices.
+	 */
+	template<typename T, typename F>
+	bool parallel_index_conversion(gsl::span<T> dst, gsl::span<const be_t<T>> src, u32 src_per_dst, u32 dst_per_src, F&& convert, std::tuple<T, T, u32>& result)
+	{
+		shared_mutex mutex;
+		T min_index = index_limit<T>(), max_index = 0;
+		u32 written = 0;
+
+		if (!parallel_conversion(::size32(src), src_per_dst, [&](u32 first, u32 range)
+		{
+			const u32 dst_first = first / src_per_dst * dst_per_src;
+			const u32 dst_range = std::min<u32>(::size32(dst) - dst_first, (range + src_per_dst - 1) / src_per_dst * dst_per_src);
+			const auto [_min, _max, count] = convert(src.subspan(first, range), dst.subspan(dst_first, dst_range));
+
+			std::lock_guard lock(mutex);
+			min_index = std::min(min_index, _min);
+			max_index = std::max(max_index, _max);
+			written += count;
+		}))
+		{
+			return false;
+		}
+
+		result = std::make_tuple(min_index, max_index, written);
+		return true;
+	}
+
 	template<typename T>
 	std::tuple<T, T, u32> write_index_array_data_to_buffer_impl(gsl::span<T> dst,
 		gsl::span<const be_t<T>> src,
 		rsx::primitive_type draw_mode, bool restart_index_enabled, u32 restart_index,
 		const std::function<bool(rsx::primitive_type)>& expands)
 	{
+		std::tuple<T, T, u32> result;
+
 		if (LIKELY(!expands(draw_mode)))
 		{
+			// Restart indices that are dropped instead of forwarded shift the output
+			if (!restart_index_enabled || !is_primitive_disjointed(draw_mode))
+			{
+				if (parallel_index_conversion<T>(dst, src, 1, 1, [&](auto _src, auto _dst)
+				{
+					return upload_untouched<T>(_src, _dst, draw_mode, restart_index_enabled, restart_index);
+				}, result))
+				{
+					return result;
+				}
+			}
+
 			return upload_untouched<T>(src, dst, draw_mode, restart_index_enabled, restart_index);
 		}
 
@@ -868,6 +1231,15 @@ namespace
 		}
 		case rsx::primitive_type::quads:
 		{
+			// Without restart every quad becomes exactly two triangles
+			if (!restart_index_enabled && parallel_index_conversion<T>(dst, src, 4, 6, [&](auto _src, auto _dst)
+			{
+				return expand_indexed_quads<T>(_src, _dst, false, 0);
+			}, result))
+			{
+				return result;
+			}
+
 			return expand_indexed_quads<T>(src, dst, restart_index_enabled, restart_index);
 		}
 		default:
@@ -6,6 +6,12 @@
 #include "Emu/Memory/vm.h"
 #include "../RSXThread.h"
 
+/**
+ * Run func(index) for every index in [0, count) on the buffer conversion threads, the calling thread takes part.
+ * Returns false without running anything if no helper thread is available.
+ */
+bool run_conversion_tasks(u32 count, const std::function<void(u32)>& func);
+
 /**
  * Write count vertex attributes from src_ptr.
  * src_ptr array layout is deduced from the type, vector element count and src_stride arguments.
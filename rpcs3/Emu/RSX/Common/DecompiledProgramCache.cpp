@@ -0,0 +1,343 @@
+#include "stdafx.h"
+#include "DecompiledProgramCache.h"
+#include "ProgramStateCache.h"
+
+namespace rsx
+{
+	namespace
+	{
+		struct vertex_program_key_data
+		{
+			u64 ucode_hash;
+			u64 device_key;
+			u64 jump_table_hash;
+			u32 output_mask;
+			u32 texture_dimensions;
+			u32 instruction_count;
+			u32 entry;
+		};
+
+		struct fragment_program_key_data
+		{
+			u64 ucode_hash;
+			u64 device_key;
+			u32 ctrl;
+			u32 texture_dimensions;
+			u16 unnormalized_coords;
+			u16 redirected_textures;
+			u16 shadow_textures;
+			u16 color_flags;
+			u8 textures_alpha_kill[16];
+			u8 textures_zfunc[16];
+		};
+
+		void write_u32(std::vector<u8>& dst, u32 value)
+		{
+			const auto bytes = reinterpret_cast<const u8*>(&value);
+			dst.insert(dst.end(), bytes, bytes + sizeof(u32));
+		}
+
+		void write_string(std::vector<u8>& dst, const std::string& value)
+		{
+			write_u32(dst, ::size32(value));
+			dst.insert(dst.end(), value.begin(), value.end());
+		}
+
+		struct reader
+		{
+			const u8* data;
+			u32 remaining;
+
+			bool read_u32(u32& value)
+			{
+				if (remaining < sizeof(u32))
+				{
+					return false;
+				}
+
+				std::memcpy(&value, data, sizeof(u32));
+				data += sizeof(u32);
+				remaining -= sizeof(u32);
+				return true;
+			}
+
+			bool read_string(std::string& value)
+			{
+				u32 length;
+				if (!read_u32(length) || remaining < length)
+				{
+					return false;
+				}
+
+				value.assign(reinterpret_cast<const char*>(data), length);
+				data += length;
+				remaining -= length;
+				return true;
+			}
+		};
+	}
+
+	void decompiled_program_cache::serialize(const decompiled_program& program, std::vector<u8>& dst)
+	{
+		write_string(dst, program.source);
+
+		write_u32(dst, ::size32(program.bindings));
+		for (const auto& binding : program.bindings)
+		{
+			write_u32(dst, binding.domain);
+			write_u32(dst, binding.type);
+			write_u32(dst, binding.location);
+			write_string(dst, binding.name);
+		}
+
+		write_u32(dst, ::size32(program.constant_offsets));
+		for (const u32 offset : program.constant_offsets)
+		{
+			write_u32(dst, offset);
+		}
+
+		for (const u32 mask : program.output_color_masks)
+		{
+			write_u32(dst, mask);
+		}
+	}
+
+	bool decompiled_program_cache::deserialize(const u8* src, u32 size, decompiled_program& program)
+	{
+		reader in{ src, size };
+		u32 count;
+
+		if (!in.read_string(program.source) || !in.read_u32(count))
+		{
+			return false;
+		}
+
+		program.bindings.resize(count);
+		for (auto& binding : program.bindings)
+		{
+			if (!in.read_u32(binding.domain) || !in.read_u32(binding.type) || !in.read_u32(binding.location) || !in.read_string(binding.name))
+			{
+				return false;
+			}
+		}
+
+		if (!in.read_u32(count) || count > in.remaining / sizeof(u32))
+		{
+			return false;
+		}
+
+		program.constant_offsets.resize(count);
+		for (u32& offset : program.constant_offsets)
+		{
+			in.read_u32(offset);
+		}
+
+		for (u32& mask : program.output_color_masks)
+		{
+			if (!in.read_u32(mask))
+			{
+				return false;
+			}
+		}
+
+		return in.remaining == 0;
+	}
+
+	bool decompiled_program_cache::read_pack(const std::vector<u8>& bytes)
+	{
+		pack_header header;
+		if (bytes.size() < sizeof(pack_header) || (std::memcpy(&header, bytes.data(), sizeof(pack_header)), header.magic != pack_magic) || header.version != pack_version)
+		{
+			LOG_WARNING(RSX, "decompiled program cache: %s is not a compatible pack file and will be replaced", m_path);
+			return false;
+		}
+
+		size_t offset = sizeof(pack_header);
+		while (offset < bytes.size())
+		{
+			pack_record_header record;
+			if (bytes.size() - offset < sizeof(pack_record_header))
+			{
+				LOG_WARNING(RSX, "decompiled program cache: %s ends with a truncated record", m_path);
+				return false;
+			}
+
+			std::memcpy(&record, bytes.data() + offset, sizeof(pack_record_header));
+			offset += sizeof(pack_record_header);
+
+			decompiled_program program;
+			if (bytes.size() - offset < record.size || !deserialize(bytes.data() + offset, record.size, program))
+			{
+				LOG_WARNING(RSX, "decompiled program cache: %s contains a damaged record", m_path);
+				return false;
+			}
+
+			offset += record.size;
+			m_programs.emplace(record.key, std::move(program));
+		}
+
+		return true;
+	}
+
+	void decompiled_program_cache::rewrite_pack()
+	{
+		const std::string temp_path = m_path + ".tmp";
+
+		{
+			fs::file pack(temp_path, fs::rewrite);
+			if (!pack)
+			{
+				LOG_ERROR(RSX, "decompiled program cache: failed to create %s", temp_path);
+				return;
+			}
+
+			pack.write(pack_header{ pack_magic, pack_version, 0 });
+
+			std::vector<u8> payload;
+			for (const auto& entry : m_programs)
+			{
+				payload.clear();
+				serialize(entry.second, payload);
+				pack.write(pack_record_header{ entry.first, ::size32(payload), 0 });
+				pack.write(payload);
+			}
+		}
+
+		if (!fs::rename(temp_path, m_path, true))
+		{
+			LOG_ERROR(RSX, "decompiled program cache: failed to replace %s", m_path);
+		}
+	}
+
+	void decompiled_program_cache::open(const std::string& path)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pack.close();
+		m_path = path;
+
+		if (m_path.empty())
+		{
+			return;
+		}
+
+		fs::create_path(fs::get_parent_dir(m_path));
+
+		if (fs::is_file(m_path))
+		{
+			std::vector<u8> bytes;
+			if (fs::file pack{ m_path })
+			{
+				bytes = pack.to_vector<u8>();
+			}
+
+			// Anything unreadable is dropped, the valid records read so far are kept
+			if (!read_pack(bytes))
+			{
+				rewrite_pack();
+			}
+		}
+
+		if (!m_pack.open(m_path, fs::write + fs::create + fs::append))
+		{
+			LOG_ERROR(RSX, "decompiled program cache: failed to open %s", m_path);
+			return;
+		}
+
+		if (m_pack.size() == 0)
+		{
+			m_pack.write(pack_header{ pack_magic, pack_version, 0 });
+		}
+
+		LOG_NOTICE(RSX, "decompiled program cache: %u programs loaded from %s", m_programs.size(), m_path);
+	}
+
+	void decompiled_program_cache::close()
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pack.close();
+		m_programs.clear();
+		m_path.clear();
+	}
+
+	bool decompiled_program_cache::find(u64 key, decompiled_program& result)
+	{
+		reader_lock lock(m_mutex);
+
+		const auto found = m_programs.find(key);
+		if (found == m_programs.end())
+		{
+			return false;
+		}
+
+		result = found->second;
+		return true;
+	}
+
+	void decompiled_program_cache::store(u64 key, const decompiled_program& program)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (!m_programs.emplace(key, program).second || !m_pack)
+		{
+			return;
+		}
+
+		std::vector<u8> record(sizeof(pack_record_header));
+		serialize(program, record);
+
+		const pack_record_header header = { key, u32(record.size() - sizeof(pack_record_header)), 0 };
+		std::memcpy(record.data(), &header, sizeof(pack_record_header));
+		m_pack.write(record);
+	}
+
+	u64 decompiled_program_cache::get_key(const RSXVertexProgram& program, u64 device_key)
+	{
+		vertex_program_key_data key{};
+		key.ucode_hash = program_hash_util::vertex_program_utils::get_vertex_program_ucode_hash(program);
+		key.device_key = device_key;
+		key.output_mask = program.output_mask;
+		key.texture_dimensions = program.texture_dimensions;
+		key.instruction_count = ::size32(program.data) / 4;
+		key.entry = program.entry - program.base_address;
+
+		// 64-bit FNV-1a over the branch targets
+		key.jump_table_hash = 0xCBF29CE484222325ULL;
+		for (const u32 target : program.jump_table)
+		{
+			key.jump_table_hash ^= target;
+			key.jump_table_hash *= 0x100000001B3ULL;
+		}
+
+		return rpcs3::hash_struct(key);
+	}
+
+	u64 decompiled_program_cache::get_key(const RSXFragmentProgram& program, u64 device_key)
+	{
+		fragment_program_key_data key{};
+		key.ucode_hash = program_hash_util::fragment_program_utils::get_fragment_program_ucode_hash(program);
+		key.device_key = device_key;
+		key.ctrl = program.ctrl;
+		key.texture_dimensions = program.texture_dimensions;
+		key.unnormalized_coords = program.unnormalized_coords;
+		key.redirected_textures = program.redirected_textures;
+		key.shadow_textures = program.shadow_textures;
+		key.color_flags = (program.front_back_color_enabled ? 1 : 0) |
+			(program.back_color_diffuse_output ? 2 : 0) |
+			(program.back_color_specular_output ? 4 : 0) |
+			(program.front_color_diffuse_output ? 8 : 0) |
+			(program.front_color_specular_output ? 16 : 0);
+
+		std::memcpy(key.textures_alpha_kill, program.textures_alpha_kill, sizeof(key.textures_alpha_kill));
+		std::memcpy(key.textures_zfunc, program.textures_zfunc, sizeof(key.textures_zfunc));
+
+		return rpcs3::hash_struct(key);
+	}
+
+	decompiled_program_cache& get_decompiled_program_cache()
+	{
+		static decompiled_program_cache s_cache;
+		return s_cache;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "Utilities/File.h"
+#include "Utilities/mutex.h"
+#include "Emu/RSX/RSXFragmentProgram.h"
+#include "Emu/RSX/RSXVertexProgram.h"
+
+#include <unordered_map>
+
+namespace rsx
+{
+	/**
+	 * Backend-independent result of a decompilation: the generated source plus the program interface
+	 * (resource bindings, fragment constant offsets, written outputs) the backend would otherwise collect from the decompiler.
+	 */
+	struct decompiled_program
+	{
+		struct binding
+		{
+			u32 domain;
+			u32 type;
+			u32 location;
+			std::string name;
+		};
+
+		std::string source;
+		std::vector<binding> bindings;
+		std::vector<u32> constant_offsets;
+		std::array<u32, 4> output_color_masks{};
+	};
+
+	/**
+	 * Keeps decompiler output keyed by the program ucode and the decoder state the output depends on.
+	 * Programs seen again in the session or in a previous run are not decompiled again, leaving only the driver compile.
+	 * Entries live in memory and are appended to a pack file when one is open. Safe to use from multiple threads.
+	 */
+	class decompiled_program_cache
+	{
+		struct pack_header
+		{
+			u64 magic;
+			u32 version;
+			u32 reserved;
+		};
+
+		struct pack_record_header
+		{
+			u64 key;
+			u32 size;
+			u32 reserved;
+		};
+
+		static constexpr u64 pack_magic = 0x4B50433353435052ull; // "RPCS3CPK"
+		static constexpr u32 pack_version = 1;
+
+		shared_mutex m_mutex;
+		std::unordered_map<u64, decompiled_program> m_programs;
+		std::string m_path;
+		fs::file m_pack;
+
+		static void serialize(const decompiled_program& program, std::vector<u8>& dst);
+		static bool deserialize(const u8* src, u32 size, decompiled_program& program);
+
+		bool read_pack(const std::vector<u8>& bytes);
+		void rewrite_pack();
+
+	public:
+		// Loads the pack at path and keeps it open for appending. An empty path keeps the cache in memory only
+		void open(const std::string& path);
+		void close();
+
+		bool find(u64 key, decompiled_program& result);
+		void store(u64 key, const decompiled_program& program);
+
+		// device_key must hold every backend and device option that changes the decompiler output
+		static u64 get_key(const RSXVertexProgram& program, u64 device_key);
+		static u64 get_key(const RSXFragmentProgram& program, u64 device_key);
+	};
+
+	decompiled_program_cache& get_decompiled_program_cache();
+}
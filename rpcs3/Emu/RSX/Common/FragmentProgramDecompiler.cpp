@@ -869,6 +869,13 @@ bool FragmentProgramDecompiler::handle_tex_srb(u32 opcode)
 			SetDst(getFunction(FUNCTION::FUNCTION_TEXTURE_SAMPLE1D));
 			return true;
 		case rsx::texture_dimension_extended::texture_dimension_2d:
+			if (device_props.emulate_depth_compare && !(m_prog.redirected_textures & (1 << dst.tex_num)))
+			{
+				// The comparison is selected at runtime from the texture control bits, shadow state does not split the program
+				SetDst(getFunction(FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC));
+				m_2d_sampled_textures |= (1 << dst.tex_num);
+				return true;
+			}
 			if (m_prog.shadow_textures & (1 << dst.tex_num))
 			{
 				m_shadow_sampled_textures |= (1 << dst.tex_num);
@@ -902,7 +909,12 @@ bool FragmentProgramDecompiler::handle_tex_srb(u32 opcode)
 			return true;
 		case rsx::texture_dimension_extended::texture_dimension_2d:
 			//Note shadow comparison only returns a true/false result!
-			if (m_prog.shadow_textures & (1 << dst.tex_num))
+			if (device_props.emulate_depth_compare)
+			{
+				SetDst(getFunction(FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC_PROJ));
+				m_2d_sampled_textures |= (1 << dst.tex_num);
+			}
+			else if (m_prog.shadow_textures & (1 << dst.tex_num))
 			{
 				m_shadow_sampled_textures |= (1 << dst.tex_num);
 				SetDst(getFunction(FUNCTION::FUNCTION_TEXTURE_SHADOW2D_PROJ) + ".xxxx");
@@ -693,8 +693,13 @@ namespace glsl
 			if (props.emulate_shadow_compare)
 			{
 				OS <<
-				"#define TEX2D_SHADOW(index, coord3) shadowCompare(TEX_NAME(index), coord3 * vec3(texture_parameters[index].xy, 1.), floatBitsToUint(texture_parameters[index].w) >> 8)\n"
-				"#define TEX2D_SHADOWPROJ(index, coord4) shadowCompareProj(TEX_NAME(index), coord4 * vec4(texture_parameters[index].xy, 1., 1.), floatBitsToUint(texture_parameters[index].w) >> 8)\n";
+				"#define TEX2D_COMPARE_FUNC(index) ((floatBitsToUint(texture_parameters[index].w) >> 8) & 0x7)\n"
+				"#define TEX2D_SHADOW(index, coord3) shadowCompare(TEX_NAME(index), coord3 * vec3(texture_parameters[index].xy, 1.), TEX2D_COMPARE_FUNC(index))\n"
+				"#define TEX2D_SHADOWPROJ(index, coord4) shadowCompareProj(TEX_NAME(index), coord4 * vec4(texture_parameters[index].xy, 1., 1.), TEX2D_COMPARE_FUNC(index))\n"
+
+				// The compare function is only set for depth textures with an active comparison, the branch is uniform across the draw
+				"#define TEX2D_SHADOW_DYNAMIC(index, coord3) ((TEX2D_COMPARE_FUNC(index) != 0)? TEX2D_SHADOW(index, coord3).xxxx : TEX2D(index, coord3.xy))\n"
+				"#define TEX2D_SHADOWPROJ_DYNAMIC(index, coord4) ((TEX2D_COMPARE_FUNC(index) != 0)? TEX2D_SHADOWPROJ(index, coord4).xxxx : TEX2D_PROJ(index, coord4))\n";
 			}
 			else
 			{
@@ -775,6 +780,10 @@ namespace glsl
 			return "TEX2D_SHADOW($_i, $0.xyz)";
 		case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_PROJ:
 			return "TEX2D_SHADOWPROJ($_i, $0)";
+		case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC:
+			return "TEX2D_SHADOW_DYNAMIC($_i, $0.xyz)";
+		case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC_PROJ:
+			return "TEX2D_SHADOWPROJ_DYNAMIC($_i, $0)";
 		case FUNCTION::FUNCTION_TEXTURE_SAMPLECUBE:
 			return "TEX3D($_i, $0.xyz)";
 		case FUNCTION::FUNCTION_TEXTURE_SAMPLECUBE_BIAS:
@@ -246,7 +246,7 @@ vertex_program_utils::vertex_program_metadata vertex_program_utils::analyse_vert
 
 size_t vertex_program_storage_hash::operator()(const RSXVertexProgram &program) const
 {
-	size_t hash = vertex_program_utils::get_vertex_program_ucode_hash(program);
+	size_t hash = program.ucode_hash ? program.ucode_hash : vertex_program_utils::get_vertex_program_ucode_hash(program);
 	hash ^= program.output_mask;
 	hash ^= program.texture_dimensions;
 	return hash;
@@ -420,7 +420,7 @@ size_t fragment_program_utils::get_fragment_program_ucode_hash(const RSXFragment
 
 size_t fragment_program_storage_hash::operator()(const RSXFragmentProgram& program) const
 {
-	size_t hash = fragment_program_utils::get_fragment_program_ucode_hash(program);
+	size_t hash = program.ucode_hash ? program.ucode_hash : fragment_program_utils::get_fragment_program_ucode_hash(program);
 	hash ^= program.ctrl;
 	hash ^= program.texture_dimensions;
 	hash ^= program.unnormalized_coords;
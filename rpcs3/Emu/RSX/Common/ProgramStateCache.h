@@ -7,8 +7,12 @@
 #include "Utilities/GSL.h"
 #include "Utilities/hash.h"
 #include "Utilities/mutex.h"
+#include "Utilities/lock_profiler.h"
+#include "Utilities/timeline.h"
 
 #include <deque>
+#include <functional>
+#include <optional>
 
 enum class SHADER_TYPE
 {
@@ -175,19 +179,48 @@ public:
 
 protected:
 	shared_mutex m_pipeline_mutex;
-	shared_mutex m_decompiler_mutex;
+	mutable shared_mutex m_decompiler_mutex;
 
 	size_t m_next_id = 0;
 	bool m_cache_miss_flag; // Set if last lookup did not find any usable cached programs
 	bool m_program_compiled_flag; // Set if last lookup caused program to be linked
+	bool m_first_use_flag; // Set if last lookup returned a cached pipeline for the first time in this session
 
 	binary_to_vertex_program m_vertex_shader_cache;
 	binary_to_fragment_program m_fragment_shader_cache;
 	std::unordered_map <pipeline_key, pipeline_storage_type, pipeline_key_hash, pipeline_key_compare> m_storage;
 
+	// Render thread lookups, filled from the shared maps above the first time an entry is used.
+	// Entries of the shared maps keep their address until clear(), so hits here never take a lock
+	std::unordered_map<RSXVertexProgram, const vertex_program_type*, program_hash_util::vertex_program_storage_hash, program_hash_util::vertex_program_compare> m_vertex_program_lookup;
+	mutable std::unordered_map<RSXFragmentProgram, const fragment_program_type*, program_hash_util::fragment_program_storage_hash, program_hash_util::fragment_program_compare> m_fragment_program_lookup;
+	std::unordered_map<pipeline_key, pipeline_storage_type*, pipeline_key_hash, pipeline_key_compare> m_pipeline_lookup;
+
 	std::unordered_map <pipeline_key, std::unique_ptr<async_link_task_entry>, pipeline_key_hash, pipeline_key_compare> m_link_queue;
 	std::deque<async_decompile_task_entry> m_decompile_queue;
 
+public:
+	// Last fragment constants upload of a program
+	struct fragment_constants_upload
+	{
+		std::vector<v128> data; // Converted constants
+		u64 buffer = 0;         // Ring buffer and offset holding them
+		u32 offset = 0;
+		u64 epoch = -1;         // Allocation epoch they were written in, only blocks of the current one can be bound again
+	};
+
+protected:
+	// Render thread only, indexed by the cached program (constants are not part of the program key)
+	std::unordered_map<const fragment_program_type*, fragment_constants_upload> m_fragment_constants_uploads;
+	std::vector<v128> m_fragment_constants_scratch;
+	u64 m_fragment_constants_epoch = 0;
+	u32 m_fragment_constants_last_offset = 0;
+
+	// Precompiled pipelines linked by async_update once the link queue is empty, in the order they were added
+	// An entry requested by the render thread before that is moved to the link queue
+	std::unordered_map <pipeline_key, std::unique_ptr<async_link_task_entry>, pipeline_key_hash, pipeline_key_compare> m_deferred_link_queue;
+	std::deque<pipeline_key> m_deferred_link_order;
+
 	vertex_program_type __null_vertex_program;
 	fragment_program_type __null_fragment_program;
 	pipeline_storage_type __null_pipeline_handle;
@@ -195,6 +228,8 @@ protected:
 	/// bool here to inform that the program was preexisting.
 	std::tuple<const vertex_program_type&, bool> search_vertex_program(const RSXVertexProgram& rsx_vp, bool force_load = true)
 	{
+		reader_lock lock(m_decompiler_mutex);
+
 		const auto& I = m_vertex_shader_cache.find(rsx_vp);
 		if (I != m_vertex_shader_cache.end())
 		{
@@ -206,8 +241,16 @@ protected:
 			return std::forward_as_tuple(__null_vertex_program, false);
 		}
 
+		// Another thread may have added the program while upgrading
+		lock.upgrade();
+		const auto result = m_vertex_shader_cache.try_emplace(rsx_vp);
+		if (!result.second)
+		{
+			return std::forward_as_tuple(result.first->second, true);
+		}
+
 		LOG_NOTICE(RSX, "VP not found in buffer!");
-		vertex_program_type& new_shader = m_vertex_shader_cache[rsx_vp];
+		vertex_program_type& new_shader = result.first->second;
 		backend_traits::recompile_vertex_program(rsx_vp, new_shader, m_next_id++);
 
 		return std::forward_as_tuple(new_shader, false);
@@ -216,6 +259,8 @@ protected:
 	/// bool here to inform that the program was preexisting.
 	std::tuple<const fragment_program_type&, bool> search_fragment_program(const RSXFragmentProgram& rsx_fp, bool force_load = true)
 	{
+		reader_lock lock(m_decompiler_mutex);
+
 		const auto& I = m_fragment_shader_cache.find(rsx_fp);
 		if (I != m_fragment_shader_cache.end())
 		{
@@ -227,6 +272,14 @@ protected:
 			return std::forward_as_tuple(__null_fragment_program, false);
 		}
 
+		// Another thread may have added the program while upgrading
+		lock.upgrade();
+		const auto& found = m_fragment_shader_cache.find(rsx_fp);
+		if (found != m_fragment_shader_cache.end())
+		{
+			return std::forward_as_tuple(found->second, true);
+		}
+
 		LOG_NOTICE(RSX, "FP not found in buffer!");
 		void* fragment_program_ucode_copy = malloc(rsx_fp.ucode_length);
 		std::memcpy(fragment_program_ucode_copy, rsx_fp.addr, rsx_fp.ucode_length);
@@ -238,6 +291,188 @@ protected:
 		return std::forward_as_tuple(new_shader, false);
 	}
 
+	// Publishes decompiled programs to the render thread lookups
+	void update_program_lookup(const RSXVertexProgram& rsx_vp, const RSXFragmentProgram& rsx_fp)
+	{
+		reader_lock lock(m_decompiler_mutex);
+
+		if (m_vertex_program_lookup.find(rsx_vp) == m_vertex_program_lookup.end())
+		{
+			const auto I = m_vertex_shader_cache.find(rsx_vp);
+			verify(HERE), I != m_vertex_shader_cache.end();
+			m_vertex_program_lookup.emplace(I->first, &I->second);
+		}
+
+		if (m_fragment_program_lookup.find(rsx_fp) == m_fragment_program_lookup.end())
+		{
+			// The key of the shared map owns its ucode copy, the one passed in points to guest memory
+			const auto I = m_fragment_shader_cache.find(rsx_fp);
+			verify(HERE), I != m_fragment_shader_cache.end();
+			m_fragment_program_lookup.emplace(I->first, &I->second);
+		}
+	}
+
+	const fragment_program_type* find_fragment_program(const RSXFragmentProgram& rsx_fp) const
+	{
+		const auto found = m_fragment_program_lookup.find(rsx_fp);
+		if (found != m_fragment_program_lookup.end())
+		{
+			return found->second;
+		}
+
+		reader_lock lock(m_decompiler_mutex);
+
+		const auto I = m_fragment_shader_cache.find(rsx_fp);
+		return I != m_fragment_shader_cache.end() ? &I->second : nullptr;
+	}
+
+	template<typename... Args>
+	pipeline_storage_type& find_graphics_pipeline(
+		const RSXVertexProgram& vertexShader,
+		const RSXFragmentProgram& fragmentShader,
+		pipeline_properties& pipelineProperties,
+		bool allow_async,
+		bool update_lookup,
+		Args&& ...args
+		)
+	{
+		const auto &vp_search = search_vertex_program(vertexShader, !allow_async);
+		const auto &fp_search = search_fragment_program(fragmentShader, !allow_async);
+
+		const bool already_existing_fragment_program = std::get<1>(fp_search);
+		const bool already_existing_vertex_program = std::get<1>(vp_search);
+
+		bool link_only = false;
+		m_cache_miss_flag = true;
+		m_program_compiled_flag = false;
+		m_first_use_flag = false;
+
+		if (!allow_async || (already_existing_vertex_program && already_existing_fragment_program))
+		{
+			const vertex_program_type &vertex_program = std::get<0>(vp_search);
+			const fragment_program_type &fragment_program = std::get<0>(fp_search);
+
+			if (update_lookup)
+			{
+				update_program_lookup(vertexShader, fragmentShader);
+			}
+
+			backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
+			pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
+
+			{
+				reader_lock lock(m_pipeline_mutex);
+
+				const auto I = m_storage.find(key);
+				if (I != m_storage.end())
+				{
+					if (update_lookup)
+					{
+						m_first_use_flag = m_pipeline_lookup.emplace(key, &I->second).second;
+					}
+
+					m_cache_miss_flag = false;
+					return I->second;
+				}
+			}
+
+			if (allow_async)
+			{
+				// Programs already exist, only linking required
+				link_only = true;
+			}
+			else
+			{
+				LOG_NOTICE(RSX, "Add program (vp id = %d, fp id = %d)", vertex_program.id, fragment_program.id);
+				m_program_compiled_flag = true;
+
+				timeline::scoped_event event("RSX", "Build pipeline");
+				pipeline_storage_type pipeline = backend_traits::build_pipeline(vertex_program, fragment_program, pipelineProperties, std::forward<Args>(args)...);
+				std::lock_guard lock(m_pipeline_mutex);
+
+				// Existing entries are never replaced, the render thread may hold on to them
+				auto &rtn = m_storage.emplace(key, std::move(pipeline)).first->second;
+				if (update_lookup)
+				{
+					m_pipeline_lookup.emplace(key, &rtn);
+				}
+
+				LOG_SUCCESS(RSX, "New program compiled successfully");
+				return rtn;
+			}
+		}
+
+		verify(HERE), allow_async;
+
+		if (link_only)
+		{
+			const vertex_program_type &vertex_program = std::get<0>(vp_search);
+			const fragment_program_type &fragment_program = std::get<0>(fp_search);
+			pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
+
+			reader_lock lock(m_pipeline_mutex);
+
+			if (m_link_queue.find(key) != m_link_queue.end())
+			{
+				// Already in queue
+				return __null_pipeline_handle;
+			}
+
+			if (m_deferred_link_queue.find(key) != m_deferred_link_queue.end())
+			{
+				// Precompiled pipeline that was not linked yet, link it before the remaining ones
+				lock.upgrade();
+
+				if (const auto found = m_deferred_link_queue.find(key); found != m_deferred_link_queue.end())
+				{
+					m_link_queue.emplace(key, std::move(found->second));
+					m_deferred_link_queue.erase(found);
+				}
+
+				return __null_pipeline_handle;
+			}
+
+			LOG_NOTICE(RSX, "Add program (vp id = %d, fp id = %d)", vertex_program.id, fragment_program.id);
+			m_program_compiled_flag = true;
+
+			lock.upgrade();
+			m_link_queue[key] = std::make_unique<async_link_task_entry>(vertex_program, fragment_program, pipelineProperties);
+		}
+		else
+		{
+			reader_lock lock(m_decompiler_mutex);
+
+			auto vertex_program_found = std::find_if(m_decompile_queue.begin(), m_decompile_queue.end(), [&](const auto& V)
+			{
+				if (V.is_fp) return false;
+				return program_hash_util::vertex_program_compare()(V.vp, vertexShader);
+			});
+
+			auto fragment_program_found = std::find_if(m_decompile_queue.begin(), m_decompile_queue.end(), [&](const auto& F)
+			{
+				if (!F.is_fp) return false;
+				return program_hash_util::fragment_program_compare()(F.fp, fragmentShader);
+			});
+
+			const bool add_vertex_program = (vertex_program_found == m_decompile_queue.end());
+			const bool add_fragment_program = (fragment_program_found == m_decompile_queue.end());
+
+			if (add_vertex_program)
+			{
+				lock.upgrade();
+				m_decompile_queue.emplace_back(vertexShader);
+			}
+
+			if (add_fragment_program)
+			{
+				lock.upgrade();
+				m_decompile_queue.emplace_back(fragmentShader);
+			}
+		}
+
+		return __null_pipeline_handle;
+	}
+
 public:
 
 	struct program_buffer_patch_entry
@@ -309,9 +544,17 @@ public:
 	patch_table;
 
 public:
-	program_state_cache() = default;
+	program_state_cache()
+	{
+		lock_profiler::set_name(&m_pipeline_mutex, "program_state_cache::m_pipeline_mutex");
+		lock_profiler::set_name(&m_decompiler_mutex, "program_state_cache::m_decompiler_mutex");
+	}
+
 	~program_state_cache()
 	{
+		lock_profiler::remove_name(&m_pipeline_mutex);
+		lock_profiler::remove_name(&m_decompiler_mutex);
+
 		for (auto& pair : m_fragment_shader_cache)
 		{
 			free(pair.first.addr);
@@ -334,6 +577,38 @@ public:
 		fmt::throw_exception("Trying to get unknown shader program" HERE);
 	}
 
+	// Reserves cache slots for the programs not decompiled yet and queues one decompile task per program into tasks
+	// The tasks only write to their own slot and can run on any thread, provided no lookups happen until they are done
+	// NOTE: The programs are referenced by the tasks and must outlive them
+	void get_preload_tasks(const RSXVertexProgram& rsx_vp, const RSXFragmentProgram& rsx_fp, std::vector<std::function<void()>>& tasks)
+	{
+		if (m_vertex_shader_cache.find(rsx_vp) == m_vertex_shader_cache.end())
+		{
+			vertex_program_type& new_shader = m_vertex_shader_cache[rsx_vp];
+			const size_t id = m_next_id++;
+
+			tasks.emplace_back([&rsx_vp, &new_shader, id]()
+			{
+				backend_traits::recompile_vertex_program(rsx_vp, new_shader, id);
+			});
+		}
+
+		if (m_fragment_shader_cache.find(rsx_fp) == m_fragment_shader_cache.end())
+		{
+			void* fragment_program_ucode_copy = malloc(rsx_fp.ucode_length);
+			std::memcpy(fragment_program_ucode_copy, rsx_fp.addr, rsx_fp.ucode_length);
+			RSXFragmentProgram new_fp_key = rsx_fp;
+			new_fp_key.addr = fragment_program_ucode_copy;
+			fragment_program_type& new_shader = m_fragment_shader_cache[new_fp_key];
+			const size_t id = m_next_id++;
+
+			tasks.emplace_back([&rsx_fp, &new_shader, id]()
+			{
+				backend_traits::recompile_fragment_program(rsx_fp, new_shader, id);
+			});
+		}
+	}
+
 	// Returns 2 booleans.
 	// First flag hints that there is more work to do (busy hint)
 	// Second flag is true if at least one program has been linked successfully (sync hint)
@@ -342,26 +617,34 @@ public:
 	{
 		// Decompile shaders and link one pipeline object per 'run'
 		// NOTE: Linking is much slower than decompilation step, so always decompile at least 1 unit
-		// TODO: Use try_lock instead
+		// NOTE: The queue is only locked to pop a task, the program caches are locked by the search itself
 		bool busy = false;
 		{
 			u32 count = 0;
-			std::lock_guard lock(m_decompiler_mutex);
 
-			while (!m_decompile_queue.empty())
+			while (true)
 			{
-				const auto& decompile_task = m_decompile_queue.front();
-				if (decompile_task.is_fp)
+				std::optional<async_decompile_task_entry> decompile_task;
 				{
-					search_fragment_program(decompile_task.fp);
+					std::lock_guard lock(m_decompiler_mutex);
+					if (m_decompile_queue.empty())
+					{
+						break;
+					}
+
+					decompile_task.emplace(std::move(m_decompile_queue.front()));
+					m_decompile_queue.pop_front();
+				}
+
+				if (decompile_task->is_fp)
+				{
+					search_fragment_program(decompile_task->fp);
 				}
 				else
 				{
-					search_vertex_program(decompile_task.vp);
+					search_vertex_program(decompile_task->vp);
 				}
 
-				m_decompile_queue.pop_front();
-
 				if (++count >= max_decompile_count)
 				{
 					// Allows configurable decompiler 'load'
@@ -372,7 +655,8 @@ public:
 			}
 		}
 
-		async_link_task_entry* link_entry;
+		async_link_task_entry* link_entry = nullptr;
+		std::unique_ptr<async_link_task_entry> deferred_entry;
 		pipeline_key key;
 		{
 			reader_lock lock(m_pipeline_mutex);
@@ -382,151 +666,136 @@ public:
 				link_entry = It->second.get();
 				key = It->first;
 			}
+			else if (!m_deferred_link_order.empty())
+			{
+				lock.upgrade();
+
+				// Skip entries that were moved to the link queue or linked by the render thread in the meantime
+				while (!deferred_entry && !m_deferred_link_order.empty())
+				{
+					key = m_deferred_link_order.front();
+					m_deferred_link_order.pop_front();
+
+					if (const auto found = m_deferred_link_queue.find(key); found != m_deferred_link_queue.end())
+					{
+						if (m_storage.find(key) == m_storage.end())
+						{
+							deferred_entry = std::move(found->second);
+						}
+
+						m_deferred_link_queue.erase(found);
+					}
+				}
+
+				if (!deferred_entry)
+				{
+					return { busy, false };
+				}
+
+				link_entry = deferred_entry.get();
+			}
 			else
 			{
 				return { busy, false };
 			}
 		}
 
+		timeline::scoped_event event("RSX", "Build pipeline (async)");
 		pipeline_storage_type pipeline = backend_traits::build_pipeline(link_entry->vp, link_entry->fp, link_entry->props, std::forward<Args>(args)...);
 		LOG_SUCCESS(RSX, "New program compiled successfully");
 
 		std::lock_guard lock(m_pipeline_mutex);
-		m_storage[key] = std::move(pipeline);
-		m_link_queue.erase(key);
+		m_storage.emplace(key, std::move(pipeline));
+
+		if (!deferred_entry)
+		{
+			m_link_queue.erase(key);
+		}
 
-		return { (busy || !m_link_queue.empty()), true };
+		return { (busy || !m_link_queue.empty() || !m_deferred_link_order.empty()), true };
 	}
 
-	template<typename... Args>
-	pipeline_storage_type& get_graphics_pipeline(
-		const RSXVertexProgram& vertexShader,
-		const RSXFragmentProgram& fragmentShader,
-		pipeline_properties& pipelineProperties,
-		bool allow_async,
-		Args&& ...args
-		)
+	// Queues a precompiled pipeline for async_update, to be linked after any pipeline the render thread is waiting for
+	// Does nothing if the programs are not decompiled yet or the pipeline already exists
+	void add_deferred_pipeline_entry(const RSXVertexProgram& vertexShader, const RSXFragmentProgram& fragmentShader, pipeline_properties pipelineProperties)
 	{
-		const auto &vp_search = search_vertex_program(vertexShader, !allow_async);
-		const auto &fp_search = search_fragment_program(fragmentShader, !allow_async);
+		const auto &vp_search = search_vertex_program(vertexShader, false);
+		const auto &fp_search = search_fragment_program(fragmentShader, false);
 
-		const bool already_existing_fragment_program = std::get<1>(fp_search);
-		const bool already_existing_vertex_program = std::get<1>(vp_search);
-
-		bool link_only = false;
-		m_cache_miss_flag = true;
-		m_program_compiled_flag = false;
-
-		if (!allow_async || (already_existing_vertex_program && already_existing_fragment_program))
+		if (!std::get<1>(vp_search) || !std::get<1>(fp_search))
 		{
-			const vertex_program_type &vertex_program = std::get<0>(vp_search);
-			const fragment_program_type &fragment_program = std::get<0>(fp_search);
+			return;
+		}
 
-			backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
-			pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
+		const vertex_program_type &vertex_program = std::get<0>(vp_search);
+		const fragment_program_type &fragment_program = std::get<0>(fp_search);
 
-			const auto I = m_storage.find(key);
-			if (I != m_storage.end())
-			{
-				m_cache_miss_flag = false;
-				return I->second;
-			}
+		backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
+		pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
 
-			if (allow_async)
-			{
-				// Programs already exist, only linking required
-				link_only = true;
-			}
-			else
-			{
-				LOG_NOTICE(RSX, "Add program (vp id = %d, fp id = %d)", vertex_program.id, fragment_program.id);
-				m_program_compiled_flag = true;
+		std::lock_guard lock(m_pipeline_mutex);
 
-				pipeline_storage_type pipeline = backend_traits::build_pipeline(vertex_program, fragment_program, pipelineProperties, std::forward<Args>(args)...);
-				std::lock_guard lock(m_pipeline_mutex);
-				auto &rtn = m_storage[key] = std::move(pipeline);
-				LOG_SUCCESS(RSX, "New program compiled successfully");
-				return rtn;
-			}
+		if (m_storage.find(key) != m_storage.end() || m_link_queue.find(key) != m_link_queue.end())
+		{
+			return;
 		}
 
-		verify(HERE), allow_async;
-
-		if (link_only)
+		if (m_deferred_link_queue.try_emplace(key, std::make_unique<async_link_task_entry>(vertex_program, fragment_program, pipelineProperties)).second)
 		{
-			const vertex_program_type &vertex_program = std::get<0>(vp_search);
-			const fragment_program_type &fragment_program = std::get<0>(fp_search);
-			pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
-
-			reader_lock lock(m_pipeline_mutex);
-
-			if (m_link_queue.find(key) != m_link_queue.end())
-			{
-				// Already in queue
-				return __null_pipeline_handle;
-			}
-
-			LOG_NOTICE(RSX, "Add program (vp id = %d, fp id = %d)", vertex_program.id, fragment_program.id);
-			m_program_compiled_flag = true;
-
-			lock.upgrade();
-			m_link_queue[key] = std::make_unique<async_link_task_entry>(vertex_program, fragment_program, pipelineProperties);
+			m_deferred_link_order.push_back(key);
 		}
-		else
-		{
-			reader_lock lock(m_decompiler_mutex);
-
-			auto vertex_program_found = std::find_if(m_decompile_queue.begin(), m_decompile_queue.end(), [&](const auto& V)
-			{
-				if (V.is_fp) return false;
-				return program_hash_util::vertex_program_compare()(V.vp, vertexShader);
-			});
-
-			auto fragment_program_found = std::find_if(m_decompile_queue.begin(), m_decompile_queue.end(), [&](const auto& F)
-			{
-				if (!F.is_fp) return false;
-				return program_hash_util::fragment_program_compare()(F.fp, fragmentShader);
-			});
+	}
 
-			const bool add_vertex_program = (vertex_program_found == m_decompile_queue.end());
-			const bool add_fragment_program = (fragment_program_found == m_decompile_queue.end());
+	// Must only be called from the render thread, hits are served from the render thread lookups without locking
+	template<typename... Args>
+	pipeline_storage_type& get_graphics_pipeline(
+		const RSXVertexProgram& vertexShader,
+		const RSXFragmentProgram& fragmentShader,
+		pipeline_properties& pipelineProperties,
+		bool allow_async,
+		Args&& ...args
+		)
+	{
+		const auto vp_found = m_vertex_program_lookup.find(vertexShader);
+		const auto fp_found = m_fragment_program_lookup.find(fragmentShader);
 
-			if (add_vertex_program)
-			{
-				lock.upgrade();
-				m_decompile_queue.emplace_back(vertexShader);
-			}
+		if (vp_found != m_vertex_program_lookup.end() && fp_found != m_fragment_program_lookup.end())
+		{
+			backend_traits::validate_pipeline_properties(*vp_found->second, *fp_found->second, pipelineProperties);
 
-			if (add_fragment_program)
+			const auto I = m_pipeline_lookup.find({ vp_found->second->id, fp_found->second->id, pipelineProperties });
+			if (I != m_pipeline_lookup.end())
 			{
-				lock.upgrade();
-				m_decompile_queue.emplace_back(fragmentShader);
+				m_cache_miss_flag = false;
+				m_program_compiled_flag = false;
+				m_first_use_flag = false;
+				return *I->second;
 			}
 		}
 
-		return __null_pipeline_handle;
+		return find_graphics_pipeline(vertexShader, fragmentShader, pipelineProperties, allow_async, true, std::forward<Args>(args)...);
 	}
 
 	size_t get_fragment_constants_buffer_size(const RSXFragmentProgram &fragmentShader) const
 	{
-		const auto I = m_fragment_shader_cache.find(fragmentShader);
-		if (I != m_fragment_shader_cache.end())
-			return I->second.FragmentConstantOffsetCache.size() * 4 * sizeof(float);
+		const auto found = find_fragment_program(fragmentShader);
+		if (found)
+			return found->FragmentConstantOffsetCache.size() * 4 * sizeof(float);
 		LOG_ERROR(RSX, "Can't retrieve constant offset cache");
 		return 0;
 	}
 
 	void fill_fragment_constants_buffer(gsl::span<f32, gsl::dynamic_range> dst_buffer, const RSXFragmentProgram &fragment_program, bool sanitize = false) const
 	{
-		const auto I = m_fragment_shader_cache.find(fragment_program);
-		if (I == m_fragment_shader_cache.end())
+		const auto found = find_fragment_program(fragment_program);
+		if (!found)
 			return;
 
-		verify(HERE), (dst_buffer.size_bytes() >= ::narrow<int>(I->second.FragmentConstantOffsetCache.size()) * 16);
+		verify(HERE), (dst_buffer.size_bytes() >= ::narrow<int>(found->FragmentConstantOffsetCache.size()) * 16);
 
 		f32* dst = dst_buffer.data();
 		alignas(16) f32 tmp[4];
-		for (size_t offset_in_fragment_program : I->second.FragmentConstantOffsetCache)
+		for (size_t offset_in_fragment_program : found->FragmentConstantOffsetCache)
 		{
 			char* data = (char*)fragment_program.addr + (u32)offset_in_fragment_program;
 			const __m128i vector = _mm_loadu_si128((__m128i*)data);
@@ -573,8 +842,65 @@ public:
 		}
 	}
 
+	// Convert the constants of a fragment program into its upload record (null if the program is not cached, fill the block directly then)
+	// Returns true if they are unchanged since its last upload, which can be bound again (buffer is the current ring buffer)
+	std::pair<fragment_constants_upload*, bool> get_fragment_constants_upload(const RSXFragmentProgram &fragment_program, u64 buffer, bool sanitize = false)
+	{
+		const auto found = find_fragment_program(fragment_program);
+		if (!found)
+			return { nullptr, false };
+
+		m_fragment_constants_scratch.resize(found->FragmentConstantOffsetCache.size());
+		fill_fragment_constants_buffer({ reinterpret_cast<f32*>(m_fragment_constants_scratch.data()), ::narrow<int>(m_fragment_constants_scratch.size() * 4) }, fragment_program, sanitize);
+
+		auto& upload = m_fragment_constants_uploads[found];
+
+		if (upload.data.size() == m_fragment_constants_scratch.size() &&
+			std::memcmp(upload.data.data(), m_fragment_constants_scratch.data(), upload.data.size() * sizeof(v128)) == 0)
+		{
+			return { &upload, upload.buffer == buffer && upload.epoch == m_fragment_constants_epoch };
+		}
+
+		upload.data.swap(m_fragment_constants_scratch);
+		return { &upload, false };
+	}
+
+	// Register a block allocated from the fragment constants ring (any allocation, so wrap-arounds are noticed)
+	void on_fragment_constants_alloc(fragment_constants_upload* upload, u64 buffer, u32 offset)
+	{
+		if (offset <= m_fragment_constants_last_offset)
+		{
+			// Started over from the beginning of the ring
+			m_fragment_constants_epoch++;
+		}
+
+		m_fragment_constants_last_offset = offset;
+
+		if (upload)
+		{
+			upload->buffer = buffer;
+			upload->offset = offset;
+			upload->epoch = m_fragment_constants_epoch;
+		}
+	}
+
+	// Called at each frame or command buffer boundary
+	// The ring releases a block once the work that allocated it completes and knows nothing about later draws binding it again
+	void on_fragment_constants_barrier()
+	{
+		m_fragment_constants_epoch++;
+	}
+
 	void clear()
 	{
+		m_fragment_constants_uploads.clear();
+		m_vertex_program_lookup.clear();
+		m_fragment_program_lookup.clear();
+		m_pipeline_lookup.clear();
 		m_storage.clear();
+
+		std::lock_guard lock(m_pipeline_mutex);
+		m_deferred_link_queue.clear();
+		m_deferred_link_order.clear();
 	}
 };
@@ -29,6 +29,8 @@ enum class FUNCTION {
 	FUNCTION_TEXTURE_SAMPLE2D_GRAD,
 	FUNCTION_TEXTURE_SHADOW2D,
 	FUNCTION_TEXTURE_SHADOW2D_PROJ,
+	FUNCTION_TEXTURE_SHADOW2D_DYNAMIC,
+	FUNCTION_TEXTURE_SHADOW2D_DYNAMIC_PROJ,
 	FUNCTION_TEXTURE_SAMPLECUBE,
 	FUNCTION_TEXTURE_SAMPLECUBE_BIAS,
 	FUNCTION_TEXTURE_SAMPLECUBE_PROJ,
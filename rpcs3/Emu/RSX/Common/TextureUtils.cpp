@@ -1,6 +1,7 @@
 ﻿#include "stdafx.h"
 #include "Emu/Memory/vm.h"
 #include "TextureUtils.h"
+#include "BufferUtils.h"
 #include "../RSXThread.h"
 #include "../rsx_utils.h"
 
@@ -546,6 +547,50 @@ void upload_texture_subresource(gsl::span<gsl::byte> dst_buffer, const rsx_subre
 	}
 }
 
+void upload_texture_subresources(const std::vector<gsl::span<gsl::byte>>& dst_buffers, const std::vector<rsx_subresource_layout>& src_layouts, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of)
+{
+	verify(HERE), dst_buffers.size() == src_layouts.size();
+
+	size_t total_size = 0;
+	for (const auto& layout : src_layouts)
+	{
+		total_size += layout.data.size_bytes();
+	}
+
+	const auto upload_one = [&](u32 index)
+	{
+		upload_texture_subresource(dst_buffers[index], src_layouts[index], format, is_swizzled, vtc_support, dst_row_pitch_multiple_of);
+	};
+
+	if (total_size >= 0x40000)
+	{
+		// Throws on unknown formats, do it here rather than on a helper thread
+		get_format_block_size_in_bytes(format);
+
+		// Start with the largest subresources, the base level usually dominates a mip chain
+		std::vector<u32> order(src_layouts.size());
+		for (u32 i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b)
+		{
+			return src_layouts[a].data.size_bytes() > src_layouts[b].data.size_bytes();
+		});
+
+		if (run_conversion_tasks(::size32(order), [&](u32 index) { upload_one(order[index]); }))
+		{
+			return;
+		}
+	}
+
+	for (u32 i = 0; i < src_layouts.size(); ++i)
+	{
+		upload_one(i);
+	}
+}
+
 /**
  * A texture is stored as an array of blocks, where a block is a pixel for standard texture
  * but is a structure containing several pixels for compressed format
@@ -118,6 +118,12 @@ std::vector<rsx_subresource_layout> get_subresources_layout(const rsx::vertex_te
 
 void upload_texture_subresource(gsl::span<gsl::byte> dst_buffer, const rsx_subresource_layout &src_layout, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of);
 
+/**
+ * Upload every src_layouts[i] to dst_buffers[i].
+ * Subresources are decoded concurrently on the buffer conversion threads when enough data is involved.
+ */
+void upload_texture_subresources(const std::vector<gsl::span<gsl::byte>>& dst_buffers, const std::vector<rsx_subresource_layout>& src_layouts, int format, bool is_swizzled, bool vtc_support, size_t dst_row_pitch_multiple_of);
+
 u8 get_format_block_size_in_bytes(int format);
 u8 get_format_block_size_in_texel(int format);
 u8 get_format_block_size_in_bytes(rsx::surface_color_format format);
@@ -0,0 +1,118 @@
+#pragma once
+#include "Utilities/types.h"
+#include "Utilities/File.h"
+#include "Utilities/mutex.h"
+#include "Utilities/StrFmt.h"
+#include "Utilities/Log.h"
+
+#include <array>
+
+namespace rsx
+{
+	enum class gpu_timer_category : u32
+	{
+		render_pass,    // Draws and clears
+		texture_cache,  // Texture uploads, copies, blits and flushes
+		compute,        // Compute dispatches
+		overlay,        // Native UI and debug text
+		present,        // Copy of the flipped image to the swap chain
+
+		count
+	};
+
+	constexpr u32 gpu_timer_category_count = static_cast<u32>(gpu_timer_category::count);
+
+	// Milliseconds of GPU time per category
+	using gpu_frame_timings = std::array<f32, gpu_timer_category_count>;
+
+	/**
+	 * Sums the intervals measured by a backend's timestamp queries into per-category frame totals.
+	 * Queries are read back a few frames late, intervals are attributed to the frame during which they were read.
+	 * Every frame is appended to gpu_timings.csv in the cache directory, the last one is kept for the performance overlay.
+	 */
+	class gpu_frame_profiler
+	{
+		std::array<u64, gpu_timer_category_count> m_pending_ns{};
+		gpu_frame_timings m_last_frame{};
+		mutable shared_mutex m_mutex;
+
+		fs::file m_trace;
+		bool m_trace_failed = false;
+		u64 m_frame_id = 0;
+
+	public:
+		static const char* get_category_name(gpu_timer_category category)
+		{
+			switch (category)
+			{
+			case gpu_timer_category::render_pass: return "render_pass";
+			case gpu_timer_category::texture_cache: return "texture_cache";
+			case gpu_timer_category::compute: return "compute";
+			case gpu_timer_category::overlay: return "overlay";
+			case gpu_timer_category::present: return "present";
+			default: return "unknown";
+			}
+		}
+
+		void add(gpu_timer_category category, u64 duration_ns)
+		{
+			m_pending_ns[static_cast<u32>(category)] += duration_ns;
+		}
+
+		void end_frame()
+		{
+			gpu_frame_timings timings;
+			f32 total = 0.f;
+
+			for (u32 i = 0; i < gpu_timer_category_count; ++i)
+			{
+				timings[i] = m_pending_ns[i] / 1000000.f;
+				total += timings[i];
+			}
+
+			m_pending_ns.fill(0);
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_last_frame = timings;
+			}
+
+			if (m_trace_failed)
+			{
+				return;
+			}
+
+			if (!m_trace)
+			{
+				if (!m_trace.open(fs::get_cache_dir() + "gpu_timings.csv", fs::rewrite))
+				{
+					LOG_ERROR(RSX, "Failed to open the GPU timings trace file");
+					m_trace_failed = true;
+					return;
+				}
+
+				std::string header = "frame";
+				for (u32 i = 0; i < gpu_timer_category_count; ++i)
+				{
+					header += fmt::format(",%s_ms", get_category_name(static_cast<gpu_timer_category>(i)));
+				}
+
+				m_trace.write(header + ",total_ms\n");
+			}
+
+			std::string row = fmt::format("%u", m_frame_id++);
+			for (const f32 value : timings)
+			{
+				row += fmt::format(",%.3f", value);
+			}
+
+			m_trace.write(row + fmt::format(",%.3f\n", total));
+		}
+
+		gpu_frame_timings get_last_frame() const
+		{
+			reader_lock lock(m_mutex);
+			return m_last_frame;
+		}
+	};
+}
@@ -46,6 +46,7 @@ struct data_heap
 	size_t m_min_guard_size; //If an allocation touches the guard region, reset the heap to avoid going over budget
 	size_t m_current_allocated_size;
 	size_t m_largest_allocated_pool;
+	size_t m_peak_allocated_size; // High-water mark of m_current_allocated_size, kept for tuning heap sizes
 
 	char* m_name;
 public:
@@ -68,6 +69,7 @@ public:
 		m_min_guard_size = min_guard_size;
 		m_current_allocated_size = 0;
 		m_largest_allocated_pool = 0;
+		m_peak_allocated_size = 0;
 	}
 
 	template<int Alignment>
@@ -85,6 +87,7 @@ public:
 		const size_t block_length = (aligned_put_pos - m_put_pos) + alloc_size;
 		m_current_allocated_size += block_length;
 		m_largest_allocated_pool = std::max(m_largest_allocated_pool, block_length);
+		m_peak_allocated_size = std::max(m_peak_allocated_size, m_current_allocated_size);
 
 		if (aligned_put_pos + alloc_size < m_size)
 		{
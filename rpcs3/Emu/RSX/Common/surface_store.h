@@ -6,6 +6,7 @@
 #include "../GCM.h"
 #include "../rsx_utils.h"
 #include <list>
+#include <map>
 
 namespace
 {
@@ -25,6 +26,55 @@ namespace rsx
 		size_t get_packed_pitch(surface_color_format format, u32 width);
 	}
 
+	/**
+	 * Surface storage ordered by base address.
+	 * Tracks the largest memory span ever stored so a surface overlapping an address can only start within that distance below it.
+	 */
+	template <typename storage_type>
+	class surface_ranged_map
+	{
+		using map_type = std::map<u32, storage_type>;
+
+		map_type m_data;
+		u32 m_max_span = 0;
+
+	public:
+		using iterator = typename map_type::iterator;
+
+		iterator begin() { return m_data.begin(); }
+		iterator end() { return m_data.end(); }
+		iterator find(u32 address) { return m_data.find(address); }
+
+		void erase(iterator It) { m_data.erase(It); }
+		void erase(u32 address) { m_data.erase(address); }
+
+		storage_type& operator[](u32 address) { return m_data[address]; }
+
+		void clear()
+		{
+			m_data.clear();
+			m_max_span = 0;
+		}
+
+		// Must be called whenever a surface is stored or its memory footprint changes
+		void on_surface_stored(u32 span)
+		{
+			m_max_span = std::max(m_max_span, span);
+		}
+
+		// Visit every entry that can overlap [start, end], entries are visited in address order
+		template <typename F>
+		void for_each_overlap_candidate(u32 start, u32 end, F&& func)
+		{
+			const u32 first = (start > m_max_span) ? (start - m_max_span) : 0;
+
+			for (auto It = m_data.lower_bound(first); It != m_data.end() && It->first <= end; ++It)
+			{
+				func(*It);
+			}
+		}
+	};
+
 	template<typename Traits>
 	struct surface_store
 	{
@@ -50,10 +100,11 @@ namespace rsx
 		using surface_type = typename Traits::surface_type;
 		using command_list_type = typename Traits::command_list_type;
 		using surface_overlap_info = surface_overlap_info_t<surface_type>;
+		using surface_storage_map = surface_ranged_map<surface_storage_type>;
 
 	protected:
-		std::unordered_map<u32, surface_storage_type> m_render_targets_storage = {};
-		std::unordered_map<u32, surface_storage_type> m_depth_stencil_storage = {};
+		surface_storage_map m_render_targets_storage = {};
+		surface_storage_map m_depth_stencil_storage = {};
 
 		rsx::address_range m_render_targets_memory_range;
 		rsx::address_range m_depth_stencil_memory_range;
@@ -83,7 +134,7 @@ namespace rsx
 			auto insert_new_surface = [&](
 				u32 new_address,
 				deferred_clipped_region<surface_type>& region,
-				std::unordered_map<u32, surface_storage_type>& data)
+				surface_storage_map& data)
 			{
 				verify(HERE), prev_surface;
 				if (prev_surface->read_barrier(cmd); !prev_surface->test())
@@ -116,6 +167,7 @@ namespace rsx
 				verify(HERE), region.target == Traits::get(sink);
 				orphaned_surfaces.push_back(region.target);
 				data[new_address] = std::move(sink);
+				data.on_surface_stored(region.target->get_memory_range().length());
 			};
 
 			// Define incoming region
@@ -189,10 +241,10 @@ namespace rsx
 		void intersect_surface_region(command_list_type cmd, u32 address, surface_type new_surface, surface_type prev_surface)
 		{
 			auto scan_list = [&new_surface, address](const rsx::address_range& mem_range, u64 timestamp_check,
-				std::unordered_map<u32, surface_storage_type>& data) -> std::vector<std::pair<u32, surface_type>>
+				surface_storage_map& data) -> std::vector<std::pair<u32, surface_type>>
 			{
 				std::vector<std::pair<u32, surface_type>> result;
-				for (const auto &e : data)
+				data.for_each_overlap_candidate(mem_range.start, mem_range.end, [&](const auto &e)
 				{
 					auto surface = Traits::get(e.second);
 
@@ -202,34 +254,34 @@ namespace rsx
 						e.second->dirty())
 					{
 						// Do not bother synchronizing with uninitialized data
-						continue;
+						return;
 					}
 
 					// Memory partition check
 					if (mem_range.start >= 0xc0000000)
 					{
-						if (e.first < 0xc0000000) continue;
+						if (e.first < 0xc0000000) return;
 					}
 					else
 					{
-						if (e.first >= 0xc0000000) continue;
+						if (e.first >= 0xc0000000) return;
 					}
 
 					// Pitch check
 					if (!rsx::pitch_compatible(surface, new_surface))
 					{
-						continue;
+						return;
 					}
 
 					// Range check
 					const rsx::address_range this_range = surface->get_memory_range();
 					if (!this_range.overlaps(mem_range))
 					{
-						continue;
+						return;
 					}
 
 					result.push_back({ e.first, surface });
-				}
+				});
 
 				return result;
 			};
@@ -346,7 +398,7 @@ namespace rsx
 			bool store = true;
 
 			address_range *storage_bounds;
-			std::unordered_map<u32, surface_storage_type> *primary_storage, *secondary_storage;
+			surface_storage_map *primary_storage, *secondary_storage;
 			if constexpr (depth)
 			{
 				primary_storage = &m_depth_stencil_storage;
@@ -473,6 +525,9 @@ namespace rsx
 				(*primary_storage)[address] = std::move(new_surface_storage);
 			}
 
+			// Pitch may have changed even if the surface was kept in place
+			primary_storage->on_surface_stored(new_surface->get_memory_range().length());
+
 			verify(HERE), new_surface->get_spp() == get_format_sample_count(antialias);
 			return new_surface;
 		}
@@ -676,27 +731,27 @@ namespace rsx
 			std::vector<std::pair<u32, bool>> dirty;
 			const u32 limit = texaddr + (required_pitch * required_height);
 
-			auto process_list_function = [&](std::unordered_map<u32, surface_storage_type>& data, bool is_depth)
+			auto process_list_function = [&](surface_storage_map& data, bool is_depth)
 			{
-				for (auto &tex_info : data)
+				data.for_each_overlap_candidate(texaddr, limit - 1, [&](auto &tex_info)
 				{
 					const auto this_address = tex_info.first;
 					if (this_address >= limit)
-						continue;
+						return;
 
 					auto surface = tex_info.second.get();
 					const auto pitch = surface->get_rsx_pitch();
 					if (!rsx::pitch_compatible(surface, required_pitch, required_height))
-						continue;
+						return;
 
 					const auto texture_size = pitch * surface->get_surface_height(rsx::surface_metrics::samples);
 					if ((this_address + texture_size) <= texaddr)
-						continue;
+						return;
 
 					if (surface->read_barrier(cmd); !surface->test())
 					{
 						dirty.emplace_back(this_address, is_depth);
-						continue;
+						return;
 					}
 
 					surface_overlap_info info;
@@ -716,7 +771,7 @@ namespace rsx
 						if (UNLIKELY(info.dst_x >= required_width || info.dst_y >= required_height))
 						{
 							// Out of bounds
-							continue;
+							return;
 						}
 
 						info.src_x = 0;
@@ -734,7 +789,7 @@ namespace rsx
 						{
 							// Region lies outside the actual texture area, but inside the 'tile'
 							// In this case, a small region lies to the top-left corner, partially occupying the  target
-							continue;
+							return;
 						}
 
 						info.dst_x = 0;
@@ -753,7 +808,7 @@ namespace rsx
 					}
 
 					result.push_back(info);
-				}
+				});
 			};
 
 			// Range test helper to quickly discard blocks
@@ -93,13 +93,18 @@ namespace rsx
 				auto dst_h = std::get<3>(region);
 
 				// Apply resolution scale if needed
-				if (g_cfg.video.resolution_scale_percent != 100)
+				if (g_cfg.video.resolution_scale_percent != 100 || g_cfg.video.dynamic_resolution_scaling)
 				{
 					auto src = static_cast<T>(source);
-					src_w = rsx::apply_resolution_scale(src_w, true, src->get_surface_width(rsx::surface_metrics::pixels));
-					src_h = rsx::apply_resolution_scale(src_h, true, src->get_surface_height(rsx::surface_metrics::pixels));
-					dst_w = rsx::apply_resolution_scale(dst_w, true, target_surface->get_surface_width(rsx::surface_metrics::pixels));
-					dst_h = rsx::apply_resolution_scale(dst_h, true, target_surface->get_surface_height(rsx::surface_metrics::pixels));
+					const u16 src_native_w = src->get_surface_width(rsx::surface_metrics::pixels);
+					const u16 src_native_h = src->get_surface_height(rsx::surface_metrics::pixels);
+					const u16 dst_native_w = target_surface->get_surface_width(rsx::surface_metrics::pixels);
+					const u16 dst_native_h = target_surface->get_surface_height(rsx::surface_metrics::pixels);
+
+					src_w = rsx::apply_surface_resolution_scale(src_w, true, src_native_w, src_native_w, src->width());
+					src_h = rsx::apply_surface_resolution_scale(src_h, true, src_native_h, src_native_h, src->height());
+					dst_w = rsx::apply_surface_resolution_scale(dst_w, true, dst_native_w, dst_native_w, target_surface->width());
+					dst_h = rsx::apply_surface_resolution_scale(dst_h, true, dst_native_h, dst_native_h, target_surface->height());
 				}
 
 				width = src_w;
@@ -372,13 +377,21 @@ namespace rsx
 			}
 
 			// Apply resolution scale if needed
-			if (g_cfg.video.resolution_scale_percent != 100)
+			if (g_cfg.video.resolution_scale_percent != 100 || g_cfg.video.dynamic_resolution_scaling)
 			{
-				auto src_width = rsx::apply_resolution_scale(old_contents.width, true, old_contents.source->width());
-				auto src_height = rsx::apply_resolution_scale(old_contents.height, true, old_contents.source->height());
+				// The source may have been created with a different scale than this surface
+				const u16 src_native_w = region.source->get_surface_width(rsx::surface_metrics::pixels);
+				const u16 src_native_h = region.source->get_surface_height(rsx::surface_metrics::pixels);
+				const u16 dst_native_w = get_surface_width(rsx::surface_metrics::pixels);
+				const u16 dst_native_h = get_surface_height(rsx::surface_metrics::pixels);
+				const u16 src_scaled_w = old_contents.source->width(), src_scaled_h = old_contents.source->height();
+				const u16 dst_scaled_w = old_contents.target->width(), dst_scaled_h = old_contents.target->height();
 
-				auto dst_width = rsx::apply_resolution_scale(old_contents.width, true, old_contents.target->width());
-				auto dst_height = rsx::apply_resolution_scale(old_contents.height, true, old_contents.target->height());
+				auto src_width = rsx::apply_surface_resolution_scale(old_contents.width, true, src_scaled_w, src_native_w, src_scaled_w);
+				auto src_height = rsx::apply_surface_resolution_scale(old_contents.height, true, src_scaled_h, src_native_h, src_scaled_h);
+
+				auto dst_width = rsx::apply_surface_resolution_scale(old_contents.width, true, dst_scaled_w, dst_native_w, dst_scaled_w);
+				auto dst_height = rsx::apply_surface_resolution_scale(old_contents.height, true, dst_scaled_h, dst_native_h, dst_scaled_h);
 
 				old_contents.transfer_scale_x *= f32(dst_width) / src_width;
 				old_contents.transfer_scale_y *= f32(dst_height) / src_height;
@@ -386,10 +399,10 @@ namespace rsx
 				old_contents.width = src_width;
 				old_contents.height = src_height;
 
-				old_contents.src_x = rsx::apply_resolution_scale(old_contents.src_x, false, old_contents.source->width());
-				old_contents.src_y = rsx::apply_resolution_scale(old_contents.src_y, false, old_contents.source->height());
-				old_contents.dst_x = rsx::apply_resolution_scale(old_contents.dst_x, false, old_contents.target->width());
-				old_contents.dst_y = rsx::apply_resolution_scale(old_contents.dst_y, false, old_contents.target->height());
+				old_contents.src_x = rsx::apply_surface_resolution_scale(old_contents.src_x, false, src_scaled_w, src_native_w, src_scaled_w);
+				old_contents.src_y = rsx::apply_surface_resolution_scale(old_contents.src_y, false, src_scaled_h, src_native_h, src_scaled_h);
+				old_contents.dst_x = rsx::apply_surface_resolution_scale(old_contents.dst_x, false, dst_scaled_w, dst_native_w, dst_scaled_w);
+				old_contents.dst_y = rsx::apply_surface_resolution_scale(old_contents.dst_y, false, dst_scaled_h, dst_native_h, dst_scaled_h);
 			}
 		}
 
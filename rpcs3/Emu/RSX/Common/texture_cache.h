@@ -5,6 +5,9 @@
 #include "texture_cache_predictor.h"
 #include "texture_cache_utils.h"
 #include "TextureUtils.h"
+#include "Utilities/timeline.h"
+
+#include "xxhash.h"
 
 #include <atomic>
 
@@ -44,11 +47,30 @@ namespace rsx
 		};
 
 	public:
+		static constexpr u32 num_invalidation_causes = invalidation_cause::committed_as_fbo + 1;
+
+		// Snapshot of the per-frame counters, used by the debug overlay and the statistics dump
+		struct frame_statistics
+		{
+			u64 frame_id;
+			u32 num_uploads;
+			u64 upload_bytes;
+			u32 num_hits;
+			u32 num_misses;
+			u32 num_flushes;
+			u64 flush_bytes;
+			u64 flush_stall_time; // us
+			std::array<u32, num_invalidation_causes> num_invalidations;
+			u32 num_sections;
+			u64 memory_in_use;
+		};
+
 		//Struct to hold data on sections to be paged back onto cpu memory
 		struct thrashed_set
 		{
 			bool violation_handled = false;
 			bool flushed = false;
+			bool partial_flush = false; // Only the fault range of the single section in sections_to_flush is written back and unprotected
 			invalidation_cause cause;
 			std::vector<section_storage_type*> sections_to_flush; // Sections to be flushed
 			std::vector<section_storage_type*> sections_to_unprotect; // These sections are to be unpotected and discarded by caller
@@ -330,21 +352,46 @@ namespace rsx
 
 		//Store of all objects in a flush_always state. A lazy readback is attempted every draw call
 		std::unordered_map<address_range, section_storage_type*> m_flush_always_cache;
+
+		//Content deduplication. Sections uploaded with identical contents share the image of the first one
+		struct deduplicated_image
+		{
+			section_storage_type *owner = nullptr; // Holds the image resource
+			std::vector<section_storage_type*> aliases; // Sample the owner's image without holding it
+		};
+		std::unordered_map<u64, deduplicated_image> m_deduplicated_images;
 		u64 m_flush_always_update_timestamp = 0;
 
 		//Memory usage
 		const u32 m_max_zombie_objects = 64; //Limit on how many texture objects to keep around for reuse after they are invalidated
+		const u64 m_min_eviction_age = 2; //Number of frames a section must go unused before it can be evicted to stay within the memory budget
+		u64 m_memory_pressure_budget = 0; //Budget derived from host memory pressure reported by the backend, 0 if there is none
+		u64 m_frame_id = 0;
+		frame_statistics m_last_frame_statistics{};
 
 		//Other statistics
 		std::atomic<u32> m_flushes_this_frame = { 0 };
 		std::atomic<u32> m_misses_this_frame  = { 0 };
 		std::atomic<u32> m_speculations_this_frame = { 0 };
 		std::atomic<u32> m_unavoidable_hard_faults_this_frame = { 0 };
+		std::atomic<u32> m_uploads_this_frame = { 0 };
+		std::atomic<u64> m_upload_bytes_this_frame = { 0 };
+		std::atomic<u32> m_texture_hits_this_frame = { 0 };
+		std::atomic<u32> m_texture_misses_this_frame = { 0 };
+		std::atomic<u64> m_flush_bytes_this_frame = { 0 };
+		std::atomic<u64> m_flush_stall_time_this_frame = { 0 };
+		std::array<std::atomic<u32>, num_invalidation_causes> m_invalidations_this_frame = {};
+		fs::file m_statistics_dump;
 		static const u32 m_predict_max_flushes_per_frame = 50; // Above this number the predictions are disabled
 
 		// Invalidation
 		static const bool invalidation_ignore_unsynchronized = true; // If true, unsynchronized sections don't get forcefully flushed unless they overlap the fault range
 		static const bool invalidation_keep_ro_during_read = true; // If true, RO sections are not invalidated during read faults
+#ifdef TEXTURE_CACHE_DEBUG
+		static const bool invalidation_partial_flush = false; // The protection checker works on whole sections and cannot follow partially released ones
+#else
+		static const bool invalidation_partial_flush = true; // If true, strict flushing only writes back and unprotects the faulting pages of a section
+#endif
 
 
 
@@ -358,6 +405,8 @@ namespace rsx
 			rsx::texture_upload_context context, rsx::texture_dimension_extended type, texture_create_flags flags) = 0;
 		virtual section_storage_type* upload_image_from_cpu(commandbuffer_type&, const address_range &rsx_range, u16 width, u16 height, u16 depth, u16 mipmaps, u16 pitch, u32 gcm_format, texture_upload_context context,
 			const std::vector<rsx_subresource_layout>& subresource_layout, rsx::texture_dimension_extended type, bool swizzled) = 0;
+		virtual section_storage_type* create_deduplicated_texture(commandbuffer_type&, const address_range &rsx_range, u64 content_hash, u16 width, u16 height, u16 depth, u16 mipmaps, u16 pitch, u32 gcm_format,
+			rsx::texture_dimension_extended type) = 0;
 		virtual void enforce_surface_creation_type(section_storage_type& section, u32 gcm_format, texture_create_flags expected) = 0;
 		virtual void insert_texture_barrier(commandbuffer_type&, image_storage_type* tex) = 0;
 		virtual image_view_type generate_cubemap_from_images(commandbuffer_type&, u32 gcm_format, u16 size, const std::vector<copy_region_descriptor>& sources, const texture_channel_remap_t& remap_vector) = 0;
@@ -451,6 +500,10 @@ namespace rsx
 		{
 			AUDIT(!data.flushed);
 
+			timeline::scoped_event event("RSX", "Texture cache flush", data.sections_to_flush.size());
+
+			const u64 flush_start = get_system_time();
+
 			if (data.sections_to_flush.size() > 1)
 			{
 				// Sort with oldest data first
@@ -492,6 +545,15 @@ namespace rsx
 				cleanup_after_dma_transfers(cmd);
 			}
 
+			if (data.partial_flush)
+			{
+				AUDIT(data.sections_to_flush.size() == 1 && data.sections_to_exclude.empty());
+				data.sections_to_flush.front()->flush_partial(data.fault_range);
+				data.flushed = true;
+				m_flush_stall_time_this_frame += get_system_time() - flush_start;
+				return;
+			}
+
 			for (auto &surface : data.sections_to_flush)
 			{
 				surface->flush();
@@ -516,6 +578,7 @@ namespace rsx
 			}
 
 			data.flushed = true;
+			m_flush_stall_time_this_frame += get_system_time() - flush_start;
 		}
 
 
@@ -567,6 +630,13 @@ namespace rsx
 			AUDIT(data.invalidate_range.is_page_range());
 			AUDIT(data.is_flushed());
 
+			if (data.partial_flush)
+			{
+				// The section stays locked, only the pages that were written back are released
+				rsx::memory_protect(data.fault_range, utils::protection::rw);
+				return;
+			}
+
 			// Merge ranges to unprotect
 			address_range_vector ranges_to_unprotect;
 			address_range_vector ranges_to_protect_ro;
@@ -754,6 +824,33 @@ namespace rsx
 
 
 		//Invalidate range base implementation
+		// Returns the section that can have only the fault range written back, if it is the only locked section on those pages
+		section_storage_type* get_partial_flush_candidate(const intersecting_set& trampled_set, const address_range& fault_range) const
+		{
+			section_storage_type* candidate = nullptr;
+			for (auto &obj : trampled_set.sections)
+			{
+				if (!obj->is_locked() || !obj->overlaps(fault_range, section_bounds::locked_range))
+					continue;
+
+				if (candidate)
+				{
+					// Overlapping sections need the full invalidation logic
+					return nullptr;
+				}
+
+				candidate = obj;
+			}
+
+			if (!candidate || !candidate->is_flushable() || candidate->is_dirty() ||
+				!candidate->test_memory_head() || !candidate->test_memory_tail())
+			{
+				return nullptr;
+			}
+
+			return candidate->can_flush_partially(fault_range) ? candidate : nullptr;
+		}
+
 		template <typename ...Args>
 		thrashed_set invalidate_range_impl_base(commandbuffer_type& cmd, const address_range &fault_range_in, invalidation_cause cause, Args&&... extras)
 		{
@@ -767,6 +864,10 @@ namespace rsx
 			address_range fault_range = fault_range_in.to_page_range();
 
 			intersecting_set trampled_set = std::move(get_intersecting_set(fault_range));
+			if (!trampled_set.sections.empty())
+			{
+				m_invalidations_this_frame[cause]++;
+			}
 
 			thrashed_set result = {};
 			result.cause = cause;
@@ -827,6 +928,30 @@ namespace rsx
 			}
 
 
+			if (invalidation_partial_flush && g_cfg.video.strict_texture_flushing && !cause.keep_fault_range_protection() && !cause.skip_fbos() && !trampled_set.sections.empty())
+			{
+				if (auto section = get_partial_flush_candidate(trampled_set, fault_range))
+				{
+					update_cache_tag();
+
+					result.sections_to_flush.push_back(section);
+					result.partial_flush = true;
+					result.violation_handled = true;
+
+					if (cause.deferred_flush())
+					{
+						result.num_flushable = 1;
+						result.cache_tag = m_cache_update_tag.load(std::memory_order_consume);
+						return result;
+					}
+
+					flush_set(cmd, result, std::forward<Args>(extras)...);
+					unprotect_set(result);
+					result.clear_sections();
+					return result;
+				}
+			}
+
 			// Decide which sections to flush, unprotect, and exclude
 			if (!trampled_set.sections.empty())
 			{
@@ -1020,9 +1145,21 @@ namespace rsx
 
 		virtual void on_frame_end()
 		{
+			enforce_memory_budget();
+
 			m_temporary_subresource_cache.clear();
 			m_predictor.on_frame_end();
+
+			m_last_frame_statistics = get_frame_statistics();
+
+			if (g_cfg.video.dump_texture_cache_statistics)
+			{
+				dump_frame_statistics(m_last_frame_statistics);
+			}
+
 			reset_frame_statistics();
+
+			m_frame_id++;
 		}
 
 		template <bool check_unlocked = false>
@@ -1434,6 +1571,124 @@ namespace rsx
 			m_storage.purge_unreleased_sections();
 		}
 
+		/**
+		 * Memory budget
+		 */
+		u64 get_memory_budget() const
+		{
+			const u64 budget = u64(g_cfg.video.vram_budget) * 0x100000;
+			if (!m_memory_pressure_budget)
+			{
+				return budget;
+			}
+
+			return budget ? std::min(budget, m_memory_pressure_budget) : m_memory_pressure_budget;
+		}
+
+		// While the device heaps are short on memory, each frame end evicts stale sections until 1/8 of the cached memory is released
+		void set_memory_pressure(bool pressure)
+		{
+			m_memory_pressure_budget = pressure ? (m_storage.m_texture_memory_in_use.load() / 8) * 7 : 0;
+		}
+
+		bool is_over_memory_budget() const
+		{
+			const u64 budget = get_memory_budget();
+			return budget && m_storage.m_texture_memory_in_use > budget;
+		}
+
+	protected:
+		void evict_section(section_storage_type& tex)
+		{
+			AUDIT(tex.is_locked() && tex.get_protection() == utils::protection::ro);
+
+			thrashed_set data;
+			data.cause = invalidation_cause::committed_as_fbo;
+			data.fault_range = data.invalidate_range = tex.get_locked_range();
+
+			tex.set_dirty(true);
+			data.sections_to_unprotect.push_back(&tex);
+
+			// Other sections sharing pages with the evicted one must keep their protection
+			for (auto It = m_storage.range_begin(data.invalidate_range, locked_range, true); It != m_storage.range_end(); It++)
+			{
+				if (&(*It) != &tex)
+				{
+					data.sections_to_exclude.push_back(&(*It));
+				}
+			}
+
+			unprotect_set(data);
+			tex.destroy();
+		}
+
+		void enforce_memory_budget()
+		{
+			if (!is_over_memory_budget())
+				return;
+
+			std::lock_guard lock(m_cache_mutex);
+
+			// Dead sections are the cheapest to drop
+			if (m_storage.m_unreleased_texture_objects)
+			{
+				m_storage.purge_unreleased_sections();
+
+				if (!is_over_memory_budget())
+					return;
+			}
+
+			// Collect read-only sections that were not sampled recently. Their contents can be re-uploaded from guest memory
+			std::vector<section_storage_type*> candidates;
+			for (auto &block : m_storage)
+			{
+				if (block.get_locked_count() == 0)
+					continue;
+
+				for (auto &tex : block)
+				{
+					if (!tex.exists() || !tex.is_locked() || tex.is_dirty() || tex.get_protection() != utils::protection::ro)
+						continue;
+
+					const auto context = tex.get_context();
+					if (context != texture_upload_context::shader_read && context != texture_upload_context::blit_engine_src)
+						continue;
+
+					if (tex.last_use_frame + m_min_eviction_age > m_frame_id)
+						continue;
+
+					candidates.push_back(&tex);
+				}
+			}
+
+			if (candidates.empty())
+				return;
+
+			std::sort(candidates.begin(), candidates.end(), [](const section_storage_type* a, const section_storage_type* b)
+			{
+				return a->last_use_frame < b->last_use_frame;
+			});
+
+			const u64 budget = get_memory_budget();
+			const u64 start_usage = m_storage.m_texture_memory_in_use;
+			u32 evicted = 0;
+
+			update_cache_tag();
+
+			for (auto *tex : candidates)
+			{
+				if (m_storage.m_texture_memory_in_use <= budget)
+					break;
+
+				evict_section(*tex);
+				evicted++;
+			}
+
+			LOG_TRACE(RSX, "Texture cache over budget; evicted %u sections (%lluK -> %lluK)", evicted, start_usage / 1024, m_storage.m_texture_memory_in_use.load() / 1024);
+		}
+
+	public:
+
 		image_view_type create_temporary_subresource(commandbuffer_type &cmd, deferred_subresource& desc)
 		{
 			if (!desc.do_not_cache)
@@ -1684,6 +1939,8 @@ namespace rsx
 					return;
 				}
 
+				section->last_use_frame = m_frame_id;
+
 				const u16 internal_clip_width = u16(std::get<2>(clipped).width * bpp) / section_bpp;
 				if (scaling)
 				{
@@ -2041,6 +2298,8 @@ namespace rsx
 				// Most mesh textures are stored as compressed to make the most of the limited memory
 				if (auto cached_texture = find_texture_from_dimensions(texaddr, format, tex_width, tex_height, depth))
 				{
+					cached_texture->last_use_frame = m_frame_id;
+					on_texture_hit();
 					return{ cached_texture->get_view(tex.remap(), tex.decoded_remap()), cached_texture->get_context(), cached_texture->is_depth_texture(), scale_x, scale_y, cached_texture->get_image_type() };
 				}
 			}
@@ -2067,6 +2326,8 @@ namespace rsx
 				{
 					if (cached_texture->matches(texaddr, format, tex_width, tex_height, depth, 0))
 					{
+						cached_texture->last_use_frame = m_frame_id;
+						on_texture_hit();
 						return{ cached_texture->get_view(tex.remap(), tex.decoded_remap()), cached_texture->get_context(), cached_texture->is_depth_texture(), scale_x, scale_y, cached_texture->get_image_type() };
 					}
 				}
@@ -2183,6 +2444,7 @@ namespace rsx
 								}
 							}
 
+							last->last_use_frame = m_frame_id;
 							return { last->get_raw_texture(), deferred_request_command::copy_image_static, texaddr, gcm_format, 0, 0,
 									tex_width, tex_height, 1, last->get_context(), is_depth,
 									scale_x, scale_y, extended_dimension, tex.decoded_remap() };
@@ -2257,10 +2519,37 @@ namespace rsx
 			//Invalidate
 			invalidate_range_impl_base(cmd, tex_range, invalidation_cause::read, std::forward<Args>(extras)...);
 
+			on_texture_miss();
+
+			const u16 mipmaps = tex.get_exact_mipmap_count();
+			u64 content_hash = 0;
+
+			if (g_cfg.video.texture_deduplication)
+			{
+				content_hash = get_content_hash(tex_range, format, tex_width, tex_height, depth, mipmaps, tex_pitch, extended_dimension, is_swizzled);
+
+				if (const auto owner = get_deduplicated_image_owner(content_hash);
+					owner && !owner->overlaps(tex_range, section_bounds::full_range))
+				{
+					if (auto alias = create_deduplicated_texture(cmd, tex_range, content_hash, tex_width, tex_height, depth, mipmaps, tex_pitch, format, extended_dimension))
+					{
+						return{ alias->get_view(tex.remap(), tex.decoded_remap()), texture_upload_context::shader_read, is_depth_format, scale_x, scale_y, extended_dimension };
+					}
+				}
+			}
+
+			on_upload(tex_range.length());
+
 			//NOTE: SRGB correction is to be handled in the fragment shader; upload as linear RGB
-			return{ upload_image_from_cpu(cmd, tex_range, tex_width, tex_height, depth, tex.get_exact_mipmap_count(), tex_pitch, format,
-				texture_upload_context::shader_read, subresources_layout, extended_dimension, is_swizzled)->get_view(tex.remap(), tex.decoded_remap()),
-				texture_upload_context::shader_read, is_depth_format, scale_x, scale_y, extended_dimension };
+			auto section = upload_image_from_cpu(cmd, tex_range, tex_width, tex_height, depth, mipmaps, tex_pitch, format,
+				texture_upload_context::shader_read, subresources_layout, extended_dimension, is_swizzled);
+
+			if (content_hash)
+			{
+				register_deduplication_owner(*section, content_hash);
+			}
+
+			return{ section->get_view(tex.remap(), tex.decoded_remap()), texture_upload_context::shader_read, is_depth_format, scale_x, scale_y, extended_dimension };
 		}
 
 		template <typename surface_store_type, typename blitter_type, typename ...Args>
@@ -2548,6 +2837,7 @@ namespace rsx
 						(unsigned)dst_area.y2 <= surface->get_height())
 					{
 						cached_dest = surface;
+						cached_dest->last_use_frame = m_frame_id;
 						dest_texture = cached_dest->get_raw_texture();
 						typeless_info.dst_context = cached_dest->get_context();
 
@@ -2646,6 +2936,7 @@ namespace rsx
 					if (src_area.x2 <= surface->get_width() &&
 						src_area.y2 <= surface->get_height())
 					{
+						surface->last_use_frame = m_frame_id;
 						vram_texture = surface->get_raw_texture();
 						typeless_info.src_context = surface->get_context();
 						break;
@@ -2706,6 +2997,7 @@ namespace rsx
 					subresource_layout.push_back(subres);
 
 					const u32 gcm_format = src_is_argb8 ? CELL_GCM_TEXTURE_A8R8G8B8 : CELL_GCM_TEXTURE_R5G6B5;
+					on_upload(rsx_range.length());
 					vram_texture = upload_image_from_cpu(cmd, rsx_range, image_width, image_height, 1, 1, src.pitch, gcm_format, texture_upload_context::blit_engine_src,
 						subresource_layout, rsx::texture_dimension_extended::texture_dimension_2d, dst.swizzled)->get_raw_texture();
 
@@ -2802,6 +3094,7 @@ namespace rsx
 					subres.data = { reinterpret_cast<const gsl::byte*>(vm::base(dst.rsx_address)), dst.pitch * dst_dimensions.height };
 					subresource_layout.push_back(subres);
 
+					on_upload(rsx_range.length());
 					cached_dest = upload_image_from_cpu(cmd, rsx_range, dst_dimensions.width, dst_dimensions.height, 1, 1, dst.pitch,
 						gcm_format, rsx::texture_upload_context::blit_engine_dst, subresource_layout,
 						rsx::texture_dimension_extended::texture_dimension_2d, false);
@@ -2855,36 +3148,43 @@ namespace rsx
 				m_rtts.notify_memory_structure_changed();
 			}
 
-			if (rsx::get_resolution_scale_percent() != 100)
+			if (rsx::get_resolution_scale_percent() != 100 || g_cfg.video.dynamic_resolution_scaling)
 			{
+				// With dynamic scaling each surface keeps the scale it was created at
+				const bool per_surface_scale = !!g_cfg.video.dynamic_resolution_scaling;
 				const f32 resolution_scale = rsx::get_resolution_scale();
+
 				if (src_is_render_target)
 				{
-					if (src_subres.surface->get_surface_width(rsx::surface_metrics::pixels) > g_cfg.video.min_scalable_dimension)
+					if (const u16 native_w = src_subres.surface->get_surface_width(rsx::surface_metrics::pixels); native_w > g_cfg.video.min_scalable_dimension)
 					{
-						src_area.x1 = (u16)(src_area.x1 * resolution_scale);
-						src_area.x2 = (u16)(src_area.x2 * resolution_scale);
+						const f32 scale = per_surface_scale ? f32(src_subres.surface->width()) / native_w : resolution_scale;
+						src_area.x1 = (u16)(src_area.x1 * scale);
+						src_area.x2 = (u16)(src_area.x2 * scale);
 					}
 
-					if (src_subres.surface->get_surface_height(rsx::surface_metrics::pixels) > g_cfg.video.min_scalable_dimension)
+					if (const u16 native_h = src_subres.surface->get_surface_height(rsx::surface_metrics::pixels); native_h > g_cfg.video.min_scalable_dimension)
 					{
-						src_area.y1 = (u16)(src_area.y1 * resolution_scale);
-						src_area.y2 = (u16)(src_area.y2 * resolution_scale);
+						const f32 scale = per_surface_scale ? f32(src_subres.surface->height()) / native_h : resolution_scale;
+						src_area.y1 = (u16)(src_area.y1 * scale);
+						src_area.y2 = (u16)(src_area.y2 * scale);
 					}
 				}
 
 				if (dst_is_render_target)
 				{
-					if (dst_subres.surface->get_surface_width(rsx::surface_metrics::pixels) > g_cfg.video.min_scalable_dimension)
+					if (const u16 native_w = dst_subres.surface->get_surface_width(rsx::surface_metrics::pixels); native_w > g_cfg.video.min_scalable_dimension)
 					{
-						dst_area.x1 = (u16)(dst_area.x1 * resolution_scale);
-						dst_area.x2 = (u16)(dst_area.x2 * resolution_scale);
+						const f32 scale = per_surface_scale ? f32(dst_subres.surface->width()) / native_w : resolution_scale;
+						dst_area.x1 = (u16)(dst_area.x1 * scale);
+						dst_area.x2 = (u16)(dst_area.x2 * scale);
 					}
 
-					if (dst_subres.surface->get_surface_height(rsx::surface_metrics::pixels) > g_cfg.video.min_scalable_dimension)
+					if (const u16 native_h = dst_subres.surface->get_surface_height(rsx::surface_metrics::pixels); native_h > g_cfg.video.min_scalable_dimension)
 					{
-						dst_area.y1 = (u16)(dst_area.y1 * resolution_scale);
-						dst_area.y2 = (u16)(dst_area.y2 * resolution_scale);
+						const f32 scale = per_surface_scale ? f32(dst_subres.surface->height()) / native_h : resolution_scale;
+						dst_area.y1 = (u16)(dst_area.y1 * scale);
+						dst_area.y2 = (u16)(dst_area.y2 * scale);
 					}
 				}
 			}
@@ -2955,6 +3255,11 @@ namespace rsx
 			}
 		}
 
+		u64 get_current_frame_id() const
+		{
+			return m_frame_id;
+		}
+
 		predictor_type& get_predictor()
 		{
 			return m_predictor;
@@ -2976,6 +3281,95 @@ namespace rsx
 		}
 
 
+		/**
+		 * Content deduplication
+		 */
+		u64 get_content_hash(const address_range &rsx_range, u32 gcm_format, u16 width, u16 height, u16 depth, u16 mipmaps, u16 pitch,
+			rsx::texture_dimension_extended type, bool swizzled) const
+		{
+			// Identical bytes only share an image if they also decode to identical texels
+			const struct
+			{
+				u32 gcm_format;
+				u16 width, height, depth, mipmaps, pitch;
+				u8 type, swizzled;
+				u32 length;
+			}
+			key = { gcm_format, width, height, depth, mipmaps, pitch, (u8)type, (u8)swizzled, rsx_range.length() };
+
+			const u64 seed = XXH64(&key, sizeof(key), 0);
+			const u64 hash = XXH64(vm::base(rsx_range.start), rsx_range.length(), seed);
+
+			// Zero marks sections that take no part in deduplication
+			return hash ? hash : 1;
+		}
+
+		section_storage_type* get_deduplicated_image_owner(u64 content_hash) const
+		{
+			const auto found = m_deduplicated_images.find(content_hash);
+			return (found == m_deduplicated_images.end()) ? nullptr : found->second.owner;
+		}
+
+		void register_deduplication_owner(section_storage_type& section, u64 content_hash)
+		{
+			AUDIT(section.content_hash == 0 && content_hash != 0);
+
+			auto &entry = m_deduplicated_images[content_hash];
+			if (entry.owner != nullptr)
+			{
+				// Uploaded separately, the existing owner keeps serving the aliases
+				return;
+			}
+
+			verify(HERE), section.exists() && section.is_managed();
+			section.content_hash = content_hash;
+			entry.owner = &section;
+		}
+
+		void register_deduplication_alias(section_storage_type& section, u64 content_hash)
+		{
+			AUDIT(section.content_hash == 0);
+
+			auto &entry = m_deduplicated_images.at(content_hash);
+			section.content_hash = content_hash;
+			entry.aliases.push_back(&section);
+		}
+
+		// Must be called by the backends before a section lets go of its image
+		void release_deduplicated_image(section_storage_type& section)
+		{
+			if (LIKELY(section.content_hash == 0))
+			{
+				return;
+			}
+
+			const auto found = m_deduplicated_images.find(section.content_hash);
+			verify(HERE), found != m_deduplicated_images.end();
+			section.content_hash = 0;
+
+			auto &entry = found->second;
+			if (entry.owner != &section)
+			{
+				const auto alias = std::find(entry.aliases.begin(), entry.aliases.end(), &section);
+				verify(HERE), alias != entry.aliases.end();
+				entry.aliases.erase(alias);
+				return;
+			}
+
+			if (entry.aliases.empty())
+			{
+				m_deduplicated_images.erase(found);
+				return;
+			}
+
+			// Hand the image over to one of the aliases so the rest keep sampling valid memory
+			auto heir = entry.aliases.back();
+			entry.aliases.pop_back();
+
+			section.transfer_image_ownership(*heir);
+			entry.owner = heir;
+		}
+
 		/**
 		 * Per-frame statistics
 		 */
@@ -2985,6 +3379,95 @@ namespace rsx
 			m_misses_this_frame.store(0u);
 			m_speculations_this_frame.store(0u);
 			m_unavoidable_hard_faults_this_frame.store(0u);
+			m_uploads_this_frame.store(0u);
+			m_upload_bytes_this_frame.store(0u);
+			m_texture_hits_this_frame.store(0u);
+			m_texture_misses_this_frame.store(0u);
+			m_flush_bytes_this_frame.store(0u);
+			m_flush_stall_time_this_frame.store(0u);
+
+			for (auto &count : m_invalidations_this_frame)
+			{
+				count.store(0u);
+			}
+		}
+
+		frame_statistics get_frame_statistics() const
+		{
+			frame_statistics stats;
+			stats.frame_id = m_frame_id;
+			stats.num_uploads = m_uploads_this_frame;
+			stats.upload_bytes = m_upload_bytes_this_frame;
+			stats.num_hits = m_texture_hits_this_frame;
+			stats.num_misses = m_texture_misses_this_frame;
+			stats.num_flushes = m_flushes_this_frame;
+			stats.flush_bytes = m_flush_bytes_this_frame;
+			stats.flush_stall_time = m_flush_stall_time_this_frame;
+			stats.num_sections = m_storage.m_sections_with_resources;
+			stats.memory_in_use = m_storage.m_texture_memory_in_use;
+
+			for (u32 i = 0; i < num_invalidation_causes; ++i)
+			{
+				stats.num_invalidations[i] = m_invalidations_this_frame[i];
+			}
+
+			return stats;
+		}
+
+		// Counters of the frame closed by the last on_frame_end
+		const frame_statistics& get_last_frame_statistics() const
+		{
+			return m_last_frame_statistics;
+		}
+
+		// Appends one CSV row per frame to texture_cache_stats.csv in the cache directory
+		void dump_frame_statistics(const frame_statistics& stats)
+		{
+			if (!m_statistics_dump)
+			{
+				if (!m_statistics_dump.open(fs::get_cache_dir() + "texture_cache_stats.csv", fs::rewrite))
+				{
+					LOG_ERROR(RSX, "Failed to open the texture cache statistics dump file");
+					return;
+				}
+
+				m_statistics_dump.write("frame,uploads,upload_bytes,hits,misses,flushes,flush_bytes,flush_stall_us,"
+					"inv_read,inv_deferred_read,inv_write,inv_deferred_write,inv_unmap,inv_reprotect,inv_superseded_by_fbo,inv_committed_as_fbo,"
+					"sections,memory_bytes\n");
+			}
+
+			std::string row = fmt::format("%u,%u,%u,%u,%u,%u,%u,%u", stats.frame_id, stats.num_uploads, stats.upload_bytes,
+				stats.num_hits, stats.num_misses, stats.num_flushes, stats.flush_bytes, stats.flush_stall_time);
+
+			// Skip invalidation_cause::invalid
+			for (u32 i = 1; i < num_invalidation_causes; ++i)
+			{
+				row += fmt::format(",%u", stats.num_invalidations[i]);
+			}
+
+			row += fmt::format(",%u,%u\n", stats.num_sections, stats.memory_in_use);
+			m_statistics_dump.write(row);
+		}
+
+		void on_upload(u32 bytes)
+		{
+			m_uploads_this_frame++;
+			m_upload_bytes_this_frame += bytes;
+		}
+
+		void on_texture_hit()
+		{
+			m_texture_hits_this_frame++;
+		}
+
+		void on_texture_miss()
+		{
+			m_texture_misses_this_frame++;
+		}
+
+		void on_flush_transfer(u32 bytes)
+		{
+			m_flush_bytes_this_frame += bytes;
 		}
 
 		void on_flush()
@@ -568,6 +568,7 @@ namespace rsx
 	public:
 		std::atomic<u32> m_unreleased_texture_objects = { 0 }; //Number of invalidated objects not yet freed from memory
 		std::atomic<u64> m_texture_memory_in_use = { 0 };
+		std::atomic<u32> m_sections_with_resources = { 0 };
 
 		// Constructor
 		ranged_storage(texture_cache_type *tex_cache) :
@@ -641,6 +642,7 @@ namespace rsx
 
 			AUDIT(m_unreleased_texture_objects == 0);
 			AUDIT(m_texture_memory_in_use == 0);
+			AUDIT(m_sections_with_resources == 0);
 		}
 
 		void purge_unreleased_sections()
@@ -699,6 +701,7 @@ namespace rsx
 		void on_section_resources_created(const section_storage_type &section)
 		{
 			m_texture_memory_in_use += section.get_section_size();
+			m_sections_with_resources++;
 		}
 
 		void on_section_resources_destroyed(const section_storage_type &section)
@@ -706,6 +709,9 @@ namespace rsx
 			u64 size = section.get_section_size();
 			u64 prev_size = m_texture_memory_in_use.fetch_sub(size);
 			ASSERT(prev_size >= size);
+
+			u32 prev_count = m_sections_with_resources--;
+			ASSERT(prev_count > 0);
 		}
 
 		void on_ranged_block_first_section_created(block_type& block)
@@ -999,6 +1005,8 @@ namespace rsx
 	public:
 		u64 cache_tag = 0;
 		u64 last_write_tag = 0;
+		u64 last_use_frame = 0;
+		u64 content_hash = 0; // Non-zero if the image is shared with other sections holding identical data
 
 		~cached_texture_section()
 		{
@@ -1056,6 +1064,8 @@ namespace rsx
 
 			cache_tag = 0ull;
 			last_write_tag = 0ull;
+			last_use_frame = m_tex_cache->get_current_frame_id();
+			AUDIT(content_hash == 0);
 
 			m_predictor_entry = nullptr;
 
@@ -1357,6 +1367,9 @@ namespace rsx
 			u8 *dst = get_ptr<u8>(vm_dst);
 			address_range copy_range = address_range::start_length(vm_dst, len);
 
+			// Written through the sudo mapping, write-tracked textures in the range must still be invalidated
+			rsx::g_protection_batch.mark_written(copy_range);
+
 			if (flush_exclusions.empty() || !copy_range.overlaps(flush_exclusions))
 			{
 				// Normal case = no flush exclusions, or no overlap
@@ -1386,15 +1399,14 @@ namespace rsx
 			}
 		}
 
-		void imp_flush()
+		void imp_flush(const address_range& valid_range)
 		{
 			AUDIT(synchronized);
 
 			ASSERT(real_pitch > 0);
 
 			// Calculate valid range
-			const auto valid_range  = get_confirmed_range();
-			AUDIT(valid_range.valid());
+			AUDIT(valid_range.valid() && valid_range.inside(get_confirmed_range()));
 			const auto valid_length = valid_range.length();
 			const auto valid_offset = valid_range.start - get_section_base();
 			AUDIT(valid_length > 0);
@@ -1423,6 +1435,8 @@ namespace rsx
 				mapped_length = valid_length;
 			}
 
+			m_tex_cache->on_flush_transfer(valid_length);
+
 			// Obtain pointers to the source and destination memory regions
 			u8 *src = static_cast<u8*>(derived()->map_synchronized(mapped_offset, mapped_length));
 			u32 dst = valid_range.start;
@@ -1477,7 +1491,7 @@ namespace rsx
 			ASSERT(synchronized);
 
 			// Copy flush result to guest memory
-			imp_flush();
+			imp_flush(get_confirmed_range());
 
 			// Finish up
 			// Its highly likely that this surface will be reused, so we just leave resources in place
@@ -1487,6 +1501,47 @@ namespace rsx
 			on_flush();
 		}
 
+		bool can_flush_partially(const address_range& page_range) const
+		{
+			AUDIT(page_range.is_page_range());
+
+			if (flushed || !derived()->supports_partial_flush())
+			{
+				return false;
+			}
+
+			// Only worth it if some locked pages remain after this flush
+			address_range_vector released_pages = flush_exclusions;
+			released_pages.merge(page_range);
+			return !get_locked_range().inside(released_pages);
+		}
+
+		// Writes back only the pages in page_range; the rest of the section stays locked and cached
+		void flush_partial(const address_range& page_range)
+		{
+			ASSERT(exists());
+			AUDIT(is_locked() && !flushed);
+			ASSERT(synchronized);
+
+			address_range flush_range = page_range.get_intersect(get_confirmed_range());
+			if (flush_range.valid())
+			{
+				if (real_pitch != rsx_pitch)
+				{
+					// Pitch remapping in imp_flush works on whole rows
+					const u32 row_start = get_section_base() + ((flush_range.start - get_section_base()) / rsx_pitch) * rsx_pitch;
+					flush_range.start = std::max(row_start, get_confirmed_range().start);
+				}
+
+				imp_flush(flush_range);
+				derived()->finish_partial_flush();
+			}
+
+			// The CPU owns these pages from now on, later flushes must not trample them
+			add_flush_exclusion(page_range);
+			m_tex_cache->on_flush();
+		}
+
 		void add_flush_exclusion(const address_range& rng)
 		{
 			AUDIT(exists() && is_locked() && is_flushable());
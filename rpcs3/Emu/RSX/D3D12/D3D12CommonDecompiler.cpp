@@ -55,6 +55,8 @@ std::string getFunctionImp(FUNCTION f)
 		return "$t.SampleGrad($tsampler, $0.x, $1, $2)";
 	case FUNCTION::FUNCTION_TEXTURE_SHADOW2D: //TODO
 	case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_PROJ:
+	case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC:
+	case FUNCTION::FUNCTION_TEXTURE_SHADOW2D_DYNAMIC_PROJ:
 	case FUNCTION::FUNCTION_TEXTURE_SAMPLE2D:
 		return "$t.Sample($tsampler, $0.xy * $t_scale)";
 	case FUNCTION::FUNCTION_TEXTURE_SAMPLE2D_PROJ:
@@ -236,6 +236,26 @@ D3D12GSRender::D3D12GSRender()
 		root_signature_blob->GetBufferSize(),
 		IID_PPV_ARGS(m_shared_root_signature.GetAddressOf()));
 
+	m_shaders_cache = std::make_unique<shader_cache>(m_pso_cache, "d3d12", "v1");
+
+	if (!g_cfg.video.disable_on_disk_shader_cache && !Emu.PPUCache().empty())
+	{
+		// The serialized pipelines are only valid for the adapter and driver version which produced them
+		ComPtr<IDXGIAdapter> device_adapter;
+		DXGI_ADAPTER_DESC desc = {};
+		LARGE_INTEGER driver_version = {};
+
+		if (SUCCEEDED(dxgi_factory->EnumAdapterByLuid(m_device->GetAdapterLuid(), IID_PPV_ARGS(device_adapter.GetAddressOf()))))
+		{
+			device_adapter->GetDesc(&desc);
+			device_adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driver_version);
+		}
+
+		const std::string dir = Emu.PPUCache() + "shaders_cache/";
+		fs::create_path(dir);
+		m_pipeline_library.open(m_device.Get(), dir + fmt::format("d3d12-pipelines-%04x-%04x-%016llx.bin", desc.VendorId, desc.DeviceId, driver_version.QuadPart));
+	}
+
 	m_per_frame_storage[0].init(m_device.Get());
 	m_per_frame_storage[0].reset();
 	m_per_frame_storage[1].init(m_device.Get());
@@ -299,10 +319,14 @@ void D3D12GSRender::on_init_thread()
 		//Init must have failed
 		fmt::throw_exception("No D3D12 device was created");
 	}
+
+	m_shaders_cache->load(nullptr, m_device.Get(), m_shared_root_signature.Get(), &m_pipeline_library);
+	m_pipeline_library.save();
 }
 
 void D3D12GSRender::on_exit()
 {
+	m_pipeline_library.save();
 	GSRender::on_exit();
 }
 
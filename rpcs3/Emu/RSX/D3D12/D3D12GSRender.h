@@ -44,6 +44,8 @@ struct D3D12DLLManagement
 
 class D3D12GSRender : public GSRender
 {
+	using shader_cache = rsx::shaders_cache<D3D12PipelineProperties, PipelineStateObjectCache>;
+
 private:
 	/** D3D12 structures.
 	 * Note: they should be declared in reverse order of destruction
@@ -57,12 +59,15 @@ private:
 
 	ComPtr<ID3D12RootSignature> m_shared_root_signature;
 
+	d3d12_pipeline_library m_pipeline_library;
+
 	// TODO: Use a tree structure to parse more efficiently
 	data_cache m_texture_cache;
 	bool invalidate_address(u32 addr);
 
 	PipelineStateObjectCache m_pso_cache;
 	std::tuple<ComPtr<ID3D12PipelineState>, size_t, size_t> m_current_pso;
+	std::unique_ptr<shader_cache> m_shaders_cache;
 
 	struct
 	{
@@ -37,6 +37,108 @@ void Shader::Compile(const std::string &code, SHADER_TYPE st)
 	}
 }
 
+void d3d12_pipeline_library::open(ID3D12Device *device, const std::string &path)
+{
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(device1.GetAddressOf()))))
+	{
+		LOG_WARNING(RSX, "D3D12: pipeline libraries are not supported by the runtime");
+		return;
+	}
+
+	m_path = path;
+
+	if (fs::file file{ m_path })
+	{
+		m_data = file.to_vector<u8>();
+	}
+
+	if (!m_data.empty())
+	{
+		const HRESULT hr = device1->CreatePipelineLibrary(m_data.data(), m_data.size(), IID_PPV_ARGS(m_library.GetAddressOf()));
+
+		if (SUCCEEDED(hr))
+		{
+			return;
+		}
+
+		// Driver update or corrupted file
+		LOG_NOTICE(RSX, "D3D12: discarding pipeline library %s (0x%x)", m_path, (u32)hr);
+		m_data.clear();
+		m_dirty = true;
+	}
+
+	if (FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_library.ReleaseAndGetAddressOf()))))
+	{
+		LOG_ERROR(RSX, "D3D12: failed to create a pipeline library");
+		m_library.Reset();
+	}
+}
+
+ComPtr<ID3D12PipelineState> d3d12_pipeline_library::get_or_create(ID3D12Device *device, const std::wstring &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+	ComPtr<ID3D12PipelineState> pso;
+
+	if (!m_library)
+	{
+		CHECK_HRESULT(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+		return pso;
+	}
+
+	// Loads of the same pipeline must not race, the library synchronizes everything else
+	std::lock_guard lock(m_mutex);
+
+	if (SUCCEEDED(m_library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf()))))
+	{
+		return pso;
+	}
+
+	CHECK_HRESULT(device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.ReleaseAndGetAddressOf())));
+
+	if (SUCCEEDED(m_library->StorePipeline(name.c_str(), pso.Get())))
+	{
+		m_dirty = true;
+	}
+
+	return pso;
+}
+
+void d3d12_pipeline_library::save()
+{
+	std::lock_guard lock(m_mutex);
+
+	if (!m_library || !m_dirty || m_path.empty())
+	{
+		return;
+	}
+
+	std::vector<u8> data(m_library->GetSerializedSize());
+
+	if (FAILED(m_library->Serialize(data.data(), data.size())))
+	{
+		LOG_ERROR(RSX, "D3D12: failed to serialize the pipeline library");
+		return;
+	}
+
+	// Write a copy and replace the file, so that an interrupted write doesn't lose the library
+	const std::string tmp = m_path + ".tmp";
+
+	bool written = false;
+
+	if (fs::file out{ tmp, fs::rewrite })
+	{
+		written = out.write(data.data(), data.size()) == data.size();
+	}
+
+	if (!written || !fs::rename(tmp, m_path, true))
+	{
+		LOG_ERROR(RSX, "D3D12: failed to write pipeline library %s (%s)", m_path, fs::g_tls_error);
+		return;
+	}
+
+	m_dirty = false;
+}
+
 void D3D12GSRender::load_program()
 {
 	auto rtt_lookup_func = [this](u32 texaddr, rsx::fragment_texture&, bool is_depth) -> std::tuple<bool, u16>
@@ -310,8 +412,20 @@ void D3D12GSRender::load_program()
 		}
 	}
 
-	m_current_pso = m_pso_cache.get_graphics_pipeline(current_vertex_program, current_fragment_program, prop, false, m_device.Get(), m_shared_root_signature.Get());
-	return;
+	m_current_pso = m_pso_cache.get_graphics_pipeline(current_vertex_program, current_fragment_program, prop, false, m_device.Get(), m_shared_root_signature.Get(), &m_pipeline_library);
+
+	if (m_pso_cache.check_cache_missed())
+	{
+		if (m_pso_cache.check_program_linked_flag())
+		{
+			m_shaders_cache->store(prop, current_vertex_program, current_fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
+		}
+	}
+	else if (m_pso_cache.check_first_use_flag())
+	{
+		// Feeds the precompilation order of the next boot
+		m_shaders_cache->record_use(prop, current_vertex_program, current_fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
+	}
 }
 
 std::pair<std::string, std::string> D3D12GSRender::get_programs() const
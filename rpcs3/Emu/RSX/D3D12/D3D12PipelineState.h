@@ -4,6 +4,8 @@
 #include "../Common/ProgramStateCache.h"
 #include "D3D12VertexProgramDecompiler.h"
 #include "D3D12FragmentProgramDecompiler.h"
+#include "Utilities/hash.h"
+#include "Utilities/mutex.h"
 
 struct D3D12PipelineProperties
 {
@@ -89,6 +91,36 @@ public:
 	void Compile(const std::string &code, enum class SHADER_TYPE st);
 };
 
+/**
+ * Pipeline state objects persisted with ID3D12PipelineLibrary.
+ * The serialized library is only valid for the adapter and driver it was created with, both are part of the file name.
+ * Data rejected by the runtime (e.g. after a driver update) is discarded and the library starts empty.
+ */
+class d3d12_pipeline_library
+{
+	// Serialized library, has to outlive m_library (members are destroyed in reverse order)
+	std::vector<u8> m_data;
+
+	ComPtr<ID3D12PipelineLibrary> m_library;
+
+	std::string m_path;
+	shared_mutex m_mutex;
+	bool m_dirty = false;
+
+public:
+	void open(ID3D12Device *device, const std::string &path);
+
+	/**
+	 * Load the pipeline from the library, or create it and add it to the library.
+	 */
+	ComPtr<ID3D12PipelineState> get_or_create(ID3D12Device *device, const std::wstring &name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+
+	/**
+	 * Write the library back to disk if pipelines were added.
+	 */
+	void save();
+};
+
 static
 bool has_attribute(size_t attribute, const std::vector<D3D12_INPUT_ELEMENT_DESC> &desc)
 {
@@ -154,7 +186,7 @@ struct D3D12Traits
 	static
 	pipeline_storage_type build_pipeline(
 		const vertex_program_type &vertexProgramData, const fragment_program_type &fragmentProgramData, const pipeline_properties &pipelineProperties,
-		ID3D12Device *device, ID3D12RootSignature* root_signatures)
+		ID3D12Device *device, ID3D12RootSignature* root_signatures, d3d12_pipeline_library* library)
 	{
 		std::tuple<ID3D12PipelineState *, std::vector<size_t>, size_t> result = {};
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicPipelineStateDesc = {};
@@ -188,7 +220,31 @@ struct D3D12Traits
 		graphicPipelineStateDesc.IBStripCutValue = pipelineProperties.CutValue;
 
 		ComPtr<ID3D12PipelineState> pso;
-		CHECK_HRESULT(device->CreateGraphicsPipelineState(&graphicPipelineStateDesc, IID_PPV_ARGS(pso.GetAddressOf())));
+
+		if (library)
+		{
+			// Keyed by content, program ids change between runs (FNV-1a 64-bit, the names are stored on disk)
+			const auto hash_blob = [](const ComPtr<ID3DBlob> &blob)
+			{
+				const u8* data = static_cast<const u8*>(blob->GetBufferPointer());
+				u64 result = 14695981039346656037ull;
+
+				for (size_t i = 0; i < blob->GetBufferSize(); i++)
+				{
+					result ^= data[i];
+					result *= 1099511628211ull;
+				}
+
+				return result;
+			};
+
+			const std::string key = fmt::format("PSO_%016llx_%016llx_%016llx", hash_blob(vertexProgramData.bytecode), hash_blob(fragmentProgramData.bytecode), rpcs3::hash_struct(pipelineProperties));
+			pso = library->get_or_create(device, std::wstring(key.begin(), key.end()), graphicPipelineStateDesc);
+		}
+		else
+		{
+			CHECK_HRESULT(device->CreateGraphicsPipelineState(&graphicPipelineStateDesc, IID_PPV_ARGS(pso.GetAddressOf())));
+		}
 
 		std::wstring name = L"PSO_" + std::to_wstring(vertexProgramData.id) + L"_" + std::to_wstring(fragmentProgramData.id);
 		pso->SetName(name.c_str());
@@ -198,4 +254,41 @@ struct D3D12Traits
 
 class PipelineStateObjectCache : public program_state_cache<D3D12Traits>
 {
+public:
+	u64 get_hash(D3D12PipelineProperties &props)
+	{
+		return rpcs3::hash_struct<D3D12PipelineProperties>(props);
+	}
+
+	u64 get_hash(RSXVertexProgram &prog)
+	{
+		return program_hash_util::vertex_program_utils::get_vertex_program_ucode_hash(prog);
+	}
+
+	u64 get_hash(RSXFragmentProgram &prog)
+	{
+		return program_hash_util::fragment_program_utils::get_fragment_program_ucode_hash(prog);
+	}
+
+	template <typename... Args>
+	void add_pipeline_entry(RSXVertexProgram &vp, RSXFragmentProgram &fp, D3D12PipelineProperties &props, Args&& ...args)
+	{
+		vp.skip_vertex_input_check = true;
+		find_graphics_pipeline(vp, fp, props, false, false, std::forward<Args>(args)...);
+	}
+
+	bool check_cache_missed() const
+	{
+		return m_cache_miss_flag;
+	}
+
+	bool check_program_linked_flag() const
+	{
+		return m_program_compiled_flag;
+	}
+
+	bool check_first_use_flag() const
+	{
+		return m_first_use_flag;
+	}
 };
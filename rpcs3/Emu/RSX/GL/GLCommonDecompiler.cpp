@@ -1,5 +1,7 @@
 #include "stdafx.h"
+#include "Emu/System.h"
 #include "GLCommonDecompiler.h"
+#include "GLHelpers.h"
 
 namespace gl
 {
@@ -36,4 +38,16 @@ namespace gl
 
 		fmt::throw_exception("Unknown register name: %s" HERE, varying_register_name);
 	}
+
+	u64 get_decompiler_device_key()
+	{
+		const auto& driver_caps = gl::get_driver_caps();
+		const bool native_half = !g_cfg.video.disable_native_float16 && (driver_caps.NV_gpu_shader5_supported || driver_caps.AMD_gpu_shader_half_float_supported);
+
+		return (native_half ? 1 : 0) |
+			(driver_caps.NV_gpu_shader5_supported ? 2 : 0) |
+			(driver_caps.AMD_gpu_shader_half_float_supported ? 4 : 0) |
+			(driver_caps.vendor_NVIDIA ? 8 : 0) |
+			(driver_caps.vendor_INTEL ? 16 : 0);
+	}
 }
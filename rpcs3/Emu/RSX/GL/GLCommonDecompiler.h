@@ -1,6 +1,10 @@
 #pragma once
+#include "../Common/DecompiledProgramCache.h"
 
 namespace gl
 {
 	int get_varying_register_location(std::string_view varying_register_name);
+
+	// Decompiled program cache key bits for the driver options the decompilers depend on
+	u64 get_decompiler_device_key();
 }
@@ -7,6 +7,10 @@
 
 namespace gl
 {
+	/**
+	 * Shadow copy of the driver state set by the renderer. Setters only reach the driver when the value changes.
+	 * Code that changes shadowed state with raw GL calls must either restore it or invalidate the property.
+	 */
 	struct driver_state
 	{
 		const u32 DEPTH_BOUNDS_MIN = 0xFFFF0001;
@@ -17,13 +21,21 @@ namespace gl
 		std::unordered_map<GLenum, u32> properties = {};
 		std::unordered_map<GLenum, std::array<u32, 4>> indexed_properties = {};
 
+		// Shadowed calls forwarded to the driver and skipped since the last reset_statistics()
+		u32 num_issued_calls = 0;
+		u32 num_elided_calls = 0;
+
 		bool enable(u32 test, GLenum cap)
 		{
 			auto found = properties.find(cap);
 			if (found != properties.end() && found->second == test)
+			{
+				num_elided_calls++;
 				return !!test;
+			}
 
 			properties[cap] = test;
+			num_issued_calls++;
 
 			if (test)
 				glEnable(cap);
@@ -46,11 +58,16 @@ namespace gl
 			else
 			{
 				if (found->second[index] == test)
+				{
+					num_elided_calls++;
 					return !!test;
+				}
 
 				found->second[index] = test;
 			}
 
+			num_issued_calls++;
+
 			if (test)
 				glEnablei(cap, index);
 			else
@@ -68,59 +85,174 @@ namespace gl
 			return (found->second == test);
 		}
 
+		// Records the new values and returns true if any of them differs from the shadow copy
+		template <typename... Args>
+		bool update_properties(Args... property_value_pairs)
+		{
+			static_assert(sizeof...(Args) % 2 == 0, "Expected property/value pairs");
+
+			const std::array<u32, sizeof...(Args)> args = { static_cast<u32>(property_value_pairs)... };
+			bool changed = false;
+
+			for (u32 n = 0; n < args.size(); n += 2)
+			{
+				if (!test_property(args[n], args[n + 1]))
+				{
+					properties[args[n]] = args[n + 1];
+					changed = true;
+				}
+			}
+
+			if (changed)
+				num_issued_calls++;
+			else
+				num_elided_calls++;
+
+			return changed;
+		}
+
+		bool update_indexed_property(GLenum property, const std::array<u32, 4>& value)
+		{
+			auto found = indexed_properties.find(property);
+			if (found != indexed_properties.end() && found->second == value)
+			{
+				num_elided_calls++;
+				return false;
+			}
+
+			indexed_properties[property] = value;
+			num_issued_calls++;
+			return true;
+		}
+
+		// Forgets the shadowed value, the next setter call always reaches the driver
+		void invalidate(GLenum property)
+		{
+			properties.erase(property);
+			indexed_properties.erase(property);
+		}
+
+		void reset_statistics()
+		{
+			num_issued_calls = 0;
+			num_elided_calls = 0;
+		}
+
 		void depth_func(GLenum func)
 		{
-			if (!test_property(GL_DEPTH_FUNC, func))
+			if (update_properties(GL_DEPTH_FUNC, func))
 			{
 				glDepthFunc(func);
-				properties[GL_DEPTH_FUNC] = func;
 			}
 		}
 
 		void depth_mask(GLboolean mask)
 		{
-			if (!test_property(GL_DEPTH_WRITEMASK, mask))
+			if (update_properties(GL_DEPTH_WRITEMASK, mask))
 			{
 				glDepthMask(mask);
-				properties[GL_DEPTH_WRITEMASK] = mask;
 			}
 		}
 
 		void clear_depth(GLfloat depth)
 		{
 			u32 value = std::bit_cast<u32>(depth);
-			if (!test_property(GL_DEPTH_CLEAR_VALUE, value))
+			if (update_properties(GL_DEPTH_CLEAR_VALUE, value))
 			{
 				glClearDepth(depth);
-				properties[GL_DEPTH_CLEAR_VALUE] = value;
 			}
 		}
 
 		void stencil_mask(GLuint mask)
 		{
-			if (!test_property(GL_STENCIL_WRITEMASK, mask))
+			if (update_properties(GL_STENCIL_WRITEMASK, mask, GL_STENCIL_BACK_WRITEMASK, mask))
 			{
 				glStencilMask(mask);
-				properties[GL_STENCIL_WRITEMASK] = mask;
+			}
+		}
+
+		void stencil_mask_separate(GLenum face, GLuint mask)
+		{
+			if (face == GL_FRONT_AND_BACK)
+			{
+				stencil_mask(mask);
+				return;
+			}
+
+			if (update_properties((face == GL_BACK) ? GL_STENCIL_BACK_WRITEMASK : GL_STENCIL_WRITEMASK, mask))
+			{
+				glStencilMaskSeparate(face, mask);
+			}
+		}
+
+		void stencil_func(GLenum func, GLint ref, GLuint mask)
+		{
+			if (update_properties(GL_STENCIL_FUNC, func, GL_STENCIL_REF, ref, GL_STENCIL_VALUE_MASK, mask,
+				GL_STENCIL_BACK_FUNC, func, GL_STENCIL_BACK_REF, ref, GL_STENCIL_BACK_VALUE_MASK, mask))
+			{
+				glStencilFunc(func, ref, mask);
+			}
+		}
+
+		void stencil_func_separate(GLenum face, GLenum func, GLint ref, GLuint mask)
+		{
+			if (face == GL_FRONT_AND_BACK)
+			{
+				stencil_func(func, ref, mask);
+				return;
+			}
+
+			const bool changed = (face == GL_BACK) ?
+				update_properties(GL_STENCIL_BACK_FUNC, func, GL_STENCIL_BACK_REF, ref, GL_STENCIL_BACK_VALUE_MASK, mask) :
+				update_properties(GL_STENCIL_FUNC, func, GL_STENCIL_REF, ref, GL_STENCIL_VALUE_MASK, mask);
+
+			if (changed)
+			{
+				glStencilFuncSeparate(face, func, ref, mask);
+			}
+		}
+
+		void stencil_op(GLenum fail, GLenum zfail, GLenum zpass)
+		{
+			if (update_properties(GL_STENCIL_FAIL, fail, GL_STENCIL_PASS_DEPTH_FAIL, zfail, GL_STENCIL_PASS_DEPTH_PASS, zpass,
+				GL_STENCIL_BACK_FAIL, fail, GL_STENCIL_BACK_PASS_DEPTH_FAIL, zfail, GL_STENCIL_BACK_PASS_DEPTH_PASS, zpass))
+			{
+				glStencilOp(fail, zfail, zpass);
+			}
+		}
+
+		void stencil_op_separate(GLenum face, GLenum fail, GLenum zfail, GLenum zpass)
+		{
+			if (face == GL_FRONT_AND_BACK)
+			{
+				stencil_op(fail, zfail, zpass);
+				return;
+			}
+
+			const bool changed = (face == GL_BACK) ?
+				update_properties(GL_STENCIL_BACK_FAIL, fail, GL_STENCIL_BACK_PASS_DEPTH_FAIL, zfail, GL_STENCIL_BACK_PASS_DEPTH_PASS, zpass) :
+				update_properties(GL_STENCIL_FAIL, fail, GL_STENCIL_PASS_DEPTH_FAIL, zfail, GL_STENCIL_PASS_DEPTH_PASS, zpass);
+
+			if (changed)
+			{
+				glStencilOpSeparate(face, fail, zfail, zpass);
 			}
 		}
 
 		void clear_stencil(GLint stencil)
 		{
 			u32 value = std::bit_cast<u32>(stencil);
-			if (!test_property(GL_STENCIL_CLEAR_VALUE, value))
+			if (update_properties(GL_STENCIL_CLEAR_VALUE, value))
 			{
 				glClearStencil(stencil);
-				properties[GL_STENCIL_CLEAR_VALUE] = value;
 			}
 		}
 
 		void color_mask(u32 mask)
 		{
-			if (!test_property(GL_COLOR_WRITEMASK, mask))
+			if (update_properties(GL_COLOR_WRITEMASK, mask))
 			{
 				glColorMask(((mask & 0x10) ? 1 : 0), ((mask & 0x20) ? 1 : 0), ((mask & 0x40) ? 1 : 0), ((mask & 0x80) ? 1 : 0));
-				properties[GL_COLOR_WRITEMASK] = mask;
 			}
 		}
 
@@ -138,10 +270,9 @@ namespace gl
 		void clear_color(u8 r, u8 g, u8 b, u8 a)
 		{
 			u32 value = (u32)r | (u32)g << 8 | (u32)b << 16 | (u32)a << 24;
-			if (!test_property(GL_COLOR_CLEAR_VALUE, value))
+			if (update_properties(GL_COLOR_CLEAR_VALUE, value))
 			{
 				glClearColor(r / 255.f, g / 255.f, b / 255.f, a / 255.f);
-				properties[GL_COLOR_CLEAR_VALUE] = value;
 			}
 		}
 
@@ -150,17 +281,38 @@ namespace gl
 			clear_color(u8(color.r * 255), u8(color.g * 255), u8(color.b * 255), u8(color.a * 255));
 		}
 
+		void blend_func_separate(GLenum src_rgb, GLenum dst_rgb, GLenum src_a, GLenum dst_a)
+		{
+			if (update_properties(GL_BLEND_SRC_RGB, src_rgb, GL_BLEND_DST_RGB, dst_rgb, GL_BLEND_SRC_ALPHA, src_a, GL_BLEND_DST_ALPHA, dst_a))
+			{
+				glBlendFuncSeparate(src_rgb, dst_rgb, src_a, dst_a);
+			}
+		}
+
+		void blend_equation_separate(GLenum mode_rgb, GLenum mode_a)
+		{
+			if (update_properties(GL_BLEND_EQUATION_RGB, mode_rgb, GL_BLEND_EQUATION_ALPHA, mode_a))
+			{
+				glBlendEquationSeparate(mode_rgb, mode_a);
+			}
+		}
+
+		void blend_color(f32 r, f32 g, f32 b, f32 a)
+		{
+			if (update_indexed_property(GL_BLEND_COLOR, { std::bit_cast<u32>(r), std::bit_cast<u32>(g), std::bit_cast<u32>(b), std::bit_cast<u32>(a) }))
+			{
+				glBlendColor(r, g, b, a);
+			}
+		}
+
 		void depth_bounds(float min, float max)
 		{
 			u32 depth_min = std::bit_cast<u32>(min);
 			u32 depth_max = std::bit_cast<u32>(max);
 
-			if (!test_property(DEPTH_BOUNDS_MIN, depth_min) || !test_property(DEPTH_BOUNDS_MAX, depth_max))
+			if (update_properties(DEPTH_BOUNDS_MIN, depth_min, DEPTH_BOUNDS_MAX, depth_max))
 			{
 				glDepthBoundsEXT(min, max);
-
-				properties[DEPTH_BOUNDS_MIN] = depth_min;
-				properties[DEPTH_BOUNDS_MAX] = depth_max;
 			}
 		}
 
@@ -169,21 +321,17 @@ namespace gl
 			u32 depth_min = std::bit_cast<u32>(min);
 			u32 depth_max = std::bit_cast<u32>(max);
 
-			if (!test_property(DEPTH_RANGE_MIN, depth_min) || !test_property(DEPTH_RANGE_MAX, depth_max))
+			if (update_properties(DEPTH_RANGE_MIN, depth_min, DEPTH_RANGE_MAX, depth_max))
 			{
 				glDepthRange(min, max);
-
-				properties[DEPTH_RANGE_MIN] = depth_min;
-				properties[DEPTH_RANGE_MAX] = depth_max;
 			}
 		}
 
 		void logic_op(GLenum op)
 		{
-			if (!test_property(GL_COLOR_LOGIC_OP, op))
+			if (update_properties(GL_COLOR_LOGIC_OP, op))
 			{
 				glLogicOp(op);
-				properties[GL_COLOR_LOGIC_OP] = op;
 			}
 		}
 
@@ -191,28 +339,25 @@ namespace gl
 		{
 			u32 value = std::bit_cast<u32>(width);
 
-			if (!test_property(GL_LINE_WIDTH, value))
+			if (update_properties(GL_LINE_WIDTH, value))
 			{
 				glLineWidth(width);
-				properties[GL_LINE_WIDTH] = value;
 			}
 		}
 
 		void front_face(GLenum face)
 		{
-			if (!test_property(GL_FRONT_FACE, face))
+			if (update_properties(GL_FRONT_FACE, face))
 			{
 				glFrontFace(face);
-				properties[GL_FRONT_FACE] = face;
 			}
 		}
 
 		void cull_face(GLenum mode)
 		{
-			if (!test_property(GL_CULL_FACE_MODE, mode))
+			if (update_properties(GL_CULL_FACE_MODE, mode))
 			{
 				glCullFace(mode);
-				properties[GL_CULL_FACE_MODE] = mode;
 			}
 		}
 
@@ -221,12 +366,50 @@ namespace gl
 			u32 _units = std::bit_cast<u32>(units);
 			u32 _factor = std::bit_cast<u32>(factor);
 
-			if (!test_property(GL_POLYGON_OFFSET_UNITS, _units) || !test_property(GL_POLYGON_OFFSET_FACTOR, _factor))
+			if (update_properties(GL_POLYGON_OFFSET_UNITS, _units, GL_POLYGON_OFFSET_FACTOR, _factor))
 			{
 				glPolygonOffset(factor, units);
+			}
+		}
+
+		void primitive_restart_index(GLuint index)
+		{
+			if (update_properties(GL_PRIMITIVE_RESTART_INDEX, index))
+			{
+				glPrimitiveRestartIndex(index);
+			}
+		}
+
+		void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+		{
+			if (update_indexed_property(GL_VIEWPORT, { u32(x), u32(y), u32(width), u32(height) }))
+			{
+				glViewport(x, y, width, height);
+			}
+		}
 
-				properties[GL_POLYGON_OFFSET_UNITS] = _units;
-				properties[GL_POLYGON_OFFSET_FACTOR] = _factor;
+		void scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+		{
+			if (update_indexed_property(GL_SCISSOR_BOX, { u32(x), u32(y), u32(width), u32(height) }))
+			{
+				glScissor(x, y, width, height);
+			}
+		}
+
+		void use_program(GLuint program)
+		{
+			if (update_properties(GL_CURRENT_PROGRAM, program))
+			{
+				glUseProgram(program);
+			}
+		}
+
+		// Element array bindings are vertex array object state, this assumes the renderer's VAO is the one bound
+		void bind_element_array(GLuint buffer)
+		{
+			if (update_properties(GL_ELEMENT_ARRAY_BUFFER_BINDING, buffer))
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
 			}
 		}
 	};
@@ -384,6 +384,17 @@ GLFragmentProgram::~GLFragmentProgram()
 
 void GLFragmentProgram::Decompile(const RSXFragmentProgram& prog)
 {
+	auto& cache = rsx::get_decompiled_program_cache();
+	const u64 key = rsx::decompiled_program_cache::get_key(prog, gl::get_decompiler_device_key());
+
+	rsx::decompiled_program cached;
+	if (cache.find(key, cached))
+	{
+		shader = std::move(cached.source);
+		FragmentConstantOffsetCache.assign(cached.constant_offsets.begin(), cached.constant_offsets.end());
+		return;
+	}
+
 	u32 size;
 	GLFragmentDecompilerThread decompiler(shader, parr, prog, size);
 
@@ -409,6 +420,10 @@ void GLFragmentProgram::Decompile(const RSXFragmentProgram& prog)
 			FragmentConstantOffsetCache.push_back(offset);
 		}
 	}
+
+	cached.source = shader;
+	cached.constant_offsets.assign(FragmentConstantOffsetCache.begin(), FragmentConstantOffsetCache.end());
+	cache.store(key, cached);
 }
 
 void GLFragmentProgram::Compile()
@@ -428,6 +443,15 @@ void GLFragmentProgram::Compile()
 	glShaderSource(id, 1, &str, &strlen);
 	glCompileShader(id);
 
+	// Querying the status would wait for the compiler threads, it is checked when the program is linked instead
+	if (!gl::get_driver_caps().KHR_parallel_shader_compile_supported)
+	{
+		Validate();
+	}
+}
+
+void GLFragmentProgram::Validate() const
+{
 	GLint compileStatus = GL_FALSE;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &compileStatus); // Determine the result of the glCompileShader call
 	if (compileStatus != GL_TRUE) // If the shader failed to compile...
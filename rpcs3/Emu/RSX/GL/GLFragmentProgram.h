@@ -57,6 +57,9 @@ public:
 	/** Compile the decompiled fragment shader into a format we can use with OpenGL. */
 	void Compile();
 
+	/** Checks the compile result, logs the fragment shader and pauses emulation on failure. */
+	void Validate() const;
+
 private:
 	/** Deletes the shader and any stored information */
 	void Delete();
@@ -6,6 +6,7 @@
 #include "../rsx_methods.h"
 #include "../Common/BufferUtils.h"
 #include "../rsx_utils.h"
+#include "../Common/DecompiledProgramCache.h"
 
 #define DUMP_VERTEX_DATA 0
 
@@ -31,6 +32,9 @@ GLGSRender::GLGSRender() : GSRender()
 {
 	m_shaders_cache = std::make_unique<gl::shader_cache>(m_prog_buffer, "opengl", "v1.6");
 
+	// Bump the pack version whenever the decompiler output changes
+	rsx::get_decompiled_program_cache().open(g_cfg.video.disable_on_disk_shader_cache ? "" : Emu.PPUCache() + "shaders_cache/opengl-decompiled-v1.pack");
+
 	if (g_cfg.video.disable_vertex_cache)
 		m_vertex_cache = std::make_unique<gl::null_vertex_cache>();
 	else
@@ -234,6 +238,7 @@ void GLGSRender::end()
 	// Load textures
 	{
 		std::chrono::time_point<steady_clock> textures_start = steady_clock::now();
+		gl::gpu_profiler_scope profiler_scope(rsx::gpu_timer_category::texture_cache);
 
 		std::lock_guard lock(m_sampler_mutex);
 		bool  update_framebuffer_sourced = false;
@@ -322,6 +327,8 @@ void GLGSRender::end()
 
 	//Bind textures and resolve external copy operations
 	std::chrono::time_point<steady_clock> textures_start = steady_clock::now();
+	auto& profiler = gl::get_timestamp_profiler();
+	profiler.begin_scope(rsx::gpu_timer_category::texture_cache);
 
 	for (int i = 0; i < rsx::limits::fragment_textures_count; ++i)
 	{
@@ -394,10 +401,13 @@ void GLGSRender::end()
 		}
 	}
 
+	profiler.end_scope();
+
 	std::chrono::time_point<steady_clock> textures_end = steady_clock::now();
 	m_textures_upload_time += (u32)std::chrono::duration_cast<std::chrono::microseconds>(textures_end - textures_start).count();
 
 	std::chrono::time_point<steady_clock> draw_start = textures_end;
+	profiler.begin_scope(rsx::gpu_timer_category::render_pass);
 
 	// Optionally do memory synchronization if the texture stage has not yet triggered this
 	if (true)//g_cfg.video.strict_rendering_mode)
@@ -601,10 +611,10 @@ void GLGSRender::end()
 
 			if (gl_state.enable(restarts_valid && rsx::method_registers.restart_index_enabled(), GL_PRIMITIVE_RESTART))
 			{
-				glPrimitiveRestartIndex((index_type == GL_UNSIGNED_SHORT) ? 0xffff : 0xffffffff);
+				gl_state.primitive_restart_index((index_type == GL_UNSIGNED_SHORT) ? 0xffff : 0xffffffff);
 			}
 
-			m_index_ring_buffer->bind();
+			gl_state.bind_element_array(m_index_ring_buffer->id());
 
 			if (rsx::method_registers.current_draw_clause.is_single_draw())
 			{
@@ -647,6 +657,8 @@ void GLGSRender::end()
 	m_fragment_constants_buffer->notify();
 	m_transform_constants_buffer->notify();
 
+	profiler.end_scope();
+
 	std::chrono::time_point<steady_clock> draw_end = steady_clock::now();
 	m_draw_time += (u32)std::chrono::duration_cast<std::chrono::microseconds>(draw_end - draw_start).count();
 
@@ -658,7 +670,7 @@ void GLGSRender::set_viewport()
 	// NOTE: scale offset matrix already contains the viewport transformation
 	const auto clip_width = rsx::apply_resolution_scale(rsx::method_registers.surface_clip_width(), true);
 	const auto clip_height = rsx::apply_resolution_scale(rsx::method_registers.surface_clip_height(), true);
-	glViewport(0, 0, clip_width, clip_height);
+	gl_state.viewport(0, 0, clip_width, clip_height);
 }
 
 void GLGSRender::set_scissor()
@@ -698,7 +710,7 @@ void GLGSRender::set_scissor()
 
 	// NOTE: window origin does not affect scissor region (probably only affects viewport matrix; already applied)
 	// See LIMBO [NPUB-30373] which uses shader window origin = top
-	glScissor(scissor_x, scissor_y, scissor_w, scissor_h);
+	gl_state.scissor(scissor_x, scissor_y, scissor_w, scissor_h);
 	gl_state.enable(GL_TRUE, GL_SCISSOR_TEST);
 }
 
@@ -754,6 +766,18 @@ void GLGSRender::on_init_thread()
 		LOG_WARNING(RSX, "Texture barriers are not supported by your GPU. Feedback loops will have undefined results.");
 	}
 
+	if (gl_caps.KHR_parallel_shader_compile_supported)
+	{
+		// Let the driver pick the number of compiler threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+
+	if (gl_caps.ARB_get_program_binary_supported)
+	{
+		// Binaries are tied to the driver, the pack is rebuilt when it changes
+		gl::get_program_binary_cache().open(g_cfg.video.disable_on_disk_shader_cache ? "" : Emu.PPUCache() + "shaders_cache/opengl-binaries-v1.pack");
+	}
+
 	//Use industry standard resource alignment values as defaults
 	m_uniform_buffer_offset_align = 256;
 	m_min_texbuffer_alignment = 256;
@@ -889,6 +913,11 @@ void GLGSRender::on_init_thread()
 		}
 	}
 
+	if (g_cfg.video.gpu_profiler)
+	{
+		gl::get_timestamp_profiler().create();
+	}
+
 	int image_unit = 0;
 	for (auto &sampler : m_fs_sampler_states)
 	{
@@ -1002,6 +1031,9 @@ void GLGSRender::on_init_thread()
 
 		m_shaders_cache->load(&helper);
 	}
+
+	// Pipelines left to the background compiler are linked on the decompiler context from the shaders compiled here
+	glFinish();
 }
 
 
@@ -1099,6 +1131,7 @@ void GLGSRender::on_exit()
 
 	m_null_textures.clear();
 	m_text_printer.close();
+	gl::get_timestamp_profiler().destroy();
 	m_gl_texture_cache.destroy();
 	m_depth_converter.destroy();
 	m_ui_renderer.destroy();
@@ -1118,6 +1151,9 @@ void GLGSRender::on_exit()
 	glFlush();
 	glFinish();
 
+	rsx::get_decompiled_program_cache().close();
+	gl::get_program_binary_cache().close();
+
 	GSRender::on_exit();
 }
 
@@ -1131,6 +1167,8 @@ void GLGSRender::clear_surface(u32 arg)
 	// Ignore invalid clear flags
 	if ((arg & 0xf3) == 0) return;
 
+	gl::gpu_profiler_scope profiler_scope(rsx::gpu_timer_category::render_pass);
+
 	GLbitfield mask = 0;
 
 	gl::command_context cmd{ gl_state };
@@ -1308,7 +1346,8 @@ bool GLGSRender::load_program()
 		if (m_prog_buffer.check_program_linked_flag())
 		{
 			// Program was linked or queued for linking
-			m_shaders_cache->store(pipeline_properties, current_vertex_program, current_fragment_program);
+			m_pipelines_compiled++;
+			m_shaders_cache->store(pipeline_properties, current_vertex_program, current_fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
 		}
 
 		// Notify the user with HUD notification
@@ -1329,6 +1368,11 @@ bool GLGSRender::load_program()
 			}
 		}
 	}
+	else if (m_prog_buffer.check_first_use_flag())
+	{
+		// Feeds the precompilation order of the next boot
+		m_shaders_cache->record_use(pipeline_properties, current_vertex_program, current_fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
+	}
 
 	return m_program != nullptr;
 }
@@ -1343,12 +1387,26 @@ void GLGSRender::load_program_env()
 	const u32 fragment_constants_size = current_fp_metadata.program_constants_buffer_length;
 
 	const bool update_transform_constants = !!(m_graphics_state & rsx::pipeline_state::transform_constants_dirty);
-	const bool update_fragment_constants = !!(m_graphics_state & rsx::pipeline_state::fragment_constants_dirty) && fragment_constants_size;
+	bool update_fragment_constants = !!(m_graphics_state & rsx::pipeline_state::fragment_constants_dirty) && fragment_constants_size;
 	const bool update_vertex_env = !!(m_graphics_state & rsx::pipeline_state::vertex_state_dirty);
 	const bool update_fragment_env = !!(m_graphics_state & rsx::pipeline_state::fragment_state_dirty);
 	const bool update_fragment_texture_env = !!(m_graphics_state & rsx::pipeline_state::fragment_texture_state_dirty);
 
-	m_program->use();
+	gl_state.use_program(m_program->id());
+
+	std::pair<GLProgramBuffer::fragment_constants_upload*, bool> fragment_constants{};
+
+	if (update_fragment_constants)
+	{
+		fragment_constants = m_prog_buffer.get_fragment_constants_upload(current_fragment_program, m_fragment_constants_buffer->id(), gl::get_driver_caps().vendor_NVIDIA);
+
+		if (fragment_constants.second)
+		{
+			// Same constants as the last upload of this program, still in the ring
+			m_fragment_constants_buffer->bind_range(3, fragment_constants.first->offset, fragment_constants_size);
+			update_fragment_constants = false;
+		}
+	}
 
 	if (manually_flush_ring_buffers)
 	{
@@ -1390,10 +1448,18 @@ void GLGSRender::load_program_env()
 		auto mapping = m_fragment_constants_buffer->alloc_from_heap(fragment_constants_size, m_uniform_buffer_offset_align);
 		auto buf = static_cast<u8*>(mapping.first);
 
-		m_prog_buffer.fill_fragment_constants_buffer({ reinterpret_cast<float*>(buf), gsl::narrow<int>(fragment_constants_size) },
-			current_fragment_program, gl::get_driver_caps().vendor_NVIDIA);
+		if (const auto upload = fragment_constants.first)
+		{
+			std::memcpy(buf, upload->data.data(), fragment_constants_size);
+		}
+		else
+		{
+			m_prog_buffer.fill_fragment_constants_buffer({ reinterpret_cast<float*>(buf), gsl::narrow<int>(fragment_constants_size) },
+				current_fragment_program, gl::get_driver_caps().vendor_NVIDIA);
+		}
 
 		m_fragment_constants_buffer->bind_range(3, mapping.second, fragment_constants_size);
+		m_prog_buffer.on_fragment_constants_alloc(fragment_constants.first, m_fragment_constants_buffer->id(), mapping.second);
 	}
 
 	if (update_fragment_env)
@@ -1489,21 +1555,21 @@ void GLGSRender::update_draw_state()
 
 	if (gl_state.enable(rsx::method_registers.stencil_test_enabled(), GL_STENCIL_TEST))
 	{
-		glStencilFunc(comparison_op(rsx::method_registers.stencil_func()),
+		gl_state.stencil_func(comparison_op(rsx::method_registers.stencil_func()),
 			rsx::method_registers.stencil_func_ref(),
 			rsx::method_registers.stencil_func_mask());
 
-		glStencilOp(stencil_op(rsx::method_registers.stencil_op_fail()), stencil_op(rsx::method_registers.stencil_op_zfail()),
+		gl_state.stencil_op(stencil_op(rsx::method_registers.stencil_op_fail()), stencil_op(rsx::method_registers.stencil_op_zfail()),
 			stencil_op(rsx::method_registers.stencil_op_zpass()));
 
 		if (rsx::method_registers.two_sided_stencil_test_enabled())
 		{
-			glStencilMaskSeparate(GL_BACK, rsx::method_registers.back_stencil_mask());
+			gl_state.stencil_mask_separate(GL_BACK, rsx::method_registers.back_stencil_mask());
 
-			glStencilFuncSeparate(GL_BACK, comparison_op(rsx::method_registers.back_stencil_func()),
+			gl_state.stencil_func_separate(GL_BACK, comparison_op(rsx::method_registers.back_stencil_func()),
 				rsx::method_registers.back_stencil_func_ref(), rsx::method_registers.back_stencil_func_mask());
 
-			glStencilOpSeparate(GL_BACK, stencil_op(rsx::method_registers.back_stencil_op_fail()),
+			gl_state.stencil_op_separate(GL_BACK, stencil_op(rsx::method_registers.back_stencil_op_fail()),
 				stencil_op(rsx::method_registers.back_stencil_op_zfail()), stencil_op(rsx::method_registers.back_stencil_op_zpass()));
 		}
 	}
@@ -1518,15 +1584,15 @@ void GLGSRender::update_draw_state()
 
 	if (mrt_blend_enabled[0] || mrt_blend_enabled[1] || mrt_blend_enabled[2] || mrt_blend_enabled[3])
 	{
-		glBlendFuncSeparate(blend_factor(rsx::method_registers.blend_func_sfactor_rgb()),
+		gl_state.blend_func_separate(blend_factor(rsx::method_registers.blend_func_sfactor_rgb()),
 			blend_factor(rsx::method_registers.blend_func_dfactor_rgb()),
 			blend_factor(rsx::method_registers.blend_func_sfactor_a()),
 			blend_factor(rsx::method_registers.blend_func_dfactor_a()));
 
 		auto blend_colors = rsx::get_constant_blend_colors();
-		glBlendColor(blend_colors[0], blend_colors[1], blend_colors[2], blend_colors[3]);
+		gl_state.blend_color(blend_colors[0], blend_colors[1], blend_colors[2], blend_colors[3]);
 
-		glBlendEquationSeparate(blend_equation(rsx::method_registers.blend_equation_rgb()),
+		gl_state.blend_equation_separate(blend_equation(rsx::method_registers.blend_equation_rgb()),
 			blend_equation(rsx::method_registers.blend_equation_a()));
 	}
 
@@ -1579,7 +1645,10 @@ void GLGSRender::update_draw_state()
 
 void GLGSRender::flip(int buffer, bool emu_flip)
 {
-	if (skip_frame)
+	// Blocks of the previous frame are released by fences, don't bind them again
+	m_prog_buffer.on_fragment_constants_barrier();
+
+	if (skip_frame || skip_present)
 	{
 		m_frame->flip(m_context, true);
 		rsx::thread::flip(buffer);
@@ -1616,6 +1685,9 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 		if (!buffer_pitch) buffer_pitch = buffer_width * 4;
 	}
 
+	auto& profiler = gl::get_timestamp_profiler();
+	profiler.begin_scope(rsx::gpu_timer_category::present);
+
 	// Disable scissor test (affects blit, clear, etc)
 	gl_state.enable(GL_FALSE, GL_SCISSOR_TEST);
 
@@ -1734,11 +1806,13 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 			const bool limited_range = !g_cfg.video.full_rgb_range_output;
 
 			gl::screen.bind();
-			glViewport(0, 0, m_frame->client_width(), m_frame->client_height());
+			gl_state.viewport(0, 0, m_frame->client_width(), m_frame->client_height());
 			m_video_output_pass.run(m_frame->client_width(), m_frame->client_height(), image, areai(aspect_ratio), gamma, limited_range);
 		}
 	}
 
+	profiler.end_scope();
+
 	if (m_overlay_manager)
 	{
 		if (m_overlay_manager->has_dirty())
@@ -1760,8 +1834,10 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 
 		if (m_overlay_manager->has_visible())
 		{
+			gl::gpu_profiler_scope profiler_scope(rsx::gpu_timer_category::overlay);
+
 			gl::screen.bind();
-			glViewport(0, 0, m_frame->client_width(), m_frame->client_height());
+			gl_state.viewport(0, 0, m_frame->client_width(), m_frame->client_height());
 
 			// Lock to avoid modification during run-update chain
 			std::lock_guard lock(*m_overlay_manager);
@@ -1775,8 +1851,10 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 
 	if (g_cfg.video.overlay)
 	{
+		gl::gpu_profiler_scope profiler_scope(rsx::gpu_timer_category::overlay);
+
 		gl::screen.bind();
-		glViewport(0, 0, m_frame->client_width(), m_frame->client_height());
+		gl_state.viewport(0, 0, m_frame->client_width(), m_frame->client_height());
 
 		m_text_printer.print_text(0,  0, m_frame->client_width(), m_frame->client_height(), fmt::format("RSX Load:                %3d%%", get_load()));
 		m_text_printer.print_text(0, 18, m_frame->client_width(), m_frame->client_height(), fmt::format("draw calls: %16d", m_draw_calls));
@@ -1784,9 +1862,11 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 		m_text_printer.print_text(0, 54, m_frame->client_width(), m_frame->client_height(), fmt::format("vertex upload time: %8dus", m_vertex_upload_time));
 		m_text_printer.print_text(0, 72, m_frame->client_width(), m_frame->client_height(), fmt::format("textures upload time: %6dus", m_textures_upload_time));
 		m_text_printer.print_text(0, 90, m_frame->client_width(), m_frame->client_height(), fmt::format("draw call execution: %7dus", m_draw_time));
+		m_text_printer.print_text(0, 108, m_frame->client_width(), m_frame->client_height(), fmt::format("State changes: %13d  (%d redundant call(s) elided)", gl_state.num_issued_calls, gl_state.num_elided_calls));
 
 		const auto num_dirty_textures = m_gl_texture_cache.get_unreleased_textures_count();
 		const auto texture_memory_size = m_gl_texture_cache.get_texture_memory_in_use() / (1024 * 1024);
+		const auto texture_memory_budget = m_gl_texture_cache.get_memory_budget() / (1024 * 1024);
 		const auto num_flushes = m_gl_texture_cache.get_num_flush_requests();
 		const auto num_mispredict = m_gl_texture_cache.get_num_cache_mispredictions();
 		const auto num_speculate = m_gl_texture_cache.get_num_cache_speculative_writes();
@@ -1794,18 +1874,32 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 		const auto num_unavoidable = m_gl_texture_cache.get_num_unavoidable_hard_faults();
 		const auto cache_miss_ratio = (u32)ceil(m_gl_texture_cache.get_cache_miss_ratio() * 100);
 		m_text_printer.print_text(0, 126, m_frame->client_width(), m_frame->client_height(), fmt::format("Unreleased textures: %7d", num_dirty_textures));
-		m_text_printer.print_text(0, 144, m_frame->client_width(), m_frame->client_height(), fmt::format("Texture memory: %12dM", texture_memory_size));
+		m_text_printer.print_text(0, 144, m_frame->client_width(), m_frame->client_height(), texture_memory_budget ?
+			fmt::format("Texture memory: %12dM / %dM", texture_memory_size, texture_memory_budget) : fmt::format("Texture memory: %12dM", texture_memory_size));
 		m_text_printer.print_text(0, 162, m_frame->client_width(), m_frame->client_height(), fmt::format("Flush requests: %12d  = %2d (%3d%%) hard faults, %2d unavoidable, %2d misprediction(s), %2d speculation(s)", num_flushes, num_misses, cache_miss_ratio, num_unavoidable, num_mispredict, num_speculate));
+
+		const auto stats = m_gl_texture_cache.get_frame_statistics();
+		m_text_printer.print_text(0, 180, m_frame->client_width(), m_frame->client_height(), fmt::format("Texture lookups: %11d  = %d hit(s), %d miss(es), %d section(s) alive", stats.num_hits + stats.num_misses, stats.num_hits, stats.num_misses, stats.num_sections));
+		m_text_printer.print_text(0, 198, m_frame->client_width(), m_frame->client_height(), fmt::format("Texture uploads: %11d  (%dK), flushed %dK in %dus", stats.num_uploads, stats.upload_bytes / 1024, stats.flush_bytes / 1024, stats.flush_stall_time));
+
+		// The text printer switches programs without restoring them
+		gl_state.invalidate(GL_CURRENT_PROGRAM);
 	}
 
 	m_frame->flip(m_context);
+	m_present_stats.on_present(get_system_time());
 	rsx::thread::flip(buffer, emu_flip);
 
+	if (profiler.is_enabled())
+	{
+		profiler.on_frame_end();
+	}
+
 	// Cleanup
 	m_gl_texture_cache.on_frame_end();
 	m_vertex_cache->purge();
 
-	auto removed_textures = m_rtts.free_invalidated();
+	auto removed_textures = m_rtts.free_invalidated(m_gl_texture_cache.is_over_memory_budget());
 	m_framebuffer_cache.remove_if([&](auto& fbo)
 	{
 		if (fbo.unused_check_count() >= 2) return true; // Remove if stale
@@ -1829,6 +1923,7 @@ void GLGSRender::flip(int buffer, bool emu_flip)
 	m_draw_time = 0;
 	m_vertex_upload_time = 0;
 	m_textures_upload_time = 0;
+	gl_state.reset_statistics();
 }
 
 bool GLGSRender::on_access_violation(u32 address, bool is_writing)
@@ -1932,8 +2027,34 @@ work_item& GLGSRender::post_flush_request(u32 address, gl::texture_cache::thrash
 	return result;
 }
 
+bool GLGSRender::get_gpu_frame_timings(rsx::gpu_frame_timings& timings) const
+{
+	const auto& profiler = gl::get_timestamp_profiler();
+	if (!profiler.is_enabled())
+	{
+		return false;
+	}
+
+	timings = profiler.get_last_frame();
+	return true;
+}
+
+void GLGSRender::get_texture_cache_statistics(rsx::frame_benchmark_stats& stats) const
+{
+	// The texture cache only closes its frame after the common flip code ran
+	const auto cache_stats = m_gl_texture_cache.get_frame_statistics();
+	stats.texture_uploads = cache_stats.num_uploads;
+	stats.texture_upload_bytes = cache_stats.upload_bytes;
+	stats.texture_hits = cache_stats.num_hits;
+	stats.texture_misses = cache_stats.num_misses;
+	stats.texture_flushes = cache_stats.num_flushes;
+	stats.texture_memory = cache_stats.memory_in_use;
+}
+
 bool GLGSRender::scaled_image_from_memory(rsx::blit_src_info& src, rsx::blit_dst_info& dst, bool interpolate)
 {
+	gl::gpu_profiler_scope profiler_scope(rsx::gpu_timer_category::texture_cache);
+
 	gl::command_context cmd{ gl_state };
 	if (m_gl_texture_cache.blit(cmd, src, dst, interpolate, m_rtts))
 	{
@@ -2004,6 +2125,11 @@ void GLGSRender::on_decompiler_init()
 {
 	// Bind decompiler context to this thread
 	m_frame->set_current(m_decompiler_context);
+
+	if (gl::get_driver_caps().KHR_parallel_shader_compile_supported)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
 }
 
 void GLGSRender::on_decompiler_exit()
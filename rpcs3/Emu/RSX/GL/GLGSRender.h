@@ -7,6 +7,7 @@
 #include "GLProgramBuffer.h"
 #include "GLTextOut.h"
 #include "GLOverlays.h"
+#include "GLProfiler.h"
 #include "../rsx_utils.h"
 #include "../rsx_cache.h"
 
@@ -386,6 +387,9 @@ public:
 	void get_occlusion_query_result(rsx::reports::occlusion_query_info* query) override;
 	void discard_occlusion_query(rsx::reports::occlusion_query_info* query) override;
 
+	bool get_gpu_frame_timings(rsx::gpu_frame_timings& timings) const override;
+	void get_texture_cache_statistics(rsx::frame_benchmark_stats& stats) const override;
+
 protected:
 	void begin() override;
 	void end() override;
@@ -105,6 +105,8 @@ namespace gl
 		bool NV_texture_barrier_supported = false;
 		bool NV_gpu_shader5_supported = false;
 		bool AMD_gpu_shader_half_float_supported = false;
+		bool ARB_get_program_binary_supported = false;
+		bool KHR_parallel_shader_compile_supported = false;
 		bool initialized = false;
 		bool vendor_INTEL = false;  // has broken GLSL compiler
 		bool vendor_AMD = false;    // has broken ARB_multidraw
@@ -124,7 +126,7 @@ namespace gl
 
 		void initialize()
 		{
-			int find_count = 10;
+			int find_count = 12;
 			int ext_count = 0;
 			glGetIntegerv(GL_NUM_EXTENSIONS, &ext_count);
 
@@ -203,6 +205,20 @@ namespace gl
 					find_count--;
 					continue;
 				}
+
+				if (check(ext_name, "GL_ARB_get_program_binary"))
+				{
+					ARB_get_program_binary_supported = true;
+					find_count--;
+					continue;
+				}
+
+				if (check(ext_name, "GL_KHR_parallel_shader_compile"))
+				{
+					KHR_parallel_shader_compile_supported = true;
+					find_count--;
+					continue;
+				}
 			}
 
 			// Workaround for intel drivers which have terrible capability reporting
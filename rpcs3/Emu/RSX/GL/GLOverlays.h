@@ -366,7 +366,8 @@ namespace gl
 		std::unordered_map<u64, std::unique_ptr<gl::texture_view>> temp_view_cache;
 		std::unordered_map<u64, std::unique_ptr<gl::texture>> font_cache;
 		std::unordered_map<u64, std::unique_ptr<gl::texture_view>> view_cache;
-		bool is_font_draw = false;
+		rsx::overlays::batched_geometry m_geometry;
+		u32 first_vertex = 0;
 
 		ui_overlay_renderer()
 		{
@@ -374,11 +375,15 @@ namespace gl
 			{
 				"#version 420\n\n"
 				"layout(location=0) in vec4 in_pos;\n"
+				"layout(location=1) in vec4 in_color;\n"
+				"layout(location=2) in vec4 in_clip_rect;\n"
+				"layout(location=3) in vec4 in_params;\n"
 				"layout(location=0) out vec2 tc0;\n"
 				"layout(location=1) flat out vec4 clip_rect;\n"
+				"layout(location=2) flat out vec4 color;\n"
+				"layout(location=3) flat out vec4 params;\n"
 				"uniform vec4 ui_scale;\n"
 				"uniform vec2 viewport;\n"
-				"uniform vec4 clip_bounds;\n"
 				"\n"
 				"vec2 snap_to_grid(vec2 normalized)\n"
 				"{\n"
@@ -388,7 +393,9 @@ namespace gl
 				"void main()\n"
 				"{\n"
 				"	tc0.xy = in_pos.zw;\n"
-				"	clip_rect = clip_bounds;\n"
+				"	color = in_color;\n"
+				"	params = in_params;\n"
+				"	clip_rect = in_clip_rect;\n"
 				"	clip_rect.yw = ui_scale.yy - clip_rect.wy; // Invert y axis\n"
 				"	clip_rect *= (ui_scale.zwzw * viewport.xyxy) / ui_scale.xyxy; // Normalize and convert to window coords\n"
 				"	vec2 window_coord = (in_pos.xy * ui_scale.zw) / ui_scale.xy;\n"
@@ -405,13 +412,10 @@ namespace gl
 				"layout(binding=31) uniform sampler2D fs0;\n"
 				"layout(location=0) in vec2 tc0;\n"
 				"layout(location=1) flat in vec4 clip_rect;\n"
+				"layout(location=2) flat in vec4 color;\n"
+				"layout(location=3) flat in vec4 params;\n"
 				"layout(location=0) out vec4 ocol;\n"
-				"uniform vec4 color;\n"
 				"uniform float time;\n"
-				"uniform int read_texture;\n"
-				"uniform int pulse_glow;\n"
-				"uniform int clip_region;\n"
-				"uniform int blur_strength;\n"
 				"\n"
 				"vec4 blur_sample(sampler2D tex, vec2 coord, vec2 tex_offset)\n"
 				"{\n"
@@ -442,7 +446,7 @@ namespace gl
 				"	return blurred / 16.f;\n"
 				"}\n"
 				"\n"
-				"vec4 sample_image(sampler2D tex, vec2 coord)\n"
+				"vec4 sample_image(sampler2D tex, vec2 coord, float blur_strength)\n"
 				"{\n"
 				"	vec4 original = texture(tex, coord);\n"
 				"	if (blur_strength == 0) return original;\n"
@@ -459,12 +463,12 @@ namespace gl
 				"\n"
 				"	vec4 blurred = blur0 + blur1 + blur2;\n"
 				"	blurred /= 3.;\n"
-				"	return mix(original, blurred, float(blur_strength) / 100.);\n"
+				"	return mix(original, blurred, blur_strength);\n"
 				"}\n"
 				"\n"
 				"void main()\n"
 				"{\n"
-				"	if (clip_region != 0)\n"
+				"	if (params.z != 0)\n"
 				"	{"
 				"		if (gl_FragCoord.x < clip_rect.x || gl_FragCoord.x > clip_rect.z ||\n"
 				"			gl_FragCoord.y < clip_rect.y || gl_FragCoord.y > clip_rect.w)\n"
@@ -475,11 +479,11 @@ namespace gl
 				"	}\n"
 				"\n"
 				"	vec4 diff_color = color;\n"
-				"	if (pulse_glow != 0)\n"
+				"	if (params.x != 0)\n"
 				"		diff_color.a *= (sin(time) + 1.f) * 0.5f;\n"
 				"\n"
-				"	if (read_texture != 0)\n"
-				"		ocol = sample_image(fs0, tc0) * diff_color;\n"
+				"	if (params.y != 0)\n"
+				"		ocol = sample_image(fs0, tc0, params.w) * diff_color;\n"
 				"	else\n"
 				"		ocol = diff_color;\n"
 				"}\n"
@@ -487,6 +491,7 @@ namespace gl
 
 			// Smooth filtering required for inputs
 			input_filter = GL_LINEAR;
+			primitives = GL_TRIANGLES;
 		}
 
 		gl::texture_view* load_simple_image(rsx::overlays::image_info* desc, bool temp_resource, u32 owner_uid)
@@ -517,6 +522,21 @@ namespace gl
 		{
 			overlay_pass::create();
 
+			// Every vertex carries the state of the command it belongs to
+			int old_vao;
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
+
+			m_vao.bind();
+			m_vao.array_buffer = m_vertex_data_buffer;
+
+			for (u32 n = 0; n < 4; ++n)
+			{
+				auto ptr = buffer_pointer(&m_vao, n * 16, sizeof(rsx::overlays::batched_geometry::batch_vertex));
+				m_vao[n] = ptr;
+			}
+
+			glBindVertexArray(old_vao);
+
 			rsx::overlays::resource_config configuration;
 			configuration.load_files();
 
@@ -591,86 +611,64 @@ namespace gl
 
 		void emit_geometry() override
 		{
-			if (!is_font_draw)
-			{
-				overlay_pass::emit_geometry();
-			}
-			else
-			{
-				int num_quads = num_drawable_elements / 4;
-				std::vector<GLint> firsts;
-				std::vector<GLsizei> counts;
-
-				firsts.resize(num_quads);
-				counts.resize(num_quads);
-
-				for (int n = 0; n < num_quads; ++n)
-				{
-					firsts[n] = (n * 4);
-					counts[n] = 4;
-				}
-
-				int old_vao;
-				glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
+			int old_vao;
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &old_vao);
 
-				m_vao.bind();
-				glMultiDrawArrays(GL_TRIANGLE_STRIP, firsts.data(), counts.data(), num_quads);
+			m_vao.bind();
+			glDrawArrays(primitives, first_vertex, num_drawable_elements);
 
-				glBindVertexArray(old_vao);
-			}
+			glBindVertexArray(old_vao);
 		}
 
 		void run(u16 w, u16 h, GLuint target, rsx::overlays::overlay& ui)
 		{
-			program_handle.uniforms["viewport"] = color2f(f32(w), f32(h));
-			program_handle.uniforms["ui_scale"] = color4f((f32)ui.virtual_width, (f32)ui.virtual_height, 1.f, 1.f);
-			program_handle.uniforms["time"] = (f32)(get_system_time() / 1000) * 0.005f;
+			m_geometry.build(ui.get_compiled());
 
-			saved_sampler_state saved(31, m_sampler);
-
-			for (auto &cmd : ui.get_compiled().draw_commands)
+			if (!m_geometry.vertices.empty())
 			{
-				upload_vertex_data((f32*)cmd.verts.data(), (u32)cmd.verts.size() * 4u);
-				num_drawable_elements = (u32)cmd.verts.size();
-				is_font_draw = false;
-				GLint texture_exists = GL_TRUE;
+				program_handle.uniforms["viewport"] = color2f(f32(w), f32(h));
+				program_handle.uniforms["ui_scale"] = color4f((f32)ui.virtual_width, (f32)ui.virtual_height, 1.f, 1.f);
+				program_handle.uniforms["time"] = (f32)(get_system_time() / 1000) * 0.005f;
 
-				switch (cmd.config.texture_ref)
-				{
-				case rsx::overlays::image_resource_id::game_icon:
-				case rsx::overlays::image_resource_id::backbuffer:
-					//TODO
-				case rsx::overlays::image_resource_id::none:
-				{
-					texture_exists = GL_FALSE;
-					glBindTexture(GL_TEXTURE_2D, GL_NONE);
-					break;
-				}
-				case rsx::overlays::image_resource_id::raw_image:
-				{
-					glBindTexture(GL_TEXTURE_2D, find_temp_image((rsx::overlays::image_info*)cmd.config.external_data_ref, ui.uid)->id());
-					break;
-				}
-				case rsx::overlays::image_resource_id::font_file:
-				{
-					is_font_draw = true;
-					glBindTexture(GL_TEXTURE_2D, find_font(cmd.config.font_ref)->id());
-					break;
-				}
-				default:
+				saved_sampler_state saved(31, m_sampler);
+
+				// The whole overlay is uploaded once, batches only differ in the texture they sample
+				upload_vertex_data((f32*)m_geometry.vertices.data(), (u32)(m_geometry.vertices.size() * sizeof(rsx::overlays::batched_geometry::batch_vertex) / sizeof(f32)));
+
+				for (const auto& batch : m_geometry.batches)
 				{
-					glBindTexture(GL_TEXTURE_2D, view_cache[cmd.config.texture_ref - 1]->id());
-					break;
+					first_vertex = batch.first_vertex;
+					num_drawable_elements = batch.vertex_count;
+
+					switch (batch.config.texture_ref)
+					{
+					case rsx::overlays::image_resource_id::game_icon:
+					case rsx::overlays::image_resource_id::backbuffer:
+						//TODO
+					case rsx::overlays::image_resource_id::none:
+					{
+						glBindTexture(GL_TEXTURE_2D, GL_NONE);
+						break;
+					}
+					case rsx::overlays::image_resource_id::raw_image:
+					{
+						glBindTexture(GL_TEXTURE_2D, find_temp_image((rsx::overlays::image_info*)batch.config.external_data_ref, ui.uid)->id());
+						break;
+					}
+					case rsx::overlays::image_resource_id::font_file:
+					{
+						glBindTexture(GL_TEXTURE_2D, find_font(batch.config.font_ref)->id());
+						break;
+					}
+					default:
+					{
+						glBindTexture(GL_TEXTURE_2D, view_cache[batch.config.texture_ref - 1]->id());
+						break;
+					}
+					}
+
+					overlay_pass::run(w, h, target, false, true);
 				}
-				}
-
-				program_handle.uniforms["color"] = cmd.config.color;
-				program_handle.uniforms["read_texture"] = texture_exists;
-				program_handle.uniforms["pulse_glow"] = (s32)cmd.config.pulse_glow;
-				program_handle.uniforms["blur_strength"] = (s32)cmd.config.blur_strength;
-				program_handle.uniforms["clip_region"] = (s32)cmd.config.clip_region;
-				program_handle.uniforms["clip_bounds"] = cmd.config.clip_rect;
-				overlay_pass::run(w, h, target, false, true);
 			}
 
 			ui.update();
@@ -29,6 +29,9 @@ OPENGL_PROC(PFNGLBINDATTRIBLOCATIONPROC, BindAttribLocation);
 OPENGL_PROC(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation);
 OPENGL_PROC(PFNGLGETPROGRAMIVPROC, GetProgramiv);
 OPENGL_PROC(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog);
+OPENGL_PROC(PFNGLPROGRAMPARAMETERIPROC, ProgramParameteri);
+OPENGL_PROC(PFNGLGETPROGRAMBINARYPROC, GetProgramBinary);
+OPENGL_PROC(PFNGLPROGRAMBINARYPROC, ProgramBinary);
 OPENGL_PROC(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer);
 OPENGL_PROC(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray);
 OPENGL_PROC(PFNGLDISABLEVERTEXATTRIBARRAYPROC, DisableVertexAttribArray);
@@ -200,6 +203,10 @@ OPENGL_PROC(PFNGLGETQUERYOBJECTIVPROC, GetQueryObjectiv);
 OPENGL_PROC(PFNGLBEGINQUERYPROC, BeginQuery);
 OPENGL_PROC(PFNGLENDQUERYPROC, EndQuery);
 
+//Timer Query
+OPENGL_PROC(PFNGLQUERYCOUNTERPROC, QueryCounter);
+OPENGL_PROC(PFNGLGETQUERYOBJECTUI64VPROC, GetQueryObjectui64v);
+
 //Texture Buffers
 OPENGL_PROC(PFNGLTEXTUREBUFFERRANGEEXTPROC, TextureBufferRangeEXT);
 OPENGL_PROC(PFNGLTEXTUREBUFFERRANGEPROC, TextureBufferRange);
@@ -230,6 +237,9 @@ OPENGL_PROC(PFNGLTEXTUREVIEWPROC, TextureView);
 //Texture_Barrier
 OPENGL_PROC(PFNGLTEXTUREBARRIERPROC, TextureBarrier);
 OPENGL_PROC(PFNGLTEXTUREBARRIERNVPROC, TextureBarrierNV);
+
+//KHR_parallel_shader_compile
+OPENGL_PROC(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC, MaxShaderCompilerThreadsKHR);
 //...
 
 WGL_PROC(PFNWGLSWAPINTERVALEXTPROC, SwapIntervalEXT);
@@ -0,0 +1,127 @@
+#include "stdafx.h"
+#include "GLProfiler.h"
+
+namespace gl
+{
+	void timestamp_profiler::create()
+	{
+		for (auto& set : m_query_sets)
+		{
+			glGenQueries(max_timestamps, set.queries.data());
+			set.used = 0;
+		}
+
+		m_current_set = 0;
+		m_current_category = untracked;
+		m_enabled = true;
+	}
+
+	void timestamp_profiler::destroy()
+	{
+		if (!m_enabled)
+		{
+			return;
+		}
+
+		for (auto& set : m_query_sets)
+		{
+			glDeleteQueries(max_timestamps, set.queries.data());
+			set.used = 0;
+		}
+
+		m_scope_stack.clear();
+		m_enabled = false;
+	}
+
+	void timestamp_profiler::switch_category(rsx::gpu_timer_category category)
+	{
+		if (category == m_current_category)
+		{
+			return;
+		}
+
+		auto& set = m_query_sets[m_current_set];
+
+		// The last slot is kept for the terminating timestamp
+		if (set.used == max_timestamps || (set.used == max_timestamps - 1 && category != untracked))
+		{
+			return;
+		}
+
+		glQueryCounter(set.queries[set.used], GL_TIMESTAMP);
+		set.categories[set.used++] = category;
+		m_current_category = category;
+	}
+
+	void timestamp_profiler::collect(query_set& set)
+	{
+		if (set.used < 2)
+		{
+			set.used = 0;
+			return;
+		}
+
+		std::array<GLuint64, max_timestamps> timestamps;
+		for (u32 i = 0; i < set.used; ++i)
+		{
+			glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+		}
+
+		for (u32 i = 0; i + 1 < set.used; ++i)
+		{
+			if (set.categories[i] != untracked && timestamps[i + 1] > timestamps[i])
+			{
+				m_frame_profiler.add(set.categories[i], timestamps[i + 1] - timestamps[i]);
+			}
+		}
+
+		set.used = 0;
+	}
+
+	void timestamp_profiler::begin_scope(rsx::gpu_timer_category category)
+	{
+		if (!m_enabled)
+		{
+			return;
+		}
+
+		m_scope_stack.push_back(category);
+		switch_category(category);
+	}
+
+	void timestamp_profiler::end_scope()
+	{
+		if (!m_enabled)
+		{
+			return;
+		}
+
+		m_scope_stack.pop_back();
+
+		// The category stays active until another one begins so that adjacent scopes share timestamps
+		if (!m_scope_stack.empty())
+		{
+			switch_category(m_scope_stack.back());
+		}
+	}
+
+	void timestamp_profiler::on_frame_end()
+	{
+		switch_category(untracked);
+
+		m_current_set = (m_current_set + 1) % max_frames_in_flight;
+		collect(m_query_sets[m_current_set]);
+		m_frame_profiler.end_frame();
+
+		if (!m_scope_stack.empty())
+		{
+			switch_category(m_scope_stack.back());
+		}
+	}
+
+	timestamp_profiler& get_timestamp_profiler()
+	{
+		static timestamp_profiler s_profiler;
+		return s_profiler;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "OpenGL.h"
+#include "../Common/gpu_profiler.h"
+
+namespace gl
+{
+	/**
+	 * GL_TIMESTAMP query based GPU profiler, the OpenGL counterpart of vk::timestamp_profiler.
+	 * A timestamp is written whenever the active category changes, the interval up to the next one is charged to the
+	 * category that was active. A frame's timestamps are read back when its query set comes around again, waiting if needed.
+	 */
+	class timestamp_profiler
+	{
+		// Query sets in rotation, reading a set back should not stall once this many frames have been submitted after it
+		static constexpr u32 max_frames_in_flight = 3;
+
+		// Timestamps per frame, categories stop changing once a frame runs out
+		static constexpr u32 max_timestamps = 1024;
+
+		// Marks the end of the last interval of a frame
+		static constexpr auto untracked = rsx::gpu_timer_category::count;
+
+		struct query_set
+		{
+			std::array<GLuint, max_timestamps> queries;
+			std::array<rsx::gpu_timer_category, max_timestamps> categories;
+			u32 used = 0;
+		};
+
+		std::array<query_set, max_frames_in_flight> m_query_sets;
+		u32 m_current_set = 0;
+		bool m_enabled = false;
+
+		rsx::gpu_timer_category m_current_category = untracked;
+		std::vector<rsx::gpu_timer_category> m_scope_stack;
+
+		rsx::gpu_frame_profiler m_frame_profiler;
+
+		void switch_category(rsx::gpu_timer_category category);
+		void collect(query_set& set);
+
+	public:
+		void create();
+		void destroy();
+
+		bool is_enabled() const
+		{
+			return m_enabled;
+		}
+
+		void begin_scope(rsx::gpu_timer_category category);
+		void end_scope();
+
+		// Closes the current frame and reads back the oldest one
+		void on_frame_end();
+
+		rsx::gpu_frame_timings get_last_frame() const
+		{
+			return m_frame_profiler.get_last_frame();
+		}
+	};
+
+	timestamp_profiler& get_timestamp_profiler();
+
+	struct gpu_profiler_scope
+	{
+		gpu_profiler_scope(rsx::gpu_timer_category category)
+		{
+			get_timestamp_profiler().begin_scope(category);
+		}
+
+		~gpu_profiler_scope()
+		{
+			get_timestamp_profiler().end_scope();
+		}
+	};
+}
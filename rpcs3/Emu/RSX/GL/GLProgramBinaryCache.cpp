@@ -0,0 +1,206 @@
+#include "stdafx.h"
+#include "GLProgramBinaryCache.h"
+
+namespace gl
+{
+	namespace
+	{
+		// 64-bit FNV-1a
+		u64 hash_bytes(u64 hash, const void* data, size_t size)
+		{
+			const auto bytes = static_cast<const u8*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001B3ULL;
+			}
+
+			return hash;
+		}
+
+		u64 hash_string(u64 hash, const char* str)
+		{
+			// Terminator included so that concatenated strings cannot alias
+			return hash_bytes(hash, str, str ? std::strlen(str) + 1 : 0);
+		}
+
+		u64 get_driver_hash()
+		{
+			u64 hash = 0xCBF29CE484222325ULL;
+			hash = hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+			hash = hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+			hash = hash_string(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+			return hash;
+		}
+	}
+
+	bool program_binary_cache::read_pack(const std::vector<u8>& bytes)
+	{
+		pack_header header;
+		if (bytes.size() < sizeof(pack_header))
+		{
+			return false;
+		}
+
+		std::memcpy(&header, bytes.data(), sizeof(pack_header));
+		if (header.magic != pack_magic || header.version != pack_version || header.driver_hash != m_driver_hash)
+		{
+			LOG_NOTICE(RSX, "program binary cache: %s was created by a different driver and will be replaced", m_path);
+			return false;
+		}
+
+		size_t offset = sizeof(pack_header);
+		while (offset < bytes.size())
+		{
+			pack_record_header record;
+			if (bytes.size() - offset < sizeof(pack_record_header))
+			{
+				LOG_WARNING(RSX, "program binary cache: %s ends with a truncated record", m_path);
+				return false;
+			}
+
+			std::memcpy(&record, bytes.data() + offset, sizeof(pack_record_header));
+			offset += sizeof(pack_record_header);
+
+			if (bytes.size() - offset < record.size)
+			{
+				LOG_WARNING(RSX, "program binary cache: %s ends with a truncated record", m_path);
+				return false;
+			}
+
+			auto& binary = m_binaries[record.key];
+			binary.format = record.format;
+			binary.data.assign(bytes.begin() + offset, bytes.begin() + offset + record.size);
+			offset += record.size;
+		}
+
+		return true;
+	}
+
+	void program_binary_cache::open(const std::string& path)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pack.close();
+		m_binaries.clear();
+		m_path.clear();
+
+		GLint format_count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+		if (path.empty() || format_count <= 0)
+		{
+			return;
+		}
+
+		m_path = path;
+		m_driver_hash = get_driver_hash();
+
+		fs::create_path(fs::get_parent_dir(m_path));
+
+		bool valid = false;
+		if (fs::file pack{ m_path })
+		{
+			valid = read_pack(pack.to_vector<u8>());
+		}
+
+		// Old drivers' binaries are useless, damaged packs are dropped with them
+		if (!m_pack.open(m_path, valid ? (fs::write + fs::append) : fs::rewrite))
+		{
+			LOG_ERROR(RSX, "program binary cache: failed to open %s", m_path);
+			m_binaries.clear();
+			m_path.clear();
+			return;
+		}
+
+		if (!valid)
+		{
+			m_binaries.clear();
+			m_pack.write(pack_header{ pack_magic, m_driver_hash, pack_version, 0 });
+		}
+
+		LOG_NOTICE(RSX, "program binary cache: %u programs loaded from %s", m_binaries.size(), m_path);
+	}
+
+	void program_binary_cache::close()
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pack.close();
+		m_binaries.clear();
+		m_path.clear();
+	}
+
+	bool program_binary_cache::load(u64 key, GLuint program)
+	{
+		{
+			reader_lock lock(m_mutex);
+
+			const auto found = m_binaries.find(key);
+			if (found == m_binaries.end())
+			{
+				return false;
+			}
+
+			glProgramBinary(program, found->second.format, found->second.data.data(), ::narrow<GLsizei>(found->second.data.size()));
+		}
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+		if (status == GL_FALSE)
+		{
+			// Rejected binaries are dropped, the program is linked from source and stored again
+			std::lock_guard lock(m_mutex);
+			m_binaries.erase(key);
+			return false;
+		}
+
+		return true;
+	}
+
+	void program_binary_cache::store(u64 key, GLuint program)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+		if (length <= 0)
+		{
+			return;
+		}
+
+		program_binary binary;
+		binary.data.resize(length);
+		glGetProgramBinary(program, length, &length, &binary.format, binary.data.data());
+		binary.data.resize(length);
+
+		std::lock_guard lock(m_mutex);
+
+		if (m_path.empty())
+		{
+			return;
+		}
+
+		if (m_pack)
+		{
+			m_pack.write(pack_record_header{ key, binary.format, ::size32(binary.data) });
+			m_pack.write(binary.data);
+		}
+
+		m_binaries[key] = std::move(binary);
+	}
+
+	u64 program_binary_cache::get_key(const std::string& vertex_source, const std::string& fragment_source)
+	{
+		u64 hash = 0xCBF29CE484222325ULL;
+		hash = hash_string(hash, vertex_source.c_str());
+		hash = hash_string(hash, fragment_source.c_str());
+		return hash;
+	}
+
+	program_binary_cache& get_program_binary_cache()
+	{
+		static program_binary_cache s_cache;
+		return s_cache;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "Utilities/File.h"
+#include "Utilities/mutex.h"
+#include "OpenGL.h"
+
+#include <unordered_map>
+
+namespace gl
+{
+	/**
+	 * Keeps linked program binaries retrieved with glGetProgramBinary, keyed by the GLSL source of the attached shaders.
+	 * The pack file is tagged with the driver vendor, renderer and version strings and is discarded when any of them changes.
+	 * Safe to use from the render thread and the decompiler thread at the same time.
+	 */
+	class program_binary_cache
+	{
+		struct pack_header
+		{
+			u64 magic;
+			u64 driver_hash;
+			u32 version;
+			u32 reserved;
+		};
+
+		struct pack_record_header
+		{
+			u64 key;
+			u32 format;
+			u32 size;
+		};
+
+		struct program_binary
+		{
+			GLenum format;
+			std::vector<u8> data;
+		};
+
+		static constexpr u64 pack_magic = 0x4B50423353435052ull; // "RPCS3BPK"
+		static constexpr u32 pack_version = 1;
+
+		shared_mutex m_mutex;
+		std::unordered_map<u64, program_binary> m_binaries;
+		std::string m_path;
+		fs::file m_pack;
+		u64 m_driver_hash = 0;
+
+		bool read_pack(const std::vector<u8>& bytes);
+
+	public:
+		// Must be called with a context bound. Does nothing if the driver exposes no binary formats
+		void open(const std::string& path);
+		void close();
+
+		bool is_open() const
+		{
+			return !m_path.empty();
+		}
+
+		// Loads the binary stored for key into the program object, returns false if there is none or the driver rejected it
+		bool load(u64 key, GLuint program);
+
+		// Retrieves the binary of a successfully linked program created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+		void store(u64 key, GLuint program);
+
+		static u64 get_key(const std::string& vertex_source, const std::string& fragment_source);
+	};
+
+	program_binary_cache& get_program_binary_cache();
+}
@@ -2,6 +2,7 @@
 #include "GLVertexProgram.h"
 #include "GLFragmentProgram.h"
 #include "GLHelpers.h"
+#include "GLProgramBinaryCache.h"
 #include "../Common/ProgramStateCache.h"
 
 struct GLTraits
@@ -40,8 +41,32 @@ struct GLTraits
 			.bind_fragment_data_location("ocol0", 0)
 			.bind_fragment_data_location("ocol1", 1)
 			.bind_fragment_data_location("ocol2", 2)
-			.bind_fragment_data_location("ocol3", 3)
-			.make();
+			.bind_fragment_data_location("ocol3", 3);
+
+		auto& binary_cache = gl::get_program_binary_cache();
+		const u64 binary_key = gl::program_binary_cache::get_key(vertexProgramData.shader, fragmentProgramData.shader);
+
+		if (!binary_cache.is_open() || !binary_cache.load(binary_key, result->id()))
+		{
+			if (gl::get_driver_caps().KHR_parallel_shader_compile_supported)
+			{
+				// Compile results were not waited for when the shaders were created
+				vertexProgramData.Validate();
+				fragmentProgramData.Validate();
+			}
+
+			if (binary_cache.is_open())
+			{
+				glProgramParameteri(result->id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			}
+
+			result->make();
+
+			if (binary_cache.is_open())
+			{
+				binary_cache.store(binary_key, result->id());
+			}
+		}
 
 		// Progam locations are guaranteed to not change after linking
 		// Texture locations are simply bound to the TIUs so this can be done once
@@ -108,7 +133,7 @@ public:
 	void add_pipeline_entry(RSXVertexProgram &vp, RSXFragmentProgram &fp, void* &props, Args&& ...args)
 	{
 		vp.skip_vertex_input_check = true;
-		get_graphics_pipeline(vp, fp, props, false, std::forward<Args>(args)...);
+		find_graphics_pipeline(vp, fp, props, false, false, std::forward<Args>(args)...);
 	}
 
     void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp)
@@ -126,4 +151,9 @@ public:
 	{
 		return m_program_compiled_flag;
 	}
+
+	bool check_first_use_flag() const
+	{
+		return m_first_use_flag;
+	}
 };
@@ -467,7 +467,7 @@ void GLGSRender::read_buffers()
 	if (!m_draw_fbo)
 		return;
 
-	glDisable(GL_STENCIL_TEST);
+	gl_state.enable(GL_FALSE, GL_STENCIL_TEST);
 
 	if (g_cfg.video.read_color_buffers)
 	{
@@ -343,12 +343,15 @@ struct gl_render_targets : public rsx::surface_store<gl_render_target_traits>
 		invalidated_resources.clear();
 	}
 
-	std::vector<GLuint> free_invalidated()
+	std::vector<GLuint> free_invalidated(bool low_memory = false)
 	{
+		// When over the memory budget, release idle surfaces sooner instead of keeping them around for reuse
+		const u8 min_unused_checks = low_memory ? 1 : 2;
+
 		std::vector<GLuint> removed;
 		invalidated_resources.remove_if([&](auto &rtt)
 		{
-			if (rtt->unused_check_count() >= 2)
+			if (rtt->unused_check_count() >= min_unused_checks)
 			{
 				removed.push_back(rtt->id());
 				return true;
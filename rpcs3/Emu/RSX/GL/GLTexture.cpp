@@ -438,10 +438,27 @@ namespace gl
 	}
 
 	void fill_texture(rsx::texture_dimension_extended dim, u16 mipmap_count, int format, u16 width, u16 height, u16 depth,
-			const std::vector<rsx_subresource_layout> &input_layouts, bool is_swizzled, GLenum gl_format, GLenum gl_type, std::vector<gsl::byte>& staging_buffer)
+			const std::vector<rsx_subresource_layout> &input_layouts, bool is_swizzled, GLenum gl_format, GLenum gl_type, std::vector<gsl::byte>& staging_buffer, gl::ring_buffer* upload_heap)
 	{
 		int mip_level = 0;
 		bool vtc_support = gl::get_driver_caps().vendor_NVIDIA;
+		const u32 block_size = get_format_block_size_in_bytes(format);
+
+		// Decodes one subresource and returns the source pointer for the pixel transfer.
+		// With an upload heap bound to GL_PIXEL_UNPACK_BUFFER the pointer is an offset into the heap.
+		auto stage_subresource = [&](const rsx_subresource_layout& layout) -> const void*
+		{
+			if (!upload_heap)
+			{
+				upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
+				return staging_buffer.data();
+			}
+
+			const u32 size = align<u32>(layout.width_in_block * block_size, 4) * layout.height_in_block * layout.depth;
+			const auto mapping = upload_heap->alloc_from_heap(size, 256);
+			upload_texture_subresource({ static_cast<gsl::byte*>(mapping.first), size }, layout, format, is_swizzled, vtc_support, 4);
+			return reinterpret_cast<const void*>(static_cast<uintptr_t>(mapping.second));
+		};
 
 		if (is_compressed_format(format))
 		{
@@ -457,8 +474,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block, gl_format, gl_type, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block, gl_format, gl_type, src);
 				}
 			}
 			else
@@ -466,8 +483,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block * 4, gl_format, size, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glCompressedTexSubImage1D(GL_TEXTURE_1D, mip_level++, 0, layout.width_in_block * 4, gl_format, size, src);
 				}
 			}
 			return;
@@ -479,8 +496,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, src);
 				}
 			}
 			else
@@ -488,8 +505,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glCompressedTexSubImage2D(GL_TEXTURE_2D, mip_level++, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, src);
 				}
 			}
 			return;
@@ -504,8 +521,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block, layout.height_in_block, gl_format, gl_type, src);
 					mip_level++;
 				}
 			}
@@ -514,8 +531,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + mip_level / mipmap_count, mip_level % mipmap_count, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, gl_format, size, src);
 					mip_level++;
 				}
 			}
@@ -528,8 +545,8 @@ namespace gl
 			{
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block, layout.height_in_block, depth, gl_format, gl_type, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block, layout.height_in_block, depth, gl_format, gl_type, src);
 				}
 			}
 			else
@@ -537,8 +554,8 @@ namespace gl
 				for (const rsx_subresource_layout &layout : input_layouts)
 				{
 					u32 size = layout.width_in_block * layout.height_in_block * layout.depth * ((format == CELL_GCM_TEXTURE_COMPRESSED_DXT1) ? 8 : 16);
-					upload_texture_subresource(staging_buffer, layout, format, is_swizzled, vtc_support, 4);
-					glCompressedTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, layout.depth, gl_format, size, staging_buffer.data());
+					const void* src = stage_subresource(layout);
+					glCompressedTexSubImage3D(GL_TEXTURE_3D, mip_level++, 0, 0, 0, layout.width_in_block * 4, layout.height_in_block * 4, layout.depth, gl_format, size, src);
 				}
 			}
 			return;
@@ -578,7 +595,7 @@ namespace gl
 	}
 
 	void upload_texture(GLuint id, u32 gcm_format, u16 width, u16 height, u16 depth, u16 mipmaps, bool is_swizzled, rsx::texture_dimension_extended type,
-			const std::vector<rsx_subresource_layout>& subresources_layout)
+			const std::vector<rsx_subresource_layout>& subresources_layout, gl::ring_buffer* upload_heap)
 	{
 		GLenum target;
 		switch (type)
@@ -608,12 +625,26 @@ namespace gl
 		// Calculate staging buffer size
 		const u32 aligned_pitch = align<u32>(width * get_format_block_size_in_bytes(gcm_format), 4);
 		size_t texture_data_sz = depth * height * aligned_pitch;
-		std::vector<gsl::byte> data_upload_buf(texture_data_sz);
+		std::vector<gsl::byte> data_upload_buf;
 
 		const auto format_type = get_format_type(gcm_format);
 		const GLenum gl_format = std::get<0>(format_type);
 		const GLenum gl_type = std::get<1>(format_type);
-		fill_texture(type, mipmaps, gcm_format, width, height, depth, subresources_layout, is_swizzled, gl_format, gl_type, data_upload_buf);
+
+		// Every subresource fits in the base level's footprint, keep large uploads from cycling the whole heap at once
+		if (upload_heap && (texture_data_sz * subresources_layout.size()) <= (upload_heap->size() / 4))
+		{
+			upload_heap->bind(gl::buffer::target::pixel_unpack);
+			fill_texture(type, mipmaps, gcm_format, width, height, depth, subresources_layout, is_swizzled, gl_format, gl_type, data_upload_buf, upload_heap);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+
+			upload_heap->notify();
+		}
+		else
+		{
+			data_upload_buf.resize(texture_data_sz);
+			fill_texture(type, mipmaps, gcm_format, width, height, depth, subresources_layout, is_swizzled, gl_format, gl_type, data_upload_buf, nullptr);
+		}
 	}
 
 	u32 get_format_texel_width(GLenum format)
@@ -32,9 +32,10 @@ namespace gl
 	 * - layout of vector is in A-R-G-B
 	 * - second vector contains overrides to force the value to either 0 or 1 instead of reading from texture
 	 * static_state - set up the texture without consideration for sampler state (useful for vertex textures which have no real sampler state on RSX)
+	 * upload_heap - optional persistently mapped ring to decode into, the driver then copies from a buffer instead of client memory
 	 */
 	void upload_texture(GLuint id, u32 gcm_format, u16 width, u16 height, u16 depth, u16 mipmaps, bool is_swizzled, rsx::texture_dimension_extended type,
-		const std::vector<rsx_subresource_layout>& subresources_layout);
+		const std::vector<rsx_subresource_layout>& subresources_layout, gl::ring_buffer* upload_heap = nullptr);
 
 	class sampler_state
 	{
@@ -350,26 +350,41 @@ namespace gl
 			return glMapBufferRange(GL_PIXEL_PACK_BUFFER, offset, size, GL_MAP_READ_BIT);
 		}
 
-		void finish_flush()
+		bool require_manual_shuffle() const
+		{
+			return pack_unpack_swap_bytes && (type == gl::texture::type::sbyte || type == gl::texture::type::ubyte);
+		}
+
+		bool supports_partial_flush() const
+		{
+			// The manual shuffle runs over the whole section in guest memory
+			return !require_manual_shuffle();
+		}
+
+		void finish_partial_flush()
 		{
-			// Free resources
 			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
 			glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
 
-			// Shuffle
-			bool require_manual_shuffle = false;
-			if (pack_unpack_swap_bytes)
+			if (context == rsx::texture_upload_context::framebuffer_storage)
 			{
-				if (type == gl::texture::type::sbyte || type == gl::texture::type::ubyte)
-					require_manual_shuffle = true;
+				// Update memory tag
+				static_cast<gl::render_target*>(vram_texture)->sync_tag();
 			}
+		}
+
+		void finish_flush()
+		{
+			// Free resources
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
 
 			const auto valid_range = get_confirmed_range_delta();
 			const u32 valid_offset = valid_range.first;
 			const u32 valid_length = valid_range.second;
 			void *dst = get_ptr(get_section_base() + valid_offset);
 
-			if (require_manual_shuffle)
+			if (require_manual_shuffle())
 			{
 				//byte swapping does not work on byte types, use uint_8_8_8_8 for rgba8 instead to avoid penalty
 				rsx::shuffle_texel_data_wzyx<u8>(dst, rsx_pitch, width, align(valid_length, rsx_pitch) / rsx_pitch);
@@ -391,6 +406,8 @@ namespace gl
 				//Already destroyed
 				return;
 
+			m_tex_cache->release_deduplicated_image(*this);
+
 			if (pbo_id != 0)
 			{
 				//Destroy pbo cache since vram texture is managed elsewhere
@@ -453,7 +470,14 @@ namespace gl
 
 		gl::texture* get_raw_texture() const
 		{
-			return managed_texture.get();
+			// Deduplicated aliases sample an image held by another section
+			return (managed_texture || !content_hash) ? managed_texture.get() : vram_texture;
+		}
+
+		void transfer_image_ownership(cached_texture_section& other)
+		{
+			ASSERT(managed_texture && other.vram_texture == vram_texture && !other.managed_texture);
+			other.managed_texture = std::move(managed_texture);
 		}
 
 		gl::texture_view* get_raw_view()
@@ -516,6 +540,7 @@ namespace gl
 
 		blitter m_hw_blitter;
 		std::vector<discardable_storage> m_temporary_surfaces;
+		std::unique_ptr<gl::ring_buffer> m_upload_heap;
 
 		void clear()
 		{
@@ -868,12 +893,42 @@ namespace gl
 				rsx::texture_create_flags::default_component_order);
 
 			gl::upload_texture(section->get_raw_texture()->id(), gcm_format, width, height, depth, mipmaps,
-					input_swizzled, type, subresource_layout);
+					input_swizzled, type, subresource_layout, m_upload_heap.get());
 
 			section->last_write_tag = rsx::get_shared_tag();
 			return section;
 		}
 
+		cached_texture_section* create_deduplicated_texture(gl::command_context&, const utils::address_range& rsx_range, u64 content_hash, u16 width, u16 height, u16 depth, u16 mipmaps, u16 pitch,
+			u32 gcm_format, rsx::texture_dimension_extended type) override
+		{
+			auto& cached = *find_cached_texture(rsx_range, true, true, width, height, depth, mipmaps);
+			ASSERT(!cached.is_locked());
+
+			// Looked up after find_cached_texture as reusing a section can destroy the previous owner
+			auto owner = get_deduplicated_image_owner(content_hash);
+			if (!owner)
+			{
+				return nullptr;
+			}
+
+			cached.reset(rsx_range);
+			cached.set_context(rsx::texture_upload_context::shader_read);
+			cached.set_image_type(type);
+			cached.set_gcm_format(gcm_format);
+
+			cached.create(width, height, depth, mipmaps, owner->get_raw_texture(), pitch, false);
+			cached.set_dirty(false);
+			register_deduplication_alias(cached, content_hash);
+
+			read_only_range = cached.get_min_max(read_only_range, rsx::section_bounds::locked_range);
+			cached.protect(utils::protection::ro);
+
+			cached.last_write_tag = owner->last_write_tag;
+			update_cache_tag();
+			return &cached;
+		}
+
 		void enforce_surface_creation_type(cached_texture_section& section, u32 gcm_format, rsx::texture_create_flags flags) override
 		{
 			if (flags == section.get_view_flags())
@@ -950,6 +1005,14 @@ namespace gl
 		{
 			m_hw_blitter.init();
 			g_hw_blitter = &m_hw_blitter;
+
+			// Legacy buffers cannot stay mapped, uploads then go through client memory
+			if (!g_cfg.video.gl_legacy_buffers)
+			{
+				m_upload_heap = std::make_unique<gl::ring_buffer>();
+				m_upload_heap->create(gl::buffer::target::pixel_unpack, 128 * 0x100000);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+			}
 		}
 
 		void destroy() override
@@ -957,6 +1020,12 @@ namespace gl
 			clear();
 			g_hw_blitter = nullptr;
 			m_hw_blitter.destroy();
+
+			if (m_upload_heap)
+			{
+				m_upload_heap->remove();
+				m_upload_heap.reset();
+			}
 		}
 
 		bool is_depth_texture(u32 rsx_address, u32 rsx_size) override
@@ -341,8 +341,21 @@ GLVertexProgram::~GLVertexProgram()
 
 void GLVertexProgram::Decompile(const RSXVertexProgram& prog)
 {
+	auto& cache = rsx::get_decompiled_program_cache();
+	const u64 key = rsx::decompiled_program_cache::get_key(prog, gl::get_decompiler_device_key());
+
+	rsx::decompiled_program cached;
+	if (cache.find(key, cached))
+	{
+		shader = std::move(cached.source);
+		return;
+	}
+
 	GLVertexDecompilerThread decompiler(prog, shader, parr);
 	decompiler.Task();
+
+	cached.source = shader;
+	cache.store(key, cached);
 }
 
 void GLVertexProgram::Compile()
@@ -363,6 +376,15 @@ void GLVertexProgram::Compile()
 	glShaderSource(id, 1, &str, &strlen);
 	glCompileShader(id);
 
+	// Querying the status would wait for the compiler threads, it is checked when the program is linked instead
+	if (!gl::get_driver_caps().KHR_parallel_shader_compile_supported)
+	{
+		Validate();
+	}
+}
+
+void GLVertexProgram::Validate() const
+{
 	GLint r = GL_FALSE;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &r);
 	if (r != GL_TRUE)
@@ -56,6 +56,9 @@ public:
 	void Decompile(const RSXVertexProgram& prog);
 	void Compile();
 
+	/** Checks the compile result, logs the vertex shader and pauses emulation on failure. */
+	void Validate() const;
+
 private:
 	void Delete();
 };
@@ -55,3 +55,8 @@ void GSRender::flip(int buffer, bool emu_flip)
 		m_frame->flip(m_context);
 	}
 }
+
+f64 GSRender::get_display_refresh_rate() const
+{
+	return m_frame ? m_frame->refresh_rate() : 0.;
+}
@@ -82,6 +82,7 @@ using draw_context_t = void*;
 		virtual void flip(draw_context_t ctx, bool skip_frame = false) = 0;
 		virtual int client_width() = 0;
 		virtual int client_height() = 0;
+		virtual double refresh_rate() = 0;
 
 		virtual display_handle_t handle() const = 0;
 };
@@ -101,6 +102,7 @@ public:
 	void on_exit() override;
 
 	void flip(int buffer, bool emu_flip = false) override;
+	f64 get_display_refresh_rate() const override;
 
 	GSFrameBase* get_frame() { return m_frame; }
 };
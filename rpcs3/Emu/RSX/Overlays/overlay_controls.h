@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <deque>
 #include <locale>
 
 #ifndef _WIN32
@@ -448,6 +449,104 @@ namespace rsx
 			}
 		};
 
+		// Flattens a compiled resource into a single triangle list for the backends. The state of each command travels with its vertices,
+		// so consecutive commands only need separate draws when they sample different textures. Untextured commands join any batch.
+		struct batched_geometry
+		{
+			enum texture_mode : u32
+			{
+				untextured = 0,
+				image = 1,
+				glyphs = 2
+			};
+
+			struct batch_vertex
+			{
+				vertex pos;        // Position and texture coordinates
+				color4f color;
+				f32 clip_rect[4];  // x1, y1, x2, y2
+				f32 params[4];     // Pulse glow, texture mode, clip enabled, blur strength
+			};
+
+			struct batch
+			{
+				compiled_resource::command_config config;  // Texture sampled by the batch
+				u32 first_vertex;
+				u32 vertex_count;
+			};
+
+			std::vector<batch_vertex> vertices;
+			std::vector<batch> batches;
+
+			static bool is_untextured(const compiled_resource::command_config& config)
+			{
+				switch (config.texture_ref)
+				{
+				case image_resource_id::none:
+				case image_resource_id::game_icon:
+				case image_resource_id::backbuffer:
+					return true;
+				default:
+					return false;
+				}
+			}
+
+			static bool is_same_texture(const compiled_resource::command_config& a, const compiled_resource::command_config& b)
+			{
+				return a.texture_ref == b.texture_ref && a.font_ref == b.font_ref && a.external_data_ref == b.external_data_ref;
+			}
+
+			void build(const compiled_resource& resource)
+			{
+				vertices.clear();
+				batches.clear();
+
+				for (const auto& cmd : resource.draw_commands)
+				{
+					// Every control emits quads as 4 vertex strips
+					const u32 num_quads = (u32)cmd.verts.size() / 4;
+					if (!num_quads)
+					{
+						continue;
+					}
+
+					const bool no_texture = is_untextured(cmd.config);
+					if (batches.empty() || (!no_texture && !is_untextured(batches.back().config) && !is_same_texture(batches.back().config, cmd.config)))
+					{
+						batches.push_back({ cmd.config, (u32)vertices.size(), 0 });
+					}
+					else if (!no_texture && is_untextured(batches.back().config))
+					{
+						// Nothing in the batch sampled a texture so far, it can take this command's texture
+						batches.back().config = cmd.config;
+					}
+
+					batch_vertex v;
+					v.color = cmd.config.color;
+					v.clip_rect[0] = cmd.config.clip_rect.x1;
+					v.clip_rect[1] = cmd.config.clip_rect.y1;
+					v.clip_rect[2] = cmd.config.clip_rect.x2;
+					v.clip_rect[3] = cmd.config.clip_rect.y2;
+					v.params[0] = cmd.config.pulse_glow ? 1.f : 0.f;
+					v.params[1] = (f32)(no_texture ? untextured : (cmd.config.texture_ref == image_resource_id::font_file ? glyphs : image));
+					v.params[2] = cmd.config.clip_region ? 1.f : 0.f;
+					v.params[3] = f32(cmd.config.blur_strength) * 0.01f;
+
+					for (u32 n = 0; n < num_quads; ++n)
+					{
+						const vertex* quad = &cmd.verts[n * 4];
+						for (const u32 index : { 0u, 1u, 2u, 2u, 1u, 3u })
+						{
+							v.pos = quad[index];
+							vertices.push_back(v);
+						}
+					}
+
+					batches.back().vertex_count += num_quads * 6;
+				}
+			}
+		};
+
 		struct overlay_element
 		{
 			enum text_align
@@ -1157,6 +1256,24 @@ namespace rsx
 			compiled_resource& get_compiled() override;
 		};
 
+		// Bar graph of the most recent datapoints, scaled to the largest one. The oldest datapoint is on the left.
+		struct graph : public overlay_element
+		{
+		private:
+			std::deque<f32> m_datapoints;
+			u32 m_datapoint_count = 120;
+			f32 m_min_scale = 0.f;
+
+		public:
+			color4f bar_color = { 1.f, 1.f, 1.f, 1.f };
+
+			void set_datapoint_count(u32 count);
+			void set_min_scale(f32 value);
+			void record_datapoint(f32 value);
+
+			compiled_resource& get_compiled() override;
+		};
+
 		struct list_view : public vertical_layout
 		{
 		private:
@@ -0,0 +1,86 @@
+﻿#include "stdafx.h"
+#include "overlay_controls.h"
+
+namespace rsx
+{
+	namespace overlays
+	{
+		void graph::set_datapoint_count(u32 count)
+		{
+			m_datapoint_count = std::max(count, 1u);
+
+			while (m_datapoints.size() > m_datapoint_count)
+			{
+				m_datapoints.pop_front();
+			}
+
+			is_compiled = false;
+		}
+
+		void graph::set_min_scale(f32 value)
+		{
+			m_min_scale = value;
+			is_compiled = false;
+		}
+
+		void graph::record_datapoint(f32 value)
+		{
+			m_datapoints.push_back(std::max(value, 0.f));
+
+			if (m_datapoints.size() > m_datapoint_count)
+			{
+				m_datapoints.pop_front();
+			}
+
+			is_compiled = false;
+		}
+
+		compiled_resource& graph::get_compiled()
+		{
+			if (!is_compiled)
+			{
+				auto& compiled = overlay_element::get_compiled();
+
+				f32 max_value = m_min_scale;
+				for (const f32 value : m_datapoints)
+				{
+					max_value = std::max(max_value, value);
+				}
+
+				if (!m_datapoints.empty() && max_value > 0.f)
+				{
+					compiled_resource compiled_bars = {};
+					auto& cmd_bars = compiled_bars.append({});
+					cmd_bars.config.color = bar_color;
+
+					const f32 inner_w = f32(w - padding_left - padding_right);
+					const f32 inner_h = f32(h - padding_top - padding_bottom);
+					const f32 bar_w = inner_w / m_datapoint_count;
+					const f32 bottom = f32(y + h - padding_bottom);
+
+					// Right align so that the newest datapoint always sits at the right edge
+					f32 left = f32(x + padding_left) + (m_datapoint_count - m_datapoints.size()) * bar_w;
+
+					auto& verts = cmd_bars.verts;
+					verts.reserve(m_datapoints.size() * 4);
+
+					for (const f32 value : m_datapoints)
+					{
+						const f32 top = bottom - std::max(inner_h * value / max_value, 1.f);
+
+						verts.emplace_back(left, top, 0.f, 0.f);
+						verts.emplace_back(left + bar_w, top, 0.f, 0.f);
+						verts.emplace_back(left, bottom, 0.f, 0.f);
+						verts.emplace_back(left + bar_w, bottom, 0.f, 0.f);
+
+						left += bar_w;
+					}
+
+					compiled.add(compiled_bars, margin_left, margin_top);
+				}
+			}
+
+			return compiled_resources;
+		}
+	} // namespace overlays
+} // namespace rsx
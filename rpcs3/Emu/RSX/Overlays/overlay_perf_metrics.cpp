@@ -43,7 +43,7 @@ namespace rsx
 			return color4f(r / 255.f, g / 255.f, b / 255.f, a / 255.f * opacity);
 		}
 
-		void perf_metrics_overlay::reset_transform(label& elm) const
+		void perf_metrics_overlay::reset_transform(overlay_element& elm, u16 y_offset) const
 		{
 			const u32 text_padding = m_font_size / 2;
 
@@ -52,8 +52,11 @@ namespace rsx
 			const positionu margin { m_margin_x, m_margin_y };
 			positionu pos;
 
+			// The frame time graph sits below the body
+			const u16 body_height = m_body.h + (m_detail == detail_level::extreme ? m_frametime_graph.h : 0);
+
 			const auto overlay_width = m_body.w + margin.x;
-			const auto overlay_height = m_body.h + margin.y;
+			const auto overlay_height = body_height + margin.y;
 
 			switch (m_quadrant)
 			{
@@ -82,17 +85,30 @@ namespace rsx
 
 			if (g_cfg.video.perf_overlay.center_y)
 			{
-				pos.y = (virtual_height - m_body.h) / 2;
+				pos.y = (virtual_height - body_height) / 2;
 			}
 
-			elm.set_pos(pos.x, pos.y);
+			elm.set_pos(pos.x, pos.y + y_offset);
 			elm.set_padding(padding.x1, padding.x2, padding.y1, padding.y2);
 		}
 
 		void perf_metrics_overlay::reset_transforms()
 		{
+			m_frametime_graph.set_size(m_body.w, static_cast<u16>(m_font_size * 4));
+
 			reset_transform(m_body);
 			reset_transform(m_titles);
+			reset_transform(m_frametime_graph, m_body.h);
+		}
+
+		void perf_metrics_overlay::reset_graph()
+		{
+			m_frametime_graph.bar_color = convert_color_code(g_cfg.video.perf_overlay.color_body, m_opacity);
+			m_frametime_graph.back_color = convert_color_code(g_cfg.video.perf_overlay.background_body, m_opacity);
+
+			// Anything up to 30 FPS frame times uses the full height
+			m_frametime_graph.set_min_scale(1000.f / 30.f);
+			reset_transforms();
 		}
 
 		void perf_metrics_overlay::reset_body()
@@ -115,8 +131,19 @@ namespace rsx
 			case detail_level::minimal:
 			case detail_level::low: m_titles.text = ""; break;
 			case detail_level::medium: m_titles.text = fmt::format("\n\n%s", title1_medium); break;
-			case detail_level::high: m_titles.text = fmt::format("\n\n%s\n\n\n\n\n\n%s", title1_high, title2); break;
+			case detail_level::high: m_titles.text = fmt::format("\n\n%s\n\n\n\n\n\n\n%s", title1_high, title2); break;
+			case detail_level::extreme: m_titles.text = fmt::format("\n\n%s\n\n\n\n\n\n\n%s\n\n\n%s", title1_high, title2, title4); break;
+			}
+
+			if (m_detail == detail_level::high && g_cfg.video.gpu_profiler)
+			{
+				m_titles.text += fmt::format("\n\n\n%s", title3);
+			}
+			else if (m_detail == detail_level::extreme && g_cfg.video.gpu_profiler)
+			{
+				m_titles.text += fmt::format("\n\n\n\n\n\n\n\n\n\n%s", title3);
 			}
+
 			m_titles.auto_resize();
 			m_titles.refresh();
 		}
@@ -125,6 +152,7 @@ namespace rsx
 		{
 			reset_body();
 			reset_titles();
+			reset_graph();
 		}
 
 		void perf_metrics_overlay::init()
@@ -144,6 +172,7 @@ namespace rsx
 			if (m_is_initialised)
 			{
 				reset_titles();
+				reset_transforms();
 			}
 		}
 
@@ -204,18 +233,133 @@ namespace rsx
 			}
 		}
 
+		// In seconds
+		void perf_metrics_overlay::set_statistics_window(u32 window)
+		{
+			m_statistics_window = window * 1000;
+		}
+
+		void perf_metrics_overlay::set_write_statistics(bool enabled)
+		{
+			m_write_statistics = enabled;
+		}
+
 		void perf_metrics_overlay::force_next_update()
 		{
 			m_force_update = true;
 		}
 
+		perf_metrics_overlay::window_statistics perf_metrics_overlay::get_window_statistics()
+		{
+			window_statistics stats;
+
+			if (const size_t count = m_frame_samples.size())
+			{
+				std::vector<f32> frametimes;
+				frametimes.reserve(count);
+
+				f32 total = 0.f;
+				for (const auto& sample : m_frame_samples)
+				{
+					frametimes.push_back(sample.frametime);
+					total += sample.frametime;
+				}
+
+				std::sort(frametimes.begin(), frametimes.end());
+
+				// Nearest rank percentiles
+				stats.average = total / count;
+				stats.median = frametimes[(count + 1) / 2 - 1];
+				stats.p99 = frametimes[(count * 99 + 99) / 100 - 1];
+				stats.p999 = frametimes[(count * 999 + 999) / 1000 - 1];
+				stats.max = frametimes.back();
+
+				// Average frame rate of the slowest frames, at least the slowest one
+				const auto low_fps = [&](size_t divisor)
+				{
+					const size_t slowest = std::max<size_t>(count / divisor, 1);
+					f32 sum = 0.f;
+
+					for (size_t n = count - slowest; n < count; ++n)
+					{
+						sum += frametimes[n];
+					}
+
+					return sum > 0.f ? slowest * 1000.f / sum : 0.f;
+				};
+
+				stats.low_1 = low_fps(100);
+				stats.low_01 = low_fps(1000);
+			}
+
+			f32 total_elapsed = 0.f;
+			for (const auto& sample : m_usage_samples)
+			{
+				stats.ppu_usage += sample.ppu_usage * sample.elapsed;
+				stats.spu_usage += sample.spu_usage * sample.elapsed;
+				stats.rsx_usage += sample.rsx_usage * sample.elapsed;
+				total_elapsed += sample.elapsed;
+			}
+
+			if (total_elapsed > 0.f)
+			{
+				stats.ppu_usage /= total_elapsed;
+				stats.spu_usage /= total_elapsed;
+				stats.rsx_usage /= total_elapsed;
+			}
+
+			return stats;
+		}
+
+		void perf_metrics_overlay::write_statistics(f32 fps, f32 frametime, f32 cpu_usage, const window_statistics& stats)
+		{
+			if (!m_statistics_file)
+			{
+				if (!m_statistics_file.open(fs::get_cache_dir() + "perf_metrics.csv", fs::rewrite))
+				{
+					LOG_ERROR(RSX, "Failed to open the performance metrics file");
+					m_write_statistics = false;
+					return;
+				}
+
+				m_statistics_start = get_system_time();
+				m_statistics_file.write(std::string("time_s,fps,frametime_ms,cpu_usage,avg_ms,median_ms,p99_ms,p999_ms,max_ms,low_1_fps,low_01_fps,ppu_usage,spu_usage,rsx_usage\n"));
+			}
+
+			m_statistics_file.write(fmt::format("%.3f,%.2f,%.2f,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f\n",
+				(get_system_time() - m_statistics_start) / 1000000., fps, frametime, cpu_usage, stats.average, stats.median, stats.p99, stats.p999, stats.max,
+				stats.low_1, stats.low_01, stats.ppu_usage, stats.spu_usage, stats.rsx_usage));
+		}
+
 		void perf_metrics_overlay::update()
 		{
 			const auto elapsed = m_update_timer.GetElapsedTimeInMilliSec();
 
+			// Pauses do not count as frame time
+			const u64 now = get_system_time() - Emu.GetPauseTime();
+			const u64 window_start = now > m_statistics_window * 1000ull ? now - m_statistics_window * 1000ull : 0;
+
 			if (!m_force_update)
 			{
 				++m_frames;
+
+				if (m_last_frame_timestamp)
+				{
+					const f32 frametime = (now - m_last_frame_timestamp) / 1000.f;
+					m_frame_samples.push_back({ now, frametime });
+
+					if (m_detail == detail_level::extreme)
+					{
+						m_frametime_graph.record_datapoint(frametime);
+					}
+				}
+
+				m_last_frame_timestamp = now;
+
+				while (!m_frame_samples.empty() && m_frame_samples.front().timestamp < window_start)
+				{
+					m_frame_samples.pop_front();
+				}
 			}
 
 			if (elapsed >= m_update_interval || m_force_update)
@@ -243,14 +387,21 @@ namespace rsx
 				f32 spu_usage{0};
 				f32 rsx_usage{0};
 				u32 rsx_load{0};
+				std::string vram_usage;
+				std::string gpu_time;
 
 				std::shared_ptr<GSRender> rsx_thread;
 
 				std::string perf_text;
 
+				// The statistics file gets every metric regardless of what is displayed
+				const detail_level metrics_level = m_write_statistics ? detail_level::extreme : m_detail;
+				const bool window_metrics = metrics_level == detail_level::extreme;
+
 				// 1. Fetch/calculate metrics we'll need
-				switch (m_detail)
+				switch (metrics_level)
 				{
+				case detail_level::extreme:
 				case detail_level::high:
 				{
 					frametime = m_force_update ? 0 : std::max(0.0, elapsed / m_frames);
@@ -258,6 +409,39 @@ namespace rsx
 					rsx_thread = fxm::get<GSRender>();
 					rsx_load = rsx_thread->get_load();
 
+					if (const auto [usage, budget] = rsx_thread->get_video_memory_usage(); budget)
+					{
+						vram_usage = fmt::format("%u/%u MB", usage / 0x100000, budget / 0x100000);
+					}
+					else
+					{
+						vram_usage = "N/A";
+					}
+
+					if (g_cfg.video.gpu_profiler)
+					{
+						gpu_time = fmt::format("\n\n%s", std::string(title3.size(), ' '));
+
+						if (rsx::gpu_frame_timings timings; rsx_thread->get_gpu_frame_timings(timings))
+						{
+							static const char* labels[] = { "Draw ", "Tex  ", "Comp ", "UI   ", "Flip " };
+							static_assert(std::size(labels) == gpu_timer_category_count);
+
+							f32 total = 0.f;
+							for (u32 i = 0; i < gpu_timer_category_count; ++i)
+							{
+								gpu_time += fmt::format("\n %s : %05.2f ms", labels[i], timings[i]);
+								total += timings[i];
+							}
+
+							gpu_time += fmt::format("\n Total : %05.2f ms", total);
+						}
+						else
+						{
+							gpu_time += "\n N/A";
+						}
+					}
+
 					total_threads = CPUStats::get_thread_count();
 
 					// fallthrough
@@ -286,6 +470,16 @@ namespace rsx
 					spu_usage = std::clamp(cpu_usage * spu_cycles / total_cycles, 0.f, 100.f);
 					rsx_usage = std::clamp(cpu_usage * rsx_cycles / total_cycles, 0.f, 100.f);
 
+					if (window_metrics && !m_force_update)
+					{
+						m_usage_samples.push_back({ now, static_cast<f32>(elapsed), ppu_usage, spu_usage, rsx_usage });
+
+						while (m_usage_samples.front().timestamp < window_start)
+						{
+							m_usage_samples.pop_front();
+						}
+					}
+
 					// fallthrough
 				}
 				case detail_level::low:
@@ -301,6 +495,34 @@ namespace rsx
 				}
 				}
 
+				window_statistics stats;
+				std::string pacing_text;
+
+				if (window_metrics)
+				{
+					stats = get_window_statistics();
+
+					if (m_write_statistics && !m_force_update)
+					{
+						write_statistics(fps, frametime, cpu_usage, stats);
+					}
+
+					if (m_detail == detail_level::extreme)
+					{
+						pacing_text = fmt::format("\n\n%s\n"
+						                          " Avg      : %05.2f ms\n"
+						                          " Median   : %05.2f ms\n"
+						                          " 99th     : %05.2f ms\n"
+						                          " 99.9th   : %05.2f ms\n"
+						                          " Max      : %05.2f ms\n"
+						                          " 1%% Low   : %05.2f FPS\n"
+						                          " 0.1%% Low : %05.2f FPS\n"
+						                          " Busy     : PPU %04.1f %%, SPU %04.1f %%, RSX %04.1f %%",
+						    std::string(title4.size(), ' '), stats.average, stats.median, stats.p99, stats.p999, stats.max, stats.low_1, stats.low_01,
+						    stats.ppu_usage, stats.spu_usage, stats.rsx_usage);
+					}
+				}
+
 				// 2. Format output string
 				switch (m_detail)
 				{
@@ -327,6 +549,7 @@ namespace rsx
 					    fps, std::string(title1_medium.size(), ' '), ppu_usage, spu_usage, rsx_usage, cpu_usage, std::string(title2.size(), ' '));
 					break;
 				}
+				case detail_level::extreme:
 				case detail_level::high:
 				{
 					perf_text += fmt::format("FPS : %05.2f (%03.1fms)\n\n"
@@ -334,10 +557,13 @@ namespace rsx
 					                         " PPU   : %04.1f %% (%2u)\n"
 					                         " SPU   : %04.1f %% (%2u)\n"
 					                         " RSX   : %04.1f %% ( 1)\n"
-					                         " Total : %04.1f %% (%2u)\n\n"
+					                         " Total : %04.1f %% (%2u)\n"
+					                         " VRAM  : %s\n\n"
 					                         "%s\n"
-					                         " RSX   : %02u %%",
-					    fps, frametime, std::string(title1_high.size(), ' '), ppu_usage, ppus, spu_usage, spus, rsx_usage, cpu_usage, total_threads, std::string(title2.size(), ' '), rsx_load);
+					                         " RSX   : %02u %%"
+					                         "%s"
+					                         "%s",
+					    fps, frametime, std::string(title1_high.size(), ' '), ppu_usage, ppus, spu_usage, spus, rsx_usage, cpu_usage, total_threads, vram_usage, std::string(title2.size(), ' '), rsx_load, pacing_text, gpu_time);
 					break;
 				}
 				}
@@ -331,6 +331,7 @@ namespace rsx
 			   low - fps, total cpu usage
 			   medium - fps, detailed cpu usage
 			   high - fps, frametime, detailed cpu usage, thread number, rsx load
+			   extreme - high, frame time percentiles, 1%/0.1% lows and thread usage over the statistics window, frame time graph
 			 */
 			detail_level m_detail;
 
@@ -339,6 +340,32 @@ namespace rsx
 
 			label m_body;
 			label m_titles;
+			graph m_frametime_graph;
+
+			struct frame_sample
+			{
+				u64 timestamp;
+				f32 frametime; // In ms
+			};
+
+			struct usage_sample
+			{
+				u64 timestamp;
+				f32 elapsed;   // In ms
+				f32 ppu_usage;
+				f32 spu_usage;
+				f32 rsx_usage;
+			};
+
+			// Samples of the statistics window, oldest first
+			std::deque<frame_sample> m_frame_samples;
+			std::deque<usage_sample> m_usage_samples;
+			u64 m_last_frame_timestamp = 0;
+			u32 m_statistics_window = 10000; // in ms
+
+			fs::file m_statistics_file;
+			bool m_write_statistics = false;
+			u64 m_statistics_start = 0;
 
 			CPUStats m_cpu_stats;
 			Timer m_update_timer;
@@ -356,9 +383,29 @@ namespace rsx
 			const std::string title1_medium{"CPU Utilization:"};
 			const std::string title1_high{"Host Utilization (CPU):"};
 			const std::string title2{"Guest Utilization (PS3):"};
+			const std::string title3{"GPU Time (Host):"};
+			const std::string title4{"Frame Pacing (Window):"};
 
-			void reset_transform(label& elm) const;
+			void reset_transform(overlay_element& elm, u16 y_offset = 0) const;
 			void reset_transforms();
+			void reset_graph();
+
+			struct window_statistics
+			{
+				f32 average = 0.f; // Frame times in ms
+				f32 median = 0.f;
+				f32 p99 = 0.f;
+				f32 p999 = 0.f;
+				f32 max = 0.f;
+				f32 low_1 = 0.f;   // FPS over the slowest 1% and 0.1% of frames
+				f32 low_01 = 0.f;
+				f32 ppu_usage = 0.f;
+				f32 spu_usage = 0.f;
+				f32 rsx_usage = 0.f;
+			};
+
+			window_statistics get_window_statistics();
+			void write_statistics(f32 fps, f32 frametime, f32 cpu_usage, const window_statistics& stats);
 			void reset_body();
 			void reset_titles();
 			void reset_text();
@@ -373,6 +420,8 @@ namespace rsx
 			void set_font_size(u32 font_size);
 			void set_margins(u32 margin_x, u32 margin_y);
 			void set_opacity(f32 opacity);
+			void set_statistics_window(u32 window);
+			void set_write_statistics(bool enabled);
 			void force_next_update();
 
 			void update() override;
@@ -381,6 +430,12 @@ namespace rsx
 			{
 				auto result = m_body.get_compiled();
 				result.add(m_titles.get_compiled());
+
+				if (m_detail == detail_level::extreme)
+				{
+					result.add(m_frametime_graph.get_compiled());
+				}
+
 				return result;
 			}
 		};
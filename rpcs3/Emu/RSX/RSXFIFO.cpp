@@ -11,6 +11,7 @@ namespace rsx
 		FIFO_control::FIFO_control(::rsx::thread* pctrl)
 		{
 			m_ctrl = pctrl->ctrl;
+			m_batch_decode = g_cfg.video.fifo_batch_decode.get();
 		}
 
 		void FIFO_control::inc_get(bool wait)
@@ -56,13 +57,47 @@ namespace rsx
 			// Update ctrl registers
 			m_ctrl->get.release(m_internal_get = get);
 			m_remaining_commands = 0;
+			m_decoded_pos = m_decoded_count = 0;
 
 			// Clear memwatch spinner
 			m_memwatch_addr = 0;
 		}
 
+		bool FIFO_control::decode_args()
+		{
+			// Byteswap all arguments of the packet which are already behind PUT
+			const u32 put = m_ctrl->put;
+			u32 count = std::min<u32>(m_remaining_commands, ::size32(m_decoded));
+
+			if (put >= m_internal_get)
+			{
+				count = std::min((put - m_internal_get) / 4, count);
+			}
+
+			vm::copy_from_be(m_decoded.data(), vm::_ptr<u32>(m_args_ptr + 4), count);
+			m_decoded_pos = 0;
+			m_decoded_count = count;
+			return count != 0;
+		}
+
 		bool FIFO_control::read_unsafe(register_pair& data)
 		{
+			if (m_batch_decode && m_remaining_commands)
+			{
+				if (m_decoded_pos == m_decoded_count && !decode_args())
+				{
+					return false;
+				}
+
+				m_command_reg += m_command_inc;
+				m_args_ptr += 4;
+				m_remaining_commands--;
+				m_internal_get += 4;
+
+				data.set(m_command_reg, m_decoded[m_decoded_pos++]);
+				return true;
+			}
+
 			// Fast read with no processing, only safe inside a PACKET_BEGIN+count block
 			if (m_remaining_commands &&
 				m_internal_get != m_ctrl->put)
@@ -79,6 +114,49 @@ namespace rsx
 			return false;
 		}
 
+		u32 FIFO_control::read_repeated(u32* dst, u32 max)
+		{
+			if (m_command_inc)
+			{
+				return 0;
+			}
+
+			max = std::min(max, m_remaining_commands);
+			u32 count = 0;
+
+			if (m_batch_decode)
+			{
+				while (count < max && (m_decoded_pos != m_decoded_count || decode_args()))
+				{
+					const u32 n = std::min(max - count, m_decoded_count - m_decoded_pos);
+					std::memcpy(dst + count, m_decoded.data() + m_decoded_pos, n * sizeof(u32));
+					m_decoded_pos += n;
+					count += n;
+
+					// decode_args() starts after the last consumed argument
+					m_args_ptr += n * 4;
+					m_remaining_commands -= n;
+					m_internal_get += n * 4;
+				}
+
+				return count;
+			}
+
+			const u32 put = m_ctrl->put;
+			count = max;
+
+			if (put >= m_internal_get)
+			{
+				count = std::min((put - m_internal_get) / 4, count);
+			}
+
+			vm::copy_from_be(dst, vm::_ptr<u32>(m_args_ptr + 4), count);
+			m_args_ptr += count * 4;
+			m_remaining_commands -= count;
+			m_internal_get += count * 4;
+			return count;
+		}
+
 		void FIFO_control::read(register_pair& data)
 		{
 			const u32 put = m_ctrl->put;
@@ -171,6 +249,7 @@ namespace rsx
 				m_command_reg = cmd & 0xfffc;
 				m_command_inc = ((cmd & RSX_METHOD_NON_INCREMENT_CMD_MASK) == RSX_METHOD_NON_INCREMENT_CMD) ? 0 : 4;
 				m_remaining_commands = count - 1;
+				m_decoded_pos = m_decoded_count = 0;
 			}
 
 			inc_get(true); // Wait for data block to become available
@@ -497,7 +576,9 @@ namespace rsx
 					replay_cmd.rsx_command = std::make_pair((reg << 2) | (1u << 18), value);
 
 					frame_capture.replay_commands.push_back(replay_cmd);
-					auto it = frame_capture.replay_commands.back();
+					capture::flush_replay_commands();
+
+					auto& it = frame_capture.replay_commands.back();
 
 					switch (reg)
 					{
@@ -557,6 +638,30 @@ namespace rsx
 			{
 				method(this, reg, value);
 			}
+
+			if (reg == NV4097_INLINE_ARRAY && LIKELY(!capture_current_frame && !m_flattener.is_enabled()))
+			{
+				// Append the rest of the packet at once instead of one method call per argument
+				auto& inline_array = method_registers.current_draw_clause.inline_vertex_array;
+
+				if (const u32 remaining = fifo_ctrl->get_remaining_commands())
+				{
+					const u32 size = inline_array.size();
+
+					if (inline_array.capacity() < size + remaining)
+					{
+						inline_array.reserve(std::max(size + remaining, inline_array.capacity() * 2));
+					}
+
+					const u32 count = fifo_ctrl->read_repeated(inline_array.data() + size, remaining);
+					inline_array.resize(size + count);
+
+					if (count)
+					{
+						method_registers.decode(reg, inline_array.back());
+					}
+				}
+			}
 		}
 		while (fifo_ctrl->read_unsafe(command));
 
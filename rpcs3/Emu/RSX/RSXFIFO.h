@@ -122,11 +122,20 @@ namespace rsx
 			u32 m_remaining_commands = 0;
 			u32 m_args_ptr = 0;
 
+			// Arguments of the current packet decoded ahead of execution
+			bool m_batch_decode = false;
+			u32 m_decoded_pos = 0;
+			u32 m_decoded_count = 0;
+			std::array<u32, 0x800> m_decoded;
+
+			bool decode_args();
+
 		public:
 			FIFO_control(rsx::thread* pctrl);
 			~FIFO_control() = default;
 
 			u32 get_pos() { return m_internal_get; }
+			u32 get_remaining_commands() const { return m_remaining_commands; }
 			void sync_get() { m_ctrl->get.release(m_internal_get); }
 			void inc_get(bool wait);
 			void set_get(u32 get);
@@ -134,6 +143,9 @@ namespace rsx
 
 			void read(register_pair& data);
 			inline bool read_unsafe(register_pair& data);
+
+			// Read up to max more arguments of a non-incrementing packet at once (only those behind PUT), returns the count
+			u32 read_repeated(u32* dst, u32 max);
 		};
 	}
 }
\ No newline at end of file
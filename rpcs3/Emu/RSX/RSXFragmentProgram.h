@@ -244,6 +244,9 @@ struct RSXFragmentProgram
 	u8 textures_alpha_kill[16];
 	u8 textures_zfunc[16];
 
+	// Ucode hash of a write-protected program, 0 if it has to be computed on lookup
+	u64 ucode_hash;
+
 	bool valid;
 
 	rsx::texture_dimension_extended get_texture_dimension(u8 id) const
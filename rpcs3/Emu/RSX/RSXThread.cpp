@@ -17,6 +17,7 @@
 
 #include "Utilities/GSL.h"
 #include "Utilities/StrUtil.h"
+#include "Utilities/timeline.h"
 
 #include <cereal/archives/binary.hpp>
 
@@ -26,6 +27,13 @@
 #include <exception>
 #include <cfenv>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
 class GSRender;
 
 #define CMD_DEBUG 0
@@ -44,7 +52,168 @@ namespace rsx
 	std::function<bool(u32 addr, bool is_writing)> g_access_violation_handler;
 	thread* g_current_renderer = nullptr;
 
-	u32 get_address(u32 offset, u32 location)
+	deadline_timer::deadline_timer()
+	{
+#ifdef _WIN32
+		// CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, not available before Windows 10 1803
+		m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0x2, TIMER_ALL_ACCESS);
+
+		if (!m_timer)
+		{
+			m_timer = CreateWaitableTimerW(nullptr, TRUE, nullptr);
+		}
+#endif
+	}
+
+	deadline_timer::~deadline_timer()
+	{
+#ifdef _WIN32
+		if (m_timer)
+		{
+			CloseHandle(m_timer);
+		}
+#endif
+	}
+
+	void deadline_timer::wait_until(u64 deadline)
+	{
+#ifdef __linux__
+		// get_system_time() is CLOCK_MONOTONIC based
+		struct timespec ts;
+		ts.tv_sec = deadline / 1000000;
+		ts.tv_nsec = (deadline % 1000000) * 1000;
+
+		while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR);
+#else
+		const u64 now = get_system_time();
+
+		if (deadline <= now)
+		{
+			return;
+		}
+
+#ifdef _WIN32
+		if (m_timer)
+		{
+			// Relative due time in 100ns units
+			LARGE_INTEGER due;
+			due.QuadPart = -static_cast<s64>((deadline - now) * 10);
+
+			if (SetWaitableTimer(m_timer, &due, 0, nullptr, nullptr, FALSE))
+			{
+				WaitForSingleObject(m_timer, INFINITE);
+				return;
+			}
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::microseconds(deadline - now));
+#endif
+	}
+
+	u64 frame_limiter::wait(f64 rate)
+	{
+		const u64 pause_time = Emu.GetPauseTime();
+		const u64 now = get_system_time() - pause_time;
+		const f64 period = 1000000. / rate;
+
+		if (rate != m_rate || !m_frame_index)
+		{
+			m_rate = rate;
+			m_start_time = now;
+			m_frame_index = 1;
+			return 0;
+		}
+
+		// Deadlines are derived from the frame count so rounding never accumulates
+		const u64 deadline = m_start_time + static_cast<u64>(m_frame_index * period);
+
+		if (now > deadline + static_cast<u64>(period))
+		{
+			// More than a frame late, restart the schedule instead of rushing the frames that were missed
+			m_start_time = now;
+			m_frame_index = 1;
+			m_stats.on_present(now);
+			return 0;
+		}
+
+		m_frame_index++;
+
+		const u64 margin = std::clamp<u64>(static_cast<u64>(m_oversleep * 2.), min_margin, max_margin);
+
+		if (deadline > now + margin)
+		{
+			// Coarse wait, woken up early enough to absorb the host timer's usual wakeup latency
+			const u64 target = deadline - margin;
+			m_timer.wait_until(target + pause_time);
+
+			const u64 woken = get_system_time() - pause_time;
+			const f64 oversleep = static_cast<f64>(woken > target ? woken - target : 0);
+
+			// Rise fast and decay slowly, an occasional late wakeup costs more than a longer spin
+			m_oversleep += (oversleep - m_oversleep) * (oversleep > m_oversleep ? 0.25 : 0.02);
+		}
+
+		// Fine wait for the remainder
+		u64 release = get_system_time() - pause_time;
+		while (release < deadline)
+		{
+			std::this_thread::yield();
+			release = get_system_time() - pause_time;
+		}
+
+		m_stats.on_present(release);
+		return release - now;
+	}
+
+	bool adaptive_frame_skip::update(u64 now, u64 idle_time, f64 target_rate, f32 gpu_time_ms, u32 max_skip, u32 min_draw)
+	{
+		const u64 elapsed = (m_last_flip_time && now > m_last_flip_time) ? now - m_last_flip_time : 0;
+		const u64 idle = idle_time - m_last_idle_time;
+
+		m_last_flip_time = now;
+		m_last_idle_time = idle_time;
+		m_total_frames++;
+
+		if (!elapsed || target_rate <= 0.)
+		{
+			m_behind = false;
+		}
+		else if (!m_consecutive_skipped)
+		{
+			const f64 period = 1000000. / target_rate;
+			const u64 rsx_load = idle < elapsed ? (elapsed - idle) * 100 / elapsed : 0;
+			const u64 gpu_load = static_cast<u64>(gpu_time_ms * 100000.f) / elapsed;
+			const u64 load = std::max(rsx_load, gpu_load);
+
+			if (elapsed > period * 1.05 && load >= busy_threshold)
+			{
+				m_behind = true;
+			}
+			else if (elapsed <= period || load < headroom_threshold)
+			{
+				m_behind = false;
+			}
+		}
+
+		// Bursts are bounded by the frame skip pattern, the drawn frames in between are the ones measured
+		const bool skip = m_behind && m_consecutive_skipped < max_skip && (m_consecutive_skipped || m_consecutive_drawn >= min_draw);
+
+		if (skip)
+		{
+			m_consecutive_skipped++;
+			m_consecutive_drawn = 0;
+			m_skipped_frames++;
+		}
+		else
+		{
+			m_consecutive_skipped = 0;
+			m_consecutive_drawn++;
+		}
+
+		return skip;
+	}
+
+	u32 get_address_slow(u32 offset, u32 location)
 	{
 
 		switch (location)
@@ -255,7 +424,9 @@ namespace rsx
 		g_current_renderer = this;
 		g_access_violation_handler = [this](u32 address, bool is_writing)
 		{
-			return on_access_violation(address, is_writing);
+			// Fragment programs and backend caches may share the page
+			const bool program_handled = m_fragment_program_analysis.on_access_violation(address, is_writing);
+			return on_access_violation(address, is_writing) || program_handled;
 		};
 
 		m_rtts_dirty = true;
@@ -284,11 +455,36 @@ namespace rsx
 	{
 		if (conditional_render_enabled && conditional_render_test_address)
 		{
-			// Evaluate conditional rendering test
-			zcull_ctrl->read_barrier(this, conditional_render_test_address, 4);
-			vm::ptr<CellGcmReportData> result = vm::cast(conditional_render_test_address);
-			conditional_render_test_failed = (result->value == 0);
-			conditional_render_test_address = 0;
+			if (!g_cfg.video.relaxed_zcull_sync)
+			{
+				// Evaluate conditional rendering test
+				zcull_ctrl->read_barrier(this, conditional_render_test_address, 4);
+				vm::ptr<CellGcmReportData> result = vm::cast(conditional_render_test_address);
+				conditional_render_test_failed = (result->value == 0);
+				conditional_render_test_address = 0;
+			}
+			else
+			{
+				zcull_ctrl->update(this, 0, true);
+
+				if (zcull_ctrl->has_pending_write(conditional_render_test_address, 4))
+				{
+					// Result is not available yet, draw unconditionally and test again on the next draw call
+					conditional_render_test_failed = false;
+				}
+				else
+				{
+					vm::ptr<CellGcmReportData> result = vm::cast(conditional_render_test_address);
+					conditional_render_test_failed = (result->value == 0);
+					conditional_render_test_address = 0;
+				}
+			}
+		}
+
+		if (m_fragment_program_analysis.test_and_reset_written())
+		{
+			// Ucode of an analysed fragment program was overwritten in place
+			m_graphics_state |= rsx::pipeline_state::fragment_program_dirty;
 		}
 
 		if (m_graphics_state & rsx::pipeline_state::fragment_program_dirty)
@@ -356,6 +552,9 @@ namespace rsx
 
 		element_push_buffer.clear();
 
+		// Apply page protection changes queued during the draw
+		rsx::memory_protect_flush();
+
 		if (zcull_ctrl->active)
 			zcull_ctrl->on_draw();
 
@@ -424,6 +623,8 @@ namespace rsx
 				perf_overlay->set_detail_level(perf_settings.level);
 				perf_overlay->set_position(perf_settings.position);
 				perf_overlay->set_update_interval(perf_settings.update_interval);
+				perf_overlay->set_statistics_window(perf_settings.statistics_window);
+				perf_overlay->set_write_statistics(perf_settings.write_statistics.get());
 				perf_overlay->set_font(perf_settings.font);
 				perf_overlay->set_font_size(perf_settings.font_size);
 				perf_overlay->set_margins(perf_settings.margin_x, perf_settings.margin_y);
@@ -448,37 +649,88 @@ namespace rsx
 
 		thread_ctrl::spawn("VBlank Thread", [this]()
 		{
-			const u64 start_time = get_system_time();
+			// Late VBlank events stall titles waiting for them
+			thread_ctrl::set_class_priority(thread_class::vblank);
+
+			// Refresh rate as a ratio, NTSC rate is 60000/1001
+			u64 rate_num = 60, rate_den = 1;
+
+			switch (g_cfg.video.vblank_rate)
+			{
+			case vblank_rate_type::_59_94: rate_num = 60000; rate_den = 1001; break;
+			case vblank_rate_type::_50: rate_num = 50; break;
+			default: break;
+			}
+
+			const u64 period = 1000000 * rate_den / rate_num;
+
+			deadline_timer timer;
+			u64 start_time = get_system_time();
+			u64 intervals = 0;
+
+			// Wakeup latency in microseconds, reported once per ~10 seconds
+			u64 jitter_sum = 0, jitter_max = 0, jitter_samples = 0;
 
 			vblank_count = 0;
 
 			// TODO: exit condition
 			while (!Emu.IsStopped() && !m_rsx_thread_exiting)
 			{
-				if (get_system_time() - start_time > vblank_count * 1000000 / 60)
+				// Deadlines are derived from the interval count so rounding never accumulates
+				const u64 deadline = start_time + (intervals + 1) * 1000000 * rate_den / rate_num;
+				timer.wait_until(deadline);
+
+				const u64 now = get_system_time();
+
+				if (now < deadline)
+				{
+					continue;
+				}
+
+				const u64 latency = now - deadline;
+
+				if (latency > period * 4)
 				{
-					vblank_count++;
-					sys_rsx_context_attribute(0x55555555, 0xFED, 1, 0, 0, 0);
-					if (vblank_handler)
+					// Host stalled for several frames (suspend, debugger), resynchronize instead of firing a burst of vblanks
+					start_time = now;
+					intervals = 0;
+				}
+				else
+				{
+					intervals++;
+					jitter_sum += latency;
+					jitter_max = std::max(jitter_max, latency);
+
+					if (++jitter_samples == rate_num * 10 / rate_den)
 					{
-						intr_thread->cmd_list
-						({
-							{ ppu_cmd::set_args, 1 }, u64{1},
-							{ ppu_cmd::lle_call, vblank_handler },
-							{ ppu_cmd::sleep, 0 }
-						});
-
-						thread_ctrl::notify(*intr_thread);
+						LOG_TRACE(RSX, "VBlank timer jitter: avg=%lluus, max=%lluus", jitter_sum / jitter_samples, jitter_max);
+						jitter_sum = jitter_max = jitter_samples = 0;
 					}
+				}
 
-					std::this_thread::sleep_for(16ms);
-					continue;
+				vblank_count++;
+				sys_rsx_context_attribute(0x55555555, 0xFED, 1, 0, 0, 0);
+				if (vblank_handler)
+				{
+					intr_thread->cmd_list
+					({
+						{ ppu_cmd::set_args, 1 }, u64{1},
+						{ ppu_cmd::lle_call, vblank_handler },
+						{ ppu_cmd::sleep, 0 }
+					});
+
+					thread_ctrl::notify(*intr_thread);
 				}
 
-				while (Emu.IsPaused() && !m_rsx_thread_exiting)
-					std::this_thread::sleep_for(16ms);
+				if (Emu.IsPaused())
+				{
+					while (Emu.IsPaused() && !m_rsx_thread_exiting)
+						std::this_thread::sleep_for(16ms);
 
-				thread_ctrl::wait_for(100); // Hack
+					// Don't count the paused time
+					start_time = get_system_time();
+					intervals = 0;
+				}
 			}
 		});
 
@@ -492,7 +744,7 @@ namespace rsx
 
 			on_decompiler_init();
 
-			if (g_cfg.core.thread_scheduler_enabled)
+			if (g_cfg.core.thread_scheduler_enabled || g_cfg.core.numa_node >= 0 || !g_cfg.core.thread_placement.get().empty())
 			{
 				thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(thread_class::rsx));
 			}
@@ -516,9 +768,9 @@ namespace rsx
 		});
 
 		// Raise priority above other threads
-		thread_ctrl::set_native_priority(1);
+		thread_ctrl::set_class_priority(thread_class::rsx);
 
-		if (g_cfg.core.thread_scheduler_enabled)
+		if (g_cfg.core.thread_scheduler_enabled || g_cfg.core.numa_node >= 0 || !g_cfg.core.thread_placement.get().empty())
 		{
 			thread_ctrl::set_thread_affinity_mask(thread_ctrl::get_affinity_mask(thread_class::rsx));
 		}
@@ -571,6 +823,25 @@ namespace rsx
 
 	void thread::on_exit()
 	{
+		if (m_present_stats.interval_count)
+		{
+			LOG_NOTICE(RSX, "Frame pacing: %llu presents, mean interval %.3fms, deviation %.3fms, worst interval %.3fms",
+				m_present_stats.interval_count, m_present_stats.mean_interval / 1000., std::sqrt(m_present_stats.get_variance()) / 1000., m_present_stats.max_interval / 1000.);
+		}
+
+		const auto& limiter_stats = m_frame_limiter.get_stats();
+		if (limiter_stats.interval_count)
+		{
+			LOG_NOTICE(RSX, "Frame limiter: %llu frames, mean frame time %.3fms, deviation %.3fms, worst frame time %.3fms, wakeup margin %lluus",
+				limiter_stats.interval_count, limiter_stats.mean_interval / 1000., std::sqrt(limiter_stats.get_variance()) / 1000., limiter_stats.max_interval / 1000.,
+				m_frame_limiter.get_margin());
+		}
+
+		if (m_frame_skipper.get_skipped_frames())
+		{
+			LOG_NOTICE(RSX, "Adaptive frame skip: %llu of %llu frames skipped", m_frame_skipper.get_skipped_frames(), m_frame_skipper.get_total_frames());
+		}
+
 		m_rsx_thread_exiting = true;
 	}
 
@@ -719,37 +990,64 @@ namespace rsx
 
 	void thread::write_inline_array_to_buffer(void *dst_buffer)
 	{
-		u8* src =
-			reinterpret_cast<u8*>(rsx::method_registers.current_draw_clause.inline_vertex_array.data());
-		u8* dst = (u8*)dst_buffer;
+		const auto& inline_array = rsx::method_registers.current_draw_clause.inline_vertex_array;
 
-		size_t bytes_written = 0;
-		while (bytes_written <
-			   rsx::method_registers.current_draw_clause.inline_vertex_array.size() * sizeof(u32))
+		// Resolve the vertex layout once, ub4 attributes are the only ones converted
+		std::array<std::pair<u32, bool>, rsx::limits::vertex_count> layout;
+		u32 attribute_count = 0;
+		u32 vertex_size = 0;
+		bool needs_swap = false;
+
+		for (int index = 0; index < rsx::limits::vertex_count; ++index)
 		{
-			for (int index = 0; index < rsx::limits::vertex_count; ++index)
-			{
-				const auto &info = rsx::method_registers.vertex_arrays_info[index];
+			const auto &info = rsx::method_registers.vertex_arrays_info[index];
 
-				if (!info.size()) // disabled
-					continue;
+			if (!info.size()) // disabled
+				continue;
+
+			const bool swap = info.type() == vertex_base_type::ub && info.size() == 4;
+			layout[attribute_count++] = { rsx::get_vertex_type_size_on_host(info.type(), info.size()), swap };
+			vertex_size += layout[attribute_count - 1].first;
+			needs_swap |= swap;
+		}
 
-				u32 element_size = rsx::get_vertex_type_size_on_host(info.type(), info.size());
+		const u32 total_size = inline_array.size() * sizeof(u32);
 
-				if (info.type() == vertex_base_type::ub && info.size() == 4)
+		if (!vertex_size || !total_size)
+		{
+			return;
+		}
+
+		const u8* src = reinterpret_cast<const u8*>(inline_array.data());
+		u8* dst = static_cast<u8*>(dst_buffer);
+
+		// Vertices are written whole, the last one may extend past the array
+		const u32 vertex_count = (total_size + vertex_size - 1) / vertex_size;
+
+		if (!needs_swap)
+		{
+			std::memcpy(dst, src, total_size);
+			return;
+		}
+
+		for (u32 vertex = 0; vertex < vertex_count; ++vertex)
+		{
+			for (u32 i = 0; i < attribute_count; ++i)
+			{
+				const u32 element_size = layout[i].first;
+
+				if (layout[i].second)
 				{
-					dst[0] = src[3];
-					dst[1] = src[2];
-					dst[2] = src[1];
-					dst[3] = src[0];
+					const u32 value = *reinterpret_cast<const u32*>(src);
+					*reinterpret_cast<u32*>(dst) = se_storage<u32>::swap(value);
 				}
 				else
-					memcpy(dst, src, element_size);
+				{
+					std::memcpy(dst, src, element_size);
+				}
 
 				src += element_size;
 				dst += element_size;
-
-				bytes_written += element_size;
 			}
 		}
 	}
@@ -1248,16 +1546,33 @@ namespace rsx
 		current_vertex_program.skip_vertex_input_check = skip_vertex_inputs;
 
 		current_vertex_program.rsx_vertex_inputs.clear();
-		current_vertex_program.data.reserve(512 * 4);
-		current_vertex_program.jump_table.clear();
 		current_vertex_program.texture_dimensions = 0;
 
-		current_vp_metadata = program_hash_util::vertex_program_utils::analyse_vertex_program
-		(
-			method_registers.transform_program.data(),  // Input raw block
-			transform_program_start,                    // Address of entry point
-			current_vertex_program                      // [out] Program object
-		);
+		// The analysis only depends on the ucode, which only changes with the epoch
+		auto& analysis = m_vertex_program_analysis[transform_program_start];
+		if (analysis.epoch != method_registers.transform_program_epoch || analysis.program.data.empty())
+		{
+			analysis.epoch = method_registers.transform_program_epoch;
+			analysis.program.data.reserve(512 * 4);
+			analysis.program.jump_table.clear();
+
+			analysis.metadata = program_hash_util::vertex_program_utils::analyse_vertex_program
+			(
+				method_registers.transform_program.data(),  // Input raw block
+				transform_program_start,                    // Address of entry point
+				analysis.program                            // [out] Program object
+			);
+
+			analysis.program.ucode_hash = program_hash_util::vertex_program_utils::get_vertex_program_ucode_hash(analysis.program);
+		}
+
+		current_vp_metadata = analysis.metadata;
+		current_vertex_program.data = analysis.program.data;
+		current_vertex_program.base_address = analysis.program.base_address;
+		current_vertex_program.entry = analysis.program.entry;
+		current_vertex_program.instruction_mask = analysis.program.instruction_mask;
+		current_vertex_program.jump_table = analysis.program.jump_table;
+		current_vertex_program.ucode_hash = analysis.program.ucode_hash;
 
 		if (!skip_textures && current_vp_metadata.referenced_textures_mask != 0)
 		{
@@ -1316,11 +1631,37 @@ namespace rsx
 		}
 	}
 
-	void thread::analyse_inputs_interleaved(vertex_input_layout& result) const
+	void thread::analyse_inputs_interleaved(vertex_input_layout& result)
 	{
 		const rsx_state& state = rsx::method_registers;
 		const u32 input_mask = state.vertex_attrib_input_mask();
 
+		const auto update_real_addresses = [&]()
+		{
+			for (auto &info : result.interleaved_blocks)
+			{
+				//Calculate real data address to be used during upload
+				info.real_offset_address = rsx::get_address(rsx::get_vertex_offset_from_base(state.vertex_data_base_offset(), info.base_offset), info.memory_location);
+			}
+		};
+
+		if (state.current_draw_clause.command == rsx::draw_command::inlined_array || state.current_draw_clause.is_immediate_draw)
+		{
+			// Layout depends on the draw data, the next draw needs a full analysis
+			m_graphics_state |= rsx::pipeline_state::vertex_arrays_dirty;
+		}
+		else if (!(m_graphics_state & rsx::pipeline_state::vertex_arrays_dirty) && m_vertex_layout_base_offset == state.vertex_data_base_offset())
+		{
+			// Nothing changed since the last draw, but the IO map the addresses go through may have
+			update_real_addresses();
+			return;
+		}
+		else
+		{
+			m_graphics_state &= ~rsx::pipeline_state::vertex_arrays_dirty;
+			m_vertex_layout_base_offset = state.vertex_data_base_offset();
+		}
+
 		result.clear();
 
 		if (state.current_draw_clause.command == rsx::draw_command::inlined_array)
@@ -1470,11 +1811,7 @@ namespace rsx
 			}
 		}
 
-		for (auto &info : result.interleaved_blocks)
-		{
-			//Calculate real data address to be used during upload
-			info.real_offset_address = rsx::get_address(rsx::get_vertex_offset_from_base(state.vertex_data_base_offset(), info.base_offset), info.memory_location);
-		}
+		update_real_addresses();
 	}
 
 	void thread::get_current_fragment_program(const std::array<std::unique_ptr<rsx::sampled_image_descriptor_base>, rsx::limits::fragment_textures_count>& sampler_descriptors)
@@ -1490,12 +1827,33 @@ namespace rsx
 		const u32 program_location = (shader_program & 0x3) - 1;
 		const u32 program_offset = (shader_program & ~0x3);
 
-		result.addr = vm::base(rsx::get_address(program_offset, program_location));
-		current_fp_metadata = program_hash_util::fragment_program_utils::analyse_fragment_program(result.addr);
+		const u32 program_address = rsx::get_address(program_offset, program_location);
+		result.addr = vm::base(program_address);
+
+		// Written ucode is dropped from the analysis cache, unchanged programs skip the analysis and hashing
+		u64 ucode_hash;
+		if (m_fragment_program_analysis.find(program_address, current_fp_metadata, ucode_hash))
+		{
+			result.ucode_hash = ucode_hash;
+		}
+		else
+		{
+			current_fp_metadata = program_hash_util::fragment_program_utils::analyse_fragment_program(result.addr);
+		}
 
 		result.addr = ((u8*)result.addr + current_fp_metadata.program_start_offset);
 		result.offset = program_offset + current_fp_metadata.program_start_offset;
 		result.ucode_length = current_fp_metadata.program_ucode_length;
+
+		if (!result.ucode_hash)
+		{
+			// Only protected programs keep their hash, others are hashed on lookup
+			ucode_hash = program_hash_util::fragment_program_utils::get_fragment_program_ucode_hash(result);
+			if (m_fragment_program_analysis.store(program_address, current_fp_metadata, ucode_hash))
+			{
+				result.ucode_hash = ucode_hash;
+			}
+		}
 		result.valid = true;
 		result.ctrl = rsx::method_registers.shader_control() & (CELL_GCM_SHADER_CONTROL_32_BITS_EXPORTS | CELL_GCM_SHADER_CONTROL_DEPTH_EXPORT);
 		result.unnormalized_coords = 0;
@@ -1733,6 +2091,7 @@ namespace rsx
 	void thread::reset()
 	{
 		rsx::method_registers.reset();
+		m_graphics_state |= rsx::pipeline_state::vertex_arrays_dirty;
 	}
 
 	void thread::init(u32 ioAddress, u32 ioSize, u32 ctrlAddress, u32 localAddress)
@@ -2124,7 +2483,23 @@ namespace rsx
 				zcull_ctrl->sync(this);
 			}
 
-			if (g_cfg.video.frame_skip_enabled)
+			if (g_cfg.video.frame_skip_enabled && g_cfg.video.adaptive_frame_skip)
+			{
+				f32 gpu_time = 0.f;
+				gpu_frame_timings timings;
+				if (get_gpu_frame_timings(timings))
+				{
+					for (const f32 category_time : timings)
+						gpu_time += category_time;
+				}
+
+				const bool skip = m_frame_skipper.update(get_system_time() - Emu.GetPauseTime(), performance_counters.idle_time.load(), m_target_frame_rate,
+					gpu_time, g_cfg.video.consequtive_frames_to_skip, g_cfg.video.consequtive_frames_to_draw);
+
+				skip_present = skip;
+				skip_frame = skip && g_cfg.video.adaptive_frame_skip_draws;
+			}
+			else if (g_cfg.video.frame_skip_enabled)
 			{
 				m_skip_frame_ctr++;
 
@@ -2132,6 +2507,12 @@ namespace rsx
 					m_skip_frame_ctr = -g_cfg.video.consequtive_frames_to_skip;
 
 				skip_frame = (m_skip_frame_ctr < 0);
+				skip_present = skip_frame;
+			}
+			else
+			{
+				skip_frame = false;
+				skip_present = false;
 			}
 		}
 		else
@@ -2151,15 +2532,51 @@ namespace rsx
 			}
 		}
 
+		if (benchmark_null_present)
+		{
+			skip_present = true;
+		}
+
+		timeline::counter("RSX", "Draw calls", m_draw_calls);
+
+		if (emu_flip && benchmark_mode)
+		{
+			frame_benchmark_stats stats;
+			stats.frame_index = int_flip_index;
+			stats.timestamp = get_system_time();
+			stats.idle_time = performance_counters.idle_time;
+			stats.draw_calls = m_draw_calls;
+			stats.pipelines_compiled = m_pipelines_compiled;
+			get_texture_cache_statistics(stats);
+
+			gpu_frame_timings timings;
+			if (get_gpu_frame_timings(timings))
+			{
+				for (const f32 category_time : timings)
+					stats.gpu_time_ms += category_time;
+			}
+
+			std::lock_guard lock(m_benchmark_stats_mutex);
+			m_benchmark_stats.push_back(stats);
+		}
+
 		if (!skip_frame)
 		{
 			// Reset counter
 			m_draw_calls = 0;
 		}
 
+		m_pipelines_compiled = 0;
 		performance_counters.sampled_frames++;
 	}
 
+	void thread::take_frame_benchmark_stats(std::vector<frame_benchmark_stats>& stats)
+	{
+		std::lock_guard lock(m_benchmark_stats_mutex);
+		stats.insert(stats.end(), m_benchmark_stats.begin(), m_benchmark_stats.end());
+		m_benchmark_stats.clear();
+	}
+
 	void thread::check_zcull_status(bool framebuffer_swap)
 	{
 		if (g_cfg.video.disable_zcull_queries)
@@ -2232,7 +2649,15 @@ namespace rsx
 
 	void thread::sync()
 	{
-		zcull_ctrl->sync(this);
+		if (!g_cfg.video.relaxed_zcull_sync)
+		{
+			zcull_ctrl->sync(this);
+		}
+		else
+		{
+			// Retire what the backend has finished, the rest is written from the update loop or on read_barrier
+			zcull_ctrl->update(this, 0, true);
+		}
 
 		// Fragment constants may have been updated
 		m_graphics_state |= rsx::pipeline_state::fragment_constants_dirty;
@@ -2261,10 +2686,13 @@ namespace rsx
 		if (m_rsx_thread_exiting)
 			return;
 
-		reader_lock lock(m_mtx_task);
-
 		const auto map_range = address_range::start_length(address, size);
 
+		// Don't let queued protection changes of the old mapping apply to the new one
+		rsx::g_protection_batch.discard(map_range);
+
+		reader_lock lock(m_mtx_task);
+
 		if (!m_invalidated_memory_range.valid())
 			return;
 
@@ -2279,6 +2707,9 @@ namespace rsx
 	{
 		if (!m_rsx_thread_exiting && address < 0xC0000000)
 		{
+			// Queued protection changes of the unmapped memory are stale
+			rsx::g_protection_batch.discard(address_range::start_length(address, size));
+
 			u32 ea = address >> 20, io = RSXIOMem.io[ea];
 
 			if (io < 512)
@@ -2329,10 +2760,28 @@ namespace rsx
 		if (!m_invalidated_memory_range.valid())
 			return;
 
+		m_fragment_program_analysis.invalidate_range(m_invalidated_memory_range);
 		on_invalidate_memory_range(m_invalidated_memory_range);
 		m_invalidated_memory_range.invalidate();
 	}
 
+	void thread::handle_written_memory()
+	{
+		// Invalidate write-tracked memory written since the last frame
+		std::vector<address_range> written;
+		rsx::g_protection_batch.poll_written(written);
+
+		if (written.empty())
+			return;
+
+		std::lock_guard lock(m_mtx_task);
+
+		for (const auto& range : written)
+		{
+			on_invalidate_memory_range(range);
+		}
+	}
+
 	//Pause/cont wrappers for FIFO ctrl. Never call this from rsx thread itself!
 	void thread::pause()
 	{
@@ -2359,7 +2808,8 @@ namespace rsx
 		if (!performance_counters.last_update_timestamp || performance_counters.sampled_frames > 30)
 		{
 			const auto timestamp = get_system_time();
-			const auto idle = performance_counters.idle_time.load();
+			const auto total_idle = performance_counters.idle_time.load();
+			const auto idle = total_idle - performance_counters.last_update_idle_time;
 			const auto elapsed = timestamp - performance_counters.last_update_timestamp;
 
 			if (elapsed > idle)
@@ -2367,7 +2817,7 @@ namespace rsx
 			else
 				performance_counters.approximate_load = 0u;
 
-			performance_counters.idle_time = 0;
+			performance_counters.last_update_idle_time = total_idle;
 			performance_counters.sampled_frames = 0;
 			performance_counters.last_update_timestamp = timestamp;
 		}
@@ -2400,37 +2850,44 @@ namespace rsx
 
 	void thread::handle_emu_flip(u32 buffer)
 	{
+		timeline::scoped_event event("RSX", "Flip", buffer);
+
 		if (user_asked_for_frame_capture && !capture_current_frame)
 		{
-			capture_current_frame = true;
 			user_asked_for_frame_capture = false;
 			frame_debug.reset();
 			frame_capture.reset();
 
-			// random number just to jumpstart the size
-			frame_capture.replay_commands.reserve(8000);
+			// The capture is streamed to disk while the frames run, the file is finalized once the last one flipped
+			const std::string file_path = fs::get_config_dir() + "captures/" + Emu.GetTitleID() + "_" + date_time::current_time_narrow() + "_capture.rrc";
+			if (capture::begin_capture_stream(file_path))
+			{
+				capture_current_frame = true;
+				m_capture_frames_remaining = g_cfg.video.frames_to_capture;
+
+				// random number just to jumpstart the size
+				frame_capture.replay_commands.reserve(8000);
 
-			// capture first tile state with nop cmd
-			rsx::frame_capture_data::replay_command replay_cmd;
-			replay_cmd.rsx_command = std::make_pair(NV4097_NO_OPERATION, 0);
-			frame_capture.replay_commands.push_back(replay_cmd);
-			capture::capture_display_tile_state(this, frame_capture.replay_commands.back());
+				// capture first tile state with nop cmd
+				rsx::frame_capture_data::replay_command replay_cmd;
+				replay_cmd.rsx_command = std::make_pair(NV4097_NO_OPERATION, 0);
+				frame_capture.replay_commands.push_back(replay_cmd);
+				capture::capture_display_tile_state(this, frame_capture.replay_commands.back());
+			}
+		}
+		else if (capture_current_frame && --m_capture_frames_remaining)
+		{
+			LOG_NOTICE(RSX, "Captured frame %u of %u", g_cfg.video.frames_to_capture - m_capture_frames_remaining, g_cfg.video.frames_to_capture);
 		}
 		else if (capture_current_frame)
 		{
 			capture_current_frame = false;
-			std::stringstream os;
-			cereal::BinaryOutputArchive archive(os);
-			const std::string& filePath = fs::get_config_dir() + "captures/" + Emu.GetTitleID() + "_" + date_time::current_time_narrow() + "_capture.rrc";
-			archive(frame_capture);
+
+			if (capture::end_capture_stream())
 			{
-				// todo: may want to compress this data?
-				fs::file f(filePath, fs::rewrite);
-				f.write(os.str());
+				LOG_SUCCESS(RSX, "capture successful");
 			}
 
-			LOG_SUCCESS(RSX, "capture successful: %s", filePath.c_str());
-
 			frame_capture.reset();
 			Emu.Pause();
 		}
@@ -2443,38 +2900,32 @@ namespace rsx
 		case frame_limit_type::_50: limit = 50.; break;
 		case frame_limit_type::_60: limit = 60.; break;
 		case frame_limit_type::_30: limit = 30.; break;
-		case frame_limit_type::_auto: limit = fps_limit; break; // TODO
+		case frame_limit_type::_auto:
+		{
+			// Match the host display, the rate the game selected is a fallback for windows without a known refresh rate
+			const f64 refresh_rate = get_display_refresh_rate();
+			limit = (refresh_rate >= 20. && refresh_rate <= 500.) ? refresh_rate : fps_limit;
+			break;
+		}
 		}
 
-		if (limit)
+		if (limit && (!benchmark_mode || benchmark_frame_limit))
 		{
-			const u64 time = get_system_time() - Emu.GetPauseTime() - start_rsx_time;
+			performance_counters.idle_time += m_frame_limiter.wait(limit);
+		}
 
-			if (int_flip_index == 0)
-			{
-				start_rsx_time = time;
-			}
-			else
-			{
-				// Convert limit to expected time value
-				double expected = int_flip_index * 1000000. / limit;
+		// Without a limit the game runs behind once it falls below the rate it asked for
+		m_target_frame_rate = limit ? limit : fps_limit;
 
-				while (time >= expected + 1000000. / limit)
-				{
-					expected = int_flip_index++ * 1000000. / limit;
-				}
+		int_flip_index++;
+		current_display_buffer = buffer;
 
-				if (expected > time + 1000)
-				{
-					const auto delay_us = static_cast<s64>(expected - time);
-					std::this_thread::sleep_for(std::chrono::milliseconds{ delay_us / 1000 });
-					performance_counters.idle_time += delay_us;
-				}
-			}
+		if (g_cfg.video.write_tracking)
+		{
+			handle_written_memory();
 		}
 
-		int_flip_index++;
-		current_display_buffer = buffer;
+		rsx::memory_protect_flush();
 		flip(buffer, true);
 
 		last_flip_time = get_system_time() - 1000000;
@@ -2798,7 +3249,7 @@ namespace rsx
 			m_tsc = std::max(m_tsc, get_system_time());
 		}
 
-		void ZCULL_control::update(::rsx::thread* ptimer, u32 sync_address)
+		void ZCULL_control::update(::rsx::thread* ptimer, u32 sync_address, bool hint)
 		{
 			if (m_pending_writes.empty())
 			{
@@ -2815,7 +3266,7 @@ namespace rsx
 			// Update timestamp and proceed with processing only if there is work to be done
 			m_tsc = std::max(m_tsc, get_system_time());
 
-			if (!sync_address)
+			if (!sync_address && !hint)
 			{
 				if (m_tsc < front.due_tsc)
 				{
@@ -2855,7 +3306,7 @@ namespace rsx
 					verify(HERE), query->pending;
 
 					const bool implemented = (writer.type == CELL_GCM_ZPASS_PIXEL_CNT || writer.type == CELL_GCM_ZCULL_STATS3);
-					if (force_read || writer.due_tsc < m_tsc)
+					if (force_read || (!hint && writer.due_tsc < m_tsc))
 					{
 						if (implemented && !result && query->num_draws)
 						{
@@ -2960,5 +3411,21 @@ namespace rsx
 				update(ptimer, sync_address);
 			}
 		}
+
+		bool ZCULL_control::has_pending_write(u32 memory_address, u32 memory_range) const
+		{
+			const auto memory_end = memory_address + memory_range;
+
+			for (const auto& writer : m_pending_writes)
+			{
+				if (!writer.sink)
+					break;
+
+				if (writer.sink >= memory_address && writer.sink < memory_end)
+					return true;
+			}
+
+			return false;
+		}
 	}
 }
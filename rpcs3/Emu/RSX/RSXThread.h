@@ -14,6 +14,7 @@
 #include "RSXFragmentProgram.h"
 #include "rsx_methods.h"
 #include "rsx_utils.h"
+#include "Common/gpu_profiler.h"
 #include "Overlays/overlays.h"
 
 #include "Utilities/Thread.h"
@@ -25,11 +26,32 @@
 
 extern u64 get_system_time();
 
+// IO address translation in 1MB pages (0xFFFF if unmapped), shared by sys_rsx, cellGcmSys and the RSX thread
 struct RSXIOTable
 {
 	atomic_t<u16> ea[4096];
 	atomic_t<u16> io[3072];
 
+	// Map 1MB pages (arguments are page numbers)
+	void map(u32 ea_page, u32 io_page, u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			this->io[ea_page + i].release(io_page + i);
+			this->ea[io_page + i].release(ea_page + i);
+		}
+	}
+
+	// Unmap 1MB pages starting at the IO page
+	void unmap(u32 io_page, u32 count)
+	{
+		for (u32 ea_page = this->ea[io_page], end = io_page + count; io_page < end;)
+		{
+			this->io[ea_page++].release(0xFFFF);
+			this->ea[io_page++].release(0xFFFF);
+		}
+	}
+
 	// try to get the real address given a mapped address
 	// return non zero on success
 	inline u32 RealAddr(u32 offs)
@@ -108,6 +130,8 @@ namespace rsx
 
 		scissor_setup_invalid = 0x400,       // Scissor configuration is broken
 
+		vertex_arrays_dirty = 0x800,         // Vertex array layout changed (formats, offsets, input mask, register attributes)
+
 		invalidate_pipeline_bits = fragment_program_dirty | vertex_program_dirty,
 		memory_barrier_bits = framebuffer_reads_dirty,
 		all_dirty = ~0u
@@ -129,7 +153,32 @@ namespace rsx
 
 	u32 get_vertex_type_size_on_host(vertex_base_type type, u32 size);
 
-	u32 get_address(u32 offset, u32 location);
+	// Address translation for locations other than local and mapped main memory (throws on invalid access)
+	u32 get_address_slow(u32 offset, u32 location);
+
+	inline u32 get_address(u32 offset, u32 location)
+	{
+		switch (location)
+		{
+		case CELL_GCM_CONTEXT_DMA_MEMORY_FRAME_BUFFER:
+		case CELL_GCM_LOCATION_LOCAL:
+		{
+			return 0xC0000000 + offset;
+		}
+		case CELL_GCM_CONTEXT_DMA_MEMORY_HOST_BUFFER:
+		case CELL_GCM_LOCATION_MAIN:
+		{
+			if (const u32 result = RSXIOMem.RealAddr(offset))
+			{
+				return result;
+			}
+
+			break;
+		}
+		}
+
+		return get_address_slow(offset, location);
+	}
 
 	struct tiled_region
 	{
@@ -245,6 +294,19 @@ namespace rsx
 			verify(HERE), _max_index >= _min_index;
 			return { _min_index, (_max_index - _min_index) + 1 };
 		}
+
+		// Identifies the stride and attribute fetch setup of the block (for caches keyed on the memory address)
+		u64 layout_signature() const
+		{
+			u64 result = attribute_stride;
+
+			for (const auto &attrib : locations)
+			{
+				result = (result * 0x100000001b3ull) ^ (attrib.index | (u64{attrib.modulo} << 8) | (u64{attrib.frequency} << 16));
+			}
+
+			return result;
+		}
 	};
 
 	enum attribute_buffer_placement : u8
@@ -418,7 +480,8 @@ namespace rsx
 			void read_barrier(class ::rsx::thread* ptimer, u32 memory_address, u32 memory_range);
 
 			// Call once every 'tick' to update, optional address provided to partially sync until address is processed
-			void update(class ::rsx::thread* ptimer, u32 sync_address = 0);
+			// With hint set, only reports whose results are already available are retired and the backend is never waited on
+			void update(class ::rsx::thread* ptimer, u32 sync_address = 0, bool hint = false);
 
 			// Draw call notification
 			void on_draw();
@@ -426,6 +489,9 @@ namespace rsx
 			// Check for pending writes
 			bool has_pending() const { return !m_pending_writes.empty(); }
 
+			// Check for a claimed write still queued for the given range
+			bool has_pending_write(u32 memory_address, u32 memory_range) const;
+
 			// Backend methods (optional, will return everything as always visible by default)
 			virtual void begin_occlusion_query(occlusion_query_info* /*query*/) {}
 			virtual void end_occlusion_query(occlusion_query_info* /*query*/) {}
@@ -437,6 +503,116 @@ namespace rsx
 
 	struct sampled_image_descriptor_base;
 
+	// Present-to-present interval statistics, fed by the backends after every present
+	struct frame_pacing_stats
+	{
+		u64 last_present_time = 0;
+		u64 interval_count = 0;
+		u64 max_interval = 0;
+		f64 mean_interval = 0.;
+		f64 m2 = 0.; // Running sum of squared deviations (Welford)
+
+		void on_present(u64 timestamp)
+		{
+			if (last_present_time)
+			{
+				const u64 interval = timestamp - last_present_time;
+				const f64 delta = interval - mean_interval;
+
+				interval_count++;
+				mean_interval += delta / interval_count;
+				m2 += delta * (interval - mean_interval);
+				max_interval = std::max(max_interval, interval);
+			}
+
+			last_present_time = timestamp;
+		}
+
+		f64 get_variance() const
+		{
+			return interval_count > 1 ? m2 / (interval_count - 1) : 0.;
+		}
+	};
+
+	// Sleeps until an absolute get_system_time() deadline without accumulating the host sleep granularity
+	class deadline_timer
+	{
+#ifdef _WIN32
+		void* m_timer = nullptr;
+#endif
+
+	public:
+		deadline_timer();
+		~deadline_timer();
+
+		deadline_timer(const deadline_timer&) = delete;
+		deadline_timer& operator=(const deadline_timer&) = delete;
+
+		void wait_until(u64 deadline);
+	};
+
+	// Paces flips to a fixed rate. Sleeps until a calibrated margin before the deadline, then yields for the rest,
+	// so the host timer granularity does not turn into uneven frame times. Pauses do not count towards the schedule.
+	class frame_limiter
+	{
+		static constexpr u64 min_margin = 200;
+		static constexpr u64 max_margin = 2000;
+
+		deadline_timer m_timer;
+		f64 m_rate = 0.;
+		u64 m_start_time = 0;
+		u64 m_frame_index = 0;
+		f64 m_oversleep = 500.; // Smoothed wakeup latency of the timer in microseconds
+
+		frame_pacing_stats m_stats;
+
+	public:
+		// Blocks until the next frame is due, returns the time spent waiting in microseconds
+		u64 wait(f64 rate);
+
+		const frame_pacing_stats& get_stats() const
+		{
+			return m_stats;
+		}
+
+		u64 get_margin() const
+		{
+			return std::clamp<u64>(static_cast<u64>(m_oversleep * 2.), min_margin, max_margin);
+		}
+	};
+
+	// Skips frames only while emulation falls behind the target frame rate. A drawn frame is behind when it took longer
+	// than the target period and kept the RSX thread or the GPU busy for most of it, the first drawn frame with headroom stops skipping.
+	// Skipped frames are not measured, their cost says nothing about the frames that are drawn.
+	class adaptive_frame_skip
+	{
+		static constexpr u32 busy_threshold = 90;     // Load in percent above which a slow frame counts as behind
+		static constexpr u32 headroom_threshold = 75; // Load in percent below which skipping stops
+
+		u64 m_last_flip_time = 0;
+		u64 m_last_idle_time = 0;
+		u32 m_consecutive_skipped = 0;
+		u32 m_consecutive_drawn = 0;
+		bool m_behind = false;
+
+		u64 m_total_frames = 0;
+		u64 m_skipped_frames = 0;
+
+	public:
+		// Called once per flip with the pause adjusted time and the accumulated RSX idle time, returns whether the next frame is skipped
+		bool update(u64 now, u64 idle_time, f64 target_rate, f32 gpu_time_ms, u32 max_skip, u32 min_draw);
+
+		u64 get_total_frames() const
+		{
+			return m_total_frames;
+		}
+
+		u64 get_skipped_frames() const
+		{
+			return m_skipped_frames;
+		}
+	};
+
 	class thread
 	{
 		u64 timestamp_ctrl = 0;
@@ -450,7 +626,18 @@ namespace rsx
 		std::vector<u32> element_push_buffer;
 
 		s32 m_skip_frame_ctr = 0;
-		bool skip_frame = false;
+		bool skip_frame = false;   // Draws of the current frame are dropped
+		bool skip_present = false; // The current frame is drawn but not presented
+		adaptive_frame_skip m_frame_skipper;
+		f64 m_target_frame_rate = 0.;
+
+		// Frames left to record in the running capture
+		u32 m_capture_frames_remaining = 0;
+
+		// Capture replay benchmark
+		u32 m_pipelines_compiled = 0;
+		shared_mutex m_benchmark_stats_mutex;
+		std::vector<frame_benchmark_stats> m_benchmark_stats;
 
 		bool supports_multidraw = false;
 		bool supports_native_ui = false;
@@ -477,6 +664,10 @@ namespace rsx
 		// Draw call stats
 		u32 m_draw_calls = 0;
 
+		// Frame pacing, summarized in the log on exit
+		frame_pacing_stats m_present_stats;
+		frame_limiter m_frame_limiter;
+
 	public:
 		RsxDmaControl* ctrl = nullptr;
 		u32 restore_point = 0;
@@ -486,8 +677,9 @@ namespace rsx
 		// Performance approximation counters
 		struct
 		{
-			atomic_t<u64> idle_time{ 0 };  // Time spent idling in microseconds
+			atomic_t<u64> idle_time{ 0 };  // Total time spent idling in microseconds
 			u64 last_update_timestamp = 0; // Timestamp of last load update
+			u64 last_update_idle_time = 0; // Idle time at the last load update
 			u64 FIFO_idle_timestamp = 0;   // Timestamp of when FIFO queue becomes idle
 			FIFO_state state = FIFO_state::running;
 			u32 approximate_load = 0;
@@ -541,9 +733,24 @@ namespace rsx
 		u32  m_graphics_state = 0;
 		u64  ROP_sync_timestamp = 0;
 
+		// Vertex data base offset used for the last analysed vertex layout
+		u32  m_vertex_layout_base_offset = 0;
+
 		program_hash_util::fragment_program_utils::fragment_program_metadata current_fp_metadata = {};
 		program_hash_util::vertex_program_utils::vertex_program_metadata current_vp_metadata = {};
 
+	private:
+		// Vertex program analysis results per transform program entry point, valid for the epoch they were made in
+		struct vertex_program_analysis
+		{
+			u32 epoch;
+			program_hash_util::vertex_program_utils::vertex_program_metadata metadata;
+			RSXVertexProgram program;
+		};
+
+		std::unordered_map<u32, vertex_program_analysis> m_vertex_program_analysis;
+		rsx::fragment_program_analysis_cache m_fragment_program_analysis;
+
 	protected:
 		std::array<u32, 4> get_color_surface_addresses() const;
 		u32 get_zeta_surface_address() const;
@@ -552,8 +759,9 @@ namespace rsx
 
 		/**
 		 * Analyze vertex inputs and group all interleaved blocks
+		 * The result is kept as is if no vertex array state changed since the previous call
 		 */
-		void analyse_inputs_interleaved(vertex_input_layout&) const;
+		void analyse_inputs_interleaved(vertex_input_layout&);
 
 		RSXVertexProgram current_vertex_program = {};
 		RSXFragmentProgram current_fragment_program = {};
@@ -572,7 +780,6 @@ namespace rsx
 		double fps_limit = 59.94;
 
 	public:
-		u64 start_rsx_time = 0;
 		u64 int_flip_index = 0;
 		u64 last_flip_time;
 		vm::ptr<void(u32)> flip_handler = vm::null;
@@ -697,6 +904,7 @@ namespace rsx
 		void do_internal_task();
 		void handle_emu_flip(u32 buffer);
 		void handle_invalidated_memory_range();
+		void handle_written_memory();
 
 	public:
 		//std::future<void> add_internal_task(std::function<bool()> callback);
@@ -794,5 +1002,27 @@ namespace rsx
 
 		//Get RSX approximate load in %
 		u32 get_load();
+
+		// Host video memory usage and budget in bytes, zero if the backend does not track it
+		virtual std::pair<u64, u64> get_video_memory_usage() const { return {}; }
+
+		// GPU time per category of the last profiled frame, false if the GPU profiler is not running
+		virtual bool get_gpu_frame_timings(gpu_frame_timings& /*timings*/) const { return false; }
+
+		// Refresh rate of the display showing the output in Hz, zero if unknown
+		virtual f64 get_display_refresh_rate() const { return 0.; }
+
+		// Texture cache counters of the frame being flipped
+		virtual void get_texture_cache_statistics(frame_benchmark_stats& /*stats*/) const {}
+
+		// Moves the counters of every emulated flip since the last call into stats, only recorded in benchmark mode
+		void take_frame_benchmark_stats(std::vector<frame_benchmark_stats>& stats);
+
+		// Set by the capture replay benchmark, frames are never throttled and optionally never presented
+		bool benchmark_mode = false;
+		bool benchmark_null_present = false;
+
+		// Set by the title benchmark, which records statistics of a game running at its normal pace
+		bool benchmark_frame_limit = false;
 	};
 }
@@ -241,6 +241,9 @@ struct RSXVertexProgram
 	std::bitset<512> instruction_mask;
 	std::set<u32> jump_table;
 
+	// Ucode hash computed with the analysis, 0 if it has to be computed on lookup
+	u64 ucode_hash = 0;
+
 	rsx::texture_dimension_extended get_texture_dimension(u8 id) const
 	{
 		return (rsx::texture_dimension_extended)((texture_dimensions >> (id * 2)) & 0x3);
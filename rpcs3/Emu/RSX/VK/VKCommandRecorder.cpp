@@ -0,0 +1,295 @@
+#include "stdafx.h"
+#include "VKCommandRecorder.h"
+
+namespace vk
+{
+	void draw_state::apply(VkCommandBuffer cmd) const
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		vkCmdSetLineWidth(cmd, line_width);
+		vkCmdSetDepthBias(cmd, depth_bias_constant, 0.f, depth_bias_slope);
+		vkCmdSetDepthBounds(cmd, depth_bounds_min, depth_bounds_max);
+
+		if (blend_enabled)
+		{
+			vkCmdSetBlendConstants(cmd, blend_constants.data());
+		}
+
+		if (stencil_enabled)
+		{
+			const VkStencilFaceFlags face_flag = two_sided_stencil ? VK_STENCIL_FACE_FRONT_BIT : VK_STENCIL_FRONT_AND_BACK;
+
+			vkCmdSetStencilWriteMask(cmd, face_flag, stencil_write_mask[0]);
+			vkCmdSetStencilCompareMask(cmd, face_flag, stencil_compare_mask[0]);
+			vkCmdSetStencilReference(cmd, face_flag, stencil_reference[0]);
+
+			if (two_sided_stencil)
+			{
+				vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FACE_BACK_BIT, stencil_write_mask[1]);
+				vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FACE_BACK_BIT, stencil_compare_mask[1]);
+				vkCmdSetStencilReference(cmd, VK_STENCIL_FACE_BACK_BIT, stencil_reference[1]);
+			}
+		}
+
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+	}
+
+	void draw_packet::record(VkCommandBuffer cmd, VkPipelineLayout pipeline_layout) const
+	{
+		if (descriptor_set)
+		{
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+		}
+
+		if (index_buffer == VK_NULL_HANDLE)
+		{
+			if (indirect_count)
+			{
+				vkCmdDrawIndirect(cmd, indirect_buffer, indirect_offset, indirect_count, sizeof(VkDrawIndirectCommand));
+			}
+			else if (ranges.empty())
+			{
+				vkCmdDraw(cmd, draw_count, 1, 0, 0);
+			}
+			else
+			{
+				for (const auto &range : ranges)
+				{
+					vkCmdDraw(cmd, range.count, 1, range.first, 0);
+				}
+			}
+		}
+		else
+		{
+			vkCmdBindIndexBuffer(cmd, index_buffer, index_offset, index_type);
+
+			if (indirect_count)
+			{
+				vkCmdDrawIndexedIndirect(cmd, indirect_buffer, indirect_offset, indirect_count, sizeof(VkDrawIndexedIndirectCommand));
+			}
+			else if (ranges.empty())
+			{
+				vkCmdDrawIndexed(cmd, draw_count, 1, 0, 0, 0);
+			}
+			else
+			{
+				for (const auto &range : ranges)
+				{
+					vkCmdDrawIndexed(cmd, range.count, 1, range.first, 0, 0);
+				}
+			}
+		}
+	}
+
+	VkCommandBuffer command_recorder::thread_context::get_command_buffer(u32 cb_index)
+	{
+		auto& list = buffers[cb_index];
+
+		if (used[cb_index] == list.size())
+		{
+			VkCommandBufferAllocateInfo infos = {};
+			infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			infos.commandBufferCount = 1;
+			infos.commandPool = pool;
+			infos.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+			VkCommandBuffer cmd;
+			CHECK_RESULT(vkAllocateCommandBuffers(pool.get_owner(), &infos, &cmd));
+			list.push_back(cmd);
+		}
+
+		return list[used[cb_index]++];
+	}
+
+	void command_recorder::worker::operator()()
+	{
+		while (thread_ctrl::state() != thread_state::aborting)
+		{
+			while (const auto job = recorder->claim())
+			{
+				recorder->record(*job, *context);
+			}
+
+			thread_ctrl::wait();
+		}
+	}
+
+	command_recorder::command_recorder(vk::render_device& dev, u32 thread_count, u32 primary_cb_count)
+	{
+		for (u32 i = 0; i <= thread_count; i++)
+		{
+			auto context = std::make_unique<thread_context>();
+			context->pool.create(dev);
+			context->buffers.resize(primary_cb_count);
+			context->used.resize(primary_cb_count, 0);
+			m_contexts.push_back(std::move(context));
+		}
+
+		for (u32 i = 0; i < thread_count; i++)
+		{
+			m_workers.emplace_back(std::make_unique<named_thread<worker>>(fmt::format("VK Command Recorder %u", i), worker{ this, m_contexts[i + 1].get() }));
+		}
+
+		m_pending.reserve(batch_size);
+	}
+
+	command_recorder::~command_recorder()
+	{
+		// Join the workers before their pools go away, the secondaries are freed with the pools
+		m_workers.clear();
+
+		for (auto& context : m_contexts)
+		{
+			context->pool.destroy();
+		}
+	}
+
+	command_recorder::batch* command_recorder::claim()
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (m_claimed == m_published)
+		{
+			return nullptr;
+		}
+
+		return &m_batches[m_claimed++];
+	}
+
+	void command_recorder::record(batch& job, thread_context& context)
+	{
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance_info.renderPass = m_render_pass;
+		inheritance_info.subpass = 0;
+		inheritance_info.framebuffer = m_framebuffer;
+
+		VkCommandBufferBeginInfo begin_infos = {};
+		begin_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_infos.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		begin_infos.pInheritanceInfo = &inheritance_info;
+
+		const VkCommandBuffer cmd = context.get_command_buffer(m_cb_index);
+		CHECK_RESULT(vkBeginCommandBuffer(cmd, &begin_infos));
+
+		m_state.apply(cmd);
+
+		for (const auto& packet : job.packets)
+		{
+			packet.record(cmd, m_state.pipeline_layout);
+		}
+
+		CHECK_RESULT(vkEndCommandBuffer(cmd));
+
+		job.commands = cmd;
+		job.done = true;
+	}
+
+	void command_recorder::publish()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+
+			auto& job = m_batches[m_published];
+			job.packets.swap(m_pending);
+			job.commands = VK_NULL_HANDLE;
+			job.done = false;
+
+			m_published++;
+		}
+
+		m_pending.clear();
+
+		if (!m_workers.empty())
+		{
+			// A woken worker keeps claiming until the queue is empty, one is enough per batch
+			thread_ctrl::notify(*m_workers[m_next_worker]);
+			m_next_worker = (m_next_worker + 1) % ::size32(m_workers);
+		}
+	}
+
+	void command_recorder::execute_pending()
+	{
+		if (!m_pending.empty())
+		{
+			publish();
+		}
+
+		// Record whatever the workers have not picked up yet
+		while (const auto job = claim())
+		{
+			record(*job, *m_contexts[0]);
+		}
+
+		std::array<VkCommandBuffer, max_batches> commands;
+		for (u32 i = 0; i < m_published; ++i)
+		{
+			while (!m_batches[i].done)
+			{
+				busy_wait(500);
+			}
+
+			commands[i] = m_batches[i].commands;
+		}
+
+		if (m_published)
+		{
+			vkCmdExecuteCommands(m_primary, m_published, commands.data());
+		}
+
+		std::lock_guard lock(m_mutex);
+		m_published = 0;
+		m_claimed = 0;
+	}
+
+	void command_recorder::begin(const draw_state& state, VkCommandBuffer primary, VkRenderPass render_pass, VkFramebuffer framebuffer, u32 cb_index)
+	{
+		verify(HERE), !m_recording, m_published == 0;
+
+		// Workers only read these after claiming a batch, which synchronizes with publish()
+		m_state = state;
+		m_render_pass = render_pass;
+		m_framebuffer = framebuffer;
+		m_primary = primary;
+		m_cb_index = cb_index;
+		m_recording = true;
+	}
+
+	void command_recorder::push(draw_packet&& packet)
+	{
+		m_pending.push_back(std::move(packet));
+
+		if (m_pending.size() < batch_size)
+		{
+			return;
+		}
+
+		publish();
+
+		if (m_published == max_batches)
+		{
+			// Out of batch slots, the render pass can execute any number of secondaries so flush the ones in flight
+			execute_pending();
+		}
+	}
+
+	void command_recorder::end()
+	{
+		verify(HERE), m_recording;
+
+		execute_pending();
+		m_recording = false;
+	}
+
+	void command_recorder::recycle(u32 cb_index)
+	{
+		verify(HERE), !m_recording;
+
+		for (auto& context : m_contexts)
+		{
+			context->used[cb_index] = 0;
+		}
+	}
+}
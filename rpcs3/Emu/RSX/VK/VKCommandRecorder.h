@@ -0,0 +1,158 @@
+#pragma once
+#include "VKHelpers.h"
+#include "Utilities/Thread.h"
+
+namespace vk
+{
+	/**
+	 * Pipeline and dynamic state shared by all the draws of a clause.
+	 * Secondary command buffers inherit nothing from the primary, each one replays this before its first draw.
+	 */
+	struct draw_state
+	{
+		VkPipeline pipeline;
+		VkPipelineLayout pipeline_layout;
+
+		VkViewport viewport;
+		VkRect2D scissor;
+
+		f32 line_width;
+		f32 depth_bias_constant;
+		f32 depth_bias_slope;
+		f32 depth_bounds_min;
+		f32 depth_bounds_max;
+
+		bool blend_enabled;
+		std::array<f32, 4> blend_constants;
+
+		// Index 0 is used for both faces unless two sided stencil is enabled
+		bool stencil_enabled;
+		bool two_sided_stencil;
+		u32 stencil_write_mask[2];
+		u32 stencil_compare_mask[2];
+		u32 stencil_reference[2];
+
+		void apply(VkCommandBuffer cmd) const;
+	};
+
+	/**
+	 * Commands of one emit_geometry pass. Buffers and descriptor sets are allocated and written on the RSX thread,
+	 * the packet only references them so it can be recorded on any thread.
+	 */
+	struct draw_packet
+	{
+		struct draw_range
+		{
+			u32 count;
+			u32 first;
+		};
+
+		// VK_NULL_HANDLE if the descriptors were pushed
+		VkDescriptorSet descriptor_set;
+
+		// Index buffer, VK_NULL_HANDLE for non-indexed draws
+		VkBuffer index_buffer = VK_NULL_HANDLE;
+		VkDeviceSize index_offset = 0;
+		VkIndexType index_type = VK_INDEX_TYPE_UINT16;
+
+		// Indirect multi-draw when indirect_count is non-zero
+		VkBuffer indirect_buffer = VK_NULL_HANDLE;
+		VkDeviceSize indirect_offset = 0;
+		u32 indirect_count = 0;
+
+		// Otherwise a single draw of draw_count elements, or one draw per entry if ranges is not empty
+		u32 draw_count = 0;
+		std::vector<draw_range> ranges;
+
+		void record(VkCommandBuffer cmd, VkPipelineLayout pipeline_layout) const;
+	};
+
+	/**
+	 * Records draw packets into secondary command buffers on helper threads.
+	 * Packets are grouped in batches that are recorded in any order and executed into the primary in submission order.
+	 * Each thread (the RSX thread included) owns a command pool with a set of secondaries for every primary command buffer,
+	 * a set is only reused when recycle is called for its primary after the primary's fence has been waited on.
+	 */
+	class command_recorder
+	{
+	public:
+		// Clauses with fewer draws are cheaper to record inline
+		static constexpr u32 min_draw_count = 32;
+
+		// Draws per secondary command buffer
+		static constexpr u32 batch_size = 16;
+
+		// Batches in flight, they are executed early if more are needed
+		static constexpr u32 max_batches = 64;
+
+	private:
+		struct batch
+		{
+			std::vector<draw_packet> packets;
+			VkCommandBuffer commands = VK_NULL_HANDLE;
+			atomic_t<bool> done{ false };
+		};
+
+		struct thread_context
+		{
+			vk::command_pool pool;
+			std::vector<std::vector<VkCommandBuffer>> buffers;
+			std::vector<u32> used;
+
+			VkCommandBuffer get_command_buffer(u32 cb_index);
+		};
+
+		struct worker
+		{
+			command_recorder* recorder;
+			thread_context* context;
+
+			void operator()();
+		};
+
+		// Guards batch claims and publication
+		shared_mutex m_mutex;
+		u32 m_published = 0;
+		u32 m_claimed = 0;
+
+		std::array<batch, max_batches> m_batches;
+		std::vector<draw_packet> m_pending;
+		bool m_recording = false;
+
+		// Inheritance of the open render pass, read by the workers after claiming a batch
+		draw_state m_state;
+		VkRenderPass m_render_pass = VK_NULL_HANDLE;
+		VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+		VkCommandBuffer m_primary = VK_NULL_HANDLE;
+		u32 m_cb_index = 0;
+
+		// Slot 0 belongs to the RSX thread
+		std::vector<std::unique_ptr<thread_context>> m_contexts;
+		std::vector<std::unique_ptr<named_thread<worker>>> m_workers;
+		u32 m_next_worker = 0;
+
+		batch* claim();
+		void record(batch& job, thread_context& context);
+		void publish();
+		void execute_pending();
+
+	public:
+		command_recorder(vk::render_device& dev, u32 thread_count, u32 primary_cb_count);
+		~command_recorder();
+
+		bool is_recording() const
+		{
+			return m_recording;
+		}
+
+		// Starts collecting the draws of a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		void begin(const draw_state& state, VkCommandBuffer primary, VkRenderPass render_pass, VkFramebuffer framebuffer, u32 cb_index);
+		void push(draw_packet&& packet);
+
+		// Waits for all the batches and executes them into the primary, the render pass must still be open
+		void end();
+
+		// The primary at cb_index has completed, its secondaries can be recorded again
+		void recycle(u32 cb_index);
+	};
+}
@@ -1,5 +1,7 @@
 #include "stdafx.h"
+#include "Emu/System.h"
 #include "VKCommonDecompiler.h"
+#include "VKHelpers.h"
 #include "restore_new.h"
 #include "SPIRV/GlslangToSpv.h"
 #include "define_new_memleakdetect.h"
@@ -189,4 +191,37 @@ namespace vk
 	{
 		glslang::FinalizeProcess();
 	}
+
+	u64 get_decompiler_device_key()
+	{
+		const auto pdev = vk::get_current_renderer();
+		const bool native_half = !g_cfg.video.disable_native_float16 && pdev->get_shader_types_support().allow_float16;
+		const bool emulate_depth_compare = !pdev->get_formats_support().d24_unorm_s8;
+		const bool low_precision_tests = vk::get_driver_vendor() == vk::driver_vendor::NVIDIA;
+
+		return (native_half ? 1 : 0) | (emulate_depth_compare ? 2 : 0) | (low_precision_tests ? 4 : 0);
+	}
+
+	void export_program_bindings(const std::vector<glsl::program_input>& inputs, rsx::decompiled_program& program)
+	{
+		program.bindings.reserve(inputs.size());
+
+		for (const auto& in : inputs)
+		{
+			program.bindings.push_back({ u32(in.domain), u32(in.type), in.location, in.name });
+		}
+	}
+
+	void import_program_bindings(const rsx::decompiled_program& program, std::vector<glsl::program_input>& inputs)
+	{
+		for (const auto& binding : program.bindings)
+		{
+			glsl::program_input in;
+			in.domain = static_cast<::glsl::program_domain>(binding.domain);
+			in.type = static_cast<glsl::program_input_type>(binding.type);
+			in.location = binding.location;
+			in.name = binding.name;
+			inputs.push_back(in);
+		}
+	}
 }
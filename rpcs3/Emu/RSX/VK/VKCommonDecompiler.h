@@ -1,8 +1,14 @@
 #pragma once
 #include "../Common/GLSLTypes.h"
+#include "../Common/DecompiledProgramCache.h"
 
 namespace vk
 {
+	namespace glsl
+	{
+		struct program_input;
+	}
+
 	using namespace ::glsl;
 
 	int get_varying_register_location(std::string_view varying_register_name);
@@ -10,4 +16,9 @@ namespace vk
 
 	void initialize_compiler_context();
 	void finalize_compiler_context();
+
+	// Decompiled program cache helpers
+	u64 get_decompiler_device_key();
+	void export_program_bindings(const std::vector<glsl::program_input>& inputs, rsx::decompiled_program& program);
+	void import_program_bindings(const rsx::decompiled_program& program, std::vector<glsl::program_input>& inputs);
 }
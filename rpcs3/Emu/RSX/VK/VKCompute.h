@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "VKHelpers.h"
+#include "VKProfiler.h"
 #include "Utilities/StrUtil.h"
 
 #define VK_MAX_COMPUTE_TASKS 1024   // Max number of jobs per frame
@@ -158,7 +159,7 @@ namespace vk
 				info.basePipelineHandle = VK_NULL_HANDLE;
 
 				VkPipeline pipeline;
-				vkCreateComputePipelines(*get_current_renderer(), nullptr, 1, &info, nullptr, &pipeline);
+				vkCreateComputePipelines(*get_current_renderer(), get_pipeline_cache(), 1, &info, nullptr, &pipeline);
 
 				m_program = std::make_unique<vk::glsl::program>(*get_current_renderer(), pipeline);
 				declare_inputs();
@@ -183,6 +184,8 @@ namespace vk
 
 		virtual void run(VkCommandBuffer cmd, u32 invocations_x, u32 invocations_y)
 		{
+			vk::gpu_profiler_scope profiler_scope(cmd, rsx::gpu_timer_category::compute);
+
 			load_program(cmd);
 			vkCmdDispatch(cmd, invocations_x, invocations_y, 1);
 		}
@@ -531,6 +534,127 @@ namespace vk
 		}
 	};
 
+	// Decodes raw guest texel data into linear rows: Z-order deswizzle, pitch removal and endian swaps.
+	// Source and destination live in the same buffer, each invocation produces one 32-bit word of output
+	struct cs_texture_decode : cs_shuffle_base
+	{
+		enum decode_flags : u32
+		{
+			swizzled = 1,
+			texel_16bit = 2,
+			swap_16bit_words = 4,
+			swap_32bit_words = 8
+		};
+
+		u32 m_ssbo_length = 0;
+
+		cs_texture_decode()
+		{
+			uniform_inputs = true;
+
+			variables =
+			{
+				"	uint word_count = params[0].x;\n"
+				"	uint dst_offset = params[0].z >> 2;\n"
+				"	uint row_pitch = params[0].w >> 2;\n"
+				"	uint width = params[1].x;\n"
+				"	uint height = params[1].y;\n"
+				"	uint log2_w = params[1].z;\n"
+				"	uint log2_h = params[1].w;\n"
+				"	uint log2_d = params[2].x;\n"
+				"	uint src_pitch = params[2].y;\n"
+				"	uint words_per_row = params[2].z;\n"
+				"	uint decode_flags = params[2].w;\n"
+				"	uint texels_per_word = ((decode_flags & 2) != 0)? 2 : 1;\n"
+				"	uint x, y, z, row, texel, n, shift, bit, src_index, src_word, result;\n"
+			};
+
+			work_kernel =
+			{
+				"		if (index >= word_count)\n"
+				"			return;\n"
+				"\n"
+				"		x = index % words_per_row;\n"
+				"		row = index / words_per_row;\n"
+				"		y = row % height;\n"
+				"		z = row / height;\n"
+				"		result = 0;\n"
+				"\n"
+				"		for (n = 0; n < texels_per_word; ++n)\n"
+				"		{\n"
+				"			texel = (x * texels_per_word) + n;\n"
+				"			if (texel >= width)\n"
+				"				break;\n"
+				"\n"
+				"			if ((decode_flags & 1) != 0)\n"
+				"			{\n"
+				"				src_index = 0;\n"
+				"				shift = 0;\n"
+				"\n"
+				"				for (bit = 0; bit < 16; ++bit)\n"
+				"				{\n"
+				"					if (bit < log2_w) { src_index |= ((texel >> bit) & 1) << shift; shift++; }\n"
+				"					if (bit < log2_h) { src_index |= ((y >> bit) & 1) << shift; shift++; }\n"
+				"					if (bit < log2_d) { src_index |= ((z >> bit) & 1) << shift; shift++; }\n"
+				"				}\n"
+				"			}\n"
+				"			else\n"
+				"			{\n"
+				"				src_index = (row * src_pitch) + texel;\n"
+				"			}\n"
+				"\n"
+				"			if (texels_per_word == 2)\n"
+				"			{\n"
+				"				src_word = data[src_index >> 1];\n"
+				"				src_word = ((src_index & 1) != 0)? (src_word >> 16) : (src_word & 0xFFFF);\n"
+				"				result |= src_word << (n * 16);\n"
+				"			}\n"
+				"			else\n"
+				"			{\n"
+				"				result = data[src_index];\n"
+				"			}\n"
+				"		}\n"
+				"\n"
+				"		if ((decode_flags & 4) != 0)\n"
+				"			result = bswap_u16(result);\n"
+				"		else if ((decode_flags & 8) != 0)\n"
+				"			result = bswap_u32(result);\n"
+				"\n"
+				"		data[dst_offset + (row * row_pitch) + x] = result;\n"
+			};
+
+			cs_shuffle_base::build("");
+		}
+
+		void bind_resources() override
+		{
+			m_program->bind_buffer({ m_data->value, m_data_offset, m_ssbo_length }, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_descriptor_set);
+
+			if (uniform_inputs)
+			{
+				verify(HERE), m_param_buffer;
+				m_program->bind_buffer({ m_param_buffer->value, 0, 256 }, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_descriptor_set);
+			}
+		}
+
+		// The source starts at data_offset, dst_offset is in bytes relative to it and is expected to follow the source.
+		// src_pitch is in texels and only used for linear sources
+		void run(VkCommandBuffer cmd, const vk::buffer* data, u32 data_offset, u32 dst_offset, u32 row_pitch,
+			u16 width, u16 height, u16 depth, u32 src_pitch, u32 flags)
+		{
+			const u32 texel_size = (flags & texel_16bit) ? 2 : 4;
+			const u32 words_per_row = ((width * texel_size) + 3) / 4;
+			const u32 word_count = words_per_row * height * depth;
+
+			u32 parameters[12] = { word_count, 0, dst_offset, row_pitch, width, height, rsx::ceil_log2(width), rsx::ceil_log2(height),
+				rsx::ceil_log2(depth), src_pitch, words_per_row, flags };
+			set_parameters(cmd, parameters, 12);
+
+			m_ssbo_length = dst_offset + (row_pitch * height * depth);
+			cs_shuffle_base::run(cmd, data, word_count * 4, data_offset);
+		}
+	};
+
 	// TODO: Replace with a proper manager
 	extern std::unordered_map<u32, std::unique_ptr<vk::compute_task>> g_compute_tasks;
 
@@ -0,0 +1,116 @@
+#include "stdafx.h"
+#include "VKDescriptors.h"
+
+namespace vk
+{
+	VkDescriptorType descriptor_writer::get_binding_type(u32 binding)
+	{
+		if (binding < VERTEX_BUFFERS_FIRST_BIND_SLOT)
+		{
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		}
+
+		if (binding < TEXTURES_FIRST_BIND_SLOT)
+		{
+			return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+		}
+
+		return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	}
+
+	void descriptor_writer::create(const vk::render_device& dev, VkDescriptorSetLayout set_layout, VkPipelineLayout pipeline_layout, bool push_descriptors)
+	{
+		m_device = dev;
+		m_pipeline_layout = pipeline_layout;
+		m_push_descriptors = push_descriptors;
+
+		if (!dev.get_descriptor_update_template_support())
+		{
+			verify(HERE), !push_descriptors;
+			return;
+		}
+
+		createDescriptorUpdateTemplateKHR = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_device, "vkCreateDescriptorUpdateTemplateKHR");
+		destroyDescriptorUpdateTemplateKHR = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_device, "vkDestroyDescriptorUpdateTemplateKHR");
+		updateDescriptorSetWithTemplateKHR = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(m_device, "vkUpdateDescriptorSetWithTemplateKHR");
+		verify("vkGetDeviceProcAddr failed to find entry point!" HERE), createDescriptorUpdateTemplateKHR, destroyDescriptorUpdateTemplateKHR, updateDescriptorSetWithTemplateKHR;
+
+		if (push_descriptors)
+		{
+			cmdPushDescriptorSetWithTemplateKHR = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(m_device, "vkCmdPushDescriptorSetWithTemplateKHR");
+			verify("vkGetDeviceProcAddr failed to find entry point!" HERE), cmdPushDescriptorSetWithTemplateKHR;
+		}
+
+		std::array<VkDescriptorUpdateTemplateEntryKHR, VK_NUM_DESCRIPTOR_BINDINGS> entries;
+		for (u32 n = 0; n < VK_NUM_DESCRIPTOR_BINDINGS; ++n)
+		{
+			entries[n].dstBinding = n;
+			entries[n].dstArrayElement = 0;
+			entries[n].descriptorCount = 1;
+			entries[n].descriptorType = get_binding_type(n);
+			entries[n].offset = n * sizeof(descriptor_bindings::entry);
+			entries[n].stride = sizeof(descriptor_bindings::entry);
+		}
+
+		VkDescriptorUpdateTemplateCreateInfoKHR info = {};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+		info.descriptorUpdateEntryCount = VK_NUM_DESCRIPTOR_BINDINGS;
+		info.pDescriptorUpdateEntries = entries.data();
+		info.templateType = push_descriptors ? VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR : VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+		info.descriptorSetLayout = set_layout;
+		info.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		info.pipelineLayout = pipeline_layout;
+		info.set = 0;
+
+		CHECK_RESULT(createDescriptorUpdateTemplateKHR(m_device, &info, nullptr, &m_template));
+	}
+
+	void descriptor_writer::destroy()
+	{
+		if (m_template)
+		{
+			destroyDescriptorUpdateTemplateKHR(m_device, m_template, nullptr);
+			m_template = VK_NULL_HANDLE;
+		}
+	}
+
+	void descriptor_writer::update(VkDescriptorSet set, const descriptor_bindings& bindings) const
+	{
+		verify(HERE), !m_push_descriptors;
+
+		if (m_template)
+		{
+			updateDescriptorSetWithTemplateKHR(m_device, set, m_template, bindings.entries.data());
+			return;
+		}
+
+		std::array<VkWriteDescriptorSet, VK_NUM_DESCRIPTOR_BINDINGS> writes;
+		for (u32 n = 0; n < VK_NUM_DESCRIPTOR_BINDINGS; ++n)
+		{
+			const auto type = get_binding_type(n);
+			const auto data = &bindings.entries[n];
+
+			writes[n] =
+			{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,   // sType
+				nullptr,                                  // pNext
+				set,                                      // dstSet
+				n,                                        // dstBinding
+				0,                                        // dstArrayElement
+				1,                                        // descriptorCount
+				type,                                     // descriptorType
+				type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ? reinterpret_cast<const VkDescriptorImageInfo*>(data) : nullptr,   // pImageInfo
+				type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? reinterpret_cast<const VkDescriptorBufferInfo*>(data) : nullptr,          // pBufferInfo
+				type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER ? reinterpret_cast<const VkBufferView*>(data) : nullptr              // pTexelBufferView
+			};
+		}
+
+		vkUpdateDescriptorSets(m_device, VK_NUM_DESCRIPTOR_BINDINGS, writes.data(), 0, nullptr);
+	}
+
+	void descriptor_writer::push(VkCommandBuffer cmd, const descriptor_bindings& bindings) const
+	{
+		verify(HERE), m_push_descriptors;
+		cmdPushDescriptorSetWithTemplateKHR(cmd, m_template, m_pipeline_layout, 0, bindings.entries.data());
+	}
+}
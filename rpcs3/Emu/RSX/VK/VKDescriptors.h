@@ -0,0 +1,39 @@
+#pragma once
+#include "VKHelpers.h"
+
+namespace vk
+{
+	/**
+	 * Writes a descriptor_bindings block to the shared pipeline layout in a single call.
+	 * Uses a descriptor update template when VK_KHR_descriptor_update_template is available and builds the writes by hand otherwise.
+	 * In push mode the set layout must have been created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+	 * the block is then pushed into the command buffer and no descriptor set is ever allocated.
+	 */
+	class descriptor_writer
+	{
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipeline_layout = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplateKHR m_template = VK_NULL_HANDLE;
+		bool m_push_descriptors = false;
+
+		PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplateKHR = nullptr;
+		PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplateKHR = nullptr;
+		PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplateKHR = nullptr;
+		PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplateKHR = nullptr;
+
+	public:
+		// Binding types of the shared pipeline layout, indexed by binding slot
+		static VkDescriptorType get_binding_type(u32 binding);
+
+		void create(const vk::render_device& dev, VkDescriptorSetLayout set_layout, VkPipelineLayout pipeline_layout, bool push_descriptors);
+		void destroy();
+
+		bool use_push_descriptors() const
+		{
+			return m_push_descriptors;
+		}
+
+		void update(VkDescriptorSet set, const descriptor_bindings& bindings) const;
+		void push(VkCommandBuffer cmd, const descriptor_bindings& bindings) const;
+	};
+}
@@ -418,6 +418,19 @@ VKFragmentProgram::~VKFragmentProgram()
 
 void VKFragmentProgram::Decompile(const RSXFragmentProgram& prog)
 {
+	auto& cache = rsx::get_decompiled_program_cache();
+	const u64 key = rsx::decompiled_program_cache::get_key(prog, vk::get_decompiler_device_key());
+
+	rsx::decompiled_program cached;
+	if (cache.find(key, cached))
+	{
+		vk::import_program_bindings(cached, uniforms);
+		FragmentConstantOffsetCache.assign(cached.constant_offsets.begin(), cached.constant_offsets.end());
+		output_color_masks = cached.output_color_masks;
+		shader.create(::glsl::program_domain::glsl_fragment_program, cached.source);
+		return;
+	}
+
 	u32 size;
 	std::string source;
 	VKFragmentDecompilerThread decompiler(source, parr, prog, size, *this);
@@ -447,6 +460,12 @@ void VKFragmentProgram::Decompile(const RSXFragmentProgram& prog)
 			FragmentConstantOffsetCache.push_back(offset);
 		}
 	}
+
+	cached.source = std::move(source);
+	vk::export_program_bindings(uniforms, cached);
+	cached.constant_offsets.assign(FragmentConstantOffsetCache.begin(), FragmentConstantOffsetCache.end());
+	cached.output_color_masks = output_color_masks;
+	cache.store(key, cached);
 }
 
 void VKFragmentProgram::Compile()
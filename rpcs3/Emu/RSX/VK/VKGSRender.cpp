@@ -272,7 +272,7 @@ namespace vk
 
 namespace
 {
-	std::tuple<VkPipelineLayout, VkDescriptorSetLayout> get_shared_pipeline_layout(VkDevice dev)
+	std::tuple<VkPipelineLayout, VkDescriptorSetLayout> get_shared_pipeline_layout(VkDevice dev, bool push_descriptors)
 	{
 		std::array<VkDescriptorSetLayoutBinding, VK_NUM_DESCRIPTOR_BINDINGS> bindings = {};
 
@@ -352,6 +352,7 @@ namespace
 
 		VkDescriptorSetLayoutCreateInfo infos = {};
 		infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		infos.flags = push_descriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
 		infos.pBindings = bindings.data();
 		infos.bindingCount = static_cast<uint32_t>(bindings.size());
 
@@ -444,6 +445,9 @@ VKGSRender::VKGSRender() : GSRender()
 	vk::set_current_thread_ctx(m_thread_context);
 	vk::set_current_renderer(m_swapchain->get_device());
 
+	// Kept next to the shaders cache so driver-compiled pipelines survive across runs as well
+	vk::create_pipeline_cache(*m_device, g_cfg.video.disable_on_disk_shader_cache ? "" : Emu.PPUCache() + "shaders_cache/vulkan-pipelines.bin");
+
 	m_swapchain_dims.width = m_frame->client_width();
 	m_swapchain_dims.height = m_frame->client_height();
 
@@ -468,14 +472,74 @@ VKGSRender::VKGSRender() : GSRender()
 	m_secondary_command_buffer.create(m_secondary_command_buffer_pool, true);
 	m_secondary_command_buffer.access_hint = vk::command_buffer::access_type_hint::all;
 
+	if (const u32 transfer_queue_family = m_device->get_transfer_queue_family(); transfer_queue_family != UINT32_MAX)
+	{
+		VkSemaphoreCreateInfo semaphore_info = {};
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		m_transfer_command_buffer_pool.create((*m_device), transfer_queue_family);
+		m_transfer_command_buffer.create(m_transfer_command_buffer_pool, true);
+		CHECK_RESULT(vkCreateSemaphore((*m_device), &semaphore_info, nullptr, &m_transfer_semaphore));
+	}
+
+	if (const u32 recording_threads = g_cfg.video.vk.command_recording_threads)
+	{
+		m_command_recorder = std::make_unique<vk::command_recorder>(*m_device, recording_threads, VK_MAX_ASYNC_CB_COUNT);
+	}
+
+	if (g_cfg.video.vk.async_present && !m_swapchain->is_headless())
+	{
+		m_present_thread = std::make_unique<named_thread<present_worker>>("VK Present Thread", present_worker{ this });
+	}
+
+	if (g_cfg.video.vk.async_submit)
+	{
+		m_submit_queue = std::make_unique<vk::submit_queue>(*m_device);
+	}
+
 	//Precalculated stuff
-	std::tie(pipeline_layout, descriptor_layouts) = get_shared_pipeline_layout(*m_device);
+	// Pushed descriptors are written into the command buffer at record time, the recorder threads need allocated sets instead
+	const bool push_descriptors = m_device->get_push_descriptor_support() && !m_command_recorder;
+	std::tie(pipeline_layout, descriptor_layouts) = get_shared_pipeline_layout(*m_device, push_descriptors);
+	m_descriptor_writer.create(*m_device, descriptor_layouts, pipeline_layout, push_descriptors);
+
+	if (push_descriptors)
+	{
+		LOG_NOTICE(RSX, "Using push descriptors");
+	}
 
 	//Occlusion
 	m_occlusion_query_pool.create((*m_device), OCCLUSION_MAX_POOL_SIZE);
 	for (int n = 0; n < 128; ++n)
 		m_occlusion_query_data[n].driver_handle = n;
 
+	//GPU timestamps, two per primary command buffer
+	if (g_cfg.video.dynamic_resolution_scaling)
+	{
+		const auto& gpu_limits = m_device->gpu().get_limits();
+		if (gpu_limits.timestampComputeAndGraphics)
+		{
+			VkQueryPoolCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			info.queryCount = VK_MAX_ASYNC_CB_COUNT * 2;
+
+			CHECK_RESULT(vkCreateQueryPool(*m_device, &info, nullptr, &m_timestamp_query_pool));
+			m_timestamp_period = gpu_limits.timestampPeriod;
+		}
+		else
+		{
+			LOG_ERROR(RSX, "Dynamic resolution scaling requires GPU timestamp support which this device does not have");
+		}
+	}
+
+	if (g_cfg.video.gpu_profiler)
+	{
+		vk::get_timestamp_profiler().create(*m_device, VK_MAX_ASYNC_CB_COUNT);
+	}
+
+	m_dynamic_resolution.reset();
+
 	//Generate frame contexts
 	VkDescriptorPoolSize uniform_buffer_pool = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER , 6 * DESCRIPTOR_MAX_DRAW_CALLS };
 	VkDescriptorPoolSize uniform_texel_pool = { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER , 2 * DESCRIPTOR_MAX_DRAW_CALLS };
@@ -494,7 +558,7 @@ VKGSRender::VKGSRender() : GSRender()
 	m_vertex_layout_ring_info.create(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_UBO_RING_BUFFER_SIZE_M * 0x100000, "vertex layout buffer");
 	m_fragment_constants_ring_info.create(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_UBO_RING_BUFFER_SIZE_M * 0x100000, "fragment constants buffer");
 	m_transform_constants_ring_info.create(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_TRANSFORM_CONSTANTS_BUFFER_SIZE_M * 0x100000, "transform constants buffer");
-	m_index_buffer_ring_info.create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_INDEX_RING_BUFFER_SIZE_M * 0x100000, "index buffer");
+	m_index_buffer_ring_info.create(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_INDEX_RING_BUFFER_SIZE_M * 0x100000, "index buffer");
 	m_texture_upload_buffer_ring_info.create(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_TEXTURE_UPLOAD_RING_BUFFER_SIZE_M * 0x100000, "texture upload buffer", 32 * 0x100000);
 
 	const auto limits = m_device->gpu().get_limits();
@@ -534,13 +598,36 @@ VKGSRender::VKGSRender() : GSRender()
 
 	m_prog_buffer = std::make_unique<VKProgramBuffer>();
 
+	if (!g_cfg.video.disable_asynchronous_shader_compiler && g_cfg.video.shader_interpreter_fallback)
+	{
+		m_shader_interpreter = std::make_unique<vk::shader_interpreter>();
+		m_shader_interpreter->init();
+	}
+
 	if (g_cfg.video.disable_vertex_cache)
 		m_vertex_cache = std::make_unique<vk::null_vertex_cache>();
 	else
 		m_vertex_cache = std::make_unique<vk::weak_vertex_cache>();
 
+	if (const u32 cache_size = g_cfg.video.persistent_vertex_cache_size * 0x100000; cache_size && !g_cfg.video.disable_vertex_cache)
+	{
+		if (vk::get_heap_compatible_buffer_types() & VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT)
+		{
+			m_vertex_cache_storage = std::make_unique<vk::buffer>(*m_device, cache_size, memory_map.host_visible_coherent,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT, 0);
+			m_persistent_vertex_cache = std::make_unique<vk::persistent_vertex_cache>(cache_size, VK_MAX_ASYNC_FRAMES);
+		}
+		else
+		{
+			LOG_WARNING(RSX, "Persistent vertex cache is not supported with this driver");
+		}
+	}
+
 	m_shaders_cache = std::make_unique<vk::shader_cache>(*m_prog_buffer, "vulkan", "v1.8");
 
+	// Bump the pack version whenever the decompiler output changes
+	rsx::get_decompiled_program_cache().open(g_cfg.video.disable_on_disk_shader_cache ? "" : Emu.PPUCache() + "shaders_cache/vulkan-decompiled-v1.pack");
+
 	open_command_buffer();
 
 	for (u32 i = 0; i < m_swapchain->get_swap_image_count(); ++i)
@@ -576,6 +663,10 @@ VKGSRender::~VKGSRender()
 		return;
 	}
 
+	wait_for_present();
+	m_present_thread.reset();
+	m_submit_queue.reset();
+
 	//Wait for device to finish up with resources
 	vkDeviceWaitIdle(*m_device);
 
@@ -585,6 +676,13 @@ VKGSRender::~VKGSRender()
 	//Shaders
 	vk::finalize_compiler_context();
 	m_prog_buffer->clear();
+	rsx::get_decompiled_program_cache().close();
+
+	if (m_shader_interpreter)
+	{
+		m_shader_interpreter->destroy();
+		m_shader_interpreter.reset();
+	}
 
 	m_persistent_attribute_storage.reset();
 	m_volatile_attribute_storage.reset();
@@ -593,6 +691,8 @@ VKGSRender::~VKGSRender()
 	vk::destroy_global_resources();
 
 	//Heaps
+	m_persistent_vertex_cache.reset();
+	m_vertex_cache_storage.reset();
 	m_attrib_ring_info.destroy();
 	m_fragment_env_ring_info.destroy();
 	m_vertex_env_ring_info.destroy();
@@ -650,13 +750,24 @@ VKGSRender::~VKGSRender()
 	m_attachment_clear_pass.reset();
 
 	//Pipeline descriptors
+	m_descriptor_writer.destroy();
 	vkDestroyPipelineLayout(*m_device, pipeline_layout, nullptr);
 	vkDestroyDescriptorSetLayout(*m_device, descriptor_layouts, nullptr);
 
 	//Queries
 	m_occlusion_query_pool.destroy();
 
+	if (m_timestamp_query_pool)
+	{
+		vkDestroyQueryPool(*m_device, m_timestamp_query_pool, nullptr);
+		m_timestamp_query_pool = VK_NULL_HANDLE;
+	}
+
+	vk::get_timestamp_profiler().destroy();
+
 	//Command buffer
+	m_command_recorder.reset();
+
 	for (auto &cb : m_primary_cb_list)
 		cb.destroy();
 
@@ -665,6 +776,13 @@ VKGSRender::~VKGSRender()
 	m_secondary_command_buffer.destroy();
 	m_secondary_command_buffer_pool.destroy();
 
+	if (m_transfer_semaphore)
+	{
+		m_transfer_command_buffer.destroy();
+		m_transfer_command_buffer_pool.destroy();
+		vkDestroySemaphore((*m_device), m_transfer_semaphore, nullptr);
+	}
+
 	//Device handles/contexts
 	m_swapchain->destroy();
 	m_thread_context.close();
@@ -677,6 +795,9 @@ VKGSRender::~VKGSRender()
 
 bool VKGSRender::on_access_violation(u32 address, bool is_writing)
 {
+	// Vertex cache and texture cache protection may share the page
+	const bool vertex_cache_handled = m_persistent_vertex_cache && m_persistent_vertex_cache->on_access_violation(address, is_writing);
+
 	vk::texture_cache::thrashed_set result;
 	{
 		std::lock_guard lock(m_secondary_cb_guard);
@@ -686,7 +807,7 @@ bool VKGSRender::on_access_violation(u32 address, bool is_writing)
 	}
 
 	if (!result.violation_handled)
-		return false;
+		return vertex_cache_handled;
 
 	{
 		std::lock_guard lock(m_sampler_mutex);
@@ -698,6 +819,24 @@ bool VKGSRender::on_access_violation(u32 address, bool is_writing)
 		const bool is_rsxthr = std::this_thread::get_id() == m_rsx_thread;
 		bool has_queue_ref = false;
 
+		// If every section was speculatively read back and the transfer has already been submitted,
+		// the flush only has to wait on the section's event and copy out of host memory
+		// flush_always sections may have to copy again, which records into the primary command buffer
+		const u64 last_submit = m_last_submit_timestamp;
+		const bool dma_in_flight = !result.sections_to_flush.empty() && std::all_of(result.sections_to_flush.begin(), result.sections_to_flush.end(), [&](const auto& section)
+		{
+			return section->is_synchronized() && section->get_sync_timestamp() < last_submit &&
+				section->get_memory_read_flags() != rsx::memory_read_flags::flush_always;
+		});
+
+		if (dma_in_flight)
+		{
+			// No need to interrupt the RSX thread, a section invalidated by a tag mismatch still records into the secondary command buffer
+			std::lock_guard lock(m_secondary_cb_guard);
+			m_texture_cache.flush_all(m_secondary_command_buffer, result);
+			return true;
+		}
+
 		if (!is_rsxthr)
 		{
 			//Always submit primary cb to ensure state consistency (flush pending changes such as image transitions)
@@ -738,6 +877,11 @@ bool VKGSRender::on_access_violation(u32 address, bool is_writing)
 
 void VKGSRender::on_invalidate_memory_range(const utils::address_range &range)
 {
+	if (m_persistent_vertex_cache)
+	{
+		m_persistent_vertex_cache->invalidate_range(range);
+	}
+
 	std::lock_guard lock(m_secondary_cb_guard);
 
 	auto data = std::move(m_texture_cache.invalidate_range(m_secondary_command_buffer, range, rsx::invalidation_cause::unmap));
@@ -826,6 +970,11 @@ void VKGSRender::check_heap_status(u32 flags)
 		while (flags && !heap_critical);
 	}
 
+	if (heap_critical && grow_critical_heaps())
+	{
+		return;
+	}
+
 	if (heap_critical)
 	{
 		std::chrono::time_point<steady_clock> submit_start = steady_clock::now();
@@ -867,6 +1016,47 @@ void VKGSRender::check_heap_status(u32 flags)
 	}
 }
 
+bool VKGSRender::grow_critical_heaps()
+{
+	const u32 growth_limit = g_cfg.video.vk.heap_growth_limit;
+	if (growth_limit <= 1)
+	{
+		return false;
+	}
+
+	// Every full heap must be able to grow, a single flush is cheaper than growing some and flushing anyway
+	vk::data_heap* heaps[] =
+	{
+		&m_attrib_ring_info, &m_texture_upload_buffer_ring_info, &m_fragment_env_ring_info,
+		&m_vertex_env_ring_info, &m_fragment_texture_params_ring_info, &m_vertex_layout_ring_info,
+		&m_fragment_constants_ring_info, &m_transform_constants_ring_info, &m_index_buffer_ring_info
+	};
+
+	for (const auto heap : heaps)
+	{
+		if (heap->is_critical() && heap->size() >= heap->base_size * growth_limit)
+		{
+			return false;
+		}
+	}
+
+	for (const auto heap : heaps)
+	{
+		if (heap->is_critical())
+		{
+			verify(HERE), heap->grow(growth_limit);
+
+			if (heap == &m_attrib_ring_info)
+			{
+				// The vertex cache references offsets into the replaced attribute buffer
+				m_vertex_cache->purge();
+			}
+		}
+	}
+
+	return true;
+}
+
 void VKGSRender::check_present_status()
 {
 	while (!m_queued_frames.empty())
@@ -896,6 +1086,7 @@ void VKGSRender::check_descriptors()
 
 		m_current_frame->descriptor_pool.reset(0);
 		m_current_frame->used_descriptors = 0;
+		m_current_frame->descriptor_set_cache.clear();
 	}
 }
 
@@ -916,10 +1107,29 @@ VkDescriptorSet VKGSRender::allocate_descriptor_set()
 	return new_descriptor_set;
 }
 
+VkDescriptorSet VKGSRender::get_descriptor_set()
+{
+	// Draws binding the same resources share a set until the pool is reset.
+	// Resources are only destroyed once the frame that released them has completed, so cached sets never reference dead handles
+	const auto found = m_current_frame->descriptor_set_cache.find(m_descriptor_bindings);
+	if (found != m_current_frame->descriptor_set_cache.end())
+	{
+		return found->second;
+	}
+
+	const auto descriptor_set = allocate_descriptor_set();
+	m_descriptor_writer.update(descriptor_set, m_descriptor_bindings);
+	m_current_frame->descriptor_set_cache.emplace(m_descriptor_bindings, descriptor_set);
+	return descriptor_set;
+}
+
 void VKGSRender::begin()
 {
 	rsx::thread::begin();
 
+	// Draws may sample or render into blit targets
+	vk::flush_pending_blits();
+
 	if (skip_frame || swapchain_unavailable ||
 		(conditional_render_enabled && conditional_render_test_failed))
 		return;
@@ -943,6 +1153,7 @@ void VKGSRender::begin()
 		{
 			m_current_frame->descriptor_pool.reset(0);
 			m_current_frame->used_descriptors = 0;
+			m_current_frame->descriptor_set_cache.clear();
 		}
 
 		verify(HERE), !m_current_frame->swap_command_buffer;
@@ -955,70 +1166,107 @@ void VKGSRender::update_draw_state()
 {
 	std::chrono::time_point<steady_clock> start = steady_clock::now();
 
-	float actual_line_width = rsx::method_registers.line_width();
-	vkCmdSetLineWidth(*m_current_command_buffer, actual_line_width);
+	m_draw_state.pipeline = m_program->pipeline;
+	m_draw_state.pipeline_layout = pipeline_layout;
+	m_draw_state.viewport = m_viewport;
+	m_draw_state.scissor = m_scissor;
+	m_draw_state.line_width = rsx::method_registers.line_width();
 
 	if (rsx::method_registers.poly_offset_fill_enabled())
 	{
 		//offset_bias is the constant factor, multiplied by the implementation factor R
 		//offst_scale is the slope factor, multiplied by the triangle slope factor M
-		vkCmdSetDepthBias(*m_current_command_buffer, rsx::method_registers.poly_offset_bias(), 0.f, rsx::method_registers.poly_offset_scale());
+		m_draw_state.depth_bias_constant = rsx::method_registers.poly_offset_bias();
+		m_draw_state.depth_bias_slope = rsx::method_registers.poly_offset_scale();
 	}
 	else
 	{
 		//Zero bias value - disables depth bias
-		vkCmdSetDepthBias(*m_current_command_buffer, 0.f, 0.f, 0.f);
+		m_draw_state.depth_bias_constant = 0.f;
+		m_draw_state.depth_bias_slope = 0.f;
 	}
 
 	//Update dynamic state
-	if (rsx::method_registers.blend_enabled())
+	m_draw_state.blend_enabled = rsx::method_registers.blend_enabled();
+	if (m_draw_state.blend_enabled)
 	{
 		//Update blend constants
-		auto blend_colors = rsx::get_constant_blend_colors();
-		vkCmdSetBlendConstants(*m_current_command_buffer, blend_colors.data());
+		m_draw_state.blend_constants = rsx::get_constant_blend_colors();
 	}
 
-	if (rsx::method_registers.stencil_test_enabled())
+	m_draw_state.stencil_enabled = rsx::method_registers.stencil_test_enabled();
+	if (m_draw_state.stencil_enabled)
 	{
-		const bool two_sided_stencil = rsx::method_registers.two_sided_stencil_test_enabled();
-		VkStencilFaceFlags face_flag = (two_sided_stencil) ? VK_STENCIL_FACE_FRONT_BIT : VK_STENCIL_FRONT_AND_BACK;
-
-		vkCmdSetStencilWriteMask(*m_current_command_buffer, face_flag, rsx::method_registers.stencil_mask());
-		vkCmdSetStencilCompareMask(*m_current_command_buffer, face_flag, rsx::method_registers.stencil_func_mask());
-		vkCmdSetStencilReference(*m_current_command_buffer, face_flag, rsx::method_registers.stencil_func_ref());
+		m_draw_state.two_sided_stencil = rsx::method_registers.two_sided_stencil_test_enabled();
+		m_draw_state.stencil_write_mask[0] = rsx::method_registers.stencil_mask();
+		m_draw_state.stencil_compare_mask[0] = rsx::method_registers.stencil_func_mask();
+		m_draw_state.stencil_reference[0] = rsx::method_registers.stencil_func_ref();
 
-		if (two_sided_stencil)
+		if (m_draw_state.two_sided_stencil)
 		{
-			vkCmdSetStencilWriteMask(*m_current_command_buffer, VK_STENCIL_FACE_BACK_BIT, rsx::method_registers.back_stencil_mask());
-			vkCmdSetStencilCompareMask(*m_current_command_buffer, VK_STENCIL_FACE_BACK_BIT, rsx::method_registers.back_stencil_func_mask());
-			vkCmdSetStencilReference(*m_current_command_buffer, VK_STENCIL_FACE_BACK_BIT, rsx::method_registers.back_stencil_func_ref());
+			m_draw_state.stencil_write_mask[1] = rsx::method_registers.back_stencil_mask();
+			m_draw_state.stencil_compare_mask[1] = rsx::method_registers.back_stencil_func_mask();
+			m_draw_state.stencil_reference[1] = rsx::method_registers.back_stencil_func_ref();
 		}
 	}
 
 	if (rsx::method_registers.depth_bounds_test_enabled())
 	{
 		//Update depth bounds min/max
-		vkCmdSetDepthBounds(*m_current_command_buffer, rsx::method_registers.depth_bounds_min(), rsx::method_registers.depth_bounds_max());
+		m_draw_state.depth_bounds_min = rsx::method_registers.depth_bounds_min();
+		m_draw_state.depth_bounds_max = rsx::method_registers.depth_bounds_max();
 	}
 	else
 	{
-		vkCmdSetDepthBounds(*m_current_command_buffer, 0.f, 1.f);
+		m_draw_state.depth_bounds_min = 0.f;
+		m_draw_state.depth_bounds_max = 1.f;
 	}
 
-	bind_viewport();
-
 	//TODO: Set up other render-state parameters into the program pipeline
 
 	std::chrono::time_point<steady_clock> stop = steady_clock::now();
 	m_setup_time += std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
 }
 
-void VKGSRender::begin_render_pass()
+void VKGSRender::consume_deferred_clears()
+{
+	for (u32 index = 0; index < m_fbo_images.size(); ++index)
+	{
+		auto surface = vk::as_rtt(m_fbo_images[index]);
+
+		// Inherited contents are written before the pass begins and would be overwritten by the load operation
+		if (surface->old_contents || surface->samples() > 1)
+		{
+			continue;
+		}
+
+		if (surface->clear_pending)
+		{
+			m_pass_clear_values[index] = surface->pending_clear_value;
+			m_pass_clear_mask |= (1u << index);
+			surface->clear_pending = false;
+		}
+		else if (surface->state_flags & rsx::surface_state_flags::erase_bkgnd)
+		{
+			// Same initialization as the write barrier would have recorded with a transfer clear
+			m_pass_clear_values[index] = surface->get_erase_value();
+			m_pass_clear_mask |= (1u << index);
+			surface->on_write(rsx::get_shared_tag(), rsx::surface_state_flags::ready);
+		}
+	}
+}
+
+void VKGSRender::begin_render_pass(VkSubpassContents contents)
 {
 	if (m_render_pass_open)
 		return;
 
-	const auto renderpass = (m_cached_renderpass)? m_cached_renderpass : vk::get_renderpass(*m_device, m_current_renderpass_key);
+	// Timestamps cannot be written inside a render pass that executes secondaries, the scope brackets the whole pass
+	m_render_pass_profiled = vk::get_timestamp_profiler().begin_scope(*m_current_command_buffer, rsx::gpu_timer_category::render_pass);
+
+	consume_deferred_clears();
+
+	auto renderpass = (m_cached_renderpass)? m_cached_renderpass : vk::get_renderpass(*m_device, m_current_renderpass_key);
 
 	VkRenderPassBeginInfo rp_begin = {};
 	rp_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -1029,8 +1277,20 @@ void VKGSRender::begin_render_pass()
 	rp_begin.renderArea.extent.width = m_draw_fbo->width();
 	rp_begin.renderArea.extent.height = m_draw_fbo->height();
 
-	vkCmdBeginRenderPass(*m_current_command_buffer, &rp_begin, VK_SUBPASS_CONTENTS_INLINE);
+	if (m_pass_clear_mask)
+	{
+		// The clears are done by the load operation of a compatible pass, the render area covers the whole framebuffer
+		rp_begin.renderPass = vk::get_renderpass(*m_device, vk::get_renderpass_clear_key(m_current_renderpass_key, m_pass_clear_mask));
+		rp_begin.clearValueCount = ::size32(m_fbo_images);
+		rp_begin.pClearValues = m_pass_clear_values.data();
+
+		m_folded_clears_this_frame += utils::popcnt32(m_pass_clear_mask);
+		m_pass_clear_mask = 0;
+	}
+
+	vkCmdBeginRenderPass(*m_current_command_buffer, &rp_begin, contents);
 	m_render_pass_open = true;
+	m_render_passes_this_frame++;
 }
 
 void VKGSRender::close_render_pass()
@@ -1040,6 +1300,12 @@ void VKGSRender::close_render_pass()
 
 	vkCmdEndRenderPass(*m_current_command_buffer);
 	m_render_pass_open = false;
+
+	if (m_render_pass_profiled)
+	{
+		vk::get_timestamp_profiler().end_scope();
+		m_render_pass_profiled = false;
+	}
 }
 
 void VKGSRender::emit_geometry(u32 sub_index)
@@ -1092,59 +1358,31 @@ void VKGSRender::emit_geometry(u32 sub_index)
 
 	auto persistent_buffer = m_persistent_attribute_storage ? m_persistent_attribute_storage->value : null_buffer_view->value;
 	auto volatile_buffer = m_volatile_attribute_storage ? m_volatile_attribute_storage->value : null_buffer_view->value;
-	bool update_descriptors = false;
 
-	if (sub_index == 0)
+	// Update vertex fetch parameters
+	update_vertex_env(upload_info);
+
+	// The staged bindings persist between sub-draws, the streams only need rebinding if they moved
+	if (sub_index == 0 || persistent_buffer != old_persistent_buffer || volatile_buffer != old_volatile_buffer)
 	{
-		update_descriptors = true;
+		m_program->bind_uniform(persistent_buffer, vk::glsl::program_input_type::input_type_texel_buffer, "persistent_input_stream", m_descriptor_bindings);
+		m_program->bind_uniform(volatile_buffer, vk::glsl::program_input_type::input_type_texel_buffer, "volatile_input_stream", m_descriptor_bindings);
 	}
-	else
-	{
-		// Vertex env update will change information in the descriptor set
-		// Make a copy for the next draw call
-		// TODO: Restructure program to allow use of push constants when possible
-		// NOTE: AMD has insuffecient push constants buffer memory which is unfortunate
-		VkDescriptorSet new_descriptor_set = allocate_descriptor_set();
-		std::array<VkCopyDescriptorSet, VK_NUM_DESCRIPTOR_BINDINGS> copy_set;
 
-		for (u32 n = 0; n < VK_NUM_DESCRIPTOR_BINDINGS; ++n)
-		{
-			copy_set[n] =
-			{
-				VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET,   // sType
-				nullptr,                                 // pNext
-				m_current_frame->descriptor_set,         // srcSet
-				n,                                       // srcBinding
-				0u,                                      // srcArrayElement
-				new_descriptor_set,                      // dstSet
-				n,                                       // dstBinding
-				0u,                                      // dstArrayElement
-				1u                                       // descriptorCount
-			};
-		}
+	// Descriptors and draw parameters are final at this point, the packet can be recorded on any thread
+	vk::draw_packet packet;
 
-		vkUpdateDescriptorSets(*m_device, 0, 0, VK_NUM_DESCRIPTOR_BINDINGS, copy_set.data());
-		m_current_frame->descriptor_set = new_descriptor_set;
-
-		if (persistent_buffer != old_persistent_buffer || volatile_buffer != old_volatile_buffer)
-		{
-			// Rare event, we need to actually change the descriptors
-			update_descriptors = true;
-		}
+	if (m_descriptor_writer.use_push_descriptors())
+	{
+		// Pushed descriptors are part of the command stream, the recorder is never active in this mode
+		m_descriptor_writer.push(*m_current_command_buffer, m_descriptor_bindings);
+		packet.descriptor_set = VK_NULL_HANDLE;
 	}
-
-	// Update vertex fetch parameters
-	update_vertex_env(upload_info);
-
-	if (update_descriptors)
+	else
 	{
-		m_program->bind_uniform(persistent_buffer, vk::glsl::program_input_type::input_type_texel_buffer, "persistent_input_stream", m_current_frame->descriptor_set);
-		m_program->bind_uniform(volatile_buffer, vk::glsl::program_input_type::input_type_texel_buffer, "volatile_input_stream", m_current_frame->descriptor_set);
+		packet.descriptor_set = get_descriptor_set();
 	}
 
-	// Bind the new set of descriptors for use with this draw call
-	vkCmdBindDescriptorSets(*m_current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &m_current_frame->descriptor_set, 0, nullptr);
-
 	//std::chrono::time_point<steady_clock> draw_start = steady_clock::now();
 	//m_setup_time += std::chrono::duration_cast<std::chrono::microseconds>(draw_start - vertex_end).count();
 
@@ -1152,44 +1390,104 @@ void VKGSRender::emit_geometry(u32 sub_index)
 	{
 		if (draw_call.is_single_draw())
 		{
-			vkCmdDraw(*m_current_command_buffer, upload_info.vertex_draw_count, 1, 0, 0);
+			packet.draw_count = upload_info.vertex_draw_count;
 		}
 		else
 		{
 			u32 vertex_offset = 0;
 			const auto subranges = draw_call.get_subranges();
-			for (const auto &range : subranges)
+
+			if (subranges.size() <= m_device->get_max_draw_indirect_count())
+			{
+				// Emit the whole flattened clause as a single indirect multi-draw
+				const u32 draw_count = (u32)subranges.size();
+				const u32 cmd_size = draw_count * sizeof(VkDrawIndirectCommand);
+				const VkDeviceSize cmd_offset = m_index_buffer_ring_info.alloc<16>(cmd_size);
+				auto cmds = (VkDrawIndirectCommand*)m_index_buffer_ring_info.map(cmd_offset, cmd_size);
+
+				for (const auto &range : subranges)
+				{
+					*cmds++ = { range.count, 1, vertex_offset, 0 };
+					vertex_offset += range.count;
+				}
+
+				m_index_buffer_ring_info.unmap();
+
+				packet.indirect_buffer = m_index_buffer_ring_info.heap->value;
+				packet.indirect_offset = cmd_offset;
+				packet.indirect_count = draw_count;
+			}
+			else
 			{
-				vkCmdDraw(*m_current_command_buffer, range.count, 1, vertex_offset, 0);
-				vertex_offset += range.count;
+				packet.ranges.reserve(subranges.size());
+
+				for (const auto &range : subranges)
+				{
+					packet.ranges.push_back({ range.count, vertex_offset });
+					vertex_offset += range.count;
+				}
 			}
 		}
 	}
 	else
 	{
-		const VkIndexType index_type = std::get<1>(*upload_info.index_info);
-		const VkDeviceSize offset = std::get<0>(*upload_info.index_info);
-
-		vkCmdBindIndexBuffer(*m_current_command_buffer, m_index_buffer_ring_info.heap->value, offset, index_type);
+		packet.index_buffer = m_index_buffer_ring_info.heap->value;
+		packet.index_offset = std::get<0>(*upload_info.index_info);
+		packet.index_type = std::get<1>(*upload_info.index_info);
 
 		if (rsx::method_registers.current_draw_clause.is_single_draw())
 		{
-			const u32 index_count = upload_info.vertex_draw_count;
-			vkCmdDrawIndexed(*m_current_command_buffer, index_count, 1, 0, 0, 0);
+			packet.draw_count = upload_info.vertex_draw_count;
 		}
 		else
 		{
 			u32 vertex_offset = 0;
 			const auto subranges = draw_call.get_subranges();
-			for (const auto &range : subranges)
+
+			if (subranges.size() <= m_device->get_max_draw_indirect_count())
+			{
+				// Emit the whole flattened clause as a single indirect multi-draw
+				const u32 draw_count = (u32)subranges.size();
+				const u32 cmd_size = draw_count * sizeof(VkDrawIndexedIndirectCommand);
+				const VkDeviceSize cmd_offset = m_index_buffer_ring_info.alloc<16>(cmd_size);
+				auto cmds = (VkDrawIndexedIndirectCommand*)m_index_buffer_ring_info.map(cmd_offset, cmd_size);
+
+				for (const auto &range : subranges)
+				{
+					const auto count = get_index_count(draw_call.primitive, range.count);
+					*cmds++ = { count, 1, vertex_offset, 0, 0 };
+					vertex_offset += count;
+				}
+
+				m_index_buffer_ring_info.unmap();
+
+				packet.indirect_buffer = m_index_buffer_ring_info.heap->value;
+				packet.indirect_offset = cmd_offset;
+				packet.indirect_count = draw_count;
+			}
+			else
 			{
-				const auto count = get_index_count(draw_call.primitive, range.count);
-				vkCmdDrawIndexed(*m_current_command_buffer, count, 1, vertex_offset, 0, 0);
-				vertex_offset += count;
+				packet.ranges.reserve(subranges.size());
+
+				for (const auto &range : subranges)
+				{
+					const auto count = get_index_count(draw_call.primitive, range.count);
+					packet.ranges.push_back({ count, vertex_offset });
+					vertex_offset += count;
+				}
 			}
 		}
 	}
 
+	if (m_command_recorder && m_command_recorder->is_recording())
+	{
+		m_command_recorder->push(std::move(packet));
+	}
+	else
+	{
+		packet.record(*m_current_command_buffer, pipeline_layout);
+	}
+
 	//std::chrono::time_point<steady_clock> draw_end = steady_clock::now();
 	//m_draw_time += std::chrono::duration_cast<std::chrono::microseconds>(draw_end - draw_start).count();
 }
@@ -1205,6 +1503,7 @@ void VKGSRender::end()
 	}
 
 	std::chrono::time_point<steady_clock> textures_start = steady_clock::now();
+	bool textures_profiled = vk::get_timestamp_profiler().begin_scope(*m_current_command_buffer, rsx::gpu_timer_category::texture_cache);
 
 	// Check for data casts
 	auto ds = std::get<1>(m_rtts.m_bound_depth_stencil);
@@ -1434,6 +1733,11 @@ void VKGSRender::end()
 		}
 	}
 
+	if (textures_profiled)
+	{
+		vk::get_timestamp_profiler().end_scope();
+	}
+
 	std::chrono::time_point<steady_clock> textures_end = steady_clock::now();
 	m_textures_upload_time += (u32)std::chrono::duration_cast<std::chrono::microseconds>(textures_end - textures_start).count();
 
@@ -1448,9 +1752,17 @@ void VKGSRender::end()
 		return;
 	}
 
-	// Allocate descriptor set
-	check_descriptors();
-	m_current_frame->descriptor_set = allocate_descriptor_set();
+	// Reserve descriptor sets for the clause, textures left unbound by the program must still hold valid descriptors
+	if (!m_descriptor_writer.use_push_descriptors())
+	{
+		check_descriptors();
+	}
+
+	const VkDescriptorImageInfo null_texture = { vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	for (u32 binding = TEXTURES_FIRST_BIND_SLOT; binding < VK_NUM_DESCRIPTOR_BINDINGS; ++binding)
+	{
+		m_descriptor_bindings.set_image(binding, null_texture);
+	}
 
 	// Load program execution environment
 	load_program_env();
@@ -1459,6 +1771,7 @@ void VKGSRender::end()
 	m_setup_time += std::chrono::duration_cast<std::chrono::microseconds>(program_end - program_start).count();
 
 	textures_start = program_end;
+	textures_profiled = vk::get_timestamp_profiler().begin_scope(*m_current_command_buffer, rsx::gpu_timer_category::texture_cache);
 
 	for (int i = 0; i < rsx::limits::fragment_textures_count; ++i)
 	{
@@ -1496,7 +1809,7 @@ void VKGSRender::end()
 				m_program->bind_uniform({ fs_sampler_handles[i]->value, view->value, view->image()->current_layout },
 					i,
 					::glsl::program_domain::glsl_fragment_program,
-					m_current_frame->descriptor_set);
+					m_descriptor_bindings);
 
 				if (current_fragment_program.redirected_textures & (1 << i))
 				{
@@ -1518,7 +1831,7 @@ void VKGSRender::end()
 					m_program->bind_uniform({ m_stencil_mirror_sampler->value, stencil_view->value, stencil_view->image()->current_layout },
 						i,
 						::glsl::program_domain::glsl_fragment_program,
-						m_current_frame->descriptor_set,
+						m_descriptor_bindings,
 						true);
 				}
 			}
@@ -1527,18 +1840,26 @@ void VKGSRender::end()
 				m_program->bind_uniform({ vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 					i,
 					::glsl::program_domain::glsl_fragment_program,
-					m_current_frame->descriptor_set);
+					m_descriptor_bindings);
 
 				if (current_fragment_program.redirected_textures & (1 << i))
 				{
 					m_program->bind_uniform({ vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 						i,
 						::glsl::program_domain::glsl_fragment_program,
-						m_current_frame->descriptor_set,
+						m_descriptor_bindings,
 						true);
 				}
 			}
 		}
+		else if (m_shader_interpreter_active)
+		{
+			// The interpreter declares every texture unit
+			m_program->bind_uniform({ vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+				i,
+				::glsl::program_domain::glsl_fragment_program,
+				m_descriptor_bindings);
+		}
 	}
 
 	for (int i = 0; i < rsx::limits::vertex_textures_count; ++i)
@@ -1550,7 +1871,7 @@ void VKGSRender::end()
 				m_program->bind_uniform({ vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 					i,
 					::glsl::program_domain::glsl_vertex_program,
-					m_current_frame->descriptor_set);
+					m_descriptor_bindings);
 
 				continue;
 			}
@@ -1570,7 +1891,7 @@ void VKGSRender::end()
 				m_program->bind_uniform({ vk::null_sampler(), vk::null_image_view(*m_current_command_buffer)->value, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
 					i,
 					::glsl::program_domain::glsl_vertex_program,
-					m_current_frame->descriptor_set);
+					m_descriptor_bindings);
 
 				continue;
 			}
@@ -1590,10 +1911,15 @@ void VKGSRender::end()
 			m_program->bind_uniform({ vs_sampler_handles[i]->value, image_ptr->value, image_ptr->image()->current_layout },
 				i,
 				::glsl::program_domain::glsl_vertex_program,
-				m_current_frame->descriptor_set);
+				m_descriptor_bindings);
 		}
 	}
 
+	if (textures_profiled)
+	{
+		vk::get_timestamp_profiler().end_scope();
+	}
+
 	textures_end = steady_clock::now();
 	m_textures_upload_time += std::chrono::duration_cast<std::chrono::microseconds>(textures_end - textures_start).count();
 
@@ -1628,6 +1954,14 @@ void VKGSRender::end()
 		m_current_command_buffer->flags |= vk::command_buffer::cb_has_occlusion_task;
 	}
 
+	// Large clauses are recorded into secondary command buffers by the recorder threads.
+	// Queries would have to be inherited by the secondaries, which needs an optional device feature
+	bool record_async = m_command_recorder && !m_occlusion_query_active &&
+		rsx::method_registers.current_draw_clause.pass_count() >= vk::command_recorder::min_draw_count;
+
+	// Pending clears of the bound surfaces become load operations of the pass opened below
+	consume_deferred_clears();
+
 	// Apply write memory barriers
 	if (true)//g_cfg.video.strict_rendering_mode)
 	{
@@ -1641,10 +1975,12 @@ void VKGSRender::end()
 			}
 		}
 
-		begin_render_pass();
+		begin_render_pass(record_async ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 	}
 	else
 	{
+		// The clears below are recorded inline
+		record_async = false;
 		begin_render_pass();
 
 		// Clear any 'dirty' surfaces - possible is a recycled cache surface is used
@@ -1684,9 +2020,18 @@ void VKGSRender::end()
 	// Only textures are synchronized tightly with the GPU and they have been read back above
 	vk::enter_uninterruptible();
 
-	vkCmdBindPipeline(*m_current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_program->pipeline);
 	update_draw_state();
 
+	if (record_async)
+	{
+		const auto renderpass = (m_cached_renderpass)? m_cached_renderpass : vk::get_renderpass(*m_device, m_current_renderpass_key);
+		m_command_recorder->begin(m_draw_state, *m_current_command_buffer, renderpass, m_draw_fbo->value, m_current_cb_index);
+	}
+	else
+	{
+		m_draw_state.apply(*m_current_command_buffer);
+	}
+
 	u32 sub_index = 0;
 	rsx::method_registers.current_draw_clause.begin();
 	do
@@ -1695,6 +2040,11 @@ void VKGSRender::end()
 	}
 	while (rsx::method_registers.current_draw_clause.next());
 
+	if (record_async)
+	{
+		m_command_recorder->end();
+	}
+
 	close_render_pass();
 	vk::leave_uninterruptible();
 
@@ -1759,12 +2109,6 @@ void VKGSRender::set_scissor()
 	}
 }
 
-void VKGSRender::bind_viewport()
-{
-	vkCmdSetViewport(*m_current_command_buffer, 0, 1, &m_viewport);
-	vkCmdSetScissor(*m_current_command_buffer, 0, 1, &m_scissor);
-}
-
 void VKGSRender::on_init_thread()
 {
 	if (m_device == VK_NULL_HANDLE)
@@ -1845,7 +2189,12 @@ void VKGSRender::on_init_thread()
 
 void VKGSRender::on_exit()
 {
+	// Join the present thread before the pacing statistics are reported
+	wait_for_present();
+	m_present_thread.reset();
+
 	zcull_ctrl.release();
+	rsx::g_dynamic_resolution_scale = 0;
 	GSRender::on_exit();
 }
 
@@ -1853,6 +2202,8 @@ void VKGSRender::clear_surface(u32 mask)
 {
 	if (skip_frame || swapchain_unavailable) return;
 
+	vk::flush_pending_blits();
+
 	// If stencil write mask is disabled, remove clear_stencil bit
 	if (!rsx::method_registers.stencil_mask()) mask &= ~0x2u;
 
@@ -1981,6 +2332,14 @@ void VKGSRender::clear_surface(u32 mask)
 				{
 					for (u32 index = 0; index < m_draw_buffers.size(); ++index)
 					{
+						auto rtt = m_rtts.m_bound_render_targets[m_draw_buffers[index]].second;
+						if (!require_mem_load && rtt->samples() == 1)
+						{
+							// Folded into the load operation of the next render pass on this surface
+							rtt->defer_clear(color_clear_values);
+							continue;
+						}
+
 						clear_descriptors.push_back({ VK_IMAGE_ASPECT_COLOR_BIT, index, color_clear_values });
 					}
 				}
@@ -2001,7 +2360,8 @@ void VKGSRender::clear_surface(u32 mask)
 					{
 						if (auto rtt = m_rtts.m_bound_render_targets[index].second)
 						{
-							if (require_mem_load) rtt->write_barrier(*m_current_command_buffer);
+							// A pending clear has to land before the masked clear is applied on top of it
+							if (require_mem_load || rtt->clear_pending) rtt->write_barrier(*m_current_command_buffer);
 
 							// Add a barrier to ensure previous writes are visible; also transitions into GENERAL layout
 							const auto old_layout = rtt->current_layout;
@@ -2040,9 +2400,19 @@ void VKGSRender::clear_surface(u32 mask)
 	{
 		if (const auto address = m_rtts.m_bound_depth_stencil.first)
 		{
-			if (require_mem_load) m_rtts.m_bound_depth_stencil.second->write_barrier(*m_current_command_buffer);
+			auto ds = m_rtts.m_bound_depth_stencil.second;
+			if (require_mem_load) ds->write_barrier(*m_current_command_buffer);
 			m_rtts.on_write(address);
-			clear_descriptors.push_back({ (VkImageAspectFlags)depth_stencil_mask, 0, depth_stencil_clear_values });
+
+			if (!require_mem_load && ds->samples() == 1 && depth_stencil_mask == ds->aspect())
+			{
+				// Every aspect is overwritten, the next render pass can clear on load
+				ds->defer_clear(depth_stencil_clear_values);
+			}
+			else
+			{
+				clear_descriptors.push_back({ (VkImageAspectFlags)depth_stencil_mask, 0, depth_stencil_clear_values });
+			}
 		}
 	}
 
@@ -2118,8 +2488,12 @@ void VKGSRender::advance_queued_frames()
 	// Check all other frames for completion and clear resources
 	check_present_status();
 
+	// Trim the caches before device-local allocations start failing or spilling into host memory
+	const bool memory_pressure = update_memory_usage();
+	m_texture_cache.set_memory_pressure(memory_pressure);
+
 	//m_rtts storage is double buffered and should be safe to tag on frame boundary
-	m_rtts.free_invalidated();
+	m_rtts.free_invalidated(memory_pressure || m_texture_cache.is_over_memory_budget());
 
 	//texture cache is also double buffered to prevent use-after-free
 	m_texture_cache.on_frame_end();
@@ -2128,6 +2502,12 @@ void VKGSRender::advance_queued_frames()
 	vk::remove_unused_framebuffers();
 
 	m_vertex_cache->purge();
+
+	if (m_persistent_vertex_cache)
+	{
+		m_persistent_vertex_cache->on_frame_end();
+	}
+
 	m_current_frame->tag_frame_end(m_attrib_ring_info.get_current_put_pos_minus_one(),
 		m_vertex_env_ring_info.get_current_put_pos_minus_one(),
 		m_fragment_env_ring_info.get_current_put_pos_minus_one(),
@@ -2148,28 +2528,154 @@ void VKGSRender::advance_queued_frames()
 	vk::advance_frame_counter();
 }
 
-void VKGSRender::present(frame_context_t *ctx)
+bool VKGSRender::present(frame_context_t *ctx)
 {
 	verify(HERE), ctx->present_image != UINT32_MAX;
 
-	if (!swapchain_unavailable)
+	// The frame's submission signals the semaphore waited on here
+	vk::flush_submit_queue();
+
+	// The present queue is usually the graphics queue, which is also submitted to from other threads
+	vk::acquire_global_submit_lock();
+	const VkResult error = m_swapchain->present(ctx->present_wait_semaphore, ctx->present_image);
+	vk::release_global_submit_lock();
+
+	m_present_stats.on_present(get_system_time());
+
+	// Presentation image released; reset value
+	ctx->present_image = UINT32_MAX;
+
+	switch (error)
 	{
-		switch (VkResult error = m_swapchain->present(ctx->present_wait_semaphore, ctx->present_image))
+	case VK_SUCCESS:
+	case VK_SUBOPTIMAL_KHR:
+		return true;
+	case VK_ERROR_OUT_OF_DATE_KHR:
+		return false;
+	default:
+		vk::die_with_error(HERE, error);
+		return false;
+	}
+}
+
+bool VKGSRender::update_memory_usage()
+{
+	m_device->get_memory_heap_usage(m_memory_heaps);
+
+	u64 usage = 0, budget = 0;
+	bool pressure = false;
+
+	for (const auto& heap : m_memory_heaps)
+	{
+		if (!heap.device_local)
 		{
-		case VK_SUCCESS:
-			break;
-		case VK_SUBOPTIMAL_KHR:
-			break;
-		case VK_ERROR_OUT_OF_DATE_KHR:
-			swapchain_unavailable = true;
-			break;
-		default:
-			vk::die_with_error(HERE, error);
+			continue;
 		}
+
+		usage += heap.usage;
+		budget += heap.budget;
+
+		// Keep some headroom, other processes allocate from the same heaps
+		pressure |= (heap.usage >= (heap.budget / 10) * 9);
 	}
 
-	// Presentation image released; reset value
-	ctx->present_image = UINT32_MAX;
+	if (pressure && m_device_local_usage < (budget / 10) * 9)
+	{
+		LOG_WARNING(RSX, "Device-local memory is running low (%lluM of %lluM in use), releasing cached resources", usage / 0x100000, budget / 0x100000);
+	}
+
+	m_device_local_usage = usage;
+	m_device_local_budget = budget;
+	return pressure;
+}
+
+std::pair<u64, u64> VKGSRender::get_video_memory_usage() const
+{
+	return { m_device_local_usage.load(), m_device_local_budget.load() };
+}
+
+bool VKGSRender::get_gpu_frame_timings(rsx::gpu_frame_timings& timings) const
+{
+	const auto& profiler = vk::get_timestamp_profiler();
+	if (!profiler.is_enabled())
+	{
+		return false;
+	}
+
+	timings = profiler.get_last_frame();
+	return true;
+}
+
+void VKGSRender::get_texture_cache_statistics(rsx::frame_benchmark_stats& stats) const
+{
+	// The texture cache closes its frame when the swap is queued, before the common flip code runs
+	const auto cache_stats = m_texture_cache.get_last_frame_statistics();
+	stats.texture_uploads = cache_stats.num_uploads;
+	stats.texture_upload_bytes = cache_stats.upload_bytes;
+	stats.texture_hits = cache_stats.num_hits;
+	stats.texture_misses = cache_stats.num_misses;
+	stats.texture_flushes = cache_stats.num_flushes;
+	stats.texture_memory = cache_stats.memory_in_use;
+}
+
+void VKGSRender::present_worker::operator()()
+{
+	while (thread_ctrl::state() != thread_state::aborting)
+	{
+		frame_context_t* ctx = nullptr;
+		{
+			std::lock_guard lock(renderer->m_present_queue_mutex);
+
+			if (!renderer->m_present_queue.empty())
+			{
+				ctx = renderer->m_present_queue.front();
+				renderer->m_present_queue.pop_front();
+				renderer->m_presenting_frame = ctx;
+			}
+		}
+
+		if (!ctx)
+		{
+			thread_ctrl::wait();
+			continue;
+		}
+
+		if (renderer->m_present_out_of_date || !renderer->present(ctx))
+		{
+			// The RSX thread recreates the swapchain on its next flip, frames queued until then are dropped
+			renderer->m_present_out_of_date = true;
+			ctx->present_image = UINT32_MAX;
+		}
+
+		std::lock_guard lock(renderer->m_present_queue_mutex);
+		renderer->m_presenting_frame = nullptr;
+	}
+}
+
+void VKGSRender::wait_for_present(frame_context_t *ctx)
+{
+	if (!m_present_thread)
+	{
+		return;
+	}
+
+	while (true)
+	{
+		{
+			reader_lock lock(m_present_queue_mutex);
+
+			const bool pending = ctx ?
+				(m_presenting_frame == ctx || std::find(m_present_queue.begin(), m_present_queue.end(), ctx) != m_present_queue.end()) :
+				(m_presenting_frame != nullptr || !m_present_queue.empty());
+
+			if (!pending)
+			{
+				break;
+			}
+		}
+
+		std::this_thread::yield();
+	}
 }
 
 void VKGSRender::queue_swap_request()
@@ -2191,10 +2697,37 @@ void VKGSRender::queue_swap_request()
 	}
 
 	// Set up a present request for this frame as well
-	present(m_current_frame);
+	if (swapchain_unavailable)
+	{
+		m_current_frame->present_image = UINT32_MAX;
+	}
+	else if (m_present_thread)
+	{
+		{
+			std::lock_guard lock(m_present_queue_mutex);
+			m_present_queue.push_back(m_current_frame);
+		}
+
+		thread_ctrl::notify(*m_present_thread);
+	}
+	else if (!present(m_current_frame))
+	{
+		swapchain_unavailable = true;
+	}
 
 	m_current_frame->swap_command_buffer->pending = true;
 
+	if (m_timestamp_query_pool)
+	{
+		// GPU work completed since the last swap; resolution changes take effect on the next framebuffer setup
+		if (m_dynamic_resolution.on_frame_time(m_gpu_busy_time_us))
+		{
+			m_rtts_dirty = true;
+		}
+
+		m_gpu_busy_time_us = 0;
+	}
+
 	// Grab next cb in line and make it usable
 	m_current_cb_index = (m_current_cb_index + 1) % VK_MAX_ASYNC_CB_COUNT;
 	m_current_command_buffer = &m_primary_cb_list[m_current_cb_index];
@@ -2202,6 +2735,16 @@ void VKGSRender::queue_swap_request()
 
 	// Set up new pointers for the next frame
 	advance_queued_frames();
+
+	if (g_cfg.video.vk.limit_frame_latency)
+	{
+		// Only the frame just submitted stays in flight, the CPU never runs more than a frame ahead of the GPU
+		while (m_queued_frames.size() > 1)
+		{
+			frame_context_cleanup(m_queued_frames.front(), true);
+		}
+	}
+
 	open_command_buffer();
 }
 
@@ -2258,25 +2801,17 @@ void VKGSRender::frame_context_cleanup(frame_context_t *ctx, bool free_resources
 			m_last_heap_sync_time = ctx->last_frame_sync_time;
 
 			//Heap cleanup; deallocates memory consumed by the frame if it is still held
-			m_attrib_ring_info.m_get_pos = ctx->attrib_heap_ptr;
-			m_vertex_env_ring_info.m_get_pos = ctx->vtx_env_heap_ptr;
-			m_fragment_env_ring_info.m_get_pos = ctx->frag_env_heap_ptr;
-			m_fragment_constants_ring_info.m_get_pos = ctx->frag_const_heap_ptr;
-			m_transform_constants_ring_info.m_get_pos = ctx->vtx_const_heap_ptr;
-			m_vertex_layout_ring_info.m_get_pos = ctx->vtx_layout_heap_ptr;
-			m_fragment_texture_params_ring_info.m_get_pos = ctx->frag_texparam_heap_ptr;
-			m_index_buffer_ring_info.m_get_pos = ctx->index_heap_ptr;
-			m_texture_upload_buffer_ring_info.m_get_pos = ctx->texture_upload_heap_ptr;
-
-			m_attrib_ring_info.notify();
-			m_vertex_env_ring_info.notify();
-			m_fragment_env_ring_info.notify();
-			m_fragment_constants_ring_info.notify();
-			m_transform_constants_ring_info.notify();
-			m_vertex_layout_ring_info.notify();
-			m_fragment_texture_params_ring_info.notify();
-			m_index_buffer_ring_info.notify();
-			m_texture_upload_buffer_ring_info.notify();
+			//Heaps grown since the frame was tagged only drop their retired buffers
+			const u64 sync_time = ctx->last_frame_sync_time;
+			m_attrib_ring_info.release(ctx->attrib_heap_ptr, sync_time);
+			m_vertex_env_ring_info.release(ctx->vtx_env_heap_ptr, sync_time);
+			m_fragment_env_ring_info.release(ctx->frag_env_heap_ptr, sync_time);
+			m_fragment_constants_ring_info.release(ctx->frag_const_heap_ptr, sync_time);
+			m_transform_constants_ring_info.release(ctx->vtx_const_heap_ptr, sync_time);
+			m_vertex_layout_ring_info.release(ctx->vtx_layout_heap_ptr, sync_time);
+			m_fragment_texture_params_ring_info.release(ctx->frag_texparam_heap_ptr, sync_time);
+			m_index_buffer_ring_info.release(ctx->index_heap_ptr, sync_time);
+			m_texture_upload_buffer_ring_info.release(ctx->texture_upload_heap_ptr, sync_time);
 		}
 	}
 
@@ -2512,9 +3047,27 @@ bool VKGSRender::load_program()
 	//Load current program from buffer
 	vertex_program.skip_vertex_input_check = true;
 	fragment_program.unnormalized_coords = 0;
+
+	// With emulated depth compare the comparison is a uniform branch on the texture control bits, keep shadow state out of the program key
+	const u16 shadow_textures = fragment_program.shadow_textures;
+	if (!m_device->get_formats_support().d24_unorm_s8)
+	{
+		fragment_program.shadow_textures = 0;
+	}
+
 	m_program = m_prog_buffer->get_graphics_pipeline(vertex_program, fragment_program, properties,
 			!g_cfg.video.disable_asynchronous_shader_compiler, *m_device, pipeline_layout).get();
 
+	m_shader_interpreter_active = false;
+
+	if (!m_program && m_shader_interpreter && !shadow_textures &&
+		m_shader_interpreter->is_supported(vertex_program, current_vp_metadata.referenced_textures_mask, fragment_program, current_fp_metadata.referenced_textures_mask))
+	{
+		// The specialized pipeline is not ready yet, draw with the interpreter instead of skipping the draw
+		m_program = m_shader_interpreter->get_pipeline(properties, *m_device, pipeline_layout);
+		m_shader_interpreter_active = true;
+	}
+
 	vk::leave_uninterruptible();
 
 	if (m_prog_buffer->check_cache_missed())
@@ -2522,7 +3075,8 @@ bool VKGSRender::load_program()
 		if (m_prog_buffer->check_program_linked_flag())
 		{
 			// Program was linked or queued for linking
-			m_shaders_cache->store(properties, vertex_program, fragment_program);
+			m_pipelines_compiled++;
+			m_shaders_cache->store(properties, vertex_program, fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
 		}
 
 		// Notify the user with HUD notification
@@ -2543,6 +3097,11 @@ bool VKGSRender::load_program()
 			}
 		}
 	}
+	else if (m_prog_buffer->check_first_use_flag())
+	{
+		// Feeds the precompilation order of the next boot
+		m_shaders_cache->record_use(properties, vertex_program, fragment_program, u32(std::min<u64>(int_flip_index, UINT32_MAX)));
+	}
 
 	return m_program != nullptr;
 }
@@ -2556,11 +3115,12 @@ void VKGSRender::load_program_env()
 
 	const u32 fragment_constants_size = current_fp_metadata.program_constants_buffer_length;
 
-	const bool update_transform_constants = !!(m_graphics_state & rsx::pipeline_state::transform_constants_dirty);
-	const bool update_fragment_constants = !!(m_graphics_state & rsx::pipeline_state::fragment_constants_dirty);
-	const bool update_vertex_env = !!(m_graphics_state & rsx::pipeline_state::vertex_state_dirty);
-	const bool update_fragment_env = !!(m_graphics_state & rsx::pipeline_state::fragment_state_dirty);
-	const bool update_fragment_texture_env = !!(m_graphics_state & rsx::pipeline_state::fragment_texture_state_dirty);
+	// Blocks left behind in a heap's retired buffer are uploaded again since the retired buffer is freed at the end of the frame
+	const bool update_transform_constants = !!(m_graphics_state & rsx::pipeline_state::transform_constants_dirty) || m_vertex_constants_buffer_info.buffer != m_transform_constants_ring_info.heap->value;
+	const bool update_fragment_constants = !!(m_graphics_state & rsx::pipeline_state::fragment_constants_dirty) || m_fragment_constants_buffer_info.buffer != m_fragment_constants_ring_info.heap->value;
+	const bool update_vertex_env = !!(m_graphics_state & rsx::pipeline_state::vertex_state_dirty) || m_vertex_env_buffer_info.buffer != m_vertex_env_ring_info.heap->value;
+	const bool update_fragment_env = !!(m_graphics_state & rsx::pipeline_state::fragment_state_dirty) || m_fragment_env_buffer_info.buffer != m_fragment_env_ring_info.heap->value;
+	const bool update_fragment_texture_env = !!(m_graphics_state & rsx::pipeline_state::fragment_texture_state_dirty) || m_fragment_texture_params_buffer_info.buffer != m_fragment_texture_params_ring_info.heap->value;
 
 	if (update_vertex_env)
 	{
@@ -2581,7 +3141,30 @@ void VKGSRender::load_program_env()
 		m_vertex_env_buffer_info = { m_vertex_env_ring_info.heap->value, mem, 144 };
 	}
 
-	if (update_transform_constants)
+	if (m_shader_interpreter_active)
+	{
+		// The interpreter reads the ucode from the constant buffers, upload both for every draw
+		check_heap_status(VK_HEAP_CHECK_TRANSFORM_CONSTANTS_STORAGE | VK_HEAP_CHECK_FRAGMENT_CONSTANTS_STORAGE);
+
+		const u32 vertex_buffer_size = vk::shader_interpreter::vertex_program_buffer_size;
+		auto mem = m_transform_constants_ring_info.alloc<256>(vertex_buffer_size);
+		auto buf = static_cast<u8*>(m_transform_constants_ring_info.map(mem, vertex_buffer_size));
+
+		fill_vertex_program_constants_data(buf);
+		m_shader_interpreter->fill_vertex_program_buffer(buf + vk::shader_interpreter::vertex_constants_size, current_vertex_program);
+		m_transform_constants_ring_info.unmap();
+		m_vertex_constants_buffer_info = { m_transform_constants_ring_info.heap->value, mem, vertex_buffer_size };
+
+		const u32 fragment_buffer_size = vk::shader_interpreter::fragment_program_buffer_size;
+		mem = m_fragment_constants_ring_info.alloc<256>(fragment_buffer_size);
+		buf = static_cast<u8*>(m_fragment_constants_ring_info.map(mem, fragment_buffer_size));
+
+		const u32 fragment_data_size = m_shader_interpreter->fill_fragment_program_buffer(buf, current_fragment_program, vk::sanitize_fp_values());
+		m_fragment_constants_ring_info.unmap();
+		m_prog_buffer->on_fragment_constants_alloc(nullptr, (u64)m_fragment_constants_ring_info.heap->value, ::narrow<u32>(mem));
+		m_fragment_constants_buffer_info = { m_fragment_constants_ring_info.heap->value, mem, fragment_data_size };
+	}
+	else if (update_transform_constants)
 	{
 		check_heap_status(VK_HEAP_CHECK_TRANSFORM_CONSTANTS_STORAGE);
 
@@ -2594,21 +3177,40 @@ void VKGSRender::load_program_env()
 		m_vertex_constants_buffer_info = { m_transform_constants_ring_info.heap->value, mem, 8192 };
 	}
 
-	if (update_fragment_constants)
+	if (update_fragment_constants && !m_shader_interpreter_active)
 	{
 		check_heap_status(VK_HEAP_CHECK_FRAGMENT_CONSTANTS_STORAGE);
 
 		// Fragment constants
 		if (fragment_constants_size)
 		{
-			auto mem = m_fragment_constants_ring_info.alloc<256>(fragment_constants_size);
-			auto buf = m_fragment_constants_ring_info.map(mem, fragment_constants_size);
+			const auto heap = m_fragment_constants_ring_info.heap->value;
+			const auto [upload, reuse] = m_prog_buffer->get_fragment_constants_upload(current_fragment_program, (u64)heap, vk::sanitize_fp_values());
 
-			m_prog_buffer->fill_fragment_constants_buffer({ reinterpret_cast<float*>(buf), ::narrow<int>(fragment_constants_size) },
-				current_fragment_program, vk::sanitize_fp_values());
+			if (reuse)
+			{
+				// Same constants as the last upload of this program, still in the ring
+				m_fragment_constants_buffer_info = { heap, upload->offset, fragment_constants_size };
+			}
+			else
+			{
+				auto mem = m_fragment_constants_ring_info.alloc<256>(fragment_constants_size);
+				auto buf = m_fragment_constants_ring_info.map(mem, fragment_constants_size);
 
-			m_fragment_constants_ring_info.unmap();
-			m_fragment_constants_buffer_info = { m_fragment_constants_ring_info.heap->value, mem, fragment_constants_size };
+				if (upload)
+				{
+					std::memcpy(buf, upload->data.data(), fragment_constants_size);
+				}
+				else
+				{
+					m_prog_buffer->fill_fragment_constants_buffer({ reinterpret_cast<float*>(buf), ::narrow<int>(fragment_constants_size) },
+						current_fragment_program, vk::sanitize_fp_values());
+				}
+
+				m_fragment_constants_ring_info.unmap();
+				m_fragment_constants_buffer_info = { heap, mem, fragment_constants_size };
+				m_prog_buffer->on_fragment_constants_alloc(upload, (u64)heap, ::narrow<u32>(mem));
+			}
 		}
 		else
 		{
@@ -2642,34 +3244,50 @@ void VKGSRender::load_program_env()
 
 	//if (1)
 	{
-		m_program->bind_uniform(m_vertex_env_buffer_info, VERTEX_PARAMS_BIND_SLOT, m_current_frame->descriptor_set);
-		m_program->bind_uniform(m_vertex_constants_buffer_info, VERTEX_CONSTANT_BUFFERS_BIND_SLOT, m_current_frame->descriptor_set);
-		m_program->bind_uniform(m_fragment_constants_buffer_info, FRAGMENT_CONSTANT_BUFFERS_BIND_SLOT, m_current_frame->descriptor_set);
-		m_program->bind_uniform(m_fragment_env_buffer_info, FRAGMENT_STATE_BIND_SLOT, m_current_frame->descriptor_set);
-		m_program->bind_uniform(m_fragment_texture_params_buffer_info, FRAGMENT_TEXTURE_PARAMS_BIND_SLOT, m_current_frame->descriptor_set);
+		m_program->bind_uniform(m_vertex_env_buffer_info, VERTEX_PARAMS_BIND_SLOT, m_descriptor_bindings);
+		m_program->bind_uniform(m_vertex_constants_buffer_info, VERTEX_CONSTANT_BUFFERS_BIND_SLOT, m_descriptor_bindings);
+		m_program->bind_uniform(m_fragment_constants_buffer_info, FRAGMENT_CONSTANT_BUFFERS_BIND_SLOT, m_descriptor_bindings);
+		m_program->bind_uniform(m_fragment_env_buffer_info, FRAGMENT_STATE_BIND_SLOT, m_descriptor_bindings);
+		m_program->bind_uniform(m_fragment_texture_params_buffer_info, FRAGMENT_TEXTURE_PARAMS_BIND_SLOT, m_descriptor_bindings);
 	}
 
 	//Clear flags
 	const u32 handled_flags = (rsx::pipeline_state::fragment_state_dirty | rsx::pipeline_state::vertex_state_dirty | rsx::pipeline_state::transform_constants_dirty | rsx::pipeline_state::fragment_constants_dirty | rsx::pipeline_state::fragment_texture_state_dirty);
 	m_graphics_state &= ~handled_flags;
+
+	if (m_shader_interpreter_active)
+	{
+		// The constant buffers now hold interpreter data, the next specialized program needs them uploaded again
+		m_graphics_state |= (rsx::pipeline_state::transform_constants_dirty | rsx::pipeline_state::fragment_constants_dirty);
+	}
 }
 
 void VKGSRender::update_vertex_env(const vk::vertex_upload_info& vertex_info)
 {
-	auto mem = m_vertex_layout_ring_info.alloc<256>(256);
-	auto buf = (u32*)m_vertex_layout_ring_info.map(mem, 128 + 16);
+	std::array<u32, 36> layout_data = {};
+	layout_data[0] = vertex_info.vertex_index_base;
+	layout_data[1] = vertex_info.vertex_index_offset;
 
-	buf[0] = vertex_info.vertex_index_base;
-	buf[1] = vertex_info.vertex_index_offset;
-	buf += 4;
-
-	fill_vertex_layout_state(m_vertex_layout, vertex_info.first_vertex, vertex_info.allocated_vertex_count, (s32*)buf,
+	fill_vertex_layout_state(m_vertex_layout, vertex_info.first_vertex, vertex_info.allocated_vertex_count, (s32*)(layout_data.data() + 4),
 		vertex_info.persistent_window_offset, vertex_info.volatile_window_offset);
 
-	m_vertex_layout_ring_info.unmap();
-	m_vertex_layout_buffer_info = { m_vertex_layout_ring_info.heap->value, mem, 128 + 16 };
+	// An unchanged layout keeps the previous block so that the draw can reuse the previous descriptor set.
+	// Only blocks written into the current command buffer are reused, the ring cannot have recycled those yet
+	if (!m_vertex_layout_data_valid || layout_data != m_vertex_layout_data || m_vertex_layout_buffer_info.buffer != m_vertex_layout_ring_info.heap->value)
+	{
+		auto mem = m_vertex_layout_ring_info.alloc<256>(256);
+		auto buf = m_vertex_layout_ring_info.map(mem, 128 + 16);
+
+		std::memcpy(buf, layout_data.data(), 128 + 16);
 
-	m_program->bind_uniform(m_vertex_layout_buffer_info, VERTEX_LAYOUT_BIND_SLOT, m_current_frame->descriptor_set);
+		m_vertex_layout_ring_info.unmap();
+		m_vertex_layout_buffer_info = { m_vertex_layout_ring_info.heap->value, mem, 128 + 16 };
+
+		m_vertex_layout_data = layout_data;
+		m_vertex_layout_data_valid = true;
+	}
+
+	m_program->bind_uniform(m_vertex_layout_buffer_info, VERTEX_LAYOUT_BIND_SLOT, m_descriptor_bindings);
 }
 
 void VKGSRender::init_buffers(rsx::framebuffer_creation_context context, bool skip_reading)
@@ -2692,6 +3310,8 @@ void VKGSRender::write_buffers()
 
 void VKGSRender::close_and_submit_command_buffer(VkFence fence, VkSemaphore wait_semaphore, VkSemaphore signal_semaphore, VkPipelineStageFlags pipeline_stage_flags)
 {
+	vk::flush_pending_blits();
+
 	if (m_attrib_ring_info.dirty() ||
 		m_fragment_env_ring_info.dirty() ||
 		m_vertex_env_ring_info.dirty() ||
@@ -2702,35 +3322,101 @@ void VKGSRender::close_and_submit_command_buffer(VkFence fence, VkSemaphore wait
 		m_transform_constants_ring_info.dirty() ||
 		m_texture_upload_buffer_ring_info.dirty())
 	{
-		std::lock_guard lock(m_secondary_cb_guard);
-		m_secondary_command_buffer.begin();
+		// The copies only depend on host writes, on a transfer queue they overlap with the graphics work still in flight
+		const bool use_transfer_queue = (m_transfer_semaphore != VK_NULL_HANDLE);
 
-		m_attrib_ring_info.sync(m_secondary_command_buffer);
-		m_fragment_env_ring_info.sync(m_secondary_command_buffer);
-		m_vertex_env_ring_info.sync(m_secondary_command_buffer);
-		m_fragment_texture_params_ring_info.sync(m_secondary_command_buffer);
-		m_vertex_layout_ring_info.sync(m_secondary_command_buffer);
-		m_fragment_constants_ring_info.sync(m_secondary_command_buffer);
-		m_index_buffer_ring_info.sync(m_secondary_command_buffer);
-		m_transform_constants_ring_info.sync(m_secondary_command_buffer);
-		m_texture_upload_buffer_ring_info.sync(m_secondary_command_buffer);
+		std::unique_lock lock(m_secondary_cb_guard, std::defer_lock);
+		if (!use_transfer_queue)
+		{
+			lock.lock();
+		}
+
+		auto& cmd = use_transfer_queue ? m_transfer_command_buffer : m_secondary_command_buffer;
+		cmd.begin();
+
+		m_attrib_ring_info.sync(cmd);
+		m_fragment_env_ring_info.sync(cmd);
+		m_vertex_env_ring_info.sync(cmd);
+		m_fragment_texture_params_ring_info.sync(cmd);
+		m_vertex_layout_ring_info.sync(cmd);
+		m_fragment_constants_ring_info.sync(cmd);
+		m_index_buffer_ring_info.sync(cmd);
+		m_transform_constants_ring_info.sync(cmd);
+		m_texture_upload_buffer_ring_info.sync(cmd);
+
+		cmd.end();
+
+		if (use_transfer_queue)
+		{
+			cmd.submit(m_device->get_transfer_queue(), VK_NULL_HANDLE, m_transfer_semaphore, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+			m_current_command_buffer->add_wait_semaphore(m_transfer_semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+		else
+		{
+			cmd.submit(m_swapchain->get_graphics_queue(),
+				VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		}
+	}
 
-		m_secondary_command_buffer.end();
+	if (m_current_command_buffer->flags & vk::command_buffer::cb_has_occlusion_task)
+	{
+		// Results of every query ended in this command buffer become readable from the host once its fence signals
+		m_occlusion_query_pool.copy_results(*m_current_command_buffer);
+	}
 
-		m_secondary_command_buffer.submit(m_swapchain->get_graphics_queue(),
-			VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	if (m_timestamp_query_pool)
+	{
+		vkCmdWriteTimestamp(*m_current_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_query_pool, m_current_cb_index * 2 + 1);
 	}
 
+	vk::get_timestamp_profiler().end_command_buffer();
+
 	m_current_command_buffer->end();
 	m_current_command_buffer->tag();
 
+	// The submit thread polls the fence of the command buffer for the RSX thread
+	const bool async_fence = m_submit_queue && fence == m_current_command_buffer->submit_fence;
+	m_current_command_buffer->async_fence = async_fence;
+
 	m_current_command_buffer->submit(m_swapchain->get_graphics_queue(),
-		wait_semaphore, signal_semaphore, fence, pipeline_stage_flags);
+		wait_semaphore, signal_semaphore, fence, pipeline_stage_flags, async_fence ? &m_current_command_buffer->fence_signaled : nullptr);
+
+	// Any readback recorded before this point is now in flight on the GPU
+	m_last_submit_timestamp = get_system_time();
 }
 
 void VKGSRender::open_command_buffer()
 {
 	m_current_command_buffer->begin();
+	m_vertex_layout_data_valid = false;
+	m_prog_buffer->on_fragment_constants_barrier();
+
+	if (m_command_recorder)
+	{
+		// The primary has been waited on, so have the secondaries it executed
+		m_command_recorder->recycle(m_current_cb_index);
+	}
+
+	if (m_timestamp_query_pool)
+	{
+		const u32 first_query = m_current_cb_index * 2;
+		if (m_timestamp_written[m_current_cb_index])
+		{
+			// The previous submission of this cb has been waited on by reset(); its timestamps should be ready
+			u64 timestamps[2];
+			if (vkGetQueryPoolResults(*m_device, m_timestamp_query_pool, first_query, 2, sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS &&
+				timestamps[1] > timestamps[0])
+			{
+				m_gpu_busy_time_us += u64((timestamps[1] - timestamps[0]) * m_timestamp_period / 1000.);
+			}
+		}
+
+		vkCmdResetQueryPool(*m_current_command_buffer, m_timestamp_query_pool, first_query, 2);
+		vkCmdWriteTimestamp(*m_current_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_query_pool, first_query);
+		m_timestamp_written[m_current_cb_index] = true;
+	}
+
+	vk::get_timestamp_profiler().begin_command_buffer(*m_current_command_buffer, m_current_cb_index);
 }
 
 void VKGSRender::prepare_rtts(rsx::framebuffer_creation_context context)
@@ -2761,6 +3447,20 @@ void VKGSRender::prepare_rtts(rsx::framebuffer_creation_context context)
 		return;
 	}
 
+	// Clears deferred on the current surfaces can no longer be folded into a render pass
+	for (auto &rtt : m_rtts.m_bound_render_targets)
+	{
+		if (auto surface = std::get<1>(rtt))
+		{
+			surface->flush_pending_clear(*m_current_command_buffer);
+		}
+	}
+
+	if (auto ds = std::get<1>(m_rtts.m_bound_depth_stencil))
+	{
+		ds->flush_pending_clear(*m_current_command_buffer);
+	}
+
 	m_rtts.prepare_render_target(*m_current_command_buffer,
 		layout.color_format, layout.depth_format,
 		layout.width, layout.height,
@@ -2952,6 +3652,9 @@ void VKGSRender::reinitialize_swapchain()
 		return;
 	}
 
+	// Queued presents still reference the old swapchain images
+	wait_for_present();
+
 	// NOTE: This operation will create a hard sync point
 	close_and_submit_command_buffer(m_current_command_buffer->submit_fence);
 	m_current_command_buffer->pending = true;
@@ -2967,6 +3670,7 @@ void VKGSRender::reinitialize_swapchain()
 	}
 
 	// Drain all the queues
+	vk::flush_submit_queue();
 	vkDeviceWaitIdle(*m_device);
 
 	// Rebuild swapchain. Old swapchain destruction is handled by the init_swapchain call
@@ -3013,6 +3717,14 @@ void VKGSRender::reinitialize_swapchain()
 
 void VKGSRender::flip(int buffer, bool emu_flip)
 {
+	vk::flush_pending_blits();
+
+	if (m_present_out_of_date.exchange(false))
+	{
+		wait_for_present();
+		swapchain_unavailable = true;
+	}
+
 	// Check swapchain condition/status
 	if (!m_swapchain->supports_automatic_wm_reports())
 	{
@@ -3055,15 +3767,16 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 		frame_context_cleanup(m_current_frame, true);
 	}
 
-	if (skip_frame || swapchain_unavailable)
+	// The flip below decides whether the next frame is skipped, the current frame's state has to be captured first
+	const bool frame_skipped = skip_frame;
+
+	if (skip_frame || skip_present || swapchain_unavailable)
 	{
 		m_frame->flip(m_context);
 		rsx::thread::flip(buffer, emu_flip);
 
-		if (!skip_frame)
+		if (!frame_skipped)
 		{
-			verify(HERE), swapchain_unavailable;
-
 			// Perform a mini-flip here without invoking present code
 			m_current_frame->swap_command_buffer = m_current_command_buffer;
 			flush_command_queue(true);
@@ -3126,6 +3839,7 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 	aspect_ratio.size = new_size;
 
 	//Prepare surface for new frame. Set no timeout here so that we wait for the next image if need be
+	wait_for_present(m_current_frame);
 	verify(HERE), m_current_frame->present_image == UINT32_MAX;
 	verify(HERE), m_current_frame->swap_command_buffer == nullptr;
 
@@ -3187,6 +3901,8 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 
 			if (image_to_flip)
 			{
+				render_target_texture->flush_pending_clear(*m_current_command_buffer);
+
 				buffer_width = rsx::apply_resolution_scale(buffer_width, true);
 				buffer_height = rsx::apply_resolution_scale(buffer_height, true);
 
@@ -3240,6 +3956,8 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 	VkImage target_image = m_swapchain->get_image(m_current_frame->present_image);
 	const auto present_layout = m_swapchain->get_optimal_present_layout();
 
+	const bool present_profiled = vk::get_timestamp_profiler().begin_scope(*m_current_command_buffer, rsx::gpu_timer_category::present);
+
 	if (image_to_flip)
 	{
 		VkImageLayout target_layout = present_layout;
@@ -3273,9 +3991,16 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 		vk::change_image_layout(*m_current_command_buffer, target_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, present_layout, range);
 	}
 
+	if (present_profiled)
+	{
+		vk::get_timestamp_profiler().end_scope();
+	}
+
 	const bool has_overlay = (m_overlay_manager && m_overlay_manager->has_visible());
 	if (g_cfg.video.overlay || has_overlay)
 	{
+		vk::gpu_profiler_scope profiler_scope(*m_current_command_buffer, rsx::gpu_timer_category::overlay);
+
 		//Change the image layout whilst setting up a dependency on waiting for the blit op to finish before we start writing
 		VkImageSubresourceRange subres = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
 		VkImageMemoryBarrier barrier = {};
@@ -3318,9 +4043,11 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0,  72, direct_fbo->width(), direct_fbo->height(), fmt::format("texture upload time: %8dus", m_textures_upload_time));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0,  90, direct_fbo->width(), direct_fbo->height(), fmt::format("draw call execution: %8dus", m_draw_time));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 108, direct_fbo->width(), direct_fbo->height(), fmt::format("submit and flip: %12dus", m_flip_time));
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 126, direct_fbo->width(), direct_fbo->height(), fmt::format("Render passes: %14d  (%d clear(s) folded)", m_render_passes_this_frame, m_folded_clears_this_frame));
 
 			const auto num_dirty_textures = m_texture_cache.get_unreleased_textures_count();
 			const auto texture_memory_size = m_texture_cache.get_texture_memory_in_use() / (1024 * 1024);
+			const auto texture_memory_budget = m_texture_cache.get_memory_budget() / (1024 * 1024);
 			const auto tmp_texture_memory_size = m_texture_cache.get_temporary_memory_in_use() / (1024 * 1024);
 			const auto num_flushes = m_texture_cache.get_num_flush_requests();
 			const auto num_mispredict = m_texture_cache.get_num_cache_mispredictions();
@@ -3329,9 +4056,17 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 			const auto num_unavoidable = m_texture_cache.get_num_unavoidable_hard_faults();
 			const auto cache_miss_ratio = (u32)ceil(m_texture_cache.get_cache_miss_ratio() * 100);
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 144, direct_fbo->width(), direct_fbo->height(), fmt::format("Unreleased textures: %8d", num_dirty_textures));
-			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 162, direct_fbo->width(), direct_fbo->height(), fmt::format("Texture cache memory: %7dM", texture_memory_size));
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 162, direct_fbo->width(), direct_fbo->height(), texture_memory_budget ?
+				fmt::format("Texture cache memory: %7dM / %dM", texture_memory_size, texture_memory_budget) : fmt::format("Texture cache memory: %7dM", texture_memory_size));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 180, direct_fbo->width(), direct_fbo->height(), fmt::format("Temporary texture memory: %3dM", tmp_texture_memory_size));
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 198, direct_fbo->width(), direct_fbo->height(), fmt::format("Flush requests: %13d  = %2d (%3d%%) hard faults, %2d unavoidable, %2d misprediction(s), %2d speculation(s)", num_flushes, num_misses, cache_miss_ratio, num_unavoidable, num_mispredict, num_speculate));
+
+			const auto stats = m_texture_cache.get_frame_statistics();
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 216, direct_fbo->width(), direct_fbo->height(), fmt::format("Texture lookups: %12d  = %d hit(s), %d miss(es), %d section(s) alive", stats.num_hits + stats.num_misses, stats.num_hits, stats.num_misses, stats.num_sections));
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 234, direct_fbo->width(), direct_fbo->height(), fmt::format("Texture uploads: %12d  (%dK), flushed %dK in %dus", stats.num_uploads, stats.upload_bytes / 1024, stats.flush_bytes / 1024, stats.flush_stall_time));
+
+			const auto& resolve_stats = vk::get_resolve_statistics();
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 252, direct_fbo->width(), direct_fbo->height(), fmt::format("MSAA resolves: %14d  (%d avoided), %d unresolve(s) (%d avoided)", resolve_stats.num_resolves, resolve_stats.num_resolves_avoided, resolve_stats.num_unresolves, resolve_stats.num_unresolves_avoided));
 		}
 
 		vk::change_image_layout(*m_current_command_buffer, target_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, present_layout, subres);
@@ -3349,6 +4084,13 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 	m_frame->flip(m_context);
 	rsx::thread::flip(buffer, emu_flip);
 
+	// Intervals read back during this frame, they belong to frames that completed on the GPU a few flips ago
+	auto& profiler = vk::get_timestamp_profiler();
+	if (profiler.is_enabled())
+	{
+		profiler.on_frame_end();
+	}
+
 	//Do not reset perf counters if we are skipping the next frame
 	if (skip_frame) return;
 
@@ -3356,6 +4098,9 @@ void VKGSRender::flip(int buffer, bool emu_flip)
 	m_setup_time = 0;
 	m_vertex_upload_time = 0;
 	m_textures_upload_time = 0;
+	m_render_passes_this_frame = 0;
+	m_folded_clears_this_frame = 0;
+	vk::get_resolve_statistics() = {};
 }
 
 bool VKGSRender::scaled_image_from_memory(rsx::blit_src_info& src, rsx::blit_dst_info& dst, bool interpolate)
@@ -3366,6 +4111,8 @@ bool VKGSRender::scaled_image_from_memory(rsx::blit_src_info& src, rsx::blit_dst
 	// Verify enough memory exists before attempting to handle data transfer
 	check_heap_status(VK_HEAP_CHECK_TEXTURE_UPLOAD_STORAGE);
 
+	vk::gpu_profiler_scope profiler_scope(*m_current_command_buffer, rsx::gpu_timer_category::texture_cache);
+
 	if (m_texture_cache.blit(src, dst, interpolate, m_rtts, *m_current_command_buffer))
 	{
 		m_samplers_dirty.store(true);
@@ -3460,15 +4207,10 @@ void VKGSRender::get_occlusion_query_result(rsx::reports::occlusion_query_info*
 		if (data.command_buffer_to_wait->pending)
 			data.command_buffer_to_wait->wait(GENERAL_WAIT_TIMEOUT);
 
-		//Gather data
-		for (const auto occlusion_id : data.indices)
+		//Gather data, the results were copied to host memory by the command buffers that were waited on
+		if (m_occlusion_query_pool.get_query_result(data.indices))
 		{
-			//We only need one hit
-			if (auto value = m_occlusion_query_pool.get_query_result(occlusion_id))
-			{
-				query->result = 1;
-				break;
-			}
+			query->result = 1;
 		}
 	}
 
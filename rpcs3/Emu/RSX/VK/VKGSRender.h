@@ -7,7 +7,12 @@
 #include "VKTextOut.h"
 #include "VKOverlays.h"
 #include "VKProgramBuffer.h"
+#include "VKShaderInterpreter.h"
 #include "VKFramebuffer.h"
+#include "VKCommandRecorder.h"
+#include "VKSubmitQueue.h"
+#include "VKDescriptors.h"
+#include "VKProfiler.h"
 #include "../GCM.h"
 #include "../rsx_utils.h"
 #include <thread>
@@ -18,6 +23,7 @@ namespace vk
 	using vertex_cache = rsx::vertex_cache::default_vertex_cache<rsx::vertex_cache::uploaded_range<VkFormat>, VkFormat>;
 	using weak_vertex_cache = rsx::vertex_cache::weak_vertex_cache<VkFormat>;
 	using null_vertex_cache = vertex_cache;
+	using persistent_vertex_cache = rsx::vertex_cache::persistent_vertex_cache<VkFormat>;
 
 	using shader_cache = rsx::shaders_cache<vk::pipeline_props, VKProgramBuffer>;
 
@@ -74,6 +80,10 @@ struct command_buffer_chunk: public vk::command_buffer
 	std::atomic<u64> last_sync = { 0 };
 	shared_mutex guard_mutex;
 
+	// With asynchronous submission the submit thread polls submit_fence and reports completion here
+	atomic_t<bool> fence_signaled{ false };
+	bool async_fence = false;
+
 	command_buffer_chunk() = default;
 
 	void init_fence(VkDevice dev)
@@ -116,7 +126,7 @@ struct command_buffer_chunk: public vk::command_buffer
 		if (!pending)
 			return true;
 
-		if (vkGetFenceStatus(m_device, submit_fence) == VK_SUCCESS)
+		if (async_fence ? fence_signaled.load() : vkGetFenceStatus(m_device, submit_fence) == VK_SUCCESS)
 		{
 			lock.upgrade();
 
@@ -139,6 +149,20 @@ struct command_buffer_chunk: public vk::command_buffer
 
 		const auto ret = vk::wait_for_fence(submit_fence, timeout);
 
+		if (async_fence)
+		{
+			if (ret != VK_SUCCESS)
+			{
+				// Still polled by the submit thread, it cannot be reset yet
+				return ret;
+			}
+
+			while (!fence_signaled)
+			{
+				std::this_thread::yield();
+			}
+		}
+
 		lock.upgrade();
 
 		if (pending)
@@ -166,11 +190,12 @@ struct frame_context_t
 {
 	VkSemaphore acquire_signal_semaphore = VK_NULL_HANDLE;
 	VkSemaphore present_wait_semaphore = VK_NULL_HANDLE;
-	VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
-
 	vk::descriptor_pool descriptor_pool;
 	u32 used_descriptors = 0;
 
+	// Sets allocated from descriptor_pool, keyed by the resources written to them
+	std::unordered_map<vk::descriptor_bindings, VkDescriptorSet, vk::descriptor_bindings::hasher> descriptor_set_cache;
+
 	flags32_t flags = 0;
 
 	std::vector<std::unique_ptr<vk::buffer_view>> buffer_views_to_clean;
@@ -196,9 +221,9 @@ struct frame_context_t
 	{
 		present_wait_semaphore = other.present_wait_semaphore;
 		acquire_signal_semaphore = other.acquire_signal_semaphore;
-		descriptor_set = other.descriptor_set;
 		descriptor_pool = other.descriptor_pool;
 		used_descriptors = other.used_descriptors;
+		descriptor_set_cache = other.descriptor_set_cache;
 		flags = other.flags;
 
 		attrib_heap_ptr = other.attrib_heap_ptr;
@@ -384,11 +409,16 @@ private:
 public:
 	//vk::fbo draw_fbo;
 	std::unique_ptr<vk::vertex_cache> m_vertex_cache;
+	std::unique_ptr<vk::persistent_vertex_cache> m_persistent_vertex_cache;
 	std::unique_ptr<vk::shader_cache> m_shaders_cache;
 
 private:
 	std::unique_ptr<VKProgramBuffer> m_prog_buffer;
 
+	// Fallback used while the pipeline for the current program pair is being compiled
+	std::unique_ptr<vk::shader_interpreter> m_shader_interpreter;
+	bool m_shader_interpreter_active = false;
+
 	std::unique_ptr<vk::swapchain_base> m_swapchain;
 	vk::context m_thread_context;
 	vk::render_device *m_device;
@@ -400,15 +430,35 @@ private:
 	rsx::reports::occlusion_query_info *m_active_query_info = nullptr;
 	std::unordered_map<u32, occlusion_data> m_occlusion_map;
 
+	//GPU frame timing (dynamic resolution scaling)
+	VkQueryPool m_timestamp_query_pool = VK_NULL_HANDLE;
+	std::array<bool, VK_MAX_ASYNC_CB_COUNT> m_timestamp_written = {};
+	f64 m_timestamp_period = 1.;
+	u64 m_gpu_busy_time_us = 0;
+	rsx::dynamic_resolution_controller m_dynamic_resolution;
+
 	shared_mutex m_secondary_cb_guard;
 	vk::command_pool m_secondary_command_buffer_pool;
 	vk::command_buffer m_secondary_command_buffer;  //command buffer used for setup operations
 
+	// Ring buffer staging copies on the dedicated transfer queue, unused if the device has none
+	vk::command_pool m_transfer_command_buffer_pool;
+	vk::command_buffer m_transfer_command_buffer;
+	VkSemaphore m_transfer_semaphore = VK_NULL_HANDLE;
+
+	// Records large draw clauses on helper threads, null when disabled
+	std::unique_ptr<vk::command_recorder> m_command_recorder;
+	vk::draw_state m_draw_state;
+
 	u32 m_current_cb_index = 0;
 	std::array<command_buffer_chunk, VK_MAX_ASYNC_CB_COUNT> m_primary_cb_list;
 	command_buffer_chunk* m_current_command_buffer = nullptr;
 
 	VkDescriptorSetLayout descriptor_layouts;
+
+	// Resources bound for the next draw, written to a cached set or pushed when it is emitted
+	vk::descriptor_bindings m_descriptor_bindings;
+	vk::descriptor_writer m_descriptor_writer;
 	VkPipelineLayout pipeline_layout;
 
 	vk::framebuffer_holder* m_draw_fbo = nullptr;
@@ -417,9 +467,15 @@ private:
 	bool swapchain_unavailable = false;
 
 	u64 m_last_heap_sync_time = 0;
+
+	// Device-local memory over all heaps, sampled at frame boundaries
+	std::vector<vk::memory_heap_usage> m_memory_heaps;
+	atomic_t<u64> m_device_local_usage{ 0 };
+	atomic_t<u64> m_device_local_budget{ 0 };
 	u32 m_texbuffer_view_size = 0;
 
 	vk::data_heap m_attrib_ring_info;                  // Vertex data
+	std::unique_ptr<vk::buffer> m_vertex_cache_storage; // Vertex data kept by the persistent vertex cache
 	vk::data_heap m_fragment_constants_ring_info;      // Fragment program constants
 	vk::data_heap m_transform_constants_ring_info;     // Transform program constants
 	vk::data_heap m_fragment_env_ring_info;            // Fragment environment params
@@ -434,6 +490,10 @@ private:
 	VkDescriptorBufferInfo m_vertex_constants_buffer_info;
 	VkDescriptorBufferInfo m_fragment_constants_buffer_info;
 	VkDescriptorBufferInfo m_vertex_layout_buffer_info;
+
+	// Contents of the block at m_vertex_layout_buffer_info, valid until the command buffer is closed
+	std::array<u32, 36> m_vertex_layout_data = {};
+	bool m_vertex_layout_data_valid = false;
 	VkDescriptorBufferInfo m_fragment_texture_params_buffer_info;
 
 	std::array<frame_context_t, VK_MAX_ASYNC_FRAMES> frame_context_storage;
@@ -444,6 +504,23 @@ private:
 	frame_context_t* m_current_frame = nullptr;
 	std::deque<frame_context_t*> m_queued_frames;
 
+	// Presents submitted frames in order so that a blocking vkQueuePresentKHR does not stall the RSX thread
+	struct present_worker
+	{
+		VKGSRender* renderer;
+
+		void operator()();
+	};
+
+	shared_mutex m_present_queue_mutex;
+	std::deque<frame_context_t*> m_present_queue;
+	frame_context_t* m_presenting_frame = nullptr;
+	atomic_t<bool> m_present_out_of_date{ false };
+	std::unique_ptr<named_thread<present_worker>> m_present_thread;
+
+	// Routes all queue submissions through a dedicated thread while it exists
+	std::unique_ptr<vk::submit_queue> m_submit_queue;
+
 	VkViewport m_viewport{};
 	VkRect2D m_scissor{};
 
@@ -460,8 +537,18 @@ private:
 	flush_request_task m_flush_requests;
 
 	std::atomic<u64> m_last_sync_event = { 0 };
+	std::atomic<u64> m_last_submit_timestamp = { 0 };
 
 	bool m_render_pass_open = false;
+	bool m_render_pass_profiled = false;
+
+	// Deferred clears of the bound surfaces picked up by the next begin_render_pass, indexed like m_fbo_images
+	u32 m_pass_clear_mask = 0;
+	std::array<VkClearValue, rsx::limits::color_buffers_count + 1> m_pass_clear_values = {};
+
+	// Render pass usage since the last flip
+	u32 m_render_passes_this_frame = 0;
+	u32 m_folded_clears_this_frame = 0;
 	u64  m_current_renderpass_key = 0;
 	VkRenderPass m_cached_renderpass = VK_NULL_HANDLE;
 	std::vector<vk::image*> m_fbo_images;
@@ -493,19 +580,24 @@ private:
 	void queue_swap_request();
 	void frame_context_cleanup(frame_context_t *ctx, bool free_resources = false);
 	void advance_queued_frames();
-	void present(frame_context_t *ctx);
+	bool present(frame_context_t *ctx);
+	bool update_memory_usage();
+	void wait_for_present(frame_context_t *ctx = nullptr);
 	void reinitialize_swapchain();
 
-	void begin_render_pass();
+	void consume_deferred_clears();
+	void begin_render_pass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void close_render_pass();
 
 	void update_draw_state();
 
 	void check_heap_status(u32 flags = VK_HEAP_CHECK_ALL);
+	bool grow_critical_heaps();
 	void check_present_status();
 
 	void check_descriptors();
 	VkDescriptorSet allocate_descriptor_set();
+	VkDescriptorSet get_descriptor_set();
 
 	vk::vertex_upload_info upload_vertex_data();
 
@@ -519,7 +611,6 @@ public:
 	void write_buffers();
 	void set_viewport();
 	void set_scissor();
-	void bind_viewport();
 
 	void sync_hint(rsx::FIFO_hint hint) override;
 
@@ -529,6 +620,10 @@ public:
 	void get_occlusion_query_result(rsx::reports::occlusion_query_info* query) override;
 	void discard_occlusion_query(rsx::reports::occlusion_query_info* query) override;
 
+	std::pair<u64, u64> get_video_memory_usage() const override;
+	bool get_gpu_frame_timings(rsx::gpu_frame_timings& timings) const override;
+	void get_texture_cache_statistics(rsx::frame_benchmark_stats& stats) const override;
+
 protected:
 	void begin() override;
 	void end() override;
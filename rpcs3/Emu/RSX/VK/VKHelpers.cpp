@@ -22,6 +22,33 @@ namespace vk
 
 	VkSampler g_null_sampler = nullptr;
 
+	VkPipelineCache g_pipeline_cache = VK_NULL_HANDLE;
+	std::string g_pipeline_cache_path;
+
+	// Prepended to the driver blob on disk. The driver's own header does not carry the driver version,
+	// and some drivers crash on stale blobs instead of rejecting them, so they are filtered here first.
+	struct pipeline_cache_file_header
+	{
+		u32 magic;
+		u32 vendor_id;
+		u32 device_id;
+		u32 driver_version;
+		u8 cache_uuid[16];
+		u64 data_size;
+	};
+
+	// Layout of the header every driver places at the start of its pipeline cache data
+	struct pipeline_cache_blob_header
+	{
+		u32 header_size;
+		u32 header_version;
+		u32 vendor_id;
+		u32 device_id;
+		u8 cache_uuid[16];
+	};
+
+	constexpr u32 pipeline_cache_magic = "RVPC"_u32;
+
 	atomic_t<bool> g_cb_no_interrupt_flag { false };
 
 	// Driver compatibility workarounds
@@ -241,9 +268,143 @@ namespace vk
 		vk::reset_resolve_resources();
 	}
 
+	static bool is_pipeline_cache_compatible(const VkPhysicalDeviceProperties& props, const pipeline_cache_file_header& header, const std::vector<u8>& data)
+	{
+		if (header.magic != pipeline_cache_magic ||
+			header.vendor_id != props.vendorID ||
+			header.device_id != props.deviceID ||
+			header.driver_version != props.driverVersion ||
+			std::memcmp(header.cache_uuid, props.pipelineCacheUUID, sizeof(header.cache_uuid)) != 0)
+		{
+			return false;
+		}
+
+		if (data.size() != header.data_size || data.size() < sizeof(pipeline_cache_blob_header))
+		{
+			return false;
+		}
+
+		pipeline_cache_blob_header blob;
+		std::memcpy(&blob, data.data(), sizeof(blob));
+
+		return blob.header_size >= sizeof(blob) &&
+			blob.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			blob.vendor_id == props.vendorID &&
+			blob.device_id == props.deviceID &&
+			std::memcmp(blob.cache_uuid, props.pipelineCacheUUID, sizeof(blob.cache_uuid)) == 0;
+	}
+
+	void create_pipeline_cache(const render_device& dev, const std::string& path)
+	{
+		verify(HERE), g_pipeline_cache == VK_NULL_HANDLE;
+
+		const auto& props = dev.gpu().get_properties();
+		std::vector<u8> initial_data;
+
+		if (!path.empty())
+		{
+			if (fs::file f{ path })
+			{
+				pipeline_cache_file_header header = {};
+				if (f.read(header) && header.data_size <= f.size())
+				{
+					f.read(initial_data, header.data_size);
+				}
+
+				if (!is_pipeline_cache_compatible(props, header, initial_data))
+				{
+					LOG_NOTICE(RSX, "Discarding Vulkan pipeline cache '%s' created by a different device or driver", path);
+					initial_data.clear();
+				}
+			}
+		}
+
+		VkPipelineCacheCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = initial_data.size();
+		info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+		if (vkCreatePipelineCache(dev, &info, nullptr, &g_pipeline_cache) != VK_SUCCESS && !initial_data.empty())
+		{
+			// Driver rejected the blob; start from an empty cache instead
+			LOG_WARNING(RSX, "Vulkan pipeline cache '%s' was rejected by the driver", path);
+			info.initialDataSize = 0;
+			info.pInitialData = nullptr;
+			CHECK_RESULT(vkCreatePipelineCache(dev, &info, nullptr, &g_pipeline_cache));
+		}
+
+		if (!initial_data.empty())
+		{
+			LOG_NOTICE(RSX, "Loaded %u bytes of Vulkan pipeline cache data", (u32)initial_data.size());
+		}
+
+		g_pipeline_cache_path = path;
+	}
+
+	static void save_pipeline_cache(const render_device& dev)
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(dev, g_pipeline_cache, &size, nullptr) != VK_SUCCESS || !size)
+		{
+			return;
+		}
+
+		std::vector<u8> data(size);
+		if (vkGetPipelineCacheData(dev, g_pipeline_cache, &size, data.data()) != VK_SUCCESS)
+		{
+			LOG_ERROR(RSX, "Failed to retrieve Vulkan pipeline cache data");
+			return;
+		}
+
+		data.resize(size);
+
+		const auto& props = dev.gpu().get_properties();
+		pipeline_cache_file_header header = {};
+		header.magic = pipeline_cache_magic;
+		header.vendor_id = props.vendorID;
+		header.device_id = props.deviceID;
+		header.driver_version = props.driverVersion;
+		header.data_size = size;
+		std::memcpy(header.cache_uuid, props.pipelineCacheUUID, sizeof(header.cache_uuid));
+
+		// Write to a temporary file first so an interrupted save cannot leave a truncated cache behind
+		fs::create_path(fs::get_parent_dir(g_pipeline_cache_path));
+
+		const std::string tmp_path = g_pipeline_cache_path + ".tmp";
+		if (fs::file f{ tmp_path, fs::rewrite })
+		{
+			f.write(header);
+			f.write(data.data(), data.size());
+			f.close();
+
+			if (!fs::rename(tmp_path, g_pipeline_cache_path, true))
+			{
+				LOG_ERROR(RSX, "Failed to write Vulkan pipeline cache '%s' (%s)", g_pipeline_cache_path, fs::g_tls_error);
+			}
+		}
+	}
+
+	VkPipelineCache get_pipeline_cache()
+	{
+		return g_pipeline_cache;
+	}
+
 	void destroy_global_resources()
 	{
 		VkDevice dev = *g_current_renderer;
+
+		if (g_pipeline_cache)
+		{
+			if (!g_pipeline_cache_path.empty())
+			{
+				save_pipeline_cache(*g_current_renderer);
+			}
+
+			vkDestroyPipelineCache(dev, g_pipeline_cache, nullptr);
+			g_pipeline_cache = VK_NULL_HANDLE;
+			g_pipeline_cache_path.clear();
+		}
+
 		vk::clear_renderpass_cache(dev);
 		vk::clear_framebuffer_cache();
 		vk::clear_resolve_helpers();
@@ -255,6 +416,8 @@ namespace vk
 		g_typeless_textures.clear();
 		g_deleted_typeless_textures.clear();
 
+		vk::discard_pending_blits();
+
 		if (g_null_sampler)
 		{
 			vkDestroySampler(dev, g_null_sampler, nullptr);
@@ -121,6 +121,10 @@ namespace vk
 	image* get_typeless_helper(VkFormat format, u32 requested_width, u32 requested_height);
 	buffer* get_scratch_buffer();
 
+	// Driver pipeline cache shared by all pipeline creation, persisted across runs when a path is given
+	VkPipelineCache get_pipeline_cache();
+	void create_pipeline_cache(const render_device& dev, const std::string& path);
+
 	memory_type_mapping get_memory_mapping(const physical_device& dev);
 	gpu_formats_support get_optimal_tiling_supported_formats(const physical_device& dev);
 
@@ -128,6 +132,11 @@ namespace vk
 	void acquire_global_submit_lock();
 	void release_global_submit_lock();
 
+	// Submits directly or hands the submission to the submit thread if one exists (see VKSubmitQueue.h)
+	void queue_submit(VkQueue queue, const VkSubmitInfo& info, VkFence fence, atomic_t<bool>* fence_signaled = nullptr);
+	// Returns once every submission queued so far has reached the driver, required before presenting or idling a queue
+	void flush_submit_queue();
+
 	template<class T>
 	T* get_compute_task();
 	void reset_compute_tasks();
@@ -213,6 +222,13 @@ namespace vk
 		bool allow_int8;
 	};
 
+	struct memory_heap_usage
+	{
+		u64 usage;   // Bytes in use; process-wide with VK_EXT_memory_budget, otherwise only what the allocator handed out
+		u64 budget;  // Bytes the process can use before allocations fail or spill to another heap
+		bool device_local;
+	};
+
 	// Memory Allocator - base class
 
 	class mem_allocator_base
@@ -232,6 +248,9 @@ namespace vk
 		virtual VkDeviceMemory get_vk_device_memory(mem_handle_t mem_handle) = 0;
 		virtual u64 get_vk_device_memory_offset(mem_handle_t mem_handle) = 0;
 
+		// Bytes allocated from a memory heap, 0 if the allocator does not track it
+		virtual u64 get_heap_allocated_size(u32 /*heap_index*/) { return 0; }
+
 	protected:
 		VkDevice m_device;
 	private:
@@ -250,6 +269,14 @@ namespace vk
 			allocatorInfo.device = dev;
 
 			vmaCreateAllocator(&allocatorInfo, &m_allocator);
+
+			VkPhysicalDeviceMemoryProperties memory_properties;
+			vkGetPhysicalDeviceMemoryProperties(pdev, &memory_properties);
+
+			for (u32 i = 0; i < memory_properties.memoryTypeCount; ++i)
+			{
+				m_type_heap_index[i] = memory_properties.memoryTypes[i].heapIndex;
+			}
 		}
 
 		~mem_allocator_vma() override = default;
@@ -269,12 +296,20 @@ namespace vk
 			mem_req.size = block_sz;
 			mem_req.alignment = alignment;
 			create_info.memoryTypeBits = 1u << memory_type_index;
-			CHECK_RESULT(vmaAllocateMemory(m_allocator, &mem_req, &create_info, &vma_alloc, nullptr));
+
+			VmaAllocationInfo alloc_info;
+			CHECK_RESULT(vmaAllocateMemory(m_allocator, &mem_req, &create_info, &vma_alloc, &alloc_info));
+
+			m_heap_usage[m_type_heap_index[alloc_info.memoryType]] += alloc_info.size;
 			return vma_alloc;
 		}
 
 		void free(mem_handle_t mem_handle) override
 		{
+			VmaAllocationInfo alloc_info;
+			vmaGetAllocationInfo(m_allocator, static_cast<VmaAllocation>(mem_handle), &alloc_info);
+			m_heap_usage[m_type_heap_index[alloc_info.memoryType]] -= alloc_info.size;
+
 			vmaFreeMemory(m_allocator, static_cast<VmaAllocation>(mem_handle));
 		}
 
@@ -310,8 +345,15 @@ namespace vk
 			return alloc_info.offset;
 		}
 
+		u64 get_heap_allocated_size(u32 heap_index) override
+		{
+			return m_heap_usage[heap_index];
+		}
+
 	private:
 		VmaAllocator m_allocator;
+		std::array<u32, VK_MAX_MEMORY_TYPES> m_type_heap_index{};
+		std::array<atomic_t<u64>, VK_MAX_MEMORY_HEAPS> m_heap_usage{};
 	};
 
 	// Memory Allocator - built-in Vulkan device memory allocate/free
@@ -523,6 +565,11 @@ namespace vk
 			return props.limits;
 		}
 
+		const VkPhysicalDeviceProperties& get_properties() const
+		{
+			return props;
+		}
+
 		operator VkPhysicalDevice() const
 		{
 			return dev;
@@ -587,9 +634,34 @@ namespace vk
 		gpu_formats_support m_formats_support{};
 		gpu_shader_types_support m_shader_types_support{};
 		bool m_stencil_export_support = false;
+		bool m_descriptor_update_template_support = false;
+		bool m_push_descriptor_support = false;
+		bool m_memory_budget_support = false;
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR getPhysicalDeviceMemoryProperties2KHR = nullptr;
+		u32 m_max_draw_indirect_count = 0;
 		std::unique_ptr<mem_allocator_base> m_allocator;
 		VkDevice dev = VK_NULL_HANDLE;
 
+		u32 m_graphics_queue_family = 0;
+		u32 m_transfer_queue_family = UINT32_MAX;
+		VkQueue m_transfer_queue = VK_NULL_HANDLE;
+
+		// Finds a family that only does transfers, these map to the copy engines
+		u32 find_dedicated_transfer_queue_family(vk::physical_device &pdev) const
+		{
+			for (u32 i = 0; i < pdev.get_queue_count(); ++i)
+			{
+				const auto props = pdev.get_queue_properties(i);
+				if (props.queueCount && (props.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+					!(props.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+				{
+					return i;
+				}
+			}
+
+			return UINT32_MAX;
+		}
+
 		void get_physical_device_features(VkPhysicalDeviceFeatures& features)
 		{
 			supported_extensions instance_extensions(supported_extensions::instance);
@@ -623,6 +695,13 @@ namespace vk
 			}
 
 			m_stencil_export_support = device_extensions.is_supported("VK_EXT_shader_stencil_export");
+			m_descriptor_update_template_support = device_extensions.is_supported("VK_KHR_descriptor_update_template");
+
+			// Pushing through a template is the only way we push descriptors
+			m_push_descriptor_support = m_descriptor_update_template_support && device_extensions.is_supported("VK_KHR_push_descriptor");
+
+			// Budgets are queried through vkGetPhysicalDeviceMemoryProperties2KHR
+			m_memory_budget_support = instance_extensions.is_supported("VK_KHR_get_physical_device_properties2") && device_extensions.is_supported("VK_EXT_memory_budget");
 		}
 
 	public:
@@ -633,13 +712,29 @@ namespace vk
 		{
 			float queue_priorities[1] = { 0.f };
 			pgpu = &pdev;
+			m_graphics_queue_family = graphics_queue_idx;
+			m_transfer_queue_family = g_cfg.video.vk.async_transfer ? find_dedicated_transfer_queue_family(pdev) : UINT32_MAX;
+
+			VkDeviceQueueCreateInfo queues[2] = {};
+			queues[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queues[0].pNext = NULL;
+			queues[0].queueFamilyIndex = graphics_queue_idx;
+			queues[0].queueCount = 1;
+			queues[0].pQueuePriorities = queue_priorities;
 
-			VkDeviceQueueCreateInfo queue = {};
-			queue.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			queue.pNext = NULL;
-			queue.queueFamilyIndex = graphics_queue_idx;
-			queue.queueCount = 1;
-			queue.pQueuePriorities = queue_priorities;
+			u32 queue_count = 1;
+			if (m_transfer_queue_family != UINT32_MAX)
+			{
+				queues[1] = queues[0];
+				queues[1].queueFamilyIndex = m_transfer_queue_family;
+				queue_count++;
+
+				LOG_NOTICE(RSX, "Using dedicated transfer queue family %u", m_transfer_queue_family);
+			}
+			else if (g_cfg.video.vk.async_transfer)
+			{
+				LOG_WARNING(RSX, "GPU has no dedicated transfer queue, all copies will use the graphics queue");
+			}
 
 			// Set up instance information
 			std::vector<const char *>requested_extensions =
@@ -660,15 +755,36 @@ namespace vk
 				requested_extensions.push_back("VK_KHR_shader_float16_int8");
 			}
 
+			if (m_descriptor_update_template_support)
+			{
+				requested_extensions.push_back("VK_KHR_descriptor_update_template");
+			}
+
+			if (m_push_descriptor_support)
+			{
+				requested_extensions.push_back("VK_KHR_push_descriptor");
+			}
+
+			if (m_memory_budget_support)
+			{
+				requested_extensions.push_back("VK_EXT_memory_budget");
+
+				getPhysicalDeviceMemoryProperties2KHR = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(*pgpu, "vkGetPhysicalDeviceMemoryProperties2KHR");
+				verify("vkGetInstanceProcAddress failed to find entry point!" HERE), getPhysicalDeviceMemoryProperties2KHR;
+			}
+
 			available_features.samplerAnisotropy = VK_TRUE;
 			available_features.textureCompressionBC = VK_TRUE;
 			available_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
 
+			// Multi-draw indirect is optional; flattened draw clauses fall back to one call per subrange without it
+			m_max_draw_indirect_count = available_features.multiDrawIndirect ? pdev.get_limits().maxDrawIndirectCount : 1;
+
 			VkDeviceCreateInfo device = {};
 			device.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 			device.pNext = nullptr;
-			device.queueCreateInfoCount = 1;
-			device.pQueueCreateInfos = &queue;
+			device.queueCreateInfoCount = queue_count;
+			device.pQueueCreateInfos = queues;
 			device.enabledLayerCount = 0;
 			device.ppEnabledLayerNames = nullptr; // Deprecated
 			device.enabledExtensionCount = (u32)requested_extensions.size();
@@ -692,6 +808,11 @@ namespace vk
 
 			CHECK_RESULT(vkCreateDevice(*pgpu, &device, nullptr, &dev));
 
+			if (m_transfer_queue_family != UINT32_MAX)
+			{
+				vkGetDeviceQueue(dev, m_transfer_queue_family, 0, &m_transfer_queue);
+			}
+
 			memory_map = vk::get_memory_mapping(pdev);
 			m_formats_support = vk::get_optimal_tiling_supported_formats(pdev);
 
@@ -713,6 +834,8 @@ namespace vk
 
 				vkDestroyDevice(dev, nullptr);
 				dev = nullptr;
+				m_transfer_queue = VK_NULL_HANDLE;
+				m_transfer_queue_family = UINT32_MAX;
 				memory_map = {};
 				m_formats_support = {};
 			}
@@ -781,6 +904,77 @@ namespace vk
 			return m_stencil_export_support;
 		}
 
+		bool get_descriptor_update_template_support() const
+		{
+			return m_descriptor_update_template_support;
+		}
+
+		bool get_push_descriptor_support() const
+		{
+			return m_push_descriptor_support;
+		}
+
+		u32 get_max_draw_indirect_count() const
+		{
+			return m_max_draw_indirect_count;
+		}
+
+		bool get_memory_budget_support() const
+		{
+			return m_memory_budget_support;
+		}
+
+		// One entry per memory heap. Without VK_EXT_memory_budget the budget is the size of the heap
+		void get_memory_heap_usage(std::vector<memory_heap_usage>& heaps) const
+		{
+			const auto memory_properties = pgpu->get_memory_properties();
+			heaps.resize(memory_properties.memoryHeapCount);
+
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_info = {};
+			if (m_memory_budget_support)
+			{
+				budget_info.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+				VkPhysicalDeviceMemoryProperties2KHR properties2 = {};
+				properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+				properties2.pNext = &budget_info;
+				getPhysicalDeviceMemoryProperties2KHR(*pgpu, &properties2);
+			}
+
+			for (u32 i = 0; i < memory_properties.memoryHeapCount; ++i)
+			{
+				auto& heap = heaps[i];
+				heap.device_local = !!(memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT);
+
+				if (m_memory_budget_support)
+				{
+					heap.usage = budget_info.heapUsage[i];
+					heap.budget = budget_info.heapBudget[i];
+				}
+				else
+				{
+					heap.usage = m_allocator->get_heap_allocated_size(i);
+					heap.budget = memory_properties.memoryHeaps[i].size;
+				}
+			}
+		}
+
+		u32 get_graphics_queue_family() const
+		{
+			return m_graphics_queue_family;
+		}
+
+		// UINT32_MAX unless asynchronous transfers are enabled and the GPU has a dedicated transfer family
+		u32 get_transfer_queue_family() const
+		{
+			return m_transfer_queue_family;
+		}
+
+		VkQueue get_transfer_queue() const
+		{
+			return m_transfer_queue;
+		}
+
 		mem_allocator_base* get_allocator() const
 		{
 			return m_allocator.get();
@@ -796,17 +990,21 @@ namespace vk
 	{
 		vk::render_device *owner = nullptr;
 		VkCommandPool pool = nullptr;
+		u32 queue_family = 0;
 
 	public:
 		command_pool() = default;
 		~command_pool() = default;
 
-		void create(vk::render_device &dev)
+		void create(vk::render_device &dev, u32 queue_family_index = UINT32_MAX)
 		{
 			owner = &dev;
+			queue_family = (queue_family_index == UINT32_MAX) ? dev.get_graphics_queue_family() : queue_family_index;
+
 			VkCommandPoolCreateInfo infos = {};
 			infos.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 			infos.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			infos.queueFamilyIndex = queue_family;
 
 			CHECK_RESULT(vkCreateCommandPool(dev, &infos, nullptr, &pool));
 		}
@@ -825,6 +1023,11 @@ namespace vk
 			return (*owner);
 		}
 
+		u32 get_queue_family() const
+		{
+			return queue_family;
+		}
+
 		operator VkCommandPool()
 		{
 			return pool;
@@ -838,6 +1041,10 @@ namespace vk
 		bool is_pending = false;
 		VkFence m_submit_fence = VK_NULL_HANDLE;
 
+		// Extra semaphores the next submit waits on, e.g. copies done on another queue
+		std::vector<VkSemaphore> m_wait_semaphores;
+		std::vector<VkPipelineStageFlags> m_wait_stages;
+
 	protected:
 		vk::command_pool *pool = nullptr;
 		VkCommandBuffer commands = nullptr;
@@ -953,7 +1160,13 @@ namespace vk
 			is_open = false;
 		}
 
-		void submit(VkQueue queue, VkSemaphore wait_semaphore, VkSemaphore signal_semaphore, VkFence fence, VkPipelineStageFlags pipeline_stage_flags)
+		void add_wait_semaphore(VkSemaphore semaphore, VkPipelineStageFlags stages)
+		{
+			m_wait_semaphores.push_back(semaphore);
+			m_wait_stages.push_back(stages);
+		}
+
+		void submit(VkQueue queue, VkSemaphore wait_semaphore, VkSemaphore signal_semaphore, VkFence fence, VkPipelineStageFlags pipeline_stage_flags, atomic_t<bool>* fence_signaled = nullptr)
 		{
 			if (is_open)
 			{
@@ -979,16 +1192,29 @@ namespace vk
 				infos.pWaitSemaphores = &wait_semaphore;
 			}
 
+			if (!m_wait_semaphores.empty())
+			{
+				if (wait_semaphore)
+				{
+					m_wait_semaphores.push_back(wait_semaphore);
+					m_wait_stages.push_back(pipeline_stage_flags);
+				}
+
+				infos.waitSemaphoreCount = ::size32(m_wait_semaphores);
+				infos.pWaitSemaphores = m_wait_semaphores.data();
+				infos.pWaitDstStageMask = m_wait_stages.data();
+			}
+
 			if (signal_semaphore)
 			{
 				infos.signalSemaphoreCount = 1;
 				infos.pSignalSemaphores = &signal_semaphore;
 			}
 
-			acquire_global_submit_lock();
-			CHECK_RESULT(vkQueueSubmit(queue, 1, &infos, fence));
-			release_global_submit_lock();
+			queue_submit(queue, infos, fence, fence_signaled);
 
+			m_wait_semaphores.clear();
+			m_wait_stages.clear();
 			clear_flags();
 		}
 	};
@@ -1276,17 +1502,30 @@ namespace vk
 		VkBufferCreateInfo info = {};
 		std::unique_ptr<vk::memory_block> memory;
 
-		buffer(const vk::render_device& dev, u64 size, uint32_t memory_type_index, uint32_t access_flags, VkBufferUsageFlags usage, VkBufferCreateFlags flags)
+		// A concurrent buffer is shared by the graphics and the transfer queue families and needs no ownership transfers
+		buffer(const vk::render_device& dev, u64 size, uint32_t memory_type_index, uint32_t access_flags, VkBufferUsageFlags usage, VkBufferCreateFlags flags,
+			VkSharingMode sharing_mode = VK_SHARING_MODE_EXCLUSIVE)
 			: m_device(dev)
 		{
 			info.size = size;
 			info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			info.sharingMode = sharing_mode;
 			info.flags = flags;
 			info.usage = usage;
 
+			const u32 queue_families[] = { dev.get_graphics_queue_family(), dev.get_transfer_queue_family() };
+			if (sharing_mode == VK_SHARING_MODE_CONCURRENT)
+			{
+				verify(HERE), queue_families[1] != UINT32_MAX;
+				info.queueFamilyIndexCount = 2;
+				info.pQueueFamilyIndices = queue_families;
+			}
+
 			CHECK_RESULT(vkCreateBuffer(m_device, &info, nullptr, &value));
 
+			// The family list does not outlive the constructor
+			info.pQueueFamilyIndices = nullptr;
+
 			//Allocate vram for this buffer
 			VkMemoryRequirements memory_reqs;
 			vkGetBufferMemoryRequirements(m_device, value, &memory_reqs);
@@ -2134,6 +2373,12 @@ public:
 				{
 					preferred_modes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
 				}
+
+				// Mailbox does not tear, so it is also acceptable with vsync enabled
+				if (g_cfg.video.vk.prefer_mailbox)
+				{
+					preferred_modes.insert(preferred_modes.begin(), VK_PRESENT_MODE_MAILBOX_KHR);
+				}
 			}
 
 			bool mode_found = false;
@@ -2688,6 +2933,27 @@ public:
 
 		std::deque<u32> available_slots;
 		std::vector<bool> query_active_status;
+
+		// Results are copied here at submit time, each query has a {result, availability} pair at index * 8
+		std::unique_ptr<vk::buffer> results_buffer;
+		const u32* results = nullptr;
+
+		// Queries ended in the current command buffer whose results have not been copied yet
+		std::vector<u32> pending_copies;
+
+		u32 read_back_result(u32 index)
+		{
+			if (!results[index * 2 + 1])
+			{
+				// The copy was not executed yet, wait for the query itself
+				u32 result = 0;
+				CHECK_RESULT(vkGetQueryPoolResults(*owner, query_pool, index, 1, 4, &result, 4, VK_QUERY_RESULT_WAIT_BIT));
+				return result;
+			}
+
+			return results[index * 2];
+		}
+
 	public:
 
 		void create(vk::render_device &dev, u32 num_entries)
@@ -2700,6 +2966,17 @@ public:
 			CHECK_RESULT(vkCreateQueryPool(dev, &info, nullptr, &query_pool));
 			owner = &dev;
 
+			const u32 buffer_size = num_entries * 8;
+			results_buffer = std::make_unique<vk::buffer>(dev, buffer_size, dev.get_memory_mapping().host_visible_coherent,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0);
+
+			// Stays mapped for the lifetime of the pool
+			auto mapping = results_buffer->map(0, buffer_size);
+			std::memset(mapping, 0, buffer_size);
+			results = static_cast<const u32*>(mapping);
+
+			pending_copies.reserve(num_entries);
+
 			query_active_status.resize(num_entries, false);
 			available_slots.resize(num_entries);
 
@@ -2713,6 +2990,11 @@ public:
 		{
 			if (query_pool)
 			{
+				results_buffer->unmap();
+				results_buffer.reset();
+				results = nullptr;
+				pending_copies.clear();
+
 				vkDestroyQueryPool(*owner, query_pool, nullptr);
 
 				owner = nullptr;
@@ -2735,30 +3017,64 @@ public:
 		void end_query(vk::command_buffer &cmd, u32 index)
 		{
 			vkCmdEndQuery(cmd, query_pool, index);
+			pending_copies.push_back(index);
 		}
 
-		bool check_query_status(u32 index)
+		// Records the copy of all queries ended since the last call, must be called outside a render pass before cmd is submitted
+		void copy_results(vk::command_buffer &cmd)
 		{
-			u32 result[2] = {0, 0};
-			switch (VkResult status = vkGetQueryPoolResults(*owner, query_pool, index, 1, 8, result, 8, VK_QUERY_RESULT_WITH_AVAILABILITY_BIT))
+			if (pending_copies.empty())
 			{
-			case VK_SUCCESS:
-				break;
-			case VK_NOT_READY:
-				return false;
-			default:
-				vk::die_with_error(HERE, status);
+				return;
 			}
 
-			return result[1] != 0;
+			std::sort(pending_copies.begin(), pending_copies.end());
+			pending_copies.erase(std::unique(pending_copies.begin(), pending_copies.end()), pending_copies.end());
+
+			// Slots are handed out in order, so the ended queries mostly form a few contiguous runs
+			for (size_t first = 0; first < pending_copies.size();)
+			{
+				size_t last = first + 1;
+				while (last < pending_copies.size() && pending_copies[last] == pending_copies[last - 1] + 1)
+				{
+					last++;
+				}
+
+				const u32 base = pending_copies[first];
+				vkCmdCopyQueryPoolResults(cmd, query_pool, base, u32(last - first), results_buffer->value, base * 8, 8, VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+				first = last;
+			}
+
+			vk::insert_buffer_memory_barrier(cmd, results_buffer->value, 0, results_buffer->size(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+
+			pending_copies.clear();
+		}
+
+		// Only valid once the command buffer that ended the query has completed, its copy overwrote any earlier use of the slot
+		bool check_query_status(u32 index)
+		{
+			return results[index * 2 + 1] != 0;
 		}
 
 		u32 get_query_result(u32 index)
 		{
-			u32 result = 0;
-			CHECK_RESULT(vkGetQueryPoolResults(*owner, query_pool, index, 1, 4, &result, 4, VK_QUERY_RESULT_WAIT_BIT));
+			return read_back_result(index) == 0u? 0u: 1u;
+		}
+
+		// Any-samples-passed over a list of queries that all completed, no further synchronization is done per query
+		template<template<class> class _List>
+		u32 get_query_result(const _List<u32> &list)
+		{
+			for (const auto index : list)
+			{
+				if (read_back_result(index))
+				{
+					return 1u;
+				}
+			}
 
-			return result == 0u? 0u: 1u;
+			return 0u;
 		}
 
 		void reset_query(vk::command_buffer &cmd, u32 index)
@@ -3019,6 +3335,69 @@ public:
 		}
 	};
 
+	/**
+	 * Resources bound to the shared pipeline layout, one entry per binding slot.
+	 * Entries hold a VkDescriptorImageInfo, VkDescriptorBufferInfo or VkBufferView in the layout vkUpdateDescriptorSetWithTemplate reads,
+	 * unused bytes are kept zero so that blocks can be hashed and compared.
+	 */
+	struct descriptor_bindings
+	{
+		struct entry
+		{
+			u64 data[3];
+		};
+
+		std::array<entry, VK_NUM_DESCRIPTOR_BINDINGS> entries{};
+
+		void set_image(u32 binding, const VkDescriptorImageInfo& info)
+		{
+			auto& dst = entries[binding];
+			dst.data[0] = reinterpret_cast<u64>(info.sampler);
+			dst.data[1] = reinterpret_cast<u64>(info.imageView);
+			dst.data[2] = info.imageLayout;
+		}
+
+		void set_buffer(u32 binding, const VkDescriptorBufferInfo& info)
+		{
+			auto& dst = entries[binding];
+			dst.data[0] = reinterpret_cast<u64>(info.buffer);
+			dst.data[1] = info.offset;
+			dst.data[2] = info.range;
+		}
+
+		void set_texel_buffer(u32 binding, VkBufferView view)
+		{
+			auto& dst = entries[binding];
+			dst.data[0] = reinterpret_cast<u64>(view);
+			dst.data[1] = 0;
+			dst.data[2] = 0;
+		}
+
+		bool operator==(const descriptor_bindings& other) const
+		{
+			return std::memcmp(entries.data(), other.entries.data(), sizeof(entries)) == 0;
+		}
+
+		struct hasher
+		{
+			size_t operator()(const descriptor_bindings& bindings) const
+			{
+				// 64-bit FNV-1a over the words
+				u64 hash = 0xCBF29CE484222325ULL;
+				for (const auto& entry : bindings.entries)
+				{
+					for (const u64 word : entry.data)
+					{
+						hash ^= word;
+						hash *= 0x100000001B3ULL;
+					}
+				}
+
+				return hash;
+			}
+		};
+	};
+
 	namespace glsl
 	{
 		enum program_input_type : u32
@@ -3141,6 +3520,9 @@ public:
 
 			void create_impl();
 
+			u32 get_texture_binding(int texture_unit, ::glsl::program_domain domain, bool is_stencil_mirror) const;
+			u32 find_uniform_location(program_input_type type, const std::string &uniform_name) const;
+
 		public:
 			VkPipeline pipeline;
 			u64 attribute_location_mask;
@@ -3163,6 +3545,11 @@ public:
 
 			void bind_buffer(const VkDescriptorBufferInfo &buffer_descriptor, uint32_t binding_point, VkDescriptorType type, VkDescriptorSet &descriptor_set);
 
+			// Same as above but staged in a bindings block, written to a set later in one update
+			void bind_uniform(const VkDescriptorImageInfo &image_descriptor, int texture_unit, ::glsl::program_domain domain, vk::descriptor_bindings &bindings, bool is_stencil_mirror = false);
+			void bind_uniform(const VkDescriptorBufferInfo &buffer_descriptor, uint32_t binding_point, vk::descriptor_bindings &bindings);
+			void bind_uniform(const VkBufferView &buffer_view, program_input_type type, const std::string &binding_name, vk::descriptor_bindings &bindings);
+
 			u64 get_vertex_input_attributes_mask();
 		};
 	}
@@ -3176,35 +3563,76 @@ public:
 		std::unique_ptr<buffer> shadow;
 		std::vector<VkBufferCopy> dirty_ranges;
 
-		// NOTE: Some drivers (RADV) use heavyweight OS map/unmap routines that are insanely slow
-		// Avoid mapping/unmapping to keep these drivers from stalling
-		// NOTE2: HOST_CACHED flag does not keep the mapped ptr around in the driver either
-
-		void create(VkBufferUsageFlags usage, size_t size, const char *name = "unnamed", size_t guard = 0x10000)
+		// Backing buffers replaced by grow(), their allocations may still be referenced by submitted work
+		struct retired_buffer
 		{
-			::data_heap::init(size, name, guard);
+			std::unique_ptr<buffer> heap;
+			std::unique_ptr<buffer> shadow;
+			std::vector<VkBufferCopy> dirty_ranges;
+			u64 retire_time;
+		};
 
+		std::vector<retired_buffer> retired;
+		VkBufferUsageFlags usage_flags = 0;
+		size_t base_size = 0;
+		u64 last_grow_time = 0;
+		u32 grow_count = 0;
+
+	private:
+		void create_buffers(size_t size)
+		{
 			const auto device = get_current_renderer();
 			const auto memory_map = device->get_memory_mapping();
 
 			VkFlags memory_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 			auto memory_index = memory_map.host_visible_coherent;
+			auto usage = usage_flags;
 
 			if (!(get_heap_compatible_buffer_types() & usage))
 			{
-				LOG_WARNING(RSX, "Buffer usage %u is not heap-compatible using this driver, explicit staging buffer in use", (u32)usage);
-
 				shadow = std::make_unique<buffer>(*device, size, memory_index, memory_flags, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0);
 				usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 				memory_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 				memory_index = memory_map.device_local;
+
+				// The shadow is copied on the transfer queue if there is one, the heap is then written there and read by graphics
+				const auto sharing_mode = (device->get_transfer_queue_family() != UINT32_MAX) ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+				heap = std::make_unique<buffer>(*device, size, memory_index, memory_flags, usage, 0, sharing_mode);
+				return;
 			}
 
 			heap = std::make_unique<buffer>(*device, size, memory_index, memory_flags, usage, 0);
 		}
 
+	public:
+		// NOTE: Some drivers (RADV) use heavyweight OS map/unmap routines that are insanely slow
+		// Avoid mapping/unmapping to keep these drivers from stalling
+		// NOTE2: HOST_CACHED flag does not keep the mapped ptr around in the driver either
+
+		void create(VkBufferUsageFlags usage, size_t size, const char *name = "unnamed", size_t guard = 0x10000)
+		{
+			::data_heap::init(size, name, guard);
+
+			usage_flags = usage;
+			base_size = size;
+			last_grow_time = 0;
+			grow_count = 0;
+
+			if (!(get_heap_compatible_buffer_types() & usage))
+			{
+				LOG_WARNING(RSX, "Buffer usage %u is not heap-compatible using this driver, explicit staging buffer in use", (u32)usage);
+			}
+
+			create_buffers(size);
+		}
+
 		void destroy()
 		{
+			if (heap)
+			{
+				LOG_NOTICE(RSX, "[%s] Peak usage %u KiB of %u KiB, grown %u times", m_name, m_peak_allocated_size / 1024, m_size / 1024, grow_count);
+			}
+
 			if (mapped)
 			{
 				unmap(true);
@@ -3212,6 +3640,64 @@ public:
 
 			heap.reset();
 			shadow.reset();
+			retired.clear();
+		}
+
+		/**
+		 * Replaces the backing buffer with one twice as large, capped at max_growth times the created size.
+		 * The whole new buffer is free; allocations made so far stay in the old buffer, which is retired until
+		 * a frame tagged after the grow has completed. Callers must not reuse offsets or handles obtained before the grow.
+		 */
+		bool grow(u32 max_growth)
+		{
+			const size_t max_size = base_size * max_growth;
+			if (m_size >= max_size)
+			{
+				return false;
+			}
+
+			if (mapped)
+			{
+				unmap(true);
+			}
+
+			const size_t new_size = std::min(m_size * 2, max_size);
+			const size_t peak = m_peak_allocated_size;
+
+			last_grow_time = get_system_time();
+			retired.push_back({ std::move(heap), std::move(shadow), std::move(dirty_ranges), last_grow_time });
+			dirty_ranges.clear();
+
+			::data_heap::init(new_size, m_name, m_min_guard_size);
+			m_peak_allocated_size = peak;
+
+			create_buffers(new_size);
+			grow_count++;
+
+			LOG_NOTICE(RSX, "[%s] Heap grown to %u KiB, peak usage so far %u KiB", m_name, new_size / 1024, peak / 1024);
+			return true;
+		}
+
+		/**
+		 * Releases the space held by a completed frame tagged at sync_time with the put position get_pos.
+		 * Frames tagged before the last grow point into a retired buffer and only free retired buffers.
+		 */
+		void release(size_t get_pos, u64 sync_time)
+		{
+			if (!retired.empty())
+			{
+				retired.erase(std::remove_if(retired.begin(), retired.end(), [&](const retired_buffer& entry)
+				{
+					return entry.retire_time < sync_time;
+				}), retired.end());
+			}
+
+			if (sync_time > last_grow_time)
+			{
+				m_get_pos = get_pos;
+			}
+
+			notify();
 		}
 
 		void* map(size_t offset, size_t size)
@@ -3250,26 +3736,66 @@ public:
 
 		bool dirty()
 		{
-			return !dirty_ranges.empty();
+			if (!dirty_ranges.empty())
+			{
+				return true;
+			}
+
+			for (const auto& entry : retired)
+			{
+				if (!entry.dirty_ranges.empty())
+					return true;
+			}
+
+			return false;
 		}
 
 		void sync(const vk::command_buffer& cmd)
 		{
+			// On the transfer queue the semaphore waited on by the graphics submit orders the copies instead of a barrier
+			const bool graphics_queue = cmd.get_command_pool().get_queue_family() == get_current_renderer()->get_graphics_queue_family();
+
+			// Writes to a retired shadow before the grow still have to reach its device heap
+			for (auto& entry : retired)
+			{
+				if (!entry.dirty_ranges.empty())
+				{
+					vkCmdCopyBuffer(cmd, entry.shadow->value, entry.heap->value, (u32)entry.dirty_ranges.size(), entry.dirty_ranges.data());
+					entry.dirty_ranges.clear();
+
+					if (graphics_queue)
+					{
+						insert_buffer_memory_barrier(cmd, entry.heap->value, 0, entry.heap->size(),
+							VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+							VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+					}
+				}
+			}
+
 			if (!dirty_ranges.empty())
 			{
 				verify (HERE), shadow, heap;
 				vkCmdCopyBuffer(cmd, shadow->value, heap->value, (u32)dirty_ranges.size(), dirty_ranges.data());
 				dirty_ranges.clear();
 
-				insert_buffer_memory_barrier(cmd, heap->value, 0, heap->size(),
-						VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-						VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+				if (graphics_queue)
+				{
+					insert_buffer_memory_barrier(cmd, heap->value, 0, heap->size(),
+							VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+							VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+				}
 			}
 		}
 	};
 
 	struct blitter
 	{
+		bool allow_batching = false; // Simple color blits may be held back and merged with following blits between the same images
+
 		void scale_image(vk::command_buffer& cmd, vk::image* src, vk::image* dst, areai src_area, areai dst_area, bool interpolate, bool /*is_depth*/, const rsx::typeless_xfer& xfer_info);
 	};
+
+	// Records blits held back by blitter::scale_image; must be called before anything else touches the images involved
+	void flush_pending_blits();
+	void discard_pending_blits();
 }
@@ -44,6 +44,10 @@ namespace vk
 		u32 num_drawable_elements = 4;
 		u32 first_vertex = 0;
 
+		// Vertices are made of consecutive vec4 attributes
+		u32 m_vertex_attribute_count = 1;
+		u32 m_vertex_heap_size = 1 * 0x100000;
+
 		u32 m_ubo_length = 128;
 		u32 m_ubo_offset = 0;
 		u32 m_vao_offset = 0;
@@ -60,7 +64,7 @@ namespace vk
 		{
 			if (!m_vao.heap)
 			{
-				m_vao.create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 1 * 0x100000, "overlays VAO", 128);
+				m_vao.create(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertex_heap_size, "overlays VAO", 128);
 				m_ubo.create(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 8 * 0x100000, "overlays UBO", 128);
 			}
 		}
@@ -190,14 +194,19 @@ namespace vk
 			get_dynamic_state_entries(dynamic_state_descriptors, dynamic_state_info);
 			dynamic_state_info.pDynamicStates = dynamic_state_descriptors;
 
-			VkVertexInputBindingDescription vb = { 0, 16, VK_VERTEX_INPUT_RATE_VERTEX };
-			VkVertexInputAttributeDescription via = { 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0 };
+			VkVertexInputBindingDescription vb = { 0, 16 * m_vertex_attribute_count, VK_VERTEX_INPUT_RATE_VERTEX };
+			std::vector<VkVertexInputAttributeDescription> via(m_vertex_attribute_count);
+			for (u32 n = 0; n < m_vertex_attribute_count; ++n)
+			{
+				via[n] = { n, 0, VK_FORMAT_R32G32B32A32_SFLOAT, n * 16 };
+			}
+
 			VkPipelineVertexInputStateCreateInfo vi = {};
 			vi.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 			vi.vertexBindingDescriptionCount = 1;
 			vi.pVertexBindingDescriptions = &vb;
-			vi.vertexAttributeDescriptionCount = 1;
-			vi.pVertexAttributeDescriptions = &via;
+			vi.vertexAttributeDescriptionCount = m_vertex_attribute_count;
+			vi.pVertexAttributeDescriptions = via.data();
 
 			VkPipelineViewportStateCreateInfo vp = {};
 			vp.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -222,7 +231,7 @@ namespace vk
 			info.basePipelineHandle = VK_NULL_HANDLE;
 			info.renderPass = render_pass;
 
-			CHECK_RESULT(vkCreateGraphicsPipelines(*m_device, nullptr, 1, &info, NULL, &pipeline));
+			CHECK_RESULT(vkCreateGraphicsPipelines(*m_device, vk::get_pipeline_cache(), 1, &info, NULL, &pipeline));
 
 			auto program = std::make_unique<vk::glsl::program>(*m_device, pipeline, get_vertex_inputs(), get_fragment_inputs());
 			auto result = program.get();
@@ -444,15 +453,9 @@ namespace vk
 	struct ui_overlay_renderer : public overlay_pass
 	{
 		f32 m_time = 0.f;
-		f32 m_blur_strength = 0.f;
 		color4f m_scale_offset;
-		color4f m_color;
-		bool m_pulse_glow = false;
-		bool m_skip_texture_read = false;
-		bool m_clip_enabled;
-		int  m_texture_type;
-		areaf m_clip_region;
 		size2f m_viewport_size;
+		rsx::overlays::batched_geometry m_geometry;
 
 		std::vector<std::unique_ptr<vk::image>> resources;
 		std::unordered_map<u64, std::unique_ptr<vk::image>> font_cache;
@@ -467,12 +470,15 @@ namespace vk
 				"#version 450\n"
 				"#extension GL_ARB_separate_shader_objects : enable\n"
 				"layout(location=0) in vec4 in_pos;\n"
+				"layout(location=1) in vec4 in_color;\n"
+				"layout(location=2) in vec4 in_clip_rect;\n"
+				"layout(location=3) in vec4 in_params;\n"
 				"layout(std140, set=0, binding=0) uniform static_data{ vec4 regs[8]; };\n"
 				"layout(location=0) out vec2 tc0;\n"
-				"layout(location=1) out vec4 color;\n"
-				"layout(location=2) out vec4 parameters;\n"
-				"layout(location=3) out vec4 clip_rect;\n"
-				"layout(location=4) out vec4 parameters2;\n"
+				"layout(location=1) flat out vec4 color;\n"
+				"layout(location=2) flat out vec4 parameters;\n"
+				"layout(location=3) flat out vec4 clip_rect;\n"
+				"layout(location=4) flat out vec4 parameters2;\n"
 				"\n"
 				"vec2 snap_to_grid(vec2 normalized)\n"
 				"{\n"
@@ -482,10 +488,10 @@ namespace vk
 				"void main()\n"
 				"{\n"
 				"	tc0.xy = in_pos.zw;\n"
-				"	color = regs[1];\n"
-				"	parameters = regs[2];\n"
-				"	parameters2 = regs[4];\n"
-				"	clip_rect = (regs[3] * regs[0].zwzw) / regs[0].xyxy;  // Normalized coords\n"
+				"	color = in_color;\n"
+				"	parameters = vec4(regs[2].x, in_params.xyz);\n"
+				"	parameters2 = vec4(in_params.w, 0., 0., 0.);\n"
+				"	clip_rect = (in_clip_rect * regs[0].zwzw) / regs[0].xyxy;  // Normalized coords\n"
 				"	clip_rect *= regs[5].xyxy;  // Window coords\n"
 				"	vec4 pos = vec4((in_pos.xy * regs[0].zw) / regs[0].xy, 0.5, 1.);\n"
 				"	pos.xy = snap_to_grid(pos.xy);\n"
@@ -499,10 +505,10 @@ namespace vk
 				"#extension GL_ARB_separate_shader_objects : enable\n"
 				"layout(set=0, binding=1) uniform sampler2D fs0;\n"
 				"layout(location=0) in vec2 tc0;\n"
-				"layout(location=1) in vec4 color;\n"
-				"layout(location=2) in vec4 parameters;\n"
-				"layout(location=3) in vec4 clip_rect;\n"
-				"layout(location=4) in vec4 parameters2;\n"
+				"layout(location=1) flat in vec4 color;\n"
+				"layout(location=2) flat in vec4 parameters;\n"
+				"layout(location=3) flat in vec4 clip_rect;\n"
+				"layout(location=4) flat in vec4 parameters2;\n"
 				"layout(location=0) out vec4 ocol;\n"
 				"\n"
 				"vec4 blur_sample(sampler2D tex, vec2 coord, vec2 tex_offset)\n"
@@ -579,6 +585,7 @@ namespace vk
 				"}\n"
 			};
 
+			renderpass_config.set_primitive_type(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
 			renderpass_config.set_attachment_count(1);
 			renderpass_config.set_color_mask(true, true, true, true);
 			renderpass_config.set_depth_mask(false);
@@ -586,6 +593,10 @@ namespace vk
 				VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_SRC_ALPHA,
 				VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
 				VK_BLEND_OP_ADD, VK_BLEND_OP_ADD);
+
+			// Position, color, clip rect and parameters, 6 vertices per quad
+			m_vertex_attribute_count = 4;
+			m_vertex_heap_size = 8 * 0x100000;
 		}
 
 		vk::image_view* upload_simple_texture(vk::render_device &dev, vk::command_buffer &cmd,
@@ -723,26 +734,8 @@ namespace vk
 			dst[2] = m_scale_offset.b;
 			dst[3] = m_scale_offset.a;
 
-			// regs[1] = color
-			dst[4] = m_color.r;
-			dst[5] = m_color.g;
-			dst[6] = m_color.b;
-			dst[7] = m_color.a;
-
-			// regs[2] = fs config parameters
+			// regs[2] = time, the per-command parameters are part of the vertex data
 			dst[8] = m_time;
-			dst[9] = m_pulse_glow? 1.f : 0.f;
-			dst[10] = m_skip_texture_read? 0.f : (f32)m_texture_type;
-			dst[11] = m_clip_enabled ? 1.f : 0.f;
-
-			// regs[3] = clip rect
-			dst[12] = m_clip_region.x1;
-			dst[13] = m_clip_region.y1;
-			dst[14] = m_clip_region.x2;
-			dst[15] = m_clip_region.y2;
-
-			// regs[4] = fs config parameters 2
-			dst[16] = m_blur_strength;
 
 			// regs[5] = viewport size
 			dst[20] = m_viewport_size.width;
@@ -751,19 +744,6 @@ namespace vk
 			m_ubo.unmap();
 		}
 
-		void emit_geometry(vk::command_buffer &cmd) override
-		{
-			//Split into groups of 4
-			u32 first = 0;
-			u32 num_quads = num_drawable_elements / 4;
-
-			for (u32 n = 0; n < num_quads; ++n)
-			{
-				vkCmdDraw(cmd, 4, 1, first, 0);
-				first += 4;
-			}
-		}
-
 		void run(vk::command_buffer &cmd, u16 w, u16 h, vk::framebuffer* target, VkRenderPass render_pass,
 				vk::data_heap &upload_heap, rsx::overlays::overlay &ui)
 		{
@@ -771,39 +751,34 @@ namespace vk
 			m_time = (f32)(get_system_time() / 1000) * 0.005f;
 			m_viewport_size = { f32(w), f32(h) };
 
-			for (auto &command : ui.get_compiled().draw_commands)
+			m_geometry.build(ui.get_compiled());
+			if (!m_geometry.vertices.empty())
 			{
-				num_drawable_elements = (u32)command.verts.size();
-				const u32 value_count = num_drawable_elements * 4;
-
-				upload_vertex_data((f32*)command.verts.data(), value_count);
+				// The whole overlay is uploaded once, batches only differ in the texture they sample
+				upload_vertex_data((f32*)m_geometry.vertices.data(), (u32)(m_geometry.vertices.size() * sizeof(rsx::overlays::batched_geometry::batch_vertex) / sizeof(f32)));
+			}
 
-				m_skip_texture_read = false;
-				m_color = command.config.color;
-				m_pulse_glow = command.config.pulse_glow;
-				m_blur_strength = f32(command.config.blur_strength) * 0.01f;
-				m_clip_enabled = command.config.clip_region;
-				m_clip_region = command.config.clip_rect;
-				m_texture_type = 1;
+			for (const auto& batch : m_geometry.batches)
+			{
+				first_vertex = batch.first_vertex;
+				num_drawable_elements = batch.vertex_count;
 
 				auto src = vk::null_image_view(cmd);
-				switch (command.config.texture_ref)
+				switch (batch.config.texture_ref)
 				{
 				case rsx::overlays::image_resource_id::game_icon:
 				case rsx::overlays::image_resource_id::backbuffer:
 					//TODO
 				case rsx::overlays::image_resource_id::none:
-					m_skip_texture_read = true;
 					break;
 				case rsx::overlays::image_resource_id::font_file:
-					m_texture_type = 2;
-					src = find_font(command.config.font_ref, cmd, upload_heap);
+					src = find_font(batch.config.font_ref, cmd, upload_heap);
 					break;
 				case rsx::overlays::image_resource_id::raw_image:
-					src = find_temp_image((rsx::overlays::image_info*)command.config.external_data_ref, cmd, upload_heap, ui.uid);
+					src = find_temp_image((rsx::overlays::image_info*)batch.config.external_data_ref, cmd, upload_heap, ui.uid);
 					break;
 				default:
-					src = view_cache[command.config.texture_ref].get();
+					src = view_cache[batch.config.texture_ref].get();
 					break;
 				}
 
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "VKProfiler.h"
+
+namespace vk
+{
+	void timestamp_profiler::create(const vk::render_device& dev, u32 command_buffer_count)
+	{
+		const auto& gpu_limits = dev.gpu().get_limits();
+		if (!gpu_limits.timestampComputeAndGraphics)
+		{
+			LOG_ERROR(RSX, "The GPU profiler requires GPU timestamp support which this device does not have");
+			return;
+		}
+
+		VkQueryPoolCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = command_buffer_count * max_timestamps;
+
+		CHECK_RESULT(vkCreateQueryPool(dev, &info, nullptr, &m_query_pool));
+
+		m_device = dev;
+		m_timestamp_period = gpu_limits.timestampPeriod;
+		m_ranges.resize(command_buffer_count);
+	}
+
+	void timestamp_profiler::destroy()
+	{
+		if (m_query_pool)
+		{
+			vkDestroyQueryPool(m_device, m_query_pool, nullptr);
+			m_query_pool = VK_NULL_HANDLE;
+		}
+
+		m_ranges.clear();
+		m_scope_stack.clear();
+		m_current_cmd = VK_NULL_HANDLE;
+		m_current_category = untracked;
+	}
+
+	void timestamp_profiler::switch_category(rsx::gpu_timer_category category)
+	{
+		if (!m_current_cmd || category == m_current_category)
+		{
+			return;
+		}
+
+		auto& range = m_ranges[m_current_cb_index];
+
+		// The last slot is kept for the terminating timestamp
+		if (range.used == max_timestamps || (range.used == max_timestamps - 1 && category != untracked))
+		{
+			return;
+		}
+
+		vkCmdWriteTimestamp(m_current_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_query_pool, m_current_cb_index * max_timestamps + range.used);
+		range.categories[range.used++] = category;
+		m_current_category = category;
+	}
+
+	void timestamp_profiler::collect(u32 cb_index)
+	{
+		auto& range = m_ranges[cb_index];
+		if (range.used < 2)
+		{
+			range.used = 0;
+			return;
+		}
+
+		std::array<u64, max_timestamps> timestamps;
+		if (vkGetQueryPoolResults(m_device, m_query_pool, cb_index * max_timestamps, range.used, range.used * sizeof(u64),
+			timestamps.data(), sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			for (u32 i = 0; i + 1 < range.used; ++i)
+			{
+				if (range.categories[i] != untracked && timestamps[i + 1] > timestamps[i])
+				{
+					m_frame_profiler.add(range.categories[i], u64((timestamps[i + 1] - timestamps[i]) * m_timestamp_period));
+				}
+			}
+		}
+
+		range.used = 0;
+	}
+
+	void timestamp_profiler::begin_command_buffer(VkCommandBuffer cmd, u32 cb_index)
+	{
+		if (!m_query_pool)
+		{
+			return;
+		}
+
+		collect(cb_index);
+		vkCmdResetQueryPool(cmd, m_query_pool, cb_index * max_timestamps, max_timestamps);
+
+		m_current_cmd = cmd;
+		m_current_cb_index = cb_index;
+		m_current_category = untracked;
+
+		if (!m_scope_stack.empty())
+		{
+			switch_category(m_scope_stack.back());
+		}
+	}
+
+	void timestamp_profiler::end_command_buffer()
+	{
+		switch_category(untracked);
+		m_current_cmd = VK_NULL_HANDLE;
+	}
+
+	bool timestamp_profiler::begin_scope(VkCommandBuffer cmd, rsx::gpu_timer_category category)
+	{
+		if (!m_current_cmd || cmd != m_current_cmd)
+		{
+			return false;
+		}
+
+		m_scope_stack.push_back(category);
+		switch_category(category);
+		return true;
+	}
+
+	void timestamp_profiler::end_scope()
+	{
+		m_scope_stack.pop_back();
+
+		// The category stays active until another one begins so that adjacent scopes share timestamps
+		if (!m_scope_stack.empty())
+		{
+			switch_category(m_scope_stack.back());
+		}
+	}
+
+	timestamp_profiler& get_timestamp_profiler()
+	{
+		static timestamp_profiler s_profiler;
+		return s_profiler;
+	}
+}
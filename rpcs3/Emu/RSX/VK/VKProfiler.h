@@ -0,0 +1,93 @@
+#pragma once
+#include "VKHelpers.h"
+#include "../Common/gpu_profiler.h"
+
+namespace vk
+{
+	/**
+	 * Timestamp query based GPU profiler.
+	 * Each primary command buffer owns a range of queries. A timestamp is written whenever the active category changes,
+	 * the interval up to the next timestamp is charged to the category that was active. Work recorded between two scopes
+	 * is charged to the scope before it, nested scopes interrupt their parent for their own duration.
+	 * A range is read back when its command buffer is reopened, which only happens after its fence was waited on.
+	 */
+	class timestamp_profiler
+	{
+		// Timestamps per primary command buffer, categories stop changing once a buffer runs out
+		static constexpr u32 max_timestamps = 1024;
+
+		// Marks the end of the last interval of a command buffer
+		static constexpr auto untracked = rsx::gpu_timer_category::count;
+
+		struct query_range
+		{
+			std::array<rsx::gpu_timer_category, max_timestamps> categories;
+			u32 used = 0;
+		};
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkQueryPool m_query_pool = VK_NULL_HANDLE;
+		f64 m_timestamp_period = 1.;
+
+		std::vector<query_range> m_ranges;
+		VkCommandBuffer m_current_cmd = VK_NULL_HANDLE;
+		u32 m_current_cb_index = 0;
+
+		rsx::gpu_timer_category m_current_category = untracked;
+		std::vector<rsx::gpu_timer_category> m_scope_stack;
+
+		rsx::gpu_frame_profiler m_frame_profiler;
+
+		void switch_category(rsx::gpu_timer_category category);
+		void collect(u32 cb_index);
+
+	public:
+		void create(const vk::render_device& dev, u32 command_buffer_count);
+		void destroy();
+
+		bool is_enabled() const
+		{
+			return m_query_pool != VK_NULL_HANDLE;
+		}
+
+		// Called right after the primary at cb_index has been reopened and before any scope is recorded into it
+		void begin_command_buffer(VkCommandBuffer cmd, u32 cb_index);
+
+		// Called before the current primary is ended, open scopes are carried over to the next one
+		void end_command_buffer();
+
+		// Scopes are ignored on any command buffer other than the current primary, end_scope must only follow a successful begin_scope
+		bool begin_scope(VkCommandBuffer cmd, rsx::gpu_timer_category category);
+		void end_scope();
+
+		void on_frame_end()
+		{
+			m_frame_profiler.end_frame();
+		}
+
+		rsx::gpu_frame_timings get_last_frame() const
+		{
+			return m_frame_profiler.get_last_frame();
+		}
+	};
+
+	timestamp_profiler& get_timestamp_profiler();
+
+	struct gpu_profiler_scope
+	{
+		bool active;
+
+		gpu_profiler_scope(VkCommandBuffer cmd, rsx::gpu_timer_category category)
+		{
+			active = get_timestamp_profiler().begin_scope(cmd, category);
+		}
+
+		~gpu_profiler_scope()
+		{
+			if (active)
+			{
+				get_timestamp_profiler().end_scope();
+			}
+		}
+	};
+}
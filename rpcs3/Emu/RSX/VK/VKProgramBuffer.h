@@ -167,7 +167,7 @@ struct VKTraits
 		info.basePipelineHandle = VK_NULL_HANDLE;
 		info.renderPass = vk::get_renderpass(dev, pipelineProperties.renderpass_key);
 
-		CHECK_RESULT(vkCreateGraphicsPipelines(dev, nullptr, 1, &info, NULL, &pipeline));
+		CHECK_RESULT(vkCreateGraphicsPipelines(dev, vk::get_pipeline_cache(), 1, &info, NULL, &pipeline));
 
 		pipeline_storage_type result = std::make_unique<vk::glsl::program>(dev, pipeline, vertexProgramData.uniforms, fragmentProgramData.uniforms);
 		result->link();
@@ -205,7 +205,7 @@ struct VKProgramBuffer : public program_state_cache<VKTraits>
 	void add_pipeline_entry(RSXVertexProgram &vp, RSXFragmentProgram &fp, vk::pipeline_props &props, Args&& ...args)
 	{
 		vp.skip_vertex_input_check = true;
-		get_graphics_pipeline(vp, fp, props, false, std::forward<Args>(args)...);
+		find_graphics_pipeline(vp, fp, props, false, false, std::forward<Args>(args)...);
 	}
 
     void preload_programs(RSXVertexProgram &vp, RSXFragmentProgram &fp)
@@ -224,4 +224,9 @@ struct VKProgramBuffer : public program_state_cache<VKTraits>
 	{
 		return m_program_compiled_flag;
 	}
+
+	bool check_first_use_flag() const
+	{
+		return m_first_use_flag;
+	}
 };
@@ -131,20 +131,35 @@ namespace vk
 			LOG_NOTICE(RSX, "texture not found in program: %s", uniform_name.c_str());
 		}
 
-		void program::bind_uniform(const VkDescriptorImageInfo & image_descriptor, int texture_unit, ::glsl::program_domain domain, VkDescriptorSet &descriptor_set, bool is_stencil_mirror)
+		u32 program::get_texture_binding(int texture_unit, ::glsl::program_domain domain, bool is_stencil_mirror) const
 		{
 			verify("Unsupported program domain" HERE, domain != ::glsl::program_domain::glsl_compute_program);
 
-			u32 binding;
 			if (domain == ::glsl::program_domain::glsl_fragment_program)
 			{
-				binding = (is_stencil_mirror) ? fs_texture_mirror_bindings[texture_unit] : fs_texture_bindings[texture_unit];
+				return (is_stencil_mirror) ? fs_texture_mirror_bindings[texture_unit] : fs_texture_bindings[texture_unit];
 			}
-			else
+
+			return vs_texture_bindings[texture_unit];
+		}
+
+		u32 program::find_uniform_location(program_input_type type, const std::string &uniform_name) const
+		{
+			for (const auto &uniform : uniforms[type])
 			{
-				binding = vs_texture_bindings[texture_unit];
+				if (uniform.name == uniform_name)
+				{
+					return uniform.location;
+				}
 			}
 
+			return ~0u;
+		}
+
+		void program::bind_uniform(const VkDescriptorImageInfo & image_descriptor, int texture_unit, ::glsl::program_domain domain, VkDescriptorSet &descriptor_set, bool is_stencil_mirror)
+		{
+			const u32 binding = get_texture_binding(texture_unit, domain, is_stencil_mirror);
+
 			if (binding != ~0u)
 			{
 				const VkWriteDescriptorSet descriptor_writer =
@@ -223,6 +238,40 @@ namespace vk
 			attribute_location_mask |= (1ull << binding_point);
 		}
 
+		void program::bind_uniform(const VkDescriptorImageInfo &image_descriptor, int texture_unit, ::glsl::program_domain domain, vk::descriptor_bindings &bindings, bool is_stencil_mirror)
+		{
+			const u32 binding = get_texture_binding(texture_unit, domain, is_stencil_mirror);
+
+			if (binding != ~0u)
+			{
+				bindings.set_image(binding, image_descriptor);
+				attribute_location_mask |= (1ull << binding);
+				return;
+			}
+
+			LOG_NOTICE(RSX, "texture not found in program: %stex%u", (domain == ::glsl::program_domain::glsl_vertex_program)? "v" : "", texture_unit);
+		}
+
+		void program::bind_uniform(const VkDescriptorBufferInfo &buffer_descriptor, uint32_t binding_point, vk::descriptor_bindings &bindings)
+		{
+			bindings.set_buffer(binding_point, buffer_descriptor);
+			attribute_location_mask |= (1ull << binding_point);
+		}
+
+		void program::bind_uniform(const VkBufferView &buffer_view, program_input_type type, const std::string &binding_name, vk::descriptor_bindings &bindings)
+		{
+			const u32 location = find_uniform_location(type, binding_name);
+
+			if (location != ~0u)
+			{
+				bindings.set_texel_buffer(location, buffer_view);
+				attribute_location_mask |= (1ull << location);
+				return;
+			}
+
+			LOG_NOTICE(RSX, "vertex buffer not found in program: %s", binding_name.c_str());
+		}
+
 		u64 program::get_vertex_input_attributes_mask()
 		{
 			if (vertex_attributes_mask)
@@ -15,6 +15,7 @@ namespace vk
 		// 8-16 depth_format
 		// 16-21 sample_counts
 		// 21-37 current layouts
+		// 40-45 attachments cleared on load (see get_renderpass_clear_key)
 		u64 key = 0;
 		u64 layout_offset = 22;
 		for (const auto &surface : images)
@@ -96,6 +97,11 @@ namespace vk
 		return key;
 	}
 
+	u64 get_renderpass_clear_key(u64 renderpass_key, u32 clear_mask)
+	{
+		return renderpass_key | (u64(clear_mask & 0x1F) << 40);
+	}
+
 	VkRenderPass get_renderpass(VkDevice dev, u64 renderpass_key)
 	{
 		// 99.999% of checks will go through this block once on-disk shader cache has loaded
@@ -141,6 +147,7 @@ namespace vk
 
 		VkFormat color_format = VkFormat(renderpass_key & 0xFF);
 		VkFormat depth_format = VkFormat((renderpass_key >> 8) & 0xFF);
+		const u32 clear_mask = u32(renderpass_key >> 40) & 0x1F;
 
 		if (depth_format)
 		{
@@ -157,7 +164,7 @@ namespace vk
 			VkAttachmentDescription color_attachment_description = {};
 			color_attachment_description.format = color_format;
 			color_attachment_description.samples = samples;
-			color_attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			color_attachment_description.loadOp = (clear_mask & (1u << attachment_count)) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 			color_attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			color_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			color_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -173,10 +180,21 @@ namespace vk
 			VkAttachmentDescription depth_attachment_description = {};
 			depth_attachment_description.format = depth_format;
 			depth_attachment_description.samples = samples;
-			depth_attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			const auto load_op = (clear_mask & (1u << attachment_count)) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+			depth_attachment_description.loadOp = load_op;
 			depth_attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			depth_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-			depth_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			if (depth_format == VK_FORMAT_D16_UNORM)
+			{
+				// No stencil aspect to preserve
+				depth_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				depth_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			}
+			else
+			{
+				depth_attachment_description.stencilLoadOp = load_op;
+				depth_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+			}
 			depth_attachment_description.initialLayout = dsv_layout;
 			depth_attachment_description.finalLayout = dsv_layout;
 			attachments.push_back(depth_attachment_description);
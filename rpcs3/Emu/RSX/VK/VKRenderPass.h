@@ -7,6 +7,10 @@ namespace vk
 	u64 get_renderpass_key(const std::vector<vk::image*>& images);
 	u64 get_renderpass_key(const std::vector<vk::image*>& images, u64 previous_key);
 	u64 get_renderpass_key(VkFormat surface_format);
+
+	// Variant of a render pass whose load operation clears the attachments in clear_mask (bit n for attachment n, depth last).
+	// Load operations do not affect render pass compatibility, pipelines and framebuffers of the base key can be used with it
+	u64 get_renderpass_clear_key(u64 renderpass_key, u32 clear_mask);
 	VkRenderPass get_renderpass(VkDevice dev, u64 renderpass_key);
 
 	void clear_renderpass_cache(VkDevice dev);
@@ -14,10 +14,25 @@ namespace vk
 	void resolve_image(vk::command_buffer& cmd, vk::viewable_image* dst, vk::viewable_image* src);
 	void unresolve_image(vk::command_buffer& cmd, vk::viewable_image* dst, vk::viewable_image* src);
 
+	// Per frame count of MSAA resolve passes run and of barriers that found the copy they needed still valid
+	struct resolve_statistics
+	{
+		u32 num_resolves = 0;
+		u32 num_unresolves = 0;
+		u32 num_resolves_avoided = 0;
+		u32 num_unresolves_avoided = 0;
+	};
+
+	resolve_statistics& get_resolve_statistics();
+
 	struct render_target : public viewable_image, public rsx::ref_counted, public rsx::render_target_descriptor<vk::viewable_image*>
 	{
 		u64 frame_tag = 0; // frame id when invalidated, 0 if not invalid
 
+		// Full surface clear waiting to become the load operation of the next render pass drawing to this surface
+		bool clear_pending = false;
+		VkClearValue pending_clear_value = {};
+
 		using viewable_image::viewable_image;
 
 		vk::viewable_image* get_surface(rsx::surface_access access_type) override
@@ -213,30 +228,63 @@ namespace vk
 			msaa_flags &= ~(rsx::surface_state_flags::require_unresolve);
 		}
 
-		void memory_barrier(vk::command_buffer& cmd, rsx::surface_access access)
+		// Contents of a surface that has never been written to
+		VkClearValue get_erase_value() const
 		{
-			// Helper to optionally clear/initialize memory contents depending on barrier type
-			auto clear_surface_impl = [&cmd, this](vk::image* surface)
+			VkClearValue value = {};
+			if (is_depth_surface())
 			{
-				const auto optimal_layout = (surface->current_layout == VK_IMAGE_LAYOUT_GENERAL) ?
-					VK_IMAGE_LAYOUT_GENERAL :
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				value.depthStencil = { 1.f, 255 };
+			}
+
+			return value;
+		}
 
-				surface->push_layout(cmd, optimal_layout);
+		static void clear_image(vk::command_buffer& cmd, vk::image* surface, const VkClearValue& value)
+		{
+			const auto optimal_layout = (surface->current_layout == VK_IMAGE_LAYOUT_GENERAL) ?
+				VK_IMAGE_LAYOUT_GENERAL :
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 
-				VkImageSubresourceRange range{ surface->aspect(), 0, 1, 0, 1 };
-				if (surface->aspect() & VK_IMAGE_ASPECT_COLOR_BIT)
-				{
-					VkClearColorValue color{};
-					vkCmdClearColorImage(cmd, surface->value, surface->current_layout, &color, 1, &range);
-				}
-				else
-				{
-					VkClearDepthStencilValue clear{ 1.f, 255 };
-					vkCmdClearDepthStencilImage(cmd, surface->value, surface->current_layout, &clear, 1, &range);
-				}
+			surface->push_layout(cmd, optimal_layout);
+
+			VkImageSubresourceRange range{ surface->aspect(), 0, 1, 0, 1 };
+			if (surface->aspect() & VK_IMAGE_ASPECT_COLOR_BIT)
+			{
+				vkCmdClearColorImage(cmd, surface->value, surface->current_layout, &value.color, 1, &range);
+			}
+			else
+			{
+				vkCmdClearDepthStencilImage(cmd, surface->value, surface->current_layout, &value.depthStencil, 1, &range);
+			}
+
+			surface->pop_layout(cmd);
+		}
+
+		void defer_clear(const VkClearValue& value)
+		{
+			clear_pending = true;
+			pending_clear_value = value;
+		}
+
+		// Applies a deferred clear that no render pass has picked up, must precede any other access to the contents
+		void flush_pending_clear(vk::command_buffer& cmd)
+		{
+			if (clear_pending)
+			{
+				clear_pending = false;
+				clear_image(cmd, this, pending_clear_value);
+			}
+		}
+
+		void memory_barrier(vk::command_buffer& cmd, rsx::surface_access access)
+		{
+			flush_pending_clear(cmd);
 
-				surface->pop_layout(cmd);
+			// Helper to optionally clear/initialize memory contents depending on barrier type
+			auto clear_surface_impl = [&cmd, this](vk::image* surface)
+			{
+				clear_image(cmd, surface, get_erase_value());
 
 				if (surface == this)
 				{
@@ -300,22 +348,37 @@ namespace vk
 						clear_surface_impl(resolve_surface.get());
 					}
 
-					on_write(rsx::get_shared_tag(), rsx::surface_state_flags::ready);
+					// A resolve surface left over from earlier reads was not cleared and no longer matches
+					on_write(rsx::get_shared_tag(), (resolve_surface && !read_access) ?
+						rsx::surface_state_flags::require_resolve :
+						rsx::surface_state_flags::ready);
 				}
-				else if (msaa_flags & rsx::surface_state_flags::require_resolve)
+				else if (samples() > 1)
 				{
+					// require_resolve marks the resolved copy stale, require_unresolve the multisampled one.
+					// Each side is only refreshed when the consumer needs it, repeated reads or writes reuse the valid copy.
+					auto& stats = vk::get_resolve_statistics();
 					if (read_access)
 					{
-						// Only do this step when read access is required
-						resolve(cmd);
+						if (msaa_flags & rsx::surface_state_flags::require_resolve)
+						{
+							resolve(cmd);
+						}
+						else
+						{
+							stats.num_resolves_avoided++;
+						}
 					}
-				}
-				else if (msaa_flags & rsx::surface_state_flags::require_unresolve)
-				{
-					if (!read_access)
+					else if (resolve_surface)
 					{
-						// Only do this step when it is needed to start rendering
-						unresolve(cmd);
+						if (msaa_flags & rsx::surface_state_flags::require_unresolve)
+						{
+							unresolve(cmd);
+						}
+						else
+						{
+							stats.num_unresolves_avoided++;
+						}
 					}
 				}
 
@@ -644,6 +707,7 @@ namespace rsx
 		{
 			surface->frame_tag = vk::get_current_frame_id();
 			if (!surface->frame_tag) surface->frame_tag = 1;
+			surface->clear_pending = false;
 
 			if (surface->old_contents)
 			{
@@ -660,6 +724,7 @@ namespace rsx
 		static void notify_surface_reused(const std::unique_ptr<vk::render_target> &surface)
 		{
 			surface->state_flags |= rsx::surface_state_flags::erase_bkgnd;
+			surface->clear_pending = false;
 			surface->add_ref();
 		}
 
@@ -718,14 +783,16 @@ namespace rsx
 			invalidated_resources.clear();
 		}
 
-		void free_invalidated()
+		void free_invalidated(bool low_memory = false)
 		{
+			// When over the memory budget, release idle surfaces sooner instead of keeping them around for reuse
+			const u8 min_unused_checks = low_memory ? 1 : 2;
 			const u64 last_finished_frame = vk::get_last_completed_frame_id();
 			invalidated_resources.remove_if([&](std::unique_ptr<vk::render_target> &rtt)
 			{
 				verify(HERE), rtt->frame_tag != 0;
 
-				if (rtt->unused_check_count() >= 2 && rtt->frame_tag < last_finished_frame)
+				if (rtt->unused_check_count() >= min_unused_checks && rtt->frame_tag < last_finished_frame)
 					return true;
 
 				return false;
@@ -42,6 +42,12 @@ namespace vk
 	std::unique_ptr<vk::stencilonly_unresolve> g_stencil_unresolver;
 	std::unique_ptr<vk::depthstencil_resolve_EXT> g_depthstencil_resolver;
 	std::unique_ptr<vk::depthstencil_unresolve_EXT> g_depthstencil_unresolver;
+	resolve_statistics g_resolve_statistics;
+
+	resolve_statistics& get_resolve_statistics()
+	{
+		return g_resolve_statistics;
+	}
 
 	template <typename T, typename ...Args>
 	void initialize_pass(std::unique_ptr<T>& ptr, vk::render_device& dev, Args&&... extras)
@@ -55,6 +61,8 @@ namespace vk
 
 	void resolve_image(vk::command_buffer& cmd, vk::viewable_image* dst, vk::viewable_image* src)
 	{
+		g_resolve_statistics.num_resolves++;
+
 		if (src->aspect() == VK_IMAGE_ASPECT_COLOR_BIT)
 		{
 			auto &job = g_resolve_helpers[src->format()];
@@ -116,6 +124,8 @@ namespace vk
 
 	void unresolve_image(vk::command_buffer& cmd, vk::viewable_image* dst, vk::viewable_image* src)
 	{
+		g_resolve_statistics.num_unresolves++;
+
 		if (src->aspect() == VK_IMAGE_ASPECT_COLOR_BIT)
 		{
 			auto &job = g_unresolve_helpers[src->format()];
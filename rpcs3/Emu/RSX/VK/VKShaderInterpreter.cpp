@@ -0,0 +1,1158 @@
+#include "stdafx.h"
+#include "VKShaderInterpreter.h"
+#include "VKCommonDecompiler.h"
+#include "VKHelpers.h"
+#include "../Common/GLSLCommon.h"
+#include "../GCM.h"
+
+namespace vk
+{
+	namespace
+	{
+		void insert_opcode_defines(std::ostream& OS, const char* prefix, std::initializer_list<std::pair<const char*, u32>> opcodes)
+		{
+			for (const auto& op : opcodes)
+			{
+				OS << "#define " << prefix << op.first << " " << op.second << "\n";
+			}
+
+			OS << "\n";
+		}
+
+		// The recompilers truncate the condition vector to the number of written components
+		void insert_expand_cond(std::ostream& OS)
+		{
+			OS <<
+			"bvec4 expand_cond(bvec4 cond, bvec4 mask)\n"
+			"{\n"
+			"	bvec4 result = bvec4(false);\n"
+			"	int packed = 0;\n"
+			"	for (int i = 0; i < 4; ++i)\n"
+			"	{\n"
+			"		if (mask[i]) result[i] = cond[packed++];\n"
+			"	}\n"
+			"	return result;\n"
+			"}\n\n";
+		}
+
+		u32 convert_fragment_word(u32 raw)
+		{
+			return ((raw & 0x00FF00FF) << 8) | ((raw >> 8) & 0x00FF00FF);
+		}
+	}
+
+	void shader_interpreter::build_vs()
+	{
+		std::stringstream OS;
+		OS << "#version 450\n\n";
+		OS << "#extension GL_ARB_separate_shader_objects : enable\n\n";
+
+		OS << "layout(std140, set = 0, binding = 0) uniform VertexContextBuffer\n";
+		OS << "{\n";
+		OS << "	mat4 scale_offset_mat;\n";
+		OS << "	ivec4 user_clip_enabled[2];\n";
+		OS << "	vec4 user_clip_factor[2];\n";
+		OS << "	uint transform_branch_bits;\n";
+		OS << "	float point_size;\n";
+		OS << "	float z_near;\n";
+		OS << "	float z_far;\n";
+		OS << "};\n\n";
+
+		OS << "layout(std140, set = 0, binding = 1) uniform VertexLayoutBuffer\n";
+		OS << "{\n";
+		OS << "	uint  vertex_base_index;\n";
+		OS << "	uint  vertex_index_offset;\n";
+		OS << "	uvec4 input_attributes_blob[16 / 2];\n";
+		OS << "};\n\n";
+
+		OS << "layout(set=0, binding=6) uniform usamplerBuffer persistent_input_stream;\n";
+		OS << "layout(set=0, binding=7) uniform usamplerBuffer volatile_input_stream;\n\n";
+
+		OS << "layout(std140, set=0, binding = 2) uniform VertexConstantsBuffer\n";
+		OS << "{\n";
+		OS << "	vec4 vc[468];\n";
+		OS << "	uvec4 vp_control;\n";
+		OS << "	uvec4 vp_ucode[" << max_vertex_program_instructions << "];\n";
+		OS << "};\n\n";
+
+		for (const char* name : { "tc0", "tc1", "tc2", "tc3", "tc4", "tc5", "tc6", "tc7", "tc8", "tc9",
+			"back_diff_color", "front_diff_color", "back_spec_color", "front_spec_color", "fog_c" })
+		{
+			OS << "layout(location=" << vk::get_varying_register_location(name) << ") out vec4 " << name << ";\n";
+		}
+
+		OS << "\n";
+
+		::glsl::shader_properties properties{};
+		properties.domain = ::glsl::glsl_vertex_program;
+		properties.require_lit_emulation = true;
+
+		::glsl::insert_glsl_legacy_function(OS, properties);
+		::glsl::insert_vertex_input_fetch(OS, ::glsl::glsl_rules_spirv);
+
+		insert_opcode_defines(OS, "VEC_",
+		{
+			{ "NOP", RSX_VEC_OPCODE_NOP }, { "MOV", RSX_VEC_OPCODE_MOV }, { "MUL", RSX_VEC_OPCODE_MUL }, { "ADD", RSX_VEC_OPCODE_ADD },
+			{ "MAD", RSX_VEC_OPCODE_MAD }, { "DP3", RSX_VEC_OPCODE_DP3 }, { "DPH", RSX_VEC_OPCODE_DPH }, { "DP4", RSX_VEC_OPCODE_DP4 },
+			{ "DST", RSX_VEC_OPCODE_DST }, { "MIN", RSX_VEC_OPCODE_MIN }, { "MAX", RSX_VEC_OPCODE_MAX }, { "SLT", RSX_VEC_OPCODE_SLT },
+			{ "SGE", RSX_VEC_OPCODE_SGE }, { "ARL", RSX_VEC_OPCODE_ARL }, { "FRC", RSX_VEC_OPCODE_FRC }, { "FLR", RSX_VEC_OPCODE_FLR },
+			{ "SEQ", RSX_VEC_OPCODE_SEQ }, { "SFL", RSX_VEC_OPCODE_SFL }, { "SGT", RSX_VEC_OPCODE_SGT }, { "SLE", RSX_VEC_OPCODE_SLE },
+			{ "SNE", RSX_VEC_OPCODE_SNE }, { "STR", RSX_VEC_OPCODE_STR }, { "SSG", RSX_VEC_OPCODE_SSG }
+		});
+
+		insert_opcode_defines(OS, "SCA_",
+		{
+			{ "NOP", RSX_SCA_OPCODE_NOP }, { "MOV", RSX_SCA_OPCODE_MOV }, { "RCP", RSX_SCA_OPCODE_RCP }, { "RCC", RSX_SCA_OPCODE_RCC },
+			{ "RSQ", RSX_SCA_OPCODE_RSQ }, { "EXP", RSX_SCA_OPCODE_EXP }, { "LOG", RSX_SCA_OPCODE_LOG }, { "LIT", RSX_SCA_OPCODE_LIT },
+			{ "BRI", RSX_SCA_OPCODE_BRI }, { "CAL", RSX_SCA_OPCODE_CAL }, { "CLI", RSX_SCA_OPCODE_CLI }, { "RET", RSX_SCA_OPCODE_RET },
+			{ "LG2", RSX_SCA_OPCODE_LG2 }, { "EX2", RSX_SCA_OPCODE_EX2 }, { "SIN", RSX_SCA_OPCODE_SIN }, { "COS", RSX_SCA_OPCODE_COS },
+			{ "BRB", RSX_SCA_OPCODE_BRB }, { "CLB", RSX_SCA_OPCODE_CLB }, { "PSH", RSX_SCA_OPCODE_PSH }, { "POP", RSX_SCA_OPCODE_POP }
+		});
+
+		insert_expand_cond(OS);
+
+		OS <<
+		"vec4 tmp[64];\n"
+		"ivec4 a[2];\n"
+		"vec4 cc[2];\n"
+		"vec4 dst_reg[16];\n"
+		"vec4 inputs[16];\n"
+		"uint inputs_loaded = 0;\n\n"
+
+		"vec4 get_input(uint index)\n"
+		"{\n"
+		"	if ((inputs_loaded & (1u << index)) == 0)\n"
+		"	{\n"
+		"		inputs[index] = read_location(int(index));\n"
+		"		inputs_loaded |= (1u << index);\n"
+		"	}\n"
+		"	return inputs[index];\n"
+		"}\n\n"
+
+		"vec4 get_src(uint src, bool abs_flag, uvec4 d)\n"
+		"{\n"
+		"	vec4 value;\n"
+		"	switch (int(src & 0x3))\n"
+		"	{\n"
+		"	case 1:\n"
+		"		value = tmp[(src >> 2) & 0x3f];\n"
+		"		break;\n"
+		"	case 2:\n"
+		"		value = get_input((d.y >> 8) & 0xf);\n"
+		"		break;\n"
+		"	default:\n"
+		"	{\n"
+		"		int index = int((d.y >> 12) & 0x3ff);\n"
+		"		if ((d.w & 0x2) != 0) index += a[(d.x >> 24) & 0x1][d.x & 0x3];\n"
+		"		value = vc[clamp(index, 0, 467)];\n"
+		"		break;\n"
+		"	}\n"
+		"	}\n\n"
+
+		"	value = vec4(value[(src >> 14) & 0x3], value[(src >> 12) & 0x3], value[(src >> 10) & 0x3], value[(src >> 8) & 0x3]);\n"
+		"	if (abs_flag) value = abs(value);\n"
+		"	if ((src & (1u << 16)) != 0) value = -value;\n"
+		"	return value;\n"
+		"}\n\n"
+
+		"bvec4 test_cond(uvec4 d)\n"
+		"{\n"
+		"	vec4 value = cc[(d.x >> 25) & 0x1];\n"
+		"	value = vec4(value[(d.x >> 8) & 0x3], value[(d.x >> 6) & 0x3], value[(d.x >> 4) & 0x3], value[(d.x >> 2) & 0x3]);\n\n"
+
+		"	switch (int((d.x >> 10) & 0x7))\n"
+		"	{\n"
+		"	case 1: return lessThan(value, vec4(0.));\n"
+		"	case 2: return equal(value, vec4(0.));\n"
+		"	case 3: return lessThanEqual(value, vec4(0.));\n"
+		"	case 4: return greaterThan(value, vec4(0.));\n"
+		"	case 5: return notEqual(value, vec4(0.));\n"
+		"	case 6: return greaterThanEqual(value, vec4(0.));\n"
+		"	case 7: return bvec4(true);\n"
+		"	}\n"
+		"	return bvec4(false);\n"
+		"}\n\n"
+
+		"void write_dst(vec4 value, bool is_sca, bool is_arl, uvec4 d)\n"
+		"{\n"
+		"	uint cond = (d.x >> 10) & 0x7;\n"
+		"	if (cond == 0) return;\n\n"
+
+		"	uint mask_bits = is_sca ? (d.w >> 17) : (d.w >> 13);\n"
+		"	bvec4 mask = bvec4((mask_bits & 0x8) != 0, (mask_bits & 0x4) != 0, (mask_bits & 0x2) != 0, (mask_bits & 0x1) != 0);\n"
+		"	if (!any(mask)) mask = bvec4(true);\n\n"
+
+		"	if (!is_arl && (d.x & (1u << 26)) != 0) value = clamp(value, 0., 1.);\n"
+		"	if ((d.x & (1u << 13)) != 0 && cond != 7) mask = expand_cond(test_cond(d), mask);\n\n"
+
+		"	uint dst = (d.w >> 2) & 0x1f;\n"
+		"	uint tmp_index = is_sca ? ((d.w >> 7) & 0x3f) : ((d.x >> 15) & 0x3f);\n"
+		"	bool is_result = is_sca ? (tmp_index == 0x3f) : ((d.x & (1u << 30)) != 0);\n"
+		"	bool result_write = is_result && dst != 0x1f;\n\n"
+
+		"	if (result_write && dst < 16)\n"
+		"	{\n"
+		"		dst_reg[dst] = mix(dst_reg[dst], value, mask);\n"
+		"	}\n\n"
+
+		"	if (tmp_index != 0x3f)\n"
+		"	{\n"
+		"		if (!is_arl)\n"
+		"		{\n"
+		"			tmp[tmp_index] = mix(tmp[tmp_index], value, mask);\n"
+		"		}\n"
+		"		else if (tmp_index < 2)\n"
+		"		{\n"
+		"			a[tmp_index] = ivec4(mix(vec4(a[tmp_index]), vec4(ivec4(value)), mask));\n"
+		"		}\n"
+		"	}\n"
+		"	else if (!result_write && (dst != 0x1f || (d.x & ((1u << 14) | (1u << 29))) != 0))\n"
+		"	{\n"
+		"		uint index = (d.x >> 25) & 0x1;\n"
+		"		cc[index] = mix(cc[index], value, mask);\n"
+		"	}\n"
+		"}\n\n"
+
+		"void vs_main()\n"
+		"{\n"
+		"	uint call_stack[8];\n"
+		"	uint stack_depth = 0;\n"
+		"	uint pc = vp_control.x;\n\n"
+
+		"	for (uint step = 0; step < 16384 && pc < vp_control.y; ++step)\n"
+		"	{\n"
+		"		uvec4 d = vp_ucode[pc];\n"
+		"		uint next_pc = pc + 1;\n"
+		"		bool terminate = false;\n\n"
+
+		"		uint src0 = (d.z >> 23) | ((d.y & 0xff) << 9);\n"
+		"		uint src1 = (d.z >> 6) & 0x1ffff;\n"
+		"		uint src2 = (d.w >> 21) | ((d.z & 0x3f) << 11);\n\n"
+
+		"		// Invalid source operands end the program, same as the recompiler\n"
+		"		if ((src0 & 0x3) == 0 || (src1 & 0x3) == 0 || (src2 & 0x3) == 0) return;\n\n"
+
+		"		vec4 s0 = get_src(src0, (d.x & (1u << 21)) != 0, d);\n"
+		"		vec4 s1 = get_src(src1, (d.x & (1u << 22)) != 0, d);\n"
+		"		vec4 s2 = get_src(src2, (d.x & (1u << 23)) != 0, d);\n\n"
+
+		"		uint cond = (d.x >> 10) & 0x7;\n"
+		"		bool cond_passed = cond == 7 || (cond != 0 && any(test_cond(d)));\n"
+		"		uint branch_target = ((d.z & 0x3f) << 3) | (d.w >> 29);\n\n"
+
+		"		switch (int((d.y >> 22) & 0x1f))\n"
+		"		{\n"
+		"		case VEC_NOP: break;\n"
+		"		case VEC_MOV: write_dst(s0, false, false, d); break;\n"
+		"		case VEC_MUL: write_dst(s0 * s1, false, false, d); break;\n"
+		"		case VEC_ADD: write_dst(s0 + s2, false, false, d); break;\n"
+		"		case VEC_MAD: write_dst(s0 * s1 + s2, false, false, d); break;\n"
+		"		case VEC_DP3: write_dst(vec4(dot(s0.xyz, s1.xyz)), false, false, d); break;\n"
+		"		case VEC_DPH: write_dst(vec4(dot(vec4(s0.xyz, 1.), s1)), false, false, d); break;\n"
+		"		case VEC_DP4: write_dst(vec4(dot(s0, s1)), false, false, d); break;\n"
+		"		case VEC_DST: write_dst(vec4(distance(s0, s1)), false, false, d); break;\n"
+		"		case VEC_MIN: write_dst(min(s0, s1), false, false, d); break;\n"
+		"		case VEC_MAX: write_dst(max(s0, s1), false, false, d); break;\n"
+		"		case VEC_SLT: write_dst(vec4(lessThan(s0, s1)), false, false, d); break;\n"
+		"		case VEC_SGE: write_dst(vec4(greaterThanEqual(s0, s1)), false, false, d); break;\n"
+		"		case VEC_ARL: write_dst(s0, false, true, d); break;\n"
+		"		case VEC_FRC: write_dst(fract(s0), false, false, d); break;\n"
+		"		case VEC_FLR: write_dst(floor(s0), false, false, d); break;\n"
+		"		case VEC_SEQ: write_dst(vec4(equal(s0, s1)), false, false, d); break;\n"
+		"		case VEC_SFL: write_dst(vec4(0.), false, false, d); break;\n"
+		"		case VEC_SGT: write_dst(vec4(greaterThan(s0, s1)), false, false, d); break;\n"
+		"		case VEC_SLE: write_dst(vec4(lessThanEqual(s0, s1)), false, false, d); break;\n"
+		"		case VEC_SNE: write_dst(vec4(notEqual(s0, s1)), false, false, d); break;\n"
+		"		case VEC_STR: write_dst(vec4(1.), false, false, d); break;\n"
+		"		case VEC_SSG: write_dst(sign(s0), false, false, d); break;\n"
+		"		default: terminate = true; break;\n"
+		"		}\n\n"
+
+		"		switch (int((d.y >> 27) & 0x1f))\n"
+		"		{\n"
+		"		case SCA_NOP:\n"
+		"		case SCA_CLB:\n"
+		"		case SCA_PSH:\n"
+		"		case SCA_POP:\n"
+		"			break;\n"
+		"		case SCA_MOV: write_dst(s2, true, false, d); break;\n"
+		"		case SCA_RCP: write_dst(1. / s2, true, false, d); break;\n"
+		"		case SCA_RCC: write_dst(clamp(1. / s2, 5.42101e-20, 1.884467e19), true, false, d); break;\n"
+		"		case SCA_RSQ: write_dst(vec4(1. / sqrt(max(s2.x, 1.E-10))), true, false, d); break;\n"
+		"		case SCA_EXP: write_dst(exp(s2), true, false, d); break;\n"
+		"		case SCA_LOG: write_dst(log(s2), true, false, d); break;\n"
+		"		case SCA_LIT: write_dst(lit_legacy(s2), true, false, d); break;\n"
+		"		case SCA_LG2: write_dst(log2(max(s2, 1.E-10)), true, false, d); break;\n"
+		"		case SCA_EX2: write_dst(exp2(s2), true, false, d); break;\n"
+		"		case SCA_SIN: write_dst(sin(s2), true, false, d); break;\n"
+		"		case SCA_COS: write_dst(cos(s2), true, false, d); break;\n"
+		"		case SCA_BRI:\n"
+		"			if (cond_passed) next_pc = branch_target;\n"
+		"			break;\n"
+		"		case SCA_CAL:\n"
+		"		case SCA_CLI:\n"
+		"			if (cond_passed && stack_depth < 8)\n"
+		"			{\n"
+		"				call_stack[stack_depth++] = next_pc;\n"
+		"				next_pc = branch_target;\n"
+		"			}\n"
+		"			break;\n"
+		"		case SCA_RET:\n"
+		"			if (stack_depth > 0) next_pc = call_stack[--stack_depth];\n"
+		"			else if (cond_passed) return;\n"
+		"			break;\n"
+		"		case SCA_BRB:\n"
+		"			if (((transform_branch_bits >> ((d.w >> 23) & 0x1f)) & 0x1) == ((d.w >> 28) & 0x1)) next_pc = branch_target;\n"
+		"			break;\n"
+		"		default:\n"
+		"			terminate = true;\n"
+		"			break;\n"
+		"		}\n\n"
+
+		"		if (terminate || (d.w & 0x1) != 0) return;\n"
+		"		pc = next_pc;\n"
+		"	}\n"
+		"}\n\n"
+
+		"void main()\n"
+		"{\n"
+		"	for (int i = 0; i < 64; ++i) tmp[i] = vec4(0.);\n"
+		"	for (int i = 0; i < 16; ++i) dst_reg[i] = vec4(0.);\n"
+		"	dst_reg[0] = vec4(0., 0., 0., 1.);\n"
+		"	a[0] = ivec4(0); a[1] = ivec4(0);\n"
+		"	cc[0] = vec4(0.); cc[1] = vec4(0.);\n\n"
+
+		"	vs_main();\n\n"
+
+		"	// Registers never written by the program are set to all ones, like the recompiler does\n"
+		"	uint written = vp_control.z;\n"
+		"	back_diff_color = ((written & (1u << 1)) != 0) ? dst_reg[1] : vec4(1.);\n"
+		"	back_spec_color = ((written & (1u << 2)) != 0) ? dst_reg[2] : vec4(1.);\n"
+		"	front_diff_color = ((written & (1u << 3)) != 0) ? dst_reg[3] : back_diff_color;\n"
+		"	front_spec_color = ((written & (1u << 4)) != 0) ? dst_reg[4] : back_spec_color;\n"
+		"	fog_c = ((written & (1u << 5)) != 0) ? dst_reg[5].xxxx : vec4(1.);\n\n"
+
+		"	bool clip0 = (written & (1u << 5)) != 0;\n"
+		"	bool clip1 = (written & (1u << 6)) != 0;\n"
+		"	gl_ClipDistance[0] = (clip0 && user_clip_enabled[0].x > 0) ? dst_reg[5].y * user_clip_factor[0].x : 0.5;\n"
+		"	gl_ClipDistance[1] = (clip0 && user_clip_enabled[0].y > 0) ? dst_reg[5].z * user_clip_factor[0].y : 0.5;\n"
+		"	gl_ClipDistance[2] = (clip0 && user_clip_enabled[0].z > 0) ? dst_reg[5].w * user_clip_factor[0].z : 0.5;\n"
+		"	gl_ClipDistance[3] = (clip1 && user_clip_enabled[0].w > 0) ? dst_reg[6].y * user_clip_factor[0].w : 0.5;\n"
+		"	gl_ClipDistance[4] = (clip1 && user_clip_enabled[1].x > 0) ? dst_reg[6].z * user_clip_factor[1].x : 0.5;\n"
+		"	gl_ClipDistance[5] = (clip1 && user_clip_enabled[1].y > 0) ? dst_reg[6].w * user_clip_factor[1].y : 0.5;\n\n"
+
+		"	tc0 = ((written & (1u << 7)) != 0) ? dst_reg[7] : vec4(1.);\n"
+		"	tc1 = ((written & (1u << 8)) != 0) ? dst_reg[8] : vec4(1.);\n"
+		"	tc2 = ((written & (1u << 9)) != 0) ? dst_reg[9] : vec4(1.);\n"
+		"	tc3 = ((written & (1u << 10)) != 0) ? dst_reg[10] : vec4(1.);\n"
+		"	tc4 = ((written & (1u << 11)) != 0) ? dst_reg[11] : vec4(1.);\n"
+		"	tc5 = ((written & (1u << 12)) != 0) ? dst_reg[12] : vec4(1.);\n"
+		"	tc6 = ((written & (1u << 13)) != 0) ? dst_reg[13] : vec4(1.);\n"
+		"	tc7 = ((written & (1u << 14)) != 0) ? dst_reg[14] : vec4(1.);\n"
+		"	tc8 = ((written & (1u << 15)) != 0) ? dst_reg[15] : vec4(1.);\n"
+		"	tc9 = ((written & (1u << 6)) != 0) ? dst_reg[6] : vec4(1.);\n\n"
+
+		"	gl_PointSize = point_size;\n"
+		"	gl_Position = dst_reg[0] * scale_offset_mat;\n"
+		"	gl_Position = apply_zclip_xform(gl_Position, z_near, z_far);\n"
+		"}\n";
+
+		m_vs.shader.create(::glsl::program_domain::glsl_vertex_program, OS.str());
+		m_vs.id = UINT32_MAX;
+		m_vs.handle = m_vs.shader.compile();
+
+		std::vector<vk::glsl::program_input> inputs;
+		vk::glsl::program_input in;
+		in.domain = ::glsl::glsl_vertex_program;
+		in.type = vk::glsl::input_type_uniform_buffer;
+
+		in.location = VERTEX_PARAMS_BIND_SLOT;
+		in.name = "VertexContextBuffer";
+		inputs.push_back(in);
+
+		in.location = VERTEX_LAYOUT_BIND_SLOT;
+		in.name = "VertexLayoutBuffer";
+		inputs.push_back(in);
+
+		in.location = VERTEX_CONSTANT_BUFFERS_BIND_SLOT;
+		in.name = "VertexConstantsBuffer";
+		inputs.push_back(in);
+
+		in.type = vk::glsl::input_type_texel_buffer;
+		in.location = VERTEX_BUFFERS_FIRST_BIND_SLOT;
+		in.name = "persistent_input_stream";
+		inputs.push_back(in);
+
+		in.location = VERTEX_BUFFERS_FIRST_BIND_SLOT + 1;
+		in.name = "volatile_input_stream";
+		inputs.push_back(in);
+
+		m_vs.SetInputs(inputs);
+	}
+
+	void shader_interpreter::build_fs()
+	{
+		std::stringstream OS;
+		OS << "#version 450\n";
+		OS << "#extension GL_ARB_separate_shader_objects: enable\n\n";
+
+		for (const char* name : { "tc0", "tc1", "tc2", "tc3", "tc4", "tc5", "tc6", "tc7", "tc8", "tc9",
+			"back_diff_color", "front_diff_color", "back_spec_color", "front_spec_color", "fog_c" })
+		{
+			OS << "layout(location=" << vk::get_varying_register_location(name) << ") in vec4 " << name << ";\n";
+		}
+
+		OS << "\n";
+
+		for (int i = 0; i < 4; ++i)
+		{
+			OS << "layout(location=" << i << ") out vec4 ocol" << i << ";\n";
+		}
+
+		OS << "\n";
+
+		for (int i = 0; i < rsx::limits::fragment_textures_count; ++i)
+		{
+			OS << "layout(set=0, binding=" << (TEXTURES_FIRST_BIND_SLOT + i) << ") uniform sampler2D tex" << i << ";\n";
+		}
+
+		OS << "\n";
+
+		OS << "layout(std140, set = 0, binding = 3) uniform FragmentConstantsBuffer\n";
+		OS << "{\n";
+		OS << "	uvec4 fp_control;\n";
+		OS << "	uvec4 fp_ucode[" << max_fragment_program_slots << "];\n";
+		OS << "};\n\n";
+
+		OS << "layout(std140, set = 0, binding = 4) uniform FragmentStateBuffer\n";
+		OS << "{\n";
+		OS << "	float fog_param0;\n";
+		OS << "	float fog_param1;\n";
+		OS << "	uint rop_control;\n";
+		OS << "	float alpha_ref;\n";
+		OS << "	uint reserved;\n";
+		OS << "	uint fog_mode;\n";
+		OS << "	float wpos_scale;\n";
+		OS << "	float wpos_bias;\n";
+		OS << "};\n\n";
+
+		OS << "layout(std140, set = 0, binding = 5) uniform TextureParametersBuffer\n";
+		OS << "{\n";
+		OS << "	vec4 texture_parameters[16];\n";
+		OS << "};\n\n";
+
+		::glsl::shader_properties properties{};
+		properties.domain = ::glsl::glsl_fragment_program;
+		properties.require_lit_emulation = true;
+		properties.require_wpos = true;
+		properties.require_texture_ops = true;
+		properties.low_precision_tests = vk::get_driver_vendor() == vk::driver_vendor::NVIDIA;
+
+		::glsl::insert_glsl_legacy_function(OS, properties);
+		::glsl::insert_fog_declaration(OS);
+
+		OS <<
+		"vec4 precision_clamp(vec4 x, float _min, float _max)\n"
+		"{\n"
+		"	// Treat NaNs as 0\n"
+		"	bvec4 nans = isnan(x);\n"
+		"	x = _select(x, vec4(0., 0., 0., 0.), nans);\n"
+		"	return clamp(x, _min, _max);\n"
+		"}\n\n"
+
+		"vec4 clamp16(vec4 x)\n"
+		"{\n"
+		"	uvec4 bits = floatBitsToUint(x);\n"
+		"	uvec4 extend = uvec4(0x7f800000);\n"
+		"	bvec4 test = equal(bits & extend, extend);\n"
+		"	vec4 clamped = clamp(x, -65504., +65504.);\n"
+		"	return _select(clamped, x, test);\n"
+		"}\n\n"
+
+		"vec4 _builtin_divsq(vec4 a, float b)\n"
+		"{\n"
+		"	vec4 tmp = a / sqrt(abs(b));\n"
+		"	vec4 choice = abs(a);\n"
+		"	return _select(a, tmp, greaterThan(choice, vec4(0.)));\n"
+		"}\n\n";
+
+		insert_opcode_defines(OS, "FP_",
+		{
+			{ "NOP", RSX_FP_OPCODE_NOP }, { "MOV", RSX_FP_OPCODE_MOV }, { "MUL", RSX_FP_OPCODE_MUL }, { "ADD", RSX_FP_OPCODE_ADD },
+			{ "MAD", RSX_FP_OPCODE_MAD }, { "DP3", RSX_FP_OPCODE_DP3 }, { "DP4", RSX_FP_OPCODE_DP4 }, { "DST", RSX_FP_OPCODE_DST },
+			{ "MIN", RSX_FP_OPCODE_MIN }, { "MAX", RSX_FP_OPCODE_MAX }, { "SLT", RSX_FP_OPCODE_SLT }, { "SGE", RSX_FP_OPCODE_SGE },
+			{ "SLE", RSX_FP_OPCODE_SLE }, { "SGT", RSX_FP_OPCODE_SGT }, { "SNE", RSX_FP_OPCODE_SNE }, { "SEQ", RSX_FP_OPCODE_SEQ },
+			{ "FRC", RSX_FP_OPCODE_FRC }, { "FLR", RSX_FP_OPCODE_FLR }, { "KIL", RSX_FP_OPCODE_KIL }, { "PK4", RSX_FP_OPCODE_PK4 },
+			{ "UP4", RSX_FP_OPCODE_UP4 }, { "DDX", RSX_FP_OPCODE_DDX }, { "DDY", RSX_FP_OPCODE_DDY }, { "TEX", RSX_FP_OPCODE_TEX },
+			{ "TXP", RSX_FP_OPCODE_TXP }, { "TXD", RSX_FP_OPCODE_TXD }, { "RCP", RSX_FP_OPCODE_RCP }, { "RSQ", RSX_FP_OPCODE_RSQ },
+			{ "EX2", RSX_FP_OPCODE_EX2 }, { "LG2", RSX_FP_OPCODE_LG2 }, { "LIT", RSX_FP_OPCODE_LIT }, { "LRP", RSX_FP_OPCODE_LRP },
+			{ "STR", RSX_FP_OPCODE_STR }, { "SFL", RSX_FP_OPCODE_SFL }, { "COS", RSX_FP_OPCODE_COS }, { "SIN", RSX_FP_OPCODE_SIN },
+			{ "PK2", RSX_FP_OPCODE_PK2 }, { "UP2", RSX_FP_OPCODE_UP2 }, { "PKB", RSX_FP_OPCODE_PKB }, { "UPB", RSX_FP_OPCODE_UPB },
+			{ "PK16", RSX_FP_OPCODE_PK16 }, { "UP16", RSX_FP_OPCODE_UP16 }, { "BEM", RSX_FP_OPCODE_BEM }, { "PKG", RSX_FP_OPCODE_PKG },
+			{ "UPG", RSX_FP_OPCODE_UPG }, { "DP2A", RSX_FP_OPCODE_DP2A }, { "TXL", RSX_FP_OPCODE_TXL }, { "TXB", RSX_FP_OPCODE_TXB },
+			{ "TEXBEM", RSX_FP_OPCODE_TEXBEM }, { "TXPBEM", RSX_FP_OPCODE_TXPBEM }, { "REFL", RSX_FP_OPCODE_REFL }, { "DP2", RSX_FP_OPCODE_DP2 },
+			{ "NRM", RSX_FP_OPCODE_NRM }, { "DIV", RSX_FP_OPCODE_DIV }, { "DIVSQ", RSX_FP_OPCODE_DIVSQ }, { "LIF", RSX_FP_OPCODE_LIF },
+			{ "BRK", RSX_FP_OPCODE_BRK }, { "IFE", RSX_FP_OPCODE_IFE }, { "LOOP", RSX_FP_OPCODE_LOOP }, { "REP", RSX_FP_OPCODE_REP },
+			{ "RET", RSX_FP_OPCODE_RET }
+		});
+
+		insert_expand_cond(OS);
+
+		OS <<
+		"vec4 r[64];\n"
+		"vec4 h[64];\n"
+		"vec4 cc[2];\n"
+		"vec4 x2d;\n\n"
+
+		"vec4 clamp_value(vec4 value, uint precision)\n"
+		"{\n"
+		"	switch (int(precision))\n"
+		"	{\n"
+		"	case 1: return clamp16(value);\n"
+		"	case 2: return precision_clamp(value, -2., 2.);\n"
+		"	case 3: return precision_clamp(value, -1., 1.);\n"
+		"	case 4: return precision_clamp(value, 0., 1.);\n"
+		"	}\n"
+		"	return value;\n"
+		"}\n\n"
+
+		"vec4 read_input(uint index)\n"
+		"{\n"
+		"	switch (int(index))\n"
+		"	{\n"
+		"	case 0: return get_wpos();\n"
+		"	case 1: return ((fp_control.y & 0xB) == 0xB && gl_FrontFacing) ? front_diff_color : back_diff_color;\n"
+		"	case 2: return ((fp_control.y & 0x15) == 0x15 && gl_FrontFacing) ? front_spec_color : back_spec_color;\n"
+		"	case 3: return fetch_fog_value(fog_mode);\n"
+		"	case 4: return tc0;\n"
+		"	case 5: return tc1;\n"
+		"	case 6: return tc2;\n"
+		"	case 7: return tc3;\n"
+		"	case 8: return tc4;\n"
+		"	case 9: return tc5;\n"
+		"	case 10: return tc6;\n"
+		"	case 11: return tc7;\n"
+		"	case 12: return tc8;\n"
+		"	case 13: return tc9;\n"
+		"	case 14: return gl_FrontFacing ? vec4(1.) : vec4(-1.);\n"
+		"	}\n"
+		"	return vec4(0.);\n"
+		"}\n\n"
+
+		"vec4 get_src(uint src, bool abs_flag, uvec4 inst, uint pc)\n"
+		"{\n"
+		"	uint input_precision = (inst.z >> 19) & 0x7;\n"
+		"	bool apply_precision = input_precision != 0;\n"
+		"	vec4 value;\n\n"
+
+		"	switch (int(src & 0x3))\n"
+		"	{\n"
+		"	case 0:\n"
+		"		if ((src & 0x100) != 0)\n"
+		"		{\n"
+		"			value = h[(src >> 2) & 0x3f];\n"
+		"			if (input_precision == 1) apply_precision = false;\n"
+		"		}\n"
+		"		else\n"
+		"		{\n"
+		"			value = r[(src >> 2) & 0x3f];\n"
+		"		}\n"
+		"		break;\n"
+		"	case 1:\n"
+		"		value = read_input((inst.x >> 13) & 0xf);\n"
+		"		break;\n"
+		"	case 2:\n"
+		"		value = uintBitsToFloat(fp_ucode[min(pc + 1, " << (max_fragment_program_slots - 1) << ")]);\n"
+		"		apply_precision = false;\n"
+		"		break;\n"
+		"	default:\n"
+		"		value = vec4(1.);\n"
+		"		apply_precision = false;\n"
+		"		break;\n"
+		"	}\n\n"
+
+		"	value = vec4(value[(src >> 9) & 0x3], value[(src >> 11) & 0x3], value[(src >> 13) & 0x3], value[(src >> 15) & 0x3]);\n"
+		"	if (abs_flag) value = abs(value);\n"
+		"	if (apply_precision) value = clamp_value(value, input_precision);\n"
+		"	if ((src & (1u << 17)) != 0) value = -value;\n"
+		"	return value;\n"
+		"}\n\n"
+
+		"bvec4 test_cond(uvec4 inst)\n"
+		"{\n"
+		"	vec4 value = cc[inst.y >> 31];\n"
+		"	value = vec4(value[(inst.y >> 21) & 0x3], value[(inst.y >> 23) & 0x3], value[(inst.y >> 25) & 0x3], value[(inst.y >> 27) & 0x3]);\n\n"
+
+		"	switch (int((inst.y >> 18) & 0x7))\n"
+		"	{\n"
+		"	case 0: return bvec4(false);\n"
+		"	case 1: return lessThan(value, vec4(0.));\n"
+		"	case 2: return equal(value, vec4(0.));\n"
+		"	case 3: return lessThanEqual(value, vec4(0.));\n"
+		"	case 4: return greaterThan(value, vec4(0.));\n"
+		"	case 5: return notEqual(value, vec4(0.));\n"
+		"	case 6: return greaterThanEqual(value, vec4(0.));\n"
+		"	}\n"
+		"	return bvec4(true);\n"
+		"}\n\n"
+
+		"bool is_precision_exempt(uint opcode, uvec4 inst)\n"
+		"{\n"
+		"	switch (int(opcode))\n"
+		"	{\n"
+		"	case FP_NRM:\n"
+		"	case FP_MAX:\n"
+		"	case FP_MIN:\n"
+		"	case FP_COS:\n"
+		"	case FP_SIN:\n"
+		"	case FP_REFL:\n"
+		"	case FP_EX2:\n"
+		"	case FP_FRC:\n"
+		"	case FP_LIT:\n"
+		"	case FP_LIF:\n"
+		"	case FP_LRP:\n"
+		"	case FP_LG2:\n"
+		"		return true;\n"
+		"	case FP_MOV:\n"
+		"		// Half to half register moves are not clamped\n"
+		"		return (inst.x & 0x80) != 0 && (inst.y & 0x100) != 0 && (inst.y & 0x3) == 0;\n"
+		"	}\n"
+		"	return false;\n"
+		"}\n\n"
+
+		"void write_dst(vec4 value, uvec4 inst, uint opcode)\n"
+		"{\n"
+		"	uint exec = (inst.y >> 18) & 0x7;\n"
+		"	if (exec == 0) return;\n\n"
+
+		"	switch (int((inst.z >> 28) & 0x7))\n"
+		"	{\n"
+		"	case 1: value *= 2.; break;\n"
+		"	case 2: value *= 4.; break;\n"
+		"	case 3: value *= 8.; break;\n"
+		"	case 5: value /= 2.; break;\n"
+		"	case 6: value /= 4.; break;\n"
+		"	case 7: value /= 8.; break;\n"
+		"	}\n\n"
+
+		"	bool no_dest = (inst.x & (1u << 30)) != 0;\n"
+		"	bool fp16 = (inst.x & 0x80) != 0;\n\n"
+
+		"	if (!no_dest)\n"
+		"	{\n"
+		"		if ((inst.x & (1u << 21)) != 0) value = (value - 0.5) * 2.;\n\n"
+
+		"		uint precision = (inst.x >> 22) & 0x3;\n"
+		"		if ((inst.x & (1u << 31)) != 0)\n"
+		"		{\n"
+		"			value = precision_clamp(value, 0., 1.);\n"
+		"		}\n"
+		"		else if (precision != 0 && !(precision == 1 && !fp16) && !is_precision_exempt(opcode, inst))\n"
+		"		{\n"
+		"			value = clamp_value(value, precision);\n"
+		"		}\n"
+		"	}\n\n"
+
+		"	uint mask_bits = (inst.x >> 9) & 0xf;\n"
+		"	bvec4 mask = bvec4((mask_bits & 0x1) != 0, (mask_bits & 0x2) != 0, (mask_bits & 0x4) != 0, (mask_bits & 0x8) != 0);\n"
+		"	if (!any(mask)) mask = bvec4(true);\n\n"
+
+		"	uint cc_index = (inst.y >> 30) & 0x1;\n"
+		"	bool set_cond = (inst.x & 0x100) != 0;\n\n"
+
+		"	if (no_dest)\n"
+		"	{\n"
+		"		if (set_cond && any(test_cond(inst))) cc[cc_index] = mix(cc[cc_index], value, mask);\n"
+		"		return;\n"
+		"	}\n\n"
+
+		"	bvec4 write_mask = (exec == 7) ? mask : expand_cond(test_cond(inst), mask);\n"
+		"	uint index = (inst.x >> 1) & 0x3f;\n"
+		"	vec4 result;\n\n"
+
+		"	if (fp16)\n"
+		"	{\n"
+		"		h[index] = mix(h[index], value, write_mask);\n"
+		"		result = h[index];\n"
+		"	}\n"
+		"	else\n"
+		"	{\n"
+		"		r[index] = mix(r[index], value, write_mask);\n"
+		"		result = r[index];\n"
+		"	}\n\n"
+
+		"	if (set_cond) cc[cc_index] = mix(cc[cc_index], result, mask);\n"
+		"}\n\n";
+
+		OS <<
+		"vec4 sample_texture(uint index, uint opcode, vec4 coord, vec4 s1, vec4 s2)\n"
+		"{\n"
+		"	switch (int(index))\n"
+		"	{\n";
+
+		for (int i = 0; i < rsx::limits::fragment_textures_count; ++i)
+		{
+			OS <<
+			"	case " << i << ":\n"
+			"		switch (int(opcode))\n"
+			"		{\n"
+			"		case FP_TXP:\n"
+			"		case FP_TXPBEM: return TEX2D_PROJ(" << i << ", coord);\n"
+			"		case FP_TXD: return TEX2D_GRAD(" << i << ", coord.xy, s1.xy, s2.xy);\n"
+			"		case FP_TXB: return TEX2D_BIAS(" << i << ", coord.xy, s1.x);\n"
+			"		case FP_TXL: return TEX2D_LOD(" << i << ", coord.xy, s1.x);\n"
+			"		}\n"
+			"		return TEX2D(" << i << ", coord.xy);\n";
+		}
+
+		OS <<
+		"	}\n"
+		"	return vec4(0.);\n"
+		"}\n\n"
+
+		"void fs_main()\n"
+		"{\n"
+		"	// Flow control stack. For IFE: x = trigger slot, y = target slot; loops also use z = counter, w = start slot\n"
+		"	uvec4 blocks[8];\n"
+		"	uint block_type[8];\n"
+		"	uvec2 loop_params[8];\n"
+		"	int depth = 0;\n"
+		"	uint pc = 0;\n\n"
+
+		"	for (uint step = 0; step < 65536 && pc < fp_control.z; ++step)\n"
+		"	{\n"
+		"		// Close any blocks ending at this slot\n"
+		"		while (depth > 0 && pc == blocks[depth - 1].x)\n"
+		"		{\n"
+		"			uvec4 block = blocks[depth - 1];\n"
+		"			if (block_type[depth - 1] == 1)\n"
+		"			{\n"
+		"				// Loop: x = end slot, z = current counter, w = first slot of the body\n"
+		"				block.z += loop_params[depth - 1].y;\n"
+		"				if (block.z < loop_params[depth - 1].x && loop_params[depth - 1].y != 0)\n"
+		"				{\n"
+		"					blocks[depth - 1].z = block.z;\n"
+		"					pc = block.w;\n"
+		"					break;\n"
+		"				}\n"
+		"			}\n"
+		"			else\n"
+		"			{\n"
+		"				pc = block.y;\n"
+		"			}\n"
+		"			depth--;\n"
+		"		}\n\n"
+
+		"		if (pc >= fp_control.z) break;\n\n"
+
+		"		uvec4 inst = fp_ucode[pc];\n"
+		"		uint opcode = ((inst.x >> 24) & 0x3f) | ((inst.z >> 31) << 6);\n"
+		"		bool has_constant = ((inst.y & 0x3) == 2) || ((inst.z & 0x3) == 2) || ((inst.w & 0x3) == 2);\n"
+		"		uint next_pc = pc + (has_constant ? 2 : 1);\n"
+		"		uint exec = (inst.y >> 18) & 0x7;\n"
+		"		bool cond_passed = exec != 0 && any(test_cond(inst));\n\n"
+
+		"		if (opcode >= 0x40)\n"
+		"		{\n"
+		"			// Flow control never carries an inline constant\n"
+		"			next_pc = pc + 1;\n"
+		"			uint end_slot = inst.w >> 2;\n\n"
+
+		"			switch (int(opcode))\n"
+		"			{\n"
+		"			case FP_BRK:\n"
+		"				if (cond_passed)\n"
+		"				{\n"
+		"					int loop = depth - 1;\n"
+		"					while (loop >= 0 && block_type[loop] != 1) loop--;\n"
+		"					if (loop >= 0)\n"
+		"					{\n"
+		"						next_pc = blocks[loop].x;\n"
+		"						depth = loop;\n"
+		"					}\n"
+		"				}\n"
+		"				break;\n"
+		"			case FP_IFE:\n"
+		"			{\n"
+		"				uint else_slot = (inst.z & 0x7fffffff) >> 2;\n"
+		"				if (depth < 8)\n"
+		"				{\n"
+		"					if (cond_passed)\n"
+		"					{\n"
+		"						blocks[depth] = uvec4(else_slot, end_slot, 0, 0);\n"
+		"						block_type[depth++] = 0;\n"
+		"					}\n"
+		"					else\n"
+		"					{\n"
+		"						blocks[depth] = uvec4(end_slot, end_slot, 0, 0);\n"
+		"						block_type[depth++] = 0;\n"
+		"						next_pc = else_slot;\n"
+		"					}\n"
+		"				}\n"
+		"				break;\n"
+		"			}\n"
+		"			case FP_LOOP:\n"
+		"			case FP_REP:\n"
+		"			{\n"
+		"				// Without any exec bits the recompiler runs the body once as straight code\n"
+		"				if (exec == 0) break;\n\n"
+
+		"				uint end_counter = (inst.z >> 2) & 0xff;\n"
+		"				uint init_counter = (inst.z >> 10) & 0xff;\n"
+		"				uint increment = (inst.z >> 19) & 0xff;\n\n"
+
+		"				if (!cond_passed || init_counter >= end_counter)\n"
+		"				{\n"
+		"					next_pc = end_slot;\n"
+		"				}\n"
+		"				else if (depth < 8)\n"
+		"				{\n"
+		"					blocks[depth] = uvec4(end_slot, end_slot, init_counter, next_pc);\n"
+		"					loop_params[depth] = uvec2(end_counter, increment);\n"
+		"					block_type[depth++] = 1;\n"
+		"				}\n"
+		"				break;\n"
+		"			}\n"
+		"			case FP_RET:\n"
+		"				if (cond_passed) return;\n"
+		"				break;\n"
+		"			}\n"
+		"		}\n"
+		"		else if (opcode == FP_KIL)\n"
+		"		{\n"
+		"			if (cond_passed) discard;\n"
+		"		}\n"
+		"		else\n"
+		"		{\n"
+		"			vec4 s0 = get_src(inst.y, (inst.y & (1u << 29)) != 0, inst, pc);\n"
+		"			vec4 s1 = get_src(inst.z, (inst.z & (1u << 18)) != 0, inst, pc);\n"
+		"			vec4 s2 = get_src(inst.w, (inst.w & (1u << 18)) != 0, inst, pc);\n"
+		"			uint tex_num = (inst.x >> 17) & 0xf;\n"
+		"			vec4 value;\n"
+		"			bool write = true;\n\n"
+
+		"			switch (int(opcode))\n"
+		"			{\n"
+		"			case FP_MOV: value = s0; break;\n"
+		"			case FP_MUL: value = s0 * s1; break;\n"
+		"			case FP_ADD: value = s0 + s1; break;\n"
+		"			case FP_MAD: value = s0 * s1 + s2; break;\n"
+		"			case FP_DP3: value = vec4(dot(s0.xyz, s1.xyz)); break;\n"
+		"			case FP_DP4: value = vec4(dot(s0, s1)); break;\n"
+		"			case FP_DST: value = vec4(distance(s0, s1)); break;\n"
+		"			case FP_MIN: value = min(s0, s1); break;\n"
+		"			case FP_MAX: value = max(s0, s1); break;\n"
+		"			case FP_SLT: value = vec4(lessThan(s0, s1)); break;\n"
+		"			case FP_SGE: value = vec4(greaterThanEqual(s0, s1)); break;\n"
+		"			case FP_SLE: value = vec4(lessThanEqual(s0, s1)); break;\n"
+		"			case FP_SGT: value = vec4(greaterThan(s0, s1)); break;\n"
+		"			case FP_SNE: value = vec4(notEqual(s0, s1)); break;\n"
+		"			case FP_SEQ: value = vec4(equal(s0, s1)); break;\n"
+		"			case FP_FRC: value = fract(s0); break;\n"
+		"			case FP_FLR: value = floor(s0); break;\n"
+		"			case FP_PK4: value = vec4(uintBitsToFloat(packSnorm4x8(s0))); break;\n"
+		"			case FP_UP4: value = unpackSnorm4x8(floatBitsToUint(s0.x)); break;\n"
+		"			case FP_DDX: value = dFdx(s0); break;\n"
+		"			case FP_DDY: value = dFdy(s0); break;\n"
+		"			case FP_TEX:\n"
+		"			case FP_TXP:\n"
+		"			case FP_TXD:\n"
+		"			case FP_TXB:\n"
+		"			case FP_TXL:\n"
+		"				value = sample_texture(tex_num, opcode, s0, s1, s2);\n"
+		"				break;\n"
+		"			case FP_TEXBEM:\n"
+		"			case FP_TXPBEM:\n"
+		"				x2d = s0.xyxy + s1.xxxx * s2.xzxz + s1.yyyy * s2.ywyw;\n"
+		"				value = sample_texture(tex_num, opcode, x2d, s1, s2);\n"
+		"				break;\n"
+		"			case FP_RCP: value = vec4(1. / s0.x); break;\n"
+		"			case FP_RSQ: value = vec4(1. / sqrt(abs(s0.x))); break;\n"
+		"			case FP_EX2: value = exp2(s0.xxxx); break;\n"
+		"			case FP_LG2: value = vec4(log2(s0.x)); break;\n"
+		"			case FP_LIT: value = lit_legacy(s0); break;\n"
+		"			case FP_LRP: value = s2 * (1. - s0) + s1 * s0; break;\n"
+		"			case FP_STR: value = vec4(1.); break;\n"
+		"			case FP_SFL: value = vec4(0.); break;\n"
+		"			case FP_COS: value = cos(s0.xxxx); break;\n"
+		"			case FP_SIN: value = sin(s0.xxxx); break;\n"
+		"			case FP_PK2: value = vec4(uintBitsToFloat(packHalf2x16(s0.xy))); break;\n"
+		"			case FP_UP2: value = unpackHalf2x16(floatBitsToUint(s0.x)).xyxy; break;\n"
+		"			case FP_PKB:\n"
+		"			case FP_PKG:\n"
+		"				value = vec4(uintBitsToFloat(packUnorm4x8(s0)));\n"
+		"				break;\n"
+		"			case FP_UPB:\n"
+		"			case FP_UPG:\n"
+		"				value = unpackUnorm4x8(floatBitsToUint(s0.x));\n"
+		"				break;\n"
+		"			case FP_PK16: value = vec4(uintBitsToFloat(packSnorm2x16(s0.xy))); break;\n"
+		"			case FP_UP16: value = unpackSnorm2x16(floatBitsToUint(s0.x)).xyxy; break;\n"
+		"			case FP_BEM: value = s0.xyxy + s1.xxxx * s2.xzxz + s1.yyyy * s2.ywyw; break;\n"
+		"			case FP_DP2A: value = vec4(dot(s0.xy, s1.xy) + s2.x); break;\n"
+		"			case FP_REFL: value = s0 - 2. * dot(s0, s1) * s1; break;\n"
+		"			case FP_DP2: value = vec4(dot(s0.xy, s1.xy)); break;\n"
+		"			case FP_NRM: value = (length(s0.xyz) > 0. ? normalize(s0.xyz) : s0.xyz).xyzz; break;\n"
+		"			case FP_DIV: value = s0 / s1.x; break;\n"
+		"			case FP_DIVSQ: value = _builtin_divsq(s0, s1.x); break;\n"
+		"			case FP_LIF: value = vec4(1., s0.y, (s0.y > 0. ? pow(2., s0.w) : 0.), 1.); break;\n"
+		"			default: write = false; break;\n"
+		"			}\n\n"
+
+		"			if (write) write_dst(value, inst, opcode);\n"
+		"		}\n\n"
+
+		"		if ((inst.x & 0x1) != 0) return;\n"
+		"		pc = next_pc;\n"
+		"	}\n"
+		"}\n\n"
+
+		"void main()\n"
+		"{\n"
+		"	for (int i = 0; i < 64; ++i)\n"
+		"	{\n"
+		"		r[i] = vec4(0.);\n"
+		"		h[i] = vec4(0.);\n"
+		"	}\n"
+		"	cc[0] = vec4(0.); cc[1] = vec4(0.);\n"
+		"	x2d = vec4(0.);\n\n"
+
+		"	fs_main();\n\n"
+
+		"	if ((fp_control.x & " << CELL_GCM_SHADER_CONTROL_32_BITS_EXPORTS << ") != 0)\n"
+		"	{\n"
+		"	vec4 r0 = r[0], r2 = r[2], r3 = r[3], r4 = r[4];\n";
+
+		::glsl::insert_rop(OS, true, false);
+
+		OS <<
+		"	}\n"
+		"	else\n"
+		"	{\n"
+		"	vec4 h0 = h[0], h4 = h[4], h6 = h[6], h8 = h[8];\n";
+
+		::glsl::insert_rop(OS, false, false);
+
+		OS <<
+		"	}\n\n"
+
+		"	gl_FragDepth = ((fp_control.x & " << CELL_GCM_SHADER_CONTROL_DEPTH_EXPORT << ") != 0) ? r[1].z : gl_FragCoord.z;\n"
+		"}\n";
+
+		m_fs.shader.create(::glsl::program_domain::glsl_fragment_program, OS.str());
+		m_fs.id = UINT32_MAX;
+		m_fs.handle = m_fs.shader.compile();
+
+		// All four outputs are always written, the render target masks decide what ends up in memory
+		m_fs.output_color_masks = { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+		std::vector<vk::glsl::program_input> inputs;
+		vk::glsl::program_input in;
+		in.domain = ::glsl::glsl_fragment_program;
+		in.type = vk::glsl::input_type_texture;
+
+		for (int i = 0; i < rsx::limits::fragment_textures_count; ++i)
+		{
+			in.location = TEXTURES_FIRST_BIND_SLOT + i;
+			in.name = "tex" + std::to_string(i);
+			inputs.push_back(in);
+		}
+
+		in.type = vk::glsl::input_type_uniform_buffer;
+		in.location = FRAGMENT_CONSTANT_BUFFERS_BIND_SLOT;
+		in.name = "FragmentConstantsBuffer";
+		inputs.push_back(in);
+
+		in.location = FRAGMENT_STATE_BIND_SLOT;
+		in.name = "FragmentStateBuffer";
+		inputs.push_back(in);
+
+		in.location = FRAGMENT_TEXTURE_PARAMS_BIND_SLOT;
+		in.name = "TextureParametersBuffer";
+		inputs.push_back(in);
+
+		m_fs.SetInputs(inputs);
+	}
+
+	void shader_interpreter::init()
+	{
+		build_vs();
+		build_fs();
+
+		LOG_NOTICE(RSX, "Shader interpreter initialized");
+	}
+
+	void shader_interpreter::destroy()
+	{
+		m_program_cache.clear();
+		m_vs.shader.destroy();
+		m_fs.shader.destroy();
+	}
+
+	bool shader_interpreter::is_supported(const RSXVertexProgram& vp, u32 vp_referenced_textures, const RSXFragmentProgram& fp, u16 fp_referenced_textures) const
+	{
+		if (vp_referenced_textures)
+		{
+			return false;
+		}
+
+		const u32 instruction_count = ::size32(vp.data) / 4;
+		if (instruction_count > max_vertex_program_instructions || (vp.entry - vp.base_address) >= instruction_count)
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < instruction_count; ++i)
+		{
+			if (!vp.instruction_mask[i])
+			{
+				continue;
+			}
+
+			D1 d1;
+			d1.HEX = vp.data[i * 4 + 1];
+
+			// Absolute branches need the address registers resolved at decompile time
+			if (d1.sca_opcode == RSX_SCA_OPCODE_BRA)
+			{
+				return false;
+			}
+		}
+
+		if (fp.ucode_length > max_fragment_program_slots * 16)
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < rsx::limits::fragment_textures_count; ++i)
+		{
+			if ((fp_referenced_textures & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			if (fp.get_texture_dimension(i) != rsx::texture_dimension_extended::texture_dimension_2d ||
+				(fp.shadow_textures & (1 << i)) || (fp.redirected_textures & (1 << i)))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	glsl::program* shader_interpreter::get_pipeline(const vk::pipeline_props& properties, VkDevice dev, VkPipelineLayout common_pipeline_layout)
+	{
+		auto found = m_program_cache.find(properties);
+		if (found != m_program_cache.end())
+		{
+			return found->second.get();
+		}
+
+		auto& result = m_program_cache[properties];
+		result = VKTraits::build_pipeline(m_vs, m_fs, properties, dev, common_pipeline_layout);
+		return result.get();
+	}
+
+	void shader_interpreter::fill_vertex_program_buffer(void* dst, const RSXVertexProgram& vp) const
+	{
+		const u32 instruction_count = ::size32(vp.data) / 4;
+		u32 written = 0;
+
+		for (u32 i = 0; i < instruction_count; ++i)
+		{
+			if (!vp.instruction_mask[i])
+			{
+				continue;
+			}
+
+			D0 d0;
+			D1 d1;
+			D3 d3;
+			d0.HEX = vp.data[i * 4];
+			d1.HEX = vp.data[i * 4 + 1];
+			d3.HEX = vp.data[i * 4 + 3];
+
+			if (d3.dst == 0x1f || d0.cond == 0)
+			{
+				continue;
+			}
+
+			// Flow control scalar opcodes do not write any register
+			const bool sca_is_flow = (d1.sca_opcode >= RSX_SCA_OPCODE_BRA && d1.sca_opcode <= RSX_SCA_OPCODE_RET) ||
+				(d1.sca_opcode >= RSX_SCA_OPCODE_BRB && d1.sca_opcode <= RSX_SCA_OPCODE_POP);
+
+			if ((d1.vec_opcode != RSX_VEC_OPCODE_NOP && d0.vec_result) ||
+				(d1.sca_opcode != RSX_SCA_OPCODE_NOP && !sca_is_flow && d3.sca_dst_tmp == 0x3f))
+			{
+				written |= (1u << d3.dst);
+			}
+		}
+
+		auto control = static_cast<u32*>(dst);
+		control[0] = vp.entry - vp.base_address;
+		control[1] = instruction_count;
+		control[2] = written;
+		control[3] = 0;
+
+		std::memcpy(control + 4, vp.data.data(), instruction_count * 16);
+	}
+
+	u32 shader_interpreter::fill_fragment_program_buffer(void* dst, const RSXFragmentProgram& fp, bool sanitize) const
+	{
+		const u32 slot_count = fp.ucode_length / 16;
+		const auto src = static_cast<const u32*>(fp.addr);
+		auto control = static_cast<u32*>(dst);
+		auto ucode = control + 4;
+
+		const bool two_sided = fp.front_back_color_enabled && (fp.back_color_diffuse_output || fp.back_color_specular_output);
+		control[0] = fp.ctrl;
+		control[1] = (two_sided ? 1 : 0) |
+			(fp.back_color_diffuse_output ? 2 : 0) |
+			(fp.back_color_specular_output ? 4 : 0) |
+			(fp.front_color_diffuse_output ? 8 : 0) |
+			(fp.front_color_specular_output ? 16 : 0);
+		control[2] = slot_count;
+		control[3] = 0;
+
+		for (u32 slot = 0; slot < slot_count;)
+		{
+			u32* inst = ucode + slot * 4;
+			for (u32 i = 0; i < 4; ++i)
+			{
+				inst[i] = convert_fragment_word(src[slot * 4 + i]);
+			}
+
+			const bool is_flow = (inst[2] >> 31) != 0;
+			const bool has_constant = !is_flow && ((inst[1] & 3) == 2 || (inst[2] & 3) == 2 || (inst[3] & 3) == 2);
+
+			if (has_constant && (slot + 1) < slot_count)
+			{
+				u32* value = inst + 4;
+				for (u32 i = 0; i < 4; ++i)
+				{
+					value[i] = convert_fragment_word(src[(slot + 1) * 4 + i]);
+
+					// Convert NaNs and Infs to 0
+					if (sanitize && (value[i] & 0x7fffffff) >= 0x7f800000)
+					{
+						value[i] = 0;
+					}
+				}
+
+				slot += 2;
+			}
+			else
+			{
+				slot++;
+			}
+
+			if (inst[0] & 1)
+			{
+				break;
+			}
+		}
+
+		return 16 + slot_count * 16;
+	}
+}
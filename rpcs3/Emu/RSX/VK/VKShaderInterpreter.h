@@ -0,0 +1,53 @@
+#pragma once
+#include "VKProgramBuffer.h"
+
+namespace vk
+{
+	/**
+	 * Prebuilt vertex/fragment program pair that executes RSX ucode read from the constants buffers.
+	 * Used to draw while the specialized program for the current ucode is still being compiled asynchronously.
+	 */
+	class shader_interpreter
+	{
+		struct pipeline_props_hash
+		{
+			size_t operator()(const vk::pipeline_props& props) const
+			{
+				return rpcs3::hash_struct(props);
+			}
+		};
+
+		VKVertexProgram m_vs;
+		VKFragmentProgram m_fs;
+
+		std::unordered_map<vk::pipeline_props, std::unique_ptr<glsl::program>, pipeline_props_hash> m_program_cache;
+
+		void build_vs();
+		void build_fs();
+
+	public:
+		// The vertex ucode is appended to the transform constants (binding 2),
+		// the fragment ucode replaces the fragment constants (binding 3) while the interpreter is active
+		static constexpr u32 max_vertex_program_instructions = 512;
+		static constexpr u32 max_fragment_program_slots = 1023;
+
+		static constexpr u32 vertex_constants_size = 468 * 16;
+		static constexpr u32 vertex_program_buffer_size = vertex_constants_size + 16 + (max_vertex_program_instructions * 16);
+		static constexpr u32 fragment_program_buffer_size = 16 + (max_fragment_program_slots * 16);
+
+		void init();
+		void destroy();
+
+		// Checks whether the interpreter can execute this program pair. Unsupported features are:
+		// vertex textures, BRA branches and fragment textures that are not plain 2D samplers
+		bool is_supported(const RSXVertexProgram& vp, u32 vp_referenced_textures, const RSXFragmentProgram& fp, u16 fp_referenced_textures) const;
+
+		glsl::program* get_pipeline(const vk::pipeline_props& properties, VkDevice dev, VkPipelineLayout common_pipeline_layout);
+
+		// Writes the control block and ucode following the transform constants
+		void fill_vertex_program_buffer(void* dst, const RSXVertexProgram& vp) const;
+
+		// Writes the control block and ucode, returns the number of bytes written
+		u32 fill_fragment_program_buffer(void* dst, const RSXFragmentProgram& fp, bool sanitize) const;
+	};
+}
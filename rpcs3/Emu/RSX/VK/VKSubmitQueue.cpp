@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "VKSubmitQueue.h"
+
+namespace vk
+{
+	atomic_t<submit_queue*> g_submit_queue{ nullptr };
+
+	void queue_submit(VkQueue queue, const VkSubmitInfo& info, VkFence fence, atomic_t<bool>* fence_signaled)
+	{
+		if (const auto async_queue = g_submit_queue.load())
+		{
+			verify(HERE), info.commandBufferCount == 1, info.signalSemaphoreCount <= 1, info.waitSemaphoreCount <= queue_submit_request::max_wait_semaphores;
+
+			queue_submit_request request;
+			request.queue = queue;
+			request.commands = info.pCommandBuffers[0];
+			request.fence = fence;
+			request.signal_semaphore = info.signalSemaphoreCount ? info.pSignalSemaphores[0] : VK_NULL_HANDLE;
+			request.wait_semaphore_count = info.waitSemaphoreCount;
+			request.fence_signaled = fence_signaled;
+
+			for (u32 i = 0; i < info.waitSemaphoreCount; i++)
+			{
+				request.wait_semaphores[i] = info.pWaitSemaphores[i];
+				request.wait_stages[i] = info.pWaitDstStageMask[i];
+			}
+
+			if (fence_signaled)
+			{
+				fence_signaled->store(false);
+			}
+
+			async_queue->push(request);
+			return;
+		}
+
+		acquire_global_submit_lock();
+		CHECK_RESULT(vkQueueSubmit(queue, 1, &info, fence));
+		release_global_submit_lock();
+	}
+
+	void flush_submit_queue()
+	{
+		if (const auto async_queue = g_submit_queue.load())
+		{
+			async_queue->flush();
+		}
+	}
+
+	void submit_queue::worker::operator()()
+	{
+		while (thread_ctrl::state() != thread_state::aborting)
+		{
+			bool idle = true;
+
+			for (auto slice = queue->m_requests.pop_all(); slice; slice.pop_front())
+			{
+				queue->submit(*slice);
+				idle = false;
+			}
+
+			if (queue->poll_fences() || !idle)
+			{
+				continue;
+			}
+
+			// Poll rarely when nothing is in flight, the timeout only bounds the reaction to thread abort
+			queue->m_requests.wait(queue->m_fences.empty() ? 10000 : 100);
+		}
+	}
+
+	void submit_queue::submit(const queue_submit_request& request)
+	{
+		VkSubmitInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		info.commandBufferCount = 1;
+		info.pCommandBuffers = &request.commands;
+		info.waitSemaphoreCount = request.wait_semaphore_count;
+		info.pWaitSemaphores = request.wait_semaphores.data();
+		info.pWaitDstStageMask = request.wait_stages.data();
+
+		if (request.signal_semaphore)
+		{
+			info.signalSemaphoreCount = 1;
+			info.pSignalSemaphores = &request.signal_semaphore;
+		}
+
+		acquire_global_submit_lock();
+		CHECK_RESULT(vkQueueSubmit(request.queue, 1, &info, request.fence));
+		release_global_submit_lock();
+
+		if (request.fence_signaled)
+		{
+			m_fences.push_back({ request.fence, request.fence_signaled });
+		}
+
+		m_submitted++;
+	}
+
+	bool submit_queue::poll_fences()
+	{
+		bool progress = false;
+
+		for (auto it = m_fences.begin(); it != m_fences.end();)
+		{
+			if (vkGetFenceStatus(m_device, it->fence) == VK_SUCCESS)
+			{
+				// The owner may reset the fence from now on, it is not touched here anymore
+				it->signaled->store(true);
+				it = m_fences.erase(it);
+				progress = true;
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		return progress;
+	}
+
+	submit_queue::submit_queue(VkDevice dev)
+		: m_device(dev)
+	{
+		m_fences.reserve(64);
+		m_thread = std::make_unique<named_thread<worker>>("VK Submit Thread", worker{ this });
+
+		verify(HERE), g_submit_queue.exchange(this) == nullptr;
+	}
+
+	submit_queue::~submit_queue()
+	{
+		g_submit_queue = nullptr;
+
+		// Hand over what is left before stopping, the owners still wait on these fences
+		flush();
+		m_thread.reset();
+
+		for (const auto& watch : m_fences)
+		{
+			vkWaitForFences(m_device, 1, &watch.fence, VK_TRUE, UINT64_MAX);
+			watch.signaled->store(true);
+		}
+	}
+
+	void submit_queue::push(const queue_submit_request& request)
+	{
+		std::lock_guard lock(m_push_mutex);
+		m_requests.push(request);
+		m_pushed++;
+	}
+
+	void submit_queue::flush()
+	{
+		const u64 target = m_pushed.load();
+
+		while (m_submitted.load() < target)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "VKHelpers.h"
+#include "Utilities/Thread.h"
+#include "Utilities/lockless.h"
+
+namespace vk
+{
+	struct queue_submit_request
+	{
+		static constexpr u32 max_wait_semaphores = 4;
+
+		VkQueue queue;
+		VkCommandBuffer commands;
+		VkFence fence;
+		VkSemaphore signal_semaphore;
+
+		u32 wait_semaphore_count;
+		std::array<VkSemaphore, max_wait_semaphores> wait_semaphores;
+		std::array<VkPipelineStageFlags, max_wait_semaphores> wait_stages;
+
+		// If set, the submit thread polls the fence and sets this once it has signaled
+		atomic_t<bool>* fence_signaled;
+	};
+
+	/**
+	 * Calls vkQueueSubmit on a dedicated thread so that slow driver submission does not stall the RSX thread.
+	 * Requests are submitted in push order, which keeps semaphore signal/wait pairs valid across queues.
+	 * Fences of requests with a completion flag are polled by the same thread while it is idle.
+	 * While a queue exists, vk::queue_submit routes all submissions through it.
+	 */
+	class submit_queue
+	{
+		struct worker
+		{
+			submit_queue* queue;
+
+			void operator()();
+		};
+
+		struct fence_watch
+		{
+			VkFence fence;
+			atomic_t<bool>* signaled;
+		};
+
+		VkDevice m_device;
+
+		// Producers may be the RSX thread or threads invalidating the texture cache
+		shared_mutex m_push_mutex;
+		lf_queue<queue_submit_request> m_requests;
+		atomic_t<u64> m_pushed{ 0 };
+		atomic_t<u64> m_submitted{ 0 };
+
+		// Owned by the worker
+		std::vector<fence_watch> m_fences;
+
+		std::unique_ptr<named_thread<worker>> m_thread;
+
+		void submit(const queue_submit_request& request);
+		bool poll_fences();
+
+	public:
+		submit_queue(VkDevice dev);
+		~submit_queue();
+
+		void push(const queue_submit_request& request);
+
+		// Waits until everything pushed so far has been handed to the driver
+		void flush();
+	};
+}
@@ -192,7 +192,7 @@ namespace vk
 			info.basePipelineHandle = VK_NULL_HANDLE;
 			info.renderPass = m_render_pass;
 
-			CHECK_RESULT(vkCreateGraphicsPipelines(dev, nullptr, 1, &info, NULL, &pipeline));
+			CHECK_RESULT(vkCreateGraphicsPipelines(dev, vk::get_pipeline_cache(), 1, &info, NULL, &pipeline));
 
 			const std::vector<vk::glsl::program_input> unused;
 			m_program = std::make_unique<vk::glsl::program>((VkDevice)dev, pipeline, unused, unused);
@@ -505,6 +505,40 @@ namespace vk
 			change_image_layout(cmd, dst, preferred_dst_format, dstLayout, vk::get_image_subresource_range(0, 0, 1, 1, aspect));
 	}
 
+	// Returns false if the format has no compute decoder, otherwise fills in the cs_texture_decode flags
+	static bool get_gpu_decode_flags(int format, u32& flags)
+	{
+		switch (format)
+		{
+		case CELL_GCM_TEXTURE_A8R8G8B8:
+		case CELL_GCM_TEXTURE_D8R8G8B8:
+			flags = 0;
+			return true;
+		case CELL_GCM_TEXTURE_X32_FLOAT:
+			flags = cs_texture_decode::swap_32bit_words;
+			return true;
+		case CELL_GCM_TEXTURE_Y16_X16:
+		case CELL_GCM_TEXTURE_Y16_X16_FLOAT:
+			flags = cs_texture_decode::swap_16bit_words;
+			return true;
+		case CELL_GCM_TEXTURE_COMPRESSED_HILO8:
+		case CELL_GCM_TEXTURE_COMPRESSED_HILO_S8:
+		case CELL_GCM_TEXTURE_DEPTH16:
+		case CELL_GCM_TEXTURE_DEPTH16_FLOAT:
+		case CELL_GCM_TEXTURE_D1R5G5B5:
+		case CELL_GCM_TEXTURE_A1R5G5B5:
+		case CELL_GCM_TEXTURE_A4R4G4B4:
+		case CELL_GCM_TEXTURE_R5G5B5A1:
+		case CELL_GCM_TEXTURE_R5G6B5:
+		case CELL_GCM_TEXTURE_G8B8:
+		case CELL_GCM_TEXTURE_X16:
+			flags = cs_texture_decode::texel_16bit | cs_texture_decode::swap_16bit_words;
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	void copy_mipmaped_image_using_buffer(VkCommandBuffer cmd, vk::image* dst_image,
 		const std::vector<rsx_subresource_layout>& subresource_layout, int format, bool is_swizzled, u16 mipmap_count,
 		VkImageAspectFlags flags, vk::data_heap &upload_heap)
@@ -513,19 +547,89 @@ namespace vk
 		u32 block_in_pixel = get_format_block_size_in_texel(format);
 		u8  block_size_in_bytes = get_format_block_size_in_bytes(format);
 
+		// Formats without any channel conversion can be deswizzled and byteswapped on the GPU.
+		// Linear data that needs no byteswap is a plain row copy and stays on the CPU
+		u32 decode_flags = 0;
+		const bool gpu_decode = g_cfg.video.vk.gpu_texture_decode &&
+			(flags == VK_IMAGE_ASPECT_COLOR_BIT || flags == VK_IMAGE_ASPECT_DEPTH_BIT) &&
+			get_gpu_decode_flags(format, decode_flags) &&
+			(is_swizzled || (decode_flags & (cs_texture_decode::swap_16bit_words | cs_texture_decode::swap_32bit_words)));
+
+		if (is_swizzled)
+		{
+			decode_flags |= cs_texture_decode::swizzled;
+		}
+
+		// Texel data is only read once the command buffer is submitted, so decoding is deferred until every copy is recorded
+		std::vector<gsl::span<gsl::byte>> dst_buffers;
+		std::vector<rsx_subresource_layout> src_layouts;
+
 		for (const rsx_subresource_layout &layout : subresource_layout)
 		{
 			u32 row_pitch = align(layout.width_in_block * block_size_in_bytes, 256);
 			u32 image_linear_size = row_pitch * layout.height_in_block * layout.depth;
 
+			if (gpu_decode && (is_swizzled || layout.width_in_block <= layout.pitch_in_block))
+			{
+				// Swizzled data spans the power-of-two extents of the level, linear data ends with the last texel of the last row
+				const u32 src_size = is_swizzled ?
+					u32{ block_size_in_bytes } << (rsx::ceil_log2(layout.width_in_block) + rsx::ceil_log2(layout.height_in_block) + rsx::ceil_log2(layout.depth)) :
+					((u32{ layout.height_in_block } * layout.depth - 1) * layout.pitch_in_block + layout.width_in_block) * block_size_in_bytes;
+				const u32 upload_size = align(src_size, 4);
+				const u32 dst_offset = align(src_size, 256);
+				auto scratch_buf = vk::get_scratch_buffer();
+
+				if ((u32)layout.data.size_bytes() >= src_size && (dst_offset + image_linear_size) <= scratch_buf->size())
+				{
+					size_t offset_in_buffer = upload_heap.alloc<512>(upload_size);
+					void *mapped_buffer = upload_heap.map(offset_in_buffer, upload_size);
+					std::memcpy(mapped_buffer, layout.data.data(), src_size);
+
+					// The previous level may still be reading from the scratch buffer
+					insert_buffer_memory_barrier(cmd, scratch_buf->value, 0, dst_offset + image_linear_size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+					VkBufferCopy copy = {};
+					copy.srcOffset = offset_in_buffer;
+					copy.dstOffset = 0;
+					copy.size = upload_size;
+
+					vkCmdCopyBuffer(cmd, upload_heap.heap->value, scratch_buf->value, 1, &copy);
+
+					insert_buffer_memory_barrier(cmd, scratch_buf->value, 0, upload_size, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+						VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+					vk::get_compute_task<vk::cs_texture_decode>()->run(cmd, scratch_buf, 0, dst_offset, row_pitch,
+						layout.width_in_block, layout.height_in_block, layout.depth, layout.pitch_in_block, decode_flags);
+
+					insert_buffer_memory_barrier(cmd, scratch_buf->value, dst_offset, image_linear_size, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+					VkBufferImageCopy copy_info = {};
+					copy_info.bufferOffset = dst_offset;
+					copy_info.imageExtent.height = layout.height_in_block;
+					copy_info.imageExtent.width = layout.width_in_block;
+					copy_info.imageExtent.depth = layout.depth;
+					copy_info.imageSubresource.aspectMask = flags;
+					copy_info.imageSubresource.layerCount = 1;
+					copy_info.imageSubresource.baseArrayLayer = mipmap_level / mipmap_count;
+					copy_info.imageSubresource.mipLevel = mipmap_level % mipmap_count;
+					copy_info.bufferRowLength = row_pitch / block_size_in_bytes;
+
+					vkCmdCopyBufferToImage(cmd, scratch_buf->value, dst_image->value, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_info);
+
+					mipmap_level++;
+					continue;
+				}
+			}
+
 			//Map with extra padding bytes in case of realignment
 			size_t offset_in_buffer = upload_heap.alloc<512>(image_linear_size + 8);
 			void *mapped_buffer = upload_heap.map(offset_in_buffer, image_linear_size + 8);
 			VkBuffer buffer_handle = upload_heap.heap->value;
 
-			gsl::span<gsl::byte> mapped{ (gsl::byte*)mapped_buffer, ::narrow<int>(image_linear_size) };
-			upload_texture_subresource(mapped, layout, format, is_swizzled, false, 256);
-			upload_heap.unmap();
+			dst_buffers.push_back({ (gsl::byte*)mapped_buffer, ::narrow<int>(image_linear_size) });
+			src_layouts.push_back(layout);
 
 			VkBufferImageCopy copy_info = {};
 			copy_info.bufferOffset = offset_in_buffer;
@@ -564,6 +668,9 @@ namespace vk
 
 			mipmap_level++;
 		}
+
+		upload_texture_subresources(dst_buffers, src_layouts, format, is_swizzled, false, 256);
+		upload_heap.unmap();
 	}
 
 	VkComponentMapping apply_swizzle_remap(const std::array<VkComponentSwizzle, 4>& base_remap, const std::pair<std::array<u8, 4>, std::array<u8, 4>>& remap_vector)
@@ -591,11 +698,100 @@ namespace vk
 		return{ final_mapping[1], final_mapping[2], final_mapping[3], final_mapping[0] };
 	}
 
+	// Consecutive blits between the same pair of images, recorded as one command with a single set of layout transitions
+	struct blit_batch
+	{
+		vk::command_buffer* cmd = nullptr;
+		vk::image* src = nullptr;
+		vk::image* dst = nullptr;
+		VkFilter filter = VK_FILTER_NEAREST;
+		bool is_copy = false;
+
+		std::vector<VkImageCopy> copies;
+		std::vector<VkImageBlit> blits;
+		std::vector<areai> dst_areas;
+
+		bool matches(const vk::command_buffer* _cmd, const vk::image* _src, const vk::image* _dst, bool _is_copy, VkFilter _filter, const areai& dst_area) const
+		{
+			if (cmd != _cmd || src != _src || dst != _dst || is_copy != _is_copy || (!is_copy && filter != _filter))
+			{
+				return false;
+			}
+
+			// Regions of one command are not ordered, overlapping writes have to go out separately
+			for (const auto& area : dst_areas)
+			{
+				if (area.x1 < dst_area.x2 && dst_area.x1 < area.x2 && area.y1 < dst_area.y2 && dst_area.y1 < area.y2)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void reset()
+		{
+			cmd = nullptr;
+			src = dst = nullptr;
+			copies.clear();
+			blits.clear();
+			dst_areas.clear();
+		}
+	};
+
+	static blit_batch g_pending_blits;
+
+	void flush_pending_blits()
+	{
+		auto& batch = g_pending_blits;
+		if (!batch.src)
+		{
+			return;
+		}
+
+		auto& cmd = *batch.cmd;
+		batch.src->push_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		batch.dst->push_layout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+		if (batch.is_copy)
+		{
+			vkCmdCopyImage(cmd, batch.src->value, batch.src->current_layout, batch.dst->value, batch.dst->current_layout,
+				(u32)batch.copies.size(), batch.copies.data());
+		}
+		else
+		{
+			vkCmdBlitImage(cmd, batch.src->value, batch.src->current_layout, batch.dst->value, batch.dst->current_layout,
+				(u32)batch.blits.size(), batch.blits.data(), batch.filter);
+		}
+
+		batch.dst->pop_layout(cmd);
+		batch.src->pop_layout(cmd);
+		batch.reset();
+	}
+
+	void discard_pending_blits()
+	{
+		g_pending_blits.reset();
+	}
+
 	void blitter::scale_image(vk::command_buffer& cmd, vk::image* src, vk::image* dst, areai src_area, areai dst_area, bool interpolate, bool /*is_depth*/, const rsx::typeless_xfer& xfer_info)
 	{
 		const auto src_aspect = vk::get_aspect_flags(src->info.format);
 		const auto dst_aspect = vk::get_aspect_flags(dst->info.format);
 
+		// Only plain color transfers between cached textures can be deferred; anything else goes out in order
+		const bool batchable = allow_batching && src != dst &&
+			!xfer_info.src_is_typeless && !xfer_info.dst_is_typeless &&
+			xfer_info.src_context != rsx::texture_upload_context::framebuffer_storage &&
+			xfer_info.dst_context != rsx::texture_upload_context::framebuffer_storage &&
+			src_aspect == VK_IMAGE_ASPECT_COLOR_BIT && dst_aspect == VK_IMAGE_ASPECT_COLOR_BIT;
+
+		if (!batchable)
+		{
+			flush_pending_blits();
+		}
+
 		vk::image* real_src = src;
 		vk::image* real_dst = dst;
 
@@ -705,6 +901,52 @@ namespace vk
 			src_area.flip_vertical();
 		}
 
+		if (batchable)
+		{
+			// Same selection as copy_scaled_image
+			const bool is_copy = src->info.format == dst->info.format && !src_area.is_flipped() && !dst_area.is_flipped() &&
+				src_area.width() == dst_area.width() && src_area.height() == dst_area.height();
+			const VkFilter filter = interpolate ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+			auto& batch = g_pending_blits;
+			if (!batch.matches(&cmd, src, dst, is_copy, filter, dst_area))
+			{
+				flush_pending_blits();
+
+				batch.cmd = &cmd;
+				batch.src = src;
+				batch.dst = dst;
+				batch.is_copy = is_copy;
+				batch.filter = filter;
+			}
+
+			const VkImageSubresourceLayers subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			if (is_copy)
+			{
+				VkImageCopy copy_rgn;
+				copy_rgn.srcOffset = { src_area.x1, src_area.y1, 0 };
+				copy_rgn.dstOffset = { dst_area.x1, dst_area.y1, 0 };
+				copy_rgn.srcSubresource = subresource;
+				copy_rgn.dstSubresource = subresource;
+				copy_rgn.extent = { (u32)src_area.width(), (u32)src_area.height(), 1 };
+				batch.copies.push_back(copy_rgn);
+			}
+			else
+			{
+				VkImageBlit rgn = {};
+				rgn.srcOffsets[0] = { src_area.x1, src_area.y1, 0 };
+				rgn.srcOffsets[1] = { src_area.x2, src_area.y2, 1 };
+				rgn.dstOffsets[0] = { dst_area.x1, dst_area.y1, 0 };
+				rgn.dstOffsets[1] = { dst_area.x2, dst_area.y2, 1 };
+				rgn.srcSubresource = subresource;
+				rgn.dstSubresource = subresource;
+				batch.blits.push_back(rgn);
+			}
+
+			batch.dst_areas.push_back(dst_area);
+			return;
+		}
+
 		copy_scaled_image(cmd, real_src->value, real_dst->value, real_src->current_layout, real_dst->current_layout,
 			src_area, dst_area, 1, dst_aspect, real_src->info.format == real_dst->info.format,
 			interpolate ? VK_FILTER_LINEAR : VK_FILTER_NEAREST, real_src->info.format, real_dst->info.format);
@@ -105,6 +105,7 @@ namespace vk
 			if (!exists())
 				return;
 
+			m_tex_cache->release_deduplicated_image(*this);
 			m_tex_cache->on_section_destroyed(*this);
 
 			vram_texture = nullptr;
@@ -138,7 +139,14 @@ namespace vk
 
 		vk::image* get_raw_texture()
 		{
-			return managed_texture.get();
+			// Deduplicated aliases sample an image held by another section
+			return (managed_texture || !content_hash) ? managed_texture.get() : vram_texture;
+		}
+
+		void transfer_image_ownership(cached_texture_section& other)
+		{
+			ASSERT(managed_texture && other.vram_texture == vram_texture && !other.managed_texture);
+			other.managed_texture = std::move(managed_texture);
 		}
 
 		std::unique_ptr<vk::viewable_image>& get_texture() 
@@ -176,6 +184,9 @@ namespace vk
 				m_device = &cmd.get_command_pool().get_owner();
 			}
 
+			// Blits into this section may still be waiting to be recorded
+			vk::flush_pending_blits();
+
 			if (dma_fence == VK_NULL_HANDLE)
 			{
 				VkEventCreateInfo createInfo = {};
@@ -308,14 +319,19 @@ namespace vk
 		{
 			AUDIT(synchronized);
 
-			// Synchronize, reset dma_fence after waiting
+			// Synchronize, dma_fence is reset once the section is fully flushed
 			vk::wait_for_event(dma_fence, GENERAL_WAIT_TIMEOUT);
-			vkResetEvent(*m_device, dma_fence);
 
 			return dma_buffer->map(offset, size);
 		}
 
 		void finish_flush()
+		{
+			vkResetEvent(*m_device, dma_fence);
+			finish_partial_flush();
+		}
+
+		void finish_partial_flush()
 		{
 			dma_buffer->unmap();
 
@@ -335,6 +351,11 @@ namespace vk
 			pack_unpack_swap_bytes = swap_bytes;
 		}
 
+		bool supports_partial_flush() const
+		{
+			return true;
+		}
+
 		bool is_synchronized() const
 		{
 			return synchronized;
@@ -477,6 +498,8 @@ namespace vk
 
 		void copy_transfer_regions_impl(vk::command_buffer& cmd, vk::image* dst, const std::vector<copy_region_descriptor>& sections_to_transfer) const
 		{
+			vk::flush_pending_blits();
+
 			const auto dst_aspect = dst->aspect();
 			const auto dst_bpp = vk::get_format_texel_width(dst->format());
 
@@ -672,6 +695,8 @@ namespace vk
 		vk::image_view* create_temporary_subresource_view_impl(vk::command_buffer& cmd, vk::image* source, VkImageType image_type, VkImageViewType view_type,
 			u32 gcm_format, u16 x, u16 y, u16 w, u16 h, const texture_channel_remap_t& remap_vector, bool copy)
 		{
+			vk::flush_pending_blits();
+
 			std::unique_ptr<vk::image> image;
 			std::unique_ptr<vk::image_view> view;
 
@@ -1016,6 +1041,36 @@ namespace vk
 			return section;
 		}
 
+		cached_texture_section* create_deduplicated_texture(vk::command_buffer& /*cmd*/, const utils::address_range& rsx_range, u64 content_hash, u16 width, u16 height, u16 depth, u16 mipmaps, u16 pitch,
+			u32 gcm_format, rsx::texture_dimension_extended type) override
+		{
+			cached_texture_section& region = *find_cached_texture(rsx_range, true, true, width, height, depth);
+			ASSERT(!region.is_locked());
+
+			// Looked up after find_cached_texture as reusing a section can destroy the previous owner
+			auto owner = get_deduplicated_image_owner(content_hash);
+			if (!owner)
+			{
+				return nullptr;
+			}
+
+			region.reset(rsx_range);
+			region.set_context(rsx::texture_upload_context::shader_read);
+			region.set_gcm_format(gcm_format);
+			region.set_image_type(type);
+
+			region.create(width, height, depth, mipmaps, owner->get_raw_texture(), pitch, false, gcm_format);
+			region.set_dirty(false);
+			register_deduplication_alias(region, content_hash);
+
+			region.protect(utils::protection::ro);
+			read_only_range = region.get_min_max(read_only_range, rsx::section_bounds::locked_range);
+
+			region.last_write_tag = owner->last_write_tag;
+			update_cache_tag();
+			return &region;
+		}
+
 		void enforce_surface_creation_type(cached_texture_section& section, u32 gcm_format, rsx::texture_create_flags expected_flags) override
 		{
 			if (expected_flags == section.get_view_flags())
@@ -1178,7 +1233,6 @@ namespace vk
 			});
 
 			m_temporary_subresource_cache.clear();
-			reset_frame_statistics();
 
 			baseclass::on_frame_end();
 		}
@@ -1239,6 +1293,7 @@ namespace vk
 		bool blit(rsx::blit_src_info& src, rsx::blit_dst_info& dst, bool interpolate, rsx::vk_render_targets& m_rtts, vk::command_buffer& cmd)
 		{
 			blitter helper;
+			helper.allow_batching = true;
 			auto reply = upload_scaled_image(src, dst, interpolate, cmd, m_rtts, helper);
 
 			if (reply.succeeded)
@@ -244,6 +244,9 @@ vk::vertex_upload_info VKGSRender::upload_vertex_data()
 	u32 persistent_range_base = UINT32_MAX, volatile_range_base = UINT32_MAX;
 	size_t persistent_offset = UINT64_MAX, volatile_offset = UINT64_MAX;
 
+	// Persistent data lives in the persistent vertex cache heap instead of the attribute ring
+	bool persistent_cached = false;
+
 	if (required.first > 0)
 	{
 		//Check if cacheable
@@ -259,7 +262,27 @@ vk::vertex_upload_info VKGSRender::upload_vertex_data()
 			const auto data_offset = (vertex_base * m_vertex_layout.interleaved_blocks[0].attribute_stride);
 			storage_address = m_vertex_layout.interleaved_blocks[0].real_offset_address + data_offset;
 
-			if (auto cached = m_vertex_cache->find_vertex_range(storage_address, VK_FORMAT_R8_UINT, required.first))
+			const u64 layout = m_vertex_layout.interleaved_blocks[0].layout_signature();
+			u32 cached_offset;
+
+			if (m_persistent_vertex_cache && m_persistent_vertex_cache->find_vertex_range(storage_address, VK_FORMAT_R8_UINT, required.first, layout, cached_offset))
+			{
+				in_cache = true;
+				persistent_cached = true;
+				persistent_range_base = cached_offset;
+			}
+			else if (m_persistent_vertex_cache && m_persistent_vertex_cache->store_range(storage_address, VK_FORMAT_R8_UINT, required.first, layout, 256, cached_offset))
+			{
+				// Guest memory is protected now, the data can be written once
+				void *cache_mapping = m_vertex_cache_storage->map(cached_offset, required.first);
+				write_vertex_data_to_memory(m_vertex_layout, vertex_base, vertex_count, cache_mapping, nullptr);
+				m_vertex_cache_storage->unmap();
+
+				in_cache = true;
+				persistent_cached = true;
+				persistent_range_base = cached_offset;
+			}
+			else if (auto cached = m_vertex_cache->find_vertex_range(storage_address, VK_FORMAT_R8_UINT, required.first))
 			{
 				verify(HERE), cached->local_address == storage_address;
 
@@ -322,7 +345,11 @@ vk::vertex_upload_info VKGSRender::upload_vertex_data()
 
 	if (persistent_range_base != UINT32_MAX)
 	{
-		if (!m_persistent_attribute_storage || !m_persistent_attribute_storage->in_range(persistent_range_base, required.first, persistent_range_base))
+		const VkBuffer persistent_heap = persistent_cached ? m_vertex_cache_storage->value : m_attrib_ring_info.heap->value;
+		const size_t persistent_heap_size = persistent_cached ? m_vertex_cache_storage->size() : m_attrib_ring_info.size();
+
+		if (!m_persistent_attribute_storage || m_persistent_attribute_storage->info.buffer != persistent_heap ||
+			!m_persistent_attribute_storage->in_range(persistent_range_base, required.first, persistent_range_base))
 		{
 			verify("Incompatible driver (MacOS?)" HERE), m_texbuffer_view_size >= required.first;
 
@@ -330,15 +357,16 @@ vk::vertex_upload_info VKGSRender::upload_vertex_data()
 				m_current_frame->buffer_views_to_clean.push_back(std::move(m_persistent_attribute_storage));
 
 			//View 64M blocks at a time (different drivers will only allow a fixed viewable heap size, 64M should be safe)
-			const size_t view_size = (persistent_range_base + m_texbuffer_view_size) > m_attrib_ring_info.size() ? m_attrib_ring_info.size() - persistent_range_base : m_texbuffer_view_size;
-			m_persistent_attribute_storage = std::make_unique<vk::buffer_view>(*m_device, m_attrib_ring_info.heap->value, VK_FORMAT_R8_UINT, persistent_range_base, view_size);
+			const size_t view_size = (persistent_range_base + m_texbuffer_view_size) > persistent_heap_size ? persistent_heap_size - persistent_range_base : m_texbuffer_view_size;
+			m_persistent_attribute_storage = std::make_unique<vk::buffer_view>(*m_device, persistent_heap, VK_FORMAT_R8_UINT, persistent_range_base, view_size);
 			persistent_range_base = 0;
 		}
 	}
 
 	if (volatile_range_base != UINT32_MAX)
 	{
-		if (!m_volatile_attribute_storage || !m_volatile_attribute_storage->in_range(volatile_range_base, required.second, volatile_range_base))
+		if (!m_volatile_attribute_storage || m_volatile_attribute_storage->info.buffer != m_attrib_ring_info.heap->value ||
+			!m_volatile_attribute_storage->in_range(volatile_range_base, required.second, volatile_range_base))
 		{
 			verify("Incompatible driver (MacOS?)" HERE), m_texbuffer_view_size >= required.second;
 
@@ -352,11 +352,26 @@ VKVertexProgram::~VKVertexProgram()
 
 void VKVertexProgram::Decompile(const RSXVertexProgram& prog)
 {
+	auto& cache = rsx::get_decompiled_program_cache();
+	const u64 key = rsx::decompiled_program_cache::get_key(prog, vk::get_decompiler_device_key());
+
+	rsx::decompiled_program cached;
+	if (cache.find(key, cached))
+	{
+		vk::import_program_bindings(cached, uniforms);
+		shader.create(::glsl::program_domain::glsl_vertex_program, cached.source);
+		return;
+	}
+
 	std::string source;
 	VKVertexDecompilerThread decompiler(prog, source, parr, *this);
 	decompiler.Task();
 
 	shader.create(::glsl::program_domain::glsl_vertex_program, source);
+
+	cached.source = std::move(source);
+	vk::export_program_bindings(uniforms, cached);
+	cache.store(key, cached);
 }
 
 void VKVertexProgram::Compile()
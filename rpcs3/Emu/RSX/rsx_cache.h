@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include "Utilities/VirtualMemory.h"
 #include "Utilities/hash.h"
+#include "Utilities/mutex.h"
+#include "Utilities/Thread.h"
 #include "Emu/Memory/vm.h"
 #include "gcm_enums.h"
 #include "Common/ProgramStateCache.h"
@@ -10,6 +12,9 @@
 
 #include "rsx_utils.h"
 #include <thread>
+#include <map>
+#include <list>
+#include <unordered_set>
 
 namespace rsx
 {
@@ -27,18 +32,117 @@ namespace rsx
 		confirmed_range
 	};
 
-	static inline void memory_protect(const address_range& range, utils::protection prot)
+	// Non-overlapping page ranges with protection (start -> end, protection)
+	class protection_map
+	{
+		std::map<u32, std::pair<u32, utils::protection>> m_map;
+
+	public:
+		// Drop ranges inside the range (splitting partially covered ranges)
+		void cut(u32 start, u32 end);
+
+		// Set protection of the range, merging it with adjacent ranges with the same protection
+		void set(u32 start, u32 end, utils::protection prot);
+
+		// Check if any part of the range has specified protection
+		bool test(u32 start, u32 end, utils::protection prot) const;
+
+		// First range ending at or after the address
+		std::map<u32, std::pair<u32, utils::protection>>::const_iterator find(u32 start) const;
+
+		auto begin() const { return m_map.begin(); }
+		auto end() const { return m_map.end(); }
+		bool empty() const { return m_map.empty(); }
+		void clear() { m_map.clear(); }
+	};
+
+	// Batch of deferred page protection changes, adjacent ranges with the same protection are merged
+	class protection_batch
+	{
+		shared_mutex m_mutex;
+
+		// Pending changes
+		protection_map m_pending;
+
+		// Write tracking: protection requested by the texture cache (ro ranges are left writable and tracked instead)
+		protection_map m_tracked;
+
+		// Write tracking status (0: not checked, 1: disabled, 2: enabled)
+		u8 m_tracking = 0;
+
+		// Ranges written through the sudo mapping since the last poll (reported by mark_written)
+		std::vector<address_range> m_written;
+
+		// Protection requested by the texture cache where it is not rw
+		protection_map m_requested;
+
+		// Ranges write-protected for the persistent vertex cache on top of the texture cache protection
+		protection_map m_vertex_locked;
+
+		// Ranges write-protected for the fragment program analysis cache, same rules as vertex cache ranges
+		protection_map m_program_locked;
+
+		bool is_tracking();
+
+		// Apply protection, keeping vertex cache and program ranges write-protected when it is loosened to rw
+		void apply(u32 start, u32 end, utils::protection prot);
+		void apply_locked(const protection_map& locked, u32 start, u32 end);
+
+		void lock_range(protection_map& locked, const address_range& range);
+		void unlock_range(protection_map& locked, const address_range& range);
+
+	public:
+		// Queue protection change, or apply it immediately (cancelling pending changes in the range)
+		void protect(const address_range& range, utils::protection prot, bool defer);
+
+		// Apply all pending changes
+		void flush();
+
+		// Drop pending changes of memory being mapped or unmapped without applying them
+		void discard(const address_range& range);
+
+		// Get write-tracked ranges written since the last call (they stop being tracked)
+		// Called every frame; resetting the dirty bits write-protects the whole process, so every written page faults once in the kernel afterwards
+		void poll_written(std::vector<address_range>& result);
+
+		// Report a write made through vm::g_sudo_addr, the dirty bits of the vm::base() mapping don't see it
+		void mark_written(const address_range& range);
+
+		// Write-protect a page range for the vertex cache (stricter texture cache protection is kept)
+		void lock_vertex_range(const address_range& range);
+
+		// Release vertex cache protection, restoring the protection requested by the texture cache
+		void unlock_vertex_range(const address_range& range);
+
+		// Forget vertex cache protection of unmapped memory without touching the pages
+		void discard_vertex_range(const address_range& range);
+
+		// Same as the vertex range functions, for the fragment program analysis cache
+		void lock_program_range(const address_range& range);
+		void unlock_program_range(const address_range& range);
+		void discard_program_range(const address_range& range);
+	};
+
+	extern protection_batch g_protection_batch;
+
+	// Deferred changes are only applied by memory_protect_flush(), only use it for protection tightening
+	static inline void memory_protect(const address_range& range, utils::protection prot, bool defer = false)
 	{
 		verify(HERE), range.is_page_range();
 
 		//LOG_ERROR(RSX, "memory_protect(0x%x, 0x%x, %x)", static_cast<u32>(range.start), static_cast<u32>(range.length()), static_cast<u32>(prot));
-		utils::memory_protect(vm::base(range.start), range.length(), prot);
+		g_protection_batch.protect(range, prot, defer);
 
 #ifdef TEXTURE_CACHE_DEBUG
 		tex_cache_checker.set_protection(range, prot);
 #endif
 	}
 
+	static inline void memory_protect_flush()
+	{
+		g_protection_batch.flush();
+	}
+
 	class buffered_section
 	{
 	public:
@@ -128,7 +232,12 @@ namespace rsx
 			}
 #endif // TEXTURE_CACHE_DEBUG
 
-			rsx::memory_protect(locked_range, new_prot);
+			// Optionally, tightening protection of the section waits until the next flush (end of draw or flip)
+			// CPU writes to fresh uploads and reads of readback sections are missed until then
+			const bool defer = g_cfg.video.deferred_protection && new_prot != utils::protection::rw &&
+				(protection == utils::protection::rw || new_prot == utils::protection::no);
+
+			rsx::memory_protect(locked_range, new_prot, defer);
 			protection = new_prot;
 			locked = (protection != utils::protection::rw);
 
@@ -414,6 +523,58 @@ namespace rsx
 		std::string version_prefix;
 		std::string root_path;
 		std::string pipeline_class_name;
+
+		// Pack file layout: a pack_header followed by records, each made of a pack_record_header and its payload
+		// Records are only ever appended; a program is written once and shared by every pipeline using it
+		enum pack_record_type : u32
+		{
+			pack_vertex_program = 1,
+			pack_fragment_program = 2,
+			pack_pipeline = 3,
+			pack_pipeline_usage = 4,
+		};
+
+		struct pack_header
+		{
+			u64 magic;
+			u32 version;
+			u32 reserved;
+		};
+
+		struct pack_record_header
+		{
+			u32 type;
+			u32 size;
+			u64 hash;
+		};
+
+		// Appended once per session for every pipeline the title used, the last record of a pipeline wins
+		struct pipeline_usage
+		{
+			u32 first_frame; // Flip count when the pipeline was first used in the session
+			u32 use_count;   // Number of sessions that used the pipeline
+		};
+
+		static constexpr u64 pack_magic = 0x4B50533353435052ull; // "RPCS3SPK"
+		static constexpr u32 pack_version = 1;
+
+		// Pipelines first used later than this (about a minute at 60 fps) are linked in the background after loading
+		static constexpr u32 hot_frame_limit = 3600;
+
+		std::string pack_path;
+		fs::file m_pack;
+		shared_mutex m_pack_mutex;
+
+		// Index of the records present in the pack
+		std::unordered_set<u64> m_packed_vertex_programs;
+		std::unordered_set<u64> m_packed_fragment_programs;
+		std::unordered_set<u64> m_packed_pipelines;
+
+		std::unordered_map<u64, pipeline_usage> m_pipeline_usage;
+		std::unordered_set<u64> m_used_pipelines; // Pipelines whose usage was recorded in this session
+
+		// Program ucode, only kept around while loading
+		std::unordered_map<u64, std::vector<u32>> vertex_program_data;
 		std::unordered_map<u64, std::vector<u8>> fragment_program_data;
 
 		backend_storage& m_storage;
@@ -508,6 +669,7 @@ namespace rsx
 			if (!g_cfg.video.disable_on_disk_shader_cache)
 			{
 				root_path = Emu.PPUCache() + "shaders_cache";
+				pack_path = root_path + "/" + pipeline_class_name + "-" + version_prefix + ".pack";
 			}
 		}
 
@@ -519,37 +681,22 @@ namespace rsx
 				return;
 			}
 
-			std::string directory_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix;
-
-			if (!fs::is_dir(directory_path))
+			std::vector<pipeline_data> pipelines;
 			{
-				fs::create_path(directory_path);
-				fs::create_path(root_path + "/raw");
-
-				return;
+				std::lock_guard lock(m_pack_mutex);
+				open_pack(pipelines);
+				import_legacy_cache(pipelines);
 			}
 
-			fs::dir root = fs::dir(directory_path);
-
-			u32 entry_count = 0;
-			std::vector<fs::dir_entry> entries;
-			for (auto It = root.begin(); It != root.end(); ++It, entry_count++)
+			u32 entry_count = u32(pipelines.size());
+			if (entry_count == 0)
 			{
-				fs::dir_entry tmp = *It;
-
-				if (tmp.name == "." || tmp.name == "..")
-					continue;
-
-				entries.push_back(tmp);
-			}
-
-			if ((entry_count = (u32)entries.size()) <= 2)
+				vertex_program_data.clear();
+				fragment_program_data.clear();
 				return;
+			}
 
-			root.rewind();
-
-			// Invalid pipeline entries to be removed
-			std::vector<std::string> invalid_entries;
+			const u32 hot_count = sort_by_usage(pipelines);
 
 			// Progress dialog
 			std::unique_ptr<progress_dialog_helper> fallback_dlg;
@@ -565,96 +712,113 @@ namespace rsx
 			dlg->update_msg(0, 0, entry_count);
 			dlg->update_msg(1, 0, entry_count);
 
-			// Setup worker threads
-			unsigned nb_threads = std::thread::hardware_concurrency();
-			std::vector<std::thread> worker_threads(nb_threads);
+			// One worker per pool thread, the compile budget limits how many run at once
+			const u32 nb_threads = worker_pool::get().size();
 
-			// Preload everything needed to compile the shaders
-			// Can probably be parallelized too, but since it's mostly reading files it's probably not worth it
-			std::vector<std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram>> unpacked;
-			std::chrono::time_point<steady_clock> last_update;
-			u32 processed_since_last_update = 0;
-
-			for (u32 i = 0; (i < entry_count) && !Emu.IsStopped(); i++)
+			// Runs worker on the pool, updating progress bar 'index' from the shared counter while waiting
+			// Progress is reported as base + processed out of total
+			auto run_workers = [&](u32 index, atomic_t<u32>& processed, u32 count, u32 base, u32 total, const std::function<void()>& worker)
 			{
-				fs::dir_entry tmp = entries[i];
+				worker_pool::group workers;
+				worker_pool::get().submit_n(worker_priority::compile, nb_threads, worker, &workers);
+
+				u32 current_progress = 0;
+				u32 last_update_progress = 0;
 
-				const auto filename = directory_path + "/" + tmp.name;
-				std::vector<u8> bytes;
-				fs::file f(filename);
-				if (f.size() != sizeof(pipeline_data))
+				while ((current_progress < count) && !Emu.IsStopped())
 				{
-					LOG_ERROR(RSX, "Cached pipeline object %s is not binary compatible with the current shader cache", tmp.name.c_str());
-					invalid_entries.push_back(filename);
-					continue;
-				}
-				f.read<u8>(bytes, f.size());
+					std::this_thread::sleep_for(100ms); // Around 10fps should be good enough
 
-				auto entry = unpack(*(pipeline_data*)bytes.data());
-				m_storage.preload_programs(std::get<1>(entry), std::get<2>(entry));
-				unpacked.push_back(entry);
+					current_progress = std::min(processed.load(), count);
+					const u32 processed_since_last_update = current_progress - last_update_progress;
+					last_update_progress = current_progress;
 
-				// Only update the screen at about 10fps since updating it everytime slows down the process
-				std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
-				processed_since_last_update++;
-				if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (i == entry_count - 1))
-				{
-					dlg->update_msg(0, i + 1, entry_count);
-					dlg->inc_value(0, processed_since_last_update);
-					last_update = now;
-					processed_since_last_update = 0;
+					if (processed_since_last_update > 0)
+					{
+						dlg->update_msg(index, base + current_progress, total);
+						dlg->inc_value(index, processed_since_last_update);
+					}
 				}
-			}
 
-			// Account for any invalid entries
-			entry_count = u32(unpacked.size());
+				// Need to wait for the jobs to be absolutely sure the work is done
+				workers.wait();
+			};
+
+			// Unpack all entries in parallel, the pack has already been validated
+			std::vector<std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram>> unpacked(entry_count);
 
-			atomic_t<u32> processed(0);
-			std::function<void(u32)> shader_comp_worker = [&](u32 index)
+			atomic_t<u32> loaded(0);
+			run_workers(0, loaded, entry_count, 0, entry_count, [&]()
 			{
 				u32 pos;
-				while (((pos = processed++) < entry_count) && !Emu.IsStopped())
+				while (((pos = loaded++) < entry_count) && !Emu.IsStopped())
 				{
-					auto& entry = unpacked[pos];
-					m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
+					unpacked[pos] = unpack(pipelines[pos]);
 				}
-			};
+			});
 
-			if (g_cfg.video.renderer == video_renderer::vulkan)
+			// Decompile the programs. Cache slots are reserved serially, the decompilation itself runs on all threads
+			std::vector<std::function<void()>> decompile_tasks;
+			for (auto& entry : unpacked)
 			{
-				// Start workers
-				for (u32 i = 0; i < nb_threads; i++)
-				{
-					worker_threads[i] = std::thread(shader_comp_worker, i);
-				}
+				m_storage.get_preload_tasks(std::get<1>(entry), std::get<2>(entry), decompile_tasks);
+			}
 
-				// Wait for the workers to finish their task while updating UI
-				u32 current_progress = 0;
-				u32 last_update_progress = 0;
+			// Decompilation is accounted for in the loading bar
+			const u32 task_count = u32(decompile_tasks.size());
+			dlg->set_limit(0, entry_count + task_count);
+			dlg->set_limit(1, hot_count);
+			dlg->update_msg(1, 0, hot_count);
 
-				while ((current_progress < entry_count) && !Emu.IsStopped())
+			atomic_t<u32> processed(0);
+			if (g_cfg.video.renderer != video_renderer::opengl)
+			{
+				atomic_t<u32> decompiled(0);
+				run_workers(0, decompiled, task_count, entry_count, entry_count + task_count, [&]()
 				{
-					std::this_thread::sleep_for(100ms); // Around 10fps should be good enough
-
-					current_progress = std::min(processed.load(), entry_count);
-					processed_since_last_update = current_progress - last_update_progress;
-					last_update_progress = current_progress;
-
-					if (processed_since_last_update > 0)
+					u32 pos;
+					while (((pos = decompiled++) < task_count) && !Emu.IsStopped())
 					{
-						dlg->update_msg(1, current_progress, entry_count);
-						dlg->inc_value(1, processed_since_last_update);
+						decompile_tasks[pos]();
 					}
-				}
+				});
 
-				// Need to join the threads to be absolutely sure shader compilation is done.
-				for (std::thread& worker_thread : worker_threads)
-					worker_thread.join();
+				run_workers(1, processed, hot_count, 0, hot_count, [&]()
+				{
+					u32 pos;
+					while (((pos = processed++) < hot_count) && !Emu.IsStopped())
+					{
+						auto& entry = unpacked[pos];
+						m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
+					}
+				});
 			}
 			else
 			{
+				std::chrono::time_point<steady_clock> last_update;
+				u32 processed_since_last_update = 0;
+
+				// Program objects belong to the context of this thread
+				for (u32 i = 0; (i < task_count) && !Emu.IsStopped(); i++)
+				{
+					decompile_tasks[i]();
+
+					// Update screen at about 10fps
+					std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
+					processed_since_last_update++;
+					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (i == task_count - 1))
+					{
+						dlg->update_msg(0, entry_count + i + 1, entry_count + task_count);
+						dlg->inc_value(0, processed_since_last_update);
+						last_update = now;
+						processed_since_last_update = 0;
+					}
+				}
+
+				processed_since_last_update = 0;
+
 				u32 pos;
-				while (((pos = processed++) < entry_count) && !Emu.IsStopped())
+				while (((pos = processed++) < hot_count) && !Emu.IsStopped())
 				{
 					auto& entry = unpacked[pos];
 					m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
@@ -662,9 +826,9 @@ namespace rsx
 					// Update screen at about 10fps
 					std::chrono::time_point<steady_clock> now = std::chrono::steady_clock::now();
 					processed_since_last_update++;
-					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (pos == entry_count - 1))
+					if ((std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update) > 100ms) || (pos == hot_count - 1))
 					{
-						dlg->update_msg(1, pos + 1, entry_count);
+						dlg->update_msg(1, pos + 1, hot_count);
 						dlg->inc_value(1, processed_since_last_update);
 						last_update = now;
 						processed_since_last_update = 0;
@@ -672,21 +836,46 @@ namespace rsx
 				}
 			}
 
-			if (!invalid_entries.empty())
+			// The remaining pipelines are linked by the asynchronous compiler while the title runs
+			for (u32 pos = hot_count; pos < entry_count; ++pos)
 			{
-				for (const auto &filename : invalid_entries)
-				{
-					fs::remove_file(filename);
-				}
+				auto& entry = unpacked[pos];
+				m_storage.add_deferred_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry));
+			}
 
-				LOG_NOTICE(RSX, "shader cache: %d entries were marked as invalid and removed", invalid_entries.size());
+			if (hot_count < entry_count)
+			{
+				LOG_NOTICE(RSX, "shader cache: %u of %u pipelines left to the background compiler", entry_count - hot_count, entry_count);
 			}
 
+			// The program caches hold their own copies of the ucode
+			unpacked.clear();
+			vertex_program_data.clear();
+			fragment_program_data.clear();
+
 			dlg->refresh();
 			dlg->close();
 		}
 
-		void store(pipeline_storage_type &pipeline, RSXVertexProgram &vp, RSXFragmentProgram &fp)
+		// Records the first use in this session of a pipeline that is already in the pack
+		void record_use(pipeline_storage_type &pipeline, RSXVertexProgram &vp, RSXFragmentProgram &fp, u32 frame)
+		{
+			if (g_cfg.video.disable_on_disk_shader_cache || vp.jump_table.size() > 32)
+			{
+				return;
+			}
+
+			const u64 pipeline_key = get_pipeline_key(pack(pipeline, vp, fp));
+
+			std::lock_guard lock(m_pack_mutex);
+
+			if (m_pack && m_packed_pipelines.count(pipeline_key))
+			{
+				append_usage(pipeline_key, frame);
+			}
+		}
+
+		void store(pipeline_storage_type &pipeline, RSXVertexProgram &vp, RSXFragmentProgram &fp, u32 frame)
 		{
 			if (g_cfg.video.disable_on_disk_shader_cache)
 			{
@@ -700,48 +889,40 @@ namespace rsx
 			}
 
 			pipeline_data data = pack(pipeline, vp, fp);
-			std::string fp_name = root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash);
-			std::string vp_name = root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash);
+			const u64 pipeline_key = get_pipeline_key(data);
+
+			std::lock_guard lock(m_pack_mutex);
 
-			if (!fs::is_file(fp_name))
+			if (!m_pack && !open_pack_for_append())
 			{
-				fs::file(fp_name, fs::rewrite).write(fp.addr, fp.ucode_length);
+				return;
 			}
 
-			if (!fs::is_file(vp_name))
+			if (!m_packed_pipelines.insert(pipeline_key).second)
 			{
-				fs::file(vp_name, fs::rewrite).write<u32>(vp.data);
+				// Already stored
+				append_usage(pipeline_key, frame);
+				return;
 			}
 
-			u64 state_hash = 0;
-			state_hash ^= rpcs3::hash_base<u32>(data.vp_ctrl);
-			state_hash ^= rpcs3::hash_base<u32>(data.fp_ctrl);
-			state_hash ^= rpcs3::hash_base<u32>(data.vp_texture_dimensions);
-			state_hash ^= rpcs3::hash_base<u32>(data.fp_texture_dimensions);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_unnormalized_coords);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_height);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_pixel_layout);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_lighting_flags);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_shadow_textures);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_redirected_textures);
-			state_hash ^= rpcs3::hash_base<u16>(data.fp_alphakill_mask);
-			state_hash ^= rpcs3::hash_base<u64>(data.fp_zfunc_mask);
+			if (m_packed_vertex_programs.insert(data.vertex_program_hash).second)
+			{
+				append_record(m_pack, pack_vertex_program, data.vertex_program_hash, vp.data.data(), u32(vp.data.size() * sizeof(u32)));
+			}
+
+			if (m_packed_fragment_programs.insert(data.fragment_program_hash).second)
+			{
+				append_record(m_pack, pack_fragment_program, data.fragment_program_hash, fp.addr, fp.ucode_length);
+			}
 
-			std::string pipeline_file_name = fmt::format("%llX+%llX+%llX+%llX.bin", data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, state_hash);
-			std::string pipeline_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix + "/" + pipeline_file_name;
-			fs::file(pipeline_path, fs::rewrite).write(&data, sizeof(pipeline_data));
+			append_record(m_pack, pack_pipeline, pipeline_key, &data, sizeof(pipeline_data));
+			append_usage(pipeline_key, frame);
 		}
 
 		RSXVertexProgram load_vp_raw(u64 program_hash)
 		{
-			std::vector<u32> data;
-			std::string filename = fmt::format("%llX.vp", program_hash);
-
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u32>(data, f.size() / sizeof(u32));
-
 			RSXVertexProgram vp = {};
-			vp.data = data;
+			vp.data = vertex_program_data.at(program_hash);
 			vp.skip_vertex_input_check = true;
 
 			return vp;
@@ -749,16 +930,11 @@ namespace rsx
 
 		RSXFragmentProgram load_fp_raw(u64 program_hash)
 		{
-			std::vector<u8> data;
-			std::string filename = fmt::format("%llX.fp", program_hash);
-
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u8>(data, f.size());
+			const auto& ucode = fragment_program_data.at(program_hash);
 
 			RSXFragmentProgram fp = {};
-			fragment_program_data[program_hash] = data;
-			fp.addr = fragment_program_data[program_hash].data();
-			fp.ucode_length = (u32)data.size();
+			fp.addr = const_cast<u8*>(ucode.data());
+			fp.ucode_length = (u32)ucode.size();
 
 			return fp;
 		}
@@ -857,71 +1033,967 @@ namespace rsx
 
 			return data_block;
 		}
-	};
 
-	namespace vertex_cache
-	{
-		// A null vertex cache
-		template <typename storage_type, typename upload_format>
-		class default_vertex_cache
+	private:
+		void append_usage(u64 pipeline_key, u32 frame)
 		{
-		public:
-			virtual ~default_vertex_cache() = default;
-			virtual storage_type* find_vertex_range(uintptr_t /*local_addr*/, upload_format, u32 /*data_length*/) { return nullptr; }
-			virtual void store_range(uintptr_t /*local_addr*/, upload_format, u32 /*data_length*/, u32 /*offset_in_heap*/) {}
-			virtual void purge() {}
-		};
+			if (!m_used_pipelines.insert(pipeline_key).second)
+			{
+				return;
+			}
 
-		// A weak vertex cache with no data checks or memory range locks
-		// Of limited use since contents are only guaranteed to be valid once per frame
-		// TODO: Strict vertex cache with range locks
-		template <typename upload_format>
-		struct uploaded_range
-		{
-			uintptr_t local_address;
-			upload_format buffer_format;
-			u32 offset_in_heap;
-			u32 data_length;
-		};
+			auto& usage = m_pipeline_usage[pipeline_key];
+			usage.first_frame = frame;
+			usage.use_count++;
 
-		template <typename upload_format>
-		class weak_vertex_cache : public default_vertex_cache<uploaded_range<upload_format>, upload_format>
-		{
-			using storage_type = uploaded_range<upload_format>;
+			append_record(m_pack, pack_pipeline_usage, pipeline_key, &usage, sizeof(pipeline_usage));
+		}
 
-		private:
-			std::unordered_map<uintptr_t, std::vector<storage_type>> vertex_ranges;
+		// Orders the pipelines by the frame they were first needed in, the most used first among equals
+		// Returns how many of them have to be linked before the title starts
+		u32 sort_by_usage(std::vector<pipeline_data>& pipelines) const
+		{
+			if (m_pipeline_usage.empty())
+			{
+				// No usage recorded yet, keep the pack order and link everything upfront
+				return u32(pipelines.size());
+			}
 
-		public:
+			std::vector<std::pair<pipeline_usage, pipeline_data>> sorted;
+			sorted.reserve(pipelines.size());
 
-			storage_type* find_vertex_range(uintptr_t local_addr, upload_format fmt, u32 data_length) override
+			for (const auto& data : pipelines)
 			{
-				const auto data_end = local_addr + data_length;
+				const auto found = m_pipeline_usage.find(get_pipeline_key(data));
+				sorted.emplace_back(found != m_pipeline_usage.end() ? found->second : pipeline_usage{ UINT32_MAX, 0 }, data);
+			}
 
-				for (auto &v : vertex_ranges[local_addr])
+			std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b)
+			{
+				if (a.first.first_frame != b.first.first_frame)
 				{
-					// NOTE: This has to match exactly. Using sized shortcuts such as >= comparison causes artifacting in some applications (UC1)
-					if (v.buffer_format == fmt && v.data_length == data_length)
-						return &v;
+					return a.first.first_frame < b.first.first_frame;
 				}
 
-				return nullptr;
+				return a.first.use_count > b.first.use_count;
+			});
+
+			u32 hot_count = 0;
+			for (u32 i = 0; i < sorted.size(); ++i)
+			{
+				pipelines[i] = sorted[i].second;
+
+				if (sorted[i].first.first_frame <= hot_frame_limit)
+				{
+					hot_count++;
+				}
 			}
 
-			void store_range(uintptr_t local_addr, upload_format fmt, u32 data_length, u32 offset_in_heap) override
+			// Without the asynchronous compiler nothing would link the rest
+			if (g_cfg.video.disable_asynchronous_shader_compiler)
 			{
-				storage_type v = {};
-				v.buffer_format = fmt;
-				v.data_length = data_length;
-				v.local_address = local_addr;
-				v.offset_in_heap = offset_in_heap;
+				return u32(pipelines.size());
+			}
 
-				vertex_ranges[local_addr].push_back(v);
+			return hot_count;
+		}
+
+		// Identifies a pipeline entry, matches the file name of the legacy layout
+		static u64 get_pipeline_key(const pipeline_data& data)
+		{
+			u64 state_hash = 0;
+			state_hash ^= rpcs3::hash_base<u32>(data.vp_ctrl);
+			state_hash ^= rpcs3::hash_base<u32>(data.fp_ctrl);
+			state_hash ^= rpcs3::hash_base<u32>(data.vp_texture_dimensions);
+			state_hash ^= rpcs3::hash_base<u32>(data.fp_texture_dimensions);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_unnormalized_coords);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_height);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_pixel_layout);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_lighting_flags);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_shadow_textures);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_redirected_textures);
+			state_hash ^= rpcs3::hash_base<u16>(data.fp_alphakill_mask);
+			state_hash ^= rpcs3::hash_base<u64>(data.fp_zfunc_mask);
+
+			const std::array<u64, 4> key = { data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, state_hash };
+			return rpcs3::hash_struct(key);
+		}
+
+		// Writes the record header and payload with a single write so that an interrupted store leaves at most a truncated tail
+		static void append_record(const fs::file& pack, u32 type, u64 hash, const void* payload, u32 size)
+		{
+			std::vector<u8> record(sizeof(pack_record_header) + size);
+
+			const pack_record_header header = { type, size, hash };
+			std::memcpy(record.data(), &header, sizeof(pack_record_header));
+			std::memcpy(record.data() + sizeof(pack_record_header), payload, size);
+
+			pack.write(record);
+		}
+
+		// Parses the whole pack into the index and the program maps
+		// Returns false if anything had to be discarded, in which case the pack should be compacted
+		bool read_pack(const fs::file_view& bytes, std::vector<pipeline_data>& pipelines)
+		{
+			pack_header header;
+			if (bytes.size() < sizeof(pack_header) || (std::memcpy(&header, bytes.data(), sizeof(pack_header)), header.magic != pack_magic) || header.version != pack_version)
+			{
+				LOG_WARNING(RSX, "shader cache: %s is not a compatible pack file and will be replaced", pack_path);
+				return false;
 			}
 
-			void purge() override
+			bool clean = true;
+			u32 usage_records = 0;
+			size_t offset = sizeof(pack_header);
+
+			while (offset < bytes.size())
 			{
-				vertex_ranges.clear();
+				pack_record_header record;
+				if (bytes.size() - offset < sizeof(pack_record_header))
+				{
+					// Truncated record header
+					clean = false;
+					break;
+				}
+
+				std::memcpy(&record, bytes.data() + offset, sizeof(pack_record_header));
+				offset += sizeof(pack_record_header);
+
+				if (record.size > bytes.size() - offset)
+				{
+					// Truncated payload
+					clean = false;
+					break;
+				}
+
+				const u8* payload = bytes.data() + offset;
+				offset += record.size;
+
+				switch (record.type)
+				{
+				case pack_vertex_program:
+				{
+					if ((record.size % sizeof(u32)) != 0 || vertex_program_data.count(record.hash))
+					{
+						clean = false;
+						break;
+					}
+
+					auto& ucode = vertex_program_data[record.hash];
+					ucode.resize(record.size / sizeof(u32));
+					std::memcpy(ucode.data(), payload, record.size);
+					break;
+				}
+				case pack_fragment_program:
+				{
+					if (!fragment_program_data.try_emplace(record.hash, payload, payload + record.size).second)
+					{
+						clean = false;
+					}
+					break;
+				}
+				case pack_pipeline:
+				{
+					if (record.size != sizeof(pipeline_data) || !m_packed_pipelines.insert(record.hash).second)
+					{
+						clean = false;
+						break;
+					}
+
+					pipelines.emplace_back();
+					std::memcpy(&pipelines.back(), payload, sizeof(pipeline_data));
+					break;
+				}
+				case pack_pipeline_usage:
+				{
+					if (record.size != sizeof(pipeline_usage))
+					{
+						clean = false;
+						break;
+					}
+
+					std::memcpy(&m_pipeline_usage[record.hash], payload, sizeof(pipeline_usage));
+					usage_records++;
+					break;
+				}
+				default:
+					clean = false;
+					break;
+				}
+			}
+
+			// Drop pipelines whose programs never made it into the pack
+			const auto end = std::remove_if(pipelines.begin(), pipelines.end(), [&](const pipeline_data& data)
+			{
+				return !vertex_program_data.count(data.vertex_program_hash) || !fragment_program_data.count(data.fragment_program_hash);
+			});
+
+			if (end != pipelines.end())
+			{
+				for (auto It = end; It != pipelines.end(); ++It)
+				{
+					m_packed_pipelines.erase(get_pipeline_key(*It));
+				}
+
+				pipelines.erase(end, pipelines.end());
+				clean = false;
+			}
+
+			// Drop the usage of pipelines that are gone
+			for (auto It = m_pipeline_usage.begin(); It != m_pipeline_usage.end();)
+				It = m_packed_pipelines.count(It->first) ? std::next(It) : m_pipeline_usage.erase(It);
+
+			if (usage_records > 2 * std::max<size_t>(m_pipeline_usage.size(), 1))
+			{
+				// Compact the usage history once most records are outdated
+				clean = false;
+			}
+
+			// Drop programs no pipeline refers to
+			std::unordered_set<u64> used_vertex_programs, used_fragment_programs;
+			for (const auto& data : pipelines)
+			{
+				used_vertex_programs.insert(data.vertex_program_hash);
+				used_fragment_programs.insert(data.fragment_program_hash);
+			}
+
+			if (used_vertex_programs.size() != vertex_program_data.size() || used_fragment_programs.size() != fragment_program_data.size())
+			{
+				for (auto It = vertex_program_data.begin(); It != vertex_program_data.end();)
+					It = used_vertex_programs.count(It->first) ? std::next(It) : vertex_program_data.erase(It);
+
+				for (auto It = fragment_program_data.begin(); It != fragment_program_data.end();)
+					It = used_fragment_programs.count(It->first) ? std::next(It) : fragment_program_data.erase(It);
+
+				clean = false;
+			}
+
+			return clean;
+		}
+
+		// Rewrites the pack from the loaded index, dropping duplicate, orphaned and damaged records
+		void compact_pack(const std::vector<pipeline_data>& pipelines)
+		{
+			const std::string temp_path = pack_path + ".tmp";
+
+			{
+				fs::file pack(temp_path, fs::rewrite);
+				if (!pack)
+				{
+					LOG_ERROR(RSX, "shader cache: failed to create %s", temp_path);
+					return;
+				}
+
+				pack.write(pack_header{ pack_magic, pack_version, 0 });
+
+				for (const auto& program : vertex_program_data)
+				{
+					append_record(pack, pack_vertex_program, program.first, program.second.data(), u32(program.second.size() * sizeof(u32)));
+				}
+
+				for (const auto& program : fragment_program_data)
+				{
+					append_record(pack, pack_fragment_program, program.first, program.second.data(), u32(program.second.size()));
+				}
+
+				for (const auto& data : pipelines)
+				{
+					append_record(pack, pack_pipeline, get_pipeline_key(data), &data, sizeof(pipeline_data));
+				}
+
+				for (const auto& usage : m_pipeline_usage)
+				{
+					append_record(pack, pack_pipeline_usage, usage.first, &usage.second, sizeof(pipeline_usage));
+				}
+			}
+
+			if (!fs::rename(temp_path, pack_path, true))
+			{
+				LOG_ERROR(RSX, "shader cache: failed to replace %s", pack_path);
+				fs::remove_file(temp_path);
+			}
+		}
+
+		bool open_pack_for_append()
+		{
+			fs::create_path(root_path);
+
+			if (!m_pack.open(pack_path, fs::write + fs::create + fs::append))
+			{
+				LOG_ERROR(RSX, "shader cache: failed to open %s", pack_path);
+				return false;
+			}
+
+			if (m_pack.size() == 0)
+			{
+				m_pack.write(pack_header{ pack_magic, pack_version, 0 });
+			}
+
+			return true;
+		}
+
+		// Loads the pack, compacting it if needed, and leaves it open for store()
+		void open_pack(std::vector<pipeline_data>& pipelines)
+		{
+			m_pack.close();
+			m_packed_vertex_programs.clear();
+			m_packed_fragment_programs.clear();
+			m_packed_pipelines.clear();
+			m_pipeline_usage.clear();
+			m_used_pipelines.clear();
+
+			if (fs::is_file(pack_path))
+			{
+				bool clean = false;
+
+				// The view must be released before compacting replaces the file
+				if (fs::file pack{ pack_path })
+				{
+					clean = read_pack(pack.map(), pipelines);
+				}
+				else
+				{
+					clean = read_pack(fs::file_view{}, pipelines);
+				}
+
+				if (!clean)
+				{
+					LOG_NOTICE(RSX, "shader cache: compacting %s (%u pipelines kept)", pack_path, pipelines.size());
+					compact_pack(pipelines);
+				}
+			}
+
+			for (const auto& program : vertex_program_data)
+				m_packed_vertex_programs.insert(program.first);
+
+			for (const auto& program : fragment_program_data)
+				m_packed_fragment_programs.insert(program.first);
+
+			open_pack_for_append();
+		}
+
+		// Moves the pipelines of the old one-file-per-object layout into the pack
+		// The raw program files may be shared with other pipeline classes and are left in place
+		void import_legacy_cache(std::vector<pipeline_data>& pipelines)
+		{
+			const std::string directory_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix;
+			if (!m_pack || !fs::is_dir(directory_path))
+			{
+				return;
+			}
+
+			u32 imported = 0;
+			for (const auto& entry : fs::dir(directory_path))
+			{
+				if (entry.is_directory)
+				{
+					continue;
+				}
+
+				const std::string filename = directory_path + "/" + entry.name;
+				pipeline_data data;
+
+				if (fs::file f{ filename }; f && f.size() == sizeof(pipeline_data) && f.read(&data, sizeof(pipeline_data)) == sizeof(pipeline_data))
+				{
+					fs::file vp_file(root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash));
+					fs::file fp_file(root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash));
+
+					if (vp_file && fp_file && m_packed_pipelines.insert(get_pipeline_key(data)).second)
+					{
+						if (m_packed_vertex_programs.insert(data.vertex_program_hash).second)
+						{
+							auto& ucode = vertex_program_data[data.vertex_program_hash];
+							vp_file.read<u32>(ucode, vp_file.size() / sizeof(u32));
+							append_record(m_pack, pack_vertex_program, data.vertex_program_hash, ucode.data(), u32(ucode.size() * sizeof(u32)));
+						}
+
+						if (m_packed_fragment_programs.insert(data.fragment_program_hash).second)
+						{
+							auto& ucode = fragment_program_data[data.fragment_program_hash];
+							fp_file.read<u8>(ucode, fp_file.size());
+							append_record(m_pack, pack_fragment_program, data.fragment_program_hash, ucode.data(), u32(ucode.size()));
+						}
+
+						append_record(m_pack, pack_pipeline, get_pipeline_key(data), &data, sizeof(pipeline_data));
+						pipelines.push_back(data);
+						imported++;
+					}
+				}
+				else
+				{
+					LOG_ERROR(RSX, "Cached pipeline object %s is not binary compatible with the current shader cache", entry.name.c_str());
+				}
+
+				fs::remove_file(filename);
+			}
+
+			fs::remove_dir(directory_path);
+			LOG_NOTICE(RSX, "shader cache: imported %u pipelines from %s", imported, directory_path);
+		}
+	};
+
+	// Fragment program analysis results keyed by the ucode address
+	// The analysed ucode is write-protected and entries are dropped when it faults
+	class fragment_program_analysis_cache
+	{
+		using metadata_type = program_hash_util::fragment_program_utils::fragment_program_metadata;
+
+		struct entry_t
+		{
+			metadata_type metadata;
+			u64 ucode_hash;
+			address_range locked_range;
+		};
+
+		shared_mutex m_mutex;
+		std::unordered_map<u32, entry_t> m_entries;
+
+		// Write faults per address, programs rewritten too often are analysed on every use instead
+		std::unordered_map<u32, u32> m_write_count;
+
+		// Set when cached ucode is written to
+		atomic_t<bool> m_written{ false };
+
+		static constexpr u32 max_write_count = 4;
+
+		// Drop entries overlapping the range, returns the union of their locked ranges
+		address_range drop_overlapping(const address_range& range, bool written)
+		{
+			address_range dropped;
+
+			for (auto it = m_entries.begin(); it != m_entries.end();)
+			{
+				if (it->second.locked_range.overlaps(range))
+				{
+					if (written)
+					{
+						m_write_count[it->first]++;
+					}
+
+					dropped.set_min_max(it->second.locked_range);
+					it = m_entries.erase(it);
+				}
+				else
+				{
+					it++;
+				}
+			}
+
+			return dropped;
+		}
+
+		// Restore protection of pages still covered by other entries
+		void relock(const address_range& range)
+		{
+			for (const auto& e : m_entries)
+			{
+				if (e.second.locked_range.overlaps(range))
+				{
+					rsx::g_protection_batch.lock_program_range(e.second.locked_range.get_intersect(range));
+				}
+			}
+		}
+
+	public:
+		~fragment_program_analysis_cache()
+		{
+			purge();
+		}
+
+		bool find(u32 address, metadata_type& metadata, u64& ucode_hash)
+		{
+			reader_lock lock(m_mutex);
+
+			const auto found = m_entries.find(address);
+			if (found == m_entries.end())
+			{
+				return false;
+			}
+
+			metadata = found->second.metadata;
+			ucode_hash = found->second.ucode_hash;
+			return true;
+		}
+
+		// Keep the analysis and write-protect the ucode, returns false if the program can't be tracked
+		bool store(u32 address, const metadata_type& metadata, u64 ucode_hash)
+		{
+			const auto range = address_range::start_length(address, metadata.program_start_offset + metadata.program_ucode_length).to_page_range();
+
+			if (!range.valid() || !vm::check_addr(range.start, range.length()))
+			{
+				return false;
+			}
+
+			std::lock_guard lock(m_mutex);
+
+			if (auto found = m_write_count.find(address); found != m_write_count.end() && found->second >= max_write_count)
+			{
+				return false;
+			}
+
+			m_entries[address] = { metadata, ucode_hash, range };
+			rsx::g_protection_batch.lock_program_range(range);
+			return true;
+		}
+
+		// Check if cached ucode was written to since the last call
+		bool test_and_reset_written()
+		{
+			return m_written && m_written.exchange(false);
+		}
+
+		// Drop programs in a written page, returns false if the page isn't protected by the cache
+		bool on_access_violation(u32 address, bool is_writing)
+		{
+			if (!is_writing)
+			{
+				return false;
+			}
+
+			std::lock_guard lock(m_mutex);
+
+			const auto dropped = drop_overlapping(utils::page_for(address), true);
+
+			if (!dropped.valid())
+			{
+				return false;
+			}
+
+			rsx::g_protection_batch.unlock_program_range(dropped);
+			relock(dropped);
+
+			m_written = true;
+			return true;
+		}
+
+		// Drop programs of invalidated (possibly unmapped) memory
+		void invalidate_range(const address_range& range)
+		{
+			std::lock_guard lock(m_mutex);
+
+			const auto unmapped = range.to_page_range();
+			const auto dropped = drop_overlapping(unmapped, false);
+
+			if (!dropped.valid())
+			{
+				return;
+			}
+
+			m_written = true;
+
+			if (vm::check_addr(unmapped.start, unmapped.length()))
+			{
+				// Still mapped
+				rsx::g_protection_batch.unlock_program_range(dropped);
+				relock(dropped);
+				return;
+			}
+
+			rsx::g_protection_batch.discard_program_range(unmapped);
+
+			// Pages around the unmapped range are still mapped and must be released
+			if (dropped.start < unmapped.start)
+			{
+				const auto head = address_range::start_end(dropped.start, unmapped.start - 1);
+				rsx::g_protection_batch.unlock_program_range(head);
+				relock(head);
+			}
+
+			if (dropped.end > unmapped.end)
+			{
+				const auto tail = address_range::start_end(unmapped.end + 1, dropped.end);
+				rsx::g_protection_batch.unlock_program_range(tail);
+				relock(tail);
+			}
+		}
+
+		void purge()
+		{
+			std::lock_guard lock(m_mutex);
+
+			for (const auto& e : m_entries)
+			{
+				rsx::g_protection_batch.unlock_program_range(e.second.locked_range);
+			}
+
+			m_entries.clear();
+			m_write_count.clear();
+		}
+	};
+
+	namespace vertex_cache
+	{
+		// A null vertex cache
+		template <typename storage_type, typename upload_format>
+		class default_vertex_cache
+		{
+		public:
+			virtual ~default_vertex_cache() = default;
+			virtual storage_type* find_vertex_range(uintptr_t /*local_addr*/, upload_format, u32 /*data_length*/) { return nullptr; }
+			virtual void store_range(uintptr_t /*local_addr*/, upload_format, u32 /*data_length*/, u32 /*offset_in_heap*/) {}
+			virtual void purge() {}
+		};
+
+		// A weak vertex cache with no data checks or memory range locks
+		// Of limited use since contents are only guaranteed to be valid once per frame
+		// TODO: Strict vertex cache with range locks
+		template <typename upload_format>
+		struct uploaded_range
+		{
+			uintptr_t local_address;
+			upload_format buffer_format;
+			u32 offset_in_heap;
+			u32 data_length;
+		};
+
+		template <typename upload_format>
+		class weak_vertex_cache : public default_vertex_cache<uploaded_range<upload_format>, upload_format>
+		{
+			using storage_type = uploaded_range<upload_format>;
+
+		private:
+			std::unordered_map<uintptr_t, std::vector<storage_type>> vertex_ranges;
+
+		public:
+
+			storage_type* find_vertex_range(uintptr_t local_addr, upload_format fmt, u32 data_length) override
+			{
+				const auto data_end = local_addr + data_length;
+
+				for (auto &v : vertex_ranges[local_addr])
+				{
+					// NOTE: This has to match exactly. Using sized shortcuts such as >= comparison causes artifacting in some applications (UC1)
+					if (v.buffer_format == fmt && v.data_length == data_length)
+						return &v;
+				}
+
+				return nullptr;
+			}
+
+			void store_range(uintptr_t local_addr, upload_format fmt, u32 data_length, u32 offset_in_heap) override
+			{
+				storage_type v = {};
+				v.buffer_format = fmt;
+				v.data_length = data_length;
+				v.local_address = local_addr;
+				v.offset_in_heap = offset_in_heap;
+
+				vertex_ranges[local_addr].push_back(v);
+			}
+
+			void purge() override
+			{
+				vertex_ranges.clear();
+			}
+		};
+
+		// A vertex cache keeping data in a dedicated heap across frames
+		// Cached guest memory is write-protected and entries are dropped when it faults
+		// Space of dropped entries is only reused after the frames that may still read it have retired
+		template <typename upload_format>
+		class persistent_vertex_cache
+		{
+			struct entry_t
+			{
+				u32 local_address;
+				upload_format buffer_format;
+				u32 data_length;
+				u64 layout;
+				u32 offset_in_heap;
+				u32 allocated_length;
+				address_range locked_range;
+			};
+
+			using entry_list = std::list<entry_t>;
+
+			shared_mutex m_mutex;
+
+			// Most recently used first
+			entry_list m_entries;
+			std::unordered_multimap<u32, typename entry_list::iterator> m_lookup;
+
+			// Free heap blocks (offset -> length)
+			std::map<u32, u32> m_free;
+
+			// Blocks of dropped entries waiting for their frames to retire, one set per frame
+			std::vector<std::vector<std::pair<u32, u32>>> m_retired;
+			u32 m_retired_index = 0;
+
+			// Write faults per address, ranges written too often are rewritten every frame and not worth protecting
+			std::unordered_map<u32, u32> m_write_count;
+
+			static constexpr u32 max_write_count = 4;
+
+			void release(u32 offset, u32 length)
+			{
+				auto next = m_free.lower_bound(offset);
+
+				// Merge with the following block
+				if (next != m_free.end() && next->first == offset + length)
+				{
+					length += next->second;
+					next = m_free.erase(next);
+				}
+
+				// Merge with the preceding block
+				if (next != m_free.begin())
+				{
+					auto prev = std::prev(next);
+
+					if (prev->first + prev->second == offset)
+					{
+						prev->second += length;
+						return;
+					}
+				}
+
+				m_free.emplace_hint(next, offset, length);
+			}
+
+			void drop(typename entry_list::iterator it)
+			{
+				for (auto [found, end] = m_lookup.equal_range(it->local_address); found != end; found++)
+				{
+					if (found->second == it)
+					{
+						m_lookup.erase(found);
+						break;
+					}
+				}
+
+				m_retired[m_retired_index].emplace_back(it->offset_in_heap, it->allocated_length);
+				m_entries.erase(it);
+			}
+
+			// Drop entries overlapping the range, returns the union of their locked ranges
+			address_range drop_overlapping(const address_range& range, bool written)
+			{
+				address_range dropped;
+
+				for (auto it = m_entries.begin(); it != m_entries.end();)
+				{
+					if (it->locked_range.overlaps(range))
+					{
+						if (written)
+						{
+							// Entries are recreated with the same key
+							m_write_count[it->local_address]++;
+						}
+
+						dropped.set_min_max(it->locked_range);
+						drop(it++);
+					}
+					else
+					{
+						it++;
+					}
+				}
+
+				return dropped;
+			}
+
+			// Restore protection of pages still covered by other entries
+			void relock(const address_range& range)
+			{
+				for (const auto& e : m_entries)
+				{
+					if (e.locked_range.overlaps(range))
+					{
+						rsx::g_protection_batch.lock_vertex_range(e.locked_range.get_intersect(range));
+					}
+				}
+			}
+
+		public:
+			persistent_vertex_cache(u32 heap_size, u32 frames_in_flight)
+				: m_retired(frames_in_flight + 1)
+			{
+				m_free.emplace(0, heap_size);
+			}
+
+			~persistent_vertex_cache()
+			{
+				purge();
+			}
+
+			// Find cached data uploaded with the same vertex layout, returns its offset in the heap
+			bool find_vertex_range(u32 local_addr, upload_format fmt, u32 data_length, u64 layout, u32& offset_in_heap)
+			{
+				std::lock_guard lock(m_mutex);
+
+				for (auto [found, end] = m_lookup.equal_range(local_addr); found != end; found++)
+				{
+					const auto it = found->second;
+
+					if (it->buffer_format == fmt && it->data_length == data_length && it->layout == layout)
+					{
+						// Move to the front
+						m_entries.splice(m_entries.begin(), m_entries, it);
+						offset_in_heap = it->offset_in_heap;
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			// Allocate heap space for new data and write-protect the guest range, the data must be written after this call
+			bool store_range(u32 local_addr, upload_format fmt, u32 data_length, u64 layout, u32 alignment, u32& offset_in_heap)
+			{
+				const auto range = address_range::start_length(local_addr, data_length).to_page_range();
+
+				if (!range.valid() || !vm::check_addr(range.start, range.length()))
+				{
+					return false;
+				}
+
+				std::lock_guard lock(m_mutex);
+
+				if (auto found = m_write_count.find(local_addr); found != m_write_count.end() && found->second >= max_write_count)
+				{
+					return false;
+				}
+
+				const u32 length = ::align(data_length, alignment);
+
+				for (auto it = m_free.begin(); it != m_free.end(); it++)
+				{
+					const u32 offset = ::align(it->first, alignment);
+					const u32 padding = offset - it->first;
+
+					if (it->second < padding + length)
+					{
+						continue;
+					}
+
+					const auto [block_offset, block_length] = *it;
+					m_free.erase(it);
+
+					if (padding)
+					{
+						release(block_offset, padding);
+					}
+
+					if (block_length > padding + length)
+					{
+						release(offset + length, block_length - padding - length);
+					}
+
+					m_entries.push_front({local_addr, fmt, data_length, layout, offset, length, range});
+					m_lookup.emplace(local_addr, m_entries.begin());
+
+					rsx::g_protection_batch.lock_vertex_range(range);
+
+					offset_in_heap = offset;
+					return true;
+				}
+
+				// Evict least recently used entries, their space becomes available once their frames have retired
+				u32 evicted = 0;
+
+				while (evicted < length && !m_entries.empty())
+				{
+					const auto last = std::prev(m_entries.end());
+					const auto locked = last->locked_range;
+					evicted += last->allocated_length;
+					drop(last);
+
+					rsx::g_protection_batch.unlock_vertex_range(locked);
+					relock(locked);
+				}
+
+				return false;
+			}
+
+			// Drop cached data in a written page, returns false if the page isn't protected by the cache
+			bool on_access_violation(u32 address, bool is_writing)
+			{
+				if (!is_writing)
+				{
+					return false;
+				}
+
+				std::lock_guard lock(m_mutex);
+
+				const auto dropped = drop_overlapping(utils::page_for(address), true);
+
+				if (!dropped.valid())
+				{
+					return false;
+				}
+
+				rsx::g_protection_batch.unlock_vertex_range(dropped);
+				relock(dropped);
+				return true;
+			}
+
+			// Drop cached data of invalidated (possibly unmapped) memory
+			void invalidate_range(const address_range& range)
+			{
+				std::lock_guard lock(m_mutex);
+
+				const auto unmapped = range.to_page_range();
+				const auto dropped = drop_overlapping(unmapped, false);
+
+				if (!dropped.valid())
+				{
+					return;
+				}
+
+				if (vm::check_addr(unmapped.start, unmapped.length()))
+				{
+					// Still mapped
+					rsx::g_protection_batch.unlock_vertex_range(dropped);
+					relock(dropped);
+					return;
+				}
+
+				rsx::g_protection_batch.discard_vertex_range(unmapped);
+
+				// Pages around the unmapped range are still mapped and must be released
+				if (dropped.start < unmapped.start)
+				{
+					const auto head = address_range::start_end(dropped.start, unmapped.start - 1);
+					rsx::g_protection_batch.unlock_vertex_range(head);
+					relock(head);
+				}
+
+				if (dropped.end > unmapped.end)
+				{
+					const auto tail = address_range::start_end(unmapped.end + 1, dropped.end);
+					rsx::g_protection_batch.unlock_vertex_range(tail);
+					relock(tail);
+				}
+			}
+
+			// Make space of the oldest retired frame available
+			void on_frame_end()
+			{
+				std::lock_guard lock(m_mutex);
+
+				m_retired_index = (m_retired_index + 1) % ::size32(m_retired);
+
+				for (const auto& [offset, length] : m_retired[m_retired_index])
+				{
+					release(offset, length);
+				}
+
+				m_retired[m_retired_index].clear();
+			}
+
+			void purge()
+			{
+				std::lock_guard lock(m_mutex);
+
+				while (!m_entries.empty())
+				{
+					const auto locked = m_entries.front().locked_range;
+					drop(m_entries.begin());
+					rsx::g_protection_batch.unlock_vertex_range(locked);
+				}
+
+				m_write_count.clear();
 			}
 		};
 	}
@@ -2,6 +2,7 @@
 #include "rsx_methods.h"
 #include "RSXThread.h"
 #include "Emu/Memory/vm.h"
+#include "Utilities/timeline.h"
 #include "Emu/System.h"
 #include "rsx_utils.h"
 #include "rsx_decode.h"
@@ -30,6 +31,22 @@ void fmt_class_string<frame_limit_type>::format(std::string& out, u64 arg)
 	});
 }
 
+template <>
+void fmt_class_string<vblank_rate_type>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](vblank_rate_type value)
+	{
+		switch (value)
+		{
+		case vblank_rate_type::_60: return "60";
+		case vblank_rate_type::_59_94: return "59.94";
+		case vblank_rate_type::_50: return "50";
+		}
+
+		return unknown;
+	});
+}
+
 namespace rsx
 {
 	rsx_state method_registers;
@@ -258,6 +275,11 @@ namespace rsx
 
 			auto& info = rsx::method_registers.register_vertex_info[attribute_index];
 
+			if (info.size != count || info.type != vtype)
+			{
+				rsx->m_graphics_state |= rsx::pipeline_state::vertex_arrays_dirty;
+			}
+
 			info.type = vtype;
 			info.size = count;
 			info.frequency = 0;
@@ -472,6 +494,8 @@ namespace rsx
 			if (!rsx::method_registers.current_draw_clause.empty())
 			{
 				rsx::method_registers.current_draw_clause.compile();
+
+				timeline::scoped_event event("RSX", "Draw");
 				rsxthr->end();
 			}
 			else
@@ -676,6 +700,14 @@ namespace rsx
 			}
 		}
 
+		void set_vertex_array_dirty_bit(thread* rsx, u32, u32 arg)
+		{
+			if (arg != method_registers.register_previous_value)
+			{
+				rsx->m_graphics_state |= rsx::pipeline_state::vertex_arrays_dirty;
+			}
+		}
+
 		void set_vertex_env_dirty_bit(thread* rsx, u32, u32 arg)
 		{
 			if (arg != method_registers.register_previous_value)
@@ -1220,7 +1252,11 @@ namespace rsx
 			const auto read_address = get_address(src_offset, src_dma);
 			rsx->read_barrier(read_address, in_pitch * (line_count - 1) + line_length);
 
-			u8 *dst = (u8*)vm::base(get_address(dst_offset, dst_dma));
+			const auto write_address = get_address(dst_offset, dst_dma);
+			vm::heatmap_sample(read_address, in_pitch * (line_count - 1) + line_length);
+			vm::heatmap_sample(write_address, out_pitch * (line_count - 1) + line_length);
+
+			u8 *dst = (u8*)vm::base(write_address);
 			const u8 *src = (u8*)vm::base(read_address);
 
 			if (in_pitch == out_pitch && out_pitch == line_length)
@@ -2685,8 +2721,8 @@ namespace rsx
 		bind_array<NV4097_SET_TRANSFORM_PROGRAM, 1, 32, nullptr>();
 		bind_array<NV4097_SET_POLYGON_STIPPLE_PATTERN, 1, 32, nullptr>();
 		bind_array<NV4097_SET_VERTEX_DATA3F_M, 1, 64, nullptr>();
-		bind_array<NV4097_SET_VERTEX_DATA_ARRAY_OFFSET, 1, 16, nullptr>();
-		bind_array<NV4097_SET_VERTEX_DATA_ARRAY_FORMAT, 1, 16, nullptr>();
+		bind_array<NV4097_SET_VERTEX_DATA_ARRAY_OFFSET, 1, 16, nv4097::set_vertex_array_dirty_bit>();
+		bind_array<NV4097_SET_VERTEX_DATA_ARRAY_FORMAT, 1, 16, nv4097::set_vertex_array_dirty_bit>();
 		bind_array<NV4097_SET_TEXTURE_CONTROL3, 1, 16, nullptr>();
 		bind_array<NV4097_SET_VERTEX_DATA2F_M, 1, 32, nullptr>();
 		bind_array<NV4097_SET_VERTEX_DATA2S_M, 1, 16, nullptr>();
@@ -2780,6 +2816,8 @@ namespace rsx
 		bind<NV4097_SET_VERTEX_ATTRIB_OUTPUT_MASK, nv4097::set_vertex_attribute_output_mask>();
 		bind<NV4097_SET_VERTEX_DATA_BASE_OFFSET, nv4097::set_vertex_base_offset>();
 		bind<NV4097_SET_VERTEX_DATA_BASE_INDEX, nv4097::set_index_base_offset>();
+		bind<NV4097_SET_VERTEX_ATTRIB_INPUT_MASK, nv4097::set_vertex_array_dirty_bit>();
+		bind<NV4097_SET_FREQUENCY_DIVIDER_OPERATION, nv4097::set_vertex_array_dirty_bit>();
 		bind<NV4097_SET_USER_CLIP_PLANE_CONTROL, nv4097::set_vertex_env_dirty_bit>();
 		bind<NV4097_SET_TRANSFORM_BRANCH_BITS, nv4097::set_vertex_env_dirty_bit>();
 		bind<NV4097_SET_CLIP_MIN, nv4097::set_vertex_env_dirty_bit>();
@@ -505,6 +505,7 @@ namespace rsx
 			transform_program = in.transform_program;
 			transform_constants = in.transform_constants;
 			register_vertex_info = in.register_vertex_info;
+			transform_program_epoch++;
 			return *this;
 		}
 
@@ -515,6 +516,9 @@ namespace rsx
 		std::array<u32, 512 * 4> transform_program;
 		std::array<u32[4], 512> transform_constants;
 
+		// Incremented on every transform program change, vertex program analysis results are only valid for one epoch
+		u32 transform_program_epoch = 0;
+
 		draw_clause current_draw_clause;
 
 		/**
@@ -1567,6 +1571,7 @@ namespace rsx
 			transform_program[load * 4 + 1] = registers[NV4097_SET_TRANSFORM_PROGRAM + index * 4 + 1];
 			transform_program[load * 4 + 2] = registers[NV4097_SET_TRANSFORM_PROGRAM + index * 4 + 2];
 			transform_program[load * 4 + 3] = registers[NV4097_SET_TRANSFORM_PROGRAM + index * 4 + 3];
+			transform_program_epoch++;
 			load++;
 		}
 
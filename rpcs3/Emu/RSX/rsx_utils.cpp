@@ -15,6 +15,92 @@ extern "C"
 namespace rsx
 {
 	atomic_t<u64> g_rsx_shared_tag{ 0 };
+	atomic_t<u32> g_dynamic_resolution_scale{ 0 };
+
+	void dynamic_resolution_controller::reset()
+	{
+		m_average_frame_time = 0.;
+		m_frames_measured = 0;
+		m_frames_since_change = 0;
+
+		if (g_cfg.video.dynamic_resolution_scaling)
+		{
+			// Start from the static setting
+			const u32 min_scale = g_cfg.video.dynamic_resolution_min_scale;
+			const u32 max_scale = std::max<u32>(min_scale, g_cfg.video.dynamic_resolution_max_scale);
+			g_dynamic_resolution_scale = std::clamp<u32>(g_cfg.video.resolution_scale_percent, min_scale, max_scale);
+		}
+		else
+		{
+			g_dynamic_resolution_scale = 0;
+		}
+	}
+
+	bool dynamic_resolution_controller::on_frame_time(u64 gpu_frame_time_us)
+	{
+		if (!g_cfg.video.dynamic_resolution_scaling)
+		{
+			if (g_dynamic_resolution_scale)
+			{
+				reset();
+				return true;
+			}
+
+			return false;
+		}
+
+		if (!g_dynamic_resolution_scale)
+		{
+			// Just enabled, take over from the static setting
+			reset();
+			return true;
+		}
+
+		m_frames_since_change++;
+
+		if (m_frames_measured++ < warmup_frames)
+		{
+			// Frames right after a change include surface recreation, do not let them skew the average
+			m_average_frame_time = f64(gpu_frame_time_us);
+			return false;
+		}
+
+		m_average_frame_time = (m_average_frame_time * 0.9) + (f64(gpu_frame_time_us) * 0.1);
+
+		if (m_frames_since_change < min_frames_between_changes)
+		{
+			return false;
+		}
+
+		const f64 target = g_cfg.video.dynamic_resolution_target_frametime;
+		const u32 min_scale = g_cfg.video.dynamic_resolution_min_scale;
+		const u32 max_scale = std::max<u32>(min_scale, g_cfg.video.dynamic_resolution_max_scale);
+		const u32 current_scale = g_dynamic_resolution_scale;
+		u32 new_scale = current_scale;
+
+		// Drop quickly when over budget, only climb back with plenty of headroom
+		if (m_average_frame_time > target * 1.05)
+		{
+			new_scale = std::max(min_scale, current_scale > scale_step ? current_scale - scale_step : min_scale);
+		}
+		else if (m_average_frame_time < target * 0.75)
+		{
+			new_scale = std::min(max_scale, current_scale + scale_step);
+		}
+
+		new_scale = std::clamp(new_scale, min_scale, max_scale);
+		if (new_scale == current_scale)
+		{
+			return false;
+		}
+
+		LOG_NOTICE(RSX, "Dynamic resolution: GPU frame time %.2fms, scale %u%% -> %u%%", m_average_frame_time / 1000., current_scale, new_scale);
+
+		g_dynamic_resolution_scale = new_scale;
+		m_frames_measured = 0;
+		m_frames_since_change = 0;
+		return true;
+	}
 
 	void convert_scale_image(u8 *dst, AVPixelFormat dst_format, int dst_width, int dst_height, int dst_pitch,
 		const u8 *src, AVPixelFormat src_format, int src_width, int src_height, int src_pitch, int src_slice_h, bool bilinear)
@@ -422,4 +508,405 @@ namespace rsx
 #ifdef TEXTURE_CACHE_DEBUG
 	tex_cache_checker_t tex_cache_checker = {};
 #endif
+
+	protection_batch g_protection_batch;
+
+	void protection_map::cut(u32 start, u32 end)
+	{
+		auto found = m_map.lower_bound(start);
+
+		if (found != m_map.begin())
+		{
+			auto& [prev_end, prev_prot] = std::prev(found)->second;
+
+			if (prev_end >= start)
+			{
+				if (prev_end > end)
+				{
+					// Keep the tail of the range covering the whole cut
+					m_map.emplace(end + 1, std::make_pair(prev_end, prev_prot));
+				}
+
+				prev_end = start - 1;
+			}
+		}
+
+		while (found != m_map.end() && found->first <= end)
+		{
+			if (found->second.first > end)
+			{
+				// Keep the tail of the range overlapping the end
+				m_map.emplace(end + 1, found->second);
+			}
+
+			found = m_map.erase(found);
+		}
+	}
+
+	void protection_map::set(u32 start, u32 end, utils::protection prot)
+	{
+		cut(start, end);
+
+		auto found = m_map.lower_bound(start);
+
+		// Merge with the following range
+		if (found != m_map.end() && found->first - 1 == end && found->second.second == prot)
+		{
+			end = found->second.first;
+			found = m_map.erase(found);
+		}
+
+		// Merge with the preceding range
+		if (found != m_map.begin())
+		{
+			auto& [prev_end, prev_prot] = std::prev(found)->second;
+
+			if (prev_end + 1 == start && prev_prot == prot)
+			{
+				prev_end = end;
+				return;
+			}
+		}
+
+		m_map.emplace_hint(found, start, std::make_pair(end, prot));
+	}
+
+	std::map<u32, std::pair<u32, utils::protection>>::const_iterator protection_map::find(u32 start) const
+	{
+		auto found = m_map.upper_bound(start);
+
+		if (found != m_map.begin() && std::prev(found)->second.first >= start)
+		{
+			found = std::prev(found);
+		}
+
+		return found;
+	}
+
+	bool protection_map::test(u32 start, u32 end, utils::protection prot) const
+	{
+		for (auto found = find(start); found != m_map.end() && found->first <= end; found++)
+		{
+			if (found->second.second == prot)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool protection_batch::is_tracking()
+	{
+		if (UNLIKELY(m_tracking == 0))
+		{
+			m_tracking = 1;
+
+			if (g_cfg.video.write_tracking)
+			{
+				if (utils::memory_watch_reset())
+				{
+					m_tracking = 2;
+				}
+				else
+				{
+					LOG_WARNING(RSX, "Write tracking is not supported on this system, using page faults");
+				}
+			}
+		}
+
+		return m_tracking == 2;
+	}
+
+	void protection_batch::apply(u32 start, u32 end, utils::protection prot)
+	{
+		utils::memory_protect(vm::base(start), end - start + 1, prot);
+
+		if (prot != utils::protection::rw)
+		{
+			return;
+		}
+
+		apply_locked(m_vertex_locked, start, end);
+		apply_locked(m_program_locked, start, end);
+	}
+
+	void protection_batch::apply_locked(const protection_map& locked, u32 start, u32 end)
+	{
+		for (auto found = locked.find(start); found != locked.end() && found->first <= end; found++)
+		{
+			const u32 lock_start = std::max(found->first, start);
+			const u32 lock_end = std::min(found->second.first, end);
+
+			if (lock_start <= lock_end)
+			{
+				utils::memory_protect(vm::base(lock_start), lock_end - lock_start + 1, utils::protection::ro);
+			}
+		}
+	}
+
+	void protection_batch::protect(const address_range& range, utils::protection prot, bool defer)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (prot == utils::protection::rw)
+		{
+			m_requested.cut(range.start, range.end);
+		}
+		else
+		{
+			m_requested.set(range.start, range.end, prot);
+		}
+
+		if (is_tracking())
+		{
+			if (prot == utils::protection::rw)
+			{
+				m_tracked.cut(range.start, range.end);
+			}
+			else if (prot == utils::protection::no || m_tracked.test(range.start, range.end, utils::protection::no))
+			{
+				// Pages of flushable sections must stay inaccessible
+				m_tracked.set(range.start, range.end, utils::protection::no);
+			}
+			else
+			{
+				// Leave read-only range writable, written pages are found by poll_written()
+				m_tracked.set(range.start, range.end, utils::protection::ro);
+				prot = utils::protection::rw;
+			}
+		}
+
+		if (!defer)
+		{
+			m_pending.cut(range.start, range.end);
+			apply(range.start, range.end, prot);
+			return;
+		}
+
+		m_pending.set(range.start, range.end, prot);
+	}
+
+	void protection_batch::flush()
+	{
+		std::lock_guard lock(m_mutex);
+
+		for (const auto& [start, info] : m_pending)
+		{
+			apply(start, info.first, info.second);
+		}
+
+		m_pending.clear();
+	}
+
+	void protection_batch::discard(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_pending.cut(range.start, range.end);
+	}
+
+	void protection_batch::lock_range(protection_map& locked, const address_range& range)
+	{
+		locked.set(range.start, range.end, utils::protection::ro);
+
+		// Protect runs of pages that the texture cache doesn't keep inaccessible
+		u32 run_start = range.start;
+
+		for (u32 page = range.start; page <= range.end; page += 4096)
+		{
+			if (m_requested.test(page, page + 4095, utils::protection::no))
+			{
+				if (run_start < page)
+				{
+					utils::memory_protect(vm::base(run_start), page - run_start, utils::protection::ro);
+				}
+
+				run_start = page + 4096;
+			}
+		}
+
+		if (run_start < range.end)
+		{
+			utils::memory_protect(vm::base(run_start), range.end - run_start + 1, utils::protection::ro);
+		}
+	}
+
+	void protection_batch::unlock_range(protection_map& locked, const address_range& range)
+	{
+		locked.cut(range.start, range.end);
+
+		for (u32 page = range.start; page <= range.end; page += 4096)
+		{
+			utils::protection prot = utils::protection::rw;
+
+			if (m_requested.test(page, page + 4095, utils::protection::no))
+			{
+				prot = utils::protection::no;
+			}
+			else if (m_requested.test(page, page + 4095, utils::protection::ro) && !is_tracking())
+			{
+				prot = utils::protection::ro;
+			}
+			else if (m_vertex_locked.test(page, page + 4095, utils::protection::ro) || m_program_locked.test(page, page + 4095, utils::protection::ro))
+			{
+				// Still locked by the other owner
+				prot = utils::protection::ro;
+			}
+
+			utils::memory_protect(vm::base(page), 4096, prot);
+		}
+	}
+
+	void protection_batch::lock_vertex_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+		lock_range(m_vertex_locked, range);
+	}
+
+	void protection_batch::unlock_vertex_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+		unlock_range(m_vertex_locked, range);
+	}
+
+	void protection_batch::discard_vertex_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_vertex_locked.cut(range.start, range.end);
+	}
+
+	void protection_batch::lock_program_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+		lock_range(m_program_locked, range);
+	}
+
+	void protection_batch::unlock_program_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+		unlock_range(m_program_locked, range);
+	}
+
+	void protection_batch::discard_program_range(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+
+		m_program_locked.cut(range.start, range.end);
+	}
+
+	void protection_batch::mark_written(const address_range& range)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (m_tracking == 2 && m_tracked.test(range.start, range.end, utils::protection::ro))
+		{
+			m_written.push_back(range.to_page_range());
+		}
+	}
+
+	void protection_batch::poll_written(std::vector<address_range>& result)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (!is_tracking() || std::none_of(m_tracked.begin(), m_tracked.end(), [](const auto& e) { return e.second.second == utils::protection::ro; }))
+		{
+			// Nothing is tracked through the dirty bits, don't pay for clearing them
+			return;
+		}
+
+		for (const auto& [start, info] : m_pending)
+		{
+			apply(start, info.first, info.second);
+		}
+
+		m_pending.clear();
+
+		// Protect tracked ranges for real while the bits are collected and reset, so writes in between cause regular page faults
+		for (const auto& [start, info] : m_tracked)
+		{
+			if (info.second == utils::protection::ro)
+			{
+				utils::memory_protect(vm::base(start), info.first - start + 1, utils::protection::ro);
+			}
+		}
+
+		std::vector<u8> written, written_sudo;
+
+		for (const auto& [start, info] : m_tracked)
+		{
+			if (info.second != utils::protection::ro || !utils::memory_watch_get(vm::base(start), info.first - start + 1, written))
+			{
+				continue;
+			}
+
+			// Dirty bits are per mapping, writes through the sudo mapping only show there
+			if (utils::memory_watch_get(vm::g_sudo_addr + start, info.first - start + 1, written_sudo))
+			{
+				for (u32 i = 0; i < written.size(); i++)
+				{
+					written[i] |= written_sudo[i];
+				}
+			}
+
+			for (u32 i = 0; i < written.size(); i++)
+			{
+				if (!written[i])
+				{
+					continue;
+				}
+
+				// Merge consecutive written pages
+				u32 count = 1;
+
+				while (i + count < written.size() && written[i + count])
+				{
+					count++;
+				}
+
+				result.push_back(address_range::start_length(start + i * 4096, count * 4096));
+				i += count;
+			}
+		}
+
+		// Sudo writes made after their dirty bits were read are reported explicitly
+		for (const auto& range : m_written)
+		{
+			for (const auto& [start, info] : m_tracked)
+			{
+				const auto tracked = address_range::start_end(start, info.first);
+
+				if (info.second == utils::protection::ro && tracked.overlaps(range))
+				{
+					result.push_back(tracked.get_intersect(range));
+				}
+			}
+		}
+
+		m_written.clear();
+
+		// Clears the soft-dirty bits of the whole process (/proc/self/clear_refs), not only of the tracked ranges:
+		// every page of the process is write-protected again and takes a minor fault on its next write
+		utils::memory_watch_reset();
+
+		// Written ranges are invalidated by the caller
+		for (const auto& range : result)
+		{
+			m_tracked.cut(range.start, range.end);
+		}
+
+		for (const auto& [start, info] : m_tracked)
+		{
+			if (info.second == utils::protection::ro)
+			{
+				apply(start, info.first, utils::protection::rw);
+			}
+		}
+
+		for (const auto& range : result)
+		{
+			apply(range.start, range.end, utils::protection::rw);
+		}
+	}
 }
@@ -11,6 +11,7 @@
 #include <memory>
 #include <bitset>
 #include <optional>
+#include <vector>
 
 extern "C"
 {
@@ -36,6 +37,7 @@ namespace rsx
 	class thread;
 	extern thread* g_current_renderer;
 	extern atomic_t<u64> g_rsx_shared_tag;
+	extern atomic_t<u32> g_dynamic_resolution_scale;
 
 	//Base for resources with reference counting
 	class ref_counted
@@ -283,12 +285,130 @@ namespace rsx
 	*    Restriction: It has mixed results if the height or width is not a power of 2
 	*    Restriction: Only works with 2D surfaces
 	*/
+	/**
+	 * Copy a 4x4 block of texels between linear and swizzled memory
+	 * Swizzled blocks are 16 contiguous texels, each linear row is made of two pairs of texels 4 texels apart
+	 */
+	template <typename T>
+	static inline void copy_swizzled_tile_4x4(T* swizzled, T* linear, u32 linear_pitch_in_texels, bool to_linear)
+	{
+		if constexpr (sizeof(T) == 4)
+		{
+			__m128i* tile = reinterpret_cast<__m128i*>(swizzled);
+			__m128i* rows[4];
+
+			for (u32 row = 0; row < 4; ++row)
+			{
+				rows[row] = reinterpret_cast<__m128i*>(linear + row * linear_pitch_in_texels);
+			}
+
+			for (u32 half = 0; half < 2; ++half)
+			{
+				if (to_linear)
+				{
+					const __m128i a = _mm_loadu_si128(tile + half * 2);
+					const __m128i b = _mm_loadu_si128(tile + half * 2 + 1);
+					_mm_storeu_si128(rows[half * 2], _mm_unpacklo_epi64(a, b));
+					_mm_storeu_si128(rows[half * 2 + 1], _mm_unpackhi_epi64(a, b));
+				}
+				else
+				{
+					const __m128i r0 = _mm_loadu_si128(rows[half * 2]);
+					const __m128i r1 = _mm_loadu_si128(rows[half * 2 + 1]);
+					_mm_storeu_si128(tile + half * 2, _mm_unpacklo_epi64(r0, r1));
+					_mm_storeu_si128(tile + half * 2 + 1, _mm_unpackhi_epi64(r0, r1));
+				}
+			}
+		}
+		else if constexpr (sizeof(T) == 2)
+		{
+			__m128i* tile = reinterpret_cast<__m128i*>(swizzled);
+
+			for (u32 half = 0; half < 2; ++half)
+			{
+				__m128i* r0 = reinterpret_cast<__m128i*>(linear + (half * 2) * linear_pitch_in_texels);
+				__m128i* r1 = reinterpret_cast<__m128i*>(linear + (half * 2 + 1) * linear_pitch_in_texels);
+
+				if (to_linear)
+				{
+					// Texel pairs 0, 2, 1, 3 -> row 0 | row 1
+					const __m128i rows = _mm_shuffle_epi32(_mm_loadu_si128(tile + half), 0xD8);
+					_mm_storel_epi64(r0, rows);
+					_mm_storel_epi64(r1, _mm_unpackhi_epi64(rows, rows));
+				}
+				else
+				{
+					const __m128i rows = _mm_unpacklo_epi64(_mm_loadl_epi64(r0), _mm_loadl_epi64(r1));
+					_mm_storeu_si128(tile + half, _mm_shuffle_epi32(rows, 0xD8));
+				}
+			}
+		}
+		else
+		{
+			for (u32 row = 0; row < 4; ++row)
+			{
+				T* linear_row = linear + row * linear_pitch_in_texels;
+				T* tile_row = swizzled + (row & 1) * 2 + (row >> 1) * 8;
+
+				if (to_linear)
+				{
+					std::memcpy(linear_row, tile_row, sizeof(T) * 2);
+					std::memcpy(linear_row + 2, tile_row + 4, sizeof(T) * 2);
+				}
+				else
+				{
+					std::memcpy(tile_row, linear_row, sizeof(T) * 2);
+					std::memcpy(tile_row + 4, linear_row + 2, sizeof(T) * 2);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Tile-blocked variant of convert_linear_swizzle for dimensions that are multiples of 4
+	 * The swizzled offset of a texel is the sum of independent x and y bit patterns, only computed once per tile column and row
+	 */
+	template <typename T>
+	void convert_linear_swizzle_tiled(void* input_pixels, void* output_pixels, u16 width, u16 height, u32 pitch, bool input_is_swizzled)
+	{
+		const u32 log2width = ceil_log2(width);
+		const u32 log2height = ceil_log2(height);
+		const u32 adv = pitch / sizeof(T);
+		const u32 tiles_x = width / 4;
+
+		std::vector<u32> x_offsets(tiles_x);
+
+		for (u32 x = 0; x < tiles_x; ++x)
+		{
+			x_offsets[x] = calculate_z_index(x * 4, 0, 0, log2width, log2height, 0);
+		}
+
+		for (u32 y = 0; y < height; y += 4)
+		{
+			const u32 y_offset = calculate_z_index(0, y, 0, log2width, log2height, 0);
+			T* linear = static_cast<T*>(input_is_swizzled ? output_pixels : input_pixels) + y * adv;
+			T* swizzled = static_cast<T*>(input_is_swizzled ? input_pixels : output_pixels) + y_offset;
+
+			for (u32 x = 0; x < tiles_x; ++x)
+			{
+				copy_swizzled_tile_4x4<T>(swizzled + x_offsets[x], linear + x * 4, adv, input_is_swizzled);
+			}
+		}
+	}
+
 	template<typename T>
 	void convert_linear_swizzle(void* input_pixels, void* output_pixels, u16 width, u16 height, u32 pitch, bool input_is_swizzled)
 	{
 		u32 log2width = ceil_log2(width);
 		u32 log2height = ceil_log2(height);
 
+		// The 4 lowest offset bits interleave 2 bits of x and y when both dimensions span at least 4 texels
+		if (width % 4 == 0 && height % 4 == 0)
+		{
+			convert_linear_swizzle_tiled<T>(input_pixels, output_pixels, width, height, pitch, input_is_swizzled);
+			return;
+		}
+
 		// Max mask possible for square texture
 		u32 x_mask = 0x55555555;
 		u32 y_mask = 0xAAAAAAAA;
@@ -377,14 +497,26 @@ namespace rsx
 		const u32 log2_w = ceil_log2(width);
 		const u32 log2_h = ceil_log2(height);
 		const u32 log2_d = ceil_log2(depth);
-	
+
+		// Bits of x, y and z don't overlap in the index, compute each axis once
+		std::vector<u32> x_offsets(width);
+
+		for (u32 x = 0; x < width; ++x)
+		{
+			x_offsets[x] = calculate_z_index(x, 0, 0, log2_w, log2_h, log2_d);
+		}
+
 		for (u32 z = 0; z < depth; ++z)
 		{
+			const u32 z_offset = calculate_z_index(0, 0, z, log2_w, log2_h, log2_d);
+
 			for (u32 y = 0; y < height; ++y)
 			{
+				const T* src_row = src + (z_offset | calculate_z_index(0, y, 0, log2_w, log2_h, log2_d));
+
 				for (u32 x = 0; x < width; ++x)
 				{
-					*dst++ = src[calculate_z_index(x, y, z, log2_w, log2_h, log2_d)];
+					*dst++ = src_row[x_offsets[x]];
 				}
 			}
 		}
@@ -531,14 +663,21 @@ namespace rsx
 		}
 	}
 
-	static inline const f32 get_resolution_scale()
+	static inline const int get_resolution_scale_percent()
 	{
-		return g_cfg.video.strict_rendering_mode? 1.f : ((f32)g_cfg.video.resolution_scale_percent / 100.f);
+		if (g_cfg.video.strict_rendering_mode)
+			return 100;
+
+		// Non-zero while dynamic resolution scaling is in control
+		if (const u32 dynamic_scale = g_dynamic_resolution_scale)
+			return dynamic_scale;
+
+		return g_cfg.video.resolution_scale_percent;
 	}
 
-	static inline const int get_resolution_scale_percent()
+	static inline const f32 get_resolution_scale()
 	{
-		return g_cfg.video.strict_rendering_mode ? 100 : g_cfg.video.resolution_scale_percent;
+		return (f32)get_resolution_scale_percent() / 100.f;
 	}
 
 	static inline const u16 apply_resolution_scale(u16 value, bool clamp, u16 ref = 0)
@@ -570,6 +709,38 @@ namespace rsx
 		return result;
 	}
 
+	// Scales a value relative to a surface. With dynamic resolution scaling, surfaces keep the scale they were created with,
+	// so the scale is taken from the surface's native and scaled dimensions instead of the current setting
+	static inline const u16 apply_surface_resolution_scale(u16 value, bool clamp, u16 ref, u16 native_size, u16 scaled_size)
+	{
+		if (!g_cfg.video.dynamic_resolution_scaling)
+			return apply_resolution_scale(value, clamp, ref);
+
+		if (native_size == 0 || native_size == scaled_size)
+			return value;
+
+		const u32 result = (u32{ value } * scaled_size) / native_size;
+		return (u16)(clamp ? std::max(result, 1u) : result);
+	}
+
+	// Picks a resolution scale within the configured window from measured GPU frame times
+	class dynamic_resolution_controller
+	{
+		static constexpr u32 scale_step = 10;
+		static constexpr u32 warmup_frames = 8;
+		static constexpr u32 min_frames_between_changes = 60; // Every change recreates the bound surfaces
+
+		f64 m_average_frame_time = 0.;
+		u32 m_frames_measured = 0;
+		u32 m_frames_since_change = 0;
+
+	public:
+		void reset();
+
+		// Returns true if the scale was changed
+		bool on_frame_time(u64 gpu_frame_time_us);
+	};
+
 	/**
 	 * Calculates the regions used for memory transfer between rendertargets on succession events
 	 * Returns <src_w, src_h, dst_w, dst_h>
@@ -905,7 +1076,7 @@ namespace rsx
 		{
 			if (_size >= _capacity)
 			{
-				reserve(_capacity + 16);
+				reserve(_capacity ? _capacity * 2 : 16);
 			}
 
 			_data[_size++] = val;
@@ -915,7 +1086,7 @@ namespace rsx
 		{
 			if (_size >= _capacity)
 			{
-				reserve(_capacity + 16);
+				reserve(_capacity ? _capacity * 2 : 16);
 			}
 
 			_data[_size++] = val;
@@ -928,7 +1099,7 @@ namespace rsx
 
 			if (_size >= _capacity)
 			{
-				reserve(_capacity + 16);
+				reserve(_capacity ? _capacity * 2 : 16);
 				pos = _data + _loc;
 			}
 
@@ -956,7 +1127,7 @@ namespace rsx
 
 			if (_size >= _capacity)
 			{
-				reserve(_capacity + 16);
+				reserve(_capacity ? _capacity * 2 : 16);
 				pos = _data + _loc;
 			}
 
@@ -106,6 +106,13 @@ struct push_buffer_vertex_info
 			attribute_mask = 0;
 
 			vertex_count++;
+
+			// Grow geometrically, immediate mode draws often submit thousands of vertices
+			if (data.capacity() < vertex_count * vertex_size)
+			{
+				data.reserve(std::max(vertex_count * vertex_size, data.capacity() * 2));
+			}
+
 			data.resize(vertex_count * vertex_size);
 		}
 
@@ -10,20 +10,26 @@
 #include "Emu/Cell/PPUAnalyser.h"
 #include "Emu/Cell/SPUThread.h"
 #include "Emu/Cell/RawSPUThread.h"
+#include "Emu/Cell/SPURecompiler.h"
 #include "Emu/Cell/lv2/sys_memory.h"
 #include "Emu/Cell/lv2/sys_sync.h"
 #include "Emu/Cell/lv2/sys_prx.h"
 #include "Emu/Cell/lv2/sys_rsx.h"
+#include "Emu/Cell/lv2/sys_timer.h"
 
 #include "Emu/IdManager.h"
 #include "Emu/RSX/GSRender.h"
 #include "Emu/RSX/Capture/rsx_replay.h"
+#include "Emu/title_benchmark.h"
 
 #include "Loader/PSF.h"
 #include "Loader/ELF.h"
+#include "Loader/ISO.h"
 
 #include "Utilities/StrUtil.h"
 #include "Utilities/sysinfo.h"
+#include "Utilities/timeline.h"
+#include "Utilities/lock_profiler.h"
 
 #include "../Crypto/unself.h"
 #include "../Crypto/unpkg.h"
@@ -63,6 +69,7 @@ extern void ppu_unload_prx(const lv2_prx&);
 extern std::shared_ptr<lv2_prx> ppu_load_prx(const ppu_prx_object&, const std::string&);
 
 extern void network_thread_init();
+extern void savedata_wait_commits();
 
 fs::file g_tty;
 atomic_t<s64> g_tty_size{0};
@@ -236,6 +243,7 @@ inline void fmt_class_string<detail_level>::format(std::string& out, u64 arg)
 		case detail_level::low: return "Low";
 		case detail_level::medium: return "Medium";
 		case detail_level::high: return "High";
+		case detail_level::extreme: return "Extreme";
 		}
 
 		return unknown;
@@ -259,6 +267,22 @@ inline void fmt_class_string<screen_quadrant>::format(std::string& out, u64 arg)
 	});
 }
 
+template <>
+void fmt_class_string<thread_priority_policy>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](thread_priority_policy value)
+	{
+		switch (value)
+		{
+		case thread_priority_policy::disabled: return "Disabled";
+		case thread_priority_policy::elevated: return "Elevated";
+		case thread_priority_policy::realtime: return "Realtime";
+		}
+
+		return unknown;
+	});
+}
+
 template <>
 void fmt_class_string<tsx_usage>::format(std::string& out, u64 arg)
 {
@@ -488,26 +512,40 @@ std::string Emulator::PPUCache() const
 	return _main->cache;
 }
 
-bool Emulator::BootRsxCapture(const std::string& path)
+bool Emulator::BootRsxCapture(const std::string& path, const rsx::replay_benchmark_settings* benchmark)
 {
 	if (!fs::is_file(path))
 		return false;
 
-	std::fstream f(path, std::ios::in | std::ios::binary);
+	rsx::capture_file_header header;
+	if (!fs::file(path).read(header) || header.magic != rsx::FRAME_CAPTURE_MAGIC)
+	{
+		LOG_ERROR(LOADER, "Invalid rsx capture file!");
+		return false;
+	}
 
-	cereal::BinaryInputArchive archive(f);
 	std::unique_ptr<rsx::frame_capture_data> frame = std::make_unique<rsx::frame_capture_data>();
-	archive(*frame);
+	std::unique_ptr<rsx::frame_capture_reader> reader;
 
-	if (frame->magic != rsx::FRAME_CAPTURE_MAGIC)
+	if (header.version == rsx::FRAME_CAPTURE_VERSION)
 	{
-		LOG_ERROR(LOADER, "Invalid rsx capture file!");
-		return false;
+		reader = std::make_unique<rsx::frame_capture_reader>();
+		if (!reader->open(path, *frame))
+		{
+			LOG_ERROR(LOADER, "Failed to read rsx capture file!");
+			return false;
+		}
 	}
+	else if (header.version == rsx::FRAME_CAPTURE_LEGACY_VERSION)
+	{
+		std::fstream f(path, std::ios::in | std::ios::binary);
 
-	if (frame->version != rsx::FRAME_CAPTURE_VERSION)
+		cereal::BinaryInputArchive archive(f);
+		archive(*frame);
+	}
+	else
 	{
-		LOG_ERROR(LOADER, "Rsx capture file version not supported! Expected %d, found %d", rsx::FRAME_CAPTURE_VERSION, frame->version);
+		LOG_ERROR(LOADER, "Rsx capture file version not supported! Expected %d, found %d", rsx::FRAME_CAPTURE_VERSION, header.version);
 		return false;
 	}
 
@@ -526,10 +564,58 @@ bool Emulator::BootRsxCapture(const std::string& path)
 	if (gsrender.get() == nullptr || padhandler.get() == nullptr)
 		return false;
 
+	if (benchmark)
+	{
+		gsrender->benchmark_mode = true;
+		gsrender->benchmark_null_present = benchmark->null_present;
+	}
+
+	GetCallbacks().on_run();
+	m_state = system_state::running;
+
+	fxm::make<named_thread<rsx::rsx_replay_thread>>("RSX Replay", std::move(frame), std::move(reader), benchmark ? *benchmark : rsx::replay_benchmark_settings{});
+
+	return true;
+}
+
+bool Emulator::BootSpuBenchmark(const std::string& path, const std::string& output_path)
+{
+	if (!fs::is_file(path))
+		return false;
+
+	Init();
+
+	// The recompilers keep their temporary files in the PPU cache directory
+	const auto _main = fxm::make_always<ppu_module>();
+	_main->cache = fs::get_cache_dir() + "cache/spu_benchmark/";
+
+	if (!fs::create_path(_main->cache))
+	{
+		LOG_ERROR(LOADER, "Failed to create cache directory: %s (%s)", _main->cache, fs::g_tls_error);
+		return false;
+	}
+
 	GetCallbacks().on_run();
 	m_state = system_state::running;
 
-	fxm::make<named_thread<rsx::rsx_replay_thread>>("RSX Replay", std::move(frame));
+	thread_ctrl::spawn("SPU Benchmark", [path, output = output_path.empty() ? fs::get_cache_dir() + "spu_benchmark.csv" : output_path]()
+	{
+		if (spu_cache::benchmark(path, output))
+		{
+			LOG_SUCCESS(LOADER, "SPU benchmark results written to %s", output);
+		}
+
+		Emu.CallAfter([]()
+		{
+			// Benchmarks are started from the command line, leave once the results are out
+			Emu.Stop();
+
+			if (!g_cfg.misc.autoexit)
+			{
+				Emu.GetCallbacks().exit();
+			}
+		});
+	});
 
 	return true;
 }
@@ -624,6 +710,25 @@ bool Emulator::BootGame(const std::string& path, const std::string& title_id, bo
 
 	m_path_old = m_path;
 
+	// Disc image: mount it and boot from its contents
+	if (path.size() > 4 && fmt::to_lower(path.substr(path.size() - 4)) == ".iso" && fs::is_file(path))
+	{
+		const std::string iso_root = iso_mount(path);
+
+		if (iso_root.empty())
+		{
+			return false;
+		}
+
+		m_iso_path = path;
+		return BootGame(iso_root.substr(0, iso_root.size() - 1), title_id, false, add_only, force_global_config);
+	}
+
+	if (!fs::get_virtual_device(path))
+	{
+		m_iso_path.clear();
+	}
+
 	if (direct && fs::exists(path))
 	{
 		m_path = path;
@@ -811,6 +916,22 @@ void Emulator::SetForceBoot(bool force_boot)
 	m_force_boot = force_boot;
 }
 
+void Emulator::SetTitleBenchmark(const title_benchmark_settings& settings)
+{
+	m_title_benchmark = std::make_shared<title_benchmark_settings>(settings);
+
+	if (settings.tune)
+	{
+		m_title_tuner = std::make_shared<title_tuner>();
+	}
+}
+
+void Emulator::SetPpuCompileBenchmark(const std::string& output_path)
+{
+	extern void ppu_start_compile_benchmark(const std::string& output_path);
+	ppu_start_compile_benchmark(output_path.empty() ? fs::get_cache_dir() + "ppu_compile_benchmark.csv" : output_path);
+}
+
 void Emulator::Load(const std::string& title_id, bool add_only, bool force_global_config)
 {
 	if (!IsStopped())
@@ -925,6 +1046,12 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 			}
 		}
 
+		// Settings on trial while tuning
+		if (m_title_tuner)
+		{
+			m_title_tuner->apply();
+		}
+
 #if defined(_WIN32) || defined(HAVE_VULKAN)
 		if (g_cfg.video.renderer == video_renderer::vulkan)
 		{
@@ -934,6 +1061,15 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 
 		LOG_NOTICE(LOADER, "Used configuration:\n%s\n", g_cfg.to_string());
 
+		// Set huge page usage for recompiled code
+		jit_runtime::set_huge_pages(g_cfg.core.jit_huge_pages.get());
+
+		// Export recompiled function names for external profilers
+		jit_runtime::set_symbol_export(g_cfg.core.jit_symbol_export.get());
+
+		// Limit compile jobs of the worker pool
+		worker_pool::get().set_compile_budget(static_cast<u32>(g_cfg.core.llvm_threads));
+
 		// Set RTM usage
 		g_use_rtm = utils::has_rtm() && ((utils::has_mpx() && g_cfg.core.enable_TSX == tsx_usage::enabled) || g_cfg.core.enable_TSX == tsx_usage::forced);
 
@@ -948,8 +1084,14 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 			LOG_ERROR(GENERAL, "Preferred SPU Threads forcefully disabled - not compatible with TSX in this version.");
 		}
 
-		// Load patches from different locations
-		fxm::check_unlocked<patch_engine>()->append(fs::get_config_dir() + "data/" + m_title_id + "/patch.yml");
+		// Load patches from different locations, parsed in the background until the first module is loaded
+		// Every path that may apply patches (or load again) must wait for boot_jobs first
+		worker_pool::group boot_jobs;
+
+		worker_pool::get().submit(worker_priority::interactive, [path = fs::get_config_dir() + "data/" + m_title_id + "/patch.yml"]
+		{
+			fxm::check_unlocked<patch_engine>()->append(path);
+		}, &boot_jobs);
 
 		// Mount all devices
 		const std::string emu_dir = GetEmuDir();
@@ -967,6 +1109,8 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 		// Special boot mode (directory scan)
 		if (fs::is_dir(m_path))
 		{
+			boot_jobs.wait();
+
 			m_state = system_state::ready;
 			GetCallbacks().on_ready();
 			vm::init();
@@ -1084,10 +1228,18 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 					thread_queue.pop();
 				}
 
+				extern bool ppu_finish_compile_benchmark();
+				const bool benchmark = ppu_finish_compile_benchmark();
+
 				// Exit "process"
-				Emu.CallAfter([]
+				Emu.CallAfter([benchmark]
 				{
 					Emu.Stop();
+
+					if (benchmark && !g_cfg.misc.autoexit)
+					{
+						Emu.GetCallbacks().exit();
+					}
 				});
 			});
 		}
@@ -1143,6 +1295,16 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 			}
 		}
 
+		// Disc image location (if /dev_bdvd/ is mounted from an image)
+		std::string bdvd_image = m_iso_path;
+
+		if (disc.empty() && !bdvd_dir.empty() && fs::is_file(bdvd_dir))
+		{
+			// Disc image from the config or the game list
+			bdvd_image = bdvd_dir;
+			bdvd_dir = iso_mount(bdvd_image);
+		}
+
 		// Check /dev_bdvd/
 		if (disc.empty() && !bdvd_dir.empty() && fs::is_dir(bdvd_dir))
 		{
@@ -1169,7 +1331,7 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 			}
 
 			// Store /dev_bdvd/ location
-			games[m_title_id] = bdvd_dir;
+			games[m_title_id] = fs::get_virtual_device(bdvd_dir) && !bdvd_image.empty() ? bdvd_image : bdvd_dir;
 			YAML::Emitter out;
 			out << games;
 			fs::file(fs::get_config_dir() + "/games.yml", fs::rewrite).write(out.c_str(), out.size());
@@ -1307,6 +1469,7 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 		{
 			// Booting game update
 			LOG_SUCCESS(LOADER, "Updates found at /dev_hdd0/game/%s/!", m_title_id);
+			boot_jobs.wait();
 			return m_path = hdd0_boot, Load();
 		}
 
@@ -1371,6 +1534,9 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 			return;
 		}
 
+		// Patches are needed from here
+		boot_jobs.wait();
+
 		ppu_exec_object ppu_exec;
 		ppu_prx_object ppu_prx;
 		spu_exec_object spu_exec;
@@ -1443,6 +1609,30 @@ void Emulator::Load(const std::string& title_id, bool add_only, bool force_globa
 				LOG_NOTICE(LOADER, "Cache: %s", _main->cache);
 			}
 
+			// Read the cached objects of known modules into the OS cache while the rest of the boot happens
+			worker_pool::get().submit(worker_priority::background, [cache = _main->cache, buf = std::make_shared<std::vector<u8>>(0x100000)]
+			{
+				for (auto&& entry : fs::dir(cache))
+				{
+					if (Emu.IsStopped() || worker_pool::is_cancelled())
+					{
+						break;
+					}
+
+					if (entry.is_directory)
+					{
+						continue;
+					}
+
+					if (fs::file file{cache + entry.name})
+					{
+						while (file.read(buf->data(), buf->size()) == buf->size() && !Emu.IsStopped())
+						{
+						}
+					}
+				}
+			});
+
 			fxm::import<GSRender>(Emu.GetCallbacks().get_gs_render); // TODO: must be created in appropriate sys_rsx syscall
 			fxm::import<pad_thread>(Emu.GetCallbacks().get_pad_handler, m_title_id);
 			network_thread_init();
@@ -1513,6 +1703,28 @@ void Emulator::Run()
 	m_pause_amend_time = 0;
 	m_state = system_state::running;
 
+	if (g_cfg.misc.write_timeline_trace)
+	{
+		timeline::start();
+	}
+
+	if (g_cfg.misc.lock_profiler)
+	{
+		lock_profiler::set_name(&vm::g_mutex, "vm::g_mutex");
+		lock_profiler::set_name(&id_manager::g_mutex, "id_manager::g_mutex");
+		lock_profiler::start();
+	}
+
+	if (g_cfg.misc.hle_call_stats)
+	{
+		ppu_call_stats::start();
+	}
+
+	logs::set_deferred(g_cfg.misc.deferred_log.get());
+
+	// Service lv2 timeouts and timers before any thread can wait on them
+	fxm::make<named_thread<lv2_timer_wheel>>("lv2 Timer Wheel");
+
 	auto on_select = [](u32, cpu_thread& cpu)
 	{
 		cpu.state -= cpu_flag::stop;
@@ -1522,6 +1734,11 @@ void Emulator::Run()
 	idm::select<named_thread<ppu_thread>>(on_select);
 	idm::select<named_thread<spu_thread>>(on_select);
 
+	if (m_title_benchmark)
+	{
+		fxm::make<named_thread<title_benchmark>>("Title Benchmark", *m_title_benchmark);
+	}
+
 #ifdef WITH_GDB_DEBUGGER
 	// Initialize debug server at the end of emu run sequence
 	fxm::make<GDBDebugServer>();
@@ -1639,6 +1856,9 @@ void Emulator::Stop(bool restart)
 
 	GetCallbacks().on_stop();
 
+	// Let the jobs of this session skip their work
+	worker_pool::get().cancel();
+
 #ifdef WITH_GDB_DEBUGGER
 	//fxm for some reason doesn't call on_stop
 	fxm::get<GDBDebugServer>()->on_stop();
@@ -1663,6 +1883,21 @@ void Emulator::Stop(bool restart)
 
 	LOG_NOTICE(GENERAL, "All threads stopped...");
 
+	// Save data written in background must reach the disk before the session ends
+	savedata_wait_commits();
+
+	const u64 suspend_count = cpu_thread::g_suspend_count.exchange(0);
+	const u64 suspend_time = cpu_thread::g_suspend_time.exchange(0);
+
+	if (suspend_count)
+	{
+		LOG_NOTICE(GENERAL, "Thread suspension: %u times (%u us)", suspend_count, suspend_time);
+	}
+
+	// All emulator threads are gone, nothing waits anymore
+	lock_profiler::stop();
+	ppu_call_stats::stop(fs::get_cache_dir() + "hle_calls.csv");
+
 	lv2_obj::cleanup();
 	idm::clear();
 	fxm::clear();
@@ -1670,6 +1905,9 @@ void Emulator::Stop(bool restart)
 
 	LOG_NOTICE(GENERAL, "Objects cleared...");
 
+	// All emulator threads are gone, their event buffers are complete
+	timeline::stop(fs::get_cache_dir() + "timeline.json");
+
 	vm::close();
 
 	if (do_exit)
@@ -9,6 +9,14 @@
 
 u64 get_system_time();
 
+namespace rsx
+{
+	struct replay_benchmark_settings;
+}
+
+struct title_benchmark_settings;
+class title_tuner;
+
 enum class system_state
 {
 	running,
@@ -32,6 +40,13 @@ enum class spu_decoder_type
 	llvm,
 };
 
+enum class ppu_llvm_pipeline
+{
+	minimal,  // No optimization passes
+	standard, // EarlyCSE and DSE, more passes for hot functions
+	extended, // Hot function passes for every function
+};
+
 enum class spu_block_size_type
 {
 	safe,
@@ -148,6 +163,13 @@ enum class frame_limit_type
 	_auto,
 };
 
+enum class vblank_rate_type
+{
+	_60,
+	_59_94,
+	_50,
+};
+
 enum class msaa_level
 {
 	none,
@@ -160,6 +182,7 @@ enum class detail_level
 	low,
 	medium,
 	high,
+	extreme,
 };
 
 enum class screen_quadrant
@@ -177,6 +200,13 @@ enum class tsx_usage
 	forced,
 };
 
+enum class thread_priority_policy
+{
+	disabled, // Leave native priorities alone
+	elevated, // Above normal for RSX, VBlank and audio threads
+	realtime, // Highest non-realtime level for RSX and VBlank, time-critical scheduling (MMCSS, SCHED_FIFO) for audio
+};
+
 enum enter_button_assign
 {
 	circle = 0, // CELL_SYSUTIL_ENTER_BUTTON_ASSIGN_CIRCLE
@@ -221,6 +251,7 @@ class Emulator final
 
 	std::string m_path;
 	std::string m_path_old;
+	std::string m_iso_path; // Booted disc image (m_path points inside of it)
 	std::string m_title_id;
 	std::string m_title;
 	std::string m_cat;
@@ -232,6 +263,10 @@ class Emulator final
 
 	bool m_force_boot = false;
 
+	// Started with the title when set
+	std::shared_ptr<title_benchmark_settings> m_title_benchmark;
+	std::shared_ptr<title_tuner> m_title_tuner;
+
 public:
 	Emulator() = default;
 
@@ -269,7 +304,7 @@ public:
 
 	const std::string& GetBoot() const
 	{
-		return m_path;
+		return m_iso_path.empty() ? m_path : m_iso_path;
 	}
 
 	const std::string& GetTitleID() const
@@ -319,7 +354,8 @@ public:
 	std::string PPUCache() const;
 
 	bool BootGame(const std::string& path, const std::string& title_id = "", bool direct = false, bool add_only = false, bool force_global_config = false);
-	bool BootRsxCapture(const std::string& path);
+	bool BootRsxCapture(const std::string& path, const rsx::replay_benchmark_settings* benchmark = nullptr);
+	bool BootSpuBenchmark(const std::string& path, const std::string& output_path);
 	bool InstallPkg(const std::string& path);
 
 private:
@@ -338,6 +374,18 @@ public:
 
 	void SetForceBoot(bool force_boot);
 
+	// Run the next booted title as a benchmark (stops and exits once its length is reached)
+	void SetTitleBenchmark(const title_benchmark_settings& settings);
+
+	// Set while the benchmark tunes the settings of the title
+	title_tuner* GetTitleTuner() const
+	{
+		return m_title_tuner.get();
+	}
+
+	// Compile all PPU modules of the next boot again, time every part and exit once done
+	void SetPpuCompileBenchmark(const std::string& output_path);
+
 	void Load(const std::string& title_id = "", bool add_only = false, bool force_global_config = false);
 	void Run();
 	bool Pause();
@@ -370,10 +418,27 @@ struct cfg_root : cfg::node
 		cfg::_enum<ppu_decoder_type> ppu_decoder{this, "PPU Decoder", ppu_decoder_type::llvm};
 		cfg::_int<1, 4> ppu_threads{this, "PPU Threads", 2}; // Amount of PPU threads running simultaneously (must be 2)
 		cfg::_bool ppu_debug{this, "PPU Debug"};
+		cfg::_bool ppu_llvm_breakpoints{this, "PPU LLVM Breakpoint Checks", false}; // Compile breakpoint check points into PPU LLVM code, so breakpoints work without the interpreter
 		cfg::_bool llvm_logs{this, "Save LLVM logs"};
 		cfg::string llvm_cpu{this, "Use LLVM CPU"};
 		cfg::_int<0, INT32_MAX> llvm_threads{this, "Max LLVM Compile Threads", 0};
+		cfg::_int<4, 1024> llvm_part_size{this, "PPU LLVM Module Part Size (KiB)", 100}; // Smaller parts make patched code recompile faster, but invalidate existing caches
+		cfg::_bool llvm_lazy{this, "PPU LLVM Lazy Compilation", false}; // Uncached code starts in the interpreter and is compiled in background
+		cfg::_enum<ppu_llvm_pipeline> llvm_pipeline{this, "PPU LLVM Optimization Pipeline", ppu_llvm_pipeline::standard};
+		cfg::_bool ppu_profile_guided{this, "PPU Profile-Guided Optimization", false}; // Count PPU function calls, optimize hot functions on next boot
+		cfg::_bool jit_huge_pages{this, "Use Huge Pages For JIT", false}; // Reduce iTLB misses with large amounts of recompiled code
+		cfg::_bool jit_symbol_export{this, "Export JIT Symbols", false}; // Write recompiled function names to /tmp/perf-<pid>.map for perf and VTune
+		cfg::_bool vm_huge_pages{this, "Use Huge Pages For Guest Memory", false}; // Reduce dTLB misses on main, user and video memory
+		cfg::_bool memory_heatmap{this, "Memory Access Heat Map", false}; // Sample guest memory accesses per 64K page and save them on stop
+		cfg::_bool llvm_compress_cache{this, "Compress PPU LLVM Cache", false}; // Store new PPU objects compressed with zlib (they are decompressed into private memory, raw objects are mapped and shared)
+		cfg::_bool llvm_shared_cache{this, "Share PPU Module Cache", true}; // Store identical PRX objects once for all titles
+		cfg::string llvm_remote_cache{this, "PPU LLVM Remote Cache Directory"}; // Shared directory (e.g. network mount) to fetch PPU objects from and publish them to
+		cfg::_bool self_cache{this, "Cache Decrypted Executables", false}; // Keep decrypted SELF/SPRX images on disk to skip decryption on the next boot
+		cfg::_bool image_decode_cache{this, "Cache Decoded Images", false}; // Reuse cellPngDec/cellJpgDec output when a title decodes the same image again
 		cfg::_bool thread_scheduler_enabled{this, "Enable thread scheduler", thread_scheduler_enabled_def};
+		cfg::_int<-1, 63> numa_node{this, "Preferred NUMA Node", -1}; // Bind emulation threads and guest memory to one NUMA node (-1 to disable)
+		cfg::string thread_placement{this, "Thread Placement Override"}; // CPU lists per thread class, e.g. "rsx=2-3;ppu_main=4-5;ppu=6-11;spu=6-11"
+		cfg::_enum<thread_priority_policy> thread_priority{this, "Thread Priority Policy", thread_priority_policy::elevated}; // Native priorities of latency-sensitive thread classes
 		cfg::_bool set_daz_and_ftz{this, "Set DAZ and FTZ", false};
 		cfg::_enum<spu_decoder_type> spu_decoder{this, "SPU Decoder", spu_decoder_type::asmjit};
 		cfg::_bool lower_spu_priority{this, "Lower SPU thread priority"};
@@ -387,9 +452,12 @@ struct cfg_root : cfg::node
 		cfg::_bool spu_accurate_putlluc{this, "Accurate PUTLLUC", false};
 		cfg::_bool spu_verification{this, "SPU Verification", true}; // Should be enabled
 		cfg::_bool spu_cache{this, "SPU Cache", true};
+		cfg::_bool spu_tiered{this, "SPU Tiered Compilation", false}; // Recompile ASMJIT functions with LLVM in the background
+		cfg::_bool spu_profiler{this, "SPU Profiler", false}; // Count entries and sample host time per compiled SPU function
 		cfg::_enum<tsx_usage> enable_TSX{this, "Enable TSX", tsx_usage::enabled}; // Enable TSX. Forcing this on Haswell/Broadwell CPUs should be used carefully
 		cfg::_bool spu_accurate_xfloat{this, "Accurate xfloat", false};
 		cfg::_bool spu_approx_xfloat{this, "Approximate xfloat", true};
+		cfg::_int<0, 256> spu_accurate_xfloat_threshold{this, "Accurate xfloat threshold", 0}; // Minimal number of xfloat instructions in a function to use accurate xfloat (0 = always)
 
 		cfg::_bool debug_console_mode{this, "Debug Console Mode", false}; // Debug console emulation, not recommended
 		cfg::_enum<lib_loading_type> lib_loading{this, "Lib Loader", lib_loading_type::liblv2only};
@@ -435,6 +503,7 @@ struct cfg_root : cfg::node
 		cfg::_enum<video_resolution> resolution{this, "Resolution", video_resolution::_720};
 		cfg::_enum<video_aspect> aspect_ratio{this, "Aspect ratio", video_aspect::_16_9};
 		cfg::_enum<frame_limit_type> frame_limit{this, "Frame limit", frame_limit_type::none};
+		cfg::_enum<vblank_rate_type> vblank_rate{this, "VBlank Rate", vblank_rate_type::_60};
 		cfg::_enum<msaa_level> antialiasing_level{this, "MSAA", msaa_level::_auto};
 
 		cfg::_bool write_color_buffers{this, "Write Color Buffers"};
@@ -451,22 +520,41 @@ struct cfg_root : cfg::node
 		cfg::_bool force_high_precision_z_buffer{this, "Force High Precision Z buffer"};
 		cfg::_bool strict_rendering_mode{this, "Strict Rendering Mode"};
 		cfg::_bool disable_zcull_queries{this, "Disable ZCull Occlusion Queries", false};
+		cfg::_bool relaxed_zcull_sync{this, "Relaxed ZCull Sync", false}; // Sync points don't wait for pending occlusion query results
 		cfg::_bool disable_vertex_cache{this, "Disable Vertex Cache", false};
 		cfg::_bool disable_FIFO_reordering{this, "Disable FIFO Reordering", false};
+		cfg::_bool fifo_batch_decode{this, "Batch FIFO Decoding", false}; // Decode all submitted arguments of a method packet at once
 		cfg::_bool frame_skip_enabled{this, "Enable Frame Skip", false};
+		cfg::_bool adaptive_frame_skip{this, "Adaptive Frame Skip", false}; // Only skip while emulation falls behind the frame limit, the consecutive frame counts become bounds
+		cfg::_bool adaptive_frame_skip_draws{this, "Adaptive Frame Skip Draws", false}; // Also drop the draws of frames skipped adaptively instead of only their presentation
 		cfg::_bool force_cpu_blit_processing{this, "Force CPU Blit", false}; // Debugging option
 		cfg::_bool disable_on_disk_shader_cache{this, "Disable On-Disk Shader Cache", false};
 		cfg::_bool disable_vulkan_mem_allocator{this, "Disable Vulkan Memory Allocator", false};
 		cfg::_bool full_rgb_range_output{this, "Use full RGB output range", true}; // Video out dynamic range
 		cfg::_bool disable_asynchronous_shader_compiler{this, "Disable Asynchronous Shader Compiler", false};
+		cfg::_bool shader_interpreter_fallback{this, "Use Shader Interpreter Fallback", false}; // Draw with a ucode interpreter while asynchronous shader compilation is pending
 		cfg::_bool strict_texture_flushing{this, "Strict Texture Flushing", false};
+		cfg::_bool texture_deduplication{this, "Texture Content Deduplication", false}; // Textures uploaded with identical contents share one image
+		cfg::_bool dump_texture_cache_statistics{this, "Dump Texture Cache Statistics", false}; // Write per-frame texture cache counters to texture_cache_stats.csv
+		cfg::_bool gpu_profiler{this, "GPU Timestamp Profiler", false}; // Time GPU work per category with timestamp queries, shown in the performance overlay and written to gpu_timings.csv
+		cfg::_bool write_tracking{this, "Write Tracking Invalidation", false}; // Detect writes to read-only textures by polling dirty pages instead of page faults (Linux, re-arms write tracking of the whole process every frame)
+		cfg::_bool deferred_protection{this, "Deferred Texture Protection", false}; // Batch protection tightening until the end of the draw, accesses in between are not caught
 		cfg::_bool disable_native_float16{this, "Disable native float16 support", false};
 		cfg::_int<1, 8> consequtive_frames_to_draw{this, "Consecutive Frames To Draw", 1};
 		cfg::_int<1, 8> consequtive_frames_to_skip{this, "Consecutive Frames To Skip", 1};
 		cfg::_int<50, 800> resolution_scale_percent{this, "Resolution Scale", 100};
+		cfg::_bool dynamic_resolution_scaling{this, "Dynamic Resolution Scaling", false}; // Adjust the resolution scale from measured GPU frame time (Vulkan only)
+		cfg::_int<50, 800> dynamic_resolution_min_scale{this, "Dynamic Resolution Minimum Scale", 50};
+		cfg::_int<50, 800> dynamic_resolution_max_scale{this, "Dynamic Resolution Maximum Scale", 200};
+		cfg::_int<1000, 100000> dynamic_resolution_target_frametime{this, "Dynamic Resolution Target Frame Time (us)", 16666};
 		cfg::_int<0, 16> anisotropic_level_override{this, "Anisotropic Filter Override", 0};
+		cfg::_int<0, 1024> persistent_vertex_cache_size{this, "Persistent Vertex Cache Size", 0}; // MB of vertex data kept across frames (0 = per-frame cache only)
+		cfg::_int<0, 8> buffer_conversion_threads{this, "Buffer Conversion Threads", 0}; // Helper threads for large vertex/index conversions (0 = disabled)
+		cfg::_int<0, 16> vdec_threads{this, "Video Decoder Threads", 0}; // FFmpeg threads per cellVdec decoder (0 = auto)
+		cfg::_int<0, 16384> vram_budget{this, "VRAM Budget (MB)", 0}; // Texture cache size above which textures unused for a few frames are evicted (0 = unlimited)
 		cfg::_int<1, 1024> min_scalable_dimension{this, "Minimum Scalable Dimension", 16};
 		cfg::_int<0, 30000000> driver_recovery_timeout{this, "Driver Recovery Timeout", 1000000};
+		cfg::_int<1, 1000> frames_to_capture{this, "Frames To Capture", 1}; // Number of consecutive frames recorded into one RSX capture
 
 		struct node_d3d12 : cfg::node
 		{
@@ -483,6 +571,14 @@ struct cfg_root : cfg::node
 			cfg::string adapter{this, "Adapter"};
 			cfg::_bool force_fifo{this, "Force FIFO present mode"};
 			cfg::_bool force_primitive_restart{this, "Force primitive restart flag"};
+			cfg::_bool gpu_texture_decode{this, "GPU texture decoding", false}; // Deswizzle and byteswap texture data with a compute shader
+			cfg::_int<0, 16> command_recording_threads{this, "Command recording threads", 0}; // Helper threads recording large draw clauses into secondary command buffers
+			cfg::_bool prefer_mailbox{this, "Prefer mailbox present mode", false}; // Tear-free presentation that replaces the queued frame instead of blocking
+			cfg::_bool async_present{this, "Asynchronous presentation", false}; // Present from a dedicated thread so that a blocking present does not stall emulation
+			cfg::_bool async_submit{this, "Asynchronous queue submission", false}; // Submit command buffers and poll their fences on a dedicated thread
+			cfg::_bool limit_frame_latency{this, "Limit frame latency", false}; // Wait for the previous frame after each flip, keeping at most one frame in flight
+			cfg::_bool async_transfer{this, "Asynchronous transfer queue", false}; // Copy staged ring buffer data on a dedicated transfer queue when the GPU has one
+			cfg::_int<1, 8> heap_growth_limit{this, "Ring buffer growth limit", 2}; // Ring buffers may grow up to this many times their default size before a full heap forces a flush
 
 		} vk{this};
 
@@ -493,6 +589,8 @@ struct cfg_root : cfg::node
 			cfg::_bool perf_overlay_enabled{this, "Enabled", false};
 			cfg::_enum<detail_level> level{this, "Detail level", detail_level::medium};
 			cfg::_int<30, 5000> update_interval{ this, "Metrics update interval (ms)", 350 };
+			cfg::_int<1, 120> statistics_window{ this, "Statistics window (s)", 10 }; // Frame time percentiles and thread usage of the extreme detail level cover this period
+			cfg::_bool write_statistics{ this, "Write Statistics CSV", false }; // Append the metrics to perf_metrics.csv in the cache directory at every update interval
 			cfg::_int<4, 36> font_size{ this, "Font size (px)", 10 };
 			cfg::_enum<screen_quadrant> position{this, "Position", screen_quadrant::top_left};
 			cfg::string font{this, "Font", "n023055ms.ttf"};
@@ -542,6 +640,7 @@ struct cfg_root : cfg::node
 		cfg::_int<0, 200> volume{this, "Master Volume", 100};
 		cfg::_bool enable_buffering{this, "Enable Buffering", true};
 		cfg::_int <20, 250> desired_buffer_duration{this, "Desired Audio Buffer Duration", 100};
+		cfg::_bool adaptive_buffering{this, "Adaptive Buffer Duration", false}; // Start at the desired duration, grow on underruns and shrink while playback is stable
 		cfg::_int<1, 1000> sampling_period_multiplier{this, "Sampling Period Multiplier", 100};
 		cfg::_bool enable_time_stretching{this, "Enable Time Stretching", false};
 		cfg::_int<0, 100> time_stretching_threshold{this, "Time Stretching Threshold", 75};
@@ -576,6 +675,7 @@ struct cfg_root : cfg::node
 
 		cfg::_enum<CellNetCtlState> net_status{this, "Connection status"};
 		cfg::string ip_address{this, "IP address", "192.168.1.1"};
+		cfg::_bool batch_udp{this, "Batch UDP Datagrams", false}; // Coalesce UDP sends and receives with sendmmsg/recvmmsg (Linux)
 
 	} net{this};
 
@@ -591,6 +691,10 @@ struct cfg_root : cfg::node
 		cfg::_bool show_shader_compilation_hint{ this, "Show shader compilation hint", true };
 		cfg::_bool use_native_interface{ this, "Use native user interface", true };
 		cfg::_int<1, 65535> gdb_server_port{this, "Port", 2345};
+		cfg::_bool write_timeline_trace{this, "Write Timeline Trace", false}; // Record PPU, SPU, RSX and audio activity into timeline.json in the cache directory
+		cfg::_bool lock_profiler{this, "Lock Contention Profiler", false}; // Record waits on host locks and lv2 sync objects, printed to the log on stop
+		cfg::_bool hle_call_stats{this, "HLE Call Statistics", false}; // Count HLE function and syscall calls with their latency, saved to hle_calls.csv in the cache directory on stop
+		cfg::_bool deferred_log{this, "Deferred Log Formatting", false}; // Format log file messages on the log writer thread instead of the emulation threads
 
 	} misc{this};
 
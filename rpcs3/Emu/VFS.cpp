@@ -15,12 +15,23 @@ struct vfs_directory
 	std::vector<std::pair<std::string, vfs_directory>> dirs;
 };
 
+struct vfs_cache_entry
+{
+	std::size_t hash = 0;
+	std::string vpath;
+	std::string path;
+};
+
 struct vfs_manager
 {
 	shared_mutex mutex;
 
 	// VFS root
 	vfs_directory root;
+
+	// Recently resolved paths (direct-mapped, cleared on mount)
+	shared_mutex cache_mutex;
+	std::array<vfs_cache_entry, 1024> cache;
 };
 
 bool vfs::mount(std::string_view vpath, std::string_view path)
@@ -50,6 +61,15 @@ bool vfs::mount(std::string_view vpath, std::string_view path)
 		{
 			// Mounting completed
 			list.back()->path = path;
+
+			// Drop all cached resolutions, they may point to the previous mount
+			std::lock_guard cache_lock(table->cache_mutex);
+
+			for (auto& entry : table->cache)
+			{
+				entry = {};
+			}
+
 			return true;
 		}
 
@@ -96,12 +116,8 @@ bool vfs::mount(std::string_view vpath, std::string_view path)
 	}
 }
 
-std::string vfs::get(std::string_view vpath, std::vector<std::string>* out_dir)
+static std::string vfs_resolve(const vfs_manager* table, std::string_view vpath, std::vector<std::string>* out_dir)
 {
-	const auto table = fxm::get_always<vfs_manager>();
-
-	reader_lock lock(table->mutex);
-
 	// Resulting path fragments: decoded ones
 	std::vector<std::string_view> result;
 	result.reserve(vpath.size() / 2);
@@ -231,6 +247,46 @@ std::string vfs::get(std::string_view vpath, std::vector<std::string>* out_dir)
 	return std::string{result_base} + vfs::escape(fmt::merge(result, "/"));
 }
 
+std::string vfs::get(std::string_view vpath, std::vector<std::string>* out_dir)
+{
+	const auto table = fxm::get_always<vfs_manager>();
+
+	if (out_dir)
+	{
+		// Directory listing requests are not cached
+		reader_lock lock(table->mutex);
+		return vfs_resolve(table.get(), vpath, out_dir);
+	}
+
+	const std::size_t hash = std::hash<std::string_view>()(vpath);
+	auto& entry = table->cache[hash % table->cache.size()];
+
+	{
+		// Hits don't touch the mount table, mount() clears the cache after modifying it
+		reader_lock lock(table->cache_mutex);
+
+		if (entry.hash == hash && entry.vpath == vpath && !entry.vpath.empty())
+		{
+			return entry.path;
+		}
+	}
+
+	reader_lock lock(table->mutex);
+
+	std::string result = vfs_resolve(table.get(), vpath, nullptr);
+
+	if (!vpath.empty())
+	{
+		// Store while still holding the mount table lock so that a concurrent mount() can't be missed
+		std::lock_guard cache_lock(table->cache_mutex);
+		entry.hash = hash;
+		entry.vpath = vpath;
+		entry.path = result;
+	}
+
+	return result;
+}
+
 std::string vfs::escape(std::string_view path)
 {
 	std::string result;
@@ -460,12 +516,12 @@ std::string vfs::unescape(std::string_view path)
 	return result;
 }
 
-bool vfs::host::rename(const std::string& from, const std::string& to, bool overwrite)
+bool vfs::host::rename(const std::string& from, const std::string& to, bool overwrite, bool abort_on_stop)
 {
 	while (!fs::rename(from, to, overwrite))
 	{
 		// Try to ignore access error in order to prevent spurious failure
-		if (Emu.IsStopped() || fs::g_tls_error != fs::error::acces)
+		if ((abort_on_stop && Emu.IsStopped()) || fs::g_tls_error != fs::error::acces)
 		{
 			return false;
 		}
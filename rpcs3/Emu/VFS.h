@@ -21,8 +21,8 @@ namespace vfs
 	// Functions in this namespace operate on host filepaths, similar to fs::
 	namespace host
 	{
-		// Call fs::rename with retry on access error
-		bool rename(const std::string& from, const std::string& to, bool overwrite);
+		// Call fs::rename with retry on access error (until the emulator is stopped, unless abort_on_stop is false)
+		bool rename(const std::string& from, const std::string& to, bool overwrite, bool abort_on_stop = true);
 
 		// Delete file without deleting its contents, emulated with MoveFileEx on Windows
 		bool unlink(const std::string&);
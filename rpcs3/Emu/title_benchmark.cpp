@@ -0,0 +1,633 @@
+﻿#include "stdafx.h"
+#include "title_benchmark.h"
+
+#include "Emu/System.h"
+#include "Emu/IdManager.h"
+#include "Emu/Cell/PPUThread.h"
+#include "Emu/Cell/SPUThread.h"
+#include "Emu/RSX/GSRender.h"
+#include "Utilities/CPUStats.h"
+#include "Utilities/StrUtil.h"
+#include "Utilities/sysinfo.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Compilation counters, updated by the PPU and SPU recompilers
+atomic_t<u64> g_ppu_modules_loaded{0};
+atomic_t<u64> g_ppu_modules_compiled{0};
+atomic_t<u64> g_spu_functions_precompiled{0};
+atomic_t<u64> g_spu_functions_compiled{0};
+
+title_benchmark::title_benchmark(const title_benchmark_settings& settings)
+	: m_settings(settings)
+{
+}
+
+bool title_benchmark::load_script()
+{
+	const fs::file file(m_settings.pad_script);
+
+	if (!file)
+	{
+		LOG_ERROR(GENERAL, "Benchmark: failed to open the pad script %s (%s)", m_settings.pad_script, fs::g_tls_error);
+		return false;
+	}
+
+	// Each line is "<flip> [button...] [lx=<0-255>] [ly=..] [rx=..] [ry=..]", held until the next line
+	static const std::pair<const char*, std::pair<bool, u16>> s_buttons[] =
+	{
+		{ "left", { false, CELL_PAD_CTRL_LEFT } },
+		{ "down", { false, CELL_PAD_CTRL_DOWN } },
+		{ "right", { false, CELL_PAD_CTRL_RIGHT } },
+		{ "up", { false, CELL_PAD_CTRL_UP } },
+		{ "start", { false, CELL_PAD_CTRL_START } },
+		{ "r3", { false, CELL_PAD_CTRL_R3 } },
+		{ "l3", { false, CELL_PAD_CTRL_L3 } },
+		{ "select", { false, CELL_PAD_CTRL_SELECT } },
+		{ "square", { true, CELL_PAD_CTRL_SQUARE } },
+		{ "cross", { true, CELL_PAD_CTRL_CROSS } },
+		{ "circle", { true, CELL_PAD_CTRL_CIRCLE } },
+		{ "triangle", { true, CELL_PAD_CTRL_TRIANGLE } },
+		{ "r1", { true, CELL_PAD_CTRL_R1 } },
+		{ "l1", { true, CELL_PAD_CTRL_L1 } },
+		{ "r2", { true, CELL_PAD_CTRL_R2 } },
+		{ "l2", { true, CELL_PAD_CTRL_L2 } },
+	};
+
+	static const char* s_sticks[] = { "lx=", "ly=", "rx=", "ry=" };
+
+	u32 line_index = 0;
+
+	for (const std::string& line : fmt::split(file.to_string(), { "\n" }))
+	{
+		line_index++;
+
+		const auto tokens = fmt::split(line, { " ", "\t", "\r" });
+
+		if (tokens.empty() || tokens[0][0] == '#')
+		{
+			continue;
+		}
+
+		script_step step{};
+
+		try
+		{
+			step.flip = std::stoull(tokens[0]);
+
+			for (std::size_t i = 1; i < tokens.size(); i++)
+			{
+				const std::string token = fmt::to_lower(tokens[i]);
+
+				const auto button = std::find_if(std::begin(s_buttons), std::end(s_buttons), [&](const auto& b) { return token == b.first; });
+
+				if (button != std::end(s_buttons))
+				{
+					(button->second.first ? step.state.digital_2 : step.state.digital_1) |= button->second.second;
+					continue;
+				}
+
+				const auto stick = std::find_if(std::begin(s_sticks), std::end(s_sticks), [&](const char* s) { return token.compare(0, 3, s) == 0; });
+
+				if (stick == std::end(s_sticks))
+				{
+					LOG_ERROR(GENERAL, "Benchmark: unknown input '%s' in line %u of the pad script", tokens[i], line_index);
+					return false;
+				}
+
+				step.state.sticks[stick - std::begin(s_sticks)] = static_cast<u16>(std::min<unsigned long>(std::stoul(token.substr(3)), 255));
+			}
+		}
+		catch (const std::exception&)
+		{
+			LOG_ERROR(GENERAL, "Benchmark: invalid line %u of the pad script", line_index);
+			return false;
+		}
+
+		if (!m_script.empty() && step.flip < m_script.back().flip)
+		{
+			LOG_ERROR(GENERAL, "Benchmark: line %u of the pad script is out of order", line_index);
+			return false;
+		}
+
+		m_script.emplace_back(std::move(step));
+	}
+
+	LOG_NOTICE(GENERAL, "Benchmark: loaded %u pad script steps", m_script.size());
+	return true;
+}
+
+void title_benchmark::update_script()
+{
+	const auto handler = pad::g_current.load();
+
+	if (!handler)
+	{
+		return;
+	}
+
+	while (m_script_pos < m_script.size() && m_script[m_script_pos].flip <= m_flip_times.size())
+	{
+		handler->SetScriptedInput(&m_script[m_script_pos++].state);
+	}
+}
+
+std::vector<f64> title_benchmark::get_frame_times() const
+{
+	std::vector<f64> frametimes; // ms
+
+	for (std::size_t i = 1; i < m_flip_times.size(); i++)
+	{
+		frametimes.push_back((m_flip_times[i] - m_flip_times[i - 1]) / 1000.);
+	}
+
+	std::sort(frametimes.begin(), frametimes.end());
+	return frametimes;
+}
+
+void title_benchmark::write_report()
+{
+	const std::string path = m_settings.output_path.empty() ? fs::get_cache_dir() + "title_benchmark.json" : m_settings.output_path;
+
+	const std::vector<f64> frametimes = get_frame_times();
+	const std::size_t count = frametimes.size();
+
+	f64 total = 0.;
+	for (const f64 time : frametimes)
+	{
+		total += time;
+	}
+
+	// Nearest rank percentiles, same as the performance overlay
+	const auto percentile = [&](u32 per_mille)
+	{
+		return count ? frametimes[(count * per_mille + 999) / 1000 - 1] : 0.;
+	};
+
+	// Average frame rate of the slowest frames, at least the slowest one
+	const auto low_fps = [&](std::size_t divisor)
+	{
+		if (!count)
+		{
+			return 0.;
+		}
+
+		const std::size_t slowest = std::max<std::size_t>(count / divisor, 1);
+		f64 sum = 0.;
+
+		for (std::size_t n = count - slowest; n < count; ++n)
+		{
+			sum += frametimes[n];
+		}
+
+		return sum > 0. ? slowest * 1000. / sum : 0.;
+	};
+
+	const f64 average = count ? total / count : 0.;
+
+	usage_sample usage{};
+	for (const auto& sample : m_usage)
+	{
+		usage.ppu += sample.ppu * sample.elapsed;
+		usage.spu += sample.spu * sample.elapsed;
+		usage.rsx += sample.rsx * sample.elapsed;
+		usage.process += sample.process * sample.elapsed;
+		usage.elapsed += sample.elapsed;
+	}
+
+	if (usage.elapsed > 0.)
+	{
+		usage.ppu /= usage.elapsed;
+		usage.spu /= usage.elapsed;
+		usage.rsx /= usage.elapsed;
+		usage.process /= usage.elapsed;
+	}
+
+	const auto ratio = [](u64 hits, u64 total)
+	{
+		return total ? static_cast<f64>(hits) / total : 0.;
+	};
+
+	const auto escape = [](const std::string& str)
+	{
+		std::string result;
+
+		for (const char c : str)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+			}
+
+			if (static_cast<u8>(c) >= 0x20)
+			{
+				result += c;
+			}
+		}
+
+		return result;
+	};
+
+	const u64 ppu_loaded = g_ppu_modules_loaded;
+	const u64 ppu_compiled = g_ppu_modules_compiled;
+	const u64 spu_precompiled = g_spu_functions_precompiled;
+	const u64 spu_compiled = g_spu_functions_compiled;
+
+	std::string json = "{\n";
+	fmt::append(json, "\t\"title\": \"%s\",\n", escape(Emu.GetTitle()));
+	fmt::append(json, "\t\"title_id\": \"%s\",\n", escape(Emu.GetTitleID()));
+	fmt::append(json, "\t\"flips\": %u,\n", m_flip_times.size());
+	fmt::append(json, "\t\"duration_s\": %.3f,\n", (get_system_time() - m_start_time) / 1000000.);
+	fmt::append(json, "\t\"fps\": { \"average\": %.3f, \"median\": %.3f, \"low_1\": %.3f, \"low_01\": %.3f },\n",
+		average > 0. ? 1000. / average : 0., count ? 1000. / percentile(500) : 0., low_fps(100), low_fps(1000));
+	fmt::append(json, "\t\"frame_time_ms\": { \"average\": %.3f, \"median\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f },\n",
+		average, percentile(500), percentile(900), percentile(990), percentile(999), count ? frametimes.back() : 0.);
+	fmt::append(json, "\t\"cpu_usage\": { \"ppu\": %.2f, \"spu\": %.2f, \"rsx\": %.2f, \"process\": %.2f },\n", usage.ppu, usage.spu, usage.rsx, usage.process);
+	fmt::append(json, "\t\"compiled\": { \"ppu_modules\": %u, \"spu_functions\": %u, \"rsx_pipelines\": %u },\n", ppu_compiled, spu_compiled - std::min(spu_precompiled, spu_compiled), m_pipelines_compiled);
+	fmt::append(json, "\t\"cached\": { \"ppu_modules\": %u, \"spu_functions\": %u },\n", ppu_loaded, spu_precompiled);
+	fmt::append(json, "\t\"hit_rate\": { \"ppu_cache\": %.4f, \"spu_cache\": %.4f, \"texture_cache\": %.4f },\n",
+		ratio(ppu_loaded, ppu_loaded + ppu_compiled), ratio(spu_precompiled, spu_compiled), ratio(m_texture_hits, m_texture_hits + m_texture_misses));
+	fmt::append(json, "\t\"draw_calls_per_frame\": %.1f\n", m_flip_times.empty() ? 0. : static_cast<f64>(m_draw_calls) / m_flip_times.size());
+	json += "}\n";
+
+	if (!fs::file(path, fs::rewrite).write(json))
+	{
+		LOG_ERROR(GENERAL, "Benchmark: failed to write the report %s", path);
+		return;
+	}
+
+	LOG_SUCCESS(GENERAL, "Benchmark: %u flips, %.2f fps average, report written to %s", m_flip_times.size(), average > 0. ? 1000. / average : 0., path);
+}
+
+void title_benchmark::operator()()
+{
+	if (const auto render = fxm::get<GSRender>())
+	{
+		// Record frame statistics but keep the configured frame limit
+		render->benchmark_mode = true;
+		render->benchmark_frame_limit = true;
+	}
+	else
+	{
+		LOG_ERROR(GENERAL, "Benchmark: no renderer is running");
+		return;
+	}
+
+	if (!m_settings.pad_script.empty() && !load_script())
+	{
+		m_script.clear();
+	}
+
+	CPUStats cpu_stats;
+	std::vector<rsx::frame_benchmark_stats> frames;
+
+	m_start_time = get_system_time();
+	u64 last_sample = m_start_time;
+	bool finished = false;
+
+	while (thread_ctrl::state() != thread_state::aborting && !Emu.IsStopped())
+	{
+		thread_ctrl::wait_for(10000);
+
+		const auto render = fxm::get<GSRender>();
+
+		if (!render)
+		{
+			break;
+		}
+
+		frames.clear();
+		render->take_frame_benchmark_stats(frames);
+
+		for (const auto& stats : frames)
+		{
+			m_flip_times.push_back(stats.timestamp);
+			m_pipelines_compiled += stats.pipelines_compiled;
+			m_draw_calls += stats.draw_calls;
+			m_texture_hits += stats.texture_hits;
+			m_texture_misses += stats.texture_misses;
+		}
+
+		update_script();
+
+		const u64 now = get_system_time();
+
+		if (now - last_sample >= 1000000)
+		{
+			// Thread cycles since the previous sample, used to split the process usage
+			u64 ppu_cycles = 0, spu_cycles = 0;
+
+			idm::select<named_thread<ppu_thread>>([&](u32, named_thread<ppu_thread>& ppu)
+			{
+				ppu_cycles += thread_ctrl::get_cycles(ppu);
+			});
+
+			idm::select<named_thread<spu_thread>>([&](u32, named_thread<spu_thread>& spu)
+			{
+				spu_cycles += thread_ctrl::get_cycles(spu);
+			});
+
+			const u64 rsx_cycles = render->get_cycles();
+			const f64 total_cycles = static_cast<f64>(ppu_cycles + spu_cycles + rsx_cycles);
+			const f64 cpu_usage = cpu_stats.get_usage();
+
+			// The first sample only initializes the counters
+			if (last_sample != m_start_time && total_cycles > 0. && cpu_usage >= 0.)
+			{
+				m_usage.push_back({ (now - last_sample) / 1000000., cpu_usage * ppu_cycles / total_cycles, cpu_usage * spu_cycles / total_cycles, cpu_usage * rsx_cycles / total_cycles, cpu_usage });
+			}
+
+			last_sample = now;
+		}
+
+		if ((m_settings.flips && m_flip_times.size() >= m_settings.flips) || (m_settings.seconds && now - m_start_time >= m_settings.seconds * 1000000ull))
+		{
+			finished = true;
+			break;
+		}
+	}
+
+	if (const auto handler = pad::g_current.load(); handler && !m_script.empty())
+	{
+		handler->SetScriptedInput(nullptr);
+	}
+
+	write_report();
+
+	if (const auto tuner = Emu.GetTitleTuner(); tuner && finished)
+	{
+		const std::vector<f64> frametimes = get_frame_times();
+
+		// Mean of the average and 99th percentile frame times, so both throughput and stutter count
+		f64 score = std::numeric_limits<f64>::infinity();
+
+		if (const std::size_t count = frametimes.size(); count >= 2)
+		{
+			f64 total = 0.;
+			for (const f64 time : frametimes)
+			{
+				total += time;
+			}
+
+			score = (total / count + frametimes[(count * 990 + 999) / 1000 - 1]) / 2;
+		}
+
+		if (tuner->report(score))
+		{
+			Emu.CallAfter([]()
+			{
+				Emu.Restart();
+			});
+
+			return;
+		}
+	}
+
+	if (finished)
+	{
+		Emu.CallAfter([]()
+		{
+			// Benchmarks are started from the command line, leave once the report is out
+			Emu.Stop();
+
+			if (!g_cfg.misc.autoexit)
+			{
+				Emu.GetCallbacks().exit();
+			}
+		});
+	}
+}
+
+namespace
+{
+	// Relative frame time difference considered run-to-run noise
+	constexpr f64 tuner_noise_margin = 0.02;
+
+	template <typename T>
+	std::string cfg_value(const T& value)
+	{
+		return fmt::format("%s", value);
+	}
+}
+
+void title_tuner::init()
+{
+	m_base = g_cfg.to_string();
+
+	const auto& core = g_cfg.core;
+	const auto& video = g_cfg.video;
+
+	const bool use_rtm = utils::has_rtm() && ((utils::has_mpx() && core.enable_TSX == tsx_usage::enabled) || core.enable_TSX == tsx_usage::forced);
+
+	// Larger blocks are less accurate, only go towards smaller ones
+	tunable block_size{"SPU Block Size", [](cfg_root& c) -> cfg::_base& { return c.core.spu_block_size; }, kind::accuracy, true};
+
+	switch (core.spu_block_size)
+	{
+	case spu_block_size_type::giga: block_size.values.emplace_back(cfg_value(spu_block_size_type::mega)); [[fallthrough]];
+	case spu_block_size_type::mega: block_size.values.emplace_back(cfg_value(spu_block_size_type::safe)); break;
+	default: break;
+	}
+
+	m_tunables.emplace_back(std::move(block_size));
+
+	// Interpreters are only chosen for accuracy, switch between recompilers only
+	tunable decoder{"SPU Decoder", [](cfg_root& c) -> cfg::_base& { return c.core.spu_decoder; }, kind::performance, true};
+
+#ifdef LLVM_AVAILABLE
+	if (core.spu_decoder == spu_decoder_type::asmjit)
+	{
+		decoder.values.emplace_back(cfg_value(spu_decoder_type::llvm));
+	}
+	else if (core.spu_decoder == spu_decoder_type::llvm)
+	{
+		decoder.values.emplace_back(cfg_value(spu_decoder_type::asmjit));
+	}
+#endif
+
+	m_tunables.emplace_back(std::move(decoder));
+
+	// Ignored with TSX, which is tuned after it
+	tunable spu_threads{"Preferred SPU Threads", [](cfg_root& c) -> cfg::_base& { return c.core.preferred_spu_threads; }, kind::performance};
+
+	for (u32 i = 0; !use_rtm && i <= 6; i++)
+	{
+		if (i != core.preferred_spu_threads)
+		{
+			spu_threads.values.emplace_back(std::to_string(i));
+		}
+	}
+
+	m_tunables.emplace_back(std::move(spu_threads));
+
+	// Forcing TSX is left to the user
+	tunable tsx{"Enable TSX", [](cfg_root& c) -> cfg::_base& { return c.core.enable_TSX; }, kind::performance};
+
+	if (utils::has_rtm() && core.enable_TSX != tsx_usage::forced)
+	{
+		tsx.values.emplace_back(cfg_value(core.enable_TSX == tsx_usage::enabled ? tsx_usage::disabled : tsx_usage::enabled));
+	}
+
+	m_tunables.emplace_back(std::move(tsx));
+
+	tunable getllar{"Accurate GETLLAR", [](cfg_root& c) -> cfg::_base& { return c.core.spu_accurate_getllar; }, kind::accuracy};
+
+	if (!core.spu_accurate_getllar)
+	{
+		getllar.values.emplace_back("true");
+	}
+
+	m_tunables.emplace_back(std::move(getllar));
+
+	tunable fifo{"Batch FIFO Decoding", [](cfg_root& c) -> cfg::_base& { return c.video.fifo_batch_decode; }, kind::performance};
+	fifo.values.emplace_back(video.fifo_batch_decode ? "false" : "true");
+	m_tunables.emplace_back(std::move(fifo));
+
+	tunable vertex_cache{"Disable Vertex Cache", [](cfg_root& c) -> cfg::_base& { return c.video.disable_vertex_cache; }, kind::performance};
+	vertex_cache.values.emplace_back(video.disable_vertex_cache ? "false" : "true");
+	m_tunables.emplace_back(std::move(vertex_cache));
+
+	tunable zcull{"Relaxed ZCull Sync", [](cfg_root& c) -> cfg::_base& { return c.video.relaxed_zcull_sync; }, kind::accuracy};
+
+	if (video.relaxed_zcull_sync)
+	{
+		zcull.values.emplace_back("false");
+	}
+
+	m_tunables.emplace_back(std::move(zcull));
+
+	// Dynamic resolution scaling picks the scale by itself
+	tunable scale{"Resolution Scale", [](cfg_root& c) -> cfg::_base& { return c.video.resolution_scale_percent; }, kind::quality};
+
+	for (u32 percent = 150; !video.dynamic_resolution_scaling && percent <= 300; percent += 50)
+	{
+		if (percent > video.resolution_scale_percent)
+		{
+			scale.values.emplace_back(std::to_string(percent));
+		}
+	}
+
+	m_tunables.emplace_back(std::move(scale));
+
+	for (auto& t : m_tunables)
+	{
+		m_best.emplace_back(t.get(g_cfg).to_string());
+	}
+
+	std::size_t trials = 0;
+	for (const auto& t : m_tunables)
+	{
+		trials += t.values.size();
+	}
+
+	LOG_NOTICE(GENERAL, "Tuner: %u candidate settings to try", trials);
+}
+
+void title_tuner::apply()
+{
+	if (!m_started)
+	{
+		m_started = true;
+		init();
+	}
+
+	for (std::size_t i = 0; i < m_tunables.size(); i++)
+	{
+		const bool trial = !m_baseline && i == m_index;
+
+		m_tunables[i].get(g_cfg).from_string(trial ? m_tunables[i].values[m_value] : m_best[i]);
+	}
+
+	if (m_warmup)
+	{
+		LOG_NOTICE(GENERAL, "Tuner: warm-up boot");
+	}
+	else if (!m_baseline)
+	{
+		LOG_NOTICE(GENERAL, "Tuner: trying %s = %s", m_tunables[m_index].name, m_tunables[m_index].values[m_value]);
+	}
+}
+
+bool title_tuner::report(f64 score)
+{
+	if (m_warmup)
+	{
+		// Measure the same settings again with warm caches
+		m_warmup = false;
+		return true;
+	}
+
+	if (m_baseline)
+	{
+		m_baseline = false;
+		m_best_score = score;
+		m_score = score;
+		LOG_NOTICE(GENERAL, "Tuner: starting settings score %.3f ms", score);
+	}
+	else
+	{
+		const tunable& t = m_tunables[m_index];
+
+		// Quality and accuracy steps are measured against the fastest score rather than the last kept one, so they can't add up beyond the margin
+		const bool accepted = t.type == kind::performance ? score < m_score * (1. - tuner_noise_margin) : score <= m_best_score * (1. + tuner_noise_margin);
+
+		LOG_NOTICE(GENERAL, "Tuner: %s = %s scores %.3f ms (kept %.3f ms, fastest %.3f ms), %s", t.name, t.values[m_value], score, m_score, m_best_score, accepted ? "kept" : "rejected");
+
+		if (accepted)
+		{
+			m_best[m_index] = t.values[m_value];
+			m_score = score;
+
+			if (t.type == kind::performance)
+			{
+				m_best_score = std::min(m_best_score, score);
+			}
+		}
+
+		// Further steps towards quality or accuracy only cost more
+		m_value = !accepted && t.type != kind::performance ? t.values.size() : m_value + 1;
+	}
+
+	while (m_index < m_tunables.size() && m_value >= m_tunables[m_index].values.size())
+	{
+		m_index++;
+		m_value = 0;
+	}
+
+	if (m_index < m_tunables.size())
+	{
+		m_warmup = m_tunables[m_index].recompiles;
+		return true;
+	}
+
+	save();
+	return false;
+}
+
+void title_tuner::save() const
+{
+	const auto cfg = std::make_unique<cfg_root>();
+	cfg->from_default();
+	cfg->from_string(m_base);
+
+	std::string summary;
+
+	for (std::size_t i = 0; i < m_tunables.size(); i++)
+	{
+		m_tunables[i].get(*cfg).from_string(m_best[i]);
+		fmt::append(summary, "\n%s: %s", m_tunables[i].name, m_best[i]);
+	}
+
+	// Homebrew without a title ID uses the config next to its executable
+	const std::string& title_id = Emu.GetTitleID();
+	const std::string path = title_id.empty() ? Emu.GetBoot() + ".yml" : Emulator::GetCustomConfigPath(title_id);
+
+	if ((!title_id.empty() && !fs::create_path(Emulator::GetCustomConfigDir())) || !fs::write_file(path, fs::rewrite, cfg->to_string()))
+	{
+		LOG_ERROR(GENERAL, "Tuner: failed to write the custom config %s (%s)", path, fs::g_tls_error);
+		return;
+	}
+
+	LOG_SUCCESS(GENERAL, "Tuner: best settings (%.3f ms) written to %s:%s", m_score, path, summary);
+}
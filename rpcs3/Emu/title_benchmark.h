@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Utilities/types.h"
+#include "pad_thread.h"
+
+#include <string>
+#include <vector>
+
+struct cfg_root;
+
+namespace cfg
+{
+	class _base;
+}
+
+// Fixed-length unattended run of a title, set with Emulator::SetTitleBenchmark
+struct title_benchmark_settings
+{
+	u32 flips = 0;           // Stop after this many emulated flips (0 = no limit)
+	u32 seconds = 0;         // Stop after this many seconds (0 = no limit)
+	std::string pad_script;  // Optional pad input script for the first pad
+	std::string output_path; // Defaults to title_benchmark.json in the cache directory
+	bool tune = false;       // Boot repeatedly with candidate settings and save the fastest ones in the custom config
+};
+
+// Collects frame, thread and compiler statistics of a running title and writes them as JSON
+class title_benchmark
+{
+	struct script_step
+	{
+		u64 flip; // Applied once this many flips have been counted
+		scripted_pad_state state;
+	};
+
+	struct usage_sample
+	{
+		f64 elapsed; // s
+		f64 ppu, spu, rsx, process; // % of the host CPU
+	};
+
+	title_benchmark_settings m_settings;
+
+	std::vector<script_step> m_script;
+	std::size_t m_script_pos = 0;
+
+	std::vector<u64> m_flip_times; // us
+	std::vector<usage_sample> m_usage;
+
+	u64 m_start_time = 0;
+	u64 m_pipelines_compiled = 0;
+	u64 m_draw_calls = 0;
+	u64 m_texture_hits = 0;
+	u64 m_texture_misses = 0;
+
+	bool load_script();
+	void update_script();
+	std::vector<f64> get_frame_times() const;
+	void write_report();
+
+public:
+	title_benchmark(const title_benchmark_settings& settings);
+
+	void operator()();
+};
+
+// Finds the fastest settings of a title with repeated benchmark runs, changing one setting at a time
+class title_tuner
+{
+	enum class kind
+	{
+		performance, // Kept if the frame time improves beyond the noise margin
+		quality,     // Raised step by step while the frame time doesn't get worse
+		accuracy,    // Correctness-sensitive: never relaxed, made more accurate while the frame time doesn't get worse
+	};
+
+	struct tunable
+	{
+		const char* name;
+		cfg::_base& (*get)(cfg_root&);
+		kind type;
+		bool recompiles; // Trials start with a warm-up boot which fills the code caches
+		std::vector<std::string> values; // Candidates in trial order
+	};
+
+	std::vector<tunable> m_tunables;
+	std::vector<std::string> m_best; // Best value of each tunable, the starting value until a candidate wins
+	std::string m_base; // Configuration of the first boot, before any candidate
+
+	std::size_t m_index = 0; // Tunable on trial
+	std::size_t m_value = 0; // Candidate of it
+	bool m_started = false;
+	bool m_baseline = true;
+	bool m_warmup = true;
+	f64 m_best_score = 0.; // Fastest score measured, only lowered by performance candidates
+	f64 m_score = 0.; // Score of the kept settings, quality and accuracy steps may raise it within the noise margin of the fastest
+
+	void init();
+	void save() const;
+
+public:
+	// Set the trial's settings, called after the configuration of each boot is loaded
+	void apply();
+
+	// Score the finished run (lower is better), returns true if the title must be booted again
+	bool report(f64 score);
+};
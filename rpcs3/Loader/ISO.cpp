@@ -0,0 +1,539 @@
+#include "stdafx.h"
+
+#include "ISO.h"
+
+#include <unordered_set>
+
+namespace
+{
+	constexpr u64 sector_size = 2048;
+
+	u32 read_u32(const u8* ptr)
+	{
+		// Both-endian fields, use the little endian half
+		u32 value;
+		std::memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	// Directory record date: years since 1900, month, day, hour, minute, second, GMT offset (15 minute units)
+	s64 iso_time(const u8* t)
+	{
+		const u32 month = t[1];
+		const u32 day = t[2];
+
+		if (!month || month > 12 || !day)
+		{
+			return 0;
+		}
+
+		// Days since 1970-01-01 (civil calendar)
+		const s64 year = t[0] + 1900 - (month <= 2);
+		const s64 era = year / 400;
+		const s64 yoe = year - era * 400;
+		const s64 doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+		const s64 days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+
+		return days * 86400 + t[3] * 3600 + t[4] * 60 + t[5] - static_cast<s8>(t[6]) * 900;
+	}
+
+	std::string iso_name(const u8* name, u32 size, bool joliet)
+	{
+		std::string result;
+
+		if (joliet)
+		{
+			// UCS-2 BE to UTF-8
+			for (u32 i = 0; i + 1 < size; i += 2)
+			{
+				const u32 c = name[i] << 8 | name[i + 1];
+
+				if (c < 0x80)
+				{
+					result += static_cast<char>(c);
+				}
+				else if (c < 0x800)
+				{
+					result += static_cast<char>(0xc0 | c >> 6);
+					result += static_cast<char>(0x80 | (c & 0x3f));
+				}
+				else
+				{
+					result += static_cast<char>(0xe0 | c >> 12);
+					result += static_cast<char>(0x80 | (c >> 6 & 0x3f));
+					result += static_cast<char>(0x80 | (c & 0x3f));
+				}
+			}
+		}
+		else
+		{
+			result.assign(reinterpret_cast<const char*>(name), size);
+		}
+
+		// Remove file version and the separator of names without extension ("EBOOT.BIN;1", "FILE.;1")
+		if (const auto pos = result.find_last_of(';'); pos != -1)
+		{
+			result.resize(pos);
+
+			if (!result.empty() && result.back() == '.')
+			{
+				result.pop_back();
+			}
+		}
+
+		return result;
+	}
+
+	class iso_file final : public fs::file_base
+	{
+		const std::shared_ptr<iso_device> m_dev; // Keeps the image mapped
+
+		const u8* const m_ptr;
+		const u64 m_size;
+		const s64 m_mtime;
+
+		u64 m_pos{};
+
+	public:
+		iso_file(std::shared_ptr<iso_device> dev, const iso_device::entry& entry)
+			: m_dev(std::move(dev))
+			, m_ptr(m_dev->data() + entry.offset)
+			, m_size(entry.size)
+			, m_mtime(entry.mtime)
+		{
+		}
+
+		fs::stat_t stat() override
+		{
+			fs::stat_t info{};
+			info.is_directory = false;
+			info.is_writable = false;
+			info.size = m_size;
+			info.atime = m_mtime;
+			info.mtime = m_mtime;
+			info.ctime = m_mtime;
+			return info;
+		}
+
+		bool trunc(u64 length) override
+		{
+			fs::g_tls_error = fs::error::acces;
+			return false;
+		}
+
+		u64 read(void* buffer, u64 count) override
+		{
+			if (m_pos < m_size)
+			{
+				// Get readable size
+				if (const u64 result = std::min<u64>(count, m_size - m_pos))
+				{
+					std::memcpy(buffer, m_ptr + m_pos, result);
+					m_pos += result;
+					return result;
+				}
+			}
+
+			return 0;
+		}
+
+		u64 write(const void* buffer, u64 count) override
+		{
+			fs::g_tls_error = fs::error::acces;
+			return 0;
+		}
+
+		u64 seek(s64 offset, fs::seek_mode whence) override
+		{
+			const s64 new_pos =
+				whence == fs::seek_set ? offset :
+				whence == fs::seek_cur ? offset + m_pos :
+				whence == fs::seek_end ? offset + m_size :
+				(fmt::raw_error("iso_file::seek(): invalid whence"), 0);
+
+			if (new_pos < 0)
+			{
+				fs::g_tls_error = fs::error::inval;
+				return -1;
+			}
+
+			m_pos = new_pos;
+			return m_pos;
+		}
+
+		u64 size() override
+		{
+			return m_size;
+		}
+	};
+
+	class iso_dir final : public fs::dir_base
+	{
+		const std::shared_ptr<iso_device> m_dev;
+		const iso_device::entry& m_entry;
+
+		std::size_t m_pos = 0;
+
+	public:
+		iso_dir(std::shared_ptr<iso_device> dev, const iso_device::entry& entry)
+			: m_dev(std::move(dev))
+			, m_entry(entry)
+		{
+		}
+
+		bool read(fs::dir_entry& info) override
+		{
+			// Start with "." and ".." like native directories
+			if (m_pos >= m_entry.children.size() + 2)
+			{
+				return false;
+			}
+
+			const std::size_t pos = m_pos++;
+			const iso_device::entry& found = pos < 2 ? m_entry : m_dev->get(m_entry.children[pos - 2]);
+
+			info.name = pos == 0 ? "." : pos == 1 ? ".." : found.name;
+			info.is_directory = found.is_dir;
+			info.is_writable = false;
+			info.size = found.is_dir ? 0 : found.size;
+			info.atime = found.mtime;
+			info.mtime = found.mtime;
+			info.ctime = found.mtime;
+			return true;
+		}
+
+		void rewind() override
+		{
+			m_pos = 0;
+		}
+	};
+}
+
+iso_device::iso_device(const std::string& root, fs::file_view&& view)
+	: m_root(root)
+	, m_view(std::move(view))
+{
+}
+
+std::shared_ptr<iso_device> iso_device::load(const std::string& root, const std::string& path)
+{
+	fs::file file(path);
+
+	if (!file)
+	{
+		LOG_ERROR(LOADER, "ISO: Failed to open %s (%s)", path, fs::g_tls_error);
+		return nullptr;
+	}
+
+	auto dev = std::make_shared<iso_device>(root, file.map());
+
+	if (!dev->m_view.is_mapped())
+	{
+		LOG_WARNING(LOADER, "ISO: Failed to map %s, the image was read to memory", path);
+	}
+
+	// Find the primary volume descriptor and optional Joliet supplementary descriptor
+	const u8* root_record = nullptr;
+	bool joliet = false;
+
+	for (u64 pos = 16 * sector_size; pos + sector_size <= dev->m_view.size(); pos += sector_size)
+	{
+		const u8* desc = dev->data() + pos;
+
+		if (std::memcmp(desc + 1, "CD001", 5) != 0 || desc[0] == 255)
+		{
+			break;
+		}
+
+		if (desc[0] == 1 && !root_record)
+		{
+			root_record = desc + 156;
+		}
+		else if (desc[0] == 2 && desc[88] == 0x25 && desc[89] == 0x2f && (desc[90] == 0x40 || desc[90] == 0x43 || desc[90] == 0x45))
+		{
+			root_record = desc + 156;
+			joliet = true;
+		}
+	}
+
+	if (!root_record)
+	{
+		LOG_ERROR(LOADER, "ISO: %s is not an ISO 9660 image", path);
+		return nullptr;
+	}
+
+	entry& first = dev->m_entries.emplace_back();
+	first.offset = read_u32(root_record + 2) * sector_size;
+	first.size = read_u32(root_record + 10);
+	first.mtime = iso_time(root_record + 18);
+	first.is_dir = true;
+	dev->m_index.emplace("", 0);
+
+	std::unordered_set<u64> scanned;
+	std::vector<std::pair<u32, std::string>> queue{{0, ""}};
+
+	while (!queue.empty())
+	{
+		const auto [index, dir] = queue.back();
+		queue.pop_back();
+
+		// Directories pointing to already scanned extents would loop
+		if (scanned.emplace(dev->m_entries[index].offset).second)
+		{
+			dev->read_dir(index, dir, joliet, queue);
+		}
+	}
+
+	LOG_NOTICE(LOADER, "ISO: Indexed %u entries of %s%s", dev->m_entries.size(), path, joliet ? " (Joliet)" : "");
+	return dev;
+}
+
+void iso_device::read_dir(u32 index, const std::string& path, bool joliet, std::vector<std::pair<u32, std::string>>& queue)
+{
+	const u64 offset = m_entries[index].offset;
+	const u64 size = m_entries[index].size;
+
+	if (offset + size > m_view.size())
+	{
+		LOG_ERROR(LOADER, "ISO: Directory /%s is out of image bounds", path);
+		return;
+	}
+
+	// Last file with the multi-extent flag, continued by the next record with the same name
+	u32 extended = -1;
+
+	for (u64 pos = 0; pos < size;)
+	{
+		const u8* rec = data() + offset + pos;
+		const u32 len = rec[0];
+
+		if (len == 0)
+		{
+			// Records don't cross sector boundaries, the rest of the sector is padding
+			pos = (pos / sector_size + 1) * sector_size;
+			continue;
+		}
+
+		if (len < 34 || pos + len > size || 33u + rec[32] > len)
+		{
+			LOG_ERROR(LOADER, "ISO: Invalid directory record in /%s", path);
+			return;
+		}
+
+		pos += len;
+
+		// Skip "." and ".."
+		if (rec[32] == 1 && rec[33] <= 1)
+		{
+			continue;
+		}
+
+		const u64 child_offset = read_u32(rec + 2) * sector_size;
+		const u64 child_size = read_u32(rec + 10);
+		const u8 flags = rec[25];
+		std::string name = iso_name(rec + 33, rec[32], joliet);
+
+		if (child_offset + child_size > m_view.size())
+		{
+			LOG_ERROR(LOADER, "ISO: Entry /%s/%s is out of image bounds", path, name);
+			continue;
+		}
+
+		if (extended != -1 && m_entries[extended].name == name)
+		{
+			entry& prev = m_entries[extended];
+
+			if (prev.offset + prev.size != child_offset)
+			{
+				LOG_ERROR(LOADER, "ISO: Fragmented file /%s/%s is not supported", path, name);
+			}
+			else
+			{
+				prev.size += child_size;
+			}
+
+			extended = flags & 0x80 ? extended : -1;
+			continue;
+		}
+
+		const u32 child = ::size32(m_entries);
+		const std::string child_path = path.empty() ? name : path + '/' + name;
+
+		entry& e = m_entries.emplace_back();
+		e.name = std::move(name);
+		e.offset = child_offset;
+		e.size = child_size;
+		e.mtime = iso_time(rec + 18);
+		e.is_dir = (flags & 0x2) != 0;
+
+		m_entries[index].children.push_back(child);
+		m_index.emplace(child_path, child);
+
+		extended = !e.is_dir && flags & 0x80 ? child : -1;
+
+		if (e.is_dir)
+		{
+			queue.emplace_back(child, child_path);
+		}
+	}
+}
+
+const iso_device::entry* iso_device::find(const std::string& path) const
+{
+	// Strip device name and normalize the rest ("//iso/PS3_GAME//USRDIR/" -> "PS3_GAME/USRDIR")
+	std::string key;
+	key.reserve(path.size());
+
+	for (std::size_t pos = m_root.size(); pos < path.size();)
+	{
+		const std::size_t end = std::min(path.find_first_of('/', pos), path.size());
+		const std::string_view name(path.data() + pos, end - pos);
+		pos = end + 1;
+
+		if (name.empty() || name == ".")
+		{
+			continue;
+		}
+
+		if (name == "..")
+		{
+			const auto slash = key.find_last_of('/');
+			key.resize(slash == -1 ? 0 : slash);
+			continue;
+		}
+
+		if (!key.empty())
+		{
+			key += '/';
+		}
+
+		key += name;
+	}
+
+	if (const auto found = m_index.find(key); found != m_index.end())
+	{
+		return &m_entries[found->second];
+	}
+
+	fs::g_tls_error = fs::error::noent;
+	return nullptr;
+}
+
+bool iso_device::stat(const std::string& path, fs::stat_t& info)
+{
+	const entry* const found = find(path);
+
+	if (!found)
+	{
+		return false;
+	}
+
+	info.is_directory = found->is_dir;
+	info.is_writable = false;
+	info.size = found->is_dir ? 0 : found->size;
+	info.atime = found->mtime;
+	info.mtime = found->mtime;
+	info.ctime = found->mtime;
+	return true;
+}
+
+bool iso_device::statfs(const std::string& path, fs::device_stat& info)
+{
+	info.block_size = sector_size;
+	info.total_size = m_view.size();
+	info.total_free = 0;
+	info.avail_free = 0;
+	return true;
+}
+
+bool iso_device::remove_dir(const std::string& path)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+bool iso_device::create_dir(const std::string& path)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+bool iso_device::rename(const std::string& from, const std::string& to)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+bool iso_device::remove(const std::string& path)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+bool iso_device::trunc(const std::string& path, u64 length)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+bool iso_device::utime(const std::string& path, s64 atime, s64 mtime)
+{
+	fs::g_tls_error = fs::error::acces;
+	return false;
+}
+
+std::unique_ptr<fs::file_base> iso_device::open(const std::string& path, bs_t<fs::open_mode> mode)
+{
+	if (mode & (fs::write + fs::append + fs::create + fs::trunc + fs::excl))
+	{
+		fs::g_tls_error = fs::error::acces;
+		return nullptr;
+	}
+
+	const entry* const found = find(path);
+
+	if (!found)
+	{
+		return nullptr;
+	}
+
+	if (found->is_dir)
+	{
+		fs::g_tls_error = fs::error::inval;
+		return nullptr;
+	}
+
+	return std::make_unique<iso_file>(shared_from_this(), *found);
+}
+
+std::unique_ptr<fs::dir_base> iso_device::open_dir(const std::string& path)
+{
+	const entry* const found = find(path);
+
+	if (!found)
+	{
+		return nullptr;
+	}
+
+	if (!found->is_dir)
+	{
+		fs::g_tls_error = fs::error::inval;
+		return nullptr;
+	}
+
+	return std::make_unique<iso_dir>(shared_from_this(), *found);
+}
+
+std::string iso_mount(const std::string& path)
+{
+	const auto dev = iso_device::load("//iso", path);
+
+	if (!dev)
+	{
+		return {};
+	}
+
+	// Replaces (and eventually closes) the previously mounted image
+	fs::set_virtual_device("//iso", dev);
+	return "//iso/";
+}
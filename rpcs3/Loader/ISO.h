@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Utilities/File.h"
+
+#include <unordered_map>
+
+// Read-only ISO 9660 image as a virtual device (Joliet names are used if present)
+// The directory tree is indexed once, file reads are copies from the memory-mapped image
+class iso_device final : public fs::device_base, public std::enable_shared_from_this<iso_device>
+{
+public:
+	struct entry
+	{
+		std::string name;
+		u64 offset; // Byte offset in the image
+		u64 size;
+		s64 mtime;
+		bool is_dir;
+		std::vector<u32> children; // Directory contents (entry indices)
+	};
+
+private:
+	const std::string m_root; // Device name ("//name")
+
+	fs::file_view m_view;
+
+	std::vector<entry> m_entries; // The first one is the root directory
+
+	std::unordered_map<std::string, u32> m_index; // Path without device name ("PS3_GAME/USRDIR") to entry index
+
+	// Add directory contents, subdirectories to scan are appended to the queue
+	void read_dir(u32 index, const std::string& path, bool joliet, std::vector<std::pair<u32, std::string>>& queue);
+
+	const entry* find(const std::string& path) const;
+
+public:
+	iso_device(const std::string& root, fs::file_view&& view);
+
+	// Open and index the image, returns nullptr if it isn't a valid ISO 9660 image
+	static std::shared_ptr<iso_device> load(const std::string& root, const std::string& path);
+
+	const entry& get(u32 index) const
+	{
+		return m_entries[index];
+	}
+
+	const u8* data() const
+	{
+		return m_view.data();
+	}
+
+	bool stat(const std::string& path, fs::stat_t& info) override;
+	bool statfs(const std::string& path, fs::device_stat& info) override;
+	bool remove_dir(const std::string& path) override;
+	bool create_dir(const std::string& path) override;
+	bool rename(const std::string& from, const std::string& to) override;
+	bool remove(const std::string& path) override;
+	bool trunc(const std::string& path, u64 length) override;
+	bool utime(const std::string& path, s64 atime, s64 mtime) override;
+
+	std::unique_ptr<fs::file_base> open(const std::string& path, bs_t<fs::open_mode> mode) override;
+	std::unique_ptr<fs::dir_base> open_dir(const std::string& path) override;
+};
+
+// Mount ISO image as the "//iso" virtual device, returns its root path ("//iso/") or empty string on failure
+std::string iso_mount(const std::string& path);
@@ -40,3 +40,17 @@ fs::file pup_object::get_file(u64 entry_id)
 	}
 	return fs::file();
 }
+
+u64 pup_object::get_file_offset(u64 entry_id) const
+{
+	if (!isValid) return -1;
+
+	for (const PUPFileEntry& file_entry : m_file_tbl)
+	{
+		if (file_entry.entry_id == entry_id)
+		{
+			return file_entry.data_offset;
+		}
+	}
+	return -1;
+}
@@ -44,4 +44,7 @@ public:
 	explicit operator bool() const { return isValid; }
 
 	fs::file get_file(u64 entry_id);
+
+	// Get the offset of the entry data in the PUP file (-1 if not found)
+	u64 get_file_offset(u64 entry_id) const;
 };
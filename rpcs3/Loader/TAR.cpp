@@ -66,6 +66,12 @@ fs::file tar_object::get_file(std::string path)
 		{
 			TARHeader header = read_header(largest_offset);
 
+			if (!header.name[0])
+			{
+				// End of archive (the archive may be embedded in a larger file)
+				break;
+			}
+
 			if (std::string(header.magic).find("ustar") != std::string::npos)
 				m_map[header.name] = largest_offset;
 
@@ -113,7 +119,39 @@ bool tar_object::extract(std::string path, std::string ignore)
 		case '0':
 		{
 			fs::file file(result, fs::rewrite);
-			file.write(get_file(header.name).to_vector<u8>());
+
+			if (!file)
+			{
+				// Parent directory may be provided by another archive extracted concurrently
+				fs::create_path(fs::get_parent_dir(result));
+				file.open(result, fs::rewrite);
+			}
+
+			if (!file)
+			{
+				LOG_ERROR(GENERAL, "TAR Loader: failed to create %s (%s)", result, fs::g_tls_error);
+				return false;
+			}
+
+			// Copy the contents in chunks instead of buffering the whole entry
+			u64 size = octalToDecimal(atoi(header.size));
+			m_file.seek(iter.second + sizeof(TARHeader));
+
+			std::vector<u8> buf(std::min<u64>(size, 0x100000));
+
+			while (size)
+			{
+				const u64 chunk = std::min<u64>(size, buf.size());
+
+				if (m_file.read(buf.data(), chunk) != chunk || file.write(buf.data(), chunk) != chunk)
+				{
+					LOG_ERROR(GENERAL, "TAR Loader: failed to extract %s", result);
+					return false;
+				}
+
+				size -= chunk;
+			}
+
 			break;
 		}
 
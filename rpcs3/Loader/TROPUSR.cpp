@@ -112,25 +112,33 @@ bool TROPUSRLoader::Save(const std::string& filepath)
 		return false;
 	}
 
-	m_file.write(m_header);
+	m_file.write(Serialize());
+	m_file.release();
+	return true;
+}
+
+std::vector<uchar> TROPUSRLoader::Serialize() const
+{
+	fs::file stream = fs::make_stream<std::vector<uchar>>();
+
+	stream.write(m_header);
 
 	for (const TROPUSRTableHeader& tableHeader : m_tableHeaders)
 	{
-		m_file.write(tableHeader);
+		stream.write(tableHeader);
 	}
 
 	for (const auto& entry : m_table4)
 	{
-		m_file.write(entry);
+		stream.write(entry);
 	}
 
 	for (const auto& entry : m_table6)
 	{
-		m_file.write(entry);
+		stream.write(entry);
 	}
 
-	m_file.release();
-	return true;
+	return std::move(static_cast<fs::container_stream<std::vector<uchar>>&>(*stream.release()).obj);
 }
 
 bool TROPUSRLoader::Generate(const std::string& filepath, const std::string& configpath)
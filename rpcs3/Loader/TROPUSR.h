@@ -72,6 +72,9 @@ public:
 	virtual bool Load(const std::string& filepath, const std::string& configpath);
 	virtual bool Save(const std::string& filepath);
 
+	// Get the file contents as Save() would write them
+	virtual std::vector<uchar> Serialize() const;
+
 	virtual u32 GetTrophiesCount();
 	virtual u32 GetUnlockedTrophiesCount();
 
@@ -698,6 +698,17 @@ int evdev_joystick_handler::add_device(const std::string& device, bool in_settin
 	return -1;
 }
 
+void evdev_joystick_handler::GetEventDescriptors(std::vector<int>& fds)
+{
+	for (const auto& device : devices)
+	{
+		if (device.device)
+		{
+			fds.push_back(libevdev_get_fd(device.device));
+		}
+	}
+}
+
 void evdev_joystick_handler::ThreadProc()
 {
 	update_devs();
@@ -9,6 +9,8 @@
 
 #include "rpcs3_app.h"
 #include "Utilities/sema.h"
+#include "Emu/RSX/Capture/rsx_replay.h"
+#include "Emu/title_benchmark.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -127,6 +129,43 @@ int main(int argc, char** argv)
 
 	const QCommandLineOption helpOption = parser.addHelpOption();
 	const QCommandLineOption versionOption = parser.addVersionOption();
+
+	// RSX capture replay benchmark, uses the renderer selected in the config
+	const QCommandLineOption rsxBenchmarkOption("rsx-benchmark", "Replay an RSX capture as a benchmark and write the per frame results as CSV.", "capture");
+	const QCommandLineOption rsxBenchmarkFramesOption("rsx-benchmark-frames", "Number of times the capture is replayed.", "count", "100");
+	const QCommandLineOption rsxBenchmarkOutputOption("rsx-benchmark-output", "Benchmark results file, defaults to rsx_benchmark.csv in the cache directory.", "file");
+	const QCommandLineOption rsxBenchmarkNoPresentOption("rsx-benchmark-no-present", "Render the replayed frames without presenting them.");
+	parser.addOption(rsxBenchmarkOption);
+	parser.addOption(rsxBenchmarkFramesOption);
+	parser.addOption(rsxBenchmarkOutputOption);
+	parser.addOption(rsxBenchmarkNoPresentOption);
+
+	// Fixed-length title benchmark, boots the (S)ELF given as positional argument
+	const QCommandLineOption headlessOption("headless", "Keep the main window hidden.");
+	const QCommandLineOption benchmarkFlipsOption("benchmark-flips", "Run the booted title for this many flips, then write a benchmark report and exit.", "count");
+	const QCommandLineOption benchmarkSecondsOption("benchmark-seconds", "Run the booted title for this many seconds, then write a benchmark report and exit.", "seconds");
+	const QCommandLineOption benchmarkPadScriptOption("benchmark-pad-script", "Pad input script played on the first pad during the benchmark.", "file");
+	const QCommandLineOption benchmarkOutputOption("benchmark-output", "Benchmark report file, defaults to title_benchmark.json in the cache directory.", "file");
+	const QCommandLineOption benchmarkTuneOption("benchmark-tune", "Boot the title repeatedly with candidate settings and save the fastest ones in its custom configuration.");
+	parser.addOption(headlessOption);
+	parser.addOption(benchmarkFlipsOption);
+	parser.addOption(benchmarkSecondsOption);
+	parser.addOption(benchmarkPadScriptOption);
+	parser.addOption(benchmarkOutputOption);
+	parser.addOption(benchmarkTuneOption);
+
+	// SPU recompiler benchmark over the functions of an SPU cache file
+	const QCommandLineOption spuBenchmarkOption("spu-benchmark", "Compile all functions of an SPU cache file with each SPU recompiler and block size and write the timings as CSV.", "cache");
+	const QCommandLineOption spuBenchmarkOutputOption("spu-benchmark-output", "SPU benchmark results file, defaults to spu_benchmark.csv in the cache directory.", "file");
+	parser.addOption(spuBenchmarkOption);
+	parser.addOption(spuBenchmarkOutputOption);
+
+	// PPU compile benchmark, boots the (S)ELF or SPRX directory given as positional argument
+	const QCommandLineOption ppuBenchmarkOption("ppu-compile-benchmark", "Compile all PPU modules of the booted (S)ELF or SPRX directory again, write the timings of every part as CSV and exit.");
+	const QCommandLineOption ppuBenchmarkOutputOption("ppu-compile-benchmark-output", "PPU compile benchmark results file, defaults to ppu_compile_benchmark.csv in the cache directory.", "file");
+	parser.addOption(ppuBenchmarkOption);
+	parser.addOption(ppuBenchmarkOutputOption);
+
 	parser.parse(QCoreApplication::arguments());
 	parser.process(app);
 
@@ -136,12 +175,60 @@ int main(int argc, char** argv)
 	if (parser.isSet(helpOption))
 		return true;
 
-	app.Init();
+	app.Init(parser.isSet(headlessOption));
 
 	QStringList args = parser.positionalArguments();
 
-	if (args.length() > 0)
+	if (parser.isSet(rsxBenchmarkOption))
+	{
+		rsx::replay_benchmark_settings benchmark;
+		benchmark.iterations = std::max(parser.value(rsxBenchmarkFramesOption).toUInt(), 1u);
+		benchmark.null_present = parser.isSet(rsxBenchmarkNoPresentOption);
+		benchmark.output_path = sstr(parser.value(rsxBenchmarkOutputOption));
+
+		QTimer::singleShot(2, [path = sstr(QFileInfo(parser.value(rsxBenchmarkOption)).canonicalFilePath()), benchmark = std::move(benchmark)]()
+		{
+			if (!Emu.BootRsxCapture(path, &benchmark))
+			{
+				LOG_ERROR(LOADER, "Failed to start the RSX benchmark with %s", path);
+			}
+		});
+	}
+	else if (parser.isSet(spuBenchmarkOption))
+	{
+		QTimer::singleShot(2, [path = sstr(QFileInfo(parser.value(spuBenchmarkOption)).canonicalFilePath()), output = sstr(parser.value(spuBenchmarkOutputOption))]()
+		{
+			if (!Emu.BootSpuBenchmark(path, output))
+			{
+				LOG_ERROR(LOADER, "Failed to start the SPU benchmark with %s", path);
+			}
+		});
+	}
+	else if (args.length() > 0)
 	{
+		if (parser.isSet(benchmarkFlipsOption) || parser.isSet(benchmarkSecondsOption) || parser.isSet(benchmarkTuneOption))
+		{
+			title_benchmark_settings benchmark;
+			benchmark.flips = parser.value(benchmarkFlipsOption).toUInt();
+			benchmark.seconds = parser.value(benchmarkSecondsOption).toUInt();
+			benchmark.pad_script = sstr(parser.value(benchmarkPadScriptOption));
+			benchmark.output_path = sstr(parser.value(benchmarkOutputOption));
+			benchmark.tune = parser.isSet(benchmarkTuneOption);
+
+			if (!benchmark.flips && !benchmark.seconds)
+			{
+				// Every trial needs the same fixed segment
+				benchmark.seconds = 60;
+			}
+
+			Emu.SetTitleBenchmark(benchmark);
+		}
+
+		if (parser.isSet(ppuBenchmarkOption))
+		{
+			Emu.SetPpuCompileBenchmark(sstr(parser.value(ppuBenchmarkOutputOption)));
+		}
+
 		// Propagate command line arguments
 		std::vector<std::string> argv;
 
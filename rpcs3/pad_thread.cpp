@@ -10,6 +10,10 @@
 #include "keyboard_pad_handler.h"
 #include "Emu/Io/Null/NullPadHandler.h"
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
 namespace pad
 {
 	atomic_t<pad_thread*> g_current = nullptr;
@@ -17,6 +21,21 @@ namespace pad
 	std::string g_title_id;
 }
 
+namespace
+{
+	// Poll interval limits (in microseconds), the maximum is used while the game doesn't read pads
+	constexpr u64 min_poll_interval = 1000;
+	constexpr u64 max_poll_interval = 8000;
+
+	// Game reads older than this are considered stopped
+	constexpr u64 sample_timeout = 500'000;
+
+	u64 pad_time()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
 struct pad_setting
 {
 	u32 port_status;
@@ -46,6 +65,9 @@ void pad_thread::Init()
 {
 	std::lock_guard lock(pad::g_pad_mutex);
 
+	// Pads are rebuilt, the scripted one is set up again on the next update
+	m_script_connected = false;
+
 	// Cache old settings if possible
 	std::vector<pad_setting> pad_settings;
 	for (u32 i = 0; i < CELL_PAD_MAX_PORT_NUM; i++) // max 7 pads
@@ -167,6 +189,147 @@ void pad_thread::SetIntercepted(bool intercepted)
 	}
 }
 
+void pad_thread::SetScriptedInput(const scripted_pad_state* state)
+{
+	std::lock_guard lock(m_script_mutex);
+
+	if (state)
+	{
+		m_script_state = *state;
+	}
+	else if (m_script_connected)
+	{
+		// No device to give the pad back to, keep it connected with nothing pressed
+		m_script_state = scripted_pad_state{};
+	}
+	else
+	{
+		m_script_state.reset();
+	}
+}
+
+void pad_thread::ApplyScriptedInput()
+{
+	std::lock_guard lock(m_script_mutex);
+
+	const auto& pad = m_pads[0];
+
+	if (!m_script_state || !pad)
+	{
+		return;
+	}
+
+	std::lock_guard pad_lock(pad::g_pad_mutex);
+
+	if (pad->m_buttons.empty())
+	{
+		// Bound to the null handler, give the pad a standard layout
+		pad->Init(CELL_PAD_STATUS_CONNECTED | CELL_PAD_STATUS_ASSIGN_CHANGES, CELL_PAD_CAPABILITY_PS3_CONFORMITY | CELL_PAD_CAPABILITY_PRESS_MODE, CELL_PAD_DEV_TYPE_STANDARD, 0);
+
+		for (u32 bit = 0; bit < 8; bit++)
+		{
+			pad->m_buttons.emplace_back(CELL_PAD_BTN_OFFSET_DIGITAL1, 0, 1u << bit);
+			pad->m_buttons.emplace_back(CELL_PAD_BTN_OFFSET_DIGITAL2, 0, 1u << bit);
+		}
+
+		pad->m_sticks.emplace_back(CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X, 0, 0);
+		pad->m_sticks.emplace_back(CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y, 0, 0);
+		pad->m_sticks.emplace_back(CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X, 0, 0);
+		pad->m_sticks.emplace_back(CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y, 0, 0);
+
+		m_script_connected = true;
+	}
+
+	for (Button& button : pad->m_buttons)
+	{
+		const u16 bits = button.m_offset == CELL_PAD_BTN_OFFSET_DIGITAL1 ? m_script_state->digital_1 : m_script_state->digital_2;
+
+		button.m_pressed = (bits & button.m_outKeyCode) != 0;
+		button.m_value = button.m_pressed ? 255 : 0;
+	}
+
+	for (AnalogStick& stick : pad->m_sticks)
+	{
+		switch (stick.m_offset)
+		{
+		case CELL_PAD_BTN_OFFSET_ANALOG_LEFT_X: stick.m_value = m_script_state->sticks[0]; break;
+		case CELL_PAD_BTN_OFFSET_ANALOG_LEFT_Y: stick.m_value = m_script_state->sticks[1]; break;
+		case CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_X: stick.m_value = m_script_state->sticks[2]; break;
+		case CELL_PAD_BTN_OFFSET_ANALOG_RIGHT_Y: stick.m_value = m_script_state->sticks[3]; break;
+		default: break;
+		}
+	}
+}
+
+void pad_thread::NotifySampled()
+{
+	const u64 now = pad_time();
+	const u64 last = m_last_sample.exchange(now);
+
+	if (last && now - last < sample_timeout)
+	{
+		// Exponential moving average, tolerant to occasional double reads
+		const u64 period = m_sample_period;
+		m_sample_period = period ? (period * 7 + (now - last)) / 8 : now - last;
+	}
+}
+
+u64 pad_thread::GetPollInterval() const
+{
+	const u64 period = m_sample_period;
+
+	if (!period || pad_time() - m_last_sample > sample_timeout)
+	{
+		return max_poll_interval;
+	}
+
+	// Poll a few times per game read so the data it gets is never more than a fraction of its period old
+	return std::clamp(period / 4, min_poll_interval, max_poll_interval);
+}
+
+void pad_thread::WaitForInput(u64 usec)
+{
+#ifndef _WIN32
+	std::vector<int> fds;
+
+	for (auto& cur_pad_handler : handlers)
+	{
+		cur_pad_handler.second->GetEventDescriptors(fds);
+	}
+
+	if (!fds.empty())
+	{
+		std::vector<pollfd> pfds(fds.size());
+
+		for (std::size_t i = 0; i < fds.size(); i++)
+		{
+			pfds[i].fd = fds[i];
+			pfds[i].events = POLLIN;
+		}
+
+		// Wake up immediately on new input events
+		if (::poll(pfds.data(), pfds.size(), static_cast<int>(usec / 1000)) <= 0)
+		{
+			return;
+		}
+
+		for (const pollfd& pfd : pfds)
+		{
+			if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
+			{
+				// Unplugged device, don't spin until the handler notices
+				std::this_thread::sleep_for(std::chrono::microseconds(usec));
+				break;
+			}
+		}
+
+		return;
+	}
+#endif
+
+	std::this_thread::sleep_for(std::chrono::microseconds(usec));
+}
+
 void pad_thread::ThreadFunc()
 {
 	active = true;
@@ -174,7 +337,7 @@ void pad_thread::ThreadFunc()
 	{
 		if (!is_enabled)
 		{
-			std::this_thread::sleep_for(1ms);
+			std::this_thread::sleep_for(std::chrono::microseconds(max_poll_interval));
 			continue;
 		}
 		if (reset && reset.exchange(false))
@@ -187,7 +350,8 @@ void pad_thread::ThreadFunc()
 			cur_pad_handler.second->ThreadProc();
 			connected += cur_pad_handler.second->connected;
 		}
-		m_info.now_connect = connected;
-		std::this_thread::sleep_for(1ms);
+		ApplyScriptedInput();
+		m_info.now_connect = connected + (m_script_connected ? 1 : 0);
+		WaitForInput(GetPollInterval());
 	}
 }
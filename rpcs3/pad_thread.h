@@ -3,10 +3,19 @@
 #include <map>
 #include <thread>
 #include <mutex>
+#include <optional>
 
 #include "../Utilities/types.h"
 #include "Emu/Io/PadHandler.h"
 
+// Pad state forced by an input script (title benchmark)
+struct scripted_pad_state
+{
+	u16 digital_1 = 0; // CELL_PAD_CTRL_* bits of the first digital word
+	u16 digital_2 = 0; // CELL_PAD_CTRL_* bits of the second digital word
+	std::array<u16, 4> sticks{ 128, 128, 128, 128 }; // Left X, left Y, right X, right Y
+};
+
 struct PadInfo
 {
 	u32 now_connect;
@@ -27,8 +36,17 @@ public:
 	void SetEnabled(bool enabled);
 	void SetIntercepted(bool intercepted);
 
+	// Replace the state of the first pad, nullptr gives it back to its handler
+	void SetScriptedInput(const scripted_pad_state* state);
+
+	// Called when the game reads pad data, adapts the poll rate to the game's sampling rate
+	void NotifySampled();
+
 protected:
 	void ThreadFunc();
+	void ApplyScriptedInput();
+	u64 GetPollInterval() const;
+	void WaitForInput(u64 usec);
 
 	// List of all handlers
 	std::map<pad_handler, std::shared_ptr<PadHandlerBase>> handlers;
@@ -44,6 +62,14 @@ protected:
 	atomic_t<bool> reset{ false };
 	atomic_t<bool> is_enabled{ true };
 	std::shared_ptr<std::thread> thread;
+
+	// Time of the last game read and the smoothed period between reads (in microseconds)
+	atomic_t<u64> m_last_sample{ 0 };
+	atomic_t<u64> m_sample_period{ 0 };
+
+	std::mutex m_script_mutex;
+	std::optional<scripted_pad_state> m_script_state;
+	bool m_script_connected = false; // The scripted pad had no device and was connected by the script
 };
 
 namespace pad
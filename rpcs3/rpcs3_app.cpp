@@ -65,7 +65,7 @@ rpcs3_app::rpcs3_app(int& argc, char** argv) : QApplication(argc, argv)
 {
 }
 
-void rpcs3_app::Init()
+void rpcs3_app::Init(bool headless)
 {
 	setApplicationName("RPCS3");
 	setWindowIcon(QIcon(":/rpcs3.ico"));
@@ -87,7 +87,11 @@ void rpcs3_app::Init()
 
 	RPCS3MainWin->Init();
 
-	if (guiSettings->GetValue(gui::ib_show_welcome).toBool())
+	if (headless)
+	{
+		RPCS3MainWin->hide();
+	}
+	else if (guiSettings->GetValue(gui::ib_show_welcome).toBool())
 	{
 		welcome_dialog* welcome = new welcome_dialog();
 		welcome->exec();
@@ -33,8 +33,9 @@ class rpcs3_app : public QApplication
 public:
 	rpcs3_app(int& argc, char** argv);
 	/** Call this method before calling app.exec
+	*   headless: keep the main window hidden and skip the welcome dialog (unattended runs)
 	*/
-	void Init();
+	void Init(bool headless = false);
 
 	/** Emu.Init() wrapper for user manager */
 	static bool InitializeEmulator(const std::string& user, bool force_init);
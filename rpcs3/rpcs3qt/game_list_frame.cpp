@@ -10,6 +10,7 @@
 #include "Emu/System.h"
 #include "Loader/PSF.h"
 #include "Utilities/types.h"
+#include "Utilities/Thread.h"
 
 #include <algorithm>
 #include <iterator>
@@ -448,32 +449,99 @@ void game_list_frame::Refresh(const bool fromDrive, const bool scrollAfter)
 
 		QSet<QString> serials;
 
-		for (const auto& dir : path_list) { try
+		// Parse PSF files on the worker pool, the results are merged in the original order below
+		struct sfo_result
 		{
-			const std::string sfo_dir = Emulator::GetSfoDirFromGamePath(dir, Emu.GetUsr());
-			const fs::file sfo_file(sfo_dir + "/PARAM.SFO");
-			if (!sfo_file)
+			GameInfo game;
+			std::string psf_category; // Category as stored in the PSF (used by the duplicate detection)
+			bool valid = false;
+		};
+
+		std::vector<sfo_result> sfo_results(path_list.size());
+
+		{
+			worker_pool::group jobs;
+
+			for (std::size_t i = 0; i < path_list.size(); i++)
 			{
-				continue;
+				worker_pool::get().submit(worker_priority::interactive, [&, i]
+				{
+					const std::string& dir = path_list[i];
+
+					try
+					{
+						const std::string sfo_dir = Emulator::GetSfoDirFromGamePath(dir, Emu.GetUsr());
+						const fs::file sfo_file(sfo_dir + "/PARAM.SFO");
+						if (!sfo_file)
+						{
+							return;
+						}
+
+						const auto psf = psf::load_object(sfo_file);
+
+						GameInfo& game = sfo_results[i].game;
+						game.path         = dir;
+						game.serial       = psf::get_string(psf, "TITLE_ID", "");
+						game.name         = psf::get_string(psf, "TITLE", cat_unknown);
+						game.app_ver      = psf::get_string(psf, "APP_VER", cat_unknown);
+						game.category     = psf::get_string(psf, "CATEGORY", cat_unknown);
+						game.fw           = psf::get_string(psf, "PS3_SYSTEM_VER", cat_unknown);
+						game.parental_lvl = psf::get_integer(psf, "PARENTAL_LEVEL", 0);
+						game.resolution   = psf::get_integer(psf, "RESOLUTION", 0);
+						game.sound_format = psf::get_integer(psf, "SOUND_FORMAT", 0);
+						game.bootable     = psf::get_integer(psf, "BOOTABLE", 0);
+						game.attr         = psf::get_integer(psf, "ATTRIBUTE", 0);
+						game.icon_path    = sfo_dir + "/ICON0.PNG";
+
+						sfo_results[i].psf_category = game.category;
+
+						auto cat = category::cat_boot.find(game.category);
+						if (cat != category::cat_boot.end())
+						{
+							game.category = sstr(cat->second);
+						}
+						else if ((cat = category::cat_data.find(game.category)) != category::cat_data.end())
+						{
+							game.category = sstr(cat->second);
+						}
+						else if (game.category != cat_unknown)
+						{
+							game.category = sstr(category::other);
+						}
+
+						sfo_results[i].valid = true;
+					}
+					catch (const std::exception& e)
+					{
+						LOG_FATAL(GENERAL, "Failed to update game list at %s\n%s thrown: %s", dir, typeid(e).name(), e.what());
+					}
+				}, &jobs);
 			}
 
-			const auto psf = psf::load_object(sfo_file);
+			jobs.wait();
+		}
 
-			GameInfo game;
-			game.path         = dir;
-			game.serial       = psf::get_string(psf, "TITLE_ID", "");
-			game.name         = psf::get_string(psf, "TITLE", cat_unknown);
-			game.app_ver      = psf::get_string(psf, "APP_VER", cat_unknown);
-			game.category     = psf::get_string(psf, "CATEGORY", cat_unknown);
-			game.fw           = psf::get_string(psf, "PS3_SYSTEM_VER", cat_unknown);
-			game.parental_lvl = psf::get_integer(psf, "PARENTAL_LEVEL", 0);
-			game.resolution   = psf::get_integer(psf, "RESOLUTION", 0);
-			game.sound_format = psf::get_integer(psf, "SOUND_FORMAT", 0);
-			game.bootable     = psf::get_integer(psf, "BOOTABLE", 0);
-			game.attr         = psf::get_integer(psf, "ATTRIBUTE", 0);
+		// Entries which still need their icon
+		struct icon_job
+		{
+			game_info entry;
+			QColor color;
+			QImage image;
+		};
+
+		std::vector<icon_job> icon_jobs;
+
+		for (sfo_result& result : sfo_results)
+		{
+			if (!result.valid)
+			{
+				continue;
+			}
+
+			GameInfo& game = result.game;
 
 			// Detect duplication
-			if (!serial_cat_name[game.serial].emplace(game.category + game.name).second)
+			if (!serial_cat_name[game.serial].emplace(result.psf_category + game.name).second)
 			{
 				continue;
 			}
@@ -483,51 +551,60 @@ void game_list_frame::Refresh(const bool fromDrive, const bool scrollAfter)
 			m_titles[serial] = m_gui_settings->GetValue(gui::titles, serial, "").toString().simplified();
 			serials.insert(serial);
 
-			auto cat = category::cat_boot.find(game.category);
-			if (cat != category::cat_boot.end())
-			{
-				game.icon_path = sfo_dir + "/ICON0.PNG";
-				game.category = sstr(cat->second);
-			}
-			else if ((cat = category::cat_data.find(game.category)) != category::cat_data.end())
-			{
-				game.icon_path = sfo_dir + "/ICON0.PNG";
-				game.category = sstr(cat->second);
-			}
-			else if (game.category == cat_unknown)
-			{
-				game.icon_path = sfo_dir + "/ICON0.PNG";
-			}
-			else
-			{
-				game.icon_path = sfo_dir + "/ICON0.PNG";
-				game.category = sstr(category::other);
-			}
-
-			// Load Image
-			QImage img;
-
-			if (game.icon_path.empty() || !img.load(qstr(game.icon_path)))
-			{
-				LOG_WARNING(GENERAL, "Could not load image from path %s", sstr(QDir(qstr(game.icon_path)).absolutePath()));
-			}
-
 			const auto compat = m_game_compat->GetCompatibility(game.serial);
 
 			const bool hasCustomConfig = fs::is_file(Emulator::GetCustomConfigPath(game.serial)) || fs::is_file(Emulator::GetCustomConfigPath(game.serial, true));
 			const bool hasCustomPadConfig = fs::is_file(Emulator::GetCustomInputConfigPath(game.serial));
 
 			const QColor color = getGridCompatibilityColor(compat.color);
-			const QPixmap pxmap = PaintedPixmap(img, hasCustomConfig, hasCustomPadConfig, color);
 
-			m_game_data.push_back(game_info(new gui_game_info{game, compat, img, pxmap, hasCustomConfig, hasCustomPadConfig}));
+			icon_jobs.push_back({game_info(new gui_game_info{game, compat, QImage(), QPixmap(), hasCustomConfig, hasCustomPadConfig}), color});
 		}
-		catch (const std::exception& e)
+
+		// Decode and paint icons on the worker pool, going through the icon cache
+		const int device_pixel_ratio = devicePixelRatio();
+
 		{
-			LOG_FATAL(GENERAL, "Failed to update game list at %s\n%s thrown: %s", dir, typeid(e).name(), e.what());
-			continue;
-			// Blame MSVC for double }}
-		}}
+			worker_pool::group jobs;
+
+			for (icon_job& job : icon_jobs)
+			{
+				worker_pool::get().submit(worker_priority::interactive, [&]
+				{
+					gui_game_info& game = *job.entry;
+
+					const std::string cache_path = GetIconCachePath(game, job.color, device_pixel_ratio);
+
+					if (!cache_path.empty() && job.image.load(qstr(cache_path)))
+					{
+						// Full size icon is only needed for repainting, it's loaded on demand
+						job.image.setDevicePixelRatio(device_pixel_ratio);
+						return;
+					}
+
+					if (game.info.icon_path.empty() || !game.icon.load(qstr(game.info.icon_path)))
+					{
+						LOG_WARNING(GENERAL, "Could not load image from path %s", sstr(QDir(qstr(game.info.icon_path)).absolutePath()));
+					}
+
+					job.image = PaintedImage(game.icon, game.hasCustomConfig, game.hasCustomPadConfig, job.color, device_pixel_ratio);
+
+					if (!cache_path.empty() && !game.icon.isNull())
+					{
+						fs::create_path(fs::get_parent_dir(cache_path));
+						job.image.save(qstr(cache_path), "PNG");
+					}
+				}, &jobs);
+			}
+
+			jobs.wait();
+		}
+
+		for (icon_job& job : icon_jobs)
+		{
+			job.entry->pxmap = QPixmap::fromImage(job.image);
+			m_game_data.push_back(std::move(job.entry));
+		}
 
 		// Try to update the app version for disc games if there is a patch
 		for (const auto& entry : m_game_data)
@@ -1476,9 +1553,29 @@ void game_list_frame::BatchRemoveShaderCaches()
 	QApplication::beep();
 }
 
+std::string game_list_frame::GetIconCachePath(const gui_game_info& game, const QColor& compatibility_color, int device_pixel_ratio) const
+{
+	fs::stat_t info;
+
+	if (game.info.icon_path.empty() || !fs::stat(game.info.icon_path, info))
+	{
+		return {};
+	}
+
+	// Key the painted icon by its source and everything the painting depends on
+	const std::string key = fmt::format("%s|%d|%u|%dx%d@%d|%08x|%08x|%d%d%d", game.info.icon_path, info.mtime, info.size, m_Icon_Size.width(), m_Icon_Size.height(), device_pixel_ratio,
+		m_Icon_Color.rgba(), compatibility_color.isValid() ? compatibility_color.rgba() : 0, m_isListLayout, game.hasCustomConfig, game.hasCustomPadConfig);
+
+	return fs::get_cache_dir() + "game_icons/" + fmt::format("%016x.png", std::hash<std::string>()(key));
+}
+
 QPixmap game_list_frame::PaintedPixmap(const QImage& img, bool paint_config_icon, bool paint_pad_config_icon, const QColor& compatibility_color)
 {
-	const int device_pixel_ratio = devicePixelRatio();
+	return QPixmap::fromImage(PaintedImage(img, paint_config_icon, paint_pad_config_icon, compatibility_color, devicePixelRatio()));
+}
+
+QImage game_list_frame::PaintedImage(const QImage& img, bool paint_config_icon, bool paint_pad_config_icon, const QColor& compatibility_color, int device_pixel_ratio) const
+{
 	const QSize original_size = img.size();
 
 	QImage image = QImage(original_size * device_pixel_ratio, QImage::Format_ARGB32);
@@ -1528,7 +1625,17 @@ QPixmap game_list_frame::PaintedPixmap(const QImage& img, bool paint_config_icon
 
 	painter.end();
 
-	return QPixmap::fromImage(image.scaled(m_Icon_Size * device_pixel_ratio, Qt::KeepAspectRatio, Qt::TransformationMode::SmoothTransformation));
+	QImage scaled = image.scaled(m_Icon_Size * device_pixel_ratio, Qt::KeepAspectRatio, Qt::TransformationMode::SmoothTransformation);
+	scaled.setDevicePixelRatio(device_pixel_ratio);
+	return scaled;
+}
+
+void game_list_frame::LoadIcon(gui_game_info& game)
+{
+	if (game.icon.isNull() && !game.info.icon_path.empty())
+	{
+		game.icon.load(qstr(game.info.icon_path));
+	}
 }
 
 void game_list_frame::ShowCustomConfigIcon(QTableWidgetItem* item)
@@ -1542,6 +1649,7 @@ void game_list_frame::ShowCustomConfigIcon(QTableWidgetItem* item)
 	if (!m_isListLayout)
 	{
 		const QColor color = getGridCompatibilityColor(game->compat.color);
+		LoadIcon(*game);
 		game->pxmap = PaintedPixmap(game->icon, game->hasCustomConfig, game->hasCustomPadConfig, color);
 		int r = m_xgrid->currentItem()->row(), c = m_xgrid->currentItem()->column();
 		m_xgrid->addItem(game->pxmap, qstr(game->info.name).simplified(), r, c);
@@ -1582,6 +1690,7 @@ void game_list_frame::RepaintIcons(const bool& fromSettings)
 	for (auto& game : m_game_data)
 	{
 		QColor color = getGridCompatibilityColor(game->compat.color);
+		LoadIcon(*game);
 		game->pxmap = PaintedPixmap(game->icon, game->hasCustomConfig, game->hasCustomPadConfig, color);
 	}
 
@@ -168,7 +168,7 @@ struct gui_game_info
 {
 	GameInfo info;
 	compat_status compat;
-	QImage icon;
+	QImage icon; // Full size icon, may be null until needed when the painted one came from the icon cache
 	QPixmap pxmap;
 	bool hasCustomConfig;
 	bool hasCustomPadConfig;
@@ -237,6 +237,9 @@ protected:
 	bool eventFilter(QObject *object, QEvent *event) override;
 private:
 	QPixmap PaintedPixmap(const QImage& img, bool paint_config_icon = false, bool paint_pad_config_icon = false, const QColor& color = QColor());
+	QImage PaintedImage(const QImage& img, bool paint_config_icon, bool paint_pad_config_icon, const QColor& color, int device_pixel_ratio) const; // Thread safe while the icon settings don't change
+	std::string GetIconCachePath(const gui_game_info& game, const QColor& compatibility_color, int device_pixel_ratio) const;
+	void LoadIcon(gui_game_info& game);
 	QColor getGridCompatibilityColor(const QString& string);
 	void ShowCustomConfigIcon(QTableWidgetItem* item);
 	void PopulateGameGrid(int maxCols, const QSize& image_size, const QColor& image_color);
@@ -9,6 +9,7 @@
 #include <QThread>
 #include <QLibraryInfo>
 #include <QMessageBox>
+#include <QScreen>
 #include <string>
 
 #include "rpcs3_version.h"
@@ -277,6 +278,13 @@ int gs_frame::client_height()
 	return height() * devicePixelRatio();
 }
 
+double gs_frame::refresh_rate()
+{
+	// Follows the window to whichever screen it was moved to
+	const QScreen* current_screen = screen();
+	return current_screen ? current_screen->refreshRate() : 0.;
+}
+
 void gs_frame::flip(draw_context_t, bool /*skip_frame*/)
 {
 	if (m_show_fps)
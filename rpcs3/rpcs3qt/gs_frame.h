@@ -72,6 +72,7 @@ protected:
 	void flip(draw_context_t context, bool skip_frame=false) override;
 	int client_width() override;
 	int client_height() override;
+	double refresh_rate() override;
 
 	bool event(QEvent* ev) override;
 
@@ -23,6 +23,8 @@
 #include "Emu/Cell/lv2/sys_timer.h"
 #include "Emu/Cell/lv2/sys_process.h"
 #include "Emu/Cell/lv2/sys_fs.h"
+#include "Emu/Cell/Modules/sysPrxForUser.h"
+#include "Utilities/lock_profiler.h"
 
 #include "kernel_explorer.h"
 
@@ -223,7 +225,15 @@ void kernel_explorer::Update()
 		case SYS_LWMUTEX_OBJECT:
 		{
 			auto& lwm = static_cast<lv2_lwmutex&>(obj);
-			l_addTreeChild(node, qstr(fmt::format("LWMutex: ID = 0x%08x \"%s\", Wq = %zu", id, +name64(lwm.name), lwm.sq.size())));
+			const auto lwm_node = l_addTreeChild(node, qstr(fmt::format("LWMutex: ID = 0x%08x \"%s\", Wq = %zu", id, +name64(lwm.name), lwm.sq.size())));
+
+			lwmutex_spin_info spin;
+
+			if (lwmutex_get_spin_info(lwm.control.addr(), spin))
+			{
+				l_addTreeChild(lwm_node, qstr(fmt::format("Spin: Hold = %uns, Acquired = %llu, Failed = %llu, Skipped = %llu", spin.hold_ns, spin.spin_acquired, spin.spin_failed, spin.spin_skipped)));
+			}
+
 			break;
 		}
 		case SYS_TIMER_OBJECT:
@@ -299,6 +309,14 @@ void kernel_explorer::Update()
 		l_addTreeChild(lv2_types.back().node, qstr(fmt::format("FD: ID = 0x%08x '%s'", id, fo.name.data())));
 	});
 
+	lv2_types.emplace_back(l_addTreeChild(root, "Lock Contention"));
+
+	for (const auto& stats : lock_profiler::get_stats())
+	{
+		lv2_types.back().count++;
+		l_addTreeChild(lv2_types.back().node, qstr(fmt::format("%s: Waits = %u, Total = %.3f ms, Max = %.3f ms, Threads = %u", stats.name, stats.count, stats.total_ns / 1000000., stats.max_ns / 1000000., stats.contenders.size())));
+	}
+
 	for (auto&& entry : lv2_types)
 	{
 		if (entry.node && entry.count)
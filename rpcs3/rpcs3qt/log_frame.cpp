@@ -48,6 +48,11 @@ struct gui_listener : logs::listener
 	{
 	}
 
+	bool wants(logs::level sev) const override
+	{
+		return sev <= enabled;
+	}
+
 	void log(u64 stamp, const logs::message& msg, const std::string& prefix, const std::string& text)
 	{
 		Q_UNUSED(stamp);
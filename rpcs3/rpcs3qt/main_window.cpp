@@ -33,11 +33,13 @@
 #include "pad_settings_dialog.h"
 #include "progress_dialog.h"
 
+#include <mutex>
 #include <thread>
 
 #include "stdafx.h"
 #include "Emu/System.h"
 #include "Emu/Memory/vm.h"
+#include "Emu/Cell/PPUFunction.h"
 
 #include "Crypto/unpkg.h"
 #include "Crypto/unself.h"
@@ -561,8 +563,16 @@ void main_window::InstallPup(const QString& dropPath)
 		return;
 	}
 
-	fs::file update_files_f = pup.get_file(0x300);
-	tar_object update_files(update_files_f);
+	const u64 update_files_offset = pup.get_file_offset(0x300);
+	if (update_files_offset == -1)
+	{
+		LOG_ERROR(GENERAL, "Error while installing firmware: PUP file is invalid.");
+		QMessageBox::critical(this, tr("Failure!"), tr("Error while installing firmware: PUP file is invalid."));
+		return;
+	}
+
+	// Read update_files.tar in place instead of copying it out of the PUP
+	tar_object update_files(pup_f, update_files_offset);
 	auto updatefilenames = update_files.get_filenames();
 
 	updatefilenames.erase(std::remove_if(
@@ -592,14 +602,33 @@ void main_window::InstallPup(const QString& dropPath)
 	// Synchronization variable
 	atomic_t<int> progress(0);
 	{
-		// Run asynchronously
-		named_thread worker("Firmware Installer", [&]
+		// Errors are reported once all workers are done, message boxes can't be shown from them
+		enum : u32 { no_error, invalid_pup, invalid_tar };
+		atomic_t<u32> error{no_error};
+
+		atomic_t<u32> next_file{0};
+		atomic_t<u32> finished{0};
+
+		// update_files shares the position of the PUP file
+		std::mutex update_files_mutex;
+
+		// dev_flash packages are independent, decrypt and extract them in parallel
+		auto install = [&]
 		{
-			for (const auto& updatefilename : updatefilenames)
+			while (progress >= 0)
 			{
-				if (progress == -1) break;
+				const u32 index = next_file++;
+
+				if (index >= updatefilenames.size())
+				{
+					break;
+				}
 
-				fs::file updatefile = update_files.get_file(updatefilename);
+				fs::file updatefile;
+				{
+					std::lock_guard lock(update_files_mutex);
+					updatefile = update_files.get_file(updatefilenames[index]);
+				}
 
 				SCEDecrypter self_dec(updatefile);
 				self_dec.LoadHeaders();
@@ -610,25 +639,43 @@ void main_window::InstallPup(const QString& dropPath)
 				if (dev_flash_tar_f.size() < 3)
 				{
 					LOG_ERROR(GENERAL, "Error while installing firmware: PUP contents are invalid.");
-					QMessageBox::critical(this, tr("Failure!"), tr("Error while installing firmware: PUP contents are invalid."));
+					error.compare_and_swap(no_error, invalid_pup);
 					progress = -1;
+					break;
 				}
 
 				tar_object dev_flash_tar(dev_flash_tar_f[2]);
 				if (!dev_flash_tar.extract(g_cfg.vfs.get_dev_flash(), "dev_flash/"))
 				{
 					LOG_ERROR(GENERAL, "Error while installing firmware: TAR contents are invalid.");
-					QMessageBox::critical(this, tr("Failure!"), tr("Error while installing firmware: TAR contents are invalid."));
+					error.compare_and_swap(no_error, invalid_tar);
 					progress = -1;
+					break;
 				}
 
-				if (progress >= 0)
-					progress += 1;
+				progress.fetch_op([](int& value)
+				{
+					if (value >= 0)
+					{
+						value++;
+					}
+				});
 			}
-		});
+
+			finished++;
+		};
+
+		const u32 worker_count = std::min<u32>(std::clamp<u32>(std::thread::hardware_concurrency(), 2, 8), ::size32(updatefilenames));
+
+		std::vector<std::unique_ptr<named_thread<decltype(install)>>> workers;
+
+		for (u32 i = 0; i < worker_count; i++)
+		{
+			workers.emplace_back(std::make_unique<named_thread<decltype(install)>>(fmt::format("Firmware Installer %u", i), install));
+		}
 
 		// Wait for the completion
-		while (std::this_thread::sleep_for(5ms), std::abs(progress) < pdlg.maximum())
+		while (std::this_thread::sleep_for(5ms), finished < worker_count)
 		{
 			if (pdlg.wasCanceled())
 			{
@@ -636,13 +683,24 @@ void main_window::InstallPup(const QString& dropPath)
 				break;
 			}
 			// Update progress window
-			pdlg.SetValue(static_cast<int>(progress));
+			pdlg.SetValue(std::max<int>(progress, 0));
 			QCoreApplication::processEvents();
 		}
 
-		update_files_f.close();
+		// Wait for the packages in progress
+		workers.clear();
+
 		pup_f.close();
 
+		if (error == invalid_pup)
+		{
+			QMessageBox::critical(this, tr("Failure!"), tr("Error while installing firmware: PUP contents are invalid."));
+		}
+		else if (error == invalid_tar)
+		{
+			QMessageBox::critical(this, tr("Failure!"), tr("Error while installing firmware: TAR contents are invalid."));
+		}
+
 		if (progress > 0)
 		{
 			pdlg.SetValue(pdlg.maximum());
@@ -841,6 +899,7 @@ void main_window::OnEmuRun()
 	ui->toolbar_start->setIcon(m_icon_pause);
 	ui->toolbar_start->setText(tr("Pause"));
 	ui->toolbar_start->setToolTip(tr("Pause emulation"));
+	ui->toolsHleCallStatsAct->setChecked(g_cfg.misc.hle_call_stats);
 	EnableMenus(true);
 
 #ifdef WITH_DISCORD_RPC
@@ -883,6 +942,9 @@ void main_window::OnEmuStop()
 	m_debuggerFrame->EnableButtons(false);
 	m_debuggerFrame->ClearBreakpoints();
 
+	// The report is written on stop
+	ui->toolsHleCallStatsAct->setChecked(false);
+
 	ui->sysPauseAct->setText(Emu.IsReady() ? tr("&Start\tCtrl+E") : tr("&Resume\tCtrl+E"));
 	ui->sysPauseAct->setIcon(m_icon_play);
 #ifdef _WIN32
@@ -1369,6 +1431,22 @@ void main_window::CreateConnects()
 		mss->show();
 	});
 
+	connect(ui->toolsHleCallStatsAct, &QAction::triggered, [=](bool checked)
+	{
+		if (checked)
+		{
+			ppu_call_stats::start();
+			return;
+		}
+
+		const std::string path = fs::get_cache_dir() + "hle_calls.csv";
+
+		if (ppu_call_stats::stop(path))
+		{
+			QMessageBox::information(this, tr("HLE Call Statistics"), tr("The report was saved to %0").arg(qstr(path)));
+		}
+	});
+
 	connect(ui->toolsDecryptSprxLibsAct, &QAction::triggered, this, &main_window::DecryptSPRXLibraries);
 
 	connect(ui->showDebuggerAct, &QAction::triggered, [=](bool checked)
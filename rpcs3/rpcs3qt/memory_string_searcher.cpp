@@ -1,8 +1,173 @@
 
 #include "memory_string_searcher.h"
+#include "Utilities/Thread.h"
 
 #include <QLabel>
 
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+	// Search block size per job (start addresses only, matches may extend past the block)
+	constexpr u32 c_search_block = 0x100000;
+
+	struct search_pattern
+	{
+		std::vector<u8> bytes;
+		std::vector<u8> mask; // 0xff for bytes which must match, 0 for wildcards
+		u32 anchor = 0; // Index of the first non-wildcard byte
+
+		// Parse hex pattern like "DE AD ?? EF"
+		bool parse_hex(const std::string& str)
+		{
+			std::string digits;
+
+			for (char c : str)
+			{
+				if (c != ' ')
+				{
+					digits += c;
+				}
+			}
+
+			if (digits.empty() || digits.size() % 2)
+			{
+				return false;
+			}
+
+			for (std::size_t i = 0; i < digits.size(); i += 2)
+			{
+				const std::string byte = digits.substr(i, 2);
+
+				if (byte == "??")
+				{
+					bytes.push_back(0);
+					mask.push_back(0);
+					continue;
+				}
+
+				if (!std::isxdigit(static_cast<uchar>(byte[0])) || !std::isxdigit(static_cast<uchar>(byte[1])))
+				{
+					return false;
+				}
+
+				bytes.push_back(static_cast<u8>(std::stoul(byte, nullptr, 16)));
+				mask.push_back(0xff);
+			}
+
+			return finalize();
+		}
+
+		void set_string(const std::string& str)
+		{
+			bytes.assign(str.begin(), str.end());
+			mask.assign(str.size(), 0xff);
+			finalize();
+		}
+
+		bool finalize()
+		{
+			anchor = 0;
+
+			while (anchor < mask.size() && !mask[anchor])
+			{
+				anchor++;
+			}
+
+			// All wildcards can't be searched for
+			return anchor < mask.size();
+		}
+
+		bool match(const u8* ptr) const
+		{
+			for (std::size_t i = 0; i < bytes.size(); i++)
+			{
+				if ((ptr[i] & mask[i]) != bytes[i])
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+
+	struct search_state
+	{
+		search_pattern pattern;
+		atomic_t<u32> remaining{0};
+		atomic_t<u32> found{0};
+	};
+
+	// Search start addresses [start, end) of a mapped range [start, limit)
+	void search_range(search_state& state, u32 start, u32 end, u32 limit)
+	{
+		const search_pattern& pat = state.pattern;
+		const u32 size = static_cast<u32>(pat.bytes.size());
+
+		if (limit - start < size)
+		{
+			return;
+		}
+
+		end = std::min(end, limit - size + 1);
+
+		const u8* const base = vm::g_base_addr;
+		const u8 first = pat.bytes[pat.anchor];
+
+		for (u32 addr = start; addr < end;)
+		{
+			// Find candidates by the anchor byte (vectorized by the C library)
+			const u8* ptr = static_cast<const u8*>(std::memchr(base + addr + pat.anchor, first, end - addr));
+
+			if (!ptr)
+			{
+				break;
+			}
+
+			addr = static_cast<u32>(ptr - base) - pat.anchor;
+
+			if (pat.match(ptr - pat.anchor))
+			{
+				LOG_NOTICE(GENERAL, "Found @ 0x%08x", addr);
+				state.found++;
+			}
+
+			addr++;
+		}
+	}
+
+	void search_block(search_state& state, u32 block_start, u32 block_end)
+	{
+		vm::reader_lock lock;
+
+		const u32 size = static_cast<u32>(state.pattern.bytes.size());
+
+		// Find mapped page runs (the last match may reach into the next block)
+		for (u32 addr = block_start; addr < block_end;)
+		{
+			if (!vm::check_addr(addr, 4096))
+			{
+				addr += 4096;
+				continue;
+			}
+
+			// Extend the run over mapped pages up to the end of the block plus the pattern overlap
+			const u64 need = u64{block_end} + size - 1;
+			u32 limit = addr + 4096;
+
+			while (limit && limit < need && vm::check_addr(limit, 4096))
+			{
+				limit += 4096;
+			}
+
+			search_range(state, addr, std::min(limit, block_end), limit);
+			addr = limit;
+		}
+	}
+}
+
 memory_string_searcher::memory_string_searcher(QWidget* parent)
 	: QDialog(parent)
 {
@@ -14,10 +179,13 @@ memory_string_searcher::memory_string_searcher(QWidget* parent)
 	m_addr_line->setFixedWidth(QLabel("This is the very length of the lineedit due to hidpi reasons.").sizeHint().width());
 	m_addr_line->setPlaceholderText(tr("Search..."));
 
+	m_chkbox_hex = new QCheckBox(tr("Hex (?? = any byte)"), this);
+
 	QPushButton* button_search = new QPushButton(tr("&Search"), this);
 
 	QHBoxLayout* hbox_panel = new QHBoxLayout();
 	hbox_panel->addWidget(m_addr_line);
+	hbox_panel->addWidget(m_chkbox_hex);
 	hbox_panel->addWidget(button_search);
 
 	setLayout(hbox_panel);
@@ -29,48 +197,49 @@ memory_string_searcher::memory_string_searcher(QWidget* parent)
 
 void memory_string_searcher::OnSearch()
 {
-	const QString wstr = m_addr_line->text();
-	const char *str = wstr.toStdString().c_str();
-	const u32 len = wstr.length();
+	const std::string wstr = m_addr_line->text().toStdString();
 
-	LOG_NOTICE(GENERAL, "Searching for string %s", str);
+	auto state = std::make_shared<search_state>();
 
-	// Search the address space for the string
-	u32 strIndex = 0;
-	u32 numFound = 0;
-	const auto area = vm::get(vm::main);
-	for (u32 addr = area->addr; addr < area->addr + area->size; addr++)
+	if (m_chkbox_hex->isChecked())
 	{
-		if (!vm::check_addr(addr))
+		if (!state->pattern.parse_hex(wstr))
 		{
-			strIndex = 0;
-			continue;
+			LOG_ERROR(GENERAL, "Invalid search pattern: %s", wstr);
+			return;
 		}
+	}
+	else if (!wstr.empty())
+	{
+		state->pattern.set_string(wstr);
+	}
+	else
+	{
+		return;
+	}
 
-		u8 byte = vm::read8(addr);
-		if (byte == str[strIndex])
-		{
-			if (strIndex == len)
-			{
-				// Found it
-				LOG_NOTICE(GENERAL, "Found @ %04x", addr - len);
-				numFound++;
-				strIndex = 0;
-				continue;
-			}
+	LOG_NOTICE(GENERAL, "Searching for %s %s", m_chkbox_hex->isChecked() ? "pattern" : "string", wstr);
 
-			strIndex++;
-		}
-		else
-		{
-			strIndex = 0;
-		}
+	// Search the address space in blocks on the worker pool, matches are logged as they are found
+	const auto area = vm::get(vm::main);
+	const u32 area_end = area->addr + area->size;
+	const u32 count = (area->size + c_search_block - 1) / c_search_block;
+
+	state->remaining = count;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		const u32 block_start = area->addr + i * c_search_block;
+		const u32 block_end = std::min(block_start + c_search_block, area_end);
 
-		if (addr % (1024 * 1024 * 64) == 0) // Log every 64mb
+		worker_pool::get().submit(worker_priority::interactive, [state, block_start, block_end]
 		{
-			LOG_NOTICE(GENERAL, "Searching %04x ...", addr);
-		}
-	}
+			search_block(*state, block_start, block_end);
 
-	LOG_NOTICE(GENERAL, "Search completed (found %d matches)", numFound);
+			if (state->remaining-- == 1)
+			{
+				LOG_NOTICE(GENERAL, "Search completed (found %u matches)", state->found.load());
+			}
+		});
+	}
 }
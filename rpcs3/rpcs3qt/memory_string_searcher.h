@@ -7,6 +7,7 @@
 #include <QDialog>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QCheckBox>
 #include <QHBoxLayout>
 
 class memory_string_searcher : public QDialog
@@ -14,6 +15,7 @@ class memory_string_searcher : public QDialog
 	Q_OBJECT
 
 	QLineEdit* m_addr_line;
+	QCheckBox* m_chkbox_hex;
 
 public:
 	memory_string_searcher(QWidget* parent);